@@ -1,16 +1,42 @@
 
-struct TerrainLod
+// Quadtree leaf patch size in world units and the number of grid cells a patch at its own LOD is tessellated into.
+#define TERRAIN_LEAF_SIZE 16.f
+#define TERRAIN_PATCH_GRID_SIZE 16.f
+#define TERRAIN_MAX_LODS 8
+
+// Height clipmap levels and the width in level texels over which a level fades into the next coarser one at the edge of its resident region.
+#define TERRAIN_MAX_CLIPMAP_LEVELS 8
+#define TERRAIN_CLIPMAP_BLEND_TEXELS 8.f
+
+struct TerrainClipmapLevel
 {
-	// Min world pos and size of each LOD level.
-	float2 minPos;
+	// Range of level texel coordinates that only samples resident tiles.  Unbounded along edges of the heightmap.
+	float2 validMin;
+	float2 validMax;
+
+	// Size of the level in texels.
 	float2 size;
+	float2 unused;
 };
 
 struct DsTerrain
 {
-	TerrainLod lods[4];
+	TerrainClipmapLevel clipmapLevels[TERRAIN_MAX_CLIPMAP_LEVELS];
+
+	// CDLOD morph range of each quadtree LOD.  x = distance the morph to the next LOD starts, y = 1 / morph distance.
+	float4 lodMorphRanges[TERRAIN_MAX_LODS];
+
+	// Position LOD distances are measured from.  Always the scene camera so shadow passes morph identically.
+	float3 lodOrigin;
+	float unused0;
+
+	// World position of the quadtree's min corner.  Morph grids and the heightmap are aligned to it.
+	float2 gridOrigin;
+	// Finest clipmap level texels per world unit.
+	float2 heightmapTexelsPerUnit;
 
-	float2 heightmapTexelSize;
 	float heightScale;
-	float unused;
+	float clipmapRingTexelsRcp;
+	uint numClipmapLevels;
+	float unused1;
 };
@@ -2,7 +2,7 @@
 #include "v_output.hlsli"
 #include "d_constants.h"
 
-Texture2D texHeightmap : register(t0);
+Texture2DArray texHeightClipmap : register(t0);
 SamplerState sampHeightmap : register(s0);
 
 cbuffer PerAction : register(b0)
@@ -17,6 +17,50 @@ cbuffer TerrainBuffer : register(b1)
 
 #define NUM_CONTROL_POINTS 4
 
+float2 getHeightmapTexel(float2 pos_ws)
+{
+	return (pos_ws - cbTerrain.gridOrigin) * cbTerrain.heightmapTexelsPerUnit;
+}
+
+float sampleClipmapLevel(float2 texel, uint level)
+{
+	// Tiles are stored toroidally so level texels map straight onto the wrapping ring.
+	TerrainClipmapLevel clipmapLevel = cbTerrain.clipmapLevels[level];
+	float2 levelTexel = clamp(texel * exp2(-(float)level), 0.5f, clipmapLevel.size - 0.5f);
+	return texHeightClipmap.SampleLevel(sampHeightmap, float3(levelTexel * cbTerrain.clipmapRingTexelsRcp, level), 0).r;
+}
+
+float sampleHeight(float2 pos_ws)
+{
+	float2 texel = getHeightmapTexel(pos_ws);
+
+	// Use the finest level with resident data, fading into the next level toward the edge of its resident region.
+	uint coarsestLevel = cbTerrain.numClipmapLevels - 1;
+	uint level = coarsestLevel;
+	float fineWeight = 1.f;
+	[loop]
+	for (uint i = 0; i < coarsestLevel; ++i)
+	{
+		TerrainClipmapLevel clipmapLevel = cbTerrain.clipmapLevels[i];
+		float2 levelTexel = texel * exp2(-(float)i);
+		float2 edgeDist = min(levelTexel - clipmapLevel.validMin, clipmapLevel.validMax - levelTexel);
+		if (all(edgeDist >= 0.f))
+		{
+			level = i;
+			fineWeight = saturate(min(edgeDist.x, edgeDist.y) / TERRAIN_CLIPMAP_BLEND_TEXELS);
+			break;
+		}
+	}
+
+	float height = sampleClipmapLevel(texel, level);
+	if (fineWeight < 1.f)
+	{
+		height = lerp(sampleClipmapLevel(texel, level + 1), height, fineWeight);
+	}
+
+	return height * cbTerrain.heightScale;
+}
+
 [domain("quad")]
 DsOutputTerrain main(
 	float2 uv : SV_DomainLocation,
@@ -29,24 +73,34 @@ DsOutputTerrain main(
 	float4 edge2 = lerp(patch[3].position_ws, patch[2].position_ws, uv.x);
 	output.position_ws = lerp(edge1, edge2, uv.y);
 
-	float2 uvHeight = (output.position_ws.xz - cbTerrain.lods[patch[0].lod].minPos) / cbTerrain.lods[patch[0].lod].size;
-	output.position_ws.y = texHeightmap.SampleLevel(sampHeightmap, uvHeight, 0).r * cbTerrain.heightScale;
+	output.position_ws.y = sampleHeight(output.position_ws.xz);
+
+	// Morph odd grid vertices onto the next coarser grid as the vertex approaches the end of its LOD's range.
+	uint lod = (uint)patch[0].lod;
+	float morphDist = length(output.position_ws.xyz - cbTerrain.lodOrigin);
+	float morphK = saturate((morphDist - cbTerrain.lodMorphRanges[lod].x) * cbTerrain.lodMorphRanges[lod].y);
+
+	float gridCellSize = TERRAIN_LEAF_SIZE * exp2(lod) / TERRAIN_PATCH_GRID_SIZE;
+	float2 gridPos = (output.position_ws.xz - cbTerrain.gridOrigin) / gridCellSize;
+	float2 oddOffset = gridPos - 2.f * floor(gridPos * 0.5f + 0.25f);
+	output.position_ws.xz -= oddOffset * morphK * gridCellSize;
+
+	output.position_ws.y = sampleHeight(output.position_ws.xz);
 
 	output.position = mul(output.position_ws, cbPerAction.mtxViewProj);
 
 #if !DEPTH_ONLY
 	output.texcoords = float2(output.position_ws.x, output.position_ws.z);
 
-	// Calculate normal from height data.
-	float2 texelSize = cbTerrain.heightmapTexelSize;
+	// Calculate normal from height data one finest level texel to either side.
+	float2 texelSize = 1.f / cbTerrain.heightmapTexelsPerUnit;
 	float4 heights;
-	heights.x = texHeightmap.SampleLevel(sampHeightmap, uvHeight + float2(-texelSize.x, 0.f), 0).r;
-	heights.y = texHeightmap.SampleLevel(sampHeightmap, uvHeight + float2(texelSize.x, 0.f), 0).r;
-	heights.z = texHeightmap.SampleLevel(sampHeightmap, uvHeight + float2(0.f, -texelSize.y), 0).r;
-	heights.w = texHeightmap.SampleLevel(sampHeightmap, uvHeight + float2(0.f, texelSize.y), 0).r;
-	heights *= cbTerrain.heightScale;
+	heights.x = sampleHeight(output.position_ws.xz + float2(-texelSize.x, 0.f));
+	heights.y = sampleHeight(output.position_ws.xz + float2(texelSize.x, 0.f));
+	heights.z = sampleHeight(output.position_ws.xz + float2(0.f, -texelSize.y));
+	heights.w = sampleHeight(output.position_ws.xz + float2(0.f, texelSize.y));
 
-	output.normal = normalize(float3(heights.x - heights.y, 2.f, heights.z - heights.w));
+	output.normal = normalize(float3((heights.x - heights.y) * texelSize.y, 2.f * texelSize.x * texelSize.y, (heights.z - heights.w) * texelSize.x));
 #endif
 
 	return output;
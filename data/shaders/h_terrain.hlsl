@@ -1,4 +1,5 @@
 #include "v_output.hlsli"
+#include "d_constants.h"
 
 #define NUM_CONTROL_POINTS 4
 
@@ -8,20 +9,25 @@ HsPatchConstants CalcHSPatchConstants(
 {
 	HsPatchConstants patchConstants;
 
-	const float kTessFactor = 16.f;
-	patchConstants.edgeTessFactor[0] = kTessFactor;
-	patchConstants.edgeTessFactor[1] = kTessFactor;
-	patchConstants.edgeTessFactor[2] = kTessFactor;
-	patchConstants.edgeTessFactor[3] = kTessFactor;
+	// Patches smaller than a full patch at their LOD (quarters of a coarser node) get proportionally fewer cells
+	// so every patch at a given LOD shares the same grid spacing.
+	float patchSize = input[2].position_ws.x - input[0].position_ws.x;
+	float lodPatchSize = TERRAIN_LEAF_SIZE * exp2(input[0].lod);
+	float tessFactor = max(TERRAIN_PATCH_GRID_SIZE * patchSize / lodPatchSize, 1.f);
 
-	patchConstants.insideTessFactors[0] = kTessFactor;
-	patchConstants.insideTessFactors[1] = kTessFactor;
+	patchConstants.edgeTessFactor[0] = tessFactor;
+	patchConstants.edgeTessFactor[1] = tessFactor;
+	patchConstants.edgeTessFactor[2] = tessFactor;
+	patchConstants.edgeTessFactor[3] = tessFactor;
+
+	patchConstants.insideTessFactors[0] = tessFactor;
+	patchConstants.insideTessFactors[1] = tessFactor;
 
 	return patchConstants;
 }
 
 [domain("quad")]
-[partitioning("fractional_odd")]
+[partitioning("integer")]
 [outputtopology("triangle_cw")]
 [outputcontrolpoints(NUM_CONTROL_POINTS)]
 [patchconstantfunc("CalcHSPatchConstants")]
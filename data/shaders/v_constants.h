@@ -12,6 +12,11 @@ struct VsPerAction
 struct VsPerObject
 {
 	float4x4 mtxWorld;
+	// Converts packed unorm vertex positions to model space.  Only used with PACKED_VERTICES.
+	float3 positionDequantScale;
+	float unused0;
+	float3 positionDequantOffset;
+	float unused1;
 };
 
 #endif // SHADER_V_CONSTANTS_H
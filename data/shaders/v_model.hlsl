@@ -23,17 +23,35 @@ cbuffer PerObject : register(b1)
 
 struct VertexInput
 {
+#if PACKED_VERTICES
+	float4 position : POSITION; // Unorm relative to the model bounds.  w is the bitangent sign.
+	float2 normal : NORMAL; // Octahedral
+	float4 color : COLOR;
+	float2 texcoords : TEXCOORD0;
+	float2 tangent : TANGENT; // Octahedral
+#else
 	float3 position : POSITION;
 	float3 normal : NORMAL;
 	float4 color : COLOR;
 	float2 texcoords : TEXCOORD0;
 	float3 tangent : TANGENT;
 	float3 bitangent : BINORMAL;
+#endif
 #if IS_INSTANCED
 	uint instanceId : SV_InstanceID;
 #endif
 };
 
+#if PACKED_VERTICES
+float3 octDecode(float2 e)
+{
+	float3 n = float3(e.xy, 1.f - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += (n.xy >= 0.f) ? -t : t;
+	return normalize(n);
+}
+#endif
+
 VsOutputModel main( VertexInput input )
 {
 	VsOutputModel output = (VsOutputModel)0;
@@ -41,19 +59,35 @@ VsOutputModel main( VertexInput input )
 #if IS_INSTANCED
 	uint idx = objectIds[input.instanceId / 4][input.instanceId % 4];
 	VsPerObject perObject = g_bufPerObject[idx];
+#else
+	VsPerObject perObject = cbPerObject;
+#endif
 	float4x4 mtxWorld = perObject.mtxWorld;
+
+#if PACKED_VERTICES
+	float3 position = input.position.xyz * perObject.positionDequantScale + perObject.positionDequantOffset;
 #else
-	float4x4 mtxWorld = cbPerObject.mtxWorld;
+	float3 position = input.position;
 #endif
 
-	output.position_ws = mul(float4(input.position, 1), mtxWorld);
+	output.position_ws = mul(float4(position, 1), mtxWorld);
 
 	output.position = mul(output.position_ws, cbPerAction.mtxViewProj);
 
 #if !DEPTH_ONLY
-	output.normal = mul(input.normal, (float3x3)mtxWorld);
-	output.tangent = mul(input.tangent, (float3x3)mtxWorld);
-	output.bitangent = mul(input.bitangent, (float3x3)mtxWorld);
+#if PACKED_VERTICES
+	float3 normal = octDecode(input.normal);
+	float3 tangent = octDecode(input.tangent);
+	float3 bitangent = cross(normal, tangent) * (input.position.w * 2.f - 1.f);
+#else
+	float3 normal = input.normal;
+	float3 tangent = input.tangent;
+	float3 bitangent = input.bitangent;
+#endif
+
+	output.normal = mul(normal, (float3x3)mtxWorld);
+	output.tangent = mul(tangent, (float3x3)mtxWorld);
+	output.bitangent = mul(bitangent, (float3x3)mtxWorld);
 
 	output.color = input.color;
 	output.texcoords = input.texcoords;
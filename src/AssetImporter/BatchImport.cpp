@@ -0,0 +1,639 @@
+#include "BatchImport.h"
+#include "ModelImport.h"
+#include "TextureImport.h"
+#include "UtilsLib/Paths.h"
+#include "UtilsLib/Util.h"
+#include "UtilsLib/Error.h"
+#include "UtilsLib/Hash.h"
+#include "UtilsLib/Timer.h"
+#include "UtilsLib/ThreadMutex.h"
+#include "UtilsLib/FileLoader.h"
+#include "UtilsLib/json/json.h"
+#include "AssetLib/AssetDef.h"
+#include "AssetLib/BinFile.h"
+#include "AssetLib/ModelAsset.h"
+#include "AssetLib/SceneAsset.h"
+#include "AssetLib/TextureAsset.h"
+#include "AssetLib/MaterialAsset.h"
+#include "AssetLib/TerrainTilesAsset.h"
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <sys/stat.h>
+
+namespace
+{
+	enum class SourceType
+	{
+		Obj,
+		Fbx,
+		Texture,
+
+		Count
+	};
+
+	struct ImportJob
+	{
+		std::string srcFilename;
+		std::string relFilename;
+		std::string outFilename;
+		SourceType eType;
+		uint binVersion;
+		uint importVersion;
+		AssetLib::ModelFlags eModelFlags;
+		uint srcFileSize;
+
+		// Normalized lower case paths of the files the import writes and reads.
+		// Entries ending in a separator are directories and cover everything under them.
+		std::vector<std::string> outputs;
+		std::vector<std::string> dependencies;
+
+		Hashing::SHA1 srcHash;
+		bool bSkipped;
+		bool bSucceeded;
+	};
+
+	// Jobs that write to the same files, or write files another job reads, run one after another in gather order.
+	typedef std::vector<uint> JobGroup;
+
+	struct ManifestEntry
+	{
+		Hashing::SHA1 srcHash;
+		uint binVersion;
+		uint importVersion;
+		AssetLib::ModelFlags eModelFlags;
+	};
+
+	typedef std::map<std::string, ManifestEntry, StringInvariantCompare> ImportManifest;
+
+	static const char* kManifestFilename = "import_manifest.json";
+
+	bool getSourceType(const char* filename, SourceType* pOutType)
+	{
+		const char* ext = Paths::GetExtension(filename);
+		if (!ext)
+			return false;
+
+		if (_stricmp(ext, "obj") == 0)
+		{
+			*pOutType = SourceType::Obj;
+			return true;
+		}
+		else if (_stricmp(ext, "fbx") == 0)
+		{
+			*pOutType = SourceType::Fbx;
+			return true;
+		}
+		else if (_stricmp(ext, "tga") == 0 || _stricmp(ext, "tif") == 0 || _stricmp(ext, "dds") == 0)
+		{
+			*pOutType = SourceType::Texture;
+			return true;
+		}
+
+		return false;
+	}
+
+	// The asset written last by an import.  FBX scenes write their meshes and materials before the scene file.
+	const AssetLib::AssetDef& getOutputAssetDef(SourceType eType)
+	{
+		switch (eType)
+		{
+		case SourceType::Obj:
+			return AssetLib::Model::GetAssetDef();
+		case SourceType::Fbx:
+			return AssetLib::Scene::GetAssetDef();
+		case SourceType::Texture:
+		default:
+			return AssetLib::Texture::GetAssetDef();
+		}
+	}
+
+	std::string getOutputFilename(const char* filename, const AssetLib::AssetDef& rAssetDef)
+	{
+		char assetName[256];
+		Paths::GetFilenameNoExtension(filename, assetName, ARRAY_SIZE(assetName));
+
+		std::string outFilename = Paths::GetSrcDataDir();
+		outFilename += "/";
+		outFilename += rAssetDef.GetFolder();
+		outFilename += "/";
+		outFilename += assetName;
+		outFilename += ".";
+		outFilename += rAssetDef.GetExt();
+
+		return outFilename;
+	}
+
+	void normalizePath(std::string& path)
+	{
+		std::replace(path.begin(), path.end(), '/', '\\');
+	}
+
+	std::string makePathKey(const std::string& path)
+	{
+		std::string key = path;
+		normalizePath(key);
+		std::transform(key.begin(), key.end(), key.begin(), [](char c) { return (char)tolower(c); });
+		return key;
+	}
+
+	std::string getOutputDirectory(const char* filename, const AssetLib::AssetDef& rAssetDef)
+	{
+		char assetName[256];
+		Paths::GetFilenameNoExtension(filename, assetName, ARRAY_SIZE(assetName));
+
+		std::string outDir = Paths::GetSrcDataDir();
+		outDir += "/";
+		outDir += rAssetDef.GetFolder();
+		outDir += "/";
+		outDir += assetName;
+		outDir += "/";
+
+		return outDir;
+	}
+
+	// Everything an import can write.  Must match what BatchImport::ImportFile() and the importers produce.
+	void gatherJobFiles(ImportJob& job)
+	{
+		const char* srcFilename = job.srcFilename.c_str();
+		switch (job.eType)
+		{
+		case SourceType::Obj:
+			job.outputs.push_back(makePathKey(getOutputFilename(srcFilename, AssetLib::Model::GetAssetDef())));
+			break;
+		case SourceType::Fbx:
+			// Meshes and materials are written under a directory named after the scene, followed by the scene itself.
+			job.outputs.push_back(makePathKey(getOutputFilename(srcFilename, AssetLib::Scene::GetAssetDef())));
+			job.outputs.push_back(makePathKey(getOutputDirectory(srcFilename, AssetLib::Model::GetAssetDef())));
+			job.outputs.push_back(makePathKey(getOutputDirectory(srcFilename, AssetLib::Material::GetAssetDef())));
+			break;
+		case SourceType::Texture:
+			// Heightmaps also write their terrain tiles.
+			job.outputs.push_back(makePathKey(getOutputFilename(srcFilename, AssetLib::Texture::GetAssetDef())));
+			job.outputs.push_back(makePathKey(getOutputFilename(srcFilename, AssetLib::TerrainTiles::GetAssetDef())));
+			break;
+		}
+
+		job.dependencies.push_back(makePathKey(job.srcFilename));
+	}
+
+	bool fileExists(const std::string& filename)
+	{
+		struct stat fileStats;
+		return stat(filename.c_str(), &fileStats) == 0;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Manifest
+
+	std::string hashToString(const Hashing::SHA1& hash)
+	{
+		char str[sizeof(hash.data) * 2 + 1];
+		for (uint i = 0; i < sizeof(hash.data); ++i)
+		{
+			sprintf_s(str + i * 2, 3, "%02x", hash.data[i]);
+		}
+		return str;
+	}
+
+	bool stringToHash(const char* str, Hashing::SHA1& rOutHash)
+	{
+		if (strlen(str) != sizeof(rOutHash.data) * 2)
+			return false;
+
+		for (uint i = 0; i < sizeof(rOutHash.data); ++i)
+		{
+			uint byte;
+			if (sscanf_s(str + i * 2, "%2x", &byte) != 1)
+				return false;
+			rOutHash.data[i] = (uchar)byte;
+		}
+		return true;
+	}
+
+	void loadManifest(const std::string& manifestFilename, ImportManifest& rOutManifest)
+	{
+		Json::Value jRoot;
+		if (!FileLoader::LoadJson(manifestFilename.c_str(), jRoot) || !jRoot.isObject())
+			return;
+
+		for (Json::ValueIterator iter = jRoot.begin(); iter != jRoot.end(); ++iter)
+		{
+			const Json::Value& jEntry = *iter;
+
+			ManifestEntry entry;
+			if (!stringToHash(jEntry.get("srcHash", "").asCString(), entry.srcHash))
+				continue;
+
+			entry.binVersion = jEntry.get("binVersion", 0).asUInt();
+			entry.importVersion = jEntry.get("importVersion", 0).asUInt();
+			entry.eModelFlags = (AssetLib::ModelFlags)jEntry.get("modelFlags", 0).asUInt();
+			rOutManifest[iter.key().asString()] = entry;
+		}
+	}
+
+	void saveManifest(const std::string& manifestFilename, const ImportManifest& manifest)
+	{
+		Json::Value jRoot(Json::objectValue);
+		for (const auto& iter : manifest)
+		{
+			Json::Value& jEntry = jRoot[iter.first] = Json::objectValue;
+			jEntry["srcHash"] = hashToString(iter.second.srcHash);
+			jEntry["binVersion"] = iter.second.binVersion;
+			jEntry["importVersion"] = iter.second.importVersion;
+			jEntry["modelFlags"] = (uint)iter.second.eModelFlags;
+		}
+
+		Json::StyledStreamWriter jsonWriter;
+		std::ofstream manifestFile(manifestFilename.c_str());
+		jsonWriter.write(manifestFile, jRoot);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Up-to-date checks
+
+	// Models embed the source hash in their bin header, so they can be validated without a manifest entry.
+	bool isModelBinUpToDate(const ImportJob& job)
+	{
+		std::ifstream modelFile(job.outFilename, std::ios::binary);
+		if (!modelFile.is_open())
+			return false;
+
+		AssetLib::BinFileHeader header;
+		if (!modelFile.read((char*)&header, sizeof(header)))
+			return false;
+
+		if (header.binUID != AssetLib::BinFileHeader::kUID
+			|| header.assetUID != AssetLib::Model::GetAssetDef().GetAssetUID()
+			|| header.version != (int)job.binVersion
+			|| header.srcHash != job.srcHash)
+		{
+			return false;
+		}
+
+		AssetLib::Model model;
+		if (!modelFile.read((char*)&model, sizeof(model)))
+			return false;
+
+		return model.eFlags == job.eModelFlags;
+	}
+
+	bool isJobUpToDate(const ImportJob& job, const ImportManifest& manifest)
+	{
+		auto iter = manifest.find(job.relFilename);
+		if (iter == manifest.end())
+		{
+			return job.eType == SourceType::Obj
+				&& job.importVersion == ModelImport::kImportVersion
+				&& isModelBinUpToDate(job);
+		}
+
+		const ManifestEntry& entry = iter->second;
+		if (entry.srcHash != job.srcHash || entry.binVersion != job.binVersion || entry.importVersion != job.importVersion
+			|| entry.eModelFlags != job.eModelFlags)
+		{
+			return false;
+		}
+
+		if (job.eType == SourceType::Obj)
+			return isModelBinUpToDate(job);
+
+		return fileExists(job.outFilename);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Job gathering
+
+	struct GatherContext
+	{
+		std::string srcDir;
+		std::string dataDir;
+		AssetLib::ModelFlags eModelFlags;
+		std::vector<ImportJob> jobs;
+	};
+
+	void gatherSourceFile(const char* relFilename, bool isDirectory, void* pUserData)
+	{
+		if (isDirectory)
+			return;
+
+		GatherContext* pContext = static_cast<GatherContext*>(pUserData);
+
+		SourceType eType;
+		if (!getSourceType(relFilename, &eType))
+			return;
+
+		ImportJob job;
+		job.srcFilename = pContext->srcDir + "\\" + relFilename;
+		job.relFilename = relFilename;
+		job.eType = eType;
+
+		const AssetLib::AssetDef& rOutputDef = getOutputAssetDef(eType);
+		job.outFilename = getOutputFilename(relFilename, rOutputDef);
+		job.binVersion = rOutputDef.GetBinVersion();
+		job.importVersion = (eType == SourceType::Texture) ? TextureImport::kImportVersion : ModelImport::kImportVersion;
+		job.eModelFlags = (eType == SourceType::Texture) ? AssetLib::ModelFlags::None : pContext->eModelFlags;
+		job.bSkipped = false;
+		job.bSucceeded = false;
+
+		// Ignore files that are already imported assets (e.g. dds files in the textures folder).
+		std::string outputDir = pContext->dataDir + "\\" + rOutputDef.GetFolder() + "\\";
+		std::string normalizedSrcFilename = job.srcFilename;
+		normalizePath(normalizedSrcFilename);
+		if (_strnicmp(normalizedSrcFilename.c_str(), outputDir.c_str(), outputDir.size()) == 0)
+			return;
+
+		struct stat fileStats;
+		job.srcFileSize = (stat(job.srcFilename.c_str(), &fileStats) == 0) ? (uint)fileStats.st_size : 0;
+
+		gatherJobFiles(job);
+
+		pContext->jobs.push_back(job);
+	}
+
+	// Multiple sources that map to the same output asset would overwrite each other, so keep the first and report the rest.
+	void removeConflictingJobs(std::vector<ImportJob>& jobs)
+	{
+		std::map<std::string, uint, StringInvariantCompare> outputs;
+		for (uint i = 0; i < jobs.size(); )
+		{
+			std::string outFilename = jobs[i].outFilename;
+			normalizePath(outFilename);
+
+			auto iter = outputs.find(outFilename);
+			if (iter != outputs.end())
+			{
+				Warning("Skipping %s: output %s is already produced by %s\n",
+					jobs[i].relFilename.c_str(), outFilename.c_str(), jobs[iter->second].relFilename.c_str());
+				jobs.erase(jobs.begin() + i);
+			}
+			else
+			{
+				outputs[outFilename] = i;
+				++i;
+			}
+		}
+	}
+
+	uint findGroupRoot(std::vector<uint>& rParents, uint job)
+	{
+		while (rParents[job] != job)
+		{
+			rParents[job] = rParents[rParents[job]];
+			job = rParents[job];
+		}
+		return job;
+	}
+
+	// Groups jobs whose files overlap so they never run at the same time.
+	// Two jobs overlap if either one writes a file or directory the other writes or reads.  Reading the same file is fine.
+	void groupOverlappingJobs(const std::vector<ImportJob>& jobs, std::vector<JobGroup>& rOutGroups)
+	{
+		struct FileEntry
+		{
+			const std::string* pPath;
+			uint job;
+			bool bOutput;
+		};
+
+		std::vector<FileEntry> files;
+		for (uint i = 0; i < jobs.size(); ++i)
+		{
+			for (const std::string& output : jobs[i].outputs)
+			{
+				FileEntry entry = { &output, i, true };
+				files.push_back(entry);
+			}
+			for (const std::string& dependency : jobs[i].dependencies)
+			{
+				FileEntry entry = { &dependency, i, false };
+				files.push_back(entry);
+			}
+		}
+
+		// After sorting, every path a directory covers immediately follows it.
+		std::sort(files.begin(), files.end(),
+			[](const FileEntry& lhs, const FileEntry& rhs) { return *lhs.pPath < *rhs.pPath; });
+
+		std::vector<uint> parents(jobs.size());
+		for (uint i = 0; i < jobs.size(); ++i)
+		{
+			parents[i] = i;
+		}
+
+		for (uint i = 0; i < files.size(); ++i)
+		{
+			const std::string& rPath = *files[i].pPath;
+			bool bDirectory = (rPath.back() == '\\');
+
+			for (uint k = i + 1; k < files.size(); ++k)
+			{
+				const std::string& rOtherPath = *files[k].pPath;
+				bool bCovered = bDirectory ? (rOtherPath.compare(0, rPath.size(), rPath) == 0) : (rOtherPath == rPath);
+				if (!bCovered)
+					break;
+
+				if (files[i].bOutput || files[k].bOutput)
+				{
+					parents[findGroupRoot(parents, files[i].job)] = findGroupRoot(parents, files[k].job);
+				}
+			}
+		}
+
+		std::map<uint, uint> groupIndices;
+		for (uint i = 0; i < jobs.size(); ++i)
+		{
+			uint root = findGroupRoot(parents, i);
+			auto iter = groupIndices.find(root);
+			if (iter == groupIndices.end())
+			{
+				iter = groupIndices.insert(std::make_pair(root, (uint)rOutGroups.size())).first;
+				rOutGroups.push_back(JobGroup());
+			}
+
+			rOutGroups[iter->second].push_back(i);
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Job execution
+
+	struct WorkerContext
+	{
+		std::vector<ImportJob>* pJobs;
+		const std::vector<JobGroup>* pGroups;
+		const ImportManifest* pManifest;
+		bool bForceRebuild;
+
+		std::atomic<uint> nextGroup;
+		ThreadMutex printLock;
+	};
+
+	void runJob(ImportJob& job, WorkerContext& rContext)
+	{
+		if (!Hashing::SHA1::HashFile(job.srcFilename.c_str(), job.srcHash))
+		{
+			AutoScopedLock lock(rContext.printLock);
+			Warning("Failed to read source file: %s\n", job.srcFilename.c_str());
+			return;
+		}
+
+		if (!rContext.bForceRebuild && isJobUpToDate(job, *rContext.pManifest))
+		{
+			job.bSkipped = true;
+			job.bSucceeded = true;
+			return;
+		}
+
+		{
+			AutoScopedLock lock(rContext.printLock);
+			printf("Importing %s\n", job.relFilename.c_str());
+		}
+
+		job.bSucceeded = (BatchImport::ImportFile(job.srcFilename, job.eModelFlags) == BatchImport::ImportResult::Success);
+	}
+
+	void importWorkerThread(WorkerContext* pContext)
+	{
+		std::vector<ImportJob>& jobs = *pContext->pJobs;
+		const std::vector<JobGroup>& groups = *pContext->pGroups;
+		for (uint i = pContext->nextGroup++; i < groups.size(); i = pContext->nextGroup++)
+		{
+			for (uint job : groups[i])
+			{
+				runJob(jobs[job], *pContext);
+			}
+		}
+	}
+}
+
+BatchImport::ImportResult BatchImport::ImportFile(const std::string& srcFilename, AssetLib::ModelFlags eModelFlags)
+{
+	SourceType eType;
+	if (!getSourceType(srcFilename.c_str(), &eType))
+	{
+		printf("Unknown file type: %s\n", srcFilename.c_str());
+		return ImportResult::UnknownFileType;
+	}
+
+	std::string outFilename;
+	switch (eType)
+	{
+	case SourceType::Obj:
+		outFilename = getOutputFilename(srcFilename.c_str(), AssetLib::Model::GetAssetDef());
+		Paths::CreateDirectoryTreeForFile(outFilename);
+		return ModelImport::ImportObj(srcFilename, outFilename, eModelFlags) ? ImportResult::Success : ImportResult::Failed;
+	case SourceType::Fbx:
+		outFilename = getOutputFilename(srcFilename.c_str(), AssetLib::Model::GetAssetDef());
+		Paths::CreateDirectoryTreeForFile(outFilename);
+		return ModelImport::ImportFbx(srcFilename, outFilename, eModelFlags) ? ImportResult::Success : ImportResult::Failed;
+	case SourceType::Texture:
+		outFilename = getOutputFilename(srcFilename.c_str(), AssetLib::Texture::GetAssetDef());
+		Paths::CreateDirectoryTreeForFile(outFilename);
+		return TextureImport::Import(srcFilename, outFilename) ? ImportResult::Success : ImportResult::Failed;
+	}
+
+	return ImportResult::UnknownFileType;
+}
+
+bool BatchImport::ImportAll(const char* srcDir, AssetLib::ModelFlags eModelFlags, bool bForceRebuild)
+{
+	Timer::Handle hTimer = Timer::Create();
+
+	GatherContext gatherContext;
+	gatherContext.srcDir = srcDir;
+	gatherContext.eModelFlags = eModelFlags;
+	gatherContext.dataDir = Paths::GetSrcDataDir();
+	normalizePath(gatherContext.dataDir);
+
+	std::string searchPattern = gatherContext.srcDir + "\\*";
+	Paths::ForEachFile(searchPattern.c_str(), true, gatherSourceFile, &gatherContext);
+
+	std::vector<ImportJob>& jobs = gatherContext.jobs;
+	removeConflictingJobs(jobs);
+
+	std::vector<JobGroup> groups;
+	groupOverlappingJobs(jobs, groups);
+
+	// Start the largest groups first so a big scene doesn't end up running alone at the end.
+	std::vector<uint> groupSizes(groups.size(), 0);
+	for (uint i = 0; i < groups.size(); ++i)
+	{
+		for (uint job : groups[i])
+		{
+			groupSizes[i] += jobs[job].srcFileSize;
+		}
+	}
+
+	std::vector<uint> groupOrder(groups.size());
+	for (uint i = 0; i < groups.size(); ++i)
+	{
+		groupOrder[i] = i;
+	}
+	std::stable_sort(groupOrder.begin(), groupOrder.end(),
+		[&groupSizes](uint lhs, uint rhs) { return groupSizes[lhs] > groupSizes[rhs]; });
+
+	std::vector<JobGroup> sortedGroups;
+	for (uint i : groupOrder)
+	{
+		sortedGroups.push_back(std::move(groups[i]));
+	}
+
+	std::string manifestFilename = gatherContext.srcDir + "\\" + kManifestFilename;
+	ImportManifest manifest;
+	loadManifest(manifestFilename, manifest);
+
+	WorkerContext workerContext;
+	workerContext.pJobs = &jobs;
+	workerContext.pGroups = &sortedGroups;
+	workerContext.pManifest = &manifest;
+	workerContext.bForceRebuild = bForceRebuild;
+	workerContext.nextGroup = 0;
+
+	uint numThreads = std::max(1u, std::min(std::thread::hardware_concurrency(), (uint)sortedGroups.size()));
+	std::vector<std::thread> threads;
+	for (uint i = 0; i < numThreads; ++i)
+	{
+		threads.push_back(std::thread(importWorkerThread, &workerContext));
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	// Update the manifest with everything that is now up to date.
+	uint numImported = 0;
+	uint numSkipped = 0;
+	uint numFailed = 0;
+	for (const ImportJob& job : jobs)
+	{
+		if (!job.bSucceeded)
+		{
+			++numFailed;
+			manifest.erase(job.relFilename);
+			continue;
+		}
+
+		if (job.bSkipped)
+			++numSkipped;
+		else
+			++numImported;
+
+		ManifestEntry& entry = manifest[job.relFilename];
+		entry.srcHash = job.srcHash;
+		entry.binVersion = job.binVersion;
+		entry.importVersion = job.importVersion;
+		entry.eModelFlags = job.eModelFlags;
+	}
+
+	saveManifest(manifestFilename, manifest);
+
+	printf("Batch import finished in %.2fs using %u threads: %u imported, %u up to date, %u failed\n",
+		Timer::GetElapsedSeconds(hTimer), numThreads, numImported, numSkipped, numFailed);
+	Timer::Release(hTimer);
+
+	return numFailed == 0;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+#include "AssetLib/ModelAsset.h"
+
+namespace BatchImport
+{
+	enum class ImportResult
+	{
+		Success,
+		Failed,
+		UnknownFileType,
+	};
+
+	// Import a single source file into the asset data directory.
+	// eModelFlags controls the vertex packing and stream compression of any models written.
+	ImportResult ImportFile(const std::string& srcFilename, AssetLib::ModelFlags eModelFlags);
+
+	// Import all known source files under srcDir across all cores.
+	// Imports that write overlapping outputs, or write a file another import reads, run one after another.
+	// Sources whose hash, importer version, and model flags match the last import are skipped unless bForceRebuild is set.
+	bool ImportAll(const char* srcDir, AssetLib::ModelFlags eModelFlags, bool bForceRebuild);
+}
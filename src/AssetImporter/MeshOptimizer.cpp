@@ -0,0 +1,1215 @@
+#include "MeshOptimizer.h"
+#include "MathLib/Maths.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace
+{
+	//////////////////////////////////////////////////////////////////////////
+	// Forsyth vertex cache optimization constants.
+	// See: https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+	static const uint kForsythCacheSize = 32;
+	static const float kCacheDecayPower = 1.5f;
+	static const float kLastTriScore = 0.75f;
+	static const float kValenceBoostScale = 2.0f;
+	static const float kValenceBoostPower = 0.5f;
+
+	float calcForsythVertexScore(int nCachePos, uint nRemainingTris)
+	{
+		if (nRemainingTris == 0)
+			return -1.f; // No triangles left to use this vertex.
+
+		float fScore = 0.f;
+		if (nCachePos >= 0)
+		{
+			if (nCachePos < 3)
+			{
+				// Vertex was used in the last triangle.  Fixed score so that it is not favored over other recent verts.
+				fScore = kLastTriScore;
+			}
+			else
+			{
+				const float fScaler = 1.f / (kForsythCacheSize - 3);
+				fScore = powf(1.f - (nCachePos - 3) * fScaler, kCacheDecayPower);
+			}
+		}
+
+		// Boost vertices with few remaining triangles so they get finished off instead of lingering.
+		fScore += kValenceBoostScale * powf((float)nRemainingTris, -kValenceBoostPower);
+		return fScore;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// FIFO cache simulation using per-vertex timestamps.
+	// A vertex is in the cache if fewer than nCacheSize misses have occurred since it was last loaded.
+	class FifoCacheSim
+	{
+	public:
+		FifoCacheSim(uint nVertexCount, uint nCacheSize)
+			: m_timestamps(nVertexCount, 0)
+			, m_nCacheSize(nCacheSize)
+			, m_nTimestamp(nCacheSize + 1)
+		{
+		}
+
+		// Returns the number of cache misses for the triangle.
+		uint AddTriangle(const uint* pTriIndices)
+		{
+			uint nMisses = 0;
+			for (uint k = 0; k < 3; ++k)
+			{
+				uint nVert = pTriIndices[k];
+				if (m_nTimestamp - m_timestamps[nVert] > m_nCacheSize)
+				{
+					m_timestamps[nVert] = m_nTimestamp++;
+					++nMisses;
+				}
+			}
+			return nMisses;
+		}
+
+		void Flush()
+		{
+			m_nTimestamp += m_nCacheSize + 1;
+		}
+
+	private:
+		std::vector<uint> m_timestamps;
+		uint m_nCacheSize;
+		uint m_nTimestamp;
+	};
+
+	struct TriangleCluster
+	{
+		uint nStartTri;
+		uint nTriCount;
+		float fSortKey;
+	};
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint>& indices, uint nVertexCount, uint nCacheSize)
+{
+	VertexCacheStats stats = { 0.f, 0.f };
+
+	uint nTriCount = (uint)indices.size() / 3;
+	if (nTriCount == 0)
+		return stats;
+
+	FifoCacheSim cacheSim(nVertexCount, nCacheSize);
+	uint nMisses = 0;
+	for (uint t = 0; t < nTriCount; ++t)
+	{
+		nMisses += cacheSim.AddTriangle(&indices[t * 3]);
+	}
+
+	std::vector<bool> referenced(nVertexCount, false);
+	uint nReferencedCount = 0;
+	for (uint nVert : indices)
+	{
+		if (!referenced[nVert])
+		{
+			referenced[nVert] = true;
+			++nReferencedCount;
+		}
+	}
+
+	stats.fAcmr = nMisses / (float)nTriCount;
+	stats.fAtvr = nMisses / (float)nReferencedCount;
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint>& indices, uint nVertexCount)
+{
+	uint nTriCount = (uint)indices.size() / 3;
+	if (nTriCount == 0)
+		return;
+
+	// Build vertex to triangle adjacency.
+	// Each vertex's triangle list is kept partitioned so the first nRemainingTris entries have not been emitted yet.
+	std::vector<uint> vertRemainingTris(nVertexCount, 0);
+	for (uint nVert : indices)
+	{
+		++vertRemainingTris[nVert];
+	}
+
+	std::vector<uint> vertTriOffsets(nVertexCount);
+	uint nOffset = 0;
+	for (uint v = 0; v < nVertexCount; ++v)
+	{
+		vertTriOffsets[v] = nOffset;
+		nOffset += vertRemainingTris[v];
+		vertRemainingTris[v] = 0;
+	}
+
+	std::vector<uint> vertTris(indices.size());
+	for (uint t = 0; t < nTriCount; ++t)
+	{
+		for (uint k = 0; k < 3; ++k)
+		{
+			uint nVert = indices[t * 3 + k];
+			vertTris[vertTriOffsets[nVert] + vertRemainingTris[nVert]++] = t;
+		}
+	}
+
+	// Initial scores
+	std::vector<int> vertCachePos(nVertexCount, -1);
+	std::vector<float> vertScores(nVertexCount);
+	for (uint v = 0; v < nVertexCount; ++v)
+	{
+		vertScores[v] = calcForsythVertexScore(-1, vertRemainingTris[v]);
+	}
+
+	std::vector<float> triScores(nTriCount);
+	std::vector<bool> triEmitted(nTriCount, false);
+	int nBestTri = 0;
+	for (uint t = 0; t < nTriCount; ++t)
+	{
+		triScores[t] = vertScores[indices[t * 3 + 0]] + vertScores[indices[t * 3 + 1]] + vertScores[indices[t * 3 + 2]];
+		if (triScores[t] > triScores[nBestTri])
+		{
+			nBestTri = t;
+		}
+	}
+
+	std::vector<uint> outIndices;
+	outIndices.reserve(indices.size());
+
+	uint cache[kForsythCacheSize + 3];
+	uint nCacheCount = 0;
+	uint nNextScanTri = 0;
+
+	while (nBestTri >= 0)
+	{
+		const uint* pTri = &indices[nBestTri * 3];
+		triEmitted[nBestTri] = true;
+		outIndices.push_back(pTri[0]);
+		outIndices.push_back(pTri[1]);
+		outIndices.push_back(pTri[2]);
+
+		// Remove the triangle from its vertices' remaining lists.
+		for (uint k = 0; k < 3; ++k)
+		{
+			uint nVert = pTri[k];
+			uint* pVertTris = &vertTris[vertTriOffsets[nVert]];
+			uint nLast = --vertRemainingTris[nVert];
+			for (uint i = 0; i <= nLast; ++i)
+			{
+				if (pVertTris[i] == (uint)nBestTri)
+				{
+					std::swap(pVertTris[i], pVertTris[nLast]);
+					break;
+				}
+			}
+		}
+
+		// Move the triangle's verts to the front of the LRU cache.
+		uint newCache[kForsythCacheSize + 3];
+		uint nNewCacheCount = 0;
+		for (uint k = 0; k < 3; ++k)
+		{
+			newCache[nNewCacheCount++] = pTri[k];
+		}
+		for (uint i = 0; i < nCacheCount; ++i)
+		{
+			uint nVert = cache[i];
+			if (nVert != pTri[0] && nVert != pTri[1] && nVert != pTri[2])
+			{
+				newCache[nNewCacheCount++] = nVert;
+			}
+		}
+
+		for (uint i = 0; i < nNewCacheCount; ++i)
+		{
+			uint nVert = newCache[i];
+			vertCachePos[nVert] = (i < kForsythCacheSize) ? (int)i : -1;
+			vertScores[nVert] = calcForsythVertexScore(vertCachePos[nVert], vertRemainingTris[nVert]);
+		}
+
+		// Rescore triangles touching any vertex whose score changed and pick the best.
+		nBestTri = -1;
+		float fBestScore = -FLT_MAX;
+		for (uint i = 0; i < nNewCacheCount; ++i)
+		{
+			uint nVert = newCache[i];
+			const uint* pVertTris = &vertTris[vertTriOffsets[nVert]];
+			for (uint j = 0; j < vertRemainingTris[nVert]; ++j)
+			{
+				uint t = pVertTris[j];
+				float fScore = vertScores[indices[t * 3 + 0]] + vertScores[indices[t * 3 + 1]] + vertScores[indices[t * 3 + 2]];
+				triScores[t] = fScore;
+				if (fScore > fBestScore)
+				{
+					fBestScore = fScore;
+					nBestTri = t;
+				}
+			}
+		}
+
+		nCacheCount = std::min(nNewCacheCount, kForsythCacheSize);
+		std::copy(newCache, newCache + nCacheCount, cache);
+
+		// Nothing connected to the cache, continue with the next unemitted triangle.
+		if (nBestTri < 0)
+		{
+			while (nNextScanTri < nTriCount && triEmitted[nNextScanTri])
+			{
+				++nNextScanTri;
+			}
+
+			if (nNextScanTri < nTriCount)
+			{
+				nBestTri = nNextScanTri;
+			}
+		}
+	}
+
+	indices.swap(outIndices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint>& indices, const std::vector<Vec3>& positions, float fAcmrThreshold)
+{
+	uint nTriCount = (uint)indices.size() / 3;
+	uint nVertexCount = (uint)positions.size();
+	if (nTriCount == 0)
+		return;
+
+	// Hard boundaries are triangles where every vertex misses the cache.  Reordering at these points costs nothing.
+	std::vector<uint> hardBoundaries;
+	{
+		FifoCacheSim cacheSim(nVertexCount, kAnalysisCacheSize);
+		for (uint t = 0; t < nTriCount; ++t)
+		{
+			if (cacheSim.AddTriangle(&indices[t * 3]) == 3)
+			{
+				hardBoundaries.push_back(t);
+			}
+		}
+		hardBoundaries.push_back(nTriCount);
+	}
+
+	// Soft boundaries split hard clusters further wherever the partial cluster's ACMR is already close to the whole cluster's.
+	std::vector<TriangleCluster> clusters;
+	for (uint i = 0; i + 1 < hardBoundaries.size(); ++i)
+	{
+		uint nHardStart = hardBoundaries[i];
+		uint nHardEnd = hardBoundaries[i + 1];
+
+		FifoCacheSim cacheSim(nVertexCount, kAnalysisCacheSize);
+		uint nHardMisses = 0;
+		for (uint t = nHardStart; t < nHardEnd; ++t)
+		{
+			nHardMisses += cacheSim.AddTriangle(&indices[t * 3]);
+		}
+		float fHardAcmr = nHardMisses / (float)(nHardEnd - nHardStart);
+
+		cacheSim.Flush();
+		uint nClusterStart = nHardStart;
+		uint nClusterMisses = 0;
+		for (uint t = nHardStart; t < nHardEnd; ++t)
+		{
+			nClusterMisses += cacheSim.AddTriangle(&indices[t * 3]);
+
+			uint nClusterTris = t - nClusterStart + 1;
+			if (t + 1 < nHardEnd && nClusterMisses <= fAcmrThreshold * fHardAcmr * nClusterTris)
+			{
+				clusters.push_back(TriangleCluster{ nClusterStart, nClusterTris, 0.f });
+				nClusterStart = t + 1;
+				nClusterMisses = 0;
+				cacheSim.Flush();
+			}
+		}
+		clusters.push_back(TriangleCluster{ nClusterStart, nHardEnd - nClusterStart, 0.f });
+	}
+
+	// Sort clusters by how much they face away from the mesh center.  Outer clusters occlude inner ones so they go first.
+	Vec3 vMeshCentroid = Vec3::kZero;
+	float fMeshArea = 0.f;
+	for (uint t = 0; t < nTriCount; ++t)
+	{
+		const Vec3& p0 = positions[indices[t * 3 + 0]];
+		const Vec3& p1 = positions[indices[t * 3 + 1]];
+		const Vec3& p2 = positions[indices[t * 3 + 2]];
+		float fArea = Vec3Length(Vec3Cross(p1 - p0, p2 - p0));
+		vMeshCentroid += (p0 + p1 + p2) * (fArea / 3.f);
+		fMeshArea += fArea;
+	}
+	vMeshCentroid = (fMeshArea > 0.f) ? (vMeshCentroid / fMeshArea) : positions[indices[0]];
+
+	for (TriangleCluster& cluster : clusters)
+	{
+		Vec3 vCentroid = Vec3::kZero;
+		Vec3 vNormal = Vec3::kZero;
+		float fArea = 0.f;
+		for (uint t = cluster.nStartTri; t < cluster.nStartTri + cluster.nTriCount; ++t)
+		{
+			const Vec3& p0 = positions[indices[t * 3 + 0]];
+			const Vec3& p1 = positions[indices[t * 3 + 1]];
+			const Vec3& p2 = positions[indices[t * 3 + 2]];
+			Vec3 vTriNormal = Vec3Cross(p1 - p0, p2 - p0);
+			float fTriArea = Vec3Length(vTriNormal);
+			vCentroid += (p0 + p1 + p2) * (fTriArea / 3.f);
+			vNormal += vTriNormal;
+			fArea += fTriArea;
+		}
+
+		if (fArea > 0.f)
+		{
+			vCentroid /= fArea;
+			float fNormalLen = Vec3Length(vNormal);
+			cluster.fSortKey = (fNormalLen > 0.f) ? Vec3Dot(vCentroid - vMeshCentroid, vNormal / fNormalLen) : 0.f;
+		}
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(),
+		[](const TriangleCluster& lhs, const TriangleCluster& rhs) { return lhs.fSortKey > rhs.fSortKey; });
+
+	std::vector<uint> outIndices;
+	outIndices.reserve(indices.size());
+	for (const TriangleCluster& cluster : clusters)
+	{
+		outIndices.insert(outIndices.end(),
+			indices.begin() + cluster.nStartTri * 3,
+			indices.begin() + (cluster.nStartTri + cluster.nTriCount) * 3);
+	}
+
+	indices.swap(outIndices);
+}
+
+std::vector<uint> MeshOptimizer::OptimizeVertexFetch(std::vector<uint>& indices, uint nVertexCount)
+{
+	const uint kUnassigned = ~0u;
+
+	std::vector<uint> oldToNew(nVertexCount, kUnassigned);
+	std::vector<uint> newToOld;
+	newToOld.reserve(nVertexCount);
+
+	for (uint& nIndex : indices)
+	{
+		if (oldToNew[nIndex] == kUnassigned)
+		{
+			oldToNew[nIndex] = (uint)newToOld.size();
+			newToOld.push_back(nIndex);
+		}
+		nIndex = oldToNew[nIndex];
+	}
+
+	// Keep unreferenced verts at the end so all vertex streams remain the same size.
+	for (uint v = 0; v < nVertexCount; ++v)
+	{
+		if (oldToNew[v] == kUnassigned)
+		{
+			oldToNew[v] = (uint)newToOld.size();
+			newToOld.push_back(v);
+		}
+	}
+
+	return newToOld;
+}
+
+namespace
+{
+	Vec3 calcTriangleNormal(const std::vector<uint>& indices, const std::vector<Vec3>& positions, uint nTri)
+	{
+		const Vec3& p0 = positions[indices[nTri * 3 + 0]];
+		const Vec3& p1 = positions[indices[nTri * 3 + 1]];
+		const Vec3& p2 = positions[indices[nTri * 3 + 2]];
+
+		// Front faces are clockwise in a left-handed space, which matches the direction of this cross product.
+		Vec3 vNormal = Vec3Cross(p1 - p0, p2 - p0);
+		float fLen = Vec3Length(vNormal);
+		return (fLen > 0.f) ? (vNormal / fLen) : Vec3::kZero;
+	}
+
+	void calcClusterBounds(const std::vector<uint>& indices, const std::vector<Vec3>& positions, MeshOptimizer::Cluster& rCluster)
+	{
+		uint nStartTri = rCluster.nIndexStart / 3;
+		uint nEndTri = nStartTri + rCluster.nIndexCount / 3;
+
+		// Bounding sphere around the center of the AABB.
+		Vec3 vMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		Vec3 vMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (uint i = rCluster.nIndexStart; i < rCluster.nIndexStart + rCluster.nIndexCount; ++i)
+		{
+			vMin = Vec3Min(vMin, positions[indices[i]]);
+			vMax = Vec3Max(vMax, positions[indices[i]]);
+		}
+
+		rCluster.vCenter = (vMin + vMax) * 0.5f;
+		rCluster.fRadius = 0.f;
+		for (uint i = rCluster.nIndexStart; i < rCluster.nIndexStart + rCluster.nIndexCount; ++i)
+		{
+			rCluster.fRadius = std::max(rCluster.fRadius, Vec3Length(positions[indices[i]] - rCluster.vCenter));
+		}
+
+		// Normal cone around the average triangle direction.
+		Vec3 vAxis = Vec3::kZero;
+		for (uint t = nStartTri; t < nEndTri; ++t)
+		{
+			vAxis += calcTriangleNormal(indices, positions, t);
+		}
+
+		float fAxisLen = Vec3Length(vAxis);
+		if (fAxisLen <= 0.f)
+		{
+			rCluster.vConeAxis = Vec3::kZero;
+			rCluster.fConeCutoff = 1.f;
+			return;
+		}
+		vAxis /= fAxisLen;
+
+		float fMinDot = 1.f;
+		for (uint t = nStartTri; t < nEndTri; ++t)
+		{
+			Vec3 vNormal = calcTriangleNormal(indices, positions, t);
+			if (vNormal != Vec3::kZero)
+			{
+				fMinDot = std::min(fMinDot, Vec3Dot(vNormal, vAxis));
+			}
+		}
+
+		rCluster.vConeAxis = vAxis;
+		// The cone test compares against the sine of the cone's half angle.  Wider than a hemisphere can never be culled.
+		rCluster.fConeCutoff = (fMinDot <= 0.f) ? 1.f : sqrtf(1.f - fMinDot * fMinDot);
+	}
+}
+
+std::vector<MeshOptimizer::Cluster> MeshOptimizer::BuildClusters(const std::vector<uint>& indices, const std::vector<Vec3>& positions)
+{
+	const uint kNoCluster = ~0u;
+
+	std::vector<Cluster> clusters;
+	std::vector<uint> vertCluster(positions.size(), kNoCluster);
+
+	uint nTriCount = (uint)indices.size() / 3;
+	uint nClusterStartTri = 0;
+	uint nClusterVerts = 0;
+	Vec3 vClusterNormal = Vec3::kZero;
+
+	for (uint t = 0; t <= nTriCount; ++t)
+	{
+		bool bSplit = (t == nTriCount);
+		Vec3 vNormal;
+		if (!bSplit)
+		{
+			uint nNewVerts = 0;
+			for (uint k = 0; k < 3; ++k)
+			{
+				if (vertCluster[indices[t * 3 + k]] != clusters.size())
+					++nNewVerts;
+			}
+
+			// Also split before the cluster's normals span more than a hemisphere, at which point it could never be back-face culled.
+			vNormal = calcTriangleNormal(indices, positions, t);
+			bSplit = (nClusterVerts + nNewVerts > kMaxClusterVertices)
+				|| (t - nClusterStartTri >= kMaxClusterTriangles)
+				|| (Vec3Dot(vClusterNormal, vNormal) < 0.f);
+		}
+
+		if (bSplit && t > nClusterStartTri)
+		{
+			Cluster cluster;
+			cluster.nIndexStart = nClusterStartTri * 3;
+			cluster.nIndexCount = (t - nClusterStartTri) * 3;
+			calcClusterBounds(indices, positions, cluster);
+			clusters.push_back(cluster);
+
+			nClusterStartTri = t;
+			nClusterVerts = 0;
+			vClusterNormal = Vec3::kZero;
+		}
+
+		if (t == nTriCount)
+			break;
+
+		for (uint k = 0; k < 3; ++k)
+		{
+			uint& rVertCluster = vertCluster[indices[t * 3 + k]];
+			if (rVertCluster != clusters.size())
+			{
+				rVertCluster = (uint)clusters.size();
+				++nClusterVerts;
+			}
+		}
+		vClusterNormal += vNormal;
+	}
+
+	return clusters;
+}
+
+namespace
+{
+	//////////////////////////////////////////////////////////////////////////
+	// Quadric error metric simplification (Garland & Heckbert, "Surface Simplification Using Quadric Error Metrics").
+	// Vertices are only collapsed onto existing neighbors so simplified index buffers can share the original vertex buffer.
+	static const double kBorderQuadricWeight = 10.0;
+	static const uint kInvalidIndex = ~0u;
+
+	struct Quadric
+	{
+		// Q(v) = v'Av + 2b.v + c, accumulated with area weights.
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double w;
+
+		void AddPlane(const Vec3& n, float d, double weight)
+		{
+			a00 += weight * n.x * n.x;
+			a01 += weight * n.x * n.y;
+			a02 += weight * n.x * n.z;
+			a11 += weight * n.y * n.y;
+			a12 += weight * n.y * n.z;
+			a22 += weight * n.z * n.z;
+			b0 += weight * n.x * d;
+			b1 += weight * n.y * d;
+			b2 += weight * n.z * d;
+			c += weight * d * d;
+			w += weight;
+		}
+
+		void Add(const Quadric& other)
+		{
+			a00 += other.a00; a01 += other.a01; a02 += other.a02;
+			a11 += other.a11; a12 += other.a12; a22 += other.a22;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			w += other.w;
+		}
+
+		// Area weighted mean squared distance from v to the accumulated planes.
+		float Evaluate(const Vec3& v) const
+		{
+			double x = v.x, y = v.y, z = v.z;
+			double err = x * x * a00 + y * y * a11 + z * z * a22
+				+ 2.0 * (x * y * a01 + x * z * a02 + y * z * a12)
+				+ 2.0 * (x * b0 + y * b1 + z * b2)
+				+ c;
+			return (w > 0.0) ? (float)std::max(0.0, err / w) : 0.f;
+		}
+	};
+
+	struct Collapse
+	{
+		uint nFrom; // Welded vertex being removed
+		uint nTo;	// Welded vertex it merges into
+		float fError;
+	};
+
+	// Assigns each vertex the lowest index vertex sharing its exact position.
+	// Vertices split by attribute seams ("wedges") share a welded index.
+	std::vector<uint> buildWeldRemap(const std::vector<Vec3>& positions)
+	{
+		uint nVertexCount = (uint)positions.size();
+		std::vector<uint> sorted(nVertexCount);
+		for (uint i = 0; i < nVertexCount; ++i)
+		{
+			sorted[i] = i;
+		}
+
+		auto lessPosition = [&positions](uint lhs, uint rhs)
+		{
+			const Vec3& a = positions[lhs];
+			const Vec3& b = positions[rhs];
+			if (a.x != b.x) return a.x < b.x;
+			if (a.y != b.y) return a.y < b.y;
+			if (a.z != b.z) return a.z < b.z;
+			return lhs < rhs;
+		};
+		std::sort(sorted.begin(), sorted.end(), lessPosition);
+
+		std::vector<uint> remap(nVertexCount);
+		for (uint i = 0; i < nVertexCount; ++i)
+		{
+			uint nVert = sorted[i];
+			bool bSameAsPrev = (i > 0) && (positions[sorted[i - 1]].x == positions[nVert].x)
+				&& (positions[sorted[i - 1]].y == positions[nVert].y)
+				&& (positions[sorted[i - 1]].z == positions[nVert].z);
+			remap[nVert] = bSameAsPrev ? remap[sorted[i - 1]] : nVert;
+		}
+
+		return remap;
+	}
+
+	uint64 makeEdgeKey(uint a, uint b)
+	{
+		return ((uint64)a << 32) | b;
+	}
+
+	class QuadricSimplifier
+	{
+	public:
+		QuadricSimplifier(const std::vector<uint>& indices, const std::vector<Vec3>& positions)
+			: m_indices(indices)
+			, m_positions(positions)
+			, m_weld(buildWeldRemap(positions))
+			, m_quadrics(positions.size(), Quadric())
+			, m_fMaxError(0.f)
+		{
+			buildAdjacency();
+			buildQuadrics();
+		}
+
+		// Runs passes of independent collapses until the index target is met or no collapse is within the error limit.
+		void Simplify(uint nTargetIndexCount, float fTargetError)
+		{
+			float fMaxQuadricError = fTargetError * fTargetError;
+			while (m_indices.size() > nTargetIndexCount)
+			{
+				std::vector<Collapse> collapses;
+				gatherCollapses(collapses, fMaxQuadricError);
+				if (collapses.empty())
+					break;
+
+				std::sort(collapses.begin(), collapses.end(),
+					[](const Collapse& lhs, const Collapse& rhs) { return lhs.fError < rhs.fError; });
+
+				uint nTrisToRemove = (uint)(m_indices.size() - nTargetIndexCount) / 3;
+				uint nRemoved = applyCollapses(collapses, nTrisToRemove);
+
+				compactTriangles();
+				buildAdjacency();
+
+				if (nRemoved == 0)
+					break;
+			}
+		}
+
+		const std::vector<uint>& GetIndices() const { return m_indices; }
+		float GetError() const { return sqrtf(m_fMaxError); }
+
+	private:
+		void buildAdjacency()
+		{
+			uint nVertexCount = (uint)m_positions.size();
+			uint nTriCount = (uint)m_indices.size() / 3;
+
+			// Triangles per welded vertex
+			m_adjOffsets.assign(nVertexCount + 1, 0);
+			for (uint nIndex : m_indices)
+			{
+				++m_adjOffsets[m_weld[nIndex] + 1];
+			}
+			for (uint v = 0; v < nVertexCount; ++v)
+			{
+				m_adjOffsets[v + 1] += m_adjOffsets[v];
+			}
+
+			m_adjTris.resize(m_indices.size());
+			std::vector<uint> fill(m_adjOffsets.begin(), m_adjOffsets.end() - 1);
+			for (uint t = 0; t < nTriCount; ++t)
+			{
+				for (uint k = 0; k < 3; ++k)
+				{
+					m_adjTris[fill[m_weld[m_indices[t * 3 + k]]]++] = t;
+				}
+			}
+
+			// Directed welded edges.  An edge without its reverse is on an open border.
+			m_edges.clear();
+			for (uint t = 0; t < nTriCount; ++t)
+			{
+				for (uint k = 0; k < 3; ++k)
+				{
+					uint a = m_weld[m_indices[t * 3 + k]];
+					uint b = m_weld[m_indices[t * 3 + (k + 1) % 3]];
+					m_edges.insert(makeEdgeKey(a, b));
+				}
+			}
+
+			m_border.assign(nVertexCount, false);
+			for (uint64 nKey : m_edges)
+			{
+				uint a = (uint)(nKey >> 32);
+				uint b = (uint)(nKey & 0xffffffff);
+				if (!isEdgeShared(a, b))
+				{
+					m_border[a] = true;
+					m_border[b] = true;
+				}
+			}
+
+			m_triAlive.assign(nTriCount, true);
+		}
+
+		void buildQuadrics()
+		{
+			uint nTriCount = (uint)m_indices.size() / 3;
+			for (uint t = 0; t < nTriCount; ++t)
+			{
+				uint w[3] = { m_weld[m_indices[t * 3 + 0]], m_weld[m_indices[t * 3 + 1]], m_weld[m_indices[t * 3 + 2]] };
+				const Vec3& p0 = m_positions[w[0]];
+				const Vec3& p1 = m_positions[w[1]];
+				const Vec3& p2 = m_positions[w[2]];
+
+				Vec3 vCross = Vec3Cross(p1 - p0, p2 - p0);
+				float fLen = Vec3Length(vCross);
+				if (fLen <= 0.f)
+					continue;
+
+				Vec3 vNormal = vCross / fLen;
+				float fArea = fLen * 0.5f;
+				float d = -Vec3Dot(vNormal, p0);
+				for (uint k = 0; k < 3; ++k)
+				{
+					m_quadrics[w[k]].AddPlane(vNormal, d, fArea);
+				}
+
+				// Constrain open borders with planes perpendicular to the triangle through the border edge.
+				for (uint k = 0; k < 3; ++k)
+				{
+					uint a = w[k];
+					uint b = w[(k + 1) % 3];
+					if (isEdgeShared(a, b))
+						continue;
+
+					Vec3 vEdge = m_positions[b] - m_positions[a];
+					float fEdgeLen = Vec3Length(vEdge);
+					if (fEdgeLen <= 0.f)
+						continue;
+
+					Vec3 vEdgeNormal = Vec3Normalize(Vec3Cross(vEdge, vNormal));
+					float fEdgeD = -Vec3Dot(vEdgeNormal, m_positions[a]);
+					double weight = kBorderQuadricWeight * fEdgeLen * fEdgeLen;
+					m_quadrics[a].AddPlane(vEdgeNormal, fEdgeD, weight);
+					m_quadrics[b].AddPlane(vEdgeNormal, fEdgeD, weight);
+				}
+			}
+		}
+
+		bool isEdgeShared(uint a, uint b) const
+		{
+			return m_edges.find(makeEdgeKey(b, a)) != m_edges.end();
+		}
+
+		float calcCollapseError(uint nFrom, uint nTo) const
+		{
+			Quadric q = m_quadrics[nFrom];
+			q.Add(m_quadrics[nTo]);
+			return q.Evaluate(m_positions[nTo]);
+		}
+
+		void gatherCollapses(std::vector<Collapse>& rCollapses, float fMaxQuadricError) const
+		{
+			for (uint64 nKey : m_edges)
+			{
+				uint a = (uint)(nKey >> 32);
+				uint b = (uint)(nKey & 0xffffffff);
+
+				// Visit shared edges once.
+				bool bShared = isEdgeShared(a, b);
+				if (bShared && a > b)
+					continue;
+
+				// Border vertices may only slide along their border.
+				Collapse best = { kInvalidIndex, kInvalidIndex, FLT_MAX };
+				if (!m_border[a] || !bShared)
+				{
+					float fError = calcCollapseError(a, b);
+					if (fError < best.fError)
+						best = Collapse{ a, b, fError };
+				}
+				if (!m_border[b] || !bShared)
+				{
+					float fError = calcCollapseError(b, a);
+					if (fError < best.fError)
+						best = Collapse{ b, a, fError };
+				}
+
+				if (best.nFrom != kInvalidIndex && best.fError <= fMaxQuadricError)
+				{
+					rCollapses.push_back(best);
+				}
+			}
+		}
+
+		// Finds the vertex each wedge of the removed vertex is replaced with.
+		// Every wedge must share a triangle with the target so that attribute seams are only collapsed along themselves.
+		bool buildWedgeRemap(uint nFrom, uint nTo, std::vector<std::pair<uint, uint>>& rRemap) const
+		{
+			rRemap.clear();
+			for (uint i = m_adjOffsets[nFrom]; i < m_adjOffsets[nFrom + 1]; ++i)
+			{
+				uint t = m_adjTris[i];
+				uint nFromVert = kInvalidIndex;
+				uint nToVert = kInvalidIndex;
+				for (uint k = 0; k < 3; ++k)
+				{
+					uint nVert = m_indices[t * 3 + k];
+					if (m_weld[nVert] == nFrom)
+						nFromVert = nVert;
+					else if (m_weld[nVert] == nTo)
+						nToVert = nVert;
+				}
+
+				auto iter = std::find_if(rRemap.begin(), rRemap.end(),
+					[nFromVert](const std::pair<uint, uint>& entry) { return entry.first == nFromVert; });
+				if (iter == rRemap.end())
+				{
+					rRemap.push_back(std::make_pair(nFromVert, nToVert));
+				}
+				else if (iter->second == kInvalidIndex)
+				{
+					iter->second = nToVert;
+				}
+				else if (nToVert != kInvalidIndex && iter->second != nToVert)
+				{
+					return false;
+				}
+			}
+
+			for (const auto& entry : rRemap)
+			{
+				if (entry.second == kInvalidIndex)
+					return false;
+			}
+			return true;
+		}
+
+		// Rejects collapses that would flip any remaining triangle around the removed vertex.
+		bool causesFlip(uint nFrom, uint nTo) const
+		{
+			const Vec3& vNewPos = m_positions[nTo];
+			for (uint i = m_adjOffsets[nFrom]; i < m_adjOffsets[nFrom + 1]; ++i)
+			{
+				uint t = m_adjTris[i];
+				uint w[3] = { m_weld[m_indices[t * 3 + 0]], m_weld[m_indices[t * 3 + 1]], m_weld[m_indices[t * 3 + 2]] };
+				if (w[0] == nTo || w[1] == nTo || w[2] == nTo)
+					continue; // Collapses to a degenerate triangle.
+
+				uint k = (w[0] == nFrom) ? 0 : ((w[1] == nFrom) ? 1 : 2);
+				const Vec3& p1 = m_positions[w[(k + 1) % 3]];
+				const Vec3& p2 = m_positions[w[(k + 2) % 3]];
+				const Vec3& p0 = m_positions[nFrom];
+
+				Vec3 vOldNormal = Vec3Cross(p1 - p0, p2 - p0);
+				Vec3 vNewNormal = Vec3Cross(p1 - vNewPos, p2 - vNewPos);
+				if (Vec3Dot(vOldNormal, vNewNormal) <= 0.f)
+					return true;
+			}
+			return false;
+		}
+
+		uint applyCollapses(const std::vector<Collapse>& collapses, uint nMaxTrisToRemove)
+		{
+			std::vector<bool> locked(m_positions.size(), false);
+			std::vector<std::pair<uint, uint>> wedgeRemap;
+			uint nTrisRemoved = 0;
+
+			for (const Collapse& collapse : collapses)
+			{
+				if (nTrisRemoved >= nMaxTrisToRemove)
+					break;
+
+				if (locked[collapse.nFrom] || locked[collapse.nTo])
+					continue;
+
+				if (!buildWedgeRemap(collapse.nFrom, collapse.nTo, wedgeRemap) || causesFlip(collapse.nFrom, collapse.nTo))
+					continue;
+
+				// Lock the one-ring so no other collapse in this pass touches the same triangles.
+				for (uint i = m_adjOffsets[collapse.nFrom]; i < m_adjOffsets[collapse.nFrom + 1]; ++i)
+				{
+					uint t = m_adjTris[i];
+					for (uint k = 0; k < 3; ++k)
+					{
+						locked[m_weld[m_indices[t * 3 + k]]] = true;
+					}
+				}
+
+				for (uint i = m_adjOffsets[collapse.nFrom]; i < m_adjOffsets[collapse.nFrom + 1]; ++i)
+				{
+					uint t = m_adjTris[i];
+					for (uint k = 0; k < 3; ++k)
+					{
+						uint& rIndex = m_indices[t * 3 + k];
+						for (const auto& entry : wedgeRemap)
+						{
+							if (rIndex == entry.first)
+							{
+								rIndex = entry.second;
+								break;
+							}
+						}
+					}
+
+					uint w0 = m_weld[m_indices[t * 3 + 0]];
+					uint w1 = m_weld[m_indices[t * 3 + 1]];
+					uint w2 = m_weld[m_indices[t * 3 + 2]];
+					if (m_triAlive[t] && (w0 == w1 || w1 == w2 || w0 == w2))
+					{
+						m_triAlive[t] = false;
+						++nTrisRemoved;
+					}
+				}
+
+				m_quadrics[collapse.nTo].Add(m_quadrics[collapse.nFrom]);
+				m_fMaxError = std::max(m_fMaxError, collapse.fError);
+			}
+
+			return nTrisRemoved;
+		}
+
+		void compactTriangles()
+		{
+			uint nDst = 0;
+			uint nTriCount = (uint)m_indices.size() / 3;
+			for (uint t = 0; t < nTriCount; ++t)
+			{
+				if (!m_triAlive[t])
+					continue;
+
+				for (uint k = 0; k < 3; ++k)
+				{
+					m_indices[nDst * 3 + k] = m_indices[t * 3 + k];
+				}
+				++nDst;
+			}
+			m_indices.resize(nDst * 3);
+		}
+
+	private:
+		std::vector<uint> m_indices;
+		const std::vector<Vec3>& m_positions;
+		std::vector<uint> m_weld;
+		std::vector<Quadric> m_quadrics;
+
+		std::vector<uint> m_adjOffsets;
+		std::vector<uint> m_adjTris;
+		std::unordered_set<uint64> m_edges;
+		std::vector<bool> m_border;
+		std::vector<bool> m_triAlive;
+
+		float m_fMaxError;
+	};
+}
+
+std::vector<uint> MeshOptimizer::Simplify(const std::vector<uint>& indices, const std::vector<Vec3>& positions, uint nTargetIndexCount, float fTargetError, float* pOutError)
+{
+	QuadricSimplifier simplifier(indices, positions);
+	simplifier.Simplify(nTargetIndexCount, fTargetError);
+
+	if (pOutError)
+	{
+		*pOutError = simplifier.GetError();
+	}
+	return simplifier.GetIndices();
+}
+
+namespace
+{
+	//////////////////////////////////////////////////////////////////////////
+	// Surface deviation measurement
+
+	// Closest point on a triangle (Ericson, "Real-Time Collision Detection" 5.1.5).
+	Vec3 closestPointOnTriangle(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c)
+	{
+		Vec3 ab = b - a;
+		Vec3 ac = c - a;
+		Vec3 ap = p - a;
+		float d1 = Vec3Dot(ab, ap);
+		float d2 = Vec3Dot(ac, ap);
+		if (d1 <= 0.f && d2 <= 0.f)
+			return a;
+
+		Vec3 bp = p - b;
+		float d3 = Vec3Dot(ab, bp);
+		float d4 = Vec3Dot(ac, bp);
+		if (d3 >= 0.f && d4 <= d3)
+			return b;
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f)
+			return a + ab * (d1 / (d1 - d3));
+
+		Vec3 cp = p - c;
+		float d5 = Vec3Dot(ab, cp);
+		float d6 = Vec3Dot(ac, cp);
+		if (d6 >= 0.f && d5 <= d6)
+			return c;
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f)
+			return a + ac * (d2 / (d2 - d6));
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f)
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+		float fDenom = 1.f / (va + vb + vc);
+		return a + ab * (vb * fDenom) + ac * (vc * fDenom);
+	}
+
+	// Uniform grid of triangles for closest point queries.  Each triangle is added to every cell its bounds overlap.
+	class TriangleGrid
+	{
+	public:
+		TriangleGrid(const std::vector<uint>& indices, const std::vector<Vec3>& positions)
+			: m_indices(indices)
+			, m_positions(positions)
+		{
+			m_vMin = Vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+			Vec3 vMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			for (const Vec3& vPos : positions)
+			{
+				m_vMin = Vec3Min(m_vMin, vPos);
+				vMax = Vec3Max(vMax, vPos);
+			}
+
+			// Roughly a couple of triangles per cell for surfaces spread over two axes.
+			uint nTriCount = (uint)indices.size() / 3;
+			Vec3 vSize = Vec3Max(vMax - m_vMin, Vec3(1e-6f, 1e-6f, 1e-6f));
+			m_fCellSize = std::max(Vec3MaxComponent(vSize) / std::max(sqrtf(nTriCount * 0.5f), 1.f), Vec3MaxComponent(vSize) / kMaxCellsPerAxis);
+			for (uint i = 0; i < 3; ++i)
+			{
+				m_nCells[i] = std::min((uint)((&vSize.x)[i] / m_fCellSize) + 1, kMaxCellsPerAxis);
+			}
+
+			// Counting sort of triangle references into cells.
+			m_cellOffsets.assign(m_nCells[0] * m_nCells[1] * m_nCells[2] + 1, 0);
+			for (int nPass = 0; nPass < 2; ++nPass)
+			{
+				for (uint t = 0; t < nTriCount; ++t)
+				{
+					uint nMin[3], nMax[3];
+					calcTriangleCellRange(t, nMin, nMax);
+					for (uint z = nMin[2]; z <= nMax[2]; ++z)
+					{
+						for (uint y = nMin[1]; y <= nMax[1]; ++y)
+						{
+							for (uint x = nMin[0]; x <= nMax[0]; ++x)
+							{
+								uint nCell = getCellIndex(x, y, z);
+								if (nPass == 0)
+									++m_cellOffsets[nCell + 1];
+								else
+									m_cellTris[m_cellFill[nCell]++] = t;
+							}
+						}
+					}
+				}
+
+				if (nPass == 0)
+				{
+					for (uint i = 1; i < m_cellOffsets.size(); ++i)
+					{
+						m_cellOffsets[i] += m_cellOffsets[i - 1];
+					}
+					m_cellTris.resize(m_cellOffsets.back());
+					m_cellFill.assign(m_cellOffsets.begin(), m_cellOffsets.end() - 1);
+				}
+			}
+		}
+
+		// Searches rings of cells outward from the point until no unsearched cell can contain a closer triangle.
+		float CalcDistance(const Vec3& p) const
+		{
+			int nCenter[3];
+			for (uint i = 0; i < 3; ++i)
+			{
+				int nCell = (int)(((&p.x)[i] - (&m_vMin.x)[i]) / m_fCellSize);
+				nCenter[i] = std::max(0, std::min(nCell, (int)m_nCells[i] - 1));
+			}
+
+			int nMaxRing = (int)std::max(m_nCells[0], std::max(m_nCells[1], m_nCells[2]));
+			float fBestDistSqr = FLT_MAX;
+			for (int nRing = 0; nRing <= nMaxRing; ++nRing)
+			{
+				for (int z = nCenter[2] - nRing; z <= nCenter[2] + nRing; ++z)
+				{
+					for (int y = nCenter[1] - nRing; y <= nCenter[1] + nRing; ++y)
+					{
+						for (int x = nCenter[0] - nRing; x <= nCenter[0] + nRing; ++x)
+						{
+							// Only the shell of the ring, inner cells were searched by previous rings.
+							bool bShell = (abs(x - nCenter[0]) == nRing) || (abs(y - nCenter[1]) == nRing) || (abs(z - nCenter[2]) == nRing);
+							if (!bShell || x < 0 || y < 0 || z < 0 || x >= (int)m_nCells[0] || y >= (int)m_nCells[1] || z >= (int)m_nCells[2])
+								continue;
+
+							uint nCell = getCellIndex(x, y, z);
+							for (uint i = m_cellOffsets[nCell]; i < m_cellOffsets[nCell + 1]; ++i)
+							{
+								uint t = m_cellTris[i];
+								Vec3 q = closestPointOnTriangle(p, m_positions[m_indices[t * 3 + 0]], m_positions[m_indices[t * 3 + 1]], m_positions[m_indices[t * 3 + 2]]);
+								fBestDistSqr = std::min(fBestDistSqr, Vec3LengthSqr(p - q));
+							}
+						}
+					}
+				}
+
+				// Cells beyond this ring are at least nRing cells away.
+				float fSearchedDist = nRing * m_fCellSize;
+				if (fBestDistSqr <= fSearchedDist * fSearchedDist)
+					break;
+			}
+
+			return sqrtf(fBestDistSqr);
+		}
+
+	private:
+		static const uint kMaxCellsPerAxis = 128;
+
+		uint getCellIndex(uint x, uint y, uint z) const
+		{
+			return (z * m_nCells[1] + y) * m_nCells[0] + x;
+		}
+
+		void calcTriangleCellRange(uint t, uint nMin[3], uint nMax[3]) const
+		{
+			const Vec3& p0 = m_positions[m_indices[t * 3 + 0]];
+			const Vec3& p1 = m_positions[m_indices[t * 3 + 1]];
+			const Vec3& p2 = m_positions[m_indices[t * 3 + 2]];
+			Vec3 vTriMin = Vec3Min(p0, Vec3Min(p1, p2)) - m_vMin;
+			Vec3 vTriMax = Vec3Max(p0, Vec3Max(p1, p2)) - m_vMin;
+			for (uint i = 0; i < 3; ++i)
+			{
+				nMin[i] = std::min((uint)std::max((&vTriMin.x)[i] / m_fCellSize, 0.f), m_nCells[i] - 1);
+				nMax[i] = std::min((uint)std::max((&vTriMax.x)[i] / m_fCellSize, 0.f), m_nCells[i] - 1);
+			}
+		}
+
+	private:
+		const std::vector<uint>& m_indices;
+		const std::vector<Vec3>& m_positions;
+
+		Vec3 m_vMin;
+		float m_fCellSize;
+		uint m_nCells[3];
+
+		std::vector<uint> m_cellOffsets;
+		std::vector<uint> m_cellTris;
+		std::vector<uint> m_cellFill;
+	};
+
+	// Largest distance from the sample points of each source triangle to the target surface.
+	float measureOneSidedDeviation(const std::vector<uint>& srcIndices, const TriangleGrid& rTargetGrid, const std::vector<Vec3>& positions)
+	{
+		float fMaxDist = 0.f;
+		for (uint i = 0; i < srcIndices.size(); i += 3)
+		{
+			const Vec3& p0 = positions[srcIndices[i + 0]];
+			const Vec3& p1 = positions[srcIndices[i + 1]];
+			const Vec3& p2 = positions[srcIndices[i + 2]];
+
+			const Vec3 samples[] = {
+				p0, p1, p2,
+				(p0 + p1) * 0.5f, (p1 + p2) * 0.5f, (p2 + p0) * 0.5f,
+				(p0 + p1 + p2) / 3.f
+			};
+			for (const Vec3& vSample : samples)
+			{
+				fMaxDist = std::max(fMaxDist, rTargetGrid.CalcDistance(vSample));
+			}
+		}
+		return fMaxDist;
+	}
+}
+
+float MeshOptimizer::MeasureDeviation(const std::vector<uint>& indicesA, const std::vector<uint>& indicesB, const std::vector<Vec3>& positions)
+{
+	if (indicesA.empty() || indicesB.empty())
+		return (indicesA.size() == indicesB.size()) ? 0.f : FLT_MAX;
+
+	TriangleGrid gridA(indicesA, positions);
+	TriangleGrid gridB(indicesB, positions);
+	return std::max(measureOneSidedDeviation(indicesA, gridB, positions), measureOneSidedDeviation(indicesB, gridA, positions));
+}
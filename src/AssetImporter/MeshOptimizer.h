@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include "../Types.h"
+#include "MathLib/Vec3.h"
+
+// Triangle and vertex ordering optimizations applied to model index buffers at import time.
+namespace MeshOptimizer
+{
+	// Post-transform cache size used to evaluate orderings.  Matches a typical FIFO vertex cache.
+	static const uint kAnalysisCacheSize = 16;
+
+	struct VertexCacheStats
+	{
+		float fAcmr; // Average cache miss ratio: transformed vertices per triangle.  Ideal is 0.5, worst is 3.
+		float fAtvr; // Average transform to vertex ratio: transformed vertices per referenced vertex.  Ideal is 1.
+	};
+
+	// Simulates a FIFO post-transform vertex cache over the index buffer.
+	VertexCacheStats AnalyzeVertexCache(const std::vector<uint>& indices, uint nVertexCount, uint nCacheSize = kAnalysisCacheSize);
+
+	// Reorders triangles for post-transform cache reuse using Tom Forsyth's linear-speed algorithm.
+	void OptimizeVertexCache(std::vector<uint>& indices, uint nVertexCount);
+
+	// Reorders clusters of cache-optimized triangles so that outward-facing clusters are drawn first (Tipsify, Sander et al).
+	// Clusters are split wherever their ACMR stays within fAcmrThreshold of the input ordering, so cache efficiency is largely preserved.
+	void OptimizeOverdraw(std::vector<uint>& indices, const std::vector<Vec3>& positions, float fAcmrThreshold);
+
+	// Renumbers vertices in the order they are first referenced so vertex fetches are sequential.
+	// Returns the new-to-old vertex mapping that must be applied to every vertex stream.
+	std::vector<uint> OptimizeVertexFetch(std::vector<uint>& indices, uint nVertexCount);
+
+	// Limits of a cluster built by BuildClusters().
+	static const uint kMaxClusterVertices = 64;
+	static const uint kMaxClusterTriangles = 128;
+
+	// Contiguous range of triangles with bounds for CPU culling.
+	struct Cluster
+	{
+		uint nIndexStart;
+		uint nIndexCount;
+
+		Vec3 vCenter;
+		float fRadius;
+
+		// Normal cone.  The whole cluster faces away from a viewer at p when
+		// dot(vCenter - p, vConeAxis) >= fConeCutoff * length(vCenter - p) + fRadius.
+		// A cutoff of 1 means the triangles span too wide a range of directions to ever be back-face culled.
+		Vec3 vConeAxis;
+		float fConeCutoff;
+	};
+
+	// Splits the index buffer into clusters of consecutive triangles without reordering it.
+	// Works best on vertex cache optimized orderings where consecutive triangles are spatially coherent.
+	std::vector<Cluster> BuildClusters(const std::vector<uint>& indices, const std::vector<Vec3>& positions);
+
+	// Reduces the triangle count with quadric error metric edge collapses until nTargetIndexCount is reached
+	// or no collapse stays within fTargetError.  Returns indices into the original vertices.
+	// Attribute seams and open borders are preserved.  pOutError receives the largest quadric error of the applied collapses,
+	// the RMS distance from a collapsed vertex to the planes it accumulated.  It's an estimate for ordering collapses
+	// and can be several times smaller than the actual deviation, so use MeasureDeviation() where a maximum is needed.
+	std::vector<uint> Simplify(const std::vector<uint>& indices, const std::vector<Vec3>& positions, uint nTargetIndexCount, float fTargetError, float* pOutError);
+
+	// Largest distance between two triangle lists sharing the same vertices (symmetric Hausdorff distance).
+	// Measured at the vertices, edge midpoints and centers of every triangle of each surface against the other.
+	float MeasureDeviation(const std::vector<uint>& indicesA, const std::vector<uint>& indicesB, const std::vector<Vec3>& positions);
+}
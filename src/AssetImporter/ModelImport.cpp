@@ -1,6 +1,10 @@
 #include "ModelImport.h"
+#include "MeshOptimizer.h"
+#include "VertexPacking.h"
 #include "MathLib/Maths.h"
 #include "AssetLib/ModelAsset.h"
+#include "AssetLib/StreamCodec.h"
+#include "AssetLib/ModelBvh.h"
 #include "AssetLib/SceneAsset.h"
 #include "AssetLib/MaterialAsset.h"
 #include "UtilsLib/Color.h"
@@ -61,6 +65,12 @@ namespace
 		std::string materialName;
 	};
 
+	struct ExportLod
+	{
+		std::vector<uint> indices;
+		float fError;
+	};
+
 	struct ExportSubMesh
 	{
 		Vec3 m_vBoundsMin;
@@ -74,6 +84,8 @@ namespace
 		std::vector<Vec3> m_bitangents;
 
 		std::vector<uint> m_indices;
+		std::vector<ExportLod> m_lods;
+		std::vector<MeshOptimizer::Cluster> m_clusters;
 		std::string m_materialName;
 
 		//////////////////////////////////////////////////////////////////////////
@@ -97,28 +109,28 @@ namespace
 			return (uint)m_positions.size();
 		}
 
-		uint GetVertexStride() const
+		uint GetVertexStride(bool bPacked) const
 		{
 			uint nBytes = 0;
 			if (!m_positions.empty()) 
-				nBytes += sizeof(Vec3);
+				nBytes += bPacked ? sizeof(uint16) * 4 : sizeof(Vec3);
 			if (!m_normals.empty()) 
-				nBytes += sizeof(Vec3);
+				nBytes += bPacked ? sizeof(int16) * 2 : sizeof(Vec3);
 			for (uint nChannel = 0; nChannel < kMaxNumTexCoords; ++nChannel)
 			{
 				if (!m_texcoords[nChannel].empty())
-					nBytes += sizeof(Vec2);
+					nBytes += bPacked ? sizeof(float16) * 2 : sizeof(Vec2);
 			}
 			if (!m_colors.empty())
 				nBytes += sizeof(Color32);
 			if (!m_tangents.empty())
-				nBytes += sizeof(Vec3);
-			if (!m_bitangents.empty())
+				nBytes += bPacked ? sizeof(int16) * 2 : sizeof(Vec3);
+			if (!m_bitangents.empty() && !bPacked)
 				nBytes += sizeof(Vec3);
 			return nBytes;
 		}
 
-		uint GetNumVertexInputElements() const
+		uint GetNumVertexInputElements(bool bPacked) const
 		{
 			uint nCount = 0;
 			if (!m_positions.empty())
@@ -134,31 +146,35 @@ namespace
 				++nCount;
 			if (!m_tangents.empty())
 				++nCount;
-			if (!m_bitangents.empty())
+			if (!m_bitangents.empty() && !bPacked)
 				++nCount;
 			return nCount;
 		}
 
-		std::vector<RdrVertexInputElement> GetVertexInputElements() const
+		// Packed vertices drop the bitangent.  The shader rebuilds it from the normal, tangent, and the sign stored in position.w.
+		std::vector<RdrVertexInputElement> GetVertexInputElements(bool bPacked) const
 		{
 			std::vector<RdrVertexInputElement> elements;
 			uint nByteOffset = 0;
 			if (!m_positions.empty())
 			{
-				elements.push_back(RdrVertexInputElement{ RdrShaderSemantic::Position, 0, RdrVertexInputFormat::RGB_F32, 0, nByteOffset, RdrVertexInputClass::PerVertex, 0 });
-				nByteOffset += sizeof(float) * 3;
+				RdrVertexInputFormat eFormat = bPacked ? RdrVertexInputFormat::RGBA_U16_UNORM : RdrVertexInputFormat::RGB_F32;
+				elements.push_back(RdrVertexInputElement{ RdrShaderSemantic::Position, 0, eFormat, 0, nByteOffset, RdrVertexInputClass::PerVertex, 0 });
+				nByteOffset += bPacked ? sizeof(uint16) * 4 : sizeof(float) * 3;
 			}
 			if (!m_normals.empty())
 			{
-				elements.push_back(RdrVertexInputElement{ RdrShaderSemantic::Normal, 0, RdrVertexInputFormat::RGB_F32, 0, nByteOffset, RdrVertexInputClass::PerVertex, 0 });
-				nByteOffset += sizeof(float) * 3;
+				RdrVertexInputFormat eFormat = bPacked ? RdrVertexInputFormat::RG_S16_SNORM : RdrVertexInputFormat::RGB_F32;
+				elements.push_back(RdrVertexInputElement{ RdrShaderSemantic::Normal, 0, eFormat, 0, nByteOffset, RdrVertexInputClass::PerVertex, 0 });
+				nByteOffset += bPacked ? sizeof(int16) * 2 : sizeof(float) * 3;
 			}
 			for (uint nChannel = 0; nChannel < kMaxNumTexCoords; ++nChannel)
 			{
 				if (!m_texcoords[nChannel].empty())
 				{
-					elements.push_back(RdrVertexInputElement{ RdrShaderSemantic::Texcoord, nChannel, RdrVertexInputFormat::RG_F32, 0, nByteOffset, RdrVertexInputClass::PerVertex, 0 });
-					nByteOffset += sizeof(float) * 2;
+					RdrVertexInputFormat eFormat = bPacked ? RdrVertexInputFormat::RG_F16 : RdrVertexInputFormat::RG_F32;
+					elements.push_back(RdrVertexInputElement{ RdrShaderSemantic::Texcoord, nChannel, eFormat, 0, nByteOffset, RdrVertexInputClass::PerVertex, 0 });
+					nByteOffset += bPacked ? sizeof(float16) * 2 : sizeof(float) * 2;
 				}
 			}
 			if (!m_colors.empty())
@@ -168,10 +184,11 @@ namespace
 			}
 			if (!m_tangents.empty())
 			{
-				elements.push_back(RdrVertexInputElement{ RdrShaderSemantic::Tangent, 0, RdrVertexInputFormat::RGB_F32, 0, nByteOffset, RdrVertexInputClass::PerVertex, 0 });
-				nByteOffset += sizeof(float) * 3;
+				RdrVertexInputFormat eFormat = bPacked ? RdrVertexInputFormat::RG_S16_SNORM : RdrVertexInputFormat::RGB_F32;
+				elements.push_back(RdrVertexInputElement{ RdrShaderSemantic::Tangent, 0, eFormat, 0, nByteOffset, RdrVertexInputClass::PerVertex, 0 });
+				nByteOffset += bPacked ? sizeof(int16) * 2 : sizeof(float) * 3;
 			}
-			if (!m_bitangents.empty())
+			if (!m_bitangents.empty() && !bPacked)
 			{
 				elements.push_back(RdrVertexInputElement{ RdrShaderSemantic::Binormal, 0, RdrVertexInputFormat::RGB_F32, 0, nByteOffset, RdrVertexInputClass::PerVertex, 0 });
 				nByteOffset += sizeof(float) * 3;
@@ -180,39 +197,52 @@ namespace
 			return elements;
 		}
 
-		std::vector<uint16> MakeIndexBuffer16() const
+		uint GetIndexCountWithLods() const
 		{
-			std::vector<uint16> indices16;
-			if (!Use16BitIndices())
+			uint nCount = (uint)m_indices.size();
+			for (const ExportLod& lod : m_lods)
 			{
-				Error("Invalid index format requested!");
-				return indices16;
+				nCount += (uint)lod.indices.size();
 			}
+			return nCount;
+		}
 
-			for (uint nIndex : m_indices)
+		// Full detail indices followed by the indices of each LOD.
+		std::vector<uint8> MakeIndexBuffer() const
+		{
+			std::vector<uint8> outBuffer;
+			AppendIndices(m_indices, outBuffer);
+			for (const ExportLod& lod : m_lods)
 			{
-				indices16.push_back(nIndex);
+				AppendIndices(lod.indices, outBuffer);
 			}
-
-			return indices16;
+			return outBuffer;
 		}
 
-		std::vector<uint> MakeIndexBuffer32() const
+		void AppendIndices(const std::vector<uint>& indices, std::vector<uint8>& rOutBuffer) const
 		{
+			uint nStart = (uint)rOutBuffer.size();
+			rOutBuffer.resize(nStart + indices.size() * GetIndexFormatSize());
+
 			if (Use16BitIndices())
 			{
-				Error("Invalid index format requested!");
-				return m_indices;
+				uint16* pDst = (uint16*)(rOutBuffer.data() + nStart);
+				for (uint i = 0; i < (uint)indices.size(); ++i)
+				{
+					pDst[i] = (uint16)indices[i];
+				}
+			}
+			else
+			{
+				std::copy(indices.begin(), indices.end(), (uint*)(rOutBuffer.data() + nStart));
 			}
-
-			return m_indices;
 		}
 
 		std::vector<uint8> MakeVertexBuffer() const
 		{
 			uint nByteOffset = 0;
 			uint nVertexCount = (uint)m_positions.size();
-			uint nVertexStride = GetVertexStride();
+			uint nVertexStride = GetVertexStride(false);
 
 			std::vector<uint8> outBuffer;
 			outBuffer.resize(nVertexStride * nVertexCount);
@@ -257,6 +287,91 @@ namespace
 			Assert(nByteOffset == nVertexStride * nVertexCount);
 			return outBuffer;
 		}
+
+		std::vector<uint8> MakePackedVertexBuffer(const VertexPacking::PositionQuantization& rQuantization) const
+		{
+			uint nByteOffset = 0;
+			uint nVertexCount = (uint)m_positions.size();
+			uint nVertexStride = GetVertexStride(true);
+
+			std::vector<uint8> outBuffer;
+			outBuffer.resize(nVertexStride * nVertexCount);
+
+			for (uint iVert = 0; iVert < nVertexCount; ++iVert)
+			{
+				if (!m_positions.empty())
+				{
+					VertexPacking::PackedPosition packed = VertexPacking::PackPosition(m_positions[iVert], GetBitangentSign(iVert), rQuantization);
+					*(VertexPacking::PackedPosition*)(outBuffer.data() + nByteOffset) = packed;
+					nByteOffset += sizeof(VertexPacking::PackedPosition);
+				}
+				if (!m_normals.empty())
+				{
+					*(VertexPacking::PackedDirection*)(outBuffer.data() + nByteOffset) = VertexPacking::PackDirection(m_normals[iVert]);
+					nByteOffset += sizeof(VertexPacking::PackedDirection);
+				}
+				for (uint nChannel = 0; nChannel < kMaxNumTexCoords; ++nChannel)
+				{
+					if (!m_texcoords[nChannel].empty())
+					{
+						*(VertexPacking::PackedTexcoord*)(outBuffer.data() + nByteOffset) = VertexPacking::PackTexcoord(m_texcoords[nChannel][iVert]);
+						nByteOffset += sizeof(VertexPacking::PackedTexcoord);
+					}
+				}
+				if (!m_colors.empty())
+				{
+					*(Color32*)(outBuffer.data() + nByteOffset) = m_colors[iVert];
+					nByteOffset += sizeof(m_colors[0]);
+				}
+				if (!m_tangents.empty())
+				{
+					*(VertexPacking::PackedDirection*)(outBuffer.data() + nByteOffset) = VertexPacking::PackDirection(m_tangents[iVert]);
+					nByteOffset += sizeof(VertexPacking::PackedDirection);
+				}
+			}
+
+			Assert(nByteOffset == nVertexStride * nVertexCount);
+			return outBuffer;
+		}
+
+		// Handedness of the tangent frame.  Packed vertices rebuild the bitangent as cross(normal, tangent) * sign.
+		float GetBitangentSign(uint iVert) const
+		{
+			if (m_normals.empty() || m_tangents.empty() || m_bitangents.empty())
+				return 1.f;
+
+			Vec3 vCross = Vec3Cross(m_normals[iVert], m_tangents[iVert]);
+			return (Vec3Dot(vCross, m_bitangents[iVert]) < 0.f) ? -1.f : 1.f;
+		}
+
+		// Reorder all vertex streams.  newToOld[i] is the original index of the new vertex i.
+		void RemapVertices(const std::vector<uint>& newToOld)
+		{
+			RemapStream(m_positions, newToOld);
+			RemapStream(m_normals, newToOld);
+			for (uint nChannel = 0; nChannel < kMaxNumTexCoords; ++nChannel)
+			{
+				RemapStream(m_texcoords[nChannel], newToOld);
+			}
+			RemapStream(m_colors, newToOld);
+			RemapStream(m_tangents, newToOld);
+			RemapStream(m_bitangents, newToOld);
+		}
+
+	private:
+		template<typename T>
+		static void RemapStream(std::vector<T>& stream, const std::vector<uint>& newToOld)
+		{
+			if (stream.empty())
+				return;
+
+			std::vector<T> remapped(stream.size());
+			for (uint i = 0; i < (uint)newToOld.size(); ++i)
+			{
+				remapped[i] = stream[newToOld[i]];
+			}
+			stream.swap(remapped);
+		}
 	};
 
 	struct ExportMesh
@@ -308,6 +423,8 @@ namespace
 	struct SceneData
 	{
 		std::string name;
+		Hashing::SHA1 srcHash;
+		AssetLib::ModelFlags eModelFlags;
 		Vec3 cameraPosition;
 		Rotation cameraRotation;
 		std::vector<SceneMesh> meshes;
@@ -407,49 +524,176 @@ namespace
 		}
 	}
 
-	bool WriteMeshAsset(ExportMesh& mesh, const std::string& dstFilename)
+	void OptimizeMesh(ExportMesh& mesh, const std::string& dstFilename)
 	{
-		GenerateTangents(mesh);
+		// Overdraw reordering may increase the ACMR by up to 5% over the vertex cache optimized order.
+		const float kOverdrawAcmrThreshold = 1.05f;
 
-		const AssetLib::AssetDef& rAssetDef = AssetLib::Model::GetAssetDef();
+		printf("Mesh optimization: %s\n", dstFilename.c_str());
 
-		std::ofstream dstFile(dstFilename, std::ios::binary);
-		Assert(dstFile.is_open());
+		for (ExportSubMesh& submesh : mesh.submeshes)
+		{
+			uint nVertexCount = submesh.GetVertexCount();
+			MeshOptimizer::VertexCacheStats statsBefore = MeshOptimizer::AnalyzeVertexCache(submesh.m_indices, nVertexCount);
 
-		// Write header
-		AssetLib::BinFileHeader header;
-		header.binUID = AssetLib::BinFileHeader::kUID;
-		header.assetUID = rAssetDef.GetAssetUID();
-		header.version = rAssetDef.GetBinVersion();
-		header.srcHash = Hashing::SHA1();
-		dstFile.write((char*)&header, sizeof(header));
+			MeshOptimizer::OptimizeVertexCache(submesh.m_indices, nVertexCount);
+			MeshOptimizer::OptimizeOverdraw(submesh.m_indices, submesh.m_positions, kOverdrawAcmrThreshold);
+
+			std::vector<uint> newToOld = MeshOptimizer::OptimizeVertexFetch(submesh.m_indices, nVertexCount);
+			submesh.RemapVertices(newToOld);
+
+			MeshOptimizer::VertexCacheStats statsAfter = MeshOptimizer::AnalyzeVertexCache(submesh.m_indices, nVertexCount);
+			printf("  %-32s tris: %7u  ACMR: %.3f -> %.3f  ATVR: %.3f -> %.3f\n",
+				submesh.m_materialName.c_str(), (uint)submesh.m_indices.size() / 3,
+				statsBefore.fAcmr, statsAfter.fAcmr, statsBefore.fAtvr, statsAfter.fAtvr);
+		}
+	}
+
+	void GenerateLods(ExportMesh& mesh)
+	{
+		// Each LOD targets half the triangles of the previous level.
+		const float kLodTriangleRatio = 0.5f;
+		// Stop generating LODs once simplification fails to remove at least a quarter of the triangles.
+		const float kMinLodReduction = 0.75f;
+		const uint kMinLodTriangles = 64;
+		// Max deviation of the last LOD relative to the size of the subobject.
+		const float kMaxLodRelativeError = 0.05f;
+
+		for (ExportSubMesh& submesh : mesh.submeshes)
+		{
+			submesh.m_lods.clear();
+			submesh.m_lods.reserve(AssetLib::Model::kMaxLods - 1);
+
+			Vec3 vMin(FLT_MAX, FLT_MAX, FLT_MAX);
+			Vec3 vMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			for (const Vec3& vPos : submesh.m_positions)
+			{
+				vMin = Vec3Min(vMin, vPos);
+				vMax = Vec3Max(vMax, vPos);
+			}
+			float fMaxError = Vec3Length(vMax - vMin) * kMaxLodRelativeError;
+
+			const std::vector<uint>* pPrevIndices = &submesh.m_indices;
+			float fPrevError = 0.f;
+			while (submesh.m_lods.size() + 1 < AssetLib::Model::kMaxLods)
+			{
+				uint nPrevTriCount = (uint)pPrevIndices->size() / 3;
+				if (nPrevTriCount <= kMinLodTriangles)
+					break;
+
+				// Each level is simplified from the previous one.  The quadric error limit is only an estimate,
+				// so the deviation from the full detail geometry is measured and checked afterwards.
+				uint nTargetIndexCount = (uint)(nPrevTriCount * kLodTriangleRatio) * 3;
+				std::vector<uint> lodIndices = MeshOptimizer::Simplify(*pPrevIndices, submesh.m_positions, nTargetIndexCount, fMaxError, nullptr);
+				if (lodIndices.size() / 3 > nPrevTriCount * kMinLodReduction)
+					break;
+
+				float fLodError = MeshOptimizer::MeasureDeviation(submesh.m_indices, lodIndices, submesh.m_positions);
+				if (fLodError > fMaxError)
+					break;
+
+				MeshOptimizer::OptimizeVertexCache(lodIndices, submesh.GetVertexCount());
+
+				// Keep errors increasing so selection can stop at the first level that exceeds the allowed error.
+				ExportLod lod;
+				lod.indices.swap(lodIndices);
+				lod.fError = std::max(fLodError, fPrevError);
+				submesh.m_lods.push_back(lod);
+
+				pPrevIndices = &submesh.m_lods.back().indices;
+				fPrevError = lod.fError;
+			}
+		}
+	}
+
+	void BuildClusters(ExportMesh& mesh)
+	{
+		for (ExportSubMesh& submesh : mesh.submeshes)
+		{
+			submesh.m_clusters = MeshOptimizer::BuildClusters(submesh.m_indices, submesh.m_positions);
+
+			uint nConeCount = 0;
+			float fConeAngleSum = 0.f;
+			for (const MeshOptimizer::Cluster& cluster : submesh.m_clusters)
+			{
+				if (cluster.fConeCutoff < 1.f)
+				{
+					fConeAngleSum += asinf(cluster.fConeCutoff);
+					++nConeCount;
+				}
+			}
+
+			printf("  %-32s clusters: %u  avg tris: %.1f  back-face cullable: %u  avg cone angle: %.1f deg\n",
+				submesh.m_materialName.c_str(), (uint)submesh.m_clusters.size(),
+				submesh.m_indices.size() / (3.f * std::max((uint)submesh.m_clusters.size(), 1u)),
+				nConeCount, nConeCount ? Maths::RadToDeg(fConeAngleSum / nConeCount) : 0.f);
+		}
+	}
+
+	// Builds the raycast BVH over the full detail triangles of all submeshes.
+	// ModelBvh_RayIntersectMatchesBruteForce in RenderLabTests checks the hierarchy against a brute-force search.
+	void BuildBvh(const ExportMesh& mesh, std::vector<AssetLib::Model::BvhNode>& rOutNodes, std::vector<AssetLib::Model::BvhTriangle>& rOutTriangles)
+	{
+		std::vector<Vec3> positions;
+		std::vector<AssetLib::Model::BvhTriangle> triangles;
+		for (const ExportSubMesh& submesh : mesh.submeshes)
+		{
+			uint nPositionStart = (uint)positions.size();
+			positions.insert(positions.end(), submesh.m_positions.begin(), submesh.m_positions.end());
+
+			for (uint i = 0; i < (uint)submesh.m_indices.size(); i += 3)
+			{
+				AssetLib::Model::BvhTriangle tri;
+				tri.anPositions[0] = nPositionStart + submesh.m_indices[i + 0];
+				tri.anPositions[1] = nPositionStart + submesh.m_indices[i + 1];
+				tri.anPositions[2] = nPositionStart + submesh.m_indices[i + 2];
+				triangles.push_back(tri);
+			}
+		}
+
+		ModelBvh::Build(triangles, positions.data(), rOutNodes, rOutTriangles);
+	}
+
+	bool WriteMeshAsset(ExportMesh& mesh, const Hashing::SHA1& srcHash, AssetLib::ModelFlags eFlags, const std::string& dstFilename)
+	{
+		GenerateTangents(mesh);
+		OptimizeMesh(mesh, dstFilename);
+		GenerateLods(mesh);
+		BuildClusters(mesh);
+
+		std::vector<AssetLib::Model::BvhNode> bvhNodes;
+		std::vector<AssetLib::Model::BvhTriangle> bvhTriangles;
+		BuildBvh(mesh, bvhNodes, bvhTriangles);
+
+		const AssetLib::AssetDef& rAssetDef = AssetLib::Model::GetAssetDef();
+		bool bPacked = IsFlagSet(eFlags, AssetLib::ModelFlags::PackedVertices);
+		bool bCompressed = IsFlagSet(eFlags, AssetLib::ModelFlags::CompressedStreams);
 
 		AssetLib::Model modelBin;
+		modelBin.eFlags = eFlags;
 		modelBin.nTotalVertCount = 0;
 		modelBin.nTotalIndexCount = 0;
 		modelBin.nTotalInputElementCount = 0;
+		modelBin.nTotalLodCount = 0;
+		modelBin.nTotalClusterCount = 0;
+		modelBin.nBvhNodeCount = (uint)bvhNodes.size();
+		modelBin.nBvhTriangleCount = (uint)bvhTriangles.size();
 		modelBin.nVertexBufferSize = 0;
 		modelBin.nIndexBufferSize = 0;
+		modelBin.nCompressedDataSize = 0;
 		modelBin.vBoundsMin = Vec3(FLT_MAX, FLT_MAX, FLT_MAX);
-		modelBin.vBoundsMax = Vec3(-FLT_MIN, -FLT_MIN, -FLT_MIN);
+		modelBin.vBoundsMax = Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
 		modelBin.nSubObjectCount = (uint)mesh.submeshes.size();
 
 		for (const ExportSubMesh& submesh : mesh.submeshes)
 		{
 			modelBin.nTotalVertCount += submesh.GetVertexCount();
-			modelBin.nTotalIndexCount += (uint)submesh.m_indices.size();
-			modelBin.nVertexBufferSize += submesh.GetVertexStride() * submesh.GetVertexCount();
-			modelBin.nIndexBufferSize += (uint)submesh.m_indices.size() * submesh.GetIndexFormatSize();
-
-			modelBin.nTotalInputElementCount += !submesh.m_positions.empty();
-			modelBin.nTotalInputElementCount += !submesh.m_normals.empty();
-			for (uint nChannel = 0; nChannel < kMaxNumTexCoords; ++nChannel)
-			{
-				modelBin.nTotalInputElementCount += !submesh.m_texcoords[nChannel].empty();
-			}
-			modelBin.nTotalInputElementCount += !submesh.m_colors.empty();
-			modelBin.nTotalInputElementCount += !submesh.m_tangents.empty();
-			modelBin.nTotalInputElementCount += !submesh.m_bitangents.empty();
+			modelBin.nTotalIndexCount += submesh.GetIndexCountWithLods();
+			modelBin.nVertexBufferSize += submesh.GetVertexStride(bPacked) * submesh.GetVertexCount();
+			modelBin.nIndexBufferSize += submesh.GetIndexCountWithLods() * submesh.GetIndexFormatSize();
+			modelBin.nTotalInputElementCount += submesh.GetNumVertexInputElements(bPacked);
+			modelBin.nTotalLodCount += (uint)submesh.m_lods.size();
+			modelBin.nTotalClusterCount += (uint)submesh.m_clusters.size();
 
 			for (const Vec3& vPos : submesh.m_positions)
 			{
@@ -458,37 +702,88 @@ namespace
 			}
 		}
 
-		modelBin.subobjects.offset = 0;
-		modelBin.inputElements.offset = modelBin.subobjects.offset + modelBin.subobjects.CalcSize(modelBin.nSubObjectCount);
-		modelBin.positions.offset = modelBin.inputElements.offset + modelBin.inputElements.CalcSize(modelBin.nTotalInputElementCount);
-		modelBin.vertexBuffer.offset = modelBin.positions.offset + modelBin.positions.CalcSize(modelBin.nTotalVertCount);
-		modelBin.indexBuffer.offset = modelBin.vertexBuffer.offset + modelBin.nVertexBufferSize;
+		// Positions are quantized relative to the model bounds rather than per subobject
+		// so that all subobjects can share the dequantization constants of the model.
+		VertexPacking::PositionQuantization quantization;
+		quantization.vOffset = modelBin.GetPositionDequantOffset();
+		quantization.vScale = modelBin.GetPositionDequantScale();
 
-		dstFile.write((char*)&modelBin, sizeof(AssetLib::Model));
+		// Build vertex and index buffers
+		std::vector<std::vector<uint8>> vertexBuffers;
+		std::vector<std::vector<uint8>> indexBuffers;
+		for (const ExportSubMesh& submesh : mesh.submeshes)
+		{
+			vertexBuffers.push_back(bPacked ? submesh.MakePackedVertexBuffer(quantization) : submesh.MakeVertexBuffer());
+			indexBuffers.push_back(submesh.MakeIndexBuffer());
+		}
 
-		// Write submesh headers
+		// Build submesh headers and compress streams
 		uint nTotalIndexBufferBytes = 0;
 		uint nTotalInputElementCount = 0;
 		uint nTotalVertexBufferBytes = 0;
 
 		std::vector<AssetLib::Model::SubObject> allSubObjects;
-		for (const ExportSubMesh& submesh : mesh.submeshes)
+		std::vector<AssetLib::Model::SubObjectLod> allLods;
+		std::vector<AssetLib::Model::SubObjectCluster> allClusters;
+		std::vector<uint8> compressedData;
+		for (uint i = 0; i < (uint)mesh.submeshes.size(); ++i)
 		{
-			AssetLib::Model::SubObject subobject;
+			const ExportSubMesh& submesh = mesh.submeshes[i];
+
+			AssetLib::Model::SubObject subobject = {};
 			subobject.nIndexCount = (uint)submesh.m_indices.size();
 			subobject.eIndexFormat = submesh.GetIndexBufferFormat();
 			subobject.nIndexStartByteOffset = nTotalIndexBufferBytes;
 			nTotalIndexBufferBytes += subobject.nIndexCount * submesh.GetIndexFormatSize();
 
-			subobject.nInputElementCount = submesh.GetNumVertexInputElements();
+			subobject.nLodStart = (uint)allLods.size();
+			subobject.nLodCount = (uint)submesh.m_lods.size();
+			for (const ExportLod& lod : submesh.m_lods)
+			{
+				AssetLib::Model::SubObjectLod lodBin;
+				lodBin.nIndexStartByteOffset = nTotalIndexBufferBytes;
+				lodBin.nIndexCount = (uint)lod.indices.size();
+				lodBin.fError = lod.fError;
+				nTotalIndexBufferBytes += lodBin.nIndexCount * submesh.GetIndexFormatSize();
+
+				allLods.push_back(lodBin);
+			}
+
+			subobject.nClusterStart = (uint)allClusters.size();
+			subobject.nClusterCount = (uint)submesh.m_clusters.size();
+			for (const MeshOptimizer::Cluster& cluster : submesh.m_clusters)
+			{
+				AssetLib::Model::SubObjectCluster clusterBin;
+				clusterBin.nIndexStart = cluster.nIndexStart;
+				clusterBin.nIndexCount = cluster.nIndexCount;
+				clusterBin.vCenter = cluster.vCenter;
+				clusterBin.fRadius = cluster.fRadius;
+				clusterBin.vConeAxis = cluster.vConeAxis;
+				clusterBin.fConeCutoff = cluster.fConeCutoff;
+
+				allClusters.push_back(clusterBin);
+			}
+
+			subobject.nInputElementCount = submesh.GetNumVertexInputElements(bPacked);
 			subobject.nInputElementStart = nTotalInputElementCount;
 			nTotalInputElementCount += subobject.nInputElementCount;
 
 			subobject.nVertexCount = submesh.GetVertexCount();
 			subobject.nVertexStartByteOffset = nTotalVertexBufferBytes;
-			subobject.nVertexStride = submesh.GetVertexStride();
+			subobject.nVertexStride = submesh.GetVertexStride(bPacked);
 			nTotalVertexBufferBytes += subobject.nVertexCount * subobject.nVertexStride;
 
+			if (bCompressed)
+			{
+				subobject.nCompressedVertexByteOffset = (uint)compressedData.size();
+				StreamCodec::Encode(vertexBuffers[i].data(), subobject.nVertexCount, subobject.nVertexStride, compressedData);
+				subobject.nCompressedVertexByteSize = (uint)compressedData.size() - subobject.nCompressedVertexByteOffset;
+
+				subobject.nCompressedIndexByteOffset = (uint)compressedData.size();
+				StreamCodec::Encode(indexBuffers[i].data(), submesh.GetIndexCountWithLods(), submesh.GetIndexFormatSize(), compressedData);
+				subobject.nCompressedIndexByteSize = (uint)compressedData.size() - subobject.nCompressedIndexByteOffset;
+			}
+
 			strcpy_s(subobject.strMaterialName, ARRAY_SIZE(subobject.strMaterialName), submesh.m_materialName.c_str());
 
 			subobject.vBoundsMin = submesh.m_vBoundsMin;
@@ -496,13 +791,48 @@ namespace
 
 			allSubObjects.push_back(subobject);
 		}
+
+		if (bCompressed)
+		{
+			uint nUncompressedSize = modelBin.nVertexBufferSize + modelBin.nIndexBufferSize;
+			printf("  Compressed streams: %u -> %u bytes (%.1f%%)\n",
+				nUncompressedSize, (uint)compressedData.size(), 100.f * compressedData.size() / std::max(nUncompressedSize, 1u));
+		}
+
+		modelBin.nCompressedDataSize = (uint)compressedData.size();
+		modelBin.subobjects.offset = 0;
+		modelBin.inputElements.offset = modelBin.subobjects.offset + modelBin.subobjects.CalcSize(modelBin.nSubObjectCount);
+		modelBin.lods.offset = modelBin.inputElements.offset + modelBin.inputElements.CalcSize(modelBin.nTotalInputElementCount);
+		modelBin.clusters.offset = modelBin.lods.offset + modelBin.lods.CalcSize(modelBin.nTotalLodCount);
+		modelBin.bvhNodes.offset = modelBin.clusters.offset + modelBin.clusters.CalcSize(modelBin.nTotalClusterCount);
+		modelBin.bvhTriangles.offset = modelBin.bvhNodes.offset + modelBin.bvhNodes.CalcSize(modelBin.nBvhNodeCount);
+		modelBin.positions.offset = modelBin.bvhTriangles.offset + modelBin.bvhTriangles.CalcSize(modelBin.nBvhTriangleCount);
+		modelBin.vertexBuffer.offset = modelBin.positions.offset + modelBin.positions.CalcSize(modelBin.nTotalVertCount);
+		modelBin.indexBuffer.offset = modelBin.vertexBuffer.offset + modelBin.nVertexBufferSize;
+		// Compressed streams take the place of the vertex and index buffers in the file.
+		modelBin.compressedData.offset = modelBin.vertexBuffer.offset;
+
+		std::ofstream dstFile(dstFilename, std::ios::binary);
+		Assert(dstFile.is_open());
+
+		// Write header
+		AssetLib::BinFileHeader header;
+		header.binUID = AssetLib::BinFileHeader::kUID;
+		header.assetUID = rAssetDef.GetAssetUID();
+		header.version = rAssetDef.GetBinVersion();
+		header.srcHash = srcHash;
+		dstFile.write((char*)&header, sizeof(header));
+
+		dstFile.write((char*)&modelBin, sizeof(AssetLib::Model));
+
+		// Write submesh headers
 		dstFile.write((char*)allSubObjects.data(), sizeof(allSubObjects[0]) * allSubObjects.size());
 
 		// Write input elements
 		std::vector<RdrVertexInputElement> allInputElements;
 		for (const ExportSubMesh& submesh : mesh.submeshes)
 		{
-			std::vector<RdrVertexInputElement> submeshElements = submesh.GetVertexInputElements();
+			std::vector<RdrVertexInputElement> submeshElements = submesh.GetVertexInputElements(bPacked);
 			for (RdrVertexInputElement& elem : submeshElements)
 			{
 				allInputElements.push_back(elem);
@@ -510,31 +840,38 @@ namespace
 		}
 		dstFile.write((char*)allInputElements.data(), sizeof(allInputElements[0]) * allInputElements.size());
 
+		// Write LODs
+		dstFile.write((char*)allLods.data(), sizeof(AssetLib::Model::SubObjectLod) * allLods.size());
+
+		// Write clusters
+		dstFile.write((char*)allClusters.data(), sizeof(AssetLib::Model::SubObjectCluster) * allClusters.size());
+
+		// Write BVH
+		dstFile.write((char*)bvhNodes.data(), sizeof(AssetLib::Model::BvhNode) * bvhNodes.size());
+		dstFile.write((char*)bvhTriangles.data(), sizeof(AssetLib::Model::BvhTriangle) * bvhTriangles.size());
+
 		// Write positions
 		for (const ExportSubMesh& submesh : mesh.submeshes)
 		{
 			dstFile.write((char*)submesh.m_positions.data(), sizeof(submesh.m_positions[0]) * submesh.m_positions.size());
 		}
 
-		// Write vertex buffers
-		for (const ExportSubMesh& submesh : mesh.submeshes)
+		if (bCompressed)
 		{
-			std::vector<uint8> vertexBuffer = submesh.MakeVertexBuffer();
-			dstFile.write((char*)vertexBuffer.data(), vertexBuffer.size());
+			dstFile.write((char*)compressedData.data(), compressedData.size());
 		}
-
-		// Write index buffers
-		for (const ExportSubMesh& submesh : mesh.submeshes)
+		else
 		{
-			if (submesh.Use16BitIndices())
+			// Write vertex buffers
+			for (const std::vector<uint8>& vertexBuffer : vertexBuffers)
 			{
-				std::vector<uint16> indexBuffer = submesh.MakeIndexBuffer16();
-				dstFile.write((char*)indexBuffer.data(), sizeof(indexBuffer[0]) * indexBuffer.size());
+				dstFile.write((char*)vertexBuffer.data(), vertexBuffer.size());
 			}
-			else
+
+			// Write index buffers
+			for (const std::vector<uint8>& indexBuffer : indexBuffers)
 			{
-				std::vector<uint> indexBuffer = submesh.MakeIndexBuffer32();
-				dstFile.write((char*)indexBuffer.data(), sizeof(indexBuffer[0]) * indexBuffer.size());
+				dstFile.write((char*)indexBuffer.data(), indexBuffer.size());
 			}
 		}
 
@@ -610,7 +947,7 @@ namespace
 	}
 }
 
-bool ModelImport::ImportObj(const std::string& srcFilename, const std::string& dstFilename)
+bool ModelImport::ImportObj(const std::string& srcFilename, const std::string& dstFilename, AssetLib::ModelFlags eModelFlags)
 {
 	std::ifstream srcFile(srcFilename);
 	Assert(srcFile.is_open());
@@ -708,7 +1045,14 @@ bool ModelImport::ImportObj(const std::string& srcFilename, const std::string& d
 		}
 	}
 
-	return WriteMeshAsset(mesh, dstFilename);
+	Hashing::SHA1 srcHash;
+	if (!Hashing::SHA1::HashFile(srcFilename.c_str(), srcHash))
+	{
+		Error("Failed to hash source file: %s", srcFilename.c_str());
+		return false;
+	}
+
+	return WriteMeshAsset(mesh, srcHash, eModelFlags, dstFilename);
 }
 
 
@@ -1520,7 +1864,7 @@ namespace
 		ExportMesh exportMesh;
 		ConvertImportedFbxMeshToExportMesh(importedMeshes, &exportMesh);
 
-		return WriteMeshAsset(exportMesh, dstFilename);
+		return WriteMeshAsset(exportMesh, sceneData.srcHash, sceneData.eModelFlags, dstFilename);
 	}
 
 	bool ImportFbxSceneMesh(FbxNode* pNode, SceneData& sceneData, SceneMesh& sceneMesh)
@@ -1678,8 +2022,15 @@ namespace
 	}
 }
 
-bool ModelImport::ImportFbx(const std::string& srcFilename, const std::string& dstFilename)
+bool ModelImport::ImportFbx(const std::string& srcFilename, const std::string& dstFilename, AssetLib::ModelFlags eModelFlags)
 {
+	Hashing::SHA1 srcHash;
+	if (!Hashing::SHA1::HashFile(srcFilename.c_str(), srcHash))
+	{
+		Error("Failed to hash source file: %s", srcFilename.c_str());
+		return false;
+	}
+
 	FbxManager* pSdkManager = nullptr;
 	FbxScene* pScene = nullptr;
 
@@ -1697,6 +2048,8 @@ bool ModelImport::ImportFbx(const std::string& srcFilename, const std::string& d
 
 	SceneData sceneData;
 	sceneData.name = sceneName;
+	sceneData.srcHash = srcHash;
+	sceneData.eModelFlags = eModelFlags;
 	sceneData.nVertexPositionSwizzle[0] = 0;
 	sceneData.nVertexPositionSwizzle[1] = 1;
 	sceneData.nVertexPositionSwizzle[2] = 2;
@@ -1,9 +1,15 @@
 #pragma once
 #include <fstream>
 #include <string>
+#include "../Types.h"
+#include "AssetLib/ModelAsset.h"
 
 namespace ModelImport
 {
-	bool ImportObj(const std::string& srcFilename, const std::string& dstFilename);
-	bool ImportFbx(const std::string& srcFilename, const std::string& dstFilename);
+	// Increment when import processing changes without a change to the asset bin version.
+	static const uint kImportVersion = 3;
+
+	// eModelFlags selects the optional packed vertex layout and stream compression for written models.
+	bool ImportObj(const std::string& srcFilename, const std::string& dstFilename, AssetLib::ModelFlags eModelFlags);
+	bool ImportFbx(const std::string& srcFilename, const std::string& dstFilename, AssetLib::ModelFlags eModelFlags);
 }
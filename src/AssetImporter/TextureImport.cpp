@@ -1,11 +1,14 @@
 #include "TextureImport.h"
 #include "AssetLib/TextureAsset.h"
+#include "AssetLib/TerrainTilesAsset.h"
+#include "MathLib/Maths.h"
 #include "UtilsLib/FileLoader.h"
 #include "UtilsLib/Error.h"
 #include "UtilsLib/Util.h"
 
 #include "DirectXTex/include/DirectXTex.h"
 #include "DirectXTex/include/Dds.h"
+#include <algorithm>
 
 namespace
 {
@@ -49,6 +52,137 @@ namespace
 
 		return TextureType::Srgb;
 	}
+
+	// Writes the heightmap's mip chain as a terrain tiles file next to the texture.
+	bool writeTerrainTiles(const DirectX::Image& rHeights, const std::string& srcFilename, const std::string& dstFilename)
+	{
+		const AssetLib::AssetDef& rAssetDef = AssetLib::TerrainTiles::GetAssetDef();
+		const uint tileSize = AssetLib::TerrainTiles::kDefaultTileSize;
+
+		// Build the mip chain.  Each level is a 2x2 box filter of the previous one.
+		std::vector<std::vector<float16>> levels;
+		std::vector<float> currLevel(rHeights.width * rHeights.height);
+		for (uint y = 0; y < rHeights.height; ++y)
+		{
+			memcpy(&currLevel[y * rHeights.width], rHeights.pixels + y * rHeights.rowPitch, sizeof(float) * rHeights.width);
+		}
+
+		AssetLib::TerrainTiles layout = { 0 };
+		layout.width = (uint)rHeights.width;
+		layout.height = (uint)rHeights.height;
+		layout.tileSize = tileSize;
+
+		uint levelWidth = layout.width;
+		uint levelHeight = layout.height;
+		uint numTiles = 0;
+		while (true)
+		{
+			uint nLevel = layout.numLevels++;
+			layout.levelTilesX[nLevel] = (levelWidth + tileSize - 1) / tileSize;
+			layout.levelTilesY[nLevel] = (levelHeight + tileSize - 1) / tileSize;
+			layout.levelFirstTile[nLevel] = numTiles;
+			numTiles += layout.levelTilesX[nLevel] * layout.levelTilesY[nLevel];
+
+			levels.emplace_back(currLevel.size());
+			for (uint i = 0; i < currLevel.size(); ++i)
+			{
+				levels.back()[i] = Maths::convertSingleToHalfPrecision(currLevel[i]);
+			}
+
+			if (layout.numLevels == AssetLib::TerrainTiles::kMaxLevels || (levelWidth <= tileSize && levelHeight <= tileSize))
+				break;
+
+			uint nextWidth = std::max(levelWidth / 2, 1u);
+			uint nextHeight = std::max(levelHeight / 2, 1u);
+			std::vector<float> nextLevel(nextWidth * nextHeight);
+			for (uint y = 0; y < nextHeight; ++y)
+			{
+				uint y0 = std::min(y * 2, levelHeight - 1);
+				uint y1 = std::min(y * 2 + 1, levelHeight - 1);
+				for (uint x = 0; x < nextWidth; ++x)
+				{
+					uint x0 = std::min(x * 2, levelWidth - 1);
+					uint x1 = std::min(x * 2 + 1, levelWidth - 1);
+					nextLevel[x + y * nextWidth] = 0.25f * (currLevel[x0 + y0 * levelWidth] + currLevel[x1 + y0 * levelWidth]
+						+ currLevel[x0 + y1 * levelWidth] + currLevel[x1 + y1 * levelWidth]);
+				}
+			}
+
+			currLevel.swap(nextLevel);
+			levelWidth = nextWidth;
+			levelHeight = nextHeight;
+		}
+
+		// Split levels into tiles.  Edge tiles repeat the last row and column of the level.
+		std::vector<float16> tileBounds(numTiles * 2);
+		std::vector<float16> tileData((size_t)numTiles * tileSize * tileSize);
+		levelWidth = layout.width;
+		levelHeight = layout.height;
+		for (uint nLevel = 0; nLevel < layout.numLevels; ++nLevel)
+		{
+			const std::vector<float16>& rTexels = levels[nLevel];
+			for (uint ty = 0; ty < layout.levelTilesY[nLevel]; ++ty)
+			{
+				for (uint tx = 0; tx < layout.levelTilesX[nLevel]; ++tx)
+				{
+					uint nTile = layout.GetTileIndex(nLevel, tx, ty);
+					float16* pTile = &tileData[(size_t)nTile * tileSize * tileSize];
+					for (uint y = 0; y < tileSize; ++y)
+					{
+						uint srcY = std::min(ty * tileSize + y, levelHeight - 1);
+						for (uint x = 0; x < tileSize; ++x)
+						{
+							uint srcX = std::min(tx * tileSize + x, levelWidth - 1);
+							pTile[x + y * tileSize] = rTexels[srcX + srcY * levelWidth];
+						}
+					}
+
+					// Bounds include a one texel apron for bilinear samples that straddle tile edges.
+					float minHeight = FLT_MAX;
+					float maxHeight = -FLT_MAX;
+					uint apronMinX = (tx * tileSize > 0) ? tx * tileSize - 1 : 0;
+					uint apronMinY = (ty * tileSize > 0) ? ty * tileSize - 1 : 0;
+					uint apronMaxX = std::min((tx + 1) * tileSize, levelWidth - 1);
+					uint apronMaxY = std::min((ty + 1) * tileSize, levelHeight - 1);
+					for (uint y = apronMinY; y <= apronMaxY; ++y)
+					{
+						for (uint x = apronMinX; x <= apronMaxX; ++x)
+						{
+							float height = Maths::convertHalfToSinglePrecision(rTexels[x + y * levelWidth]);
+							minHeight = std::min(minHeight, height);
+							maxHeight = std::max(maxHeight, height);
+						}
+					}
+
+					tileBounds[nTile * 2 + 0] = Maths::convertSingleToHalfPrecision(minHeight);
+					tileBounds[nTile * 2 + 1] = Maths::convertSingleToHalfPrecision(maxHeight);
+				}
+			}
+
+			levelWidth = std::max(levelWidth / 2, 1u);
+			levelHeight = std::max(levelHeight / 2, 1u);
+		}
+
+		std::string tilesFilename = dstFilename.substr(0, dstFilename.find_last_of('.') + 1) + rAssetDef.GetExt();
+		std::ofstream dstFile(tilesFilename, std::ios::binary);
+		if (!dstFile.is_open())
+		{
+			Error("Failed to write terrain tiles: %s", tilesFilename.c_str());
+			return false;
+		}
+
+		AssetLib::BinFileHeader header;
+		header.binUID = AssetLib::BinFileHeader::kUID;
+		header.assetUID = rAssetDef.GetAssetUID();
+		header.version = rAssetDef.GetBinVersion();
+		Hashing::SHA1::HashFile(srcFilename.c_str(), header.srcHash);
+		dstFile.write((char*)&header, sizeof(header));
+
+		dstFile.write((char*)&layout, sizeof(layout));
+		dstFile.write((char*)tileBounds.data(), tileBounds.size() * sizeof(float16));
+		dstFile.write((char*)tileData.data(), tileData.size() * sizeof(float16));
+		return true;
+	}
 }
 
 bool TextureImport::Import(const std::string& srcFilename, std::string& dstFilename)
@@ -144,11 +278,30 @@ bool TextureImport::Import(const std::string& srcFilename, std::string& dstFilen
 		break;
 	}
 
+	//////////////////////////////////////////////////////////////////////////
+	// Heightmaps are stored as half floats, both as a texture and as tiles for terrain streaming.
+	DirectX::ScratchImage heightmapImage;
+	if (texType == TextureType::HeightMap)
+	{
+		DirectX::ScratchImage floatImage;
+		hr = DirectX::Convert(*srcImage.GetImage(0, 0, 0), DXGI_FORMAT_R32_FLOAT, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, floatImage);
+		Assert(hr == S_OK);
+
+		if (!writeTerrainTiles(*floatImage.GetImage(0, 0, 0), srcFilename, dstFilename))
+		{
+			delete pImageFileData;
+			return false;
+		}
+
+		hr = DirectX::Convert(*floatImage.GetImage(0, 0, 0), format, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, heightmapImage);
+		Assert(hr == S_OK);
+	}
+
 	//////////////////////////////////////////////////////////////////////////
 	// Generate mipmaps and compress
 	DirectX::ScratchImage mipmapImage;
 	DirectX::ScratchImage compressedImage;
-	DirectX::ScratchImage* pCurrImage = &srcImage;
+	DirectX::ScratchImage* pCurrImage = (texType == TextureType::HeightMap) ? &heightmapImage : &srcImage;
 
 	if (bGenerateMipMaps && srcMetadata.width >= 2 && srcMetadata.height >= 2)
 	{
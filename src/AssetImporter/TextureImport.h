@@ -1,8 +1,12 @@
 #pragma once
 #include <fstream>
 #include <string>
+#include "../Types.h"
 
 namespace TextureImport
 {
+	// Increment when import processing changes without a change to the asset bin version.
+	static const uint kImportVersion = 2;
+
 	bool Import(const std::string& srcFilename, std::string& dstFilename);
 }
@@ -0,0 +1,91 @@
+#include "VertexPacking.h"
+#include "MathLib/Maths.h"
+#include <algorithm>
+
+namespace
+{
+	uint16 quantizeUnorm16(float f)
+	{
+		f = std::max(0.f, std::min(1.f, f));
+		return (uint16)(f * 65535.f + 0.5f);
+	}
+
+	float dequantizeUnorm16(uint16 n)
+	{
+		return n / 65535.f;
+	}
+
+	int16 quantizeSnorm16(float f)
+	{
+		f = std::max(-1.f, std::min(1.f, f));
+		return (int16)(f * 32767.f + (f >= 0.f ? 0.5f : -0.5f));
+	}
+
+	float dequantizeSnorm16(int16 n)
+	{
+		return std::max(n / 32767.f, -1.f);
+	}
+}
+
+Vec2 VertexPacking::OctEncode(const Vec3& n)
+{
+	float fL1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	if (fL1 <= 0.f)
+		return Vec2(0.f, 0.f);
+
+	float fInvL1 = 1.f / fL1;
+	Vec2 e(n.x * fInvL1, n.y * fInvL1);
+	if (n.z < 0.f)
+	{
+		Vec2 folded((1.f - fabsf(e.y)) * (e.x >= 0.f ? 1.f : -1.f), (1.f - fabsf(e.x)) * (e.y >= 0.f ? 1.f : -1.f));
+		e = folded;
+	}
+	return e;
+}
+
+Vec3 VertexPacking::OctDecode(const Vec2& e)
+{
+	Vec3 n(e.x, e.y, 1.f - fabsf(e.x) - fabsf(e.y));
+	float t = std::max(-n.z, 0.f);
+	n.x += (n.x >= 0.f) ? -t : t;
+	n.y += (n.y >= 0.f) ? -t : t;
+	return Vec3Normalize(n);
+}
+
+VertexPacking::PackedPosition VertexPacking::PackPosition(const Vec3& vPos, float fBitangentSign, const PositionQuantization& rQuantization)
+{
+	Vec3 vNormalized = (vPos - rQuantization.vOffset) / rQuantization.vScale;
+	PackedPosition packed;
+	packed.x = quantizeUnorm16(vNormalized.x);
+	packed.y = quantizeUnorm16(vNormalized.y);
+	packed.z = quantizeUnorm16(vNormalized.z);
+	packed.w = (fBitangentSign < 0.f) ? 0 : 0xffff;
+	return packed;
+}
+
+Vec3 VertexPacking::UnpackPosition(const PackedPosition& packed, const PositionQuantization& rQuantization)
+{
+	Vec3 vNormalized(dequantizeUnorm16(packed.x), dequantizeUnorm16(packed.y), dequantizeUnorm16(packed.z));
+	return vNormalized * rQuantization.vScale + rQuantization.vOffset;
+}
+
+VertexPacking::PackedDirection VertexPacking::PackDirection(const Vec3& vDir)
+{
+	Vec2 e = OctEncode(vDir);
+	return PackedDirection{ quantizeSnorm16(e.x), quantizeSnorm16(e.y) };
+}
+
+Vec3 VertexPacking::UnpackDirection(const PackedDirection& packed)
+{
+	return OctDecode(Vec2(dequantizeSnorm16(packed.x), dequantizeSnorm16(packed.y)));
+}
+
+VertexPacking::PackedTexcoord VertexPacking::PackTexcoord(const Vec2& uv)
+{
+	return PackedTexcoord{ Maths::convertSingleToHalfPrecision(uv.x), Maths::convertSingleToHalfPrecision(uv.y) };
+}
+
+Vec2 VertexPacking::UnpackTexcoord(const PackedTexcoord& packed)
+{
+	return Vec2(Maths::convertHalfToSinglePrecision(packed.u), Maths::convertHalfToSinglePrecision(packed.v));
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "../Types.h"
+#include "MathLib/Vec2.h"
+#include "MathLib/Vec3.h"
+
+// Compact vertex formats written for models imported with packed vertices.
+namespace VertexPacking
+{
+	// Positions are stored as unorm16 relative to the model bounds: pos = unorm * vScale + vOffset.
+	struct PositionQuantization
+	{
+		Vec3 vOffset;
+		Vec3 vScale;
+	};
+
+	// xyz is the quantized position; w holds the bitangent sign (0 for negative, 0xffff for positive).
+	struct PackedPosition
+	{
+		uint16 x, y, z, w;
+	};
+
+	// Octahedral encoded unit vector stored as snorm16.
+	struct PackedDirection
+	{
+		int16 x, y;
+	};
+
+	struct PackedTexcoord
+	{
+		float16 u, v;
+	};
+
+	// Octahedral encoding (Meyer et al, "On Floating-Point Normal Vectors").
+	Vec2 OctEncode(const Vec3& n);
+	// Must match octDecode() in v_model.hlsl
+	Vec3 OctDecode(const Vec2& e);
+
+	PackedPosition PackPosition(const Vec3& vPos, float fBitangentSign, const PositionQuantization& rQuantization);
+	Vec3 UnpackPosition(const PackedPosition& packed, const PositionQuantization& rQuantization);
+
+	PackedDirection PackDirection(const Vec3& vDir);
+	Vec3 UnpackDirection(const PackedDirection& packed);
+
+	PackedTexcoord PackTexcoord(const Vec2& uv);
+	Vec2 UnpackTexcoord(const PackedTexcoord& packed);
+}
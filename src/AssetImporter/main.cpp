@@ -1,75 +1,57 @@
 #define NOMINMAX
 #include <Windows.h>
-#include "ModelImport.h"
-#include "TextureImport.h"
+#include "BatchImport.h"
 #include "UtilsLib/Paths.h"
 #include "UtilsLib/Util.h"
 #include "UtilsLib/Error.h"
-#include "AssetLib/AssetDef.h"
-#include "AssetLib/BinFile.h"
-#include "AssetLib/ModelAsset.h"
-#include "AssetLib/TextureAsset.h"
-
-namespace
-{
-	std::string getOutputFilename(const char* filename, const AssetLib::AssetDef& rAssetDef)
-	{
-		char assetName[256];
-		Paths::GetFilenameNoExtension(filename, assetName, ARRAY_SIZE(assetName));
-
-		std::string outFilename = Paths::GetSrcDataDir();
-		outFilename += "/";
-		outFilename += rAssetDef.GetFolder();
-		outFilename += "/";
-		outFilename += assetName;
-		outFilename += ".";
-		outFilename += rAssetDef.GetExt();
-
-		Paths::CreateDirectoryTreeForFile(outFilename);
-
-		return outFilename;
-	}
-}
 
 int main(int argc, char** argv)
 {
 	if (argc <= 1)
 	{
-		printf("Usage: <filename>\n");
+		printf("Usage: <filename> [-packverts] [-compress]\n");
+		printf("       -batch [srcDir] [-force] [-packverts] [-compress]\n");
 		return -1;
 	}
 
+	// Model output options
+	AssetLib::ModelFlags eModelFlags = AssetLib::ModelFlags::None;
+	for (int i = 2; i < argc; ++i)
+	{
+		if (_stricmp(argv[i], "-packverts") == 0)
+			eModelFlags |= AssetLib::ModelFlags::PackedVertices;
+		else if (_stricmp(argv[i], "-compress") == 0)
+			eModelFlags |= AssetLib::ModelFlags::CompressedStreams;
+	}
+
 	// DirectXTex initialization
 	HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
 	AssertMsg(hr == S_OK, "DirectXTex initialization failed!");
 
-	const char* filename = argv[1];
-	const char* ext = Paths::GetExtension(filename);
-
-	if (_stricmp(ext, "obj") == 0)
-	{
-		std::string outFilename = getOutputFilename(filename, AssetLib::Model::GetAssetDef());
-		ModelImport::ImportObj(filename, outFilename);
-	}
-	else if (_stricmp(ext, "fbx") == 0)
+	if (_stricmp(argv[1], "-batch") == 0)
 	{
-		std::string outFilename = getOutputFilename(filename, AssetLib::Model::GetAssetDef());
-		if (!ModelImport::ImportFbx(filename, outFilename))
+		const char* srcDir = Paths::GetSrcDataDir();
+		bool bForceRebuild = false;
+		for (int i = 2; i < argc; ++i)
 		{
-			return -3;
+			if (_stricmp(argv[i], "-force") == 0)
+				bForceRebuild = true;
+			else if (argv[i][0] != '-')
+				srcDir = argv[i];
 		}
+
+		return BatchImport::ImportAll(srcDir, eModelFlags, bForceRebuild) ? 0 : -4;
 	}
-	else if (_stricmp(ext, "tga") == 0 || _stricmp(ext, "tif") == 0 || _stricmp(ext, "dds") == 0)
-	{
-		std::string outFilename = getOutputFilename(filename, AssetLib::Texture::GetAssetDef());
-		TextureImport::Import(filename, outFilename);
-	}
-	else
+
+	const char* filename = argv[1];
+	switch (BatchImport::ImportFile(filename, eModelFlags))
 	{
-		printf("Unknown file type: %s\n", filename);
+	case BatchImport::ImportResult::Success:
+		return 0;
+	case BatchImport::ImportResult::UnknownFileType:
 		return -2;
+	case BatchImport::ImportResult::Failed:
+	default:
+		return -3;
 	}
-
-
-	return 0;
 }
@@ -1,12 +1,322 @@
 #include "ModelAsset.h"
+#include "ModelBvh.h"
+#include "StreamCodec.h"
+#include "MathLib/Maths.h"
 #include "UtilsLib/Error.h"
 #include "UtilsLib/Util.h"
 
 using namespace AssetLib;
 
+namespace
+{
+	// Version 3 models predate packed vertices, compressed streams, LODs, clusters, and BVHs.
+	// The committed data was built with it, so they are still loaded and converted to the current layout.
+	const int kLegacyBinVersion = 3;
+
+	struct LegacySubObject
+	{
+		char strMaterialName[AssetDef::kMaxNameLen];
+		Vec3 vBoundsMin;
+		Vec3 vBoundsMax;
+		uint nIndexStartByteOffset;
+		uint nIndexCount;
+		RdrIndexBufferFormat eIndexFormat;
+		uint nVertexStartByteOffset;
+		uint nVertexCount;
+		uint nVertexStride;
+		uint nInputElementStart;
+		uint nInputElementCount;
+	};
+
+	struct LegacyModel
+	{
+		Vec3 vBoundsMin;
+		Vec3 vBoundsMax;
+		uint nSubObjectCount;
+		uint nTotalInputElementCount;
+		uint nTotalIndexCount;
+		uint nTotalVertCount;
+		uint nIndexBufferSize;
+		uint nVertexBufferSize;
+
+		BinDataPtr<LegacySubObject> subobjects;
+		BinDataPtr<RdrVertexInputElement> inputElements;
+		BinDataPtr<Vec3> positions;
+		BinDataPtr<uint8> vertexBuffer;
+		BinDataPtr<uint8> indexBuffer;
+
+		uint nTimeLastModified;
+		const char* assetName;
+	};
+
+	// True if [offset, offset + size) lies within [0, limit).
+	bool isRangeValid(uint64 offset, uint64 size, uint64 limit)
+	{
+		return offset <= limit && size <= limit - offset;
+	}
+
+	// Checks that the ranges the streams decompress into and read from are within the buffers they refer to.
+	// The file could be stale or corrupt, so nothing in it can be trusted before decoding.
+	bool validateCompressedModel(const Model& rModel, const Model::SubObject* pSubObjects, const Model::SubObjectLod* pLods)
+	{
+		for (uint i = 0; i < rModel.nSubObjectCount; ++i)
+		{
+			const Model::SubObject& rSubObject = pSubObjects[i];
+			if (rSubObject.eIndexFormat != RdrIndexBufferFormat::R16_UINT && rSubObject.eIndexFormat != RdrIndexBufferFormat::R32_UINT)
+				return false;
+
+			if (!isRangeValid(rSubObject.nLodStart, rSubObject.nLodCount, rModel.nTotalLodCount))
+				return false;
+
+			uint64 nIndexSize = rdrGetIndexBufferFormatSize(rSubObject.eIndexFormat);
+			uint64 nIndexCount = rSubObject.nIndexCount;
+			for (uint n = 0; n < rSubObject.nLodCount; ++n)
+			{
+				const Model::SubObjectLod& rLod = pLods[rSubObject.nLodStart + n];
+				if (!isRangeValid(rLod.nIndexStartByteOffset, rLod.nIndexCount * nIndexSize, rModel.nIndexBufferSize))
+					return false;
+
+				nIndexCount += rLod.nIndexCount;
+			}
+
+			if (!isRangeValid(rSubObject.nVertexStartByteOffset, (uint64)rSubObject.nVertexCount * rSubObject.nVertexStride, rModel.nVertexBufferSize)
+				|| !isRangeValid(rSubObject.nIndexStartByteOffset, nIndexCount * nIndexSize, rModel.nIndexBufferSize)
+				|| !isRangeValid(rSubObject.nCompressedVertexByteOffset, rSubObject.nCompressedVertexByteSize, rModel.nCompressedDataSize)
+				|| !isRangeValid(rSubObject.nCompressedIndexByteOffset, rSubObject.nCompressedIndexByteSize, rModel.nCompressedDataSize))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Replaces the compressed file data with a buffer containing the decompressed vertex and index buffers.
+	// The returned buffer has the same layout as an uncompressed model file.
+	char* decompressModelStreams(char* pFileData, uint fileSize, const char* assetName)
+	{
+		const Model* pSrcModel = (const Model*)(pFileData + sizeof(BinFileHeader));
+		const char* pSrcDataMem = pFileData + sizeof(BinFileHeader) + sizeof(Model);
+		uint nDataMemSize = fileSize - sizeof(BinFileHeader) - sizeof(Model);
+
+		// Everything preceding the vertex buffer is stored uncompressed, and the index buffer immediately follows the vertex buffer.
+		uint nPrefixDataSize = pSrcModel->vertexBuffer.offset;
+		if (!isRangeValid(0, nPrefixDataSize, nDataMemSize)
+			|| !isRangeValid(pSrcModel->subobjects.offset, (uint64)pSrcModel->nSubObjectCount * sizeof(Model::SubObject), nPrefixDataSize)
+			|| !isRangeValid(pSrcModel->lods.offset, (uint64)pSrcModel->nTotalLodCount * sizeof(Model::SubObjectLod), nPrefixDataSize)
+			|| !isRangeValid(pSrcModel->compressedData.offset, pSrcModel->nCompressedDataSize, nDataMemSize)
+			|| pSrcModel->indexBuffer.offset != (uint64)pSrcModel->vertexBuffer.offset + pSrcModel->nVertexBufferSize
+			|| (uint64)nPrefixDataSize + pSrcModel->nVertexBufferSize + pSrcModel->nIndexBufferSize > 0xffffffffull - sizeof(BinFileHeader) - sizeof(Model))
+		{
+			Error("Invalid compressed model layout: %s", assetName);
+			delete[] pFileData;
+			return nullptr;
+		}
+
+		const uint8* pCompressedData = (const uint8*)(pSrcDataMem + pSrcModel->compressedData.offset);
+		const Model::SubObject* pSubObjects = (const Model::SubObject*)(pSrcDataMem + pSrcModel->subobjects.offset);
+		const Model::SubObjectLod* pLods = (const Model::SubObjectLod*)(pSrcDataMem + pSrcModel->lods.offset);
+
+		if (!validateCompressedModel(*pSrcModel, pSubObjects, pLods))
+		{
+			Error("Invalid compressed model stream ranges: %s", assetName);
+			delete[] pFileData;
+			return nullptr;
+		}
+
+		uint nPrefixSize = sizeof(BinFileHeader) + sizeof(Model) + nPrefixDataSize;
+		uint nDecompressedSize = nPrefixSize + pSrcModel->nVertexBufferSize + pSrcModel->nIndexBufferSize;
+
+		char* pDecompressed = new char[nDecompressedSize];
+		std::copy(pFileData, pFileData + nPrefixSize, pDecompressed);
+
+		uint8* pVertexData = (uint8*)pDecompressed + nPrefixSize;
+		uint8* pIndexData = pVertexData + pSrcModel->nVertexBufferSize;
+
+		for (uint i = 0; i < pSrcModel->nSubObjectCount; ++i)
+		{
+			const Model::SubObject& rSubObject = pSubObjects[i];
+
+			// LOD indices are compressed in the same stream as the subobject's indices.
+			uint nIndexCount = rSubObject.nIndexCount;
+			for (uint n = 0; n < rSubObject.nLodCount; ++n)
+			{
+				nIndexCount += pLods[rSubObject.nLodStart + n].nIndexCount;
+			}
+
+			bool bVertsValid = StreamCodec::Decode(pCompressedData + rSubObject.nCompressedVertexByteOffset, rSubObject.nCompressedVertexByteSize,
+				rSubObject.nVertexCount, rSubObject.nVertexStride, pVertexData + rSubObject.nVertexStartByteOffset);
+			bool bIndicesValid = StreamCodec::Decode(pCompressedData + rSubObject.nCompressedIndexByteOffset, rSubObject.nCompressedIndexByteSize,
+				nIndexCount, rdrGetIndexBufferFormatSize(rSubObject.eIndexFormat), pIndexData + rSubObject.nIndexStartByteOffset);
+
+			if (!bVertsValid || !bIndicesValid)
+			{
+				Error("Failed to decompress model streams: %s", assetName);
+				delete[] pDecompressed;
+				delete[] pFileData;
+				return nullptr;
+			}
+		}
+
+		delete[] pFileData;
+		return pDecompressed;
+	}
+
+	// Replaces version 3 file data with a buffer in the current uncompressed layout.
+	// Legacy models have no LODs or clusters, and their BVH is built here since the importer didn't write one.
+	// Their model bounds are also rebuilt from the subobject bounds, which the old importer calculated correctly.
+	char* upgradeLegacyModel(char* pFileData, uint fileSize, const char* assetName)
+	{
+		if (fileSize < sizeof(BinFileHeader) + sizeof(LegacyModel))
+		{
+			Error("Model asset is truncated: %s", assetName);
+			delete[] pFileData;
+			return nullptr;
+		}
+
+		const LegacyModel* pSrcModel = (const LegacyModel*)(pFileData + sizeof(BinFileHeader));
+		const char* pSrcDataMem = pFileData + sizeof(BinFileHeader) + sizeof(LegacyModel);
+		uint nDataMemSize = fileSize - sizeof(BinFileHeader) - sizeof(LegacyModel);
+
+		bool bValid = isRangeValid(pSrcModel->subobjects.offset, (uint64)pSrcModel->nSubObjectCount * sizeof(LegacySubObject), nDataMemSize)
+			&& isRangeValid(pSrcModel->inputElements.offset, (uint64)pSrcModel->nTotalInputElementCount * sizeof(RdrVertexInputElement), nDataMemSize)
+			&& isRangeValid(pSrcModel->positions.offset, (uint64)pSrcModel->nTotalVertCount * sizeof(Vec3), nDataMemSize)
+			&& isRangeValid(pSrcModel->vertexBuffer.offset, pSrcModel->nVertexBufferSize, nDataMemSize)
+			&& isRangeValid(pSrcModel->indexBuffer.offset, pSrcModel->nIndexBufferSize, nDataMemSize);
+
+		const LegacySubObject* pSrcSubObjects = (const LegacySubObject*)(pSrcDataMem + pSrcModel->subobjects.offset);
+		const Vec3* pSrcPositions = (const Vec3*)(pSrcDataMem + pSrcModel->positions.offset);
+		const uint8* pSrcIndices = (const uint8*)(pSrcDataMem + pSrcModel->indexBuffer.offset);
+
+		// Positions are stored per subobject in order, and BVH triangles index into all of them.
+		std::vector<Model::BvhTriangle> triangles;
+		uint nPositionStart = 0;
+		for (uint i = 0; bValid && i < pSrcModel->nSubObjectCount; ++i)
+		{
+			const LegacySubObject& rSubObject = pSrcSubObjects[i];
+			bValid = (rSubObject.eIndexFormat == RdrIndexBufferFormat::R16_UINT || rSubObject.eIndexFormat == RdrIndexBufferFormat::R32_UINT)
+				&& isRangeValid(rSubObject.nInputElementStart, rSubObject.nInputElementCount, pSrcModel->nTotalInputElementCount)
+				&& isRangeValid(nPositionStart, rSubObject.nVertexCount, pSrcModel->nTotalVertCount)
+				&& isRangeValid(rSubObject.nVertexStartByteOffset, (uint64)rSubObject.nVertexCount * rSubObject.nVertexStride, pSrcModel->nVertexBufferSize)
+				&& isRangeValid(rSubObject.nIndexStartByteOffset, (uint64)rSubObject.nIndexCount * rdrGetIndexBufferFormatSize(rSubObject.eIndexFormat), pSrcModel->nIndexBufferSize);
+
+			for (uint n = 0; bValid && n + 2 < rSubObject.nIndexCount; n += 3)
+			{
+				Model::BvhTriangle tri;
+				for (uint k = 0; k < 3; ++k)
+				{
+					const uint8* pIndex = pSrcIndices + rSubObject.nIndexStartByteOffset + (uint64)(n + k) * rdrGetIndexBufferFormatSize(rSubObject.eIndexFormat);
+					uint nIndex = (rSubObject.eIndexFormat == RdrIndexBufferFormat::R16_UINT) ? *(const uint16*)pIndex : *(const uint*)pIndex;
+					bValid = bValid && nIndex < rSubObject.nVertexCount;
+					tri.anPositions[k] = nPositionStart + nIndex;
+				}
+				triangles.push_back(tri);
+			}
+
+			nPositionStart += rSubObject.nVertexCount;
+		}
+
+		if (!bValid)
+		{
+			Error("Invalid legacy model layout: %s", assetName);
+			delete[] pFileData;
+			return nullptr;
+		}
+
+		std::vector<Model::BvhNode> bvhNodes;
+		std::vector<Model::BvhTriangle> bvhTriangles;
+		if (!triangles.empty())
+		{
+			ModelBvh::Build(triangles, pSrcPositions, bvhNodes, bvhTriangles);
+		}
+
+		Model model = {};
+		model.eFlags = ModelFlags::None;
+		model.nSubObjectCount = pSrcModel->nSubObjectCount;
+		model.nTotalInputElementCount = pSrcModel->nTotalInputElementCount;
+		model.nBvhNodeCount = (uint)bvhNodes.size();
+		model.nBvhTriangleCount = (uint)bvhTriangles.size();
+		model.nTotalIndexCount = pSrcModel->nTotalIndexCount;
+		model.nTotalVertCount = pSrcModel->nTotalVertCount;
+		model.nIndexBufferSize = pSrcModel->nIndexBufferSize;
+		model.nVertexBufferSize = pSrcModel->nVertexBufferSize;
+		model.nTimeLastModified = pSrcModel->nTimeLastModified;
+
+		model.subobjects.offset = 0;
+		model.inputElements.offset = model.subobjects.offset + model.subobjects.CalcSize(model.nSubObjectCount);
+		model.lods.offset = model.inputElements.offset + model.inputElements.CalcSize(model.nTotalInputElementCount);
+		model.clusters.offset = model.lods.offset;
+		model.bvhNodes.offset = model.clusters.offset;
+		model.bvhTriangles.offset = model.bvhNodes.offset + model.bvhNodes.CalcSize(model.nBvhNodeCount);
+		model.positions.offset = model.bvhTriangles.offset + model.bvhTriangles.CalcSize(model.nBvhTriangleCount);
+		model.vertexBuffer.offset = model.positions.offset + model.positions.CalcSize(model.nTotalVertCount);
+		model.indexBuffer.offset = model.vertexBuffer.offset + model.nVertexBufferSize;
+		model.compressedData.offset = model.vertexBuffer.offset;
+
+		uint64 nUpgradedSize = (uint64)sizeof(BinFileHeader) + sizeof(Model) + model.indexBuffer.offset + model.nIndexBufferSize;
+		if (nUpgradedSize > 0xffffffffull)
+		{
+			Error("Invalid legacy model layout: %s", assetName);
+			delete[] pFileData;
+			return nullptr;
+		}
+
+		char* pUpgraded = new char[(uint)nUpgradedSize];
+		BinFileHeader* pHeader = (BinFileHeader*)pUpgraded;
+		*pHeader = *(const BinFileHeader*)pFileData;
+		pHeader->version = Model::GetAssetDef().GetBinVersion();
+
+		char* pDataMem = pUpgraded + sizeof(BinFileHeader) + sizeof(Model);
+		model.vBoundsMin = Vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+		model.vBoundsMax = Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		Model::SubObject* pSubObjects = (Model::SubObject*)(pDataMem + model.subobjects.offset);
+		for (uint i = 0; i < model.nSubObjectCount; ++i)
+		{
+			const LegacySubObject& rSrcSubObject = pSrcSubObjects[i];
+			Model::SubObject subobject = {};
+			std::copy(rSrcSubObject.strMaterialName, rSrcSubObject.strMaterialName + AssetDef::kMaxNameLen, subobject.strMaterialName);
+			subobject.strMaterialName[AssetDef::kMaxNameLen - 1] = 0;
+			subobject.vBoundsMin = rSrcSubObject.vBoundsMin;
+			subobject.vBoundsMax = rSrcSubObject.vBoundsMax;
+			subobject.nIndexStartByteOffset = rSrcSubObject.nIndexStartByteOffset;
+			subobject.nIndexCount = rSrcSubObject.nIndexCount;
+			subobject.eIndexFormat = rSrcSubObject.eIndexFormat;
+			subobject.nVertexStartByteOffset = rSrcSubObject.nVertexStartByteOffset;
+			subobject.nVertexCount = rSrcSubObject.nVertexCount;
+			subobject.nVertexStride = rSrcSubObject.nVertexStride;
+			subobject.nInputElementStart = rSrcSubObject.nInputElementStart;
+			subobject.nInputElementCount = rSrcSubObject.nInputElementCount;
+			pSubObjects[i] = subobject;
+
+			model.vBoundsMin = Vec3Min(model.vBoundsMin, subobject.vBoundsMin);
+			model.vBoundsMax = Vec3Max(model.vBoundsMax, subobject.vBoundsMax);
+		}
+
+		if (model.nSubObjectCount == 0)
+		{
+			model.vBoundsMin = Vec3::kZero;
+			model.vBoundsMax = Vec3::kZero;
+		}
+		*(Model*)(pUpgraded + sizeof(BinFileHeader)) = model;
+
+		const char* pSrcInputElements = pSrcDataMem + pSrcModel->inputElements.offset;
+		std::copy(pSrcInputElements, pSrcInputElements + model.inputElements.CalcSize(model.nTotalInputElementCount), pDataMem + model.inputElements.offset);
+		std::copy(bvhNodes.begin(), bvhNodes.end(), (Model::BvhNode*)(pDataMem + model.bvhNodes.offset));
+		std::copy(bvhTriangles.begin(), bvhTriangles.end(), (Model::BvhTriangle*)(pDataMem + model.bvhTriangles.offset));
+		std::copy(pSrcPositions, pSrcPositions + model.nTotalVertCount, (Vec3*)(pDataMem + model.positions.offset));
+
+		const char* pSrcVertices = pSrcDataMem + pSrcModel->vertexBuffer.offset;
+		std::copy(pSrcVertices, pSrcVertices + model.nVertexBufferSize, pDataMem + model.vertexBuffer.offset);
+		std::copy((const char*)pSrcIndices, (const char*)pSrcIndices + model.nIndexBufferSize, pDataMem + model.indexBuffer.offset);
+
+		delete[] pFileData;
+		return pUpgraded;
+	}
+}
+
 AssetDef& Model::GetAssetDef()
 {
-	static AssetLib::AssetDef s_assetDef("geo", "model", 3);
+	static AssetLib::AssetDef s_assetDef("geo", "model", 7);
 	return s_assetDef;
 }
 
@@ -23,6 +333,13 @@ Model* Model::Load(const CachedString& assetName, Model* pModel)
 		return pModel;
 	}
 
+	if (fileSize < sizeof(BinFileHeader))
+	{
+		Error("Model asset is truncated: %s", assetName.getString());
+		delete[] pFileData;
+		return pModel;
+	}
+
 	BinFileHeader* pHeader = (BinFileHeader*)pFileData;
 	if (pHeader->binUID != BinFileHeader::kUID)
 	{
@@ -32,16 +349,43 @@ Model* Model::Load(const CachedString& assetName, Model* pModel)
 
 	Assert(pHeader->assetUID == GetAssetDef().GetAssetUID());
 
+	if (pHeader->version == kLegacyBinVersion)
+	{
+		pFileData = upgradeLegacyModel(pFileData, fileSize, assetName.getString());
+		if (!pFileData)
+			return nullptr;
+
+		pHeader = (BinFileHeader*)pFileData;
+	}
+	else if (pHeader->version == GetAssetDef().GetBinVersion() && fileSize < sizeof(BinFileHeader) + sizeof(Model))
+	{
+		Error("Model asset is truncated: %s", assetName.getString());
+		delete[] pFileData;
+		return pModel;
+	}
+
 	if (pHeader->version == GetAssetDef().GetBinVersion())
 	{
+		if (IsFlagSet(((Model*)(pFileData + sizeof(BinFileHeader)))->eFlags, ModelFlags::CompressedStreams))
+		{
+			pFileData = decompressModelStreams(pFileData, fileSize, assetName.getString());
+			if (!pFileData)
+				return nullptr;
+		}
+
 		pModel = (Model*)(pFileData + sizeof(BinFileHeader));
 		char* pDataMem = pFileData + sizeof(BinFileHeader) + sizeof(Model);
 
 		pModel->subobjects.PatchPointer(pDataMem);
 		pModel->inputElements.PatchPointer(pDataMem);
+		pModel->lods.PatchPointer(pDataMem);
+		pModel->clusters.PatchPointer(pDataMem);
+		pModel->bvhNodes.PatchPointer(pDataMem);
+		pModel->bvhTriangles.PatchPointer(pDataMem);
 		pModel->positions.PatchPointer(pDataMem);
 		pModel->vertexBuffer.PatchPointer(pDataMem);
 		pModel->indexBuffer.PatchPointer(pDataMem);
+		pModel->compressedData.ptr = nullptr;
 		pModel->assetName = assetName.getString();
 	}
 	else
@@ -52,3 +396,20 @@ Model* Model::Load(const CachedString& assetName, Model* pModel)
 	
 	return pModel;
 }
+
+Vec3 Model::GetPositionDequantScale() const
+{
+	if (!IsFlagSet(eFlags, ModelFlags::PackedVertices))
+		return Vec3::kOne;
+
+	// Must match the quantization in the importer.
+	return Vec3Max(vBoundsMax - vBoundsMin, Vec3(FLT_MIN, FLT_MIN, FLT_MIN));
+}
+
+Vec3 Model::GetPositionDequantOffset() const
+{
+	if (!IsFlagSet(eFlags, ModelFlags::PackedVertices))
+		return Vec3::kZero;
+
+	return vBoundsMin;
+}
@@ -38,6 +38,9 @@ enum class RdrVertexInputFormat
 	RGB_F32,
 	RGBA_F32,
 	RGBA_U8,
+	RG_F16,
+	RG_S16_SNORM,
+	RGBA_U16_UNORM,
 
 	Count
 };
@@ -64,11 +67,75 @@ struct RdrVertexInputElement
 
 namespace AssetLib
 {
+	enum class ModelFlags : uint
+	{
+		None = 0x0,
+		// Positions are 16-bit unorms relative to the model bounds with the bitangent sign in w.
+		// Normals and tangents are octahedral encoded snorms and texcoords are half floats.
+		PackedVertices = 0x1,
+		// Vertex and index buffers are stored with StreamCodec and decompressed on load.
+		CompressedStreams = 0x2,
+	};
+	ENUM_FLAGS(ModelFlags);
+
 	struct Model
 	{
 		static AssetDef& GetAssetDef();
 		static Model* Load(const CachedString& assetName, Model* pModel);
 
+		// Max detail levels per subobject, including the full detail geometry.
+		static constexpr uint kMaxLods = 4;
+
+		// LOD errors are measured at a few points per triangle, so the deviation between those points can be slightly larger.
+		// Selection scales the errors by this margin before comparing them against the allowed error.
+		static constexpr float kLodErrorMargin = 1.5f;
+
+		// Simplified index range that draws from the same vertices as its subobject.
+		struct SubObjectLod
+		{
+			uint nIndexStartByteOffset;
+			uint nIndexCount;
+			// Largest object space distance between the LOD and the full detail surfaces, measured at the vertices,
+			// edge midpoints and centers of the triangles of both.
+			float fError;
+		};
+
+		// Contiguous range of the subobject's full detail triangles with bounds for CPU culling.
+		struct SubObjectCluster
+		{
+			// Relative to the subobject's first index.
+			uint nIndexStart;
+			uint nIndexCount;
+
+			Vec3 vCenter;
+			float fRadius;
+
+			// Normal cone.  The cluster is entirely back-facing from p when
+			// dot(vCenter - p, vConeAxis) >= fConeCutoff * length(vCenter - p) + fRadius.
+			// A cutoff of 1 means the cluster can't be back-face culled.
+			Vec3 vConeAxis;
+			float fConeCutoff;
+		};
+
+		// Node of the triangle BVH used for ray queries.  Children of an interior node are the next node and nSecondChild.
+		struct BvhNode
+		{
+			Vec3 vBoundsMin;
+			union
+			{
+				uint nFirstTriangle; // Leaf nodes
+				uint nSecondChild; // Interior nodes
+			};
+			Vec3 vBoundsMax;
+			uint nTriangleCount; // 0 for interior nodes.
+		};
+
+		// Full detail triangle, indexing into the model's positions.
+		struct BvhTriangle
+		{
+			uint anPositions[3];
+		};
+
 		struct SubObject
 		{
 			char strMaterialName[AssetDef::kMaxNameLen];
@@ -82,22 +149,53 @@ namespace AssetLib
 			uint nVertexStride;
 			uint nInputElementStart;
 			uint nInputElementCount;
+
+			// Simplified LODs, ordered from most to least detailed.  Their indices follow the subobject's indices.
+			uint nLodStart;
+			uint nLodCount;
+
+			// Clusters partitioning the full detail indices, in index order.
+			uint nClusterStart;
+			uint nClusterCount;
+
+			// Byte ranges within compressedData.  Only valid with ModelFlags::CompressedStreams.
+			uint nCompressedVertexByteOffset;
+			uint nCompressedVertexByteSize;
+			uint nCompressedIndexByteOffset;
+			uint nCompressedIndexByteSize;
 		};
 
+		// Scale and offset to convert packed vertex positions back to model space.
+		Vec3 GetPositionDequantScale() const;
+		Vec3 GetPositionDequantOffset() const;
+
 		Vec3 vBoundsMin;
 		Vec3 vBoundsMax;
+		ModelFlags eFlags;
 		uint nSubObjectCount;
 		uint nTotalInputElementCount;
+		uint nTotalLodCount;
+		uint nTotalClusterCount;
+		uint nBvhNodeCount;
+		uint nBvhTriangleCount;
 		uint nTotalIndexCount;
 		uint nTotalVertCount;
 		uint nIndexBufferSize;
 		uint nVertexBufferSize;
+		uint nCompressedDataSize;
 
 		BinDataPtr<SubObject> subobjects;
 		BinDataPtr<RdrVertexInputElement> inputElements;
+		BinDataPtr<SubObjectLod> lods;
+		BinDataPtr<SubObjectCluster> clusters;
+		BinDataPtr<BvhNode> bvhNodes;
+		BinDataPtr<BvhTriangle> bvhTriangles;
 		BinDataPtr<Vec3> positions;
 		BinDataPtr<uint8> vertexBuffer;
 		BinDataPtr<uint8> indexBuffer;
+		// When streams are compressed, the vertex and index buffers are not stored in the file.
+		// Their offsets describe where they are placed when decompressed on load.
+		BinDataPtr<uint8> compressedData;
 
 		uint nTimeLastModified;
 		const char* assetName;
@@ -0,0 +1,554 @@
+#include "ModelBvh.h"
+#include "MathLib/Maths.h"
+#include <algorithm>
+#include <xmmintrin.h>
+
+using namespace AssetLib;
+
+namespace
+{
+	static const uint kNumSahBins = 16;
+	static const uint kMaxLeafTriangles = 8;
+	// Relative costs of a traversal step and a triangle test.
+	static const float kTraversalCost = 1.f;
+	static const float kTriangleCost = 1.f;
+	static const uint kMaxTraversalDepth = 64;
+	// Past this depth ranges are split in half so the tree always fits within the traversal stack.
+	static const uint kMaxSahDepth = 32;
+
+	struct Aabb
+	{
+		Vec3 vMin;
+		Vec3 vMax;
+
+		Aabb()
+			: vMin(FLT_MAX, FLT_MAX, FLT_MAX), vMax(-FLT_MAX, -FLT_MAX, -FLT_MAX) {}
+
+		void Grow(const Vec3& vPos)
+		{
+			vMin = Vec3Min(vMin, vPos);
+			vMax = Vec3Max(vMax, vPos);
+		}
+
+		void Grow(const Aabb& rOther)
+		{
+			vMin = Vec3Min(vMin, rOther.vMin);
+			vMax = Vec3Max(vMax, rOther.vMax);
+		}
+
+		float SurfaceArea() const
+		{
+			if (vMin.x > vMax.x)
+				return 0.f;
+
+			Vec3 vSize = vMax - vMin;
+			return 2.f * (vSize.x * vSize.y + vSize.y * vSize.z + vSize.z * vSize.x);
+		}
+	};
+
+	struct BuildItem
+	{
+		Aabb bounds;
+		Vec3 vCentroid;
+		uint nSrcIndex;
+	};
+
+	float getAxis(const Vec3& v, uint nAxis)
+	{
+		return (nAxis == 0) ? v.x : ((nAxis == 1) ? v.y : v.z);
+	}
+
+	class BvhBuilder
+	{
+	public:
+		BvhBuilder(std::vector<BuildItem>& rItems, std::vector<Model::BvhNode>& rOutNodes)
+			: m_rItems(rItems), m_rNodes(rOutNodes) {}
+
+		void BuildNode(uint nStart, uint nCount, uint nDepth)
+		{
+			uint nNodeIndex = (uint)m_rNodes.size();
+			m_rNodes.emplace_back();
+
+			Aabb bounds;
+			Aabb centroidBounds;
+			for (uint i = nStart; i < nStart + nCount; ++i)
+			{
+				bounds.Grow(m_rItems[i].bounds);
+				centroidBounds.Grow(m_rItems[i].vCentroid);
+			}
+
+			m_rNodes[nNodeIndex].vBoundsMin = bounds.vMin;
+			m_rNodes[nNodeIndex].vBoundsMax = bounds.vMax;
+
+			uint nSplit;
+			if (nCount <= 1)
+			{
+				nSplit = nStart;
+			}
+			else if (nDepth >= kMaxSahDepth)
+			{
+				nSplit = (nCount <= kMaxLeafTriangles) ? nStart : (nStart + nCount / 2);
+			}
+			else
+			{
+				nSplit = FindSplit(nStart, nCount, bounds, centroidBounds);
+			}
+
+			if (nSplit == nStart)
+			{
+				m_rNodes[nNodeIndex].nFirstTriangle = nStart;
+				m_rNodes[nNodeIndex].nTriangleCount = nCount;
+				return;
+			}
+
+			// First child immediately follows its parent.
+			BuildNode(nStart, nSplit - nStart, nDepth + 1);
+			m_rNodes[nNodeIndex].nSecondChild = (uint)m_rNodes.size();
+			m_rNodes[nNodeIndex].nTriangleCount = 0;
+			BuildNode(nSplit, nStart + nCount - nSplit, nDepth + 1);
+		}
+
+	private:
+		// Partitions the triangles and returns the first triangle of the second child, or nStart to make a leaf.
+		uint FindSplit(uint nStart, uint nCount, const Aabb& bounds, const Aabb& centroidBounds)
+		{
+			float fBestCost = FLT_MAX;
+			uint nBestAxis = 0;
+			uint nBestBin = 0;
+
+			for (uint nAxis = 0; nAxis < 3; ++nAxis)
+			{
+				float fMin = getAxis(centroidBounds.vMin, nAxis);
+				float fExtent = getAxis(centroidBounds.vMax, nAxis) - fMin;
+				if (fExtent <= 0.f)
+					continue;
+
+				Aabb binBounds[kNumSahBins];
+				uint binCounts[kNumSahBins] = { 0 };
+				for (uint i = nStart; i < nStart + nCount; ++i)
+				{
+					uint nBin = CalcBin(m_rItems[i].vCentroid, nAxis, fMin, fExtent);
+					binBounds[nBin].Grow(m_rItems[i].bounds);
+					++binCounts[nBin];
+				}
+
+				// Sweep from the right to get the cost of everything above each split plane.
+				float rightAreas[kNumSahBins];
+				uint rightCounts[kNumSahBins];
+				Aabb rightBounds;
+				uint nRightCount = 0;
+				for (uint nBin = kNumSahBins - 1; nBin > 0; --nBin)
+				{
+					rightBounds.Grow(binBounds[nBin]);
+					nRightCount += binCounts[nBin];
+					rightAreas[nBin] = rightBounds.SurfaceArea();
+					rightCounts[nBin] = nRightCount;
+				}
+
+				Aabb leftBounds;
+				uint nLeftCount = 0;
+				for (uint nBin = 1; nBin < kNumSahBins; ++nBin)
+				{
+					leftBounds.Grow(binBounds[nBin - 1]);
+					nLeftCount += binCounts[nBin - 1];
+					if (nLeftCount == 0 || rightCounts[nBin] == 0)
+						continue;
+
+					float fCost = leftBounds.SurfaceArea() * nLeftCount + rightAreas[nBin] * rightCounts[nBin];
+					if (fCost < fBestCost)
+					{
+						fBestCost = fCost;
+						nBestAxis = nAxis;
+						nBestBin = nBin;
+					}
+				}
+			}
+
+			float fParentArea = bounds.SurfaceArea();
+			float fLeafCost = kTriangleCost * nCount;
+			float fSplitCost = (fParentArea > 0.f) ? (kTraversalCost + kTriangleCost * fBestCost / fParentArea) : FLT_MAX;
+
+			if (fBestCost == FLT_MAX || (fSplitCost >= fLeafCost && nCount <= kMaxLeafTriangles))
+			{
+				if (nCount <= kMaxLeafTriangles)
+					return nStart;
+
+				// No useful split plane, usually because all centroids coincide.  Split the range in half to bound leaf size.
+				return nStart + nCount / 2;
+			}
+
+			float fMin = getAxis(centroidBounds.vMin, nBestAxis);
+			float fExtent = getAxis(centroidBounds.vMax, nBestAxis) - fMin;
+			BuildItem* pMid = std::partition(m_rItems.data() + nStart, m_rItems.data() + nStart + nCount,
+				[&](const BuildItem& rTri) { return CalcBin(rTri.vCentroid, nBestAxis, fMin, fExtent) < nBestBin; });
+
+			return (uint)(pMid - m_rItems.data());
+		}
+
+		static uint CalcBin(const Vec3& vCentroid, uint nAxis, float fMin, float fExtent)
+		{
+			uint nBin = (uint)((getAxis(vCentroid, nAxis) - fMin) / fExtent * kNumSahBins);
+			return std::min(nBin, kNumSahBins - 1);
+		}
+
+	private:
+		std::vector<BuildItem>& m_rItems;
+		std::vector<Model::BvhNode>& m_rNodes;
+	};
+
+	// Slab test.  Returns the entry distance, or FLT_MAX on a miss.
+	float rayAabbIntersect(const Vec3& rayOrigin, const Vec3& invRayDir, const Vec3& vMin, const Vec3& vMax, float fMaxT)
+	{
+		float tx1 = (vMin.x - rayOrigin.x) * invRayDir.x;
+		float tx2 = (vMax.x - rayOrigin.x) * invRayDir.x;
+		float tMin = std::min(tx1, tx2);
+		float tMax = std::max(tx1, tx2);
+
+		float ty1 = (vMin.y - rayOrigin.y) * invRayDir.y;
+		float ty2 = (vMax.y - rayOrigin.y) * invRayDir.y;
+		tMin = std::max(tMin, std::min(ty1, ty2));
+		tMax = std::min(tMax, std::max(ty1, ty2));
+
+		float tz1 = (vMin.z - rayOrigin.z) * invRayDir.z;
+		float tz2 = (vMax.z - rayOrigin.z) * invRayDir.z;
+		tMin = std::max(tMin, std::min(tz1, tz2));
+		tMax = std::min(tMax, std::max(tz1, tz2));
+
+		return (tMax >= tMin && tMax > 0.f && tMin < fMaxT) ? tMin : FLT_MAX;
+	}
+}
+
+void ModelBvh::Build(const std::vector<Model::BvhTriangle>& triangles, const Vec3* aPositions,
+	std::vector<Model::BvhNode>& rOutNodes, std::vector<Model::BvhTriangle>& rOutTriangles)
+{
+	std::vector<Vec3> mins(triangles.size());
+	std::vector<Vec3> maxs(triangles.size());
+	for (uint i = 0; i < (uint)triangles.size(); ++i)
+	{
+		const Model::BvhTriangle& rTri = triangles[i];
+		mins[i] = Vec3Min(aPositions[rTri.anPositions[0]], Vec3Min(aPositions[rTri.anPositions[1]], aPositions[rTri.anPositions[2]]));
+		maxs[i] = Vec3Max(aPositions[rTri.anPositions[0]], Vec3Max(aPositions[rTri.anPositions[1]], aPositions[rTri.anPositions[2]]));
+	}
+
+	std::vector<uint> order;
+	BuildFromBounds(mins.data(), maxs.data(), (uint)triangles.size(), rOutNodes, order);
+
+	rOutTriangles.clear();
+	rOutTriangles.reserve(triangles.size());
+	for (uint nIndex : order)
+	{
+		rOutTriangles.push_back(triangles[nIndex]);
+	}
+}
+
+void ModelBvh::BuildFromBounds(const Vec3* aMins, const Vec3* aMaxs, uint nCount,
+	std::vector<Model::BvhNode>& rOutNodes, std::vector<uint>& rOutOrder)
+{
+	rOutNodes.clear();
+	rOutOrder.clear();
+	if (nCount == 0)
+		return;
+
+	std::vector<BuildItem> buildItems(nCount);
+	for (uint i = 0; i < nCount; ++i)
+	{
+		BuildItem& rItem = buildItems[i];
+		rItem.bounds.vMin = aMins[i];
+		rItem.bounds.vMax = aMaxs[i];
+		rItem.vCentroid = (aMins[i] + aMaxs[i]) * 0.5f;
+		rItem.nSrcIndex = i;
+	}
+
+	rOutNodes.reserve(nCount * 2);
+	BvhBuilder builder(buildItems, rOutNodes);
+	builder.BuildNode(0, nCount, 0);
+
+	rOutOrder.reserve(nCount);
+	for (const BuildItem& rItem : buildItems)
+	{
+		rOutOrder.push_back(rItem.nSrcIndex);
+	}
+}
+
+bool ModelBvh::RayTriangleIntersect(const Vec3& rayOrigin, const Vec3& rayDir, const Vec3& triPtA, const Vec3& triPtB, const Vec3& triPtC, float* pOutT)
+{
+	Vec3 e1 = triPtB - triPtA;
+	Vec3 e2 = triPtC - triPtA;
+	Vec3 q = Vec3Cross(rayDir, e2);
+	float a = Vec3Dot(e1, q);
+	if (a > -Maths::kEpsilon && a < Maths::kEpsilon)
+		return false;
+
+	float f = 1 / a;
+	Vec3 s = rayOrigin - triPtA;
+	float u = f * Vec3Dot(s, q);
+	if (u < 0.f)
+		return false;
+
+	Vec3 r = Vec3Cross(s, e1);
+	float v = f * Vec3Dot(rayDir, r);
+	if (v < 0.f || u + v > 1.f)
+		return false;
+
+	*pOutT = f * Vec3Dot(e2, r);
+	return *pOutT > Maths::kEpsilon;
+}
+
+bool ModelBvh::RayIntersect(const Model::BvhNode* aNodes, const Model::BvhTriangle* aTriangles, const Vec3* aPositions,
+	const Vec3& rayOrigin, const Vec3& rayDir, float* pOutT)
+{
+	// Axis-parallel rays get an infinite inverse, which the slab test handles.
+	Vec3 invRayDir(1.f / rayDir.x, 1.f / rayDir.y, 1.f / rayDir.z);
+
+	float fClosestT = FLT_MAX;
+	if (rayAabbIntersect(rayOrigin, invRayDir, aNodes[0].vBoundsMin, aNodes[0].vBoundsMax, fClosestT) == FLT_MAX)
+		return false;
+
+	uint stack[kMaxTraversalDepth];
+	uint nStackSize = 0;
+	uint nNode = 0;
+
+	while (true)
+	{
+		const Model::BvhNode& rNode = aNodes[nNode];
+		if (rNode.nTriangleCount > 0)
+		{
+			for (uint i = rNode.nFirstTriangle; i < rNode.nFirstTriangle + rNode.nTriangleCount; ++i)
+			{
+				const Model::BvhTriangle& rTri = aTriangles[i];
+
+				float t;
+				if (RayTriangleIntersect(rayOrigin, rayDir, aPositions[rTri.anPositions[0]], aPositions[rTri.anPositions[1]], aPositions[rTri.anPositions[2]], &t)
+					&& t < fClosestT)
+				{
+					fClosestT = t;
+				}
+			}
+		}
+		else
+		{
+			// Visit the nearer child first so the closest hit shrinks the ray early.
+			uint nFirst = nNode + 1;
+			uint nSecond = rNode.nSecondChild;
+			float tFirst = rayAabbIntersect(rayOrigin, invRayDir, aNodes[nFirst].vBoundsMin, aNodes[nFirst].vBoundsMax, fClosestT);
+			float tSecond = rayAabbIntersect(rayOrigin, invRayDir, aNodes[nSecond].vBoundsMin, aNodes[nSecond].vBoundsMax, fClosestT);
+			if (tSecond < tFirst)
+			{
+				std::swap(nFirst, nSecond);
+				std::swap(tFirst, tSecond);
+			}
+
+			if (tFirst != FLT_MAX)
+			{
+				if (tSecond != FLT_MAX)
+				{
+					stack[nStackSize++] = nSecond;
+				}
+				nNode = nFirst;
+				continue;
+			}
+		}
+
+		if (nStackSize == 0)
+			break;
+		nNode = stack[--nStackSize];
+	}
+
+	*pOutT = fClosestT;
+	return fClosestT != FLT_MAX;
+}
+
+namespace
+{
+	struct SimdPacket
+	{
+		__m128 origin[3];
+		__m128 dir[3];
+		__m128 invDir[3];
+	};
+
+	SimdPacket loadPacket(const ModelBvh::RayPacket& rPacket)
+	{
+		SimdPacket packet;
+		packet.origin[0] = _mm_load_ps(rPacket.originX);
+		packet.origin[1] = _mm_load_ps(rPacket.originY);
+		packet.origin[2] = _mm_load_ps(rPacket.originZ);
+		packet.dir[0] = _mm_load_ps(rPacket.dirX);
+		packet.dir[1] = _mm_load_ps(rPacket.dirY);
+		packet.dir[2] = _mm_load_ps(rPacket.dirZ);
+
+		__m128 one = _mm_set1_ps(1.f);
+		for (uint i = 0; i < 3; ++i)
+		{
+			packet.invDir[i] = _mm_div_ps(one, packet.dir[i]);
+		}
+		return packet;
+	}
+
+	// Slab test against all lanes.  Returns the lane mask of hits and the entry distance of each lane.
+	int packetAabbIntersect(const SimdPacket& packet, const Model::BvhNode& rNode, __m128 tCur, __m128 activeMask, __m128* pOutTMin)
+	{
+		const float* aMin = &rNode.vBoundsMin.x;
+		const float* aMax = &rNode.vBoundsMax.x;
+
+		__m128 tMin = _mm_setzero_ps();
+		__m128 tMax = tCur;
+		for (uint i = 0; i < 3; ++i)
+		{
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aMin[i]), packet.origin[i]), packet.invDir[i]);
+			__m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aMax[i]), packet.origin[i]), packet.invDir[i]);
+			tMin = _mm_max_ps(tMin, _mm_min_ps(t1, t2));
+			tMax = _mm_min_ps(tMax, _mm_max_ps(t1, t2));
+		}
+
+		*pOutTMin = tMin;
+		return _mm_movemask_ps(_mm_and_ps(activeMask, _mm_cmple_ps(tMin, tMax)));
+	}
+
+	__m128 cross(const __m128 a[3], const __m128 b[3], int nComponent)
+	{
+		int i = (nComponent + 1) % 3;
+		int j = (nComponent + 2) % 3;
+		return _mm_sub_ps(_mm_mul_ps(a[i], b[j]), _mm_mul_ps(a[j], b[i]));
+	}
+
+	__m128 dot(const __m128 a[3], const __m128 b[3])
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])), _mm_mul_ps(a[2], b[2]));
+	}
+
+	// Double-sided Moller-Trumbore test of one triangle against all lanes.  Updates tCur and returns the lanes that were hit.
+	int packetTriangleIntersect(const SimdPacket& packet, const Vec3& triPtA, const Vec3& triPtB, const Vec3& triPtC, __m128& tCur)
+	{
+		Vec3 vE1 = triPtB - triPtA;
+		Vec3 vE2 = triPtC - triPtA;
+		__m128 e1[3] = { _mm_set1_ps(vE1.x), _mm_set1_ps(vE1.y), _mm_set1_ps(vE1.z) };
+		__m128 e2[3] = { _mm_set1_ps(vE2.x), _mm_set1_ps(vE2.y), _mm_set1_ps(vE2.z) };
+
+		__m128 q[3] = { cross(packet.dir, e2, 0), cross(packet.dir, e2, 1), cross(packet.dir, e2, 2) };
+		__m128 a = dot(e1, q);
+		__m128 absA = _mm_max_ps(a, _mm_sub_ps(_mm_setzero_ps(), a));
+		__m128 mask = _mm_cmpge_ps(absA, _mm_set1_ps(Maths::kEpsilon));
+
+		__m128 f = _mm_div_ps(_mm_set1_ps(1.f), a);
+		__m128 s[3] = {
+			_mm_sub_ps(packet.origin[0], _mm_set1_ps(triPtA.x)),
+			_mm_sub_ps(packet.origin[1], _mm_set1_ps(triPtA.y)),
+			_mm_sub_ps(packet.origin[2], _mm_set1_ps(triPtA.z)) };
+		__m128 u = _mm_mul_ps(f, dot(s, q));
+		mask = _mm_and_ps(mask, _mm_cmpge_ps(u, _mm_setzero_ps()));
+
+		__m128 r[3] = { cross(s, e1, 0), cross(s, e1, 1), cross(s, e1, 2) };
+		__m128 v = _mm_mul_ps(f, dot(packet.dir, r));
+		mask = _mm_and_ps(mask, _mm_cmpge_ps(v, _mm_setzero_ps()));
+		mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.f)));
+
+		__m128 t = _mm_mul_ps(f, dot(e2, r));
+		mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, _mm_set1_ps(Maths::kEpsilon)));
+		mask = _mm_and_ps(mask, _mm_cmplt_ps(t, tCur));
+
+		tCur = _mm_or_ps(_mm_and_ps(mask, t), _mm_andnot_ps(mask, tCur));
+		return _mm_movemask_ps(mask);
+	}
+
+	uint countLanes(int nMask)
+	{
+		static const uint kLaneCounts[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+		return kLaneCounts[nMask & 0xf];
+	}
+
+	struct TrianglePacketContext
+	{
+		const SimdPacket* pPacket;
+		const Model::BvhTriangle* aTriangles;
+		const Vec3* aPositions;
+		uint nHitMask;
+	};
+
+	void intersectTriangleLeaf(const Model::BvhNode& rLeaf, const ModelBvh::RayPacket& rPacket, float afT[ModelBvh::kRayPacketSize], void* pUserData)
+	{
+		TrianglePacketContext* pContext = (TrianglePacketContext*)pUserData;
+		const SimdPacket& packet = *pContext->pPacket;
+		__m128 tCur = _mm_loadu_ps(afT);
+
+		for (uint i = rLeaf.nFirstTriangle; i < rLeaf.nFirstTriangle + rLeaf.nTriangleCount; ++i)
+		{
+			const Model::BvhTriangle& rTri = pContext->aTriangles[i];
+			pContext->nHitMask |= packetTriangleIntersect(packet,
+				pContext->aPositions[rTri.anPositions[0]], pContext->aPositions[rTri.anPositions[1]], pContext->aPositions[rTri.anPositions[2]], tCur);
+		}
+
+		_mm_storeu_ps(afT, tCur);
+	}
+}
+
+void ModelBvh::TraversePacket(const Model::BvhNode* aNodes, const RayPacket& rPacket, float afT[kRayPacketSize],
+	PacketLeafFunc leafFunc, void* pUserData)
+{
+	SimdPacket packet = loadPacket(rPacket);
+	__m128 activeMask = _mm_cmpgt_ps(_mm_loadu_ps(afT), _mm_setzero_ps());
+
+	__m128 tEntry;
+	if (!packetAabbIntersect(packet, aNodes[0], _mm_loadu_ps(afT), activeMask, &tEntry))
+		return;
+
+	uint stack[kMaxTraversalDepth];
+	uint nStackSize = 0;
+	uint nNode = 0;
+
+	while (true)
+	{
+		const Model::BvhNode& rNode = aNodes[nNode];
+		if (rNode.nTriangleCount > 0)
+		{
+			leafFunc(rNode, rPacket, afT, pUserData);
+		}
+		else
+		{
+			__m128 tCur = _mm_loadu_ps(afT);
+			uint nFirst = nNode + 1;
+			uint nSecond = rNode.nSecondChild;
+
+			__m128 tFirst, tSecond;
+			int nFirstMask = packetAabbIntersect(packet, aNodes[nFirst], tCur, activeMask, &tFirst);
+			int nSecondMask = packetAabbIntersect(packet, aNodes[nSecond], tCur, activeMask, &tSecond);
+
+			if (nFirstMask && nSecondMask)
+			{
+				// Visit the child that is closer for more of the packet first.
+				int nSecondCloser = _mm_movemask_ps(_mm_cmplt_ps(tSecond, tFirst)) & nFirstMask & nSecondMask;
+				if (countLanes(nSecondCloser) * 2 > countLanes(nFirstMask & nSecondMask))
+				{
+					std::swap(nFirst, nSecond);
+				}
+				stack[nStackSize++] = nSecond;
+				nNode = nFirst;
+				continue;
+			}
+			else if (nFirstMask || nSecondMask)
+			{
+				nNode = nFirstMask ? nFirst : nSecond;
+				continue;
+			}
+		}
+
+		if (nStackSize == 0)
+			break;
+		nNode = stack[--nStackSize];
+	}
+}
+
+uint ModelBvh::RayIntersectPacket(const Model::BvhNode* aNodes, const Model::BvhTriangle* aTriangles, const Vec3* aPositions,
+	const RayPacket& rPacket, float afT[kRayPacketSize])
+{
+	SimdPacket packet = loadPacket(rPacket);
+
+	TrianglePacketContext context;
+	context.pPacket = &packet;
+	context.aTriangles = aTriangles;
+	context.aPositions = aPositions;
+	context.nHitMask = 0;
+
+	TraversePacket(aNodes, rPacket, afT, intersectTriangleLeaf, &context);
+	return context.nHitMask;
+}
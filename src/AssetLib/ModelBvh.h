@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include "ModelAsset.h"
+
+// Bounding volume hierarchy over a model's full detail triangles for ray queries in model space.
+namespace ModelBvh
+{
+	static const uint kRayPacketSize = 4;
+
+	// Rays in SoA form, traversed together with SIMD.  Lanes with a max distance of 0 are inactive.
+	struct RayPacket
+	{
+		alignas(16) float originX[kRayPacketSize];
+		alignas(16) float originY[kRayPacketSize];
+		alignas(16) float originZ[kRayPacketSize];
+		alignas(16) float dirX[kRayPacketSize];
+		alignas(16) float dirY[kRayPacketSize];
+		alignas(16) float dirZ[kRayPacketSize];
+	};
+
+	// Called for each leaf reached by any active lane.  Leaves update afT with closer hits.
+	typedef void (*PacketLeafFunc)(const AssetLib::Model::BvhNode& rLeaf, const RayPacket& rPacket, float afT[kRayPacketSize], void* pUserData);
+
+	// Builds the hierarchy with a binned surface area heuristic.  Output triangles are reordered to match the leaves.
+	void Build(const std::vector<AssetLib::Model::BvhTriangle>& triangles, const Vec3* aPositions,
+		std::vector<AssetLib::Model::BvhNode>& rOutNodes, std::vector<AssetLib::Model::BvhTriangle>& rOutTriangles);
+
+	// Builds a hierarchy over arbitrary boxes.  Leaf ranges index into rOutOrder, which maps back to the input boxes.
+	void BuildFromBounds(const Vec3* aMins, const Vec3* aMaxs, uint nCount,
+		std::vector<AssetLib::Model::BvhNode>& rOutNodes, std::vector<uint>& rOutOrder);
+
+	// Finds the closest double-sided triangle hit along the ray.
+	// rayDir does not need to be normalized, in which case pOutT is in units of its length.
+	bool RayIntersect(const AssetLib::Model::BvhNode* aNodes, const AssetLib::Model::BvhTriangle* aTriangles, const Vec3* aPositions,
+		const Vec3& rayOrigin, const Vec3& rayDir, float* pOutT);
+
+	// Packet version of RayIntersect().  afT holds each lane's max distance on input and its closest hit on output.
+	// Returns a bit mask of the lanes whose distance was reduced.
+	uint RayIntersectPacket(const AssetLib::Model::BvhNode* aNodes, const AssetLib::Model::BvhTriangle* aTriangles, const Vec3* aPositions,
+		const RayPacket& rPacket, float afT[kRayPacketSize]);
+
+	// Generic packet traversal for hierarchies with custom leaf contents, such as scene level BVHs.
+	void TraversePacket(const AssetLib::Model::BvhNode* aNodes, const RayPacket& rPacket, float afT[kRayPacketSize],
+		PacketLeafFunc leafFunc, void* pUserData);
+
+	// Double-sided Moller-Trumbore test.
+	bool RayTriangleIntersect(const Vec3& rayOrigin, const Vec3& rayDir, const Vec3& triPtA, const Vec3& triPtB, const Vec3& triPtC, float* pOutT);
+}
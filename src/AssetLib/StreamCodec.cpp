@@ -0,0 +1,248 @@
+#include "StreamCodec.h"
+#include <algorithm>
+
+namespace
+{
+	enum class StreamMode : uint8
+	{
+		Raw,
+		Rans,
+	};
+
+	static constexpr uint kProbBits = 12;
+	static constexpr uint kProbScale = 1 << kProbBits;
+	static constexpr uint kRansLowerBound = 1 << 23;
+	static constexpr uint kNumSymbols = 256;
+	static constexpr uint kRansHeaderSize = sizeof(uint16) * kNumSymbols + sizeof(uint);
+
+	struct SymbolTable
+	{
+		uint16 freqs[kNumSymbols];
+		uint16 starts[kNumSymbols];
+	};
+
+	// Splits elements into byte lanes and replaces each byte with its difference from the same byte of the previous element.
+	void transposeAndDelta(const uint8* pSrc, uint nElementCount, uint nStride, uint8* pDst)
+	{
+		for (uint nLane = 0; nLane < nStride; ++nLane)
+		{
+			uint8* pLane = pDst + nLane * nElementCount;
+			uint8 prev = 0;
+			for (uint i = 0; i < nElementCount; ++i)
+			{
+				uint8 cur = pSrc[i * nStride + nLane];
+				pLane[i] = cur - prev;
+				prev = cur;
+			}
+		}
+	}
+
+	void undoTransposeAndDelta(const uint8* pSrc, uint nElementCount, uint nStride, uint8* pDst)
+	{
+		for (uint nLane = 0; nLane < nStride; ++nLane)
+		{
+			const uint8* pLane = pSrc + nLane * nElementCount;
+			uint8 prev = 0;
+			for (uint i = 0; i < nElementCount; ++i)
+			{
+				prev += pLane[i];
+				pDst[i * nStride + nLane] = prev;
+			}
+		}
+	}
+
+	bool buildStartsFromFreqs(SymbolTable& rTable)
+	{
+		uint nStart = 0;
+		for (uint s = 0; s < kNumSymbols; ++s)
+		{
+			rTable.starts[s] = (uint16)nStart;
+			nStart += rTable.freqs[s];
+		}
+		return nStart == kProbScale;
+	}
+
+	void buildSymbolTable(const uint8* pData, uint nSize, SymbolTable& rTable)
+	{
+		uint counts[kNumSymbols] = { 0 };
+		for (uint i = 0; i < nSize; ++i)
+		{
+			++counts[pData[i]];
+		}
+
+		// Scale counts to the probability range, keeping every present symbol representable.
+		uint nTotal = 0;
+		for (uint s = 0; s < kNumSymbols; ++s)
+		{
+			uint nFreq = (uint)(((uint64)counts[s] * kProbScale) / nSize);
+			if (counts[s] && nFreq == 0)
+				nFreq = 1;
+			rTable.freqs[s] = (uint16)nFreq;
+			nTotal += nFreq;
+		}
+
+		// Distribute any rounding error across the most frequent symbols.
+		while (nTotal != kProbScale)
+		{
+			uint nBest = 0;
+			for (uint s = 1; s < kNumSymbols; ++s)
+			{
+				if (rTable.freqs[s] > rTable.freqs[nBest])
+					nBest = s;
+			}
+
+			if (nTotal > kProbScale)
+			{
+				uint nReduce = std::min<uint>(nTotal - kProbScale, rTable.freqs[nBest] - 1);
+				rTable.freqs[nBest] -= (uint16)nReduce;
+				nTotal -= nReduce;
+			}
+			else
+			{
+				rTable.freqs[nBest] += (uint16)(kProbScale - nTotal);
+				nTotal = kProbScale;
+			}
+		}
+
+		buildStartsFromFreqs(rTable);
+	}
+
+	void ransEncode(const uint8* pData, uint nSize, const SymbolTable& table, std::vector<uint8>& rOutBytes)
+	{
+		// rANS encodes in reverse so the decoder can read forward.  Bytes are emitted backwards and flipped at the end.
+		uint x = kRansLowerBound;
+		for (uint i = nSize; i > 0; --i)
+		{
+			uint8 s = pData[i - 1];
+			uint nFreq = table.freqs[s];
+			uint nMaxState = ((kRansLowerBound >> kProbBits) << 8) * nFreq;
+			while (x >= nMaxState)
+			{
+				rOutBytes.push_back((uint8)(x & 0xff));
+				x >>= 8;
+			}
+			x = ((x / nFreq) << kProbBits) + (x % nFreq) + table.starts[s];
+		}
+
+		rOutBytes.push_back((uint8)(x >> 24));
+		rOutBytes.push_back((uint8)(x >> 16));
+		rOutBytes.push_back((uint8)(x >> 8));
+		rOutBytes.push_back((uint8)(x >> 0));
+		std::reverse(rOutBytes.begin(), rOutBytes.end());
+	}
+
+	bool ransDecode(const uint8* pSrc, uint nSrcSize, const SymbolTable& table, uint8* pDst, uint nDstSize)
+	{
+		uint8 symbolLookup[kProbScale];
+		for (uint s = 0; s < kNumSymbols; ++s)
+		{
+			for (uint i = 0; i < table.freqs[s]; ++i)
+			{
+				symbolLookup[table.starts[s] + i] = (uint8)s;
+			}
+		}
+
+		if (nSrcSize < sizeof(uint))
+			return false;
+
+		const uint8* pRead = pSrc;
+		const uint8* pEnd = pSrc + nSrcSize;
+		uint x = pRead[0] | (pRead[1] << 8) | (pRead[2] << 16) | (pRead[3] << 24);
+		pRead += 4;
+
+		for (uint i = 0; i < nDstSize; ++i)
+		{
+			uint nSlot = x & (kProbScale - 1);
+			uint8 s = symbolLookup[nSlot];
+			pDst[i] = s;
+
+			x = table.freqs[s] * (x >> kProbBits) + nSlot - table.starts[s];
+			while (x < kRansLowerBound)
+			{
+				if (pRead == pEnd)
+					return false;
+				x = (x << 8) | *pRead++;
+			}
+		}
+
+		return true;
+	}
+}
+
+void StreamCodec::Encode(const uint8* pSrc, uint nElementCount, uint nStride, std::vector<uint8>& rOutData)
+{
+	uint nSize = nElementCount * nStride;
+
+	std::vector<uint8> residuals(nSize);
+	transposeAndDelta(pSrc, nElementCount, nStride, residuals.data());
+
+	std::vector<uint8> ransBytes;
+	SymbolTable table;
+	if (nSize > 0)
+	{
+		buildSymbolTable(residuals.data(), nSize, table);
+		ransEncode(residuals.data(), nSize, table, ransBytes);
+	}
+
+	// Fall back to storing the raw stream if entropy coding doesn't pay for its header.
+	if (nSize == 0 || kRansHeaderSize + ransBytes.size() >= nSize)
+	{
+		rOutData.push_back((uint8)StreamMode::Raw);
+		rOutData.insert(rOutData.end(), pSrc, pSrc + nSize);
+		return;
+	}
+
+	rOutData.push_back((uint8)StreamMode::Rans);
+	const uint8* pFreqs = (const uint8*)table.freqs;
+	rOutData.insert(rOutData.end(), pFreqs, pFreqs + sizeof(table.freqs));
+
+	uint nRansSize = (uint)ransBytes.size();
+	const uint8* pRansSize = (const uint8*)&nRansSize;
+	rOutData.insert(rOutData.end(), pRansSize, pRansSize + sizeof(nRansSize));
+	rOutData.insert(rOutData.end(), ransBytes.begin(), ransBytes.end());
+}
+
+bool StreamCodec::Decode(const uint8* pSrc, uint nSrcSize, uint nElementCount, uint nStride, uint8* pDst)
+{
+	uint nSize = nElementCount * nStride;
+	if (nSrcSize < 1)
+		return false;
+
+	StreamMode eMode = (StreamMode)pSrc[0];
+	++pSrc;
+	--nSrcSize;
+
+	if (eMode == StreamMode::Raw)
+	{
+		if (nSrcSize != nSize)
+			return false;
+
+		std::copy(pSrc, pSrc + nSize, pDst);
+		return true;
+	}
+	else if (eMode == StreamMode::Rans)
+	{
+		if (nSrcSize < kRansHeaderSize)
+			return false;
+
+		SymbolTable table;
+		std::copy(pSrc, pSrc + sizeof(table.freqs), (uint8*)table.freqs);
+		pSrc += sizeof(table.freqs);
+
+		uint nRansSize;
+		std::copy(pSrc, pSrc + sizeof(nRansSize), (uint8*)&nRansSize);
+		pSrc += sizeof(nRansSize);
+
+		if (nRansSize != nSrcSize - kRansHeaderSize || !buildStartsFromFreqs(table))
+			return false;
+
+		std::vector<uint8> residuals(nSize);
+		if (!ransDecode(pSrc, nRansSize, table, residuals.data(), nSize))
+			return false;
+
+		undoTransposeAndDelta(residuals.data(), nElementCount, nStride, pDst);
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <vector>
+#include "../Types.h"
+
+// Lossless compression for fixed-stride binary streams such as vertex and index buffers.
+// Each byte lane of the element is delta encoded against the previous element and the
+// residuals are entropy coded with an order-0 rANS coder.
+namespace StreamCodec
+{
+	// Appends the encoded stream to rOutData.
+	void Encode(const uint8* pSrc, uint nElementCount, uint nStride, std::vector<uint8>& rOutData);
+
+	// Decodes nElementCount * nStride bytes into pDst.  Returns false if the encoded data is malformed.
+	bool Decode(const uint8* pSrc, uint nSrcSize, uint nElementCount, uint nStride, uint8* pDst);
+}
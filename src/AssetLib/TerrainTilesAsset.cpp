@@ -0,0 +1,81 @@
+#include "TerrainTilesAsset.h"
+#include "MathLib/Maths.h"
+#include "UtilsLib/Error.h"
+#include "UtilsLib/Util.h"
+
+using namespace AssetLib;
+
+AssetDef& TerrainTiles::GetAssetDef()
+{
+	static AssetDef s_assetDef("textures", "htiles", 1);
+	return s_assetDef;
+}
+
+bool TerrainTileReader::Open(const char* assetName)
+{
+	Close();
+
+	char filePath[FILE_MAX_PATH];
+	TerrainTiles::GetAssetDef().BuildFilename(assetName, filePath, ARRAY_SIZE(filePath));
+
+	m_file.open(filePath, std::ios::binary);
+	if (!m_file.is_open())
+		return false;
+
+	BinFileHeader header;
+	m_file.read((char*)&header, sizeof(header));
+	m_file.read((char*)&m_layout, sizeof(m_layout));
+	if (!m_file.good() || header.binUID != BinFileHeader::kUID || header.assetUID != TerrainTiles::GetAssetDef().GetAssetUID())
+	{
+		Error("Invalid terrain tiles file: %s", filePath);
+		Close();
+		return false;
+	}
+
+	if (header.version != TerrainTiles::GetAssetDef().GetBinVersion()
+		|| m_layout.numLevels == 0 || m_layout.numLevels > TerrainTiles::kMaxLevels)
+	{
+		Error("Terrain tiles file is out of date: %s", filePath);
+		Close();
+		return false;
+	}
+
+	m_tileBounds.resize(m_layout.GetTileCount() * 2);
+	m_file.read((char*)m_tileBounds.data(), m_tileBounds.size() * sizeof(float16));
+	if (!m_file.good())
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void TerrainTileReader::Close()
+{
+	if (m_file.is_open())
+	{
+		m_file.close();
+	}
+	m_file.clear();
+	m_tileBounds.clear();
+}
+
+void TerrainTileReader::GetTileBounds(uint nLevel, uint nTileX, uint nTileY, float* pOutMin, float* pOutMax) const
+{
+	uint nTile = m_layout.GetTileIndex(nLevel, nTileX, nTileY);
+	*pOutMin = Maths::convertHalfToSinglePrecision(m_tileBounds[nTile * 2 + 0]);
+	*pOutMax = Maths::convertHalfToSinglePrecision(m_tileBounds[nTile * 2 + 1]);
+}
+
+bool TerrainTileReader::ReadTile(uint nLevel, uint nTileX, uint nTileY, float16* pOutTexels)
+{
+	m_file.seekg(m_layout.GetTileDataOffset(nLevel, nTileX, nTileY));
+	m_file.read((char*)pOutTexels, m_layout.GetTileDataSize());
+	if (!m_file.good())
+	{
+		m_file.clear();
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <fstream>
+#include <vector>
+#include "AssetDef.h"
+#include "BinFile.h"
+
+namespace AssetLib
+{
+	// Heightmap mip chain split into square R16F tiles so terrain can stream just the tiles around the camera.
+	// Written by the texture importer next to every heightmap texture.
+	// File layout:
+	//	BinFileHeader
+	//	TerrainTiles
+	//	Half float (min, max) height pairs for every tile
+	//	Tile texels for every tile
+	// Tiles are stored finest level first and row-major within each level, so any tile can be read with a single seek.
+	struct TerrainTiles
+	{
+		static AssetDef& GetAssetDef();
+
+		static const uint kMaxLevels = 8;
+		static const uint kDefaultTileSize = 64;
+
+		uint GetTileCount() const;
+		uint GetTileIndex(uint nLevel, uint nTileX, uint nTileY) const;
+		uint GetTileDataSize() const;
+		uint GetBoundsOffset() const;
+		uint64 GetTileDataOffset(uint nLevel, uint nTileX, uint nTileY) const;
+
+		uint width; // Texels in the finest level.
+		uint height;
+		uint tileSize; // Texels along each side of a tile.  Edge tiles repeat the last row and column.
+		uint numLevels;
+		uint levelTilesX[kMaxLevels];
+		uint levelTilesY[kMaxLevels];
+		uint levelFirstTile[kMaxLevels];
+	};
+
+	// Random access reader for a terrain tiles file.  Not thread safe; use one reader per thread.
+	class TerrainTileReader
+	{
+	public:
+		bool Open(const char* assetName);
+		void Close();
+
+		bool IsOpen() const;
+		const TerrainTiles& GetLayout() const;
+
+		// (min, max) height of a tile including the texels a bilinear sample inside it can reach.
+		void GetTileBounds(uint nLevel, uint nTileX, uint nTileY, float* pOutMin, float* pOutMax) const;
+
+		// Reads tileSize * tileSize half float texels.
+		bool ReadTile(uint nLevel, uint nTileX, uint nTileY, float16* pOutTexels);
+
+	private:
+		std::ifstream m_file;
+		TerrainTiles m_layout;
+		std::vector<float16> m_tileBounds;
+	};
+
+	inline uint TerrainTiles::GetTileCount() const
+	{
+		return levelFirstTile[numLevels - 1] + levelTilesX[numLevels - 1] * levelTilesY[numLevels - 1];
+	}
+
+	inline uint TerrainTiles::GetTileIndex(uint nLevel, uint nTileX, uint nTileY) const
+	{
+		return levelFirstTile[nLevel] + nTileX + nTileY * levelTilesX[nLevel];
+	}
+
+	inline uint TerrainTiles::GetTileDataSize() const
+	{
+		return tileSize * tileSize * sizeof(float16);
+	}
+
+	inline uint TerrainTiles::GetBoundsOffset() const
+	{
+		return sizeof(BinFileHeader) + sizeof(TerrainTiles);
+	}
+
+	inline uint64 TerrainTiles::GetTileDataOffset(uint nLevel, uint nTileX, uint nTileY) const
+	{
+		uint64 nTilesStart = GetBoundsOffset() + GetTileCount() * 2 * sizeof(float16);
+		return nTilesStart + (uint64)GetTileIndex(nLevel, nTileX, nTileY) * GetTileDataSize();
+	}
+
+	inline bool TerrainTileReader::IsOpen() const
+	{
+		return m_file.is_open();
+	}
+
+	inline const TerrainTiles& TerrainTileReader::GetLayout() const
+	{
+		return m_layout;
+	}
+}
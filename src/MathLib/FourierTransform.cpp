@@ -1,11 +1,20 @@
 #include "FourierTransform.h"
 #include "Maths.h"
+#include <xmmintrin.h>
+#include <algorithm>
 
+// Iterative decimation-in-time FFT.  After the bit reversal permutation, pairs of radix-2 stages are fused into
+// radix-4 butterflies (radix-2^2) so each pass over the data does twice the work of a radix-2 pass.
+// A single radix-2 pass is done first when log2(size) is odd.
+// Row transforms are vectorized across butterflies within the row, column transforms are vectorized across columns.
+// References:
 // http://www.keithlantz.net/2011/11/ocean-simulation-part-two-using-the-fast-fourier-transform/
-// TODO: Research the FFT and actually understand how it works.  This is basically a straight copy from the above URL.
+// http://www.fftw.org/fftw-paper-ieee.pdf
 
 namespace
 {
+	const double kPiDouble = 3.14159265358979323846;
+
 	// Reverse bits in "i" given a max usable bit of maxBit - 1).
 	// e.g. If:  
 	//		i = 0x01, and
@@ -21,101 +30,279 @@ namespace
 		}
 		return res;
 	}
+
+	// Radix-4 butterfly on elements i0..i3 (spaced by the stage's quarter size).
+	//	w1 - Twiddle for the first radix-2 stage, exp(i*pi*k/L)
+	//	w2 - Twiddle for the second radix-2 stage, exp(i*pi*k/(2L)).  The odd half uses w2 * i.
+	inline void butterfly4(float* pRe, float* pIm, int i0, int i1, int i2, int i3, float w1r, float w1i, float w2r, float w2i)
+	{
+		float a1r = pRe[i1] * w1r - pIm[i1] * w1i;
+		float a1i = pRe[i1] * w1i + pIm[i1] * w1r;
+		float a3r = pRe[i3] * w1r - pIm[i3] * w1i;
+		float a3i = pRe[i3] * w1i + pIm[i3] * w1r;
+
+		float b0r = pRe[i0] + a1r, b0i = pIm[i0] + a1i;
+		float b1r = pRe[i0] - a1r, b1i = pIm[i0] - a1i;
+		float b2r = pRe[i2] + a3r, b2i = pIm[i2] + a3i;
+		float b3r = pRe[i2] - a3r, b3i = pIm[i2] - a3i;
+
+		float c2r = b2r * w2r - b2i * w2i;
+		float c2i = b2r * w2i + b2i * w2r;
+		// b3 * w2 * i
+		float c3r = -(b3r * w2i + b3i * w2r);
+		float c3i = b3r * w2r - b3i * w2i;
+
+		pRe[i0] = b0r + c2r; pIm[i0] = b0i + c2i;
+		pRe[i2] = b0r - c2r; pIm[i2] = b0i - c2i;
+		pRe[i1] = b1r + c3r; pIm[i1] = b1i + c3i;
+		pRe[i3] = b1r - c3r; pIm[i3] = b1i - c3i;
+	}
+
+	// Four radix-4 butterflies at once.  Elements i0..i3 and the 3 following elements of each are processed.
+	inline void butterfly4Simd(float* pRe, float* pIm, int i0, int i1, int i2, int i3, __m128 w1r, __m128 w1i, __m128 w2r, __m128 w2i)
+	{
+		__m128 x0r = _mm_loadu_ps(pRe + i0), x0i = _mm_loadu_ps(pIm + i0);
+		__m128 x1r = _mm_loadu_ps(pRe + i1), x1i = _mm_loadu_ps(pIm + i1);
+		__m128 x2r = _mm_loadu_ps(pRe + i2), x2i = _mm_loadu_ps(pIm + i2);
+		__m128 x3r = _mm_loadu_ps(pRe + i3), x3i = _mm_loadu_ps(pIm + i3);
+
+		__m128 a1r = _mm_sub_ps(_mm_mul_ps(x1r, w1r), _mm_mul_ps(x1i, w1i));
+		__m128 a1i = _mm_add_ps(_mm_mul_ps(x1r, w1i), _mm_mul_ps(x1i, w1r));
+		__m128 a3r = _mm_sub_ps(_mm_mul_ps(x3r, w1r), _mm_mul_ps(x3i, w1i));
+		__m128 a3i = _mm_add_ps(_mm_mul_ps(x3r, w1i), _mm_mul_ps(x3i, w1r));
+
+		__m128 b0r = _mm_add_ps(x0r, a1r), b0i = _mm_add_ps(x0i, a1i);
+		__m128 b1r = _mm_sub_ps(x0r, a1r), b1i = _mm_sub_ps(x0i, a1i);
+		__m128 b2r = _mm_add_ps(x2r, a3r), b2i = _mm_add_ps(x2i, a3i);
+		__m128 b3r = _mm_sub_ps(x2r, a3r), b3i = _mm_sub_ps(x2i, a3i);
+
+		__m128 c2r = _mm_sub_ps(_mm_mul_ps(b2r, w2r), _mm_mul_ps(b2i, w2i));
+		__m128 c2i = _mm_add_ps(_mm_mul_ps(b2r, w2i), _mm_mul_ps(b2i, w2r));
+		__m128 c3r = _mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(_mm_mul_ps(b3r, w2i), _mm_mul_ps(b3i, w2r)));
+		__m128 c3i = _mm_sub_ps(_mm_mul_ps(b3r, w2r), _mm_mul_ps(b3i, w2i));
+
+		_mm_storeu_ps(pRe + i0, _mm_add_ps(b0r, c2r)); _mm_storeu_ps(pIm + i0, _mm_add_ps(b0i, c2i));
+		_mm_storeu_ps(pRe + i2, _mm_sub_ps(b0r, c2r)); _mm_storeu_ps(pIm + i2, _mm_sub_ps(b0i, c2i));
+		_mm_storeu_ps(pRe + i1, _mm_add_ps(b1r, c3r)); _mm_storeu_ps(pIm + i1, _mm_add_ps(b1i, c3i));
+		_mm_storeu_ps(pRe + i3, _mm_sub_ps(b1r, c3r)); _mm_storeu_ps(pIm + i3, _mm_sub_ps(b1i, c3i));
+	}
+
+	// Adds/subtracts "count" values at pA and pB in place.
+	inline void butterfly2(float* pA, float* pB, int count)
+	{
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 a = _mm_loadu_ps(pA + i);
+			__m128 b = _mm_loadu_ps(pB + i);
+			_mm_storeu_ps(pA + i, _mm_add_ps(a, b));
+			_mm_storeu_ps(pB + i, _mm_sub_ps(a, b));
+		}
+
+		for (; i < count; ++i)
+		{
+			float a = pA[i];
+			pA[i] = a + pB[i];
+			pB[i] = a - pB[i];
+		}
+	}
 }
 
 FourierTransform::FourierTransform()
 	: m_size(0)
 	, m_sizeLog2(0)
-	, m_reversed(nullptr)
-	, m_w(nullptr)
+	, m_swapPairs(nullptr)
+	, m_numSwapPairs(0)
+	, m_twiddles(nullptr)
 {
 
 }
 
 void FourierTransform::Init(int size)
 {
+	delete[] m_swapPairs;
+	delete[] m_twiddles;
+
 	m_size = size;
 	m_sizeLog2 = (int)log2(m_size);
 
-	m_reversed = new int[m_size];
+	m_numSwapPairs = 0;
+	m_swapPairs = new int[m_size];
 	for (int i = 0; i < m_size; i++)
 	{
-		m_reversed[i] = reverseBitRange(i, m_sizeLog2);
+		int reversed = reverseBitRange(i, m_sizeLog2);
+		if (i < reversed)
+		{
+			m_swapPairs[m_numSwapPairs * 2 + 0] = i;
+			m_swapPairs[m_numSwapPairs * 2 + 1] = reversed;
+			++m_numSwapPairs;
+		}
 	}
 
-	int pow2 = 1;
-	m_w = new Complex*[m_sizeLog2];
-	for (int i = 0; i < m_sizeLog2; i++)
+	// Each radix-4 stage with quarter size L stores 4 arrays of L floats: w1 real, w1 imag, w2 real, w2 imag.
+	int numTwiddles = 0;
+	for (int L = (m_sizeLog2 & 1) ? 2 : 1; L * 4 <= m_size; L *= 4)
 	{
-		m_w[i] = new Complex[pow2];
-		float mul = Maths::kTwoPi / (pow2 * 2);
+		numTwiddles += L * 4;
+	}
+
+	m_twiddles = new float[std::max(numTwiddles, 1)];
 
-		for (int j = 0; j < pow2; j++)
+	float* pTwiddles = m_twiddles;
+	for (int L = (m_sizeLog2 & 1) ? 2 : 1; L * 4 <= m_size; L *= 4)
+	{
+		for (int k = 0; k < L; ++k)
 		{
-			m_w[i][j] = Complex(cosf(mul * j), sinf(mul * j));
+			// Computed in double precision so error doesn't accumulate across stages.
+			double a1 = kPiDouble * k / (double)L;
+			double a2 = kPiDouble * k / (double)(L * 2);
+			pTwiddles[k + L * 0] = (float)cos(a1);
+			pTwiddles[k + L * 1] = (float)sin(a1);
+			pTwiddles[k + L * 2] = (float)cos(a2);
+			pTwiddles[k + L * 3] = (float)sin(a2);
 		}
-
-		pow2 *= 2;
+		pTwiddles += L * 4;
 	}
 }
 
 FourierTransform::~FourierTransform()
 {
-	if (m_reversed)
+	delete[] m_swapPairs;
+	delete[] m_twiddles;
+}
+
+void FourierTransform::Transform(float* aReal, float* aImag) const
+{
+	for (int i = 0; i < m_numSwapPairs; ++i)
 	{
-		delete[] m_reversed;
+		int a = m_swapPairs[i * 2 + 0];
+		int b = m_swapPairs[i * 2 + 1];
+		std::swap(aReal[a], aReal[b]);
+		std::swap(aImag[a], aImag[b]);
 	}
-	
-	if (m_w)
+
+	int L = 1;
+	if (m_sizeLog2 & 1)
 	{
-		for (int i = 0; i < m_sizeLog2; i++)
+		for (int j = 0; j < m_size; j += 2)
 		{
-			delete[] m_w[i];
+			butterfly2(aReal + j, aReal + j + 1, 1);
+			butterfly2(aImag + j, aImag + j + 1, 1);
 		}
-		delete[] m_w;
+		L = 2;
+	}
+
+	const float* pTwiddles = m_twiddles;
+	for (; L * 4 <= m_size; L *= 4)
+	{
+		const float* pW1r = pTwiddles;
+		const float* pW1i = pTwiddles + L;
+		const float* pW2r = pTwiddles + L * 2;
+		const float* pW2i = pTwiddles + L * 3;
+
+		for (int j = 0; j < m_size; j += L * 4)
+		{
+			if (L >= 4)
+			{
+				for (int k = 0; k < L; k += 4)
+				{
+					int i0 = j + k;
+					butterfly4Simd(aReal, aImag, i0, i0 + L, i0 + L * 2, i0 + L * 3,
+						_mm_loadu_ps(pW1r + k), _mm_loadu_ps(pW1i + k), _mm_loadu_ps(pW2r + k), _mm_loadu_ps(pW2i + k));
+				}
+			}
+			else
+			{
+				for (int k = 0; k < L; ++k)
+				{
+					int i0 = j + k;
+					butterfly4(aReal, aImag, i0, i0 + L, i0 + L * 2, i0 + L * 3, pW1r[k], pW1i[k], pW2r[k], pW2i[k]);
+				}
+			}
+		}
+
+		pTwiddles += L * 4;
 	}
 }
 
-void FourierTransform::Fast(Complex* input, Complex* output, int stride, int offset)
+void FourierTransform::TransformRows(float* aReal, float* aImag, int firstRow, int numRows) const
 {
-	Complex* c[2];
-	c[0] = (Complex*)alloca(m_size * sizeof(Complex));
-	c[1] = (Complex*)alloca(m_size * sizeof(Complex));
-	memset(c[0], 0, m_size * sizeof(Complex));
-	memset(c[1], 0, m_size * sizeof(Complex));
+	for (int m = firstRow; m < firstRow + numRows; ++m)
+	{
+		Transform(aReal + m * m_size, aImag + m * m_size);
+	}
+}
 
-	int which = 0;
+void FourierTransform::TransformColumns(float* aReal, float* aImag, int firstColumn, int numColumns) const
+{
+	// Same as Transform() but every element is a (partial) row, so each butterfly transforms all columns at once.
+	const int rowSize = m_size;
+	aReal += firstColumn;
+	aImag += firstColumn;
 
-	for (int i = 0; i < m_size; i++)
-		c[which][i] = input[m_reversed[i] * stride + offset];
+	for (int i = 0; i < m_numSwapPairs; ++i)
+	{
+		int a = m_swapPairs[i * 2 + 0] * rowSize;
+		int b = m_swapPairs[i * 2 + 1] * rowSize;
+		std::swap_ranges(aReal + a, aReal + a + numColumns, aReal + b);
+		std::swap_ranges(aImag + a, aImag + a + numColumns, aImag + b);
+	}
 
-	int loops = m_size >> 1;
-	int size = 1 << 1;
-	int size_over_2 = 1;
-	int w_ = 0;
-	for (int i = 1; i <= m_sizeLog2; i++)
+	int L = 1;
+	if (m_sizeLog2 & 1)
 	{
-		which ^= 1;
-		for (int j = 0; j < loops; j++)
+		for (int j = 0; j < m_size; j += 2)
 		{
-			for (int k = 0; k < size_over_2; k++)
-			{
-				c[which][size * j + k] = c[which ^ 1][size * j + k] +
-					c[which ^ 1][size * j + size_over_2 + k] * m_w[w_][k];
-			}
+			butterfly2(aReal + j * rowSize, aReal + (j + 1) * rowSize, numColumns);
+			butterfly2(aImag + j * rowSize, aImag + (j + 1) * rowSize, numColumns);
+		}
+		L = 2;
+	}
 
-			for (int k = size_over_2; k < size; k++)
+	const float* pTwiddles = m_twiddles;
+	for (; L * 4 <= m_size; L *= 4)
+	{
+		for (int j = 0; j < m_size; j += L * 4)
+		{
+			for (int k = 0; k < L; ++k)
 			{
-				c[which][size * j + k] = c[which ^ 1][size * j - size_over_2 + k] -
-					c[which ^ 1][size * j + k] * m_w[w_][k - size_over_2];
+				float w1r = pTwiddles[k];
+				float w1i = pTwiddles[k + L];
+				float w2r = pTwiddles[k + L * 2];
+				float w2i = pTwiddles[k + L * 3];
+
+				int i0 = (j + k) * rowSize;
+				int i1 = i0 + L * rowSize;
+				int i2 = i1 + L * rowSize;
+				int i3 = i2 + L * rowSize;
+
+				int c = 0;
+				for (; c + 4 <= numColumns; c += 4)
+				{
+					butterfly4Simd(aReal, aImag, i0 + c, i1 + c, i2 + c, i3 + c,
+						_mm_set1_ps(w1r), _mm_set1_ps(w1i), _mm_set1_ps(w2r), _mm_set1_ps(w2i));
+				}
+
+				for (; c < numColumns; ++c)
+				{
+					butterfly4(aReal, aImag, i0 + c, i1 + c, i2 + c, i3 + c, w1r, w1i, w2r, w2i);
+				}
 			}
 		}
-		loops >>= 1;
-		size <<= 1;
-		size_over_2 <<= 1;
-		w_++;
+
+		pTwiddles += L * 4;
 	}
+}
 
-	for (int i = 0; i < m_size; i++)
-		output[i * stride + offset] = c[which][i];
+void FourierTransform::Transform2D(float* const* aReal, float* const* aImag, int numFields) const
+{
+	for (int f = 0; f < numFields; ++f)
+	{
+		TransformRows(aReal[f], aImag[f], 0, m_size);
+	}
+
+	for (int f = 0; f < numFields; ++f)
+	{
+		TransformColumns(aReal[f], aImag[f], 0, m_size);
+	}
 }
@@ -4,6 +4,9 @@
 
 typedef std::complex<float> Complex;
 
+// Precomputed power-of-two FFT plan.
+// Data is stored as separate real and imaginary arrays (SoA) and transformed in place.
+// Uses the positive exponent convention, x[n] = sum(X[k] * exp(2*pi*i*k*n / N)), without normalization.
 class FourierTransform
 {
 public:
@@ -12,12 +15,28 @@ public:
 
 	void Init(int size);
 
-	void Fast(Complex* input, Complex* output, int stride, int offset);
+	// In-place 1D transform of "size" contiguous values.
+	void Transform(float* aReal, float* aImag) const;
+
+	// In-place 2D transform of numFields row-major size x size grids.
+	// Each field is processed separately: the rows of every field are transformed first, then the columns of each field.
+	// The column pass transforms all columns of a field together, a row at a time, so loads are contiguous.
+	void Transform2D(float* const* aReal, float* const* aImag, int numFields) const;
+
+	// The two passes of Transform2D() on part of a single grid, for splitting the work across threads.
+	// All rows must be complete before any columns are transformed.
+	// Column ranges should start on multiples of 4 so loads line up with SIMD widths.
+	void TransformRows(float* aReal, float* aImag, int firstRow, int numRows) const;
+	void TransformColumns(float* aReal, float* aImag, int firstColumn, int numColumns) const;
 
 private:
 	int m_size;
 	int m_sizeLog2;
 
-	int* m_reversed;
-	Complex** m_w;
-};
\ No newline at end of file
+	// Index pairs to swap for the bit reversal permutation.
+	int* m_swapPairs;
+	int m_numSwapPairs;
+
+	// Twiddle factors for each radix-4 stage, see Init() for layout.
+	float* m_twiddles;
+};
@@ -2,6 +2,7 @@
 
 #include <math.h>
 #include <float.h>
+#include <DirectXPackedVector.h>
 #include "Vec2.h"
 #include "Vec3.h"
 #include "Vec4.h"
@@ -35,6 +36,16 @@ namespace Maths
 		return rad * 180.f / kPi;
 	}
 
+	inline float16 convertSingleToHalfPrecision(float f)
+	{
+		return DirectX::PackedVector::XMConvertFloatToHalf(f);
+	}
+
+	inline float convertHalfToSinglePrecision(float16 half)
+	{
+		return DirectX::PackedVector::XMConvertHalfToFloat(half);
+	}
+
 	// Input data MUST be 16 byte aligned.
 	inline Vec4 convertHalfToSinglePrecision4(float16* pHalf)
 	{
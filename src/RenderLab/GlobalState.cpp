@@ -19,6 +19,51 @@ namespace
 	{
 		g_debugState.showCpuProfiler = (args[0].val.inum != 0);
 	}
+
+	void cmdSetLodErrorPixels(DebugCommandArg *args, int numArgs)
+	{
+		g_debugState.lodErrorPixels = args[0].val.fnum;
+	}
+
+	void cmdSetShadowLodBias(DebugCommandArg *args, int numArgs)
+	{
+		g_debugState.shadowLodBias = args[0].val.fnum;
+	}
+
+	void cmdForceLod(DebugCommandArg *args, int numArgs)
+	{
+		g_debugState.forceLod = args[0].val.inum;
+	}
+
+	void cmdClusterCulling(DebugCommandArg *args, int numArgs)
+	{
+		g_debugState.clusterCulling = (args[0].val.inum != 0);
+	}
+
+	void cmdSetTerrainLodDistance(DebugCommandArg *args, int numArgs)
+	{
+		g_debugState.terrainLodDistance = args[0].val.fnum;
+	}
+
+	void cmdTerrainShadows(DebugCommandArg *args, int numArgs)
+	{
+		g_debugState.terrainShadows = (args[0].val.inum != 0);
+	}
+
+	void cmdCpuLightCulling(DebugCommandArg *args, int numArgs)
+	{
+		g_debugState.cpuLightCulling = (args[0].val.inum != 0);
+	}
+
+	void cmdValidateLightCulling(DebugCommandArg *args, int numArgs)
+	{
+		g_debugState.validateLightCulling = true;
+	}
+
+	void cmdSetOceanSimRate(DebugCommandArg *args, int numArgs)
+	{
+		g_debugState.oceanSimRate = args[0].val.fnum;
+	}
 }
 
 void GlobalState::Init()
@@ -27,6 +72,15 @@ void GlobalState::Init()
 	DebugConsole::RegisterCommand("instancing", cmdSetInstancingEnabled, DebugCommandArgType::Integer);
 	DebugConsole::RegisterCommand("wireframe", cmdSetWireframeEnabled, DebugCommandArgType::Integer);
 	DebugConsole::RegisterCommand("showCpuProfiler", cmdShowCpuProfiler, DebugCommandArgType::Integer);
+	DebugConsole::RegisterCommand("lodErrorPixels", cmdSetLodErrorPixels, DebugCommandArgType::Float);
+	DebugConsole::RegisterCommand("shadowLodBias", cmdSetShadowLodBias, DebugCommandArgType::Float);
+	DebugConsole::RegisterCommand("forceLod", cmdForceLod, DebugCommandArgType::Integer);
+	DebugConsole::RegisterCommand("clusterCulling", cmdClusterCulling, DebugCommandArgType::Integer);
+	DebugConsole::RegisterCommand("terrainLodDistance", cmdSetTerrainLodDistance, DebugCommandArgType::Float);
+	DebugConsole::RegisterCommand("terrainShadows", cmdTerrainShadows, DebugCommandArgType::Integer);
+	DebugConsole::RegisterCommand("cpuLightCulling", cmdCpuLightCulling, DebugCommandArgType::Integer);
+	DebugConsole::RegisterCommand("validateLightCulling", cmdValidateLightCulling);
+	DebugConsole::RegisterCommand("oceanSimRate", cmdSetOceanSimRate, DebugCommandArgType::Float);
 
 	// Init default state
 	g_debugState.enableInstancing = false; // Leaving this disabled as the engine is far more GPU bound than CPU right now.
@@ -34,4 +88,13 @@ void GlobalState::Init()
 	g_debugState.wireframe = false;
 	g_debugState.visMode = DebugVisMode::kNone;
 	g_debugState.showCpuProfiler = false;
+	g_debugState.lodErrorPixels = 1.f;
+	g_debugState.shadowLodBias = 4.f;
+	g_debugState.forceLod = -1;
+	g_debugState.clusterCulling = true;
+	g_debugState.terrainLodDistance = 64.f;
+	g_debugState.terrainShadows = true;
+	g_debugState.cpuLightCulling = false;
+	g_debugState.validateLightCulling = false;
+	g_debugState.oceanSimRate = 30.f;
 }
\ No newline at end of file
@@ -17,6 +17,20 @@ struct GlobalState
 	int msaaLevel;
 	DebugVisMode visMode;
 
+	// Model LOD selection
+	float lodErrorPixels; // Max screen space error of a selected LOD.
+	float shadowLodBias; // Multiplier on the allowed LOD error for shadow maps.
+	int forceLod; // Forces a detail level on all models.  -1 for automatic selection.
+	bool clusterCulling; // Cull model clusters against the view frustum and their normal cones.
+
+	float terrainLodDistance; // Distance covered by the finest terrain LOD.  Each coarser LOD covers twice the distance.
+	bool terrainShadows; // Include terrain in shadow caster selection.
+
+	bool cpuLightCulling; // Bin clustered lights on the CPU instead of with the light culling compute shader.
+	bool validateLightCulling; // Check the next frame's clustered light lists from the compute shader against the CPU assignment.
+
+	float oceanSimRate; // Ocean simulation updates per second.  Rendered frames interpolate between updates.  0 simulates every frame.
+
 	static void Init();
 };
 
@@ -0,0 +1,166 @@
+#include "Precompiled.h"
+#include "RayQuery.h"
+#include "Scene.h"
+#include "components/ModelComponent.h"
+#include "AssetLib/ModelBvh.h"
+#include "UtilsLib/JobPool.h"
+
+namespace
+{
+	// Rays per unit of work handed to a thread.  Multiple of the packet size so jobs don't split packets.
+	static const uint kRaysPerJob = 256;
+	static_assert(kRaysPerJob % ModelBvh::kRayPacketSize == 0, "Jobs must contain whole ray packets");
+
+	struct CastRaysContext
+	{
+		const RayQueryScene* pScene;
+		const RayQuery* aRays;
+		RayQueryHit* aOutHits;
+	};
+
+	struct PacketContext
+	{
+		const RayQueryScene* pScene;
+		const uint* aInstanceOrder;
+		int aHitInstance[ModelBvh::kRayPacketSize];
+	};
+}
+
+void RayQueryScene::Build()
+{
+	m_instances.clear();
+	m_nodes.clear();
+	m_instanceOrder.clear();
+
+	std::vector<Vec3> mins;
+	std::vector<Vec3> maxs;
+
+	for (ModelComponent& rModel : Scene::GetComponentAllocator()->GetModelComponentFreeList())
+	{
+		const Entity* pEntity = rModel.GetEntity();
+		const AssetLib::Model* pModelData = rModel.GetModelData()->GetSource();
+		if (!pEntity || pModelData->nBvhNodeCount == 0)
+			continue;
+
+		Matrix44 mtxWorld = pEntity->GetTransform();
+
+		Instance instance;
+		instance.pModel = &rModel;
+		instance.pModelData = pModelData;
+		instance.mtxInvWorld = Matrix44Inverse(mtxWorld);
+		m_instances.push_back(instance);
+
+		// World space bounds of the model's BVH root.
+		const AssetLib::Model::BvhNode& rRoot = pModelData->bvhNodes.ptr[0];
+		Vec3 vMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		Vec3 vMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (uint nCorner = 0; nCorner < 8; ++nCorner)
+		{
+			Vec3 vCorner((nCorner & 1) ? rRoot.vBoundsMax.x : rRoot.vBoundsMin.x,
+				(nCorner & 2) ? rRoot.vBoundsMax.y : rRoot.vBoundsMin.y,
+				(nCorner & 4) ? rRoot.vBoundsMax.z : rRoot.vBoundsMin.z);
+			vCorner = Vec3TransformCoord(vCorner, mtxWorld);
+			vMin = Vec3Min(vMin, vCorner);
+			vMax = Vec3Max(vMax, vCorner);
+		}
+		mins.push_back(vMin);
+		maxs.push_back(vMax);
+	}
+
+	ModelBvh::BuildFromBounds(mins.data(), maxs.data(), (uint)mins.size(), m_nodes, m_instanceOrder);
+}
+
+void RayQueryScene::CastRays(const RayQuery* aRays, uint nRayCount, RayQueryHit* aOutHits) const
+{
+	CastRaysContext context = { this, aRays, aOutHits };
+	JobPool::ParallelFor(nRayCount, kRaysPerJob, CastRaysJob, &context);
+}
+
+void RayQueryScene::CastRaysJob(uint nBegin, uint nEnd, void* pUserData)
+{
+	const CastRaysContext* pContext = (const CastRaysContext*)pUserData;
+	pContext->pScene->CastRayRange(pContext->aRays + nBegin, nEnd - nBegin, pContext->aOutHits + nBegin);
+}
+
+void RayQueryScene::CastRayRange(const RayQuery* aRays, uint nRayCount, RayQueryHit* aOutHits) const
+{
+	for (uint i = 0; i < nRayCount; ++i)
+	{
+		aOutHits[i].pModel = nullptr;
+		aOutHits[i].distance = aRays[i].maxDistance;
+	}
+
+	if (m_nodes.empty())
+		return;
+
+	// Transforms the packet into each instance's model space and traces it through the model's BVH.
+	// Hit distances carry over between spaces because the transformed directions are not normalized.
+	auto intersectInstanceLeaf = [](const AssetLib::Model::BvhNode& rLeaf, const ModelBvh::RayPacket& rPacket, float afT[ModelBvh::kRayPacketSize], void* pUserData)
+	{
+		PacketContext* pContext = (PacketContext*)pUserData;
+		for (uint i = rLeaf.nFirstTriangle; i < rLeaf.nFirstTriangle + rLeaf.nTriangleCount; ++i)
+		{
+			uint nInstance = pContext->aInstanceOrder[i];
+			const Instance& rInstance = pContext->pScene->m_instances[nInstance];
+
+			ModelBvh::RayPacket localPacket;
+			for (uint nLane = 0; nLane < ModelBvh::kRayPacketSize; ++nLane)
+			{
+				Vec3 vOrigin = Vec3TransformCoord(Vec3(rPacket.originX[nLane], rPacket.originY[nLane], rPacket.originZ[nLane]), rInstance.mtxInvWorld);
+				Vec3 vDir = Vec3TransformNormal(Vec3(rPacket.dirX[nLane], rPacket.dirY[nLane], rPacket.dirZ[nLane]), rInstance.mtxInvWorld);
+				localPacket.originX[nLane] = vOrigin.x;
+				localPacket.originY[nLane] = vOrigin.y;
+				localPacket.originZ[nLane] = vOrigin.z;
+				localPacket.dirX[nLane] = vDir.x;
+				localPacket.dirY[nLane] = vDir.y;
+				localPacket.dirZ[nLane] = vDir.z;
+			}
+
+			const AssetLib::Model* pModelData = rInstance.pModelData;
+			uint nHitMask = ModelBvh::RayIntersectPacket(pModelData->bvhNodes.ptr, pModelData->bvhTriangles.ptr, pModelData->positions.ptr, localPacket, afT);
+			for (uint nLane = 0; nLane < ModelBvh::kRayPacketSize; ++nLane)
+			{
+				if (nHitMask & (1 << nLane))
+				{
+					pContext->aHitInstance[nLane] = nInstance;
+				}
+			}
+		}
+	};
+
+	for (uint nStart = 0; nStart < nRayCount; nStart += ModelBvh::kRayPacketSize)
+	{
+		uint nLaneCount = std::min(ModelBvh::kRayPacketSize, nRayCount - nStart);
+
+		ModelBvh::RayPacket packet;
+		alignas(16) float afT[ModelBvh::kRayPacketSize];
+		PacketContext context;
+		context.pScene = this;
+		context.aInstanceOrder = m_instanceOrder.data();
+
+		for (uint nLane = 0; nLane < ModelBvh::kRayPacketSize; ++nLane)
+		{
+			// Unused lanes repeat the last ray with a max distance of 0, which disables them.
+			const RayQuery& rRay = aRays[nStart + std::min(nLane, nLaneCount - 1)];
+			packet.originX[nLane] = rRay.origin.x;
+			packet.originY[nLane] = rRay.origin.y;
+			packet.originZ[nLane] = rRay.origin.z;
+			packet.dirX[nLane] = rRay.direction.x;
+			packet.dirY[nLane] = rRay.direction.y;
+			packet.dirZ[nLane] = rRay.direction.z;
+			afT[nLane] = (nLane < nLaneCount) ? rRay.maxDistance : 0.f;
+			context.aHitInstance[nLane] = -1;
+		}
+
+		ModelBvh::TraversePacket(m_nodes.data(), packet, afT, intersectInstanceLeaf, &context);
+
+		for (uint nLane = 0; nLane < nLaneCount; ++nLane)
+		{
+			if (context.aHitInstance[nLane] >= 0)
+			{
+				aOutHits[nStart + nLane].pModel = m_instances[context.aHitInstance[nLane]].pModel;
+				aOutHits[nStart + nLane].distance = afT[nLane];
+			}
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "MathLib/Vec3.h"
+#include "AssetLib/ModelAsset.h"
+#include <vector>
+
+class ModelComponent;
+
+struct RayQuery
+{
+	Vec3 origin;
+	Vec3 direction;
+	float maxDistance;
+};
+
+struct RayQueryHit
+{
+	ModelComponent* pModel; // nullptr if the ray missed.
+	float distance; // In units of the query's direction.  maxDistance if the ray missed.
+};
+
+// Batched ray queries against model triangles.
+// Models are organized by a scene level BVH over their world bounds, and each model is traversed through its own BVH.
+// Rays are traced in SIMD packets of 4 so queries that are next to each other in the batch should be coherent.
+class RayQueryScene
+{
+public:
+	// Snapshots the transforms and bounds of the scene's models.  Must be rebuilt after models move or change.
+	void Build();
+
+	// Traces all rays, splitting the work across the JobPool workers and the calling thread.
+	// Safe to call from multiple threads at once as long as the scene is not rebuilt.
+	void CastRays(const RayQuery* aRays, uint nRayCount, RayQueryHit* aOutHits) const;
+
+private:
+	struct Instance
+	{
+		ModelComponent* pModel;
+		const AssetLib::Model* pModelData;
+		Matrix44 mtxInvWorld;
+	};
+
+	void CastRayRange(const RayQuery* aRays, uint nRayCount, RayQueryHit* aOutHits) const;
+	static void CastRaysJob(uint nBegin, uint nEnd, void* pUserData);
+
+private:
+	std::vector<Instance> m_instances;
+	std::vector<AssetLib::Model::BvhNode> m_nodes;
+	// Leaf ranges of m_nodes index into this list of instances.
+	std::vector<uint> m_instanceOrder;
+};
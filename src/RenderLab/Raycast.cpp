@@ -2,6 +2,7 @@
 #include "Raycast.h"
 #include "components/ModelComponent.h"
 #include "AssetLib/ModelAsset.h"
+#include "AssetLib/ModelBvh.h"
 
 // Most of these come from Real-Time Rendering
 //http://www.realtimerendering.com/intersections.html
@@ -74,51 +75,16 @@ bool rayModelIntersect(const Vec3& rayOrigin, const Vec3& rayDir, const ModelCom
 	if (!raySphereIntersect(rayOrigin, rayDir, pos, radius, &sphereT))
 		return false;
 
-	float closestT = FLT_MAX;
-	bool hit = false;
-
 	const AssetLib::Model* pData = pModel->GetModelData()->GetSource();
-	for (uint iSubObject = 0; iSubObject < pData->nSubObjectCount; ++iSubObject)
-	{
-		const AssetLib::Model::SubObject& subobj = pData->subobjects.ptr[iSubObject];
-		const void* pSubObjIndices = pData->indexBuffer.ptr + subobj.nIndexStartByteOffset;
-
-		for (uint idx = 0; idx < subobj.nIndexCount; idx += 3)
-		{
-			uint nIndices[3];
-			switch (subobj.eIndexFormat)
-			{
-			case RdrIndexBufferFormat::R16_UINT:
-				nIndices[0] = ((uint16*)pSubObjIndices)[idx + 0];
-				nIndices[1] = ((uint16*)pSubObjIndices)[idx + 1];
-				nIndices[2] = ((uint16*)pSubObjIndices)[idx + 2];
-				break;
-			case RdrIndexBufferFormat::R32_UINT:
-				nIndices[0] = ((uint*)pSubObjIndices)[idx + 0];
-				nIndices[1] = ((uint*)pSubObjIndices)[idx + 1];
-				nIndices[2] = ((uint*)pSubObjIndices)[idx + 2];
-				break;
-			}
-
-			Vec3 triA = pData->positions.ptr[nIndices[0]];
-			Vec3 triB = pData->positions.ptr[nIndices[1]];
-			Vec3 triC = pData->positions.ptr[nIndices[2]];
-
-			triA = Vec3TransformCoord(triA, mtxWorld);
-			triB = Vec3TransformCoord(triB, mtxWorld);
-			triC = Vec3TransformCoord(triC, mtxWorld);
+	if (pData->nBvhNodeCount == 0)
+		return false;
 
-			float t;
-			if (rayTriangleIntersect(rayOrigin, rayDir, triA, triB, triC, true, &t) && t < closestT)
-			{
-				closestT = t;
-				hit = true;
-			}
-		}
-	}
+	// Traverse in model space.  The transformed direction is not normalized, so hit distances stay in world units.
+	Matrix44 mtxInvWorld = Matrix44Inverse(mtxWorld);
+	Vec3 localOrigin = Vec3TransformCoord(rayOrigin, mtxInvWorld);
+	Vec3 localDir = Vec3TransformNormal(rayDir, mtxInvWorld);
 
-	*pOutT = closestT;
-	return hit;
+	return ModelBvh::RayIntersect(pData->bvhNodes.ptr, pData->bvhTriangles.ptr, pData->positions.ptr, localOrigin, localDir, pOutT);
 }
 
 bool rayPlaneIntersect(const Vec3& rayOrigin, const Vec3& rayDir, const Vec3& planeNormal, const Vec3& planePt, float* pOutT)
@@ -9,10 +9,22 @@
 #include "AssetLib/AssetLibrary.h"
 #include "render/Terrain.h"
 #include "render/Ocean.h"
+#include "render/LightCulling.h"
 #include "Game.h"
 
 namespace
 {
+	struct RankedLight
+	{
+		const Light* pLight;
+		float importance;
+	};
+
+	bool compareLightImportance(const RankedLight& rLeft, const RankedLight& rRight)
+	{
+		return rLeft.importance > rRight.importance;
+	}
+
 	struct
 	{
 		DefaultComponentAllocator m_componentAllocator;
@@ -28,6 +40,9 @@ namespace
 		uint m_environmentMapSize;
 
 		CachedString m_name;
+
+		// Visible spot and point lights for the current frame.  Kept around to avoid reallocating every frame.
+		std::vector<RankedLight> m_rankedLights;
 	} s_scene;
 
 	void captureEnvironmentLight(Light* pLight)
@@ -67,6 +82,8 @@ void Scene::Cleanup()
 	}
 	s_scene.m_entities.clear();
 
+	s_scene.m_terrain.Cleanup();
+
 	s_scene.m_name = nullptr;
 }
 
@@ -331,9 +348,58 @@ void Scene::QueueDraw(RdrAction* pAction)
 
 	//////////////////////////////////////////////////////////////////////////
 	// Sky & Lighting
+	// Spot and point lights are culled against the view and queued most important first.  RdrLighting hands out shadow
+	// maps in queue order, and lights that don't fit in the light lists are the least visible ones.
+	s_scene.m_rankedLights.clear();
 	for (Light& rLight : s_scene.m_componentAllocator.GetLightFreeList())
 	{
-		pAction->AddLight(&rLight);
+		LightType eType = rLight.GetType();
+		if (eType != LightType::Spot && eType != LightType::Point)
+		{
+			pAction->AddLight(&rLight);
+			continue;
+		}
+
+		Vec3 boundsCenter = rLight.GetEntity()->GetPosition();
+		float boundsRadius = rLight.GetRadius();
+		if (eType == LightType::Spot)
+		{
+			LightCulling::CalcSpotLightBounds(boundsCenter, rLight.GetDirection(), rLight.GetRadius(), rLight.GetOuterConeAngle(),
+				boundsCenter, boundsRadius);
+		}
+
+		if (!rCamera.CanSee(boundsCenter, boundsRadius))
+		{
+			// Light volume is off screen.
+			continue;
+		}
+
+		RankedLight rankedLight;
+		rankedLight.pLight = &rLight;
+		rankedLight.importance = LightCulling::CalcScreenImportance(rCamera, boundsCenter, boundsRadius, rLight.GetColor());
+		s_scene.m_rankedLights.push_back(rankedLight);
+	}
+
+	std::sort(s_scene.m_rankedLights.begin(), s_scene.m_rankedLights.end(), compareLightImportance);
+
+	uint numSpotLights = 0;
+	uint numPointLights = 0;
+	for (const RankedLight& rRankedLight : s_scene.m_rankedLights)
+	{
+		if (rRankedLight.pLight->GetType() == LightType::Spot)
+		{
+			if (numSpotLights == RdrLightList::kMaxSpotLights)
+				continue;
+			++numSpotLights;
+		}
+		else
+		{
+			if (numPointLights == RdrLightList::kMaxPointLights)
+				continue;
+			++numPointLights;
+		}
+
+		pAction->AddLight(rRankedLight.pLight);
 	}
 
 	AssetLib::SkySettings sky;
@@ -354,7 +420,7 @@ void Scene::QueueDraw(RdrAction* pAction)
 	//////////////////////////////////////////////////////////////////////////
 	// Shadows
 	// Can only be after lighting is queued else there are no shadow passes.
-	// TODO: Better way to handle shadows.  Perhaps have the scene decide which lights will cast shadows this frame rather than RdrLighting.
+	// TODO: Better way to handle shadows.
 	int numShadowPasses = pAction->GetShadowPassCount();
 	for (ModelComponent& rModel : Scene::GetComponentAllocator()->GetModelComponentFreeList())
 	{
@@ -371,7 +437,7 @@ void Scene::QueueDraw(RdrAction* pAction)
 				// Re-use draw ops if we've already built them for a previous shadow pass.
 				if (ops.numDrawOps == 0)
 				{
-					ops = rModel.BuildDrawOps(pAction);
+					ops = rModel.BuildShadowDrawOps(pAction);
 				}
 
 				for (int i = 0; i < ops.numDrawOps; ++i)
@@ -385,6 +451,18 @@ void Scene::QueueDraw(RdrAction* pAction)
 		}
 	}
 
+	// Terrain selects its own patches for each shadow camera.
+	for (int iShadowPass = 0; iShadowPass < numShadowPasses; ++iShadowPass)
+	{
+		RdrBucketType shadowBucket = (RdrBucketType)((int)RdrBucketType::ShadowMap0 + iShadowPass);
+
+		opSet = s_scene.m_terrain.BuildShadowDrawOps(pAction, iShadowPass);
+		for (uint16 i = 0; i < opSet.numDrawOps; ++i)
+		{
+			pAction->AddDrawOp(&opSet.aDrawOps[i], shadowBucket);
+		}
+	}
+
 	//////////////////////////////////////////////////////////////////////////
 	// Post-processing
 	AssetLib::PostProcessEffects postProcFx;
@@ -418,6 +496,11 @@ DefaultComponentAllocator* Scene::GetComponentAllocator()
 	return &s_scene.m_componentAllocator;
 }
 
+const Ocean& Scene::GetOcean()
+{
+	return s_scene.m_ocean;
+}
+
 EntityList& Scene::GetEntities()
 {
 	return s_scene.m_entities;
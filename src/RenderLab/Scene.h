@@ -10,6 +10,7 @@
 
 class Camera;
 class Renderer;
+class Ocean;
 class Entity;
 class RdrContext;
 
@@ -37,4 +38,7 @@ namespace Scene
 	const Rotation& GetCameraSpawnRotation();
 
 	DefaultComponentAllocator* GetComponentAllocator();
+
+	// Height and displacement queries are safe from any thread.  See Ocean::GetHeight()
+	const Ocean& GetOcean();
 }
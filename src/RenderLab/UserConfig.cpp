@@ -14,8 +14,11 @@ void UserConfig::Load()
 	g_userConfig.defaultScene = "basic";
 	g_userConfig.debugDevice = false;
 	g_userConfig.debugShaders = false;
+	g_userConfig.shaderCache = true;
+	g_userConfig.prewarmPipelineStates = true;
 	g_userConfig.attachRenderDoc = false;
 	g_userConfig.vsync = 0;
+	g_userConfig.framesInFlight = 2;
 
 	// Override settings if the User.config file exists.
 	Json::Value jRoot;
@@ -27,7 +30,10 @@ void UserConfig::Load()
 		g_userConfig.attachRenderDoc = jRoot.get("attachRenderDoc", g_userConfig.attachRenderDoc).asBool();
 		g_userConfig.debugDevice = jRoot.get("debugDevice", g_userConfig.debugDevice).asBool();
 		g_userConfig.debugShaders = jRoot.get("debugShaders", g_userConfig.debugShaders).asBool();
+		g_userConfig.shaderCache = jRoot.get("shaderCache", g_userConfig.shaderCache).asBool();
+		g_userConfig.prewarmPipelineStates = jRoot.get("prewarmPipelineStates", g_userConfig.prewarmPipelineStates).asBool();
 
 		g_userConfig.vsync = jRoot.get("vsync", g_userConfig.vsync).asInt();
+		g_userConfig.framesInFlight = jRoot.get("framesInFlight", g_userConfig.framesInFlight).asInt();
 	}
 }
\ No newline at end of file
@@ -7,9 +7,12 @@ struct UserConfig
 	std::string renderDocPath;
 	std::string defaultScene;
 	bool debugShaders;
+	bool shaderCache; // Keep compiled shaders on disk between runs.
+	bool prewarmPipelineStates; // Create the pipeline states recorded by the previous run at startup.
 	bool debugDevice;
 	bool attachRenderDoc;
 	int vsync;
+	int framesInFlight; // Frame states shared between the main and render threads (2-4).
 
 	static void Load();
 };
@@ -2,6 +2,7 @@
 #include "ModelComponent.h"
 #include "ComponentAllocator.h"
 #include "AssetLib/SceneAsset.h"
+#include "AssetLib/ModelAsset.h"
 #include "render/ModelData.h"
 #include "render/RdrFrameMem.h"
 #include "render/RdrDrawOp.h"
@@ -9,6 +10,7 @@
 #include "render/RdrShaderSystem.h"
 #include "render/RdrInstancedObjectDataBuffer.h"
 #include "render/RdrAction.h"
+#include "render/ClusterCulling.h"
 #include "render/Renderer.h"
 
 ModelComponent* ModelComponent::Create(IComponentAllocator* pAllocator, const CachedString& modelAssetName, const AssetLib::MaterialSwap* aMaterialSwaps, uint numMaterialSwaps)
@@ -68,7 +70,40 @@ void ModelComponent::SetModelData(const CachedString& modelAssetName, const Asse
 	}
 }
 
+float ModelComponent::CalcMaxLodError(RdrAction* pAction, float fErrorPixels) const
+{
+	const Camera& rCamera = pAction->GetCamera();
+	const Rect& rViewport = pAction->GetViewport();
+
+	// Screen pixels covered by one object space unit at the nearest point of the model's bounds.
+	float fPixelsPerUnit;
+	if (rCamera.IsOrtho())
+	{
+		fPixelsPerUnit = rViewport.height / rCamera.GetOrthoHeight();
+	}
+	else
+	{
+		float fDist = Vec3Length(m_pEntity->GetPosition() - rCamera.GetPosition()) - GetRadius();
+		fDist = std::max(fDist, rCamera.GetNearDist());
+		fPixelsPerUnit = rViewport.height / (2.f * tanf(rCamera.GetFieldOfViewY() * 0.5f) * fDist);
+	}
+	fPixelsPerUnit *= Vec3MaxComponent(m_pEntity->GetScale());
+
+	return fErrorPixels / fPixelsPerUnit;
+}
+
 RdrDrawOpSet ModelComponent::BuildDrawOps(RdrAction* pAction)
+{
+	return BuildDrawOpsInternal(pAction, g_debugState.lodErrorPixels, g_debugState.clusterCulling);
+}
+
+RdrDrawOpSet ModelComponent::BuildShadowDrawOps(RdrAction* pAction)
+{
+	// Shadow LODs are chosen against the main view since that is where the shadow is seen.
+	return BuildDrawOpsInternal(pAction, g_debugState.lodErrorPixels * g_debugState.shadowLodBias, false);
+}
+
+RdrDrawOpSet ModelComponent::BuildDrawOpsInternal(RdrAction* pAction, float fLodErrorPixels, bool bCullClusters)
 {
 	if (!m_hVsPerObjectConstantBuffer || m_lastTransformId != m_pEntity->GetTransformId())
 	{
@@ -78,6 +113,10 @@ RdrDrawOpSet ModelComponent::BuildDrawOps(RdrAction* pAction)
 		VsPerObject* pVsPerObject = (VsPerObject*)RdrFrameMem::AllocAligned(constantsSize, 16);
 		pVsPerObject->mtxWorld = Matrix44Transpose(mtxWorld);
 
+		const AssetLib::Model* pModelAsset = m_pModelData->GetSource();
+		pVsPerObject->positionDequantScale = pModelAsset->GetPositionDequantScale();
+		pVsPerObject->positionDequantOffset = pModelAsset->GetPositionDequantOffset();
+
 		m_hVsPerObjectConstantBuffer = RdrResourceSystem::CreateUpdateConstantBuffer(m_hVsPerObjectConstantBuffer,
 			pVsPerObject, constantsSize, RdrResourceAccessFlags::GpuRead, CREATE_BACKPOINTER(this));
 	
@@ -87,6 +126,7 @@ RdrDrawOpSet ModelComponent::BuildDrawOps(RdrAction* pAction)
 			{
 				m_instancedDataId = RdrInstancedObjectDataBuffer::AllocEntry();
 			}
+			RdrInstancedObjectDataBuffer::SetEntry(m_instancedDataId, *pVsPerObject);
 		}
 		else
 		{
@@ -96,21 +136,57 @@ RdrDrawOpSet ModelComponent::BuildDrawOps(RdrAction* pAction)
 		m_lastTransformId = m_pEntity->GetTransformId();
 	}
 
+	float fMaxLodError = CalcMaxLodError(pAction, fLodErrorPixels);
+
+	const AssetLib::Model* pModelAsset = m_pModelData->GetSource();
+	Matrix44 mtxWorld = m_pEntity->GetTransform();
+
 	uint numSubObjects = m_pModelData->GetNumSubObjects();
 	RdrDrawOp* aDrawOps = RdrFrameMem::AllocDrawOps(numSubObjects, CREATE_BACKPOINTER(this));
+	uint16 numDrawOps = 0;
 
 	for (uint i = 0; i < numSubObjects; ++i)
 	{
 		const ModelData::SubObject& rSubObject = m_pModelData->GetSubObject(i);
-		RdrDrawOp& rDrawOp = aDrawOps[i];
+		RdrDrawOp& rDrawOp = aDrawOps[numDrawOps];
 
 		rDrawOp.instanceDataId = m_instancedDataId;
 		rDrawOp.hVsConstants = m_hVsPerObjectConstantBuffer;
 		rDrawOp.pMaterial = m_pMaterials[i];
 
-		rDrawOp.hGeo = rSubObject.hGeo;
+		if (g_debugState.forceLod >= 0)
+		{
+			rDrawOp.hGeo = rSubObject.ahLodGeos[std::min((uint)g_debugState.forceLod, rSubObject.nLodCount - 1)];
+		}
+		else
+		{
+			rDrawOp.hGeo = m_pModelData->SelectLodGeo(i, fMaxLodError);
+		}
 		rDrawOp.bHasAlpha = rDrawOp.pMaterial->HasAlpha();
+
+		// Clusters only cover the full detail geometry.
+		const AssetLib::Model::SubObject& rBinSubObject = pModelAsset->subobjects.ptr[i];
+		if (bCullClusters && rDrawOp.hGeo == rSubObject.hGeo && rBinSubObject.nClusterCount > 1)
+		{
+			RdrIndexRange* aRanges = (RdrIndexRange*)RdrFrameMem::Alloc(sizeof(RdrIndexRange) * rBinSubObject.nClusterCount);
+			uint nRangeCount = ClusterCulling::CullClusters(pAction->GetCamera(), mtxWorld,
+				pModelAsset->clusters.ptr + rBinSubObject.nClusterStart, rBinSubObject.nClusterCount, aRanges);
+
+			if (nRangeCount == 0)
+				continue;
+
+			// Leave fully visible subobjects as a single instanceable draw.
+			bool bPartial = (nRangeCount > 1 || aRanges[0].nIndexCount != rBinSubObject.nIndexCount);
+			if (bPartial && nRangeCount <= 0xffff)
+			{
+				rDrawOp.aIndexRanges = aRanges;
+				rDrawOp.numIndexRanges = (uint16)nRangeCount;
+				rDrawOp.instanceDataId = 0;
+			}
+		}
+
+		++numDrawOps;
 	}
 
-	return RdrDrawOpSet(aDrawOps, numSubObjects);
+	return RdrDrawOpSet(aDrawOps, numDrawOps);
 }
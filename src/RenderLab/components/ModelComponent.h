@@ -19,6 +19,8 @@ public:
 	void OnDetached(Entity* pEntity);
 
 	RdrDrawOpSet BuildDrawOps(RdrAction* pAction);
+	// Same as BuildDrawOps(), but selects LODs with the shadow LOD bias applied.
+	RdrDrawOpSet BuildShadowDrawOps(RdrAction* pAction);
 
 	float GetRadius() const;
 
@@ -34,6 +36,12 @@ private:
 	// Whether the model should allow GPU hardware instancing.
 	bool CanInstance() const;
 
+	// Max object space error allowed when selecting LODs for the action's primary view.
+	float CalcMaxLodError(RdrAction* pAction, float fErrorPixels) const;
+
+	// Cluster culling only applies to the action's primary view, so it is disabled for shadow maps.
+	RdrDrawOpSet BuildDrawOpsInternal(RdrAction* pAction, float fLodErrorPixels, bool bCullClusters);
+
 private:
 	ModelData* m_pModelData;
 	const RdrMaterial* m_pMaterials[ModelData::kMaxSubObjects];
@@ -4,7 +4,10 @@
 #include "Scene.h"
 #include "render/Renderer.h"
 #include "render/Font.h"
+#include "render/RdrInstancedObjectDataBuffer.h"
 #include "DebugConsole.h"
+#include "HashBenchmark.h"
+#include "RayQueryBenchmark.h"
 
 namespace
 {
@@ -28,10 +31,22 @@ void cmdShowDebugger(DebugCommandArg* args, int numArgs)
 	}
 }
 
+void cmdHashBenchmark(DebugCommandArg* args, int numArgs)
+{
+	HashBenchmark::Run();
+}
+
+void cmdRayQueryBenchmark(DebugCommandArg* args, int numArgs)
+{
+	RayQueryBenchmark::Run();
+}
+
 void Debug::Init()
 {
 	DebugConsole::Init();
 	DebugConsole::RegisterCommand("dbg", cmdShowDebugger, DebugCommandArgType::String, DebugCommandArgType::Integer);
+	DebugConsole::RegisterCommand("hashBenchmark", cmdHashBenchmark);
+	DebugConsole::RegisterCommand("rayQueryBenchmark", cmdRayQueryBenchmark);
 }
 
 void Debug::RegisterDebugger(const char* name, IDebugger* pDebugger)
@@ -150,6 +165,40 @@ void Debug::QueueDraw(RdrAction* pAction)
 		sprintf_s(line, "  Tris: %d", rProfiler.GetCounter(RdrProfileCounter::Triangles));
 		Font::QueueDraw(pAction, uiPos, 20.f, line, Color::kWhite);
 
+		uiPos.y.val += 20.f;
+		sprintf_s(line, "  SRV Desc: %u live, %u free, %u frag (peak: %u)",
+			rProfiler.GetCounter(RdrProfileCounter::SrvDescriptorsLive), rProfiler.GetCounter(RdrProfileCounter::SrvDescriptorsFree),
+			rProfiler.GetCounter(RdrProfileCounter::SrvDescriptorsFragmented), rProfiler.GetCounter(RdrProfileCounter::SrvDescriptorsPeak));
+		Font::QueueDraw(pAction, uiPos, 20.f, line, Color::kWhite);
+
+		const RdrInstancedObjectDataBuffer::Stats& rInstanceStats = RdrInstancedObjectDataBuffer::GetStats();
+		uiPos.y.val += 20.f;
+		sprintf_s(line, "  Instance Data: %.1f KB (full: %.1f KB)", rInstanceStats.bytesUploaded / 1024.f, rInstanceStats.fullRangeBytes / 1024.f);
+		Font::QueueDraw(pAction, uiPos, 20.f, line, Color::kWhite);
+
+		const UploadHeap::Stats uploadStats = g_pRenderer->GetContext()->GetUploadHeap().GetStats();
+		uiPos.y.val += 20.f;
+		sprintf_s(line, "  Upload Ring: %.1f / %.1f MB (peak: %.1f MB, fallbacks: %u)",
+			uploadStats.ring.bytesInUse / (1024.f * 1024.f), uploadStats.ring.capacity / (1024.f * 1024.f),
+			uploadStats.ring.peakBytesInUse / (1024.f * 1024.f), uploadStats.fallbackAllocationsThisFrame);
+		Font::QueueDraw(pAction, uiPos, 20.f, line, Color::kWhite);
+
+		const RdrReadbackPool::Stats& readbackStats = g_pRenderer->GetReadbackPoolStats();
+		uiPos.y.val += 20.f;
+		sprintf_s(line, "  Readback: %u bufs, %.1f KB (reuses: %u, creates: %u)",
+			readbackStats.numBuffers, readbackStats.bytesAllocated / 1024.f, readbackStats.reuses, readbackStats.creates);
+		Font::QueueDraw(pAction, uiPos, 20.f, line, Color::kWhite);
+
+		const RdrFrameSync::Stats syncStats = g_pRenderer->GetFrameSyncStats();
+		uiPos.y.val += 20.f;
+		sprintf_s(line, "  Stall: main %.2f ms, RT %.2f ms (%u/%u queued)",
+			syncStats.mainStallMs, syncStats.renderStallMs, syncStats.queuedFrames, g_pRenderer->GetNumFrameStates());
+		Font::QueueDraw(pAction, uiPos, 20.f, line, Color::kWhite);
+
+		uiPos.y.val += 20.f;
+		sprintf_s(line, "  Stall Peak: main %.2f ms, RT %.2f ms", syncStats.peakMainStallMs, syncStats.peakRenderStallMs);
+		Font::QueueDraw(pAction, uiPos, 20.f, line, Color::kWhite);
+
 		uiPos.y.val += 20.f;
 		sprintf_s(line, "  RT: %.4f ms", RdrCpuThreadProfiler::GetThreadProfiler(Renderer::GetRenderThreadId()).GetThreadTimeMS());
 		Font::QueueDraw(pAction, uiPos, 20.f, line, Color::kWhite);
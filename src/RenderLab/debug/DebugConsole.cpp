@@ -4,6 +4,7 @@
 #include "render/Sprite.h"
 #include "render/Font.h"
 #include "UI.h"
+#include <stdarg.h>
 
 namespace
 {
@@ -273,6 +274,17 @@ void DebugConsole::RegisterCommand(const char* name, DebugCommandCallback func,
 	s_debugConsole.commands.insert(std::make_pair(std::string(cmd.name), cmd));
 }
 
+void DebugConsole::Print(const char* format, ...)
+{
+	char msg[256];
+	va_list args;
+	va_start(args, format);
+	vsprintf_s(msg, format, args);
+	va_end(args);
+
+	OutputDebugStringA(msg);
+}
+
 void DebugConsole::QueueDraw(RdrAction* pAction)
 {
 	if (!s_debugConsole.isActive)
@@ -34,6 +34,9 @@ namespace DebugConsole
 	void RegisterCommand(const char* name, DebugCommandCallback func, DebugCommandArgType arg1, DebugCommandArgType arg2, DebugCommandArgType arg3);
 	void RegisterCommand(const char* name, DebugCommandCallback func, DebugCommandArgType arg1, DebugCommandArgType arg2, DebugCommandArgType arg3, DebugCommandArgType arg4);
 
+	// Writes formatted command output to the debugger output window.
+	void Print(const char* format, ...);
+
 	void QueueDraw(RdrAction* pAction);
 
 	void ToggleActive(InputManager& rInputManager);
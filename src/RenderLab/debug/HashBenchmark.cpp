@@ -0,0 +1,123 @@
+#include "Precompiled.h"
+#include "HashBenchmark.h"
+#include "DebugConsole.h"
+#include "UtilsLib/Hash.h"
+#include "UtilsLib/Timer.h"
+#include "AssetLib/ModelAsset.h"
+
+namespace
+{
+	const uint kTargetBytes = 64 * 1024 * 1024;
+	const uint kNumLayouts = 64;
+	const uint kNumLayoutElements = 5;
+	const uint kNumLookups = 1000000;
+
+	double calcMBPerSec(uint64 numBytes, double ms)
+	{
+		return (numBytes / (1024.0 * 1024.0)) / std::max(ms * 0.001, 1e-9);
+	}
+
+	void benchmarkThroughput(Timer::Handle hTimer, uint dataSize)
+	{
+		std::vector<uint8> data(dataSize, 0x5a);
+		uint numIterations = std::max(kTargetBytes / dataSize, 1u);
+		uint64 totalBytes = (uint64)dataSize * numIterations;
+
+		// The first byte changes each iteration so the hashes can't be hoisted out of the loop.
+		uint64 sink = 0;
+		Timer::Reset(hTimer);
+		for (uint i = 0; i < numIterations; ++i)
+		{
+			data[0] = (uint8)i;
+			sink += Hashing::HashData64(data.data(), dataSize);
+		}
+		double hash64Ms = Timer::GetElapsedMillisecondsAndReset(hTimer);
+
+		for (uint i = 0; i < numIterations; ++i)
+		{
+			data[0] = (uint8)i;
+			sink += Hashing::HashData128(data.data(), dataSize).low;
+		}
+		double hash128Ms = Timer::GetElapsedMillisecondsAndReset(hTimer);
+
+		// SHA1 is much slower, so it gets a fraction of the data.
+		uint numSHA1Iterations = std::max(numIterations / 16, 1u);
+		for (uint i = 0; i < numSHA1Iterations; ++i)
+		{
+			data[0] = (uint8)i;
+			Hashing::SHA1 hash;
+			Hashing::SHA1::Finish(Hashing::SHA1::Begin(data.data(), dataSize), hash);
+			sink += hash.data[0];
+		}
+		double sha1Ms = Timer::GetElapsedMilliseconds(hTimer);
+
+		DebugConsole::Print("  %8u bytes: HashData64 %8.0f MB/s, HashData128 %8.0f MB/s, SHA1 %6.0f MB/s (%u)\n", dataSize,
+			calcMBPerSec(totalBytes, hash64Ms), calcMBPerSec(totalBytes, hash128Ms),
+			calcMBPerSec((uint64)dataSize * numSHA1Iterations, sha1Ms), (uint)(sink & 1));
+	}
+
+	// Keys a material by its input layout and finds it, as RdrMaterial::Create() does.  Compares the previous
+	// SHA1 layout keys with the current 64-bit keys.
+	void benchmarkMaterialLookup(Timer::Handle hTimer)
+	{
+		std::vector<RdrVertexInputElement> layouts(kNumLayouts * kNumLayoutElements);
+		for (uint i = 0; i < (uint)layouts.size(); ++i)
+		{
+			RdrVertexInputElement& rElem = layouts[i];
+			memset(&rElem, 0, sizeof(rElem));
+			rElem.semantic = (RdrShaderSemantic)(i % kNumLayoutElements);
+			rElem.format = (RdrVertexInputFormat)((i / kNumLayoutElements) % 4);
+			rElem.streamIndex = (i / kNumLayoutElements) / 4;
+			rElem.byteOffset = (i % kNumLayoutElements) * 12;
+		}
+
+		const uint layoutSize = kNumLayoutElements * sizeof(RdrVertexInputElement);
+		std::map<Hashing::SHA1, uint> sha1Materials;
+		std::map<uint64, uint> hash64Materials;
+		for (uint i = 0; i < kNumLayouts; ++i)
+		{
+			const RdrVertexInputElement* pLayout = &layouts[i * kNumLayoutElements];
+
+			Hashing::SHA1 hash;
+			Hashing::SHA1::Finish(Hashing::SHA1::Begin(pLayout, layoutSize), hash);
+			sha1Materials.insert(std::make_pair(hash, i));
+			hash64Materials.insert(std::make_pair(Hashing::HashData64(pLayout, layoutSize), i));
+		}
+
+		uint sink = 0;
+		Timer::Reset(hTimer);
+		for (uint i = 0; i < kNumLookups; ++i)
+		{
+			const RdrVertexInputElement* pLayout = &layouts[(i % kNumLayouts) * kNumLayoutElements];
+
+			Hashing::SHA1 hash;
+			Hashing::SHA1::Finish(Hashing::SHA1::Begin(pLayout, layoutSize), hash);
+			sink += sha1Materials.find(hash)->second;
+		}
+		double sha1Ms = Timer::GetElapsedMillisecondsAndReset(hTimer);
+
+		for (uint i = 0; i < kNumLookups; ++i)
+		{
+			const RdrVertexInputElement* pLayout = &layouts[(i % kNumLayouts) * kNumLayoutElements];
+			sink += hash64Materials.find(Hashing::HashData64(pLayout, layoutSize))->second;
+		}
+		double hash64Ms = Timer::GetElapsedMilliseconds(hTimer);
+
+		DebugConsole::Print("  Material lookup (%u layouts): SHA1 key %.1f ns, HashData64 key %.1f ns (%u)\n", kNumLayouts,
+			sha1Ms * 1e6 / kNumLookups, hash64Ms * 1e6 / kNumLookups, sink & 1);
+	}
+}
+
+void HashBenchmark::Run()
+{
+	Timer::Handle hTimer = Timer::Create();
+
+	DebugConsole::Print("Hash benchmark:\n");
+	benchmarkThroughput(hTimer, 32);
+	benchmarkThroughput(hTimer, 256);
+	benchmarkThroughput(hTimer, 4096);
+	benchmarkThroughput(hTimer, 1024 * 1024);
+	benchmarkMaterialLookup(hTimer);
+
+	Timer::Release(hTimer);
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+// Measures hash throughput and the cost of keying a material lookup by its input layout.
+// Results are written to the debugger output.
+namespace HashBenchmark
+{
+	void Run();
+}
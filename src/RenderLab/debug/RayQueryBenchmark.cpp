@@ -0,0 +1,122 @@
+#include "Precompiled.h"
+#include "RayQueryBenchmark.h"
+#include "DebugConsole.h"
+#include "RayQuery.h"
+#include "Raycast.h"
+#include "Scene.h"
+#include "Entity.h"
+#include "components/ModelComponent.h"
+#include "UtilsLib/Timer.h"
+#include "UtilsLib/JobPool.h"
+#include <random>
+
+namespace
+{
+	const uint kNumRays = 256 * 1024;
+	// Testing every model is much slower, so it only runs a subset of the rays.
+	const uint kNumPerModelRays = 4 * 1024;
+
+	double calcMRaysPerSec(uint numRays, double ms)
+	{
+		return (numRays * 1e-6) / std::max(ms * 0.001, 1e-9);
+	}
+
+	// Rays from a sphere around the scene's models towards random points within their bounds.
+	// Consecutive rays share an origin so packets are as coherent as the picking and probe queries they stand in for.
+	void makeRays(std::vector<RayQuery>& rRays)
+	{
+		Vec3 vMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		Vec3 vMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (const ModelComponent& rModel : Scene::GetComponentAllocator()->GetModelComponentFreeList())
+		{
+			if (!rModel.GetEntity())
+				continue;
+
+			Vec3 vRadius(rModel.GetRadius(), rModel.GetRadius(), rModel.GetRadius());
+			vMin = Vec3Min(vMin, rModel.GetEntity()->GetPosition() - vRadius);
+			vMax = Vec3Max(vMax, rModel.GetEntity()->GetPosition() + vRadius);
+		}
+
+		Vec3 vCenter = (vMin + vMax) * 0.5f;
+		float fRadius = Vec3Length(vMax - vMin);
+
+		std::mt19937 rng(0);
+		std::uniform_real_distribution<float> unitDist(0.f, 1.f);
+		rRays.resize(kNumRays);
+		for (uint i = 0; i < kNumRays; i += ModelBvh::kRayPacketSize)
+		{
+			Vec3 vDir = Vec3Normalize(Vec3(unitDist(rng) - 0.5f, unitDist(rng) - 0.5f, unitDist(rng) - 0.5f) + Vec3(0.f, 0.f, 1e-4f));
+			Vec3 vOrigin = vCenter + vDir * fRadius;
+			for (uint nLane = 0; nLane < ModelBvh::kRayPacketSize; ++nLane)
+			{
+				Vec3 vTarget = vMin + (vMax - vMin) * Vec3(unitDist(rng), unitDist(rng), unitDist(rng));
+				rRays[i + nLane].origin = vOrigin;
+				rRays[i + nLane].direction = Vec3Normalize(vTarget - vOrigin);
+				rRays[i + nLane].maxDistance = FLT_MAX;
+			}
+		}
+	}
+
+	RayQueryHit castRayPerModel(const RayQuery& rRay)
+	{
+		RayQueryHit hit = { nullptr, rRay.maxDistance };
+		for (ModelComponent& rModel : Scene::GetComponentAllocator()->GetModelComponentFreeList())
+		{
+			float t;
+			if (rModel.GetEntity() && rayModelIntersect(rRay.origin, rRay.direction, &rModel, &t) && t < hit.distance)
+			{
+				hit.pModel = &rModel;
+				hit.distance = t;
+			}
+		}
+		return hit;
+	}
+}
+
+void RayQueryBenchmark::Run()
+{
+	Timer::Handle hTimer = Timer::Create();
+
+	RayQueryScene rayScene;
+	rayScene.Build();
+	double buildMs = Timer::GetElapsedMillisecondsAndReset(hTimer);
+
+	std::vector<RayQuery> rays;
+	makeRays(rays);
+
+	std::vector<RayQueryHit> hits(kNumRays);
+	Timer::Reset(hTimer);
+	rayScene.CastRays(rays.data(), kNumRays, hits.data());
+	double castMs = Timer::GetElapsedMillisecondsAndReset(hTimer);
+
+	std::vector<RayQueryHit> perModelHits(kNumPerModelRays);
+	for (uint i = 0; i < kNumPerModelRays; ++i)
+	{
+		perModelHits[i] = castRayPerModel(rays[i]);
+	}
+	double perModelMs = Timer::GetElapsedMilliseconds(hTimer);
+	Timer::Release(hTimer);
+
+	uint numHits = 0;
+	for (const RayQueryHit& rHit : hits)
+	{
+		if (rHit.pModel)
+			++numHits;
+	}
+
+	// Packets and single rays test the same triangles, but in a different order, so the distances can differ slightly.
+	uint numMismatches = 0;
+	for (uint i = 0; i < kNumPerModelRays; ++i)
+	{
+		const RayQueryHit& rHit = hits[i];
+		const RayQueryHit& rExpected = perModelHits[i];
+		bool bSameHit = (rHit.pModel != nullptr) == (rExpected.pModel != nullptr);
+		if (!bSameHit || (rHit.pModel && fabsf(rHit.distance - rExpected.distance) > 1e-4f * std::max(1.f, rExpected.distance)))
+			++numMismatches;
+	}
+
+	DebugConsole::Print("Ray query benchmark:\n");
+	DebugConsole::Print("  Scene BVH build: %.2f ms\n", buildMs);
+	DebugConsole::Print("  RayQueryScene: %.2f Mrays/s on %u threads (%u/%u hit)\n", calcMRaysPerSec(kNumRays, castMs), JobPool::GetThreadCount(), numHits, kNumRays);
+	DebugConsole::Print("  Per model: %.3f Mrays/s on 1 thread, %u/%u rays disagree\n", calcMRaysPerSec(kNumPerModelRays, perModelMs), numMismatches, kNumPerModelRays);
+}
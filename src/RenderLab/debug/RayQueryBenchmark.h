@@ -0,0 +1,8 @@
+#pragma once
+
+// Traces synthetic rays through the loaded scene with RayQueryScene and compares them against
+// testing every model in turn with rayModelIntersect().  Results are written to the debugger output.
+namespace RayQueryBenchmark
+{
+	void Run();
+}
@@ -179,6 +179,29 @@ bool Camera::CanSee(const Vec3& pos, float radius) const
 	return true;
 }
 
+bool Camera::CanSee(const Vec3& boundsMin, const Vec3& boundsMax) const
+{
+	if (m_fovY > Maths::kPi)
+	{
+		Vec3 halfSize = (boundsMax - boundsMin) * 0.5f;
+		return CanSee(boundsMin + halfSize, Vec3Length(halfSize));
+	}
+
+	for (int i = 0; i < 6; ++i)
+	{
+		// Test the corner furthest along the plane normal.
+		const Plane& rPlane = m_frustum.planes[i];
+		Vec3 corner(
+			(rPlane.m_normal.x >= 0.f) ? boundsMax.x : boundsMin.x,
+			(rPlane.m_normal.y >= 0.f) ? boundsMax.y : boundsMin.y,
+			(rPlane.m_normal.z >= 0.f) ? boundsMax.z : boundsMin.z);
+		if (rPlane.Distance(corner) < 0.f)
+			return false;
+	}
+
+	return true;
+}
+
 Vec3 Camera::CalcRayDirection(float x, float y) const
 {
 	float ndcX = 2.f * x - 1.f;
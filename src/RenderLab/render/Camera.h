@@ -35,6 +35,9 @@ public:
 
 	float GetFieldOfViewY() const;
 
+	bool IsOrtho() const;
+	float GetOrthoHeight() const;
+
 	float GetNearDist() const;
 	float GetFarDist() const;
 
@@ -50,6 +53,7 @@ public:
 	Quad GetFrustumQuad(float depth) const;
 
 	bool CanSee(const Vec3& pos, float radius) const;
+	bool CanSee(const Vec3& boundsMin, const Vec3& boundsMax) const;
 
 	// Calculate direction of ray from a point on the near plane.
 	Vec3 CalcRayDirection(float x, float y) const;
@@ -86,6 +90,16 @@ inline float Camera::GetFieldOfViewY() const
 	return m_fovY; 
 }
 
+inline bool Camera::IsOrtho() const
+{
+	return m_isOrtho;
+}
+
+inline float Camera::GetOrthoHeight() const
+{
+	return m_orthoHeight;
+}
+
 inline float Camera::GetNearDist() const
 { 
 	return m_nearDist; 
@@ -0,0 +1,50 @@
+#include "Precompiled.h"
+#include "ClusterCulling.h"
+#include "Camera.h"
+#include "RdrDrawOp.h"
+
+uint ClusterCulling::CullClusters(const Camera& rCamera, const Matrix44& mtxWorld,
+	const AssetLib::Model::SubObjectCluster* aClusters, uint nClusterCount,
+	RdrIndexRange* aOutRanges)
+{
+	Vec3 vScale(Vec3Length(Vec3(mtxWorld._11, mtxWorld._12, mtxWorld._13)),
+		Vec3Length(Vec3(mtxWorld._21, mtxWorld._22, mtxWorld._23)),
+		Vec3Length(Vec3(mtxWorld._31, mtxWorld._32, mtxWorld._33)));
+	float fRadiusScale = Vec3MaxComponent(vScale);
+
+	// Back-facing is preserved by affine transforms, so cones are tested in object space.
+	// Mirrored transforms flip the winding and ortho views have no single eye position, so those skip the cone test.
+	bool bTestCones = !rCamera.IsOrtho() && Matrix44Determinant(mtxWorld) > 0.f;
+	Vec3 vLocalCameraPos = Vec3TransformCoord(rCamera.GetPosition(), Matrix44Inverse(mtxWorld));
+
+	uint nRangeCount = 0;
+
+	for (uint i = 0; i < nClusterCount; ++i)
+	{
+		const AssetLib::Model::SubObjectCluster& rCluster = aClusters[i];
+
+		if (bTestCones && rCluster.fConeCutoff < 1.f)
+		{
+			Vec3 vToCluster = rCluster.vCenter - vLocalCameraPos;
+			if (Vec3Dot(vToCluster, rCluster.vConeAxis) >= rCluster.fConeCutoff * Vec3Length(vToCluster) + rCluster.fRadius)
+				continue;
+		}
+
+		if (!rCamera.CanSee(Vec3TransformCoord(rCluster.vCenter, mtxWorld), rCluster.fRadius * fRadiusScale))
+			continue;
+
+		// Clusters are stored in index order, so visible neighbors can be drawn as one range.
+		if (nRangeCount > 0 && aOutRanges[nRangeCount - 1].nIndexStart + aOutRanges[nRangeCount - 1].nIndexCount == rCluster.nIndexStart)
+		{
+			aOutRanges[nRangeCount - 1].nIndexCount += rCluster.nIndexCount;
+		}
+		else
+		{
+			aOutRanges[nRangeCount].nIndexStart = rCluster.nIndexStart;
+			aOutRanges[nRangeCount].nIndexCount = rCluster.nIndexCount;
+			++nRangeCount;
+		}
+	}
+
+	return nRangeCount;
+}
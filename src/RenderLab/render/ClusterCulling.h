@@ -0,0 +1,17 @@
+#pragma once
+
+#include "AssetLib/ModelAsset.h"
+
+class Camera;
+struct RdrIndexRange;
+
+// CPU culling of the triangle clusters generated at model import time.
+namespace ClusterCulling
+{
+	// Tests each cluster against the camera frustum and its normal cone, writing the visible
+	// index ranges to aOutRanges with adjacent ranges merged.  aOutRanges must hold nClusterCount entries.
+	// Returns the number of ranges written, which is 0 if every cluster was culled.
+	uint CullClusters(const Camera& rCamera, const Matrix44& mtxWorld,
+		const AssetLib::Model::SubObjectCluster* aClusters, uint nClusterCount,
+		RdrIndexRange* aOutRanges);
+}
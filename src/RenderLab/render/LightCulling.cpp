@@ -0,0 +1,433 @@
+#include "Precompiled.h"
+#include "LightCulling.h"
+#include "Camera.h"
+#include "UtilsLib/JobPool.h"
+#include <algorithm>
+#include <xmmintrin.h>
+
+namespace
+{
+	// View space lights in SoA form for testing four at a time.  Arrays are padded to a multiple of 4.
+	struct ViewSpaceLights
+	{
+		std::vector<float> posX;
+		std::vector<float> posY;
+		std::vector<float> posZ;
+		std::vector<float> radius;
+
+		// Spot lights only
+		std::vector<float> dirX;
+		std::vector<float> dirY;
+		std::vector<float> dirZ;
+		std::vector<float> coneBaseRadius;
+
+		uint count;
+	};
+
+	// View space extents of a cluster, matching the Frustum built by c_clustered_light_cull.hlsl.
+	struct ClusterFrustum
+	{
+		float nearMinX;
+		float nearMaxX;
+		float nearMinY;
+		float nearMaxY;
+		float farMinX;
+		float farMaxX;
+		float farMinY;
+		float farMaxY;
+		float minZ;
+		float maxZ;
+		Vec3 center;
+	};
+
+	struct AssignContext
+	{
+		const ClusteredLightCullingParams* pParams;
+		ViewSpaceLights spotLights;
+		ViewSpaceLights pointLights;
+		uint16* aOutLightIndices;
+	};
+
+	// The view matrix in the cull params is transposed for the shader, so rows of the transposed matrix produce each component.
+	Vec3 transformToView(const Matrix44& mtxViewTransposed, const Vec3& v, float w)
+	{
+		const Matrix44& m = mtxViewTransposed;
+		return Vec3(m._11 * v.x + m._12 * v.y + m._13 * v.z + m._14 * w,
+			m._21 * v.x + m._22 * v.y + m._23 * v.z + m._24 * w,
+			m._31 * v.x + m._32 * v.y + m._33 * v.z + m._34 * w);
+	}
+
+	void resizeLights(ViewSpaceLights& rLights, uint nCount, bool bSpotLights)
+	{
+		uint nPaddedCount = (nCount + 3) & ~3;
+		rLights.count = nCount;
+		rLights.posX.assign(nPaddedCount, 0.f);
+		rLights.posY.assign(nPaddedCount, 0.f);
+		rLights.posZ.assign(nPaddedCount, 0.f);
+		rLights.radius.assign(nPaddedCount, 0.f);
+		if (bSpotLights)
+		{
+			rLights.dirX.assign(nPaddedCount, 0.f);
+			rLights.dirY.assign(nPaddedCount, 0.f);
+			rLights.dirZ.assign(nPaddedCount, 0.f);
+			rLights.coneBaseRadius.assign(nPaddedCount, 0.f);
+		}
+	}
+
+	void initContext(AssignContext& rContext, const ClusteredLightCullingParams& rParams,
+		const SpotLight* aSpotLights, const PointLight* aPointLights)
+	{
+		rContext.pParams = &rParams;
+
+		ViewSpaceLights& rSpotLights = rContext.spotLights;
+		resizeLights(rSpotLights, rParams.spotLightCount, true);
+		for (uint i = 0; i < rParams.spotLightCount; ++i)
+		{
+			const SpotLight& rLight = aSpotLights[i];
+			Vec3 viewPos = transformToView(rParams.mtxView, rLight.position, 1.f);
+			Vec3 viewDir = transformToView(rParams.mtxView, rLight.direction, 0.f);
+			rSpotLights.posX[i] = viewPos.x;
+			rSpotLights.posY[i] = viewPos.y;
+			rSpotLights.posZ[i] = viewPos.z;
+			rSpotLights.radius[i] = rLight.radius;
+			rSpotLights.dirX[i] = viewDir.x;
+			rSpotLights.dirY[i] = viewDir.y;
+			rSpotLights.dirZ[i] = viewDir.z;
+			rSpotLights.coneBaseRadius[i] = rLight.radius * tanf(rLight.outerConeAngle);
+		}
+
+		ViewSpaceLights& rPointLights = rContext.pointLights;
+		resizeLights(rPointLights, rParams.pointLightCount, false);
+		for (uint i = 0; i < rParams.pointLightCount; ++i)
+		{
+			const PointLight& rLight = aPointLights[i];
+			Vec3 viewPos = transformToView(rParams.mtxView, rLight.position, 1.f);
+			rPointLights.posX[i] = viewPos.x;
+			rPointLights.posY[i] = viewPos.y;
+			rPointLights.posZ[i] = viewPos.z;
+			rPointLights.radius[i] = rLight.radius;
+		}
+	}
+
+	void getClusterDepthRange(uint z, float& rOutDepthMin, float& rOutDepthMax)
+	{
+		if (z == 0)
+		{
+			rOutDepthMin = 0.1f;
+			rOutDepthMax = CLUSTEREDLIGHTING_SPECIAL_NEAR_DEPTH;
+		}
+		else
+		{
+			const float kDepthRatio = CLUSTEREDLIGHTING_MAX_DEPTH / CLUSTEREDLIGHTING_SPECIAL_NEAR_DEPTH;
+			rOutDepthMin = CLUSTEREDLIGHTING_SPECIAL_NEAR_DEPTH * powf(kDepthRatio, (z - 1) / (CLUSTEREDLIGHTING_DEPTH_SLICES - 1.f));
+			rOutDepthMax = CLUSTEREDLIGHTING_SPECIAL_NEAR_DEPTH * powf(kDepthRatio, z / (CLUSTEREDLIGHTING_DEPTH_SLICES - 1.f));
+		}
+	}
+
+	ClusterFrustum buildClusterFrustum(const ClusteredLightCullingParams& rParams, uint x, uint y, uint z)
+	{
+		float depthMin, depthMax;
+		getClusterDepthRange(z, depthMin, depthMax);
+
+		// Screens that aren't divisible by the cluster size have partial clusters along the right and bottom edges.
+		float actualScreenClustersX = rParams.screenSize.x / rParams.clusterTileSize;
+		float actualScreenClustersY = rParams.screenSize.y / rParams.clusterTileSize;
+
+		// NDC to view space scale of each edge.
+		float minX = -(1.f - 2.f / actualScreenClustersX * x) / rParams.proj_11;
+		float maxX = -(1.f - 2.f / actualScreenClustersX * (x + 1)) / rParams.proj_11;
+		float minY = (1.f - 2.f / actualScreenClustersY * (y + 1)) / rParams.proj_22;
+		float maxY = (1.f - 2.f / actualScreenClustersY * y) / rParams.proj_22;
+
+		ClusterFrustum frustum;
+		frustum.nearMinX = minX * depthMin;
+		frustum.nearMaxX = maxX * depthMin;
+		frustum.nearMinY = minY * depthMin;
+		frustum.nearMaxY = maxY * depthMin;
+		frustum.farMinX = minX * depthMax;
+		frustum.farMaxX = maxX * depthMax;
+		frustum.farMinY = minY * depthMax;
+		frustum.farMaxY = maxY * depthMax;
+		frustum.minZ = depthMin;
+		frustum.maxZ = depthMax;
+
+		Vec3 boundsMin(min(frustum.nearMinX, frustum.farMinX), min(frustum.nearMinY, frustum.farMinY), depthMin);
+		Vec3 boundsMax(max(frustum.nearMaxX, frustum.farMaxX), max(frustum.nearMaxY, frustum.farMaxY), depthMax);
+		frustum.center = (boundsMin + boundsMax) * 0.5f;
+		return frustum;
+	}
+
+	inline __m128 dot3(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+	}
+
+	inline void normalize3(__m128& x, __m128& y, __m128& z)
+	{
+		__m128 len = _mm_sqrt_ps(dot3(x, y, z, x, y, z));
+		x = _mm_div_ps(x, len);
+		y = _mm_div_ps(y, len);
+		z = _mm_div_ps(z, len);
+	}
+
+	inline void cross3(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz, __m128& rOutX, __m128& rOutY, __m128& rOutZ)
+	{
+		rOutX = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+		rOutY = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+		rOutZ = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+	}
+
+	// Separating axis test of four spheres against the cluster along per-light axes.  See testFrustumAxis() in the shader.
+	inline __m128 testFrustumAxis(const ClusterFrustum& rFrustum, __m128 px, __m128 py, __m128 pz,
+		__m128 nx, __m128 ny, __m128 nz, __m128 radius)
+	{
+		__m128 base = _mm_sub_ps(_mm_setzero_ps(), dot3(nx, ny, nz, px, py, pz));
+
+		__m128 min1 = _mm_add_ps(base, _mm_min_ps(_mm_mul_ps(nx, _mm_set1_ps(rFrustum.nearMinX)), _mm_mul_ps(nx, _mm_set1_ps(rFrustum.nearMaxX))));
+		min1 = _mm_add_ps(min1, _mm_min_ps(_mm_mul_ps(ny, _mm_set1_ps(rFrustum.nearMinY)), _mm_mul_ps(ny, _mm_set1_ps(rFrustum.nearMaxY))));
+		min1 = _mm_add_ps(min1, _mm_mul_ps(nz, _mm_set1_ps(rFrustum.minZ)));
+
+		__m128 min2 = _mm_add_ps(base, _mm_min_ps(_mm_mul_ps(nx, _mm_set1_ps(rFrustum.farMinX)), _mm_mul_ps(nx, _mm_set1_ps(rFrustum.farMaxX))));
+		min2 = _mm_add_ps(min2, _mm_min_ps(_mm_mul_ps(ny, _mm_set1_ps(rFrustum.farMinY)), _mm_mul_ps(ny, _mm_set1_ps(rFrustum.farMaxY))));
+		min2 = _mm_add_ps(min2, _mm_mul_ps(nz, _mm_set1_ps(rFrustum.maxZ)));
+
+		return _mm_cmplt_ps(_mm_min_ps(min1, min2), radius);
+	}
+
+	// Returns a bitmask of the four point lights starting at nFirst that touch the cluster.
+	uint testPointLights(const ClusterFrustum& rFrustum, const ViewSpaceLights& rLights, uint nFirst)
+	{
+		__m128 px = _mm_loadu_ps(&rLights.posX[nFirst]);
+		__m128 py = _mm_loadu_ps(&rLights.posY[nFirst]);
+		__m128 pz = _mm_loadu_ps(&rLights.posZ[nFirst]);
+		__m128 radius = _mm_loadu_ps(&rLights.radius[nFirst]);
+
+		__m128 dx = _mm_sub_ps(_mm_set1_ps(rFrustum.center.x), px);
+		__m128 dy = _mm_sub_ps(_mm_set1_ps(rFrustum.center.y), py);
+		__m128 dz = _mm_sub_ps(_mm_set1_ps(rFrustum.center.z), pz);
+		normalize3(dx, dy, dz);
+
+		return _mm_movemask_ps(testFrustumAxis(rFrustum, px, py, pz, dx, dy, dz, radius));
+	}
+
+	// Returns a bitmask of the four spot lights starting at nFirst that touch the cluster.
+	// http://www.jonmanatee.com/blog/2015/1/20/improved-spotlight-culling-for-clustered-forward-shading.html
+	uint testSpotLights(const ClusterFrustum& rFrustum, const ViewSpaceLights& rLights, uint nFirst)
+	{
+		__m128 px = _mm_loadu_ps(&rLights.posX[nFirst]);
+		__m128 py = _mm_loadu_ps(&rLights.posY[nFirst]);
+		__m128 pz = _mm_loadu_ps(&rLights.posZ[nFirst]);
+		__m128 radius = _mm_loadu_ps(&rLights.radius[nFirst]);
+
+		__m128 dx = _mm_sub_ps(_mm_set1_ps(rFrustum.center.x), px);
+		__m128 dy = _mm_sub_ps(_mm_set1_ps(rFrustum.center.y), py);
+		__m128 dz = _mm_sub_ps(_mm_set1_ps(rFrustum.center.z), pz);
+		normalize3(dx, dy, dz);
+
+		// Coarse check vs spot light sphere.
+		__m128 coarse = testFrustumAxis(rFrustum, px, py, pz, dx, dy, dz, radius);
+		if (_mm_movemask_ps(coarse) == 0)
+			return 0;
+
+		__m128 lx = _mm_loadu_ps(&rLights.dirX[nFirst]);
+		__m128 ly = _mm_loadu_ps(&rLights.dirY[nFirst]);
+		__m128 lz = _mm_loadu_ps(&rLights.dirZ[nFirst]);
+
+		__m128 tx, ty, tz;
+		cross3(lx, ly, lz, dx, dy, dz, tx, ty, tz);
+		normalize3(tx, ty, tz);
+
+		__m128 cx, cy, cz;
+		cross3(tx, ty, tz, lx, ly, lz, cx, cy, cz);
+
+		// Direction from the light to the closest point on the cone's cap.
+		__m128 coneBaseRadius = _mm_loadu_ps(&rLights.coneBaseRadius[nFirst]);
+		__m128 bx = _mm_add_ps(_mm_mul_ps(lx, radius), _mm_mul_ps(cx, coneBaseRadius));
+		__m128 by = _mm_add_ps(_mm_mul_ps(ly, radius), _mm_mul_ps(cy, coneBaseRadius));
+		__m128 bz = _mm_add_ps(_mm_mul_ps(lz, radius), _mm_mul_ps(cz, coneBaseRadius));
+		normalize3(bx, by, bz);
+
+		__m128 nx, ny, nz;
+		cross3(tx, ty, tz, bx, by, bz, nx, ny, nz);
+
+		__m128 fine = testFrustumAxis(rFrustum, px, py, pz, nx, ny, nz, _mm_setzero_ps());
+		return _mm_movemask_ps(_mm_and_ps(coarse, fine));
+	}
+
+	// Writes up to nMaxLights indices of the lights touching a cluster, spot lights first.  Returns the number written.
+	uint cullClusterLights(const AssignContext& rContext, const ClusterFrustum& rFrustum, uint nMaxLights,
+		uint16* aOutIndices, uint* pOutSpotLightCount)
+	{
+		uint count = 0;
+
+		const ViewSpaceLights& rSpotLights = rContext.spotLights;
+		for (uint i = 0; i < rSpotLights.count && count < nMaxLights; i += 4)
+		{
+			uint mask = testSpotLights(rFrustum, rSpotLights, i);
+			for (uint bit = 0; bit < 4 && count < nMaxLights; ++bit)
+			{
+				if ((mask & (1 << bit)) && i + bit < rSpotLights.count)
+				{
+					aOutIndices[count++] = (uint16)(i + bit);
+				}
+			}
+		}
+
+		*pOutSpotLightCount = count;
+
+		const ViewSpaceLights& rPointLights = rContext.pointLights;
+		for (uint i = 0; i < rPointLights.count && count < nMaxLights; i += 4)
+		{
+			uint mask = testPointLights(rFrustum, rPointLights, i);
+			for (uint bit = 0; bit < 4 && count < nMaxLights; ++bit)
+			{
+				if ((mask & (1 << bit)) && i + bit < rPointLights.count)
+				{
+					aOutIndices[count++] = (uint16)(i + bit);
+				}
+			}
+		}
+
+		return count;
+	}
+
+	bool isValidLightSubset(const uint16* aLights, uint nCount, const uint16* aSortedExpected, uint nExpectedCount)
+	{
+		std::vector<uint16> lights(aLights, aLights + nCount);
+		std::sort(lights.begin(), lights.end());
+		if (std::adjacent_find(lights.begin(), lights.end()) != lights.end())
+			return false;
+
+		for (uint16 light : lights)
+		{
+			if (!std::binary_search(aSortedExpected, aSortedExpected + nExpectedCount, light))
+				return false;
+		}
+		return true;
+	}
+}
+
+void LightCulling::CalcSpotLightBounds(const Vec3& position, const Vec3& direction, float radius, float outerConeAngle,
+	Vec3& rOutCenter, float& rOutRadius)
+{
+	// The smallest sphere touching the apex and the rim of the cone's cap contains the whole lit volume.
+	// Past 60 degrees that sphere is larger than the light's range, which bounds it as well.
+	float coneBoundsRadius = radius / (2.f * max(cosf(outerConeAngle), 0.0001f));
+	if (coneBoundsRadius < radius)
+	{
+		rOutCenter = position + direction * coneBoundsRadius;
+		rOutRadius = coneBoundsRadius;
+	}
+	else
+	{
+		rOutCenter = position;
+		rOutRadius = radius;
+	}
+}
+
+float LightCulling::CalcScreenImportance(const Camera& rCamera, const Vec3& boundsCenter, float boundsRadius, const Vec3& color)
+{
+	float luminance = Vec3Dot(color, Vec3(0.2126f, 0.7152f, 0.0722f));
+
+	// Projected radius relative to half of the screen height.
+	float projectedRadius;
+	if (rCamera.IsOrtho())
+	{
+		projectedRadius = boundsRadius / (rCamera.GetOrthoHeight() * 0.5f);
+	}
+	else
+	{
+		Vec3 offset = boundsCenter - rCamera.GetPosition();
+		float distSqr = Vec3Dot(offset, offset);
+		float radiusSqr = boundsRadius * boundsRadius;
+		if (distSqr <= radiusSqr)
+			return luminance;
+
+		projectedRadius = boundsRadius / (sqrtf(distSqr - radiusSqr) * tanf(rCamera.GetFieldOfViewY() * 0.5f));
+	}
+
+	// The screen is 2 * aspect ratio by 2 in these units.
+	float coverage = Maths::kPi * projectedRadius * projectedRadius / (4.f * rCamera.GetAspectRatio());
+	return min(coverage, 1.f) * luminance;
+}
+
+uint LightCulling::GetClusteredLightIndexCount(const ClusteredLightCullingParams& rParams)
+{
+	return rParams.clusterCountX * rParams.clusterCountY * rParams.clusterCountZ * CLUSTEREDLIGHTING_BLOCK_SIZE;
+}
+
+void LightCulling::AssignClusteredLights(const ClusteredLightCullingParams& rParams,
+	const SpotLight* aSpotLights, const PointLight* aPointLights, uint16* aOutLightIndices)
+{
+	AssignContext context;
+	initContext(context, rParams, aSpotLights, aPointLights);
+	context.aOutLightIndices = aOutLightIndices;
+
+	// Each job bins a row of clusters.
+	JobPool::ParallelFor(rParams.clusterCountY * rParams.clusterCountZ, 1, [](uint nBegin, uint nEnd, void* pUserData)
+	{
+		const AssignContext* pContext = (const AssignContext*)pUserData;
+		const ClusteredLightCullingParams& rParams = *pContext->pParams;
+		for (uint nRow = nBegin; nRow < nEnd; ++nRow)
+		{
+			uint y = nRow % rParams.clusterCountY;
+			uint z = nRow / rParams.clusterCountY;
+			for (uint x = 0; x < rParams.clusterCountX; ++x)
+			{
+				uint clusterIdx = x + y * rParams.clusterCountX + z * rParams.clusterCountX * rParams.clusterCountY;
+				uint16* pBlock = pContext->aOutLightIndices + clusterIdx * CLUSTEREDLIGHTING_BLOCK_SIZE;
+
+				uint spotLightCount;
+				uint lightCount = cullClusterLights(*pContext, buildClusterFrustum(rParams, x, y, z), CLUSTEREDLIGHTING_MAX_LIGHTS_PER,
+					pBlock + LIGHTLIST_NUM_LIGHT_TYPES, &spotLightCount);
+				pBlock[0] = (uint16)spotLightCount;
+				pBlock[1] = (uint16)(lightCount - spotLightCount);
+			}
+		}
+	}, &context);
+}
+
+uint LightCulling::ValidateClusteredLights(const ClusteredLightCullingParams& rParams,
+	const SpotLight* aSpotLights, const PointLight* aPointLights, const uint16* aLightIndices)
+{
+	AssignContext context;
+	initContext(context, rParams, aSpotLights, aPointLights);
+
+	// Full light lists so overflowing clusters can be checked too.
+	std::vector<uint16> expected(rParams.spotLightCount + rParams.pointLightCount + 1);
+
+	uint numMismatches = 0;
+	for (uint z = 0; z < rParams.clusterCountZ; ++z)
+	{
+		for (uint y = 0; y < rParams.clusterCountY; ++y)
+		{
+			for (uint x = 0; x < rParams.clusterCountX; ++x)
+			{
+				uint spotLightCount;
+				uint lightCount = cullClusterLights(context, buildClusterFrustum(rParams, x, y, z), (uint)expected.size(),
+					expected.data(), &spotLightCount);
+				uint pointLightCount = lightCount - spotLightCount;
+
+				// Overflowing clusters keep any subset of the lights, but spot lights are always added first.
+				uint clusterIdx = x + y * rParams.clusterCountX + z * rParams.clusterCountX * rParams.clusterCountY;
+				const uint16* pBlock = aLightIndices + clusterIdx * CLUSTEREDLIGHTING_BLOCK_SIZE;
+				uint actualSpotLightCount = pBlock[0];
+				uint actualPointLightCount = pBlock[1];
+
+				bool bValid = (actualSpotLightCount == min(spotLightCount, (uint)CLUSTEREDLIGHTING_MAX_LIGHTS_PER))
+					&& (actualSpotLightCount + actualPointLightCount == min(lightCount, (uint)CLUSTEREDLIGHTING_MAX_LIGHTS_PER));
+				bValid = bValid && isValidLightSubset(pBlock + LIGHTLIST_NUM_LIGHT_TYPES, actualSpotLightCount,
+					expected.data(), spotLightCount);
+				bValid = bValid && isValidLightSubset(pBlock + LIGHTLIST_NUM_LIGHT_TYPES + actualSpotLightCount, actualPointLightCount,
+					expected.data() + spotLightCount, pointLightCount);
+
+				if (!bValid)
+				{
+					++numMismatches;
+				}
+			}
+		}
+	}
+
+	return numMismatches;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "RdrShaderTypes.h"
+#include "../../data/shaders/light_types.h"
+
+class Camera;
+
+// CPU light culling.
+namespace LightCulling
+{
+	// Bounding sphere of the volume lit by a spot light.
+	void CalcSpotLightBounds(const Vec3& position, const Vec3& direction, float radius, float outerConeAngle,
+		Vec3& rOutCenter, float& rOutRadius);
+
+	// Ranks how visible a light is so the most important lights get shadows and fit in the light lists.
+	// Approximates the fraction of the screen covered by the light's bounds, weighted by the light's luminance.
+	float CalcScreenImportance(const Camera& rCamera, const Vec3& boundsCenter, float boundsRadius, const Vec3& color);
+
+	// Number of uint16 light indices in a clustered light list for the params' cluster grid.
+	uint GetClusteredLightIndexCount(const ClusteredLightCullingParams& rParams);
+
+	// CPU version of c_clustered_light_cull.hlsl.  Uses the same depth slicing, froxel tests, and output layout:
+	// one CLUSTEREDLIGHTING_BLOCK_SIZE block per cluster holding the spot and point light counts followed by spot light
+	// indices and then point light indices, clamped to CLUSTEREDLIGHTING_MAX_LIGHTS_PER.
+	// rParams must be filled exactly as it is for the shader, including the transposed view matrix.
+	// Lights are tested four at a time and clusters are split across the job pool.
+	void AssignClusteredLights(const ClusteredLightCullingParams& rParams,
+		const SpotLight* aSpotLights, const PointLight* aPointLights, uint16* aOutLightIndices);
+
+	// Checks a light list produced by the shader against the CPU assignment.  The shader's light order within a cluster
+	// isn't deterministic, and neither is the subset it keeps when a cluster overflows, so clusters are compared as sets.
+	// Returns the number of clusters that don't match.
+	uint ValidateClusteredLights(const ClusteredLightCullingParams& rParams,
+		const SpotLight* aSpotLights, const PointLight* aPointLights, const uint16* aLightIndices);
+}
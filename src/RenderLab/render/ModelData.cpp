@@ -10,6 +10,8 @@
 #include "AssetLib/AssetLibrary.h"
 #include "UtilsLib/Hash.h"
 
+static_assert(ModelData::kMaxLods == AssetLib::Model::kMaxLods, "ModelData LOD count must match the model asset");
+
 namespace
 {
 	ModelDataFreeList s_models;
@@ -55,9 +57,32 @@ ModelData* ModelData::LoadFromFile(const CachedString& modelName)
 	for (uint i = 0; i < pModel->m_subObjectCount; ++i)
 	{
 		const AssetLib::Model::SubObject& rBinSubobject = pBinData->subobjects.ptr[i];
-		pModel->m_subObjects[i].hGeo = RdrResourceSystem::CreateGeo(pModel->m_hVertexBuffer, rBinSubobject.nVertexStride, rBinSubobject.nVertexStartByteOffset, rBinSubobject.nVertexCount,
+		ModelData::SubObject& rSubObject = pModel->m_subObjects[i];
+		rSubObject.hGeo = RdrResourceSystem::CreateGeo(pModel->m_hVertexBuffer, rBinSubobject.nVertexStride, rBinSubobject.nVertexStartByteOffset, rBinSubobject.nVertexCount,
 			pModel->m_hIndexBuffer, rBinSubobject.nIndexStartByteOffset, rBinSubobject.nIndexCount, rBinSubobject.eIndexFormat, RdrTopology::TriangleList, rBinSubobject.vBoundsMin, rBinSubobject.vBoundsMax, CREATE_BACKPOINTER(pModel));
 
+		// LODs share the subobject's vertices and only differ in their index range.
+		rSubObject.ahLodGeos[0] = rSubObject.hGeo;
+		rSubObject.afLodErrors[0] = 0.f;
+		rSubObject.nLodCount = 1;
+
+		// The file could be stale or corrupt, so LODs that don't fit the LOD table or this model's LODs are dropped.
+		uint nBinLodCount = rBinSubobject.nLodCount;
+		if (nBinLodCount >= kMaxLods || rBinSubobject.nLodStart > pBinData->nTotalLodCount || nBinLodCount > pBinData->nTotalLodCount - rBinSubobject.nLodStart)
+		{
+			Warning("Invalid LOD range in model %s, subobject %u", modelName.getString(), i);
+			nBinLodCount = 0;
+		}
+
+		for (uint n = 0; n < nBinLodCount; ++n)
+		{
+			const AssetLib::Model::SubObjectLod& rBinLod = pBinData->lods.ptr[rBinSubobject.nLodStart + n];
+			rSubObject.ahLodGeos[rSubObject.nLodCount] = RdrResourceSystem::CreateGeo(pModel->m_hVertexBuffer, rBinSubobject.nVertexStride, rBinSubobject.nVertexStartByteOffset, rBinSubobject.nVertexCount,
+				pModel->m_hIndexBuffer, rBinLod.nIndexStartByteOffset, rBinLod.nIndexCount, rBinSubobject.eIndexFormat, RdrTopology::TriangleList, rBinSubobject.vBoundsMin, rBinSubobject.vBoundsMax, CREATE_BACKPOINTER(pModel));
+			rSubObject.afLodErrors[rSubObject.nLodCount] = rBinLod.fError * AssetLib::Model::kLodErrorMargin;
+			++rSubObject.nLodCount;
+		}
+
 		pModel->m_subObjects[i].pMaterial = RdrMaterial::Create(rBinSubobject.strMaterialName, pModel->GetVertexElements(i), pModel->GetNumVertexElements(i));
 	}
 
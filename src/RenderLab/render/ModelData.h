@@ -14,6 +14,7 @@ class ModelData
 {
 public:
 	static constexpr uint kMaxSubObjects = 16;
+	static constexpr uint kMaxLods = 4;
 
 	static ModelData* LoadFromFile(const CachedString& modelName);
 
@@ -21,6 +22,11 @@ public:
 	{
 		RdrGeoHandle hGeo;
 		const RdrMaterial* pMaterial;
+
+		// Detail levels, starting with hGeo.  Errors are object space deviations from the full detail geometry, including the selection margin.
+		RdrGeoHandle ahLodGeos[kMaxLods];
+		float afLodErrors[kMaxLods];
+		uint nLodCount;
 	};
 
 	void Release();
@@ -29,6 +35,9 @@ public:
 
 	const SubObject& GetSubObject(const uint index) const;
 
+	// Selects the lowest detail geometry whose error is within fMaxError (object space).
+	RdrGeoHandle SelectLodGeo(const uint index, float fMaxError) const;
+
 	uint GetNumSubObjects() const;
 
 	const char* GetName() const;
@@ -65,6 +74,18 @@ inline const ModelData::SubObject& ModelData::GetSubObject(const uint index) con
 	return m_subObjects[index];
 }
 
+inline RdrGeoHandle ModelData::SelectLodGeo(const uint index, float fMaxError) const
+{
+	const SubObject& rSubObject = m_subObjects[index];
+
+	uint nLod = 0;
+	while (nLod + 1 < rSubObject.nLodCount && rSubObject.afLodErrors[nLod + 1] <= fMaxError)
+	{
+		++nLod;
+	}
+	return rSubObject.ahLodGeos[nLod];
+}
+
 inline uint ModelData::GetNumSubObjects() const
 {
 	return m_subObjectCount;
@@ -6,22 +6,7 @@
 #include "RdrFrameMem.h"
 #include "RdrAction.h"
 #include "Renderer.h"
-
-// References:
-// Simulating Ocean Water https://people.cs.clemson.edu/~jtessen/papers_files/coursenotes2004.pdf
-// http://www.keithlantz.net/2011/10/ocean-simulation-part-one-using-the-discrete-fourier-transform/
-// http://malideveloper.arm.com/sample-code/ocean-rendering-with-fast-fourier-transform/
-
-struct FourierGridCell
-{
-	Complex h0;
-	Vec2 k;
-	float dispersion;
-
-	// Derivative values used for choppiness displacement
-	float dx;
-	float dz;
-};
+#include "OceanGrid.h"
 
 namespace
 {
@@ -33,173 +18,119 @@ namespace
 		{ RdrShaderSemantic::Texcoord, 0, RdrVertexInputFormat::R_F32, 0, 24, RdrVertexInputClass::PerVertex, 0 },
 	};
 
-	struct OceanVertex
-	{
-		Vec3 position;
-		Vec3 normal;
-		float jacobian;
-	};
+	// Smallest grid a LOD level can reduce the tile to.
+	static const int kMinLodCells = 8;
 
-	//////////////////////////////////////////////////////////////////////////
+	static const float kSurfaceHeight = 5.f;
 
-	static const float kGravity = 9.8f;
-	static const float kTimePeriod = 200.f; // Repeat time in seconds.
+	// Fixed point iterations to undo choppiness displacement in height queries.
+	static const int kQueryDisplacementIterations = 4;
+}
 
-	Complex randomGaussian()
+Ocean::Ocean()
+	: m_numLods(0)
+	, m_hasTileConstants(false)
+	, m_gridSize(0)
+	, m_currSimState(0)
+	, m_hasSimStates(false)
+	, m_initialized(false)
+{
+	m_latestQuerySnapshot = -1;
+	for (int i = 0; i < 2; ++i)
 	{
-		// http://www.design.caltech.edu/erik/Misc/Gaussian.html
-		float x1, x2, w;
-
-		do 
-		{
-			x1 = 2.f * randFloat() - 1.f;
-			x2 = 2.f * randFloat() - 1.f;
-			w = x1 * x1 + x2 * x2;
-		} 
-		while (w >= 1.f);
-
-		w = sqrt((-2.f * log(w)) / w);
-
-		return Complex(x1 * w, x2 * w);
+		m_aSimVertices[i] = nullptr;
+		m_aSimSamples[i] = nullptr;
+		m_aQuerySamples[i] = nullptr;
+		m_querySequence[i] = 0;
 	}
 
-	float phillipsSpectrum(const Vec2& k, float A, const Vec2& windDir, float windSpeed)
-	{
-		// Phillips spectrum - Figure 40 from Tessendorf paper
-		// P(k) = A * (exp(-1 / (_k * L)^2) / _k^4) * |k' * w|^2
-		// A = wave height scalar
-		// L = V^2 / g
-		// V = Wind speed
-		// w = Wind dir
-		// _k = length(k)
-		// k' = normalized k
-
-		float kLen = Vec2Length(k);
-		if (kLen < Maths::kEpsilon)
-			return 0.f; // Avoid divide by zero
+}
 
-		float L = (windSpeed * windSpeed) / kGravity;
-		float kLSqr = (kLen * L) * (kLen * L);
+void Ocean::Init(float tileWorldSize, UVec2 tileCounts, int fourierGridSize, float waveHeightScalar, const Vec2& wind)
+{
+	m_initialized = true;
+	m_timer = 0.f;
+	m_simAccumTime = 0.f;
+	m_hasSimStates = false;
+	m_gridSize = fourierGridSize;
+	m_tileSize = tileWorldSize;
 
-		float kDotWind = Vec2Dot(Vec2Normalize(k), windDir);
+	m_tileCounts.x = std::max(tileCounts.x, 1u);
+	m_tileCounts.y = std::max(tileCounts.y, 1u);
 
-		// Spectrum results
-		float res = kDotWind * kDotWind * (A * exp(-1.f / kLSqr)) / (kLen * kLen * kLen * kLen);
+	// The simulation wraps, so the last row and column of vertices repeat the first ones a tile over.
+	// Every tile and LOD level draws from this one set of vertices, see OceanGrid for the layout.
+	int numVerts = OceanGrid::CalcVertexCount(m_gridSize);
 
-		// Suppress small waves
-		const float kSupressionPercent = 0.001f;
-		float l = L * kSupressionPercent;
-		float waveSuppression = exp(-kLen * kLen * l * l);
+	for (int i = 0; i < 2; ++i)
+	{
+		delete[] m_aSimVertices[i];
+		m_aSimVertices[i] = new OceanVertex[numVerts];
 
-		return res * waveSuppression;
-	}
+		delete[] m_aSimSamples[i];
+		m_aSimSamples[i] = new Vec3[m_gridSize * m_gridSize];
 
-	float calcDispersion(const Vec2 k)
-	{
-		// Dispersion - Figure 35 from Tessendorf paper
-		// w(k) = floor(w'(k) / w0) * w0
-		// w'(k) = sqrt(g * |k|)
-		// w0 = 2 * pi / T
-		// T = repeat time
-		float w0 = Maths::kTwoPi / kTimePeriod;
-		float w = sqrt(kGravity * Vec2Length(k));
-		return floor(w / w0) * w0;
+		delete[] m_aQuerySamples[i];
+		m_aQuerySamples[i] = new Vec3[m_gridSize * m_gridSize];
+		m_querySequence[i] = 0;
 	}
-}
+	m_latestQuerySnapshot = -1;
 
-Ocean::Ocean()
-	: m_initialized(false)
-{
+	OceanVertex* aVertices = (OceanVertex*)RdrFrameMem::AllocAligned(sizeof(OceanVertex) * numVerts, 16);
+	m_hVertexBuffer = RdrResourceSystem::CreateVertexBuffer(aVertices, sizeof(OceanVertex), numVerts, RdrResourceAccessFlags::None, CREATE_BACKPOINTER(this));
 
-}
+	// Each LOD level skips every other vertex of the previous level.
+	// Neighboring tiles can be at different levels, so every level has skirts to cover the cracks along tile edges.
+	std::vector<uint> indices;
+	uint aLodIndexStarts[kMaxLods];
+	uint aLodIndexCounts[kMaxLods];
 
-void Ocean::GenerateFourierGrid(int gridSize, float tileWorldSize, const Vec2& wind)
-{
-	// Destroy the old grid if we have one.
-	if (m_grid)
+	m_numLods = 0;
+	for (int step = 1; m_numLods < kMaxLods && (m_gridSize / step) >= kMinLodCells; step *= 2)
 	{
-		delete[] m_grid;
+		aLodIndexStarts[m_numLods] = (uint)indices.size();
+		OceanGrid::AppendLodIndices(m_gridSize, step, indices);
+		aLodIndexCounts[m_numLods] = (uint)indices.size() - aLodIndexStarts[m_numLods];
+		++m_numLods;
 	}
 
-	// Allocate the new grid.
-	m_tileSize = tileWorldSize;
-	m_gridSize = gridSize;
-	m_grid = new FourierGridCell[m_gridSize * m_gridSize];
-
-	m_h = new Complex[m_gridSize * m_gridSize];
-	m_hDx = new Complex[m_gridSize * m_gridSize];
-	m_hDz = new Complex[m_gridSize * m_gridSize];
-	m_hSlopeX = new Complex[m_gridSize * m_gridSize];
-	m_hSlopeZ = new Complex[m_gridSize * m_gridSize];
-
-	// Generate
-	Vec2 windDir = Vec2Normalize(wind);
-	float windSpeed = Vec2Length(wind);
-
-	int gridHalfSize = m_gridSize / 2;
-	float kScalar = Maths::kTwoPi / m_tileSize;
+	m_simulation.Init(m_gridSize, m_tileSize, waveHeightScalar, wind, OceanGrid::CalcSkirtDepth(m_tileSize / m_gridSize, m_numLods));
 
-	for (int m = 0; m < m_gridSize; ++m)
+	RdrIndexBufferFormat eIndexFormat;
+	uint indexSize;
+	void* pIndexData;
+	if (numVerts <= 0xffff)
 	{
-		for (int n = 0; n < m_gridSize; ++n)
+		eIndexFormat = RdrIndexBufferFormat::R16_UINT;
+		indexSize = sizeof(uint16);
+
+		uint16* aIndices16 = (uint16*)RdrFrameMem::AllocAligned(sizeof(uint16) * indices.size(), 16);
+		for (uint i = 0; i < (uint)indices.size(); ++i)
 		{
-			int idx = (m * m_gridSize) + n;
-			FourierGridCell& rCell = m_grid[idx];
-
-			rCell.k.x = (float)((n > gridHalfSize) ? (n - m_gridSize) : n);
-			rCell.k.y = (float)((m > gridHalfSize) ? (m - m_gridSize) : m);
-			rCell.k *= kScalar;
-
-			Complex gauss = randomGaussian();
-			float phillips = sqrt(phillipsSpectrum(rCell.k, m_waveHeightScalar, windDir, windSpeed));
-			rCell.h0 = gauss * phillips / sqrt(2.f);
-			rCell.dispersion = calcDispersion(rCell.k);
-
-			// Derivatives used for displacement/normals
-			float len = Vec2Length(rCell.k);
-			rCell.dx = rCell.k.x / (len + 0.00001f);
-			rCell.dz = -rCell.k.y / (len + 0.00001f);
+			aIndices16[i] = (uint16)indices[i];
 		}
+		pIndexData = aIndices16;
 	}
-}
-
-void Ocean::Init(float tileWorldSize, UVec2 tileCounts, int fourierGridSize, float waveHeightScalar, const Vec2& wind)
-{
-	m_initialized = true;
-	m_timer = 0.f;
-	m_waveHeightScalar = waveHeightScalar;
+	else
+	{
+		eIndexFormat = RdrIndexBufferFormat::R32_UINT;
+		indexSize = sizeof(uint);
 
-	m_fft.Init(fourierGridSize);
-	GenerateFourierGrid(fourierGridSize, tileWorldSize, wind);
+		uint* aIndices32 = (uint*)RdrFrameMem::AllocAligned(sizeof(uint) * indices.size(), 16);
+		memcpy(aIndices32, indices.data(), sizeof(uint) * indices.size());
+		pIndexData = aIndices32;
+	}
 
-	int numVerts = m_gridSize * m_gridSize;
-	OceanVertex* aVertices = (OceanVertex*)RdrFrameMem::AllocAligned(sizeof(OceanVertex) * numVerts, 16);
+	m_hIndexBuffer = RdrResourceSystem::CreateIndexBuffer(pIndexData, indexSize * (uint)indices.size(), RdrResourceAccessFlags::None, CREATE_BACKPOINTER(this));
 
-	const int numColumns = (m_gridSize - 1);
-	const int numRowTris = numColumns * 2;
-	const int numTriangles = (m_gridSize - 1) * numRowTris;
-	uint16* aIndices = (uint16*)RdrFrameMem::AllocAligned(sizeof(uint16) * numTriangles * 3, 16);
-	
-	for (int m = 0; m < m_gridSize - 1; ++m)
+	for (int i = 0; i < m_numLods; ++i)
 	{
-		for (int n = 0; n < m_gridSize - 1; ++n)
-		{
-			int idx = (numRowTris * m * 3) + (n * 2 * 3);
-			aIndices[idx + 0] = (m * m_gridSize) + n;
-			aIndices[idx + 1] = ((m + 1) * m_gridSize) + n;
-			aIndices[idx + 2] = (m * m_gridSize) + n + 1;
-
-			aIndices[idx + 3] = (m * m_gridSize) + n + 1;
-			aIndices[idx + 4] = ((m + 1) * m_gridSize) + n;
-			aIndices[idx + 5] = ((m + 1) * m_gridSize) + n + 1;
-		}
+		m_ahLodGeos[i] = RdrResourceSystem::CreateGeo(
+			m_hVertexBuffer, sizeof(OceanVertex), 0, numVerts,
+			m_hIndexBuffer, aLodIndexStarts[i] * indexSize, aLodIndexCounts[i], eIndexFormat,
+			RdrTopology::TriangleList, Vec3(-0.5f, 0.f, -0.5f) * m_tileSize, Vec3(0.5f, 0.f, 0.5f) * m_tileSize, CREATE_BACKPOINTER(this));
 	}
 
-	m_hGeo = RdrResourceSystem::CreateGeo(
-		aVertices, sizeof(aVertices[0]), numVerts,
-		aIndices, numTriangles * 3, RdrIndexBufferFormat::R16_UINT,
-		RdrTopology::TriangleList, Vec3(0.f, 0.f, 0.f), Vec3(1.f, 0.f, 1.f), CREATE_BACKPOINTER(this));
-
 	// Setup pixel material
 	m_material.Init("Ocean", RdrMaterialFlags::NeedsLighting);
 	m_material.FillConstantBuffer(nullptr, 16, RdrResourceAccessFlags::CpuRW_GpuRO, CREATE_BACKPOINTER(this));
@@ -224,20 +155,10 @@ void Ocean::Init(float tileWorldSize, UVec2 tileCounts, int fourierGridSize, flo
 		rasterState,
 		RdrDepthStencilState(true, true, RdrComparisonFunc::Equal));
 
-	// Setup per-object constants
-	Matrix44 mtxWorld = Matrix44Translation(Vec3(0.f, 5.f, 0.f));
-	uint constantsSize = sizeof(VsPerObject);
-	VsPerObject* pVsPerObject = (VsPerObject*)RdrFrameMem::AllocAligned(constantsSize, 16);
-	pVsPerObject->mtxWorld = Matrix44Transpose(mtxWorld);
-
-	m_hVsPerObjectConstantBuffer = RdrResourceSystem::CreateUpdateConstantBuffer(m_hVsPerObjectConstantBuffer,
-		pVsPerObject, constantsSize, RdrResourceAccessFlags::CpuRW_GpuRO, CREATE_BACKPOINTER(this));
-}
-
-Vec2 Ocean::GetDisplacement(int n, int m)
-{
-	int idx = (m * m_gridSize) + n;
-	return Vec2(m_hDx[idx].real(), m_hDz[idx].real());
+	// Per-tile constants are filled in once the camera position is known.
+	m_ahTileConstants.clear();
+	m_ahTileConstants.resize(m_tileCounts.x * m_tileCounts.y);
+	m_hasTileConstants = false;
 }
 
 void Ocean::Update()
@@ -245,88 +166,193 @@ void Ocean::Update()
 	if (!m_initialized)
 		return;
 
-	m_timer += Time::FrameTime();
+	int numVerts = OceanGrid::CalcVertexCount(m_gridSize);
+	OceanVertex* aVertices = (OceanVertex*)RdrFrameMem::AllocAligned(sizeof(OceanVertex) * numVerts, 16);
 
-	// Update geometry
-	OceanVertex* aVertices = (OceanVertex*)RdrFrameMem::AllocAligned(sizeof(OceanVertex) * m_gridSize * m_gridSize, 16);
-	
-	// Generate h~ values for each point in the grid.
-	for (int m = 0; m < m_gridSize; ++m)
+	int querySlot = (m_latestQuerySnapshot.load(std::memory_order_relaxed) == 0) ? 1 : 0;
+	BeginQuerySnapshotWrite(querySlot);
+
+	if (g_debugState.oceanSimRate <= 0.f)
+	{
+		// Simulate every frame.
+		m_timer += Time::FrameTime();
+		m_simulation.Simulate(m_timer, aVertices, m_aQuerySamples[querySlot]);
+		m_hasSimStates = false;
+	}
+	else
 	{
-		for (int n = 0; n < m_gridSize; ++n)
+		// Simulate at a fixed rate and interpolate between the last two states.
+		// m_aSimVertices[m_currSimState] is the state at m_timer, the other is one step earlier.
+		const float stepTime = 1.f / g_debugState.oceanSimRate;
+		m_simAccumTime += Time::FrameTime();
+
+		int numSteps = (int)(m_simAccumTime / stepTime);
+		m_simAccumTime -= numSteps * stepTime;
+		m_timer += numSteps * stepTime;
+
+		if (!m_hasSimStates || numSteps >= 2)
+		{
+			// Both states are stale.
+			m_simulation.Simulate(m_timer - stepTime, m_aSimVertices[!m_currSimState], m_aSimSamples[!m_currSimState]);
+			m_simulation.Simulate(m_timer, m_aSimVertices[m_currSimState], m_aSimSamples[m_currSimState]);
+			m_hasSimStates = true;
+		}
+		else if (numSteps == 1)
 		{
-			// Figure 43 from Tessendorf paper
-			// h~(k, t) = h0(k) * exp(i * w(k) * t)
-			//		  + conj(h0(-k)) * exp(-i * w(k) * t)
-			int idx = (m * m_gridSize) + n;
-			const FourierGridCell& rCell = m_grid[idx];
-
-			// Negative frequency
-			int n2 = (n == 0) ? 0 : (m_gridSize - n);
-			int m2 = (m == 0) ? 0 : (m_gridSize - m);
-			int idxNeg = (m2 * m_gridSize) + n2;
-			const FourierGridCell& rCellNeg = m_grid[idxNeg];
-
-			// Calculate h~
-			float c = cos(rCell.dispersion * m_timer);
-			float s = sin(rCell.dispersion * m_timer);
-			m_h[idx] = rCell.h0 * Complex(c, s) + rCellNeg.h0 * Complex(c, -s);
-
-			m_hSlopeX[idx] = m_h[idx] * Complex(0, rCell.k.x);
-			m_hSlopeZ[idx] = m_h[idx] * Complex(0, rCell.k.y);
-			m_hDx[idx] = m_h[idx] * Complex(0, rCell.dx);
-			m_hDz[idx] = m_h[idx] * Complex(0, rCell.dz);
+			m_currSimState = !m_currSimState;
+			m_simulation.Simulate(m_timer, m_aSimVertices[m_currSimState], m_aSimSamples[m_currSimState]);
 		}
+
+		float t = std::min(m_simAccumTime / stepTime, 1.f);
+		m_simulation.Interpolate(m_aSimVertices[!m_currSimState], m_aSimVertices[m_currSimState],
+			m_aSimSamples[!m_currSimState], m_aSimSamples[m_currSimState], t, aVertices, m_aQuerySamples[querySlot]);
+	}
+
+	EndQuerySnapshotWrite(querySlot);
+
+	g_pRenderer->GetResourceCommandList().UpdateBuffer(m_hVertexBuffer, aVertices, numVerts, CREATE_BACKPOINTER(this));
+}
+
+void Ocean::BeginQuerySnapshotWrite(int slot)
+{
+	// Odd sequence numbers mark a snapshot as being written.
+	m_querySequence[slot].fetch_add(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+void Ocean::EndQuerySnapshotWrite(int slot)
+{
+	m_querySequence[slot].fetch_add(1, std::memory_order_release);
+	m_latestQuerySnapshot.store(slot, std::memory_order_release);
+}
+
+const Vec3* Ocean::BeginQueryRead(int* pOutSlot, uint* pOutSequence) const
+{
+	while (true)
+	{
+		int slot = m_latestQuerySnapshot.load(std::memory_order_acquire);
+		if (slot < 0)
+			return nullptr;
+
+		uint sequence = m_querySequence[slot].load(std::memory_order_acquire);
+		if (sequence & 1)
+			continue; // The writer lapped this reader and is updating the snapshot.
+
+		*pOutSlot = slot;
+		*pOutSequence = sequence;
+		return m_aQuerySamples[slot];
 	}
-	
-	for (int m = 0; m < m_gridSize; m++)
+}
+
+bool Ocean::EndQueryRead(int slot, uint sequence) const
+{
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return m_querySequence[slot].load(std::memory_order_relaxed) == sequence;
+}
+
+Vec3 Ocean::SampleQuerySnapshot(const Vec3* aSamples, const Vec2& gridPos) const
+{
+	// Bilinear sample of the wrapping grid.
+	float fx = floorf(gridPos.x);
+	float fy = floorf(gridPos.y);
+	float tx = gridPos.x - fx;
+	float ty = gridPos.y - fy;
+
+	int mask = m_gridSize - 1;
+	int x0 = (int)fx & mask;
+	int y0 = (int)fy & mask;
+	int x1 = (x0 + 1) & mask;
+	int y1 = (y0 + 1) & mask;
+
+	const Vec3& s00 = aSamples[y0 * m_gridSize + x0];
+	const Vec3& s10 = aSamples[y0 * m_gridSize + x1];
+	const Vec3& s01 = aSamples[y1 * m_gridSize + x0];
+	const Vec3& s11 = aSamples[y1 * m_gridSize + x1];
+
+	Vec3 top = s00 + (s10 - s00) * tx;
+	Vec3 bottom = s01 + (s11 - s01) * tx;
+	return top + (bottom - top) * ty;
+}
+
+Vec3 Ocean::QuerySurfacePoint(const Vec3* aSamples, const Vec2& posXZ) const
+{
+	// World space to grid space.  Tiles repeat the simulation and tile centers lie on multiples of the tile size.
+	const float gridScale = m_gridSize / m_tileSize;
+	const float gridOffset = m_gridSize * 0.5f;
+	Vec2 targetGridPos = posXZ * gridScale + Vec2(gridOffset, gridOffset);
+
+	// Find the undisplaced point that gets displaced onto posXZ with a fixed point iteration: p = target - D(p)
+	Vec2 gridPos = targetGridPos;
+	Vec3 sample;
+	for (int i = 0; i < kQueryDisplacementIterations; ++i)
 	{
-		m_fft.Fast(m_h, m_h, 1, m * m_gridSize);
-		m_fft.Fast(m_hSlopeX, m_hSlopeX, 1, m * m_gridSize);
-		m_fft.Fast(m_hSlopeZ, m_hSlopeZ, 1, m * m_gridSize);
-		m_fft.Fast(m_hDx, m_hDx, 1, m * m_gridSize);
-		m_fft.Fast(m_hDz, m_hDz, 1, m * m_gridSize);
+		sample = SampleQuerySnapshot(aSamples, gridPos);
+		gridPos = targetGridPos - Vec2(sample.x, sample.z) * gridScale;
 	}
+	sample = SampleQuerySnapshot(aSamples, gridPos);
+
+	return Vec3(sample.x, sample.y + kSurfaceHeight, sample.z);
+}
 
-	for (int n = 0; n < m_gridSize; n++)
+Vec3 Ocean::SampleDisplacement(const Vec2& posXZ) const
+{
+	const float gridScale = m_gridSize / m_tileSize;
+	const float gridOffset = m_gridSize * 0.5f;
+
+	Vec3 result(0.f, kSurfaceHeight, 0.f);
+	int slot;
+	uint sequence;
+	do
 	{
-		m_fft.Fast(m_h, m_h, m_gridSize, n);
-		m_fft.Fast(m_hSlopeX, m_hSlopeX, m_gridSize, n);
-		m_fft.Fast(m_hSlopeZ, m_hSlopeZ, m_gridSize, n);
-		m_fft.Fast(m_hDx, m_hDx, m_gridSize, n);
-		m_fft.Fast(m_hDz, m_hDz, m_gridSize, n);
+		const Vec3* aSamples = BeginQueryRead(&slot, &sequence);
+		if (!aSamples)
+			return result;
+
+		result = SampleQuerySnapshot(aSamples, posXZ * gridScale + Vec2(gridOffset, gridOffset));
+		result.y += kSurfaceHeight;
 	}
+	while (!EndQueryRead(slot, sequence));
+
+	return result;
+}
+
+float Ocean::GetHeight(const Vec2& posXZ) const
+{
+	float height;
+	GetHeights(&posXZ, 1, &height);
+	return height;
+}
 
-	int gridHalfSize = m_gridSize / 2;
-	for (int m = 0; m < m_gridSize; ++m)
+void Ocean::GetHeights(const Vec2* aPositions, uint count, float* aOutHeights) const
+{
+	// Validate the snapshot every few points so a large batch can't be starved by the simulation updating under it.
+	static const uint kPointsPerRead = 64;
+
+	for (uint start = 0; start < count; start += kPointsPerRead)
 	{
-		for (int n = 0; n < m_gridSize; ++n)
+		uint end = std::min(start + kPointsPerRead, count);
+
+		int slot;
+		uint sequence;
+		do
 		{
-			int idx = (m * m_gridSize) + n;
-
-			aVertices[idx].position.x = ((n - gridHalfSize) * m_tileSize) / m_gridSize;
-			aVertices[idx].position.y = m_h[idx].real(); 
-			aVertices[idx].position.z = ((m - gridHalfSize) * m_tileSize) / m_gridSize;
-
-			// Apply displacement to the XZ positions to get some choppiness to the waves.
-			// This generally results in high peaks and flat valleys instead of simple heightfield points moving up and down.
-			Vec2 displacement = Vec2(m_hDx[idx].real(), m_hDz[idx].real());
-			aVertices[idx].position.x += displacement.x;
-			aVertices[idx].position.z += displacement.y;
-
-			// Normal
-			Vec3 normal = Vec3(0.0f - m_hSlopeX[idx].real(), 1.0f, 0.0f - m_hSlopeZ[idx].real());
-			aVertices[idx].normal = Vec3Normalize(normal);
-
-			// Jacobian for turbulence coloring.
-			const float lambda = 1.2f;
-			Vec2 dDdx = 0.5f * lambda * (GetDisplacement(n, m + 1) - GetDisplacement(n, m - 1));
-			Vec2 dDdy = 0.5f * lambda * (GetDisplacement(n, m + 1) - GetDisplacement(n, m - 1));
-			aVertices[idx].jacobian = (1.f + dDdx.x) * (1.f + dDdy.y) - dDdx.y * dDdy.x;
+			const Vec3* aSamples = BeginQueryRead(&slot, &sequence);
+			if (!aSamples)
+			{
+				for (uint i = start; i < count; ++i)
+				{
+					aOutHeights[i] = kSurfaceHeight;
+				}
+				return;
+			}
+
+			for (uint i = start; i < end; ++i)
+			{
+				aOutHeights[i] = QuerySurfacePoint(aSamples, aPositions[i]).y;
+			}
 		}
+		while (!EndQueryRead(slot, sequence));
 	}
-
-	g_pRenderer->GetResourceCommandList().UpdateGeoVerts(m_hGeo, aVertices, CREATE_BACKPOINTER(this));
 }
 
 RdrDrawOpSet Ocean::BuildDrawOps(RdrAction* pAction)
@@ -334,12 +360,64 @@ RdrDrawOpSet Ocean::BuildDrawOps(RdrAction* pAction)
 	if (!m_initialized)
 		return RdrDrawOpSet();
 
+	// Tiles are laid out around the tile the camera is over.
+	const Camera& rCamera = pAction->GetCamera();
+	Vec3 cameraPos = rCamera.GetPosition();
+	int centerTileX = (int)floorf(cameraPos.x / m_tileSize + 0.5f);
+	int centerTileZ = (int)floorf(cameraPos.z / m_tileSize + 0.5f);
+	int firstTileX = centerTileX - (int)(m_tileCounts.x - 1) / 2;
+	int firstTileZ = centerTileZ - (int)(m_tileCounts.y - 1) / 2;
+
+	if (!m_hasTileConstants || centerTileX != m_centerTileX || centerTileZ != m_centerTileZ)
+	{
+		for (uint y = 0; y < m_tileCounts.y; ++y)
+		{
+			for (uint x = 0; x < m_tileCounts.x; ++x)
+			{
+				Vec3 tileCenter((firstTileX + (int)x) * m_tileSize, kSurfaceHeight, (firstTileZ + (int)y) * m_tileSize);
+
+				uint constantsSize = sizeof(VsPerObject);
+				VsPerObject* pVsPerObject = (VsPerObject*)RdrFrameMem::AllocAligned(constantsSize, 16);
+				pVsPerObject->mtxWorld = Matrix44Transpose(Matrix44Translation(tileCenter));
+
+				RdrConstantBufferHandle& rhConstants = m_ahTileConstants[x + y * m_tileCounts.x];
+				rhConstants = RdrResourceSystem::CreateUpdateConstantBuffer(rhConstants,
+					pVsPerObject, constantsSize, RdrResourceAccessFlags::CpuRW_GpuRO, CREATE_BACKPOINTER(this));
+			}
+		}
+
+		m_centerTileX = centerTileX;
+		m_centerTileZ = centerTileZ;
+		m_hasTileConstants = true;
+	}
+
 	//////////////////////////////////////////////////////////////////////////
-	// Fill out the draw op
-	RdrDrawOp* pDrawOp = RdrFrameMem::AllocDrawOp(CREATE_BACKPOINTER(this));
-	pDrawOp->hVsConstants = m_hVsPerObjectConstantBuffer;
-	pDrawOp->hGeo = m_hGeo;
-	pDrawOp->pMaterial = &m_material;
+	// Fill out the draw ops
+	RdrDrawOp* aDrawOps = RdrFrameMem::AllocDrawOps(m_tileCounts.x * m_tileCounts.y, CREATE_BACKPOINTER(this));
+	uint16 numDrawOps = 0;
+
+	// Bounding radius of a tile, with some slack for wave displacement.
+	const float tileRadius = m_tileSize;
+
+	for (uint y = 0; y < m_tileCounts.y; ++y)
+	{
+		for (uint x = 0; x < m_tileCounts.x; ++x)
+		{
+			int tileX = firstTileX + (int)x;
+			int tileZ = firstTileZ + (int)y;
+			if (!rCamera.CanSee(Vec3(tileX * m_tileSize, kSurfaceHeight, tileZ * m_tileSize), tileRadius))
+				continue;
+
+			// Camera centered rings.  The center tile and its neighbors use full detail, then each ring out drops a LOD.
+			int ring = std::max(abs(tileX - centerTileX), abs(tileZ - centerTileZ));
+			int lod = std::min(std::max(ring - 1, 0), m_numLods - 1);
+
+			RdrDrawOp& rDrawOp = aDrawOps[numDrawOps++];
+			rDrawOp.hVsConstants = m_ahTileConstants[x + y * m_tileCounts.x];
+			rDrawOp.hGeo = m_ahLodGeos[lod];
+			rDrawOp.pMaterial = &m_material;
+		}
+	}
 
-	return RdrDrawOpSet(pDrawOp, 1);
+	return RdrDrawOpSet(aDrawOps, numDrawOps);
 }
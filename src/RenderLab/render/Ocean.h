@@ -6,11 +6,11 @@
 #include "RdrGeometry.h"
 #include "RdrMaterial.h"
 #include "RdrDrawOp.h"
-#include "MathLib/FourierTransform.h"
+#include "OceanSimulation.h"
+#include <atomic>
 
 class RdrAction;
 class Camera;
-struct FourierGridCell;
 
 class Ocean
 {
@@ -18,8 +18,8 @@ public:
 	Ocean();
 
 	// tileWorldSize - Size of an ocean tile in world units.
-	// tileCounts - Number of tiles in each direction to build the ocean from.
-	// fourierGridSize - Size of the fourier grid used on the tile.
+	// tileCounts - Number of tiles in each direction to build the ocean from.  Tiles are centered on the camera.
+	// fourierGridSize - Size of the fourier grid used on the tile.  Must be a power of 2.
 	// waveHeightScalar - 
 	// wind - Direction of the wind
 	void Init(float tileWorldSize, UVec2 tileCounts, int fourierGridSize, float waveHeightScalar, const Vec2& wind);
@@ -28,31 +28,61 @@ public:
 
 	RdrDrawOpSet BuildDrawOps(RdrAction* pAction);
 
+	// Surface queries against the most recently updated simulation, matching what is drawn.
+	// Safe to call from any thread while the ocean is initialized.  Readers never block the simulation,
+	// they retry if it replaced the data they were reading.
+
+	// Height of the water surface at a world space XZ position.
+	float GetHeight(const Vec2& posXZ) const;
+	void GetHeights(const Vec2* aPositions, uint count, float* aOutHeights) const;
+
+	// Choppiness displacement (x, z) and height (y) of the surface point that rests at posXZ before displacement.
+	Vec3 SampleDisplacement(const Vec2& posXZ) const;
+
 private:
-	void GenerateFourierGrid(int gridSize, float tileWorldSize, const Vec2& wind);
-	Vec2 GetDisplacement(int n, int m);
-	
+	// Query snapshots are double buffered and versioned with a sequence lock.
+	void BeginQuerySnapshotWrite(int slot);
+	void EndQuerySnapshotWrite(int slot);
+	const Vec3* BeginQueryRead(int* pOutSlot, uint* pOutSequence) const;
+	bool EndQueryRead(int slot, uint sequence) const;
+	Vec3 SampleQuerySnapshot(const Vec3* aSamples, const Vec2& gridPos) const;
+	Vec3 QuerySurfacePoint(const Vec3* aSamples, const Vec2& posXZ) const;
+
 private:
 	RdrMaterial m_material;
 
-	RdrConstantBufferHandle m_hVsPerObjectConstantBuffer;
-	RdrGeoHandle m_hGeo;
+	static const int kMaxLods = 4;
+
+	// All tiles share the simulated vertices.  LOD levels index a subset of them.
+	RdrResourceHandle m_hVertexBuffer;
+	RdrResourceHandle m_hIndexBuffer;
+	RdrGeoHandle m_ahLodGeos[kMaxLods];
+	int m_numLods;
 
-	FourierTransform m_fft;
-	FourierGridCell* m_grid;
+	UVec2 m_tileCounts;
+	std::vector<RdrConstantBufferHandle> m_ahTileConstants;
+	int m_centerTileX; // Tile the constants were last laid out around.
+	int m_centerTileZ;
+	bool m_hasTileConstants;
+
+	OceanSimulation m_simulation;
 	int m_gridSize;
 
 	float m_tileSize;
-	float m_waveHeightScalar;
 	float m_timer;
 
-	bool m_initialized;
+	// Fixed rate simulation states.  See GlobalState::oceanSimRate
+	// Samples hold the displacement (x, z) and height (y) of each grid cell.
+	OceanVertex* m_aSimVertices[2];
+	Vec3* m_aSimSamples[2];
+	int m_currSimState;
+	float m_simAccumTime;
+	bool m_hasSimStates;
 
-	// Values used during Update().  These are written over every frame,
-	// but allocating them here avoids unnecessary new/free every Update().
-	Complex* m_h;
-	Complex* m_hDx;
-	Complex* m_hDz;
-	Complex* m_hSlopeX;
-	Complex* m_hSlopeZ;
+	// Samples read by the surface queries.
+	Vec3* m_aQuerySamples[2];
+	std::atomic<uint> m_querySequence[2];
+	std::atomic<int> m_latestQuerySnapshot;
+
+	bool m_initialized;
 };
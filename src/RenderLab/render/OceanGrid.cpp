@@ -0,0 +1,108 @@
+#include "Precompiled.h"
+#include "OceanGrid.h"
+
+namespace
+{
+	void appendQuad(std::vector<uint>& rIndices, uint a, uint b, uint c, uint d)
+	{
+		// Corners in winding order.
+		rIndices.push_back(a);
+		rIndices.push_back(b);
+		rIndices.push_back(d);
+
+		rIndices.push_back(b);
+		rIndices.push_back(c);
+		rIndices.push_back(d);
+	}
+}
+
+int OceanGrid::CalcVertexCount(int gridSize)
+{
+	int vertsPerSide = gridSize + 1;
+	return vertsPerSide * vertsPerSide + kEdge_Count * vertsPerSide;
+}
+
+int OceanGrid::GetSurfaceVertexIndex(int gridSize, int n, int m)
+{
+	return m * (gridSize + 1) + n;
+}
+
+int OceanGrid::GetEdgeVertexIndex(int gridSize, Edge edge, int i)
+{
+	switch (edge)
+	{
+	case kEdge_MinZ:
+		return GetSurfaceVertexIndex(gridSize, i, 0);
+	case kEdge_MaxZ:
+		return GetSurfaceVertexIndex(gridSize, i, gridSize);
+	case kEdge_MinX:
+		return GetSurfaceVertexIndex(gridSize, 0, i);
+	default:
+		return GetSurfaceVertexIndex(gridSize, gridSize, i);
+	}
+}
+
+int OceanGrid::GetSkirtVertexIndex(int gridSize, Edge edge, int i)
+{
+	int vertsPerSide = gridSize + 1;
+	return vertsPerSide * vertsPerSide + edge * vertsPerSide + i;
+}
+
+float OceanGrid::CalcSkirtDepth(float cellSize, int numLods)
+{
+	// Level L uses every 2^L'th vertex, so edges meeting at a LOD change diverge by at most the coarser cell's height change.
+	return cellSize * (1 << (numLods - 1));
+}
+
+void OceanGrid::AppendLodIndices(int gridSize, int step, std::vector<uint>& rIndices)
+{
+	int numCells = gridSize / step;
+	for (int m = 0; m < numCells; ++m)
+	{
+		for (int n = 0; n < numCells; ++n)
+		{
+			uint v00 = GetSurfaceVertexIndex(gridSize, n * step, m * step);
+			uint v01 = GetSurfaceVertexIndex(gridSize, (n + 1) * step, m * step);
+			uint v10 = GetSurfaceVertexIndex(gridSize, n * step, (m + 1) * step);
+			uint v11 = GetSurfaceVertexIndex(gridSize, (n + 1) * step, (m + 1) * step);
+
+			appendQuad(rIndices, v00, v10, v11, v01);
+		}
+	}
+
+	// Skirts drop straight down from each edge segment.  Walking the edge in the direction that keeps the outside
+	// on the same side as the surface's winding makes them face outwards.
+	for (int edge = 0; edge < kEdge_Count; ++edge)
+	{
+		bool bReversed = (edge == kEdge_MaxZ || edge == kEdge_MinX);
+		for (int i = 0; i < gridSize; i += step)
+		{
+			int first = bReversed ? i + step : i;
+			int second = bReversed ? i : i + step;
+
+			appendQuad(rIndices,
+				GetEdgeVertexIndex(gridSize, (Edge)edge, first),
+				GetEdgeVertexIndex(gridSize, (Edge)edge, second),
+				GetSkirtVertexIndex(gridSize, (Edge)edge, second),
+				GetSkirtVertexIndex(gridSize, (Edge)edge, first));
+		}
+	}
+}
+
+float OceanGrid::CalcJacobian(const float* aDisplacementX, const float* aDisplacementZ, int gridSize, float cellSize, int n, int m)
+{
+	// The fields are periodic, so neighbors outside the grid wrap around.
+	int mask = gridSize - 1;
+	int idxPosX = (m & mask) * gridSize + ((n + 1) & mask);
+	int idxNegX = (m & mask) * gridSize + ((n - 1) & mask);
+	int idxPosZ = ((m + 1) & mask) * gridSize + (n & mask);
+	int idxNegZ = ((m - 1) & mask) * gridSize + (n & mask);
+
+	float invSpacing = 1.f / (2.f * cellSize);
+	float dDxdx = (aDisplacementX[idxPosX] - aDisplacementX[idxNegX]) * invSpacing;
+	float dDzdx = (aDisplacementZ[idxPosX] - aDisplacementZ[idxNegX]) * invSpacing;
+	float dDxdz = (aDisplacementX[idxPosZ] - aDisplacementX[idxNegZ]) * invSpacing;
+	float dDzdz = (aDisplacementZ[idxPosZ] - aDisplacementZ[idxNegZ]) * invSpacing;
+
+	return (1.f + dDxdx) * (1.f + dDzdz) - dDxdz * dDzdx;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+// Layout of the ocean tile mesh and derivatives of the simulated displacement fields.
+// Has no renderer dependencies so it can be tested offline.
+namespace OceanGrid
+{
+	enum Edge
+	{
+		kEdge_MinZ,
+		kEdge_MaxZ,
+		kEdge_MinX,
+		kEdge_MaxX,
+
+		kEdge_Count
+	};
+
+	// Vertices start with the (gridSize + 1) x (gridSize + 1) row-major surface grid, followed by a skirt along each tile edge.
+	// Skirt vertices hang below the edge vertices and hide the cracks where tiles of different LOD levels meet.
+	int CalcVertexCount(int gridSize);
+	int GetSurfaceVertexIndex(int gridSize, int n, int m);
+	int GetEdgeVertexIndex(int gridSize, Edge edge, int i);
+	int GetSkirtVertexIndex(int gridSize, Edge edge, int i);
+
+	// Skirt length that covers the gap between tiles of any two LOD levels, unless the surface is steeper than
+	// 45 degrees across a cell of the coarsest level.
+	float CalcSkirtDepth(float cellSize, int numLods);
+
+	// Appends the triangle list for a LOD level that uses every step'th vertex, including its skirts.
+	// Triangles are wound so the surface faces +Y and skirts face away from the tile.
+	void AppendLodIndices(int gridSize, int step, std::vector<uint>& rIndices);
+
+	// Determinant of the Jacobian of the displaced XZ positions at grid point (n, m), from central differences of the
+	// periodic displacement fields.  Values near or below 0 are where the surface folds over.
+	// J = (1 + dDx/dx) * (1 + dDz/dz) - dDx/dz * dDz/dx
+	float CalcJacobian(const float* aDisplacementX, const float* aDisplacementZ, int gridSize, float cellSize, int n, int m);
+}
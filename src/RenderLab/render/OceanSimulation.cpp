@@ -0,0 +1,396 @@
+#include "Precompiled.h"
+#include "OceanSimulation.h"
+#include "OceanGrid.h"
+#include "UtilsLib/JobPool.h"
+
+// References:
+// Simulating Ocean Water https://people.cs.clemson.edu/~jtessen/papers_files/coursenotes2004.pdf
+// http://www.keithlantz.net/2011/10/ocean-simulation-part-one-using-the-discrete-fourier-transform/
+// http://malideveloper.arm.com/sample-code/ocean-rendering-with-fast-fourier-transform/
+
+struct FourierGridCell
+{
+	Complex h0;
+	Vec2 k;
+	float dispersion;
+
+	// Derivative values used for choppiness displacement
+	float dx;
+	float dz;
+};
+
+namespace
+{
+	static const float kGravity = 9.8f;
+	static const float kTimePeriod = 200.f; // Repeat time in seconds.
+
+	// Work split for OceanSimulation::Simulate()
+	static const uint kRowsPerJob = 8;
+	static const int kFftColumnBlockSize = 64;
+
+	Complex randomGaussian()
+	{
+		// http://www.design.caltech.edu/erik/Misc/Gaussian.html
+		float x1, x2, w;
+
+		do
+		{
+			x1 = 2.f * randFloat() - 1.f;
+			x2 = 2.f * randFloat() - 1.f;
+			w = x1 * x1 + x2 * x2;
+		}
+		while (w >= 1.f);
+
+		w = sqrt((-2.f * log(w)) / w);
+
+		return Complex(x1 * w, x2 * w);
+	}
+
+	float phillipsSpectrum(const Vec2& k, float A, const Vec2& windDir, float windSpeed)
+	{
+		// Phillips spectrum - Figure 40 from Tessendorf paper
+		// P(k) = A * (exp(-1 / (_k * L)^2) / _k^4) * |k' * w|^2
+		// A = wave height scalar
+		// L = V^2 / g
+		// V = Wind speed
+		// w = Wind dir
+		// _k = length(k)
+		// k' = normalized k
+
+		float kLen = Vec2Length(k);
+		if (kLen < Maths::kEpsilon)
+			return 0.f; // Avoid divide by zero
+
+		float L = (windSpeed * windSpeed) / kGravity;
+		float kLSqr = (kLen * L) * (kLen * L);
+
+		float kDotWind = Vec2Dot(Vec2Normalize(k), windDir);
+
+		// Spectrum results
+		float res = kDotWind * kDotWind * (A * exp(-1.f / kLSqr)) / (kLen * kLen * kLen * kLen);
+
+		// Suppress small waves
+		const float kSupressionPercent = 0.001f;
+		float l = L * kSupressionPercent;
+		float waveSuppression = exp(-kLen * kLen * l * l);
+
+		return res * waveSuppression;
+	}
+
+	float calcDispersion(const Vec2 k)
+	{
+		// Dispersion - Figure 35 from Tessendorf paper
+		// w(k) = floor(w'(k) / w0) * w0
+		// w'(k) = sqrt(g * |k|)
+		// w0 = 2 * pi / T
+		// T = repeat time
+		float w0 = Maths::kTwoPi / kTimePeriod;
+		float w = sqrt(kGravity * Vec2Length(k));
+		return floor(w / w0) * w0;
+	}
+}
+
+OceanSimulation::OceanSimulation()
+	: m_grid(nullptr)
+	, m_gridSize(0)
+	, m_tileSize(0.f)
+	, m_waveHeightScalar(0.f)
+	, m_skirtDepth(0.f)
+{
+	for (int i = 0; i < kField_Count; ++i)
+	{
+		m_fieldReal[i] = nullptr;
+		m_fieldImag[i] = nullptr;
+	}
+}
+
+OceanSimulation::~OceanSimulation()
+{
+	delete[] m_grid;
+	ReleaseFields();
+}
+
+void OceanSimulation::ReleaseFields()
+{
+	for (int i = 0; i < kField_Count; ++i)
+	{
+		delete[] m_fieldReal[i];
+		m_fieldReal[i] = nullptr;
+		delete[] m_fieldImag[i];
+		m_fieldImag[i] = nullptr;
+	}
+}
+
+void OceanSimulation::Init(int gridSize, float tileWorldSize, float waveHeightScalar, const Vec2& wind, float skirtDepth)
+{
+	m_gridSize = gridSize;
+	m_tileSize = tileWorldSize;
+	m_waveHeightScalar = waveHeightScalar;
+	m_skirtDepth = skirtDepth;
+
+	m_fft.Init(gridSize);
+	GenerateFourierGrid(wind);
+}
+
+void OceanSimulation::GenerateFourierGrid(const Vec2& wind)
+{
+	// Destroy the old grid if we have one.
+	delete[] m_grid;
+	ReleaseFields();
+
+	// Allocate the new grid.
+	m_grid = new FourierGridCell[m_gridSize * m_gridSize];
+
+	for (int i = 0; i < kField_Count; ++i)
+	{
+		m_fieldReal[i] = new float[m_gridSize * m_gridSize];
+		m_fieldImag[i] = new float[m_gridSize * m_gridSize];
+	}
+
+	// Generate
+	Vec2 windDir = Vec2Normalize(wind);
+	float windSpeed = Vec2Length(wind);
+
+	int gridHalfSize = m_gridSize / 2;
+	float kScalar = Maths::kTwoPi / m_tileSize;
+
+	for (int m = 0; m < m_gridSize; ++m)
+	{
+		for (int n = 0; n < m_gridSize; ++n)
+		{
+			int idx = (m * m_gridSize) + n;
+			FourierGridCell& rCell = m_grid[idx];
+
+			rCell.k.x = (float)((n > gridHalfSize) ? (n - m_gridSize) : n);
+			rCell.k.y = (float)((m > gridHalfSize) ? (m - m_gridSize) : m);
+			rCell.k *= kScalar;
+
+			Complex gauss = randomGaussian();
+			float phillips = sqrt(phillipsSpectrum(rCell.k, m_waveHeightScalar, windDir, windSpeed));
+			rCell.h0 = gauss * phillips / sqrt(2.f);
+			rCell.dispersion = calcDispersion(rCell.k);
+
+			// Derivatives used for displacement/normals
+			float len = Vec2Length(rCell.k);
+			rCell.dx = rCell.k.x / (len + 0.00001f);
+			rCell.dz = -rCell.k.y / (len + 0.00001f);
+		}
+	}
+}
+
+Vec2 OceanSimulation::GetDisplacement(int n, int m)
+{
+	// The FFT output is periodic, so wrap samples outside the grid.
+	n &= (m_gridSize - 1);
+	m &= (m_gridSize - 1);
+
+	int idx = (m * m_gridSize) + n;
+	return Vec2(m_fieldReal[kField_DisplacementX][idx], m_fieldReal[kField_DisplacementZ][idx]);
+}
+
+void OceanSimulation::EvaluateSpectrum(int firstRow, int numRows, float time)
+{
+	// Generate h~ values for each point in the grid.
+	for (int m = firstRow; m < firstRow + numRows; ++m)
+	{
+		for (int n = 0; n < m_gridSize; ++n)
+		{
+			// Figure 43 from Tessendorf paper
+			// h~(k, t) = h0(k) * exp(i * w(k) * t)
+			//		  + conj(h0(-k)) * exp(-i * w(k) * t)
+			int idx = (m * m_gridSize) + n;
+			const FourierGridCell& rCell = m_grid[idx];
+
+			// Negative frequency
+			int n2 = (n == 0) ? 0 : (m_gridSize - n);
+			int m2 = (m == 0) ? 0 : (m_gridSize - m);
+			int idxNeg = (m2 * m_gridSize) + n2;
+			const FourierGridCell& rCellNeg = m_grid[idxNeg];
+
+			// Calculate h~
+			float c = cos(rCell.dispersion * time);
+			float s = sin(rCell.dispersion * time);
+			Complex h = rCell.h0 * Complex(c, s) + rCellNeg.h0 * Complex(c, -s);
+			Complex hSlopeX = h * Complex(0, rCell.k.x);
+			Complex hSlopeZ = h * Complex(0, rCell.k.y);
+			Complex hDx = h * Complex(0, rCell.dx);
+			Complex hDz = h * Complex(0, rCell.dz);
+
+			m_fieldReal[kField_Height][idx] = h.real();
+			m_fieldImag[kField_Height][idx] = h.imag();
+			m_fieldReal[kField_SlopeX][idx] = hSlopeX.real();
+			m_fieldImag[kField_SlopeX][idx] = hSlopeX.imag();
+			m_fieldReal[kField_SlopeZ][idx] = hSlopeZ.real();
+			m_fieldImag[kField_SlopeZ][idx] = hSlopeZ.imag();
+			m_fieldReal[kField_DisplacementX][idx] = hDx.real();
+			m_fieldImag[kField_DisplacementX][idx] = hDx.imag();
+			m_fieldReal[kField_DisplacementZ][idx] = hDz.real();
+			m_fieldImag[kField_DisplacementZ][idx] = hDz.imag();
+		}
+	}
+}
+
+void OceanSimulation::BuildVertices(int firstRow, int numRows, OceanVertex* aOutVertices, Vec3* aOutSamples)
+{
+	const int vertsPerSide = m_gridSize + 1;
+	const int gridHalfSize = m_gridSize / 2;
+	const float cellSize = m_tileSize / m_gridSize;
+
+	for (int m = firstRow; m < firstRow + numRows; ++m)
+	{
+		for (int n = 0; n < vertsPerSide; ++n)
+		{
+			int fieldIdx = ((m & (m_gridSize - 1)) * m_gridSize) + (n & (m_gridSize - 1));
+			OceanVertex& rVertex = aOutVertices[m * vertsPerSide + n];
+
+			rVertex.position.x = (n - gridHalfSize) * cellSize;
+			rVertex.position.y = m_fieldReal[kField_Height][fieldIdx];
+			rVertex.position.z = (m - gridHalfSize) * cellSize;
+
+			// Apply displacement to the XZ positions to get some choppiness to the waves.
+			// This generally results in high peaks and flat valleys instead of simple heightfield points moving up and down.
+			Vec2 displacement = GetDisplacement(n, m);
+			rVertex.position.x += displacement.x;
+			rVertex.position.z += displacement.y;
+
+			if (m < m_gridSize && n < m_gridSize)
+			{
+				aOutSamples[fieldIdx] = Vec3(displacement.x, rVertex.position.y, displacement.y);
+			}
+
+			// Normal
+			Vec3 normal = Vec3(0.0f - m_fieldReal[kField_SlopeX][fieldIdx], 1.0f, 0.0f - m_fieldReal[kField_SlopeZ][fieldIdx]);
+			rVertex.normal = Vec3Normalize(normal);
+
+			// Jacobian of the displaced XZ positions for turbulence coloring.
+			rVertex.jacobian = OceanGrid::CalcJacobian(m_fieldReal[kField_DisplacementX], m_fieldReal[kField_DisplacementZ], m_gridSize, cellSize, n, m);
+		}
+	}
+}
+
+void OceanSimulation::BuildSkirtVertices(OceanVertex* aVertices)
+{
+	for (int edge = 0; edge < OceanGrid::kEdge_Count; ++edge)
+	{
+		for (int i = 0; i <= m_gridSize; ++i)
+		{
+			// Shading matches the edge so the skirt blends into the surface above it.
+			OceanVertex& rSkirtVertex = aVertices[OceanGrid::GetSkirtVertexIndex(m_gridSize, (OceanGrid::Edge)edge, i)];
+			rSkirtVertex = aVertices[OceanGrid::GetEdgeVertexIndex(m_gridSize, (OceanGrid::Edge)edge, i)];
+			rSkirtVertex.position.y -= m_skirtDepth;
+		}
+	}
+}
+
+void OceanSimulation::Simulate(float time, OceanVertex* aOutVertices, Vec3* aOutSamples)
+{
+	// Each pass is split across the job pool.  Passes depend on the previous pass's results.
+	struct SimulateContext
+	{
+		OceanSimulation* pSimulation;
+		float time;
+		OceanVertex* aOutVertices;
+		Vec3* aOutSamples;
+		int numColumnBlocks;
+	};
+
+	SimulateContext context;
+	context.pSimulation = this;
+	context.time = time;
+	context.aOutVertices = aOutVertices;
+	context.aOutSamples = aOutSamples;
+	context.numColumnBlocks = std::max(m_gridSize / kFftColumnBlockSize, 1);
+
+	JobPool::ParallelFor(m_gridSize, kRowsPerJob, [](uint nBegin, uint nEnd, void* pUserData)
+	{
+		SimulateContext* pContext = (SimulateContext*)pUserData;
+		pContext->pSimulation->EvaluateSpectrum(nBegin, nEnd - nBegin, pContext->time);
+	}, &context);
+
+	// FFT rows of all fields.
+	JobPool::ParallelFor(m_gridSize * kField_Count, kRowsPerJob, [](uint nBegin, uint nEnd, void* pUserData)
+	{
+		SimulateContext* pContext = (SimulateContext*)pUserData;
+		OceanSimulation* pSimulation = pContext->pSimulation;
+		for (uint i = nBegin; i < nEnd; ++i)
+		{
+			int field = i / pSimulation->m_gridSize;
+			int row = i % pSimulation->m_gridSize;
+			pSimulation->m_fft.TransformRows(pSimulation->m_fieldReal[field], pSimulation->m_fieldImag[field], row, 1);
+		}
+	}, &context);
+
+	// FFT columns of all fields.  Column blocks are independent of each other.
+	JobPool::ParallelFor(context.numColumnBlocks * kField_Count, 1, [](uint nBegin, uint nEnd, void* pUserData)
+	{
+		SimulateContext* pContext = (SimulateContext*)pUserData;
+		OceanSimulation* pSimulation = pContext->pSimulation;
+		int blockSize = std::min(pSimulation->m_gridSize, (int)kFftColumnBlockSize);
+		for (uint i = nBegin; i < nEnd; ++i)
+		{
+			int field = i / pContext->numColumnBlocks;
+			int block = i % pContext->numColumnBlocks;
+			pSimulation->m_fft.TransformColumns(pSimulation->m_fieldReal[field], pSimulation->m_fieldImag[field], block * blockSize, blockSize);
+		}
+	}, &context);
+
+	JobPool::ParallelFor(m_gridSize + 1, kRowsPerJob, [](uint nBegin, uint nEnd, void* pUserData)
+	{
+		SimulateContext* pContext = (SimulateContext*)pUserData;
+		pContext->pSimulation->BuildVertices(nBegin, nEnd - nBegin, pContext->aOutVertices, pContext->aOutSamples);
+	}, &context);
+
+	BuildSkirtVertices(aOutVertices);
+}
+
+void OceanSimulation::Interpolate(const OceanVertex* aPrevVertices, const OceanVertex* aCurrVertices, const Vec3* aPrevSamples, const Vec3* aCurrSamples,
+	float t, OceanVertex* aOutVertices, Vec3* aOutSamples) const
+{
+	struct LerpContext
+	{
+		const OceanVertex* aPrev;
+		const OceanVertex* aCurr;
+		OceanVertex* aOut;
+		const Vec3* aPrevSamples;
+		const Vec3* aCurrSamples;
+		Vec3* aOutSamples;
+		float t;
+	};
+
+	LerpContext context;
+	context.aPrev = aPrevVertices;
+	context.aCurr = aCurrVertices;
+	context.aOut = aOutVertices;
+	context.aPrevSamples = aPrevSamples;
+	context.aCurrSamples = aCurrSamples;
+	context.aOutSamples = aOutSamples;
+	context.t = t;
+
+	int numVerts = OceanGrid::CalcVertexCount(m_gridSize);
+	JobPool::ParallelFor(numVerts, kRowsPerJob * (m_gridSize + 1), [](uint nBegin, uint nEnd, void* pUserData)
+	{
+		LerpContext* pContext = (LerpContext*)pUserData;
+		for (uint i = nBegin; i < nEnd; ++i)
+		{
+			const OceanVertex& rPrev = pContext->aPrev[i];
+			const OceanVertex& rCurr = pContext->aCurr[i];
+			OceanVertex& rOut = pContext->aOut[i];
+			float t = pContext->t;
+			rOut.position = rPrev.position + (rCurr.position - rPrev.position) * t;
+			rOut.normal = Vec3Normalize(rPrev.normal + (rCurr.normal - rPrev.normal) * t);
+			rOut.jacobian = rPrev.jacobian + (rCurr.jacobian - rPrev.jacobian) * t;
+		}
+	}, &context);
+
+	// Query samples match what is drawn.
+	int numSamples = m_gridSize * m_gridSize;
+	JobPool::ParallelFor(numSamples, kRowsPerJob * m_gridSize, [](uint nBegin, uint nEnd, void* pUserData)
+	{
+		LerpContext* pContext = (LerpContext*)pUserData;
+		for (uint i = nBegin; i < nEnd; ++i)
+		{
+			const Vec3& rPrev = pContext->aPrevSamples[i];
+			pContext->aOutSamples[i] = rPrev + (pContext->aCurrSamples[i] - rPrev) * pContext->t;
+		}
+	}, &context);
+}
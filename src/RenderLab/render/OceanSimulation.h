@@ -0,0 +1,72 @@
+#pragma once
+
+#include "MathLib/Maths.h"
+#include "MathLib/FourierTransform.h"
+
+struct FourierGridCell;
+
+struct OceanVertex
+{
+	Vec3 position;
+	Vec3 normal;
+	float jacobian;
+};
+
+// FFT ocean surface simulation.  Produces the vertices of one tile, laid out as described in OceanGrid.
+// Each stage is split across the job pool.  Has no renderer dependencies so it can be benchmarked offline.
+class OceanSimulation
+{
+public:
+	OceanSimulation();
+	~OceanSimulation();
+
+	// gridSize - Size of the fourier grid used on the tile.  Must be a power of 2.
+	// skirtDepth - Distance the skirt vertices hang below the tile edges.
+	void Init(int gridSize, float tileWorldSize, float waveHeightScalar, const Vec2& wind, float skirtDepth);
+
+	int GetGridSize() const { return m_gridSize; }
+
+	// Runs the simulation at the given time and writes the resulting surface to aOutVertices.
+	// aOutSamples receives the displacement (x, z) and height (y) of each grid cell.
+	void Simulate(float time, OceanVertex* aOutVertices, Vec3* aOutSamples);
+
+	// Blends two simulated states.  Output may not alias the inputs.
+	void Interpolate(const OceanVertex* aPrevVertices, const OceanVertex* aCurrVertices, const Vec3* aPrevSamples, const Vec3* aCurrSamples,
+		float t, OceanVertex* aOutVertices, Vec3* aOutSamples) const;
+
+private:
+	void GenerateFourierGrid(const Vec2& wind);
+	Vec2 GetDisplacement(int n, int m);
+
+	void EvaluateSpectrum(int firstRow, int numRows, float time);
+	void BuildVertices(int firstRow, int numRows, OceanVertex* aOutVertices, Vec3* aOutSamples);
+	void BuildSkirtVertices(OceanVertex* aVertices);
+
+	void ReleaseFields();
+
+private:
+	FourierTransform m_fft;
+	FourierGridCell* m_grid;
+	int m_gridSize;
+
+	float m_tileSize;
+	float m_waveHeightScalar;
+	float m_skirtDepth;
+
+	// Spectral fields transformed during Simulate().  These are written over every step,
+	// but allocating them here avoids unnecessary new/free every step.
+	// Real and imaginary parts are stored separately for the FFT.
+	enum Field
+	{
+		kField_Height,
+		kField_SlopeX,
+		kField_SlopeZ,
+		kField_DisplacementX,
+		kField_DisplacementZ,
+
+		kField_Count
+	};
+
+	float* m_fieldReal[kField_Count];
+	float* m_fieldImag[kField_Count];
+};
@@ -5,14 +5,18 @@
 #include "Scene.h"
 #include "components/SkyVolume.h"
 #include "RdrComputeOp.h"
+#include "RdrInstanceIdRing.h"
 
 namespace
 {
 	const uint kMaxInstancesPerDraw = 2048;
 
+	// Enough for several frames of instanced draws to be in flight.  Views are only created for blocks that get used.
+	const uint kInstanceIdRingBlocks = 1024;
+
 	struct  
 	{
-		FreeList<RdrAction, MAX_ACTIONS_PER_FRAME * 2> actions;
+		FreeList<RdrAction, MAX_ACTIONS_PER_FRAME * kMaxFrameStates> actions;
 		RdrLighting lighting;
 		RdrSky sky;
 		RdrPostProcess postProcess;
@@ -21,13 +25,14 @@ namespace
 		std::vector<RdrActionSurfaces> offscreenSurfaces;
 
 		// Instance object ID data.
+		// Ids for every instanced draw are written straight into a persistently mapped upload buffer.
 		struct
 		{
 			RdrResource buffer;
-			char* pData; // Original non-aligned pointer.
-			uint* ids;
-		} instanceIds[8];
-		uint currentInstanceIds;
+			uint* pMappedIds;
+			RdrInstanceIdRing ring;
+			std::vector<RdrDescriptors*> blockViews; // Constant buffer views starting at each block, created on first use.
+		} instanceIds;
 
 	} s_actionSharedData;
 
@@ -237,22 +242,19 @@ void RdrAction::InitSharedData(RdrContext* pContext, const InputManager* pInputM
 {
 	s_actionSharedData.postProcess.Init(pContext, pInputManager);
 
-	// Create instance ids buffers
-	s_actionSharedData.currentInstanceIds = 0;
-	for (int i = 0; i < ARRAY_SIZE(s_actionSharedData.instanceIds); ++i)
-	{
-		size_t temp;
-		void* pAlignedData;
-
-		uint dataSize = kMaxInstancesPerDraw * sizeof(uint) + 16;
-		s_actionSharedData.instanceIds[i].pData = new char[dataSize];
-		pAlignedData = (void*)s_actionSharedData.instanceIds[i].pData;
-		std::align(16, dataSize, pAlignedData, temp);
+	// Create the instance ids ring buffer.
+	// Padded by a full draw's worth of ids so views of the last blocks don't run past the end of the buffer.
+	auto& rInstanceIds = s_actionSharedData.instanceIds;
+	rInstanceIds.ring.Init(kInstanceIdRingBlocks);
+	rInstanceIds.buffer.CreateConstantBuffer(*pContext, (rInstanceIds.ring.GetCapacity() + kMaxInstancesPerDraw) * sizeof(uint),
+		RdrResourceAccessFlags::CpuRW_GpuRO, CREATE_NULL_BACKPOINTER);
+	rInstanceIds.pMappedIds = (uint*)rInstanceIds.buffer.MapPersistent(*pContext);
+	rInstanceIds.blockViews.resize(kInstanceIdRingBlocks, nullptr);
+}
 
-		s_actionSharedData.instanceIds[i].ids = (uint*)pAlignedData;
-		s_actionSharedData.instanceIds[i].buffer.CreateConstantBuffer(*pContext, kMaxInstancesPerDraw * sizeof(uint), 
-			RdrResourceAccessFlags::CpuRW_GpuRO, CREATE_NULL_BACKPOINTER);
-	}
+void RdrAction::BeginSharedDataFrame(RdrContext* pContext)
+{
+	s_actionSharedData.instanceIds.ring.BeginFrame(pContext->GetFrameNum(), pContext->GetLastCompletedFrame());
 }
 
 RdrAction* RdrAction::CreatePrimary(Camera& rCamera)
@@ -625,23 +627,29 @@ void RdrAction::DrawBucket(const RdrPassData& rPass, const RdrDrawOpBucket& rBuc
 {
 	if (g_debugState.enableInstancing & 1)
 	{
+		RdrInstanceIdRing& rRing = s_actionSharedData.instanceIds.ring;
+		uint* pMappedIds = s_actionSharedData.instanceIds.pMappedIds;
+
 		const RdrDrawBucketEntry* pPendingEntry = nullptr;
 		uint instanceCount = 0;
-		uint* pCurrInstanceIds = nullptr;
+		uint maxInstanceCount = 0;
+		uint idsOffset = 0;
 
 		for (const RdrDrawBucketEntry& rEntry : rBucket)
 		{
 			if (pPendingEntry)
 			{
-				if (pPendingEntry->pDrawOp->instanceDataId != 0 && pPendingEntry->sortKey == rEntry.sortKey && instanceCount < kMaxInstancesPerDraw)
+				if (rEntry.pDrawOp->instanceDataId != 0
+					&& pPendingEntry->sortKey == rEntry.sortKey && instanceCount < maxInstanceCount)
 				{
-					pCurrInstanceIds[instanceCount] = rEntry.pDrawOp->instanceDataId;
+					pMappedIds[idsOffset + instanceCount] = rEntry.pDrawOp->instanceDataId;
 					++instanceCount;
 				}
 				else
 				{
 					// Draw the pending entry
-					DrawGeo(rPass, rGlobalConstants, pPendingEntry->pDrawOp, instanceCount);
+					rRing.CommitList(idsOffset, (instanceCount > 1) ? instanceCount : 0);
+					DrawGeo(rPass, rGlobalConstants, pPendingEntry->pDrawOp, instanceCount, idsOffset);
 					pPendingEntry = nullptr;
 				}
 			}
@@ -649,12 +657,16 @@ void RdrAction::DrawBucket(const RdrPassData& rPass, const RdrDrawOpBucket& rBuc
 			// Update pending entry if it was not set or we just drew.
 			if (!pPendingEntry)
 			{
-				s_actionSharedData.currentInstanceIds++;
-				if (s_actionSharedData.currentInstanceIds >= 8)
-					s_actionSharedData.currentInstanceIds = 0;
-
-				pCurrInstanceIds = s_actionSharedData.instanceIds[s_actionSharedData.currentInstanceIds].ids;
-				pCurrInstanceIds[0] = rEntry.pDrawOp->instanceDataId;
+				// If the ring is full, instanceable ops are drawn individually.
+				maxInstanceCount = 0;
+				if (rEntry.pDrawOp->instanceDataId != 0)
+				{
+					maxInstanceCount = rRing.GetListCapacity(kMaxInstancesPerDraw, idsOffset);
+					if (maxInstanceCount > 0)
+					{
+						pMappedIds[idsOffset] = rEntry.pDrawOp->instanceDataId;
+					}
+				}
 
 				pPendingEntry = &rEntry;
 				instanceCount = 1;
@@ -663,20 +675,21 @@ void RdrAction::DrawBucket(const RdrPassData& rPass, const RdrDrawOpBucket& rBuc
 
 		if (pPendingEntry)
 		{
-			DrawGeo(rPass, rGlobalConstants, pPendingEntry->pDrawOp, instanceCount);
+			rRing.CommitList(idsOffset, (instanceCount > 1) ? instanceCount : 0);
+			DrawGeo(rPass, rGlobalConstants, pPendingEntry->pDrawOp, instanceCount, idsOffset);
 		}
 	}
 	else
 	{
 		for (const RdrDrawBucketEntry& rEntry : rBucket)
 		{
-			DrawGeo(rPass, rGlobalConstants, rEntry.pDrawOp, 1);
+			DrawGeo(rPass, rGlobalConstants, rEntry.pDrawOp, 1, 0);
 		}
 	}
 }
 
 void RdrAction::DrawGeo(const RdrPassData& rPass, const RdrGlobalConstants& rGlobalConstants,
-	const RdrDrawOp* pDrawOp, uint instanceCount)
+	const RdrDrawOp* pDrawOp, uint instanceCount, uint instanceIdsOffset)
 {
 	bool bDepthOnly = (rPass.shaderMode == RdrShaderMode::DepthOnly || rPass.shaderMode == RdrShaderMode::ShadowMap);
 	const RdrGeometry* pGeo = RdrResourceSystem::GetGeo(pDrawOp->hGeo);
@@ -692,19 +705,26 @@ void RdrAction::DrawGeo(const RdrPassData& rPass, const RdrGlobalConstants& rGlo
 
 	RdrConstantBufferHandle hPerActionVs = rGlobalConstants.hVsPerAction;
 
-	m_pDrawState->pVsPerObjectConstantBuffer = RdrResourceSystem::GetConstantBuffer(pDrawOp->hVsConstants)->GetCBV().pDesc;
+	m_pDrawState->pVsGlobalConstantBufferTable = RdrResourceSystem::GetConstantBuffer(hPerActionVs)->GetCBV().pDesc;
 
 	if (instanced)
 	{
-		RdrResource& rBuffer = s_actionSharedData.instanceIds[s_actionSharedData.currentInstanceIds].buffer;
-		rBuffer.UpdateResource(*m_pContext, s_actionSharedData.instanceIds[s_actionSharedData.currentInstanceIds].ids, rBuffer.GetSize());
-		m_pDrawState->pVsGlobalConstantBufferTable = rBuffer.GetCBV().pDesc;
+		// The ids were written to the ring by DrawBucket(), so all that's left is binding a view that starts at them.
+		auto& rInstanceIds = s_actionSharedData.instanceIds;
+		uint block = instanceIdsOffset / RdrInstanceIdRing::kIdsPerBlock;
+		RdrDescriptors*& rpView = rInstanceIds.blockViews[block];
+		if (!rpView)
+		{
+			rpView = rInstanceIds.buffer.CreateConstantBufferView(*m_pContext, block * RdrInstanceIdRing::kBlockSize,
+				kMaxInstancesPerDraw * sizeof(uint), CREATE_NULL_BACKPOINTER).pDesc;
+		}
 
+		m_pDrawState->pVsPerObjectConstantBuffer = rpView;
 		m_pDrawState->pVsShaderResourceViewTable = RdrResourceSystem::GetResource(RdrInstancedObjectDataBuffer::GetResourceHandle())->GetSRV().pDesc;
 	}
 	else
 	{
-		m_pDrawState->pVsGlobalConstantBufferTable = RdrResourceSystem::GetConstantBuffer(hPerActionVs)->GetCBV().pDesc;
+		m_pDrawState->pVsPerObjectConstantBuffer = RdrResourceSystem::GetConstantBuffer(pDrawOp->hVsConstants)->GetCBV().pDesc;
 	}
 
 	// Tessellation material
@@ -774,6 +794,26 @@ void RdrAction::DrawGeo(const RdrPassData& rPass, const RdrGlobalConstants& rGlo
 		m_pDrawState->indexCount = pGeo->geoInfo.numIndices;
 		m_pDrawState->eIndexBufferFormat = pGeo->geoInfo.eIndexFormat;
 		m_pDrawState->indexByteOffset = pGeo->geoInfo.nIndexStartByteOffset;
+
+		if (pDrawOp->numIndexRanges > 0)
+		{
+			Assert(instanceCount == 1);
+
+			// Partial draws issue one draw per visible range.
+			uint nIndexSize = rdrGetIndexBufferFormatSize(pGeo->geoInfo.eIndexFormat);
+			for (uint i = 0; i < pDrawOp->numIndexRanges; ++i)
+			{
+				const RdrIndexRange& rRange = pDrawOp->aIndexRanges[i];
+				m_pDrawState->indexByteOffset = pGeo->geoInfo.nIndexStartByteOffset + rRange.nIndexStart * nIndexSize;
+				m_pDrawState->indexCount = rRange.nIndexCount;
+				m_pGpuProfiler->AddCounter(RdrProfileCounter::Triangles, m_pDrawState->indexCount / 3);
+
+				m_pContext->Draw(*m_pDrawState, 1);
+				m_pGpuProfiler->IncrementCounter(RdrProfileCounter::DrawCall);
+			}
+			return;
+		}
+
 		m_pGpuProfiler->AddCounter(RdrProfileCounter::Triangles, instanceCount * m_pDrawState->indexCount / 3);
 	}
 	else
@@ -88,6 +88,7 @@ class RdrAction
 {
 public:
 	static void InitSharedData(RdrContext* pContext, const InputManager* pInputManager);
+	static void BeginSharedDataFrame(RdrContext* pContext);
 	static RdrAction* CreatePrimary(Camera& rCamera);
 	static RdrAction* CreateOffscreen(const wchar_t* actionName, Camera& rCamera,
 		bool enablePostprocessing, const Rect& viewport, RdrRenderTargetViewHandle hOutputTarget);
@@ -137,7 +138,7 @@ private:
 	void DrawPass(RdrPass ePass);
 	void DrawShadowPass(int shadowPassIndex);
 	void DrawBucket(const RdrPassData& rPass, const RdrDrawOpBucket& rBucket, const RdrGlobalConstants& rGlobalConstants);
-	void DrawGeo(const RdrPassData& rPass, const RdrGlobalConstants& rGlobalConstants, const RdrDrawOp* pDrawOp, uint instanceCount);
+	void DrawGeo(const RdrPassData& rPass, const RdrGlobalConstants& rGlobalConstants, const RdrDrawOp* pDrawOp, uint instanceCount, uint instanceIdsOffset);
 	void DispatchCompute(const RdrComputeOp* pComputeOp);
 
 	///
@@ -48,6 +48,27 @@ namespace
 	static constexpr uint kRootCsSamplerTable				= 2;
 	static constexpr uint kRootCsUnorderedAccessViewTable	= 3;
 
+	// Size of the shared upload ring used for resource updates.
+	static constexpr uint64 kUploadRingSize = 32 * 1024 * 1024;
+
+	ID3D12Resource* createUploadBuffer(ID3D12Device* pDevice, uint64 nByteSize)
+	{
+		ID3D12Resource* pUploadBuffer = nullptr;
+
+		CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_UPLOAD);
+		HRESULT hr = pDevice->CreateCommittedResource(
+			&heapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(nByteSize),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&pUploadBuffer));
+
+		if (!ValidateHResult(hr, __FUNCTION__, "Failed to create upload buffer!"))
+			return nullptr;
+
+		return pUploadBuffer;
+	}
 }
 
 RdrContext::RdrContext(RdrGpuProfiler& rProfiler)
@@ -208,17 +229,13 @@ ComPtr<IDXGISwapChain4> CreateSwapChain(HWND hWnd,
 	return dxgiSwapChain4;
 }
 
-void DescriptorHeap::Create(ComPtr<ID3D12Device> pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type, const uint* anDescriptorTableSizes, uint numDescriptorTableSizes)
+void DescriptorHeap::Create(ComPtr<ID3D12Device> pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type, uint nMaxDescriptors)
 {
 	m_pDevice = pDevice.Get();
 	m_heapType = type;
 
-	uint nTotalNumDescriptors = 0;
-	for (uint i = 0; i < numDescriptorTableSizes; ++i)
-		nTotalNumDescriptors += anDescriptorTableSizes[i] * (1 << i);
-
 	D3D12_DESCRIPTOR_HEAP_DESC desc = {};
-	desc.NumDescriptors = nTotalNumDescriptors;
+	desc.NumDescriptors = nMaxDescriptors;
 	desc.Type = type;
 	desc.NodeMask = 0;
 	desc.Flags = (type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV || type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER)
@@ -229,49 +246,31 @@ void DescriptorHeap::Create(ComPtr<ID3D12Device> pDevice, D3D12_DESCRIPTOR_HEAP_
 		return;
 
 	m_descriptorSize = pDevice->GetDescriptorHandleIncrementSize(type);
+	m_allocator.Init(nMaxDescriptors);
+
+	// Create storage for the descriptors.  Tables are contiguous ranges of the heap and are identified by the entry at their first descriptor.
+	m_pDescriptors = new RdrDescriptors[nMaxDescriptors];
 
-	Assert(numDescriptorTableSizes == ARRAYSIZE(m_tables));
 	CD3DX12_CPU_DESCRIPTOR_HANDLE hCpuDesc(m_pDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
 	CD3DX12_GPU_DESCRIPTOR_HANDLE hGpuDesc(m_pDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-
-	// Create storage for the descriptors.
-	m_pDescriptors = new RdrDescriptors[nTotalNumDescriptors];
-
-	RdrDescriptors* pCurrDesc = m_pDescriptors;
-	for (uint iTableSize = 0; iTableSize < ARRAYSIZE(m_tables); iTableSize++)
+	for (uint i = 0; i < nMaxDescriptors; ++i)
 	{
-		DescriptorTableList& tables = m_tables[iTableSize];
-		uint numTables = anDescriptorTableSizes[iTableSize];
-		tables.reserve(numTables);
-
-		uint nTableSize = (1 << iTableSize);
-		for (uint iTable = 0; iTable < numTables; ++iTable)
-		{
-			tables.push_back(pCurrDesc);
-
-			pCurrDesc->m_hCpuDesc = hCpuDesc;
-			pCurrDesc->m_hGpuDesc = hGpuDesc;
-			pCurrDesc->m_nRefCount = 0;
-			pCurrDesc->m_nTableSize = nTableSize;
-			pCurrDesc->m_nTableListIndex = iTableSize;
-
-			hCpuDesc.Offset(nTableSize, m_descriptorSize);
-			hGpuDesc.Offset(nTableSize, m_descriptorSize);
-
-			++pCurrDesc;
-		}
+		RdrDescriptors* pCurrDesc = &m_pDescriptors[i];
+		pCurrDesc->m_hCpuDesc = hCpuDesc;
+		pCurrDesc->m_hGpuDesc = hGpuDesc;
+		pCurrDesc->m_nRefCount = 0;
+		pCurrDesc->m_nTableSize = 0;
+
+		hCpuDesc.Offset(1, m_descriptorSize);
+		hGpuDesc.Offset(1, m_descriptorSize);
 	}
 
-
 	//////////////////////////////////////////////////////////////////////////
-	// If the heap is shader visible, then create copy descriptors for all the size 1 tables.
+	// If the heap is shader visible, then create a matching CPU-only heap to copy descriptors from when building tables.
 	if (desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)
 	{
-		// Create storage for the descriptors.
-		uint numCopyDescriptors = anDescriptorTableSizes[0];
-
 		D3D12_DESCRIPTOR_HEAP_DESC copyDesc = {};
-		copyDesc.NumDescriptors = numCopyDescriptors;
+		copyDesc.NumDescriptors = nMaxDescriptors;
 		copyDesc.Type = type;
 		copyDesc.NodeMask = 0;
 		copyDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
@@ -281,9 +280,9 @@ void DescriptorHeap::Create(ComPtr<ID3D12Device> pDevice, D3D12_DESCRIPTOR_HEAP_
 			return;
 
 		CD3DX12_CPU_DESCRIPTOR_HANDLE hCpuCopyDesc(m_pCopyDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-		for (RdrDescriptors* pDesc : m_tables[0])
+		for (uint i = 0; i < nMaxDescriptors; ++i)
 		{
-			pDesc->m_hCpuCopyDesc = hCpuCopyDesc;
+			m_pDescriptors[i].m_hCpuCopyDesc = hCpuCopyDesc;
 			hCpuCopyDesc.Offset(1, m_descriptorSize);
 		}
 	}
@@ -294,24 +293,41 @@ void DescriptorHeap::Cleanup()
 	m_pDescriptorHeap->Release();
 }
 
-RdrDescriptors* DescriptorHeap::AllocateDescriptor(const RdrDebugBackpointer& debug)
+RdrDescriptors* DescriptorHeap::allocateRange(uint size, const RdrDebugBackpointer& debug)
 {
-	AutoScopedLock lock(m_mutex);
-
-	RdrDescriptors* pDesc = m_tables[0].back();
-	m_tables[0].pop_back();
+	uint offset = m_allocator.Allocate(size);
+	if (offset == RdrDescriptorAllocator::kInvalidOffset)
+	{
+		RdrDescriptorAllocator::Stats stats = m_allocator.GetStats();
+		Warning("Descriptor heap exhausted allocating %u descriptors. (%u/%u live, %u free, largest free range %u)\n",
+			size, stats.liveDescriptors, stats.capacity, stats.freeDescriptors, stats.largestFreeRange);
+		Assert(false);
+		return nullptr;
+	}
 
-	pDesc->m_debugCreator = debug;
+	RdrDescriptors* pDesc = &m_pDescriptors[offset];
+	Assert(pDesc->m_nRefCount == 0);
 	pDesc->m_nRefCount = 1;
+	pDesc->m_nTableSize = size;
+	pDesc->m_debugCreator = debug;
 
 	return pDesc;
 }
 
+RdrDescriptors* DescriptorHeap::AllocateDescriptor(const RdrDebugBackpointer& debug)
+{
+	AutoScopedLock lock(m_mutex);
+	return allocateRange(1, debug);
+}
+
 RdrDescriptors* DescriptorHeap::CreateShaderResourceView(ID3D12Resource* pResource, const D3D12_SHADER_RESOURCE_VIEW_DESC* pDesc, const RdrDebugBackpointer& debug)
 {
 	Assert(m_heapType == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
 	RdrDescriptors* pDescriptor = AllocateDescriptor(debug);
+	if (!pDescriptor)
+		return nullptr;
+
 	pDescriptor->m_eDescType = RdrDescriptorType::SRV;
 	m_pDevice->CreateShaderResourceView(pResource, pDesc, pDescriptor->m_hCpuDesc);
 	m_pDevice->CreateShaderResourceView(pResource, pDesc, pDescriptor->m_hCpuCopyDesc);
@@ -324,6 +340,9 @@ RdrDescriptors* DescriptorHeap::CreateUnorderedAccesView(ID3D12Resource* pResour
 	Assert(m_heapType == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
 	RdrDescriptors* pDescriptor = AllocateDescriptor(debug);
+	if (!pDescriptor)
+		return nullptr;
+
 	pDescriptor->m_eDescType = RdrDescriptorType::UAV;
 	m_pDevice->CreateUnorderedAccessView(pResource, nullptr, pDesc, pDescriptor->m_hCpuDesc);
 	m_pDevice->CreateUnorderedAccessView(pResource, nullptr, pDesc, pDescriptor->m_hCpuCopyDesc);
@@ -336,6 +355,9 @@ RdrDescriptors* DescriptorHeap::CreateConstantBufferView(const D3D12_CONSTANT_BU
 	Assert(m_heapType == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
 	RdrDescriptors* pDescriptor = AllocateDescriptor(debug);
+	if (!pDescriptor)
+		return nullptr;
+
 	pDescriptor->m_eDescType = RdrDescriptorType::CBV;
 	m_pDevice->CreateConstantBufferView(pDesc, pDescriptor->m_hCpuDesc);
 	m_pDevice->CreateConstantBufferView(pDesc, pDescriptor->m_hCpuCopyDesc);
@@ -348,6 +370,9 @@ RdrDescriptors* DescriptorHeap::CreateRenderTargetView(ID3D12Resource* pResource
 	Assert(m_heapType == D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 
 	RdrDescriptors* pDescriptor = AllocateDescriptor(debug);
+	if (!pDescriptor)
+		return nullptr;
+
 	pDescriptor->m_eDescType = RdrDescriptorType::RTV;
 	m_pDevice->CreateRenderTargetView(pResource, pDesc, pDescriptor->m_hCpuDesc);
 
@@ -359,6 +384,9 @@ RdrDescriptors* DescriptorHeap::CreateDepthStencilView(ID3D12Resource* pResource
 	Assert(m_heapType == D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 
 	RdrDescriptors* pDescriptor = AllocateDescriptor(debug);
+	if (!pDescriptor)
+		return nullptr;
+
 	pDescriptor->m_eDescType = RdrDescriptorType::DSV;
 	m_pDevice->CreateDepthStencilView(pResource, pDesc, pDescriptor->m_hCpuDesc);
 
@@ -370,6 +398,9 @@ RdrDescriptors* DescriptorHeap::CreateSampler(const D3D12_SAMPLER_DESC& samplerD
 	Assert(m_heapType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
 
 	RdrDescriptors* pDescriptor = AllocateDescriptor(debug);
+	if (!pDescriptor)
+		return nullptr;
+
 	pDescriptor->m_eDescType = RdrDescriptorType::Sampler;
 	m_pDevice->CreateSampler(&samplerDesc, pDescriptor->m_hCpuDesc);
 	m_pDevice->CreateSampler(&samplerDesc, pDescriptor->m_hCpuCopyDesc);
@@ -392,25 +423,10 @@ RdrDescriptors* DescriptorHeap::CreateDescriptorTable(const RdrDescriptors** apS
 		return const_cast<RdrDescriptors*>(apSrcDescriptors[0]);
 	}
 
-	uint nTable = 0;
-	while (size > (uint)(1 << nTable))
-	{
-		nTable++;
-	}
-
-	if (nTable > ARRAYSIZE(m_tables) || m_tables[nTable].empty())
-	{
-		Assert(false);
+	RdrDescriptors* pDesc = allocateRange(size, debug);
+	if (!pDesc)
 		return nullptr;
-	}
-
-	RdrDescriptors* pDesc = m_tables[nTable].back();
-	m_tables[nTable].pop_back();
 
-	Assert(pDesc->m_nRefCount == 0);
-	Assert(pDesc->m_nTableListIndex == nTable);
-	pDesc->m_nRefCount = 1;
-	pDesc->m_debugCreator = debug;
 	pDesc->m_eDescType = apSrcDescriptors[0]->m_eDescType;
 
 	// Copy descriptors
@@ -435,8 +451,15 @@ void DescriptorHeap::FreeDescriptor(RdrDescriptors* pDesc)
 	
 	Assert(pDesc->m_nRefCount <= 0);
 	pDesc->m_nRefCount = 0;
+	pDesc->m_nTableSize = 0;
 
-	m_tables[pDesc->m_nTableListIndex].push_back(pDesc);
+	m_allocator.Free((uint)(pDesc - m_pDescriptors));
+}
+
+RdrDescriptorAllocator::Stats DescriptorHeap::GetStats()
+{
+	AutoScopedLock lock(m_mutex);
+	return m_allocator.GetStats();
 }
 
 void DescriptorRingBuffer::Create(ComPtr<ID3D12Device> pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type, uint nMaxDescriptors)
@@ -459,6 +482,9 @@ void DescriptorRingBuffer::Create(ComPtr<ID3D12Device> pDevice, D3D12_DESCRIPTOR
 	m_nFrame = 0;
 	memset(m_nFrameStartDescriptor, 0, sizeof(m_nFrameStartDescriptor)); 
 	memset(m_nFrameDescriptorCount, 0, sizeof(m_nFrameDescriptorCount));
+
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_stats.capacity = nMaxDescriptors;
 }
 
 void DescriptorRingBuffer::Cleanup()
@@ -477,24 +503,39 @@ void DescriptorRingBuffer::BeginFrame()
 	{
 		m_nFrameAvailableDescriptors -= nDescriptorCount;
 	}
+
+	m_stats.descriptorsThisFrame = 0;
+	m_stats.overflowsThisFrame = 0;
 }
 
 CD3DX12_CPU_DESCRIPTOR_HANDLE DescriptorRingBuffer::AllocateDescriptors(uint numToAllocate, uint& nOutDescriptorStartIndex)
 {
-	if (m_nextDescriptor + numToAllocate >= m_maxDescriptors)
+	bool bWrap = (m_nextDescriptor + numToAllocate > m_maxDescriptors);
+	uint nSkipped = bWrap ? (m_maxDescriptors - m_nextDescriptor) : 0;
+
+	if (m_nFrameDescriptorCount[m_nFrame] + nSkipped + numToAllocate > m_nFrameAvailableDescriptors)
 	{
-		uint nSkipped = (m_maxDescriptors - m_nextDescriptor);
-		m_nFrameDescriptorCount[m_nFrame] += nSkipped;
+		// Report the first overflow each frame rather than silently overwriting descriptors the GPU may still be using.
+		if (m_stats.overflowsThisFrame == 0)
+		{
+			Warning("Descriptor ring buffer overflow allocating %u descriptors. (%u used this frame, %u available)\n",
+				numToAllocate, m_nFrameDescriptorCount[m_nFrame], m_nFrameAvailableDescriptors);
+		}
+		++m_stats.overflowsThisFrame;
+		++m_stats.totalOverflows;
 
-		m_nextDescriptor = 0;
+		nOutDescriptorStartIndex = ~0u;
+		return CD3DX12_CPU_DESCRIPTOR_HANDLE(D3D12_DEFAULT);
 	}
 
-	if (m_nFrameDescriptorCount[m_nFrame] + numToAllocate > m_nFrameAvailableDescriptors)
+	if (bWrap)
 	{
-		Assert(false);
+		m_nextDescriptor = 0;
 	}
 
-	m_nFrameDescriptorCount[m_nFrame] += numToAllocate;
+	m_nFrameDescriptorCount[m_nFrame] += nSkipped + numToAllocate;
+	m_stats.descriptorsThisFrame = m_nFrameDescriptorCount[m_nFrame];
+	m_stats.peakFrameDescriptors = std::max(m_stats.peakFrameDescriptors, m_stats.descriptorsThisFrame);
 
 	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(m_pDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
 	hDescriptor.Offset(m_nextDescriptor, m_descriptorSize);
@@ -558,6 +599,87 @@ RdrQuery QueryHeap::AllocateQuery()
 	return handle;
 }
 
+void UploadHeap::Create(ComPtr<ID3D12Device> pDevice, uint64 nRingSize, uint64 nFrameNum, uint64 nLastCompletedFrame)
+{
+	m_pDevice = pDevice.Get();
+	m_pRingBuffer.Attach(createUploadBuffer(m_pDevice, nRingSize));
+	m_ring.Init(nRingSize);
+
+	// Larger requests would evict too much of the ring, so they always get their own buffer.
+	m_nMaxRingAllocation = nRingSize / 4;
+
+	BeginFrame(nFrameNum, nLastCompletedFrame);
+}
+
+void UploadHeap::Cleanup()
+{
+	for (const FallbackBuffer& rBuffer : m_fallbackBuffers)
+	{
+		rBuffer.pResource->Release();
+	}
+	m_fallbackBuffers.clear();
+
+	m_pRingBuffer.Reset();
+}
+
+void UploadHeap::BeginFrame(uint64 nFrameNum, uint64 nLastCompletedFrame)
+{
+	m_nFrameNum = nFrameNum;
+	m_ring.BeginFrame(nFrameNum, nLastCompletedFrame);
+
+	for (uint i = 0; i < m_fallbackBuffers.size(); ++i)
+	{
+		if (m_fallbackBuffers[i].nFrameNum <= nLastCompletedFrame)
+		{
+			m_fallbackBuffers[i].pResource->Release();
+			m_fallbackBuffers[i] = m_fallbackBuffers.back();
+			m_fallbackBuffers.pop_back();
+			--i;
+		}
+	}
+
+	m_nFallbackAllocations = 0;
+	m_nFallbackBytes = 0;
+}
+
+RdrUploadAllocation UploadHeap::Allocate(uint64 size, uint64 alignment)
+{
+	RdrUploadAllocation allocation;
+	if (size <= m_nMaxRingAllocation)
+	{
+		allocation.offset = m_ring.Allocate(size, alignment);
+		if (allocation.offset != RdrUploadRingAllocator::kInvalidOffset)
+		{
+			allocation.pResource = m_pRingBuffer.Get();
+			return allocation;
+		}
+	}
+
+	allocation.pResource = createUploadBuffer(m_pDevice, size);
+	allocation.offset = 0;
+	if (allocation.pResource)
+	{
+		FallbackBuffer buffer;
+		buffer.pResource = allocation.pResource;
+		buffer.nFrameNum = m_nFrameNum;
+		m_fallbackBuffers.push_back(buffer);
+
+		++m_nFallbackAllocations;
+		m_nFallbackBytes += size;
+	}
+
+	return allocation;
+}
+
+UploadHeap::Stats UploadHeap::GetStats() const
+{
+	Stats stats;
+	stats.ring = m_ring.GetStats();
+	stats.fallbackAllocationsThisFrame = m_nFallbackAllocations;
+	stats.fallbackBytesThisFrame = m_nFallbackBytes;
+	return stats;
+}
+
 ComPtr<ID3D12CommandAllocator> CreateCommandAllocator(ComPtr<ID3D12Device> device,
 	D3D12_COMMAND_LIST_TYPE type)
 {
@@ -669,17 +791,17 @@ bool RdrContext::Init(HWND hWnd, uint width, uint height)
 	m_pSwapChain = CreateSwapChain(hWnd, m_pCommandQueue, width, height, kNumBackBuffers);
 	m_currBackBuffer = m_pSwapChain->GetCurrentBackBufferIndex();
 
-	static constexpr uint akMaxNumRenderTargetViews[] = { 64, 0, 0, 0, 0 };
-	m_rtvHeap.Create(m_pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, akMaxNumRenderTargetViews, ARRAYSIZE(akMaxNumRenderTargetViews));
+	static constexpr uint kMaxNumRenderTargetViews = 64;
+	m_rtvHeap.Create(m_pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, kMaxNumRenderTargetViews);
 
-	static constexpr uint akMaxNumDepthStencilViews[] = { 64, 0, 0, 0, 0 };
-	m_dsvHeap.Create(m_pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_DSV, akMaxNumDepthStencilViews, ARRAYSIZE(akMaxNumDepthStencilViews));
+	static constexpr uint kMaxNumDepthStencilViews = 64;
+	m_dsvHeap.Create(m_pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_DSV, kMaxNumDepthStencilViews);
 
-	static constexpr uint akMaxNumShaderResourceViews[] = { 8000, 1024, 1024, 1024, 0 };
-	m_srvHeap.Create(m_pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, akMaxNumShaderResourceViews, ARRAYSIZE(akMaxNumShaderResourceViews));
+	static constexpr uint kMaxNumShaderResourceViews = 22 * 1024;
+	m_srvHeap.Create(m_pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, kMaxNumShaderResourceViews);
 
-	static constexpr uint akMaxNumSamplers[] = { 512, 256, 128, 64, 0 };
-	m_samplerHeap.Create(m_pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, akMaxNumSamplers, ARRAYSIZE(akMaxNumSamplers));
+	static constexpr uint kMaxNumSamplers = 2048; // D3D12 limit for shader visible sampler heaps.
+	m_samplerHeap.Create(m_pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, kMaxNumSamplers);
 
 	for (int i = 0; i < kNumBackBuffers; ++i)
 	{
@@ -692,6 +814,8 @@ bool RdrContext::Init(HWND hWnd, uint width, uint height)
 	m_hFenceEvent = CreateEventHandle();
 	m_nFrameNum = kNumBackBuffers;
 
+	m_uploadHeap.Create(m_pDevice, kUploadRingSize, GetFrameNum(), GetLastCompletedFrame());
+
 	// Query heaps
 	const uint kMaxTimestampQueries = 512;
 	m_timestampQueryHeap.Create(m_pDevice, D3D12_QUERY_HEAP_TYPE_TIMESTAMP, kMaxTimestampQueries);
@@ -911,6 +1035,8 @@ void RdrContext::Release()
 	m_srvHeap.Cleanup();
 	m_dsvHeap.Cleanup();
 
+	m_uploadHeap.Cleanup();
+
 	m_timestampQueryHeap.Cleanup();
 	m_timestampResultBuffer->Release();
 	m_pDebug->Release();
@@ -1125,6 +1251,7 @@ void RdrContext::BeginFrame()
 		return;
 	
 	m_timestampQueryHeap.BeginFrame();
+	m_uploadHeap.BeginFrame(GetFrameNum(), GetLastCompletedFrame());
 
 	// Set descriptor heaps
 	ID3D12DescriptorHeap* ppHeaps[] = {
@@ -1446,7 +1573,8 @@ void RdrContext::Draw(const RdrDrawState& rDrawState, uint instanceCount)
 
 	if (rDrawState.pIndexBuffer && rDrawState.pIndexBuffer->GetResource())
 	{
-		if (rDrawState.pIndexBuffer != m_drawState.pIndexBuffer || rDrawState.indexByteOffset != m_drawState.indexByteOffset || rDrawState.eIndexBufferFormat != m_drawState.eIndexBufferFormat)
+		if (rDrawState.pIndexBuffer != m_drawState.pIndexBuffer || rDrawState.indexByteOffset != m_drawState.indexByteOffset
+			|| rDrawState.indexCount != m_drawState.indexCount || rDrawState.eIndexBufferFormat != m_drawState.eIndexBufferFormat)
 		{
 			D3D12_INDEX_BUFFER_VIEW view;
 			view.BufferLocation = rDrawState.pIndexBuffer->GetResource()->GetGPUVirtualAddress();
@@ -1457,6 +1585,7 @@ void RdrContext::Draw(const RdrDrawState& rDrawState, uint instanceCount)
 			m_pCommandList->IASetIndexBuffer(&view);
 			m_drawState.pIndexBuffer = rDrawState.pIndexBuffer;
 			m_drawState.indexByteOffset = rDrawState.indexByteOffset;
+			m_drawState.indexCount = rDrawState.indexCount;
 			m_drawState.eIndexBufferFormat = rDrawState.eIndexBufferFormat;
 			m_rProfiler.IncrementCounter(RdrProfileCounter::IndexBuffer);
 		}
@@ -1545,13 +1674,18 @@ uint64 RdrContext::GetTimestampFrequency() const
 
 namespace
 {
+	uint getShaderCompileFlags()
+	{
+		return (g_userConfig.debugShaders ? D3DCOMPILE_DEBUG : D3DCOMPILE_OPTIMIZATION_LEVEL3);
+	}
+
 	ID3D10Blob* compileShaderD3D(const char* pShaderText, uint textLen, const char* entrypoint, const char* shadermodel)
 	{
 		HRESULT hr;
 		ID3D10Blob* pCompiledData;
 		ID3D10Blob* pErrors = nullptr;
 
-		uint flags = (g_userConfig.debugShaders ? D3DCOMPILE_DEBUG : D3DCOMPILE_OPTIMIZATION_LEVEL3);
+		uint flags = getShaderCompileFlags();
 
 		hr = D3DCompile(pShaderText, textLen, nullptr, nullptr, nullptr, entrypoint, shadermodel, flags, 0, &pCompiledData, &pErrors);
 		if (hr != S_OK)
@@ -1597,6 +1731,11 @@ bool RdrContext::CompileShader(RdrShaderStage eType, const char* pShaderText, ui
 	return true;
 }
 
+void RdrContext::GetShaderCompilerId(char* pOutId, uint maxIdLen) const
+{
+	sprintf_s(pOutId, maxIdLen, "d3dcompiler_%d sm5_0 flags=%x", D3D_COMPILER_VERSION, getShaderCompileFlags());
+}
+
 void RdrContext::ReleaseShader(RdrShader* pShader) const
 {
 	delete[] pShader->pCompiledData;
@@ -7,6 +7,8 @@
 #include "Camera.h"
 #include "RdrDrawState.h"
 #include "IDSet.h"
+#include "RdrUploadRingAllocator.h"
+#include "RdrDescriptorAllocator.h"
 #include <wrl.h>
 #include <d3d12.h>
 #include "d3dx12.h"
@@ -25,11 +27,12 @@ class RdrDrawState;
 
 static constexpr RdrResourceFormat kDefaultDepthFormat = RdrResourceFormat::D24_UNORM_S8_UINT;
 static constexpr int kNumBackBuffers = 2;
+static constexpr uint kMaxFrameStates = 4; // Max frames the main thread can have queued for the render thread.
 
 class DescriptorHeap
 {
 public:
-	void Create(ComPtr<ID3D12Device> pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type, const uint* anDescriptorTableSizes, uint numDescriptorTableSizes);
+	void Create(ComPtr<ID3D12Device> pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type, uint nMaxDescriptors);
 	void Cleanup();
 
 	RdrDescriptors* CreateShaderResourceView(ID3D12Resource* pResource, const D3D12_SHADER_RESOURCE_VIEW_DESC* pDesc, const RdrDebugBackpointer& debug);
@@ -50,16 +53,17 @@ public:
 
 	RdrDescriptors* AllocateDescriptor(const RdrDebugBackpointer& debug);
 
+	RdrDescriptorAllocator::Stats GetStats();
+
 private:
-	typedef std::vector<RdrDescriptors*> DescriptorTableList;
+	RdrDescriptors* allocateRange(uint size, const RdrDebugBackpointer& debug);
 
 	ID3D12Device* m_pDevice;
 
 	ComPtr<ID3D12DescriptorHeap> m_pCopyDescriptorHeap;
 	ComPtr<ID3D12DescriptorHeap> m_pDescriptorHeap;
-	RdrDescriptors* m_pDescriptors;
-	DescriptorTableList m_tables[5];
-
+	RdrDescriptors* m_pDescriptors; // One per descriptor in the heap, indexed by heap offset.
+	RdrDescriptorAllocator m_allocator;
 
 	D3D12_DESCRIPTOR_HEAP_TYPE m_heapType;
 	uint m_descriptorSize;
@@ -73,16 +77,29 @@ public:
 	void Create(ComPtr<ID3D12Device> pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type, uint nMaxDescriptors);
 	void Cleanup();
 
+	struct Stats
+	{
+		uint capacity;
+		uint descriptorsThisFrame;	// Includes descriptors skipped when wrapping.
+		uint peakFrameDescriptors;
+		uint overflowsThisFrame;
+		uint totalOverflows;
+	};
+
 	void BeginFrame();
 
+	// Returns a null handle if the descriptors would overwrite ones still in use by frames in flight.
 	CD3DX12_CPU_DESCRIPTOR_HANDLE AllocateDescriptors(uint numToAllocate, uint& nOutDescriptorStartIndex);
 	CD3DX12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(uint nDescriptor) const;
 
 	uint GetDescriptorSize() const { return m_descriptorSize; }
 	ID3D12DescriptorHeap* GetHeap() const { return m_pDescriptorHeap.Get(); }
 
+	const Stats& GetStats() const { return m_stats; }
+
 private:
 	ComPtr<ID3D12DescriptorHeap> m_pDescriptorHeap;
+	Stats m_stats;
 
 	uint m_nFrameStartDescriptor[kNumBackBuffers];
 	uint m_nFrameDescriptorCount[kNumBackBuffers];
@@ -121,6 +138,52 @@ private:
 	uint m_nMaxQueries;
 };
 
+struct RdrUploadAllocation
+{
+	ID3D12Resource* pResource;
+	uint64 offset;
+};
+
+// Shared upload memory for resource updates.
+// Ranges are sub-allocated from a ring buffer and reclaimed once the frame that used them completes.  Requests that
+// are too large for the ring, or that are made while it's full, get a dedicated buffer that's released the same way.
+class UploadHeap
+{
+public:
+	struct Stats
+	{
+		RdrUploadRingAllocator::Stats ring;
+		uint fallbackAllocationsThisFrame;
+		uint64 fallbackBytesThisFrame;
+	};
+
+	void Create(ComPtr<ID3D12Device> pDevice, uint64 nRingSize, uint64 nFrameNum, uint64 nLastCompletedFrame);
+	void Cleanup();
+
+	void BeginFrame(uint64 nFrameNum, uint64 nLastCompletedFrame);
+
+	RdrUploadAllocation Allocate(uint64 size, uint64 alignment);
+
+	Stats GetStats() const;
+
+private:
+	struct FallbackBuffer
+	{
+		ID3D12Resource* pResource;
+		uint64 nFrameNum;
+	};
+
+	ID3D12Device* m_pDevice;
+	ComPtr<ID3D12Resource> m_pRingBuffer;
+	RdrUploadRingAllocator m_ring;
+	std::vector<FallbackBuffer> m_fallbackBuffers;
+
+	uint64 m_nFrameNum;
+	uint64 m_nMaxRingAllocation;
+	uint m_nFallbackAllocations;
+	uint64 m_nFallbackBytes;
+};
+
 struct RdrSampler
 {
 	const RdrDescriptors* pDesc;
@@ -146,6 +209,8 @@ public:
 	DescriptorHeap& GetRtvHeap() { return m_rtvHeap; }
 	DescriptorHeap& GetDsvHeap() { return m_rtvHeap; }
 
+	UploadHeap& GetUploadHeap() { return m_uploadHeap; }
+
 	const RdrSampler& GetSampler(const RdrSamplerState& state);
 
 	const ComPtr<ID3D12RootSignature>& GetGraphicsRootSignature() { return m_pGraphicsRootSignature; }
@@ -174,6 +239,8 @@ public:
 	/////////////////////////////////////////////////////////////
 	// Shaders
 	bool CompileShader(RdrShaderStage eType, const char* pShaderText, uint textLen, void** ppOutCompiledData, uint* pOutDataSize) const;
+	// Identifies the compiler version and options for the shader cache.
+	void GetShaderCompilerId(char* pOutId, uint maxIdLen) const;
 	void ReleaseShader(RdrShader* pShader) const;
 
 	/////////////////////////////////////////////////////////////
@@ -206,6 +273,9 @@ public:
 	uint64 GetLastCompletedFrame() const { return m_nFrameNum - kNumBackBuffers; }
 	uint64 GetFrameNum() const { return m_nFrameNum; }
 
+	// Whether the GPU has finished executing the given frame.
+	bool IsFrameComplete(uint64 nFrameNum) const { return m_pFence->GetCompletedValue() >= nFrameNum; }
+
 private:
 	static constexpr int kMaxNumSamplers = 64;
 
@@ -237,6 +307,8 @@ private:
 	RdrShaderResourceView m_nullUnorderedAccessView;
 	RdrConstantBufferView m_nullConstantBufferView;
 
+	UploadHeap m_uploadHeap;
+
 	QueryHeap m_timestampQueryHeap;
 	ComPtr<ID3D12Resource> m_timestampResultBuffer;
 
@@ -0,0 +1,282 @@
+#include "Precompiled.h"
+#include "RdrDescriptorAllocator.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	// Index of the lowest/highest set bit.  The value must be non-zero.
+	inline uint lowestBit(uint val)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, val);
+		return index;
+#else
+		return __builtin_ctz(val);
+#endif
+	}
+
+	inline uint highestBit(uint val)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse(&index, val);
+		return index;
+#else
+		return 31 - __builtin_clz(val);
+#endif
+	}
+}
+
+RdrDescriptorAllocator::RdrDescriptorAllocator()
+{
+	Init(0);
+}
+
+void RdrDescriptorAllocator::Init(uint capacity)
+{
+	Range emptyRange = { 0, kInvalidOffset, kInvalidOffset, kInvalidOffset, false };
+	m_ranges.assign(capacity, emptyRange);
+
+	for (uint i = 0; i < kNumLists; ++i)
+	{
+		for (uint k = 0; k < kNumSubLists; ++k)
+		{
+			m_freeLists[i][k] = kInvalidOffset;
+		}
+		m_subListBitmaps[i] = 0;
+	}
+	m_listBitmap = 0;
+
+	m_capacity = capacity;
+	m_liveDescriptors = 0;
+	m_liveAllocations = 0;
+	m_peakLiveDescriptors = 0;
+	m_freeRanges = 0;
+	m_failedAllocations = 0;
+
+	if (capacity > 0)
+	{
+		m_ranges[0].size = capacity;
+		insertFreeRange(0);
+	}
+}
+
+void RdrDescriptorAllocator::mapSize(uint size, uint& rOutList, uint& rOutSubList) const
+{
+	if (size < kNumSubLists)
+	{
+		rOutList = 0;
+		rOutSubList = size;
+	}
+	else
+	{
+		uint topBit = highestBit(size);
+		rOutList = topBit - kSubListBits + 1;
+		rOutSubList = (size >> (topBit - kSubListBits)) - kNumSubLists;
+	}
+}
+
+uint RdrDescriptorAllocator::findFreeRange(uint size) const
+{
+	// Round up to the next bucket so any range found is guaranteed to fit.
+	uint searchSize = size;
+	if (searchSize >= kNumSubLists)
+	{
+		searchSize += (1 << (highestBit(searchSize) - kSubListBits)) - 1;
+	}
+
+	uint list, subList;
+	mapSize(searchSize, list, subList);
+
+	uint subListBitmap = (list < kNumLists) ? (m_subListBitmaps[list] & (~0u << subList)) : 0;
+	if (!subListBitmap)
+	{
+		uint listBitmap = (list + 1 < kNumLists) ? (m_listBitmap & (~0u << (list + 1))) : 0;
+		if (listBitmap)
+		{
+			list = lowestBit(listBitmap);
+			subListBitmap = m_subListBitmaps[list];
+		}
+	}
+
+	if (subListBitmap)
+		return m_freeLists[list][lowestBit(subListBitmap)];
+
+	// Nothing in the larger buckets.  The bucket the size itself maps to may still hold a range that fits.
+	mapSize(size, list, subList);
+	for (uint offset = m_freeLists[list][subList]; offset != kInvalidOffset; offset = m_ranges[offset].nextFree)
+	{
+		if (m_ranges[offset].size >= size)
+			return offset;
+	}
+
+	return kInvalidOffset;
+}
+
+void RdrDescriptorAllocator::insertFreeRange(uint offset)
+{
+	Range& rRange = m_ranges[offset];
+
+	uint list, subList;
+	mapSize(rRange.size, list, subList);
+
+	uint head = m_freeLists[list][subList];
+	rRange.prevFree = kInvalidOffset;
+	rRange.nextFree = head;
+	rRange.bFree = true;
+	if (head != kInvalidOffset)
+	{
+		m_ranges[head].prevFree = offset;
+	}
+
+	m_freeLists[list][subList] = offset;
+	m_subListBitmaps[list] |= (1 << subList);
+	m_listBitmap |= (1 << list);
+	++m_freeRanges;
+}
+
+void RdrDescriptorAllocator::removeFreeRange(uint offset)
+{
+	Range& rRange = m_ranges[offset];
+
+	uint list, subList;
+	mapSize(rRange.size, list, subList);
+
+	if (rRange.prevFree != kInvalidOffset)
+	{
+		m_ranges[rRange.prevFree].nextFree = rRange.nextFree;
+	}
+	if (rRange.nextFree != kInvalidOffset)
+	{
+		m_ranges[rRange.nextFree].prevFree = rRange.prevFree;
+	}
+
+	if (m_freeLists[list][subList] == offset)
+	{
+		m_freeLists[list][subList] = rRange.nextFree;
+		if (rRange.nextFree == kInvalidOffset)
+		{
+			m_subListBitmaps[list] &= ~(1 << subList);
+			if (!m_subListBitmaps[list])
+			{
+				m_listBitmap &= ~(1 << list);
+			}
+		}
+	}
+
+	rRange.prevFree = kInvalidOffset;
+	rRange.nextFree = kInvalidOffset;
+	rRange.bFree = false;
+	--m_freeRanges;
+}
+
+uint RdrDescriptorAllocator::Allocate(uint numDescriptors)
+{
+	Assert(numDescriptors > 0);
+
+	uint offset = findFreeRange(numDescriptors);
+	if (offset == kInvalidOffset)
+	{
+		++m_failedAllocations;
+		return kInvalidOffset;
+	}
+
+	removeFreeRange(offset);
+
+	// Return whatever is left over to the free lists.
+	Range& rRange = m_ranges[offset];
+	if (rRange.size > numDescriptors)
+	{
+		uint remainder = offset + numDescriptors;
+		m_ranges[remainder].size = rRange.size - numDescriptors;
+		m_ranges[remainder].prevPhysical = offset;
+
+		uint next = remainder + m_ranges[remainder].size;
+		if (next < m_capacity)
+		{
+			m_ranges[next].prevPhysical = remainder;
+		}
+
+		rRange.size = numDescriptors;
+		insertFreeRange(remainder);
+	}
+
+	m_liveDescriptors += numDescriptors;
+	++m_liveAllocations;
+	m_peakLiveDescriptors = std::max(m_peakLiveDescriptors, m_liveDescriptors);
+
+	return offset;
+}
+
+void RdrDescriptorAllocator::Free(uint offset)
+{
+	Range* pRange = &m_ranges[offset];
+	Assert(pRange->size > 0 && !pRange->bFree);
+
+	m_liveDescriptors -= pRange->size;
+	--m_liveAllocations;
+
+	// Merge with the following range.
+	uint next = offset + pRange->size;
+	if (next < m_capacity && m_ranges[next].bFree)
+	{
+		removeFreeRange(next);
+		pRange->size += m_ranges[next].size;
+		m_ranges[next].size = 0;
+	}
+
+	// Merge into the preceding range.
+	uint prev = pRange->prevPhysical;
+	if (prev != kInvalidOffset && m_ranges[prev].bFree)
+	{
+		removeFreeRange(prev);
+		m_ranges[prev].size += pRange->size;
+		pRange->size = 0;
+
+		offset = prev;
+		pRange = &m_ranges[prev];
+	}
+
+	next = offset + pRange->size;
+	if (next < m_capacity)
+	{
+		m_ranges[next].prevPhysical = offset;
+	}
+
+	insertFreeRange(offset);
+}
+
+uint RdrDescriptorAllocator::GetAllocationSize(uint offset) const
+{
+	return m_ranges[offset].size;
+}
+
+RdrDescriptorAllocator::Stats RdrDescriptorAllocator::GetStats() const
+{
+	Stats stats;
+	stats.capacity = m_capacity;
+	stats.liveDescriptors = m_liveDescriptors;
+	stats.liveAllocations = m_liveAllocations;
+	stats.peakLiveDescriptors = m_peakLiveDescriptors;
+	stats.freeDescriptors = m_capacity - m_liveDescriptors;
+	stats.freeRanges = m_freeRanges;
+	stats.failedAllocations = m_failedAllocations;
+
+	// The largest free range is in the highest non-empty bucket.
+	stats.largestFreeRange = 0;
+	if (m_listBitmap)
+	{
+		uint list = highestBit(m_listBitmap);
+		uint subList = highestBit(m_subListBitmaps[list]);
+		for (uint offset = m_freeLists[list][subList]; offset != kInvalidOffset; offset = m_ranges[offset].nextFree)
+		{
+			stats.largestFreeRange = std::max(stats.largestFreeRange, m_ranges[offset].size);
+		}
+	}
+	stats.fragmentedDescriptors = stats.freeDescriptors - stats.largestFreeRange;
+
+	return stats;
+}
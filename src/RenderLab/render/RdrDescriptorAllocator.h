@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+
+// Allocates contiguous ranges of descriptors from a fixed size heap.
+// Uses a two-level segregated fit (TLSF) scheme: free ranges are bucketed by size with bitmaps over the buckets, so finding
+// a range that fits is constant time.  Freed ranges are merged with free neighbors immediately to keep fragmentation down.
+// Only deals in offsets and has no graphics API dependencies; the caller owns the descriptors the offsets refer to.
+class RdrDescriptorAllocator
+{
+public:
+	static const uint kInvalidOffset = ~0u;
+
+	struct Stats
+	{
+		uint capacity;
+		uint liveDescriptors;
+		uint liveAllocations;
+		uint peakLiveDescriptors;
+		uint freeDescriptors;
+		uint freeRanges;
+		uint largestFreeRange;
+		uint fragmentedDescriptors;	// Free descriptors outside of the largest free range.
+		uint failedAllocations;		// Allocations that didn't fit since Init().
+	};
+
+	RdrDescriptorAllocator();
+
+	void Init(uint capacity);
+
+	// Returns the offset of a range of numDescriptors, or kInvalidOffset if there is no free range large enough.
+	uint Allocate(uint numDescriptors);
+	void Free(uint offset);
+
+	uint GetAllocationSize(uint offset) const;
+
+	Stats GetStats() const;
+
+private:
+	// Free ranges smaller than kNumSubLists are bucketed exactly.  Above that, each power of two is split into kNumSubLists buckets.
+	static const uint kSubListBits = 4;
+	static const uint kNumSubLists = 1 << kSubListBits;
+	static const uint kNumLists = 32 - kSubListBits + 1;
+
+	struct Range
+	{
+		uint size;			// Zero if this offset isn't the start of a range.
+		uint prevPhysical;	// Start of the range immediately before this one, or kInvalidOffset.
+		uint prevFree;		// Neighbors in the free list when this range is free.
+		uint nextFree;
+		bool bFree;
+	};
+
+	void mapSize(uint size, uint& rOutList, uint& rOutSubList) const;
+	uint findFreeRange(uint size) const;
+	void insertFreeRange(uint offset);
+	void removeFreeRange(uint offset);
+
+	std::vector<Range> m_ranges; // Indexed by offset.
+	uint m_freeLists[kNumLists][kNumSubLists];
+	uint m_listBitmap;
+	uint m_subListBitmaps[kNumLists];
+
+	uint m_capacity;
+	uint m_liveDescriptors;
+	uint m_liveAllocations;
+	uint m_peakLiveDescriptors;
+	uint m_freeRanges;
+	uint m_failedAllocations;
+};
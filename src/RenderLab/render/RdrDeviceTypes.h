@@ -50,8 +50,7 @@ private:
 	CD3DX12_GPU_DESCRIPTOR_HANDLE m_hGpuDesc;
 
 	int m_nRefCount			= 0;
-	uint8 m_nTableSize		= 0;
-	uint8 m_nTableListIndex	= 0;
+	uint m_nTableSize		= 0;
 
 	uint64 m_nLastUsedFrameCode = 0;
 	RdrDebugBackpointer m_debugCreator;
@@ -489,6 +488,9 @@ inline DXGI_FORMAT getD3DVertexInputFormat(RdrVertexInputFormat eFormat)
 		DXGI_FORMAT_R32G32B32_FLOAT,	// RdrVertexInputFormat::RGB_F32
 		DXGI_FORMAT_R32G32B32A32_FLOAT,	// RdrVertexInputFormat::RGBA_F32
 		DXGI_FORMAT_R8G8B8A8_UINT,		// RdrVertexInputFormat::RGBA_U8
+		DXGI_FORMAT_R16G16_FLOAT,		// RdrVertexInputFormat::RG_F16
+		DXGI_FORMAT_R16G16_SNORM,		// RdrVertexInputFormat::RG_S16_SNORM
+		DXGI_FORMAT_R16G16B16A16_UNORM,	// RdrVertexInputFormat::RGBA_U16_UNORM
 	};
 	static_assert(ARRAY_SIZE(s_d3dFormats) == (int)RdrVertexInputFormat::Count, "Missing D3D12 vertex input format!");
 	return s_d3dFormats[(int)eFormat];
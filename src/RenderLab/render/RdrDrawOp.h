@@ -36,6 +36,13 @@ struct RdrDrawOpSortKey
 
 static_assert(sizeof(RdrDrawOpSortKey) == sizeof(uint64), "RdrDrawOpSortKey size has changed.  Update compare vals.");
 
+// Range of indices relative to the start of a geometry's indices.
+struct RdrIndexRange
+{
+	uint nIndexStart;
+	uint nIndexCount;
+};
+
 struct RdrDrawOp
 {
 	static void BuildSortKey(const RdrDrawOp* pDrawOp, const float minDepth, RdrDrawOpSortKey& rOutKey);
@@ -51,6 +58,11 @@ struct RdrDrawOp
 	RdrResourceHandle hCustomInstanceBuffer;
 	uint16 instanceCount;
 
+	// Optional subset of the geometry to draw, such as the clusters that survived culling.
+	// Draw ops with index ranges are never instanced.
+	const RdrIndexRange* aIndexRanges;
+	uint16 numIndexRanges;
+
 	uint8 bHasAlpha : 1;
 	uint8 unused : 7;
 
@@ -6,7 +6,6 @@
 
 namespace
 {
-	static const uint kMaxFrames = 2;
 	const uint kFrameMemSize = 64 * 1024 * 1024;
 	const uint kFrameDrawOps = 16 * 1024;
 	const uint kFrameComputeOps = 1 * 1024;
@@ -18,13 +17,21 @@ namespace
 		StructLinearAllocator<RdrComputeOp, kFrameComputeOps> computeOps;
 	};
 
-	FrameDataSet s_frameMem[kMaxFrames];
+	// Allocated at init so only the frame states in use are committed.
+	FrameDataSet* s_frameMem = nullptr;
 	uint s_frame = 0;
 }
 
-void RdrFrameMem::FlipState()
+void RdrFrameMem::Init(uint numFrameStates)
 {
-	s_frame = (s_frame + 1) % kMaxFrames;
+	Assert(!s_frameMem);
+	s_frameMem = new FrameDataSet[numFrameStates];
+	s_frame = 0;
+}
+
+void RdrFrameMem::FlipState(uint nQueueState)
+{
+	s_frame = nQueueState;
 	s_frameMem[s_frame].genericMem.Reset();
 	s_frameMem[s_frame].drawOps.Reset();
 	s_frameMem[s_frame].computeOps.Reset();
@@ -6,8 +6,8 @@ struct RdrDrawOp;
 struct RdrComputeOp;
 
 // Allocator for transient frame memory.
-// This is implemented as two linear allocators that are flipped between frames.
-// As such, memory does not need to be explicitly freed, but it becomes invalid every frame.
+// This is implemented as one set of linear allocators per frame state, which are reset when the main thread starts queuing into them again.
+// As such, memory does not need to be explicitly freed, but it becomes invalid once the render thread has finished the frame.
 // Should really only be used for queuing render thread commands.
 namespace RdrFrameMem
 {
@@ -18,5 +18,9 @@ namespace RdrFrameMem
 	RdrDrawOp* AllocDrawOps(uint16 count, const RdrDebugBackpointer& src);
 	RdrComputeOp* AllocComputeOp(const RdrDebugBackpointer& src);
 
-	void FlipState();
+	void Init(uint numFrameStates);
+
+	// Switches allocations to the frame state the main thread is now queuing into.
+	// The render thread must be finished with that state.
+	void FlipState(uint nQueueState);
 }
@@ -0,0 +1,97 @@
+#include "Precompiled.h"
+#include "RdrFrameSync.h"
+#include <chrono>
+
+namespace
+{
+	typedef std::chrono::steady_clock StallClock;
+
+	float elapsedMs(const StallClock::time_point& start)
+	{
+		return std::chrono::duration<float, std::milli>(StallClock::now() - start).count();
+	}
+}
+
+RdrFrameSync::RdrFrameSync()
+	: m_numFrameStates(kMinFrameStates)
+	, m_queueState(0)
+	, m_renderState(0)
+	, m_numSubmittedFrames(0)
+	, m_bShutdown(false)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void RdrFrameSync::Init(uint numFrameStates)
+{
+	Assert(numFrameStates >= kMinFrameStates);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_numFrameStates = numFrameStates;
+	m_queueState = 0;
+	m_renderState = 0;
+	m_numSubmittedFrames = 0;
+	m_bShutdown = false;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+uint RdrFrameSync::SubmitFrame()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	++m_numSubmittedFrames;
+	m_stats.queuedFrames = m_numSubmittedFrames;
+	m_frameSubmitted.notify_one();
+
+	// The next state is free unless every state has been submitted, in which case it's the one being drawn.
+	StallClock::time_point stallStart = StallClock::now();
+	m_frameFinished.wait(lock, [this] { return m_numSubmittedFrames < m_numFrameStates || m_bShutdown; });
+
+	m_stats.mainStallMs = elapsedMs(stallStart);
+	m_stats.peakMainStallMs = std::max(m_stats.peakMainStallMs, m_stats.mainStallMs);
+
+	uint nextState = (m_queueState + 1) % m_numFrameStates;
+	m_queueState = nextState;
+	return nextState;
+}
+
+void RdrFrameSync::Shutdown()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_bShutdown = true;
+	m_frameSubmitted.notify_all();
+	m_frameFinished.notify_all();
+}
+
+bool RdrFrameSync::BeginRenderFrame(uint& rOutState)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	StallClock::time_point stallStart = StallClock::now();
+	m_frameSubmitted.wait(lock, [this] { return m_numSubmittedFrames > 0 || m_bShutdown; });
+
+	m_stats.renderStallMs = elapsedMs(stallStart);
+	m_stats.peakRenderStallMs = std::max(m_stats.peakRenderStallMs, m_stats.renderStallMs);
+
+	if (m_bShutdown)
+		return false;
+
+	rOutState = m_renderState;
+	return true;
+}
+
+void RdrFrameSync::EndRenderFrame()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Assert(m_numSubmittedFrames > 0);
+	--m_numSubmittedFrames;
+	m_renderState = (m_renderState + 1) % m_numFrameStates;
+	m_frameFinished.notify_one();
+}
+
+RdrFrameSync::Stats RdrFrameSync::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
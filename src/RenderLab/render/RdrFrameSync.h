@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+// Hands frame states between the main thread, which queues frames, and the render thread, which draws them.
+// The states form a ring.  The main thread can run up to (numFrameStates - 1) frames ahead of the frame being drawn,
+// so a spike on one thread is absorbed by the queue rather than immediately stalling the other one.
+// Uses only standard library primitives so it has no platform or graphics API dependencies.
+class RdrFrameSync
+{
+public:
+	static const uint kMinFrameStates = 2;
+
+	struct Stats
+	{
+		float mainStallMs;		// Time the main thread waited for a free frame state in the last SubmitFrame().
+		float renderStallMs;	// Time the render thread waited for a frame in the last BeginRenderFrame().
+		float peakMainStallMs;
+		float peakRenderStallMs;
+		uint queuedFrames;		// Frames submitted and not yet finished by the render thread, as of the last submit.
+	};
+
+	RdrFrameSync();
+
+	void Init(uint numFrameStates);
+	uint GetNumFrameStates() const { return m_numFrameStates; }
+
+	/////////////////////////////////////////////////////////////
+	// Main thread
+
+	// State that frames are currently being queued into.  Safe to read from any thread.
+	uint GetQueueState() const { return m_queueState; }
+
+	// Hands the queued state to the render thread and returns the next state to queue into.
+	// Blocks until the render thread has finished with that state if every state is in use.
+	uint SubmitFrame();
+
+	// Makes the render thread stop waiting for frames.
+	void Shutdown();
+
+	/////////////////////////////////////////////////////////////
+	// Render thread
+
+	// Waits for a submitted frame and returns its state.  Returns false once Shutdown() has been called.
+	bool BeginRenderFrame(uint& rOutState);
+	// Returns the state being drawn to the main thread.
+	void EndRenderFrame();
+
+	Stats GetStats() const;
+
+private:
+	mutable std::mutex m_mutex;
+	std::condition_variable m_frameSubmitted;
+	std::condition_variable m_frameFinished;
+
+	uint m_numFrameStates;
+	std::atomic<uint> m_queueState;
+	uint m_renderState;
+	uint m_numSubmittedFrames;	// Includes the frame being drawn.
+	bool m_bShutdown;
+
+	Stats m_stats;
+};
@@ -0,0 +1,141 @@
+#include "Precompiled.h"
+#include "RdrInstanceIdRing.h"
+
+namespace
+{
+	uint calcNumBlocks(uint numIds)
+	{
+		return (numIds + RdrInstanceIdRing::kIdsPerBlock - 1) / RdrInstanceIdRing::kIdsPerBlock;
+	}
+}
+
+RdrInstanceIdRing::RdrInstanceIdRing()
+	: m_numBlocks(0)
+	, m_headBlock(0)
+	, m_usedBlocks(0)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void RdrInstanceIdRing::Init(uint numBlocks)
+{
+	m_frames.clear();
+	m_numBlocks = numBlocks;
+	m_headBlock = 0;
+	m_usedBlocks = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void RdrInstanceIdRing::BeginFrame(uint64 frameNum, uint64 lastCompletedFrame)
+{
+	while (!m_frames.empty() && m_frames.front().frameNum <= lastCompletedFrame)
+	{
+		m_usedBlocks -= m_frames.front().numBlocks;
+		m_frames.pop_front();
+	}
+
+	// Nothing is in flight, so start over from the beginning to keep lists from straddling the end of the ring.
+	if (m_usedBlocks == 0)
+	{
+		m_headBlock = 0;
+	}
+
+	FrameRange frame;
+	frame.frameNum = frameNum;
+	frame.startBlock = m_headBlock;
+	frame.numBlocks = 0;
+	m_frames.push_back(frame);
+
+	m_stats.listsThisFrame = 0;
+	m_stats.idsThisFrame = 0;
+	m_stats.blocksInUse = m_usedBlocks;
+}
+
+uint RdrInstanceIdRing::GetListCapacity(uint maxIds, uint& rOutOffset)
+{
+	Assert(!m_frames.empty());
+
+	rOutOffset = 0;
+	if (m_usedBlocks == m_numBlocks)
+	{
+		++m_stats.failedLists;
+		return 0;
+	}
+
+	// Free space runs from the head to the oldest block still in use, which may mean wrapping around the end of the ring.
+	// Frames that didn't write anything don't hold any space.
+	uint tailBlock = m_headBlock;
+	for (const FrameRange& rFrame : m_frames)
+	{
+		if (rFrame.numBlocks > 0)
+		{
+			tailBlock = rFrame.startBlock;
+			break;
+		}
+	}
+
+	uint blocksAtHead;
+	uint blocksAtStart;
+	if (m_headBlock >= tailBlock)
+	{
+		blocksAtHead = m_numBlocks - m_headBlock;
+		blocksAtStart = tailBlock;
+	}
+	else
+	{
+		blocksAtHead = tailBlock - m_headBlock;
+		blocksAtStart = 0;
+	}
+
+	uint neededBlocks = calcNumBlocks(maxIds);
+	uint startBlock = m_headBlock;
+	uint availableBlocks = blocksAtHead;
+	if (blocksAtHead < neededBlocks && blocksAtStart > blocksAtHead)
+	{
+		startBlock = 0;
+		availableBlocks = blocksAtStart;
+	}
+
+	if (availableBlocks == 0)
+	{
+		++m_stats.failedLists;
+		return 0;
+	}
+
+	rOutOffset = startBlock * kIdsPerBlock;
+	return std::min(maxIds, availableBlocks * kIdsPerBlock);
+}
+
+void RdrInstanceIdRing::CommitList(uint offset, uint numIds)
+{
+	if (numIds == 0)
+		return;
+
+	FrameRange& rFrame = m_frames.back();
+	uint startBlock = offset / kIdsPerBlock;
+	if (startBlock != m_headBlock)
+	{
+		// The list wrapped.  The skipped blocks at the end of the ring are freed along with the rest of the frame.
+		Assert(startBlock == 0);
+		uint skippedBlocks = m_numBlocks - m_headBlock;
+		rFrame.numBlocks += skippedBlocks;
+		m_usedBlocks += skippedBlocks;
+		m_headBlock = 0;
+	}
+
+	uint numBlocks = calcNumBlocks(numIds);
+	Assert(m_usedBlocks + numBlocks <= m_numBlocks);
+
+	rFrame.numBlocks += numBlocks;
+	m_usedBlocks += numBlocks;
+	m_headBlock += numBlocks;
+	if (m_headBlock == m_numBlocks)
+	{
+		m_headBlock = 0;
+	}
+
+	++m_stats.listsThisFrame;
+	m_stats.idsThisFrame += numIds;
+	m_stats.blocksInUse = m_usedBlocks;
+	m_stats.peakBlocksInUse = std::max(m_stats.peakBlocksInUse, m_usedBlocks);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <deque>
+
+// Packs the instance id lists of instanced draws into a ring buffer that is shared by every frame.
+// Lists start on constant buffer view boundaries (256 bytes) so each one can be bound directly as the ids buffer.
+// Space written during a frame is reclaimed once the GPU has finished that frame.
+// Only deals in offsets and has no graphics API dependencies; the caller owns the memory the offsets refer to.
+class RdrInstanceIdRing
+{
+public:
+	static const uint kBlockSize = 256;
+	static const uint kIdsPerBlock = kBlockSize / sizeof(uint);
+
+	struct Stats
+	{
+		uint listsThisFrame;
+		uint idsThisFrame;
+		uint blocksInUse;		// Blocks held by frames the GPU may still be reading, including the current frame.
+		uint peakBlocksInUse;
+		uint failedLists;		// Lists that didn't fit in the ring since Init().
+	};
+
+	RdrInstanceIdRing();
+
+	void Init(uint numBlocks);
+
+	// Starts a new frame and reclaims the space used by every frame up to and including lastCompletedFrame.
+	void BeginFrame(uint64 frameNum, uint64 lastCompletedFrame);
+
+	// Finds space for a new list of up to maxIds ids without committing it.
+	// Returns how many ids can be written starting at rOutOffset (in ids from the start of the ring), or 0 if the ring is full.
+	uint GetListCapacity(uint maxIds, uint& rOutOffset);
+
+	// Commits a list found with GetListCapacity().  Committing 0 ids releases the space again.
+	void CommitList(uint offset, uint numIds);
+
+	uint GetNumBlocks() const { return m_numBlocks; }
+	uint GetCapacity() const { return m_numBlocks * kIdsPerBlock; }
+
+	const Stats& GetStats() const { return m_stats; }
+
+private:
+	struct FrameRange
+	{
+		uint64 frameNum;
+		uint startBlock;
+		uint numBlocks; // Includes blocks skipped when wrapping back to the start of the ring.
+	};
+
+	std::deque<FrameRange> m_frames; // Frames that haven't been reclaimed yet, oldest first.
+	uint m_numBlocks;
+	uint m_headBlock;	// Next block to write.
+	uint m_usedBlocks;
+	Stats m_stats;
+};
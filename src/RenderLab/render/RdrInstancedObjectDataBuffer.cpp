@@ -1,18 +1,81 @@
 #include "Precompiled.h"
 #include "RdrInstancedObjectDataBuffer.h"
 #include "RdrResourceSystem.h"
+#include "RdrFrameMem.h"
 #include "Renderer.h"
 
 namespace
 {
+	const uint kMaxEntries = 6 * 1024;
+	const uint kNumDirtyWords = kMaxEntries / 64;
+
+	// One GPU copy per frame that can be in flight so uploads never touch a buffer the GPU may be reading.
+	const uint kNumBuffers = kNumBackBuffers;
+
+	// Clean gaps smaller than this are uploaded along with the dirty entries around them to save on update commands.
+	const uint kMinRangeGap = 8;
+
+	struct DirtyRange
+	{
+		uint firstEntry;
+		uint numEntries;
+	};
+
 	struct ObjectBuffer
 	{
-		ObjectBuffer() : currentFrame(0) {}
+		ObjectBuffer() : queueBuffer(0), activeBuffer(0), queueState(0) {}
+
+		FreeList<VsPerObject, kMaxEntries> data;
+		RdrResourceHandle hResources[kNumBuffers];
+
+		// Entries that changed since each buffer was last updated.
+		uint64 dirtyBits[kNumBuffers][kNumDirtyWords];
+
+		uint queueBuffer;	// Buffer the next UpdateBuffer() writes to.
+		uint activeBuffer;	// Buffer used by the frame being rendered.
+
+		// The main thread can be several frames ahead of the render thread, so each frame state records the buffer it was updated with.
+		uint stateBuffers[kMaxFrameStates];
+		uint queueState;
 
-		FreeList<VsPerObject, 6 * 1024> data;
-		RdrResourceHandle hResource;
-		uint currentFrame;
+		std::vector<DirtyRange> ranges;
+		RdrInstancedObjectDataBuffer::Stats stats;
 	} s_objectBuffer;
+
+	// Collects the set bits as ranges of entries and clears them.  Returns the number of dirty entries.
+	uint extractDirtyRanges(uint64* pDirtyWords, std::vector<DirtyRange>& rRanges)
+	{
+		uint numDirty = 0;
+		rRanges.clear();
+		for (uint word = 0; word < kNumDirtyWords; ++word)
+		{
+			uint64 bits = pDirtyWords[word];
+			if (!bits)
+				continue;
+
+			pDirtyWords[word] = 0;
+			for (uint bit = 0; bits; ++bit, bits >>= 1)
+			{
+				if (!(bits & 1))
+					continue;
+
+				uint entry = word * 64 + bit;
+				++numDirty;
+
+				if (!rRanges.empty() && entry < rRanges.back().firstEntry + rRanges.back().numEntries + kMinRangeGap)
+				{
+					rRanges.back().numEntries = entry - rRanges.back().firstEntry + 1;
+				}
+				else
+				{
+					DirtyRange range = { entry, 1 };
+					rRanges.push_back(range);
+				}
+			}
+		}
+
+		return numDirty;
+	}
 }
 
 RdrInstancedObjectDataId RdrInstancedObjectDataBuffer::AllocEntry()
@@ -21,11 +84,22 @@ RdrInstancedObjectDataId RdrInstancedObjectDataBuffer::AllocEntry()
 	return s_objectBuffer.data.getId(pData);
 }
 
-VsPerObject* RdrInstancedObjectDataBuffer::GetEntry(RdrInstancedObjectDataId id)
+const VsPerObject* RdrInstancedObjectDataBuffer::GetEntry(RdrInstancedObjectDataId id)
 {
 	return s_objectBuffer.data.get(id);
 }
 
+void RdrInstancedObjectDataBuffer::SetEntry(RdrInstancedObjectDataId id, const VsPerObject& rData)
+{
+	*s_objectBuffer.data.get(id) = rData;
+
+	uint64 bit = 1ull << (id % 64);
+	for (uint i = 0; i < kNumBuffers; ++i)
+	{
+		s_objectBuffer.dirtyBits[i][id / 64] |= bit;
+	}
+}
+
 void RdrInstancedObjectDataBuffer::ReleaseEntry(RdrInstancedObjectDataId id)
 {
 	s_objectBuffer.data.releaseIdSafe(id);
@@ -33,31 +107,64 @@ void RdrInstancedObjectDataBuffer::ReleaseEntry(RdrInstancedObjectDataId id)
 
 void RdrInstancedObjectDataBuffer::UpdateBuffer(Renderer& rRenderer)
 {
-	// TODO: This is not safe.  The buffer data could be changing on the main thread
-	//	while the render thread processes the update.  This should use immediate commands instead.
-	uint lastObject = s_objectBuffer.data.getMaxUsedId();
-	if (!s_objectBuffer.hResource)
+	if (!s_objectBuffer.hResources[0])
 	{
-		s_objectBuffer.hResource = RdrResourceSystem::CreateStructuredBuffer(
-			s_objectBuffer.data.data(), 
-			s_objectBuffer.data.kMaxEntries, 
-			sizeof(VsPerObject), 
-			RdrResourceAccessFlags::CpuRW_GpuRO,
-			CREATE_NULL_BACKPOINTER);
+		// Entries are uploaded as they're set, so the buffers don't need initial data.
+		for (uint i = 0; i < kNumBuffers; ++i)
+		{
+			s_objectBuffer.hResources[i] = RdrResourceSystem::CreateStructuredBuffer(
+				nullptr,
+				kMaxEntries,
+				sizeof(VsPerObject),
+				RdrResourceAccessFlags::CpuRW_GpuRO,
+				CREATE_NULL_BACKPOINTER);
+		}
 	}
-	else if (lastObject > 0)
+
+	RdrInstancedObjectDataBuffer::Stats& rStats = s_objectBuffer.stats;
+	rStats.uploadRanges = 0;
+	rStats.bytesUploaded = 0;
+	rStats.fullRangeBytes = s_objectBuffer.data.getMaxUsedId() * sizeof(VsPerObject);
+
+	uint bufferIndex = s_objectBuffer.queueBuffer;
+	s_objectBuffer.stateBuffers[s_objectBuffer.queueState] = bufferIndex;
+	rStats.dirtyEntries = extractDirtyRanges(s_objectBuffer.dirtyBits[bufferIndex], s_objectBuffer.ranges);
+
+	// The entries can change on the main thread before the render thread processes the updates, so upload from a copy.
+	RdrResourceCommandList& rResCommandList = rRenderer.GetResourceCommandList();
+	for (const DirtyRange& rRange : s_objectBuffer.ranges)
 	{
-		RdrResourceCommandList& rResCommandList = rRenderer.GetResourceCommandList();
-		rResCommandList.UpdateBuffer(s_objectBuffer.hResource, s_objectBuffer.data.data(), lastObject, CREATE_NULL_BACKPOINTER);
+		uint rangeSize = rRange.numEntries * sizeof(VsPerObject);
+		void* pRangeData = RdrFrameMem::AllocAligned(rangeSize, 16);
+		memcpy(pRangeData, s_objectBuffer.data.data() + rRange.firstEntry, rangeSize);
+
+		rResCommandList.UpdateBufferRange(s_objectBuffer.hResources[bufferIndex], pRangeData,
+			rRange.firstEntry, rRange.numEntries, CREATE_NULL_BACKPOINTER);
+
+		++rStats.uploadRanges;
+		rStats.bytesUploaded += rangeSize;
 	}
 }
 
-void RdrInstancedObjectDataBuffer::FlipState()
+void RdrInstancedObjectDataBuffer::FlipState(uint nQueueState)
+{
+	// The render thread draws frames in the order they were queued, so rotating per queued frame keeps
+	// kNumBuffers frames between uploads to the same buffer regardless of how many frames are queued.
+	s_objectBuffer.queueBuffer = (s_objectBuffer.queueBuffer + 1) % kNumBuffers;
+	s_objectBuffer.queueState = nQueueState;
+}
+
+void RdrInstancedObjectDataBuffer::BeginFrame(uint nFrameState)
 {
-	s_objectBuffer.currentFrame = !s_objectBuffer.currentFrame;
+	s_objectBuffer.activeBuffer = s_objectBuffer.stateBuffers[nFrameState];
 }
 
 RdrResourceHandle RdrInstancedObjectDataBuffer::GetResourceHandle()
 {
-	return s_objectBuffer.hResource;
+	return s_objectBuffer.hResources[s_objectBuffer.activeBuffer];
+}
+
+const RdrInstancedObjectDataBuffer::Stats& RdrInstancedObjectDataBuffer::GetStats()
+{
+	return s_objectBuffer.stats;
 }
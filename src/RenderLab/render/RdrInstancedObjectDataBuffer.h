@@ -9,12 +9,29 @@ typedef uint16 RdrInstancedObjectDataId;
 
 namespace RdrInstancedObjectDataBuffer
 {
+	struct Stats
+	{
+		uint dirtyEntries;
+		uint uploadRanges;
+		uint bytesUploaded;		// Bytes queued for upload by the last UpdateBuffer().
+		uint fullRangeBytes;	// Bytes a full re-upload of every entry up to the highest live id would have taken.
+	};
+
 	RdrInstancedObjectDataId AllocEntry();
 	void ReleaseEntry(RdrInstancedObjectDataId id);
-	VsPerObject* GetEntry(RdrInstancedObjectDataId id);
+	const VsPerObject* GetEntry(RdrInstancedObjectDataId id);
+	void SetEntry(RdrInstancedObjectDataId id, const VsPerObject& rData);
 	
 	RdrResourceHandle GetResourceHandle();
+
+	// Queues uploads of the entries that changed since the buffer for the next frame was last updated.
+	// Must be called from the frame sync point.
 	void UpdateBuffer(Renderer& rRenderer);
 
-	void FlipState();
-}
\ No newline at end of file
+	// Main thread.  Frame states are indexed the same as the renderer's.
+	void FlipState(uint nQueueState);
+	// Render thread.  Selects the buffer the frame state was updated with.
+	void BeginFrame(uint nFrameState);
+
+	const Stats& GetStats();
+}
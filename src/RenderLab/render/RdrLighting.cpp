@@ -5,6 +5,7 @@
 #include "Scene.h"
 #include "RdrComputeOp.h"
 #include "RdrOffscreenTasks.h"
+#include "LightCulling.h"
 #include "components/Light.h"
 #include "components/SkyVolume.h"
 #include "Entity.h"
@@ -43,6 +44,43 @@ namespace
 		boundsMax = Vec3Max(boundsMax, quad.topLeft);
 		boundsMax = Vec3Max(boundsMax, quad.topRight);
 	}
+
+	// Inputs to a frame's clustered light culling, kept until the shader's light lists for that frame are read back.
+	struct ClusteredLightValidation
+	{
+		ClusteredLightCullingParams params;
+		std::vector<SpotLight> spotLights;
+		std::vector<PointLight> pointLights;
+	};
+
+	void validateClusteredLightsReadback(const void* pData, uint dataSize, void* pUserData)
+	{
+		ClusteredLightValidation* pValidation = (ClusteredLightValidation*)pUserData;
+		Assert(dataSize == LightCulling::GetClusteredLightIndexCount(pValidation->params) * sizeof(uint16));
+
+		uint numClusters = pValidation->params.clusterCountX * pValidation->params.clusterCountY * pValidation->params.clusterCountZ;
+		uint numMismatches = LightCulling::ValidateClusteredLights(pValidation->params,
+			pValidation->spotLights.data(), pValidation->pointLights.data(), (const uint16*)pData);
+
+		char msg[256];
+		sprintf_s(msg, "Clustered light validation: %u of %u clusters don't match the CPU assignment (%u spot lights, %u point lights).\n",
+			numMismatches, numClusters, pValidation->params.spotLightCount, pValidation->params.pointLightCount);
+		OutputDebugStringA(msg);
+
+		delete pValidation;
+	}
+
+	// Reads back the light lists the culling shader produces this frame and checks them against the CPU assignment.
+	void queueClusteredLightValidation(const ClusteredLightCullingParams& rParams, const RdrLightList* pLights, RdrResourceHandle hLightIndices)
+	{
+		ClusteredLightValidation* pValidation = new ClusteredLightValidation();
+		pValidation->params = rParams;
+		pValidation->spotLights.assign(pLights->m_spotLights.getData(), pLights->m_spotLights.getData() + pLights->m_spotLights.size());
+		pValidation->pointLights.assign(pLights->m_pointLights.getData(), pLights->m_pointLights.getData() + pLights->m_pointLights.size());
+
+		uint dataSize = LightCulling::GetClusteredLightIndexCount(rParams) * sizeof(uint16);
+		g_pRenderer->IssueStructuredBufferReadbackRequest(hLightIndices, 0, dataSize, validateClusteredLightsReadback, pValidation);
+	}
 }
 
 
@@ -258,6 +296,7 @@ void RdrLighting::QueueDraw(RdrAction* pAction, RdrLightList* pLights, RdrLighti
 		}
 	}
 
+	// Spot and point lights are queued by the scene in order of screen importance, so the most visible lights get the shadow maps.
 	for (SpotLight& rSpotLight : pLights->m_spotLights)
 	{
 		int remainingShadowMaps = MAX_SHADOW_MAPS - curShadowMapIndex - 1;
@@ -343,7 +382,7 @@ void RdrLighting::QueueDraw(RdrAction* pAction, RdrLightList* pLights, RdrLighti
 	RdrResourceHandle hLightIndicesRes;
 	if (lightingMethod == RdrLightingMethod::Clustered)
 	{
-		QueueClusteredLightCulling(pAction, rCamera, pLights->m_spotLights.size(), pLights->m_pointLights.size(), pOutResources);
+		QueueClusteredLightCulling(pAction, rCamera, pLights, pOutResources);
 		hLightIndicesRes = m_clusteredLightData.hLightIndices;
 	}
 	else
@@ -382,7 +421,7 @@ void RdrLighting::QueueDraw(RdrAction* pAction, RdrLightList* pLights, RdrLighti
 	sharedResources.hLightIndicesRes = hLightIndicesRes;
 }
 
-void RdrLighting::QueueClusteredLightCulling(RdrAction* pAction, const Camera& rCamera, int numSpotLights, int numPointLights,
+void RdrLighting::QueueClusteredLightCulling(RdrAction* pAction, const Camera& rCamera, const RdrLightList* pLights,
 	RdrActionLightResources* pOutResources)
 {
 	RdrResourceCommandList& rResCommandList = g_pRenderer->GetResourceCommandList();
@@ -412,17 +451,6 @@ void RdrLighting::QueueClusteredLightCulling(RdrAction* pAction, const Camera& r
 			, CREATE_BACKPOINTER(this));
 	}
 
-	RdrComputeOp* pCullOp = RdrFrameMem::AllocComputeOp(CREATE_BACKPOINTER(this));
-	pCullOp->pipelineState = RdrShaderSystem::GetComputeShaderPipelineState(RdrComputeShader::ClusteredLightCull);
-	pCullOp->threads[0] = clusterCountX;
-	pCullOp->threads[1] = clusterCountY;
-	pCullOp->threads[2] = CLUSTEREDLIGHTING_DEPTH_SLICES;
-
-	pCullOp->pUnorderedAccessDescriptorTable = RdrResourceSystem::CreateTempUnorderedAccessViewTable(&m_clusteredLightData.hLightIndices, 1, CREATE_BACKPOINTER(this));
-	
-	RdrResourceHandle ahResources[] = { pOutResources->hSpotLightListRes, pOutResources->hPointLightListRes };
-	pCullOp->pResourceDescriptorTable = RdrResourceSystem::CreateTempShaderResourceViewTable(ahResources, ARRAYSIZE(ahResources), CREATE_BACKPOINTER(this));
-
 	uint constantsSize = sizeof(ClusteredLightCullingParams);
 	ClusteredLightCullingParams* pParams = (ClusteredLightCullingParams*)RdrFrameMem::AllocAligned(constantsSize, 16);
 
@@ -439,13 +467,41 @@ void RdrLighting::QueueClusteredLightCulling(RdrAction* pAction, const Camera& r
 	pParams->clusterCountY = clusterCountY;
 	pParams->clusterCountZ = CLUSTEREDLIGHTING_DEPTH_SLICES;
 	pParams->clusterTileSize = m_clusteredLightData.clusterTileSize;
-	pParams->spotLightCount = numSpotLights;
-	pParams->pointLightCount = numPointLights;
+	pParams->spotLightCount = pLights->m_spotLights.size();
+	pParams->pointLightCount = pLights->m_pointLights.size();
+
+	if (g_debugState.cpuLightCulling)
+	{
+		// Bin lights on the CPU and upload the lists in place of the compute dispatch.
+		// Buffer uploads always cover the whole buffer, so the allocation matches the buffer's capacity.
+		uint bufferSize = m_clusteredLightData.clusterCountX * m_clusteredLightData.clusterCountY * CLUSTEREDLIGHTING_DEPTH_SLICES * CLUSTEREDLIGHTING_BLOCK_SIZE;
+		uint16* pLightIndices = (uint16*)RdrFrameMem::AllocAligned(sizeof(uint16) * bufferSize, 16);
+		LightCulling::AssignClusteredLights(*pParams, pLights->m_spotLights.getData(), pLights->m_pointLights.getData(), pLightIndices);
+		rResCommandList.UpdateBuffer(m_clusteredLightData.hLightIndices, pLightIndices, bufferSize, CREATE_BACKPOINTER(this));
+		return;
+	}
+
+	RdrComputeOp* pCullOp = RdrFrameMem::AllocComputeOp(CREATE_BACKPOINTER(this));
+	pCullOp->pipelineState = RdrShaderSystem::GetComputeShaderPipelineState(RdrComputeShader::ClusteredLightCull);
+	pCullOp->threads[0] = clusterCountX;
+	pCullOp->threads[1] = clusterCountY;
+	pCullOp->threads[2] = CLUSTEREDLIGHTING_DEPTH_SLICES;
+
+	pCullOp->pUnorderedAccessDescriptorTable = RdrResourceSystem::CreateTempUnorderedAccessViewTable(&m_clusteredLightData.hLightIndices, 1, CREATE_BACKPOINTER(this));
+	
+	RdrResourceHandle ahResources[] = { pOutResources->hSpotLightListRes, pOutResources->hPointLightListRes };
+	pCullOp->pResourceDescriptorTable = RdrResourceSystem::CreateTempShaderResourceViewTable(ahResources, ARRAYSIZE(ahResources), CREATE_BACKPOINTER(this));
 
 	RdrConstantBufferHandle hCullConstants = RdrResourceSystem::CreateTempConstantBuffer(pParams, constantsSize, CREATE_BACKPOINTER(this));
 	pCullOp->pConstantsDescriptorTable = RdrResourceSystem::CreateTempConstantBufferTable(&hCullConstants, 1, CREATE_BACKPOINTER(this));
 
 	pAction->AddComputeOp(pCullOp, RdrPass::LightCulling);
+
+	if (g_debugState.validateLightCulling)
+	{
+		queueClusteredLightValidation(*pParams, pLights, m_clusteredLightData.hLightIndices);
+		g_debugState.validateLightCulling = false;
+	}
 }
 
 void RdrLighting::QueueTiledLightCulling(RdrAction* pAction, const Camera& rCamera, int numSpotLights, int numPointLights)
@@ -67,12 +67,15 @@ struct RdrActionLightResources
 
 struct RdrLightList
 {
+	static const uint kMaxPointLights = 256;
+	static const uint kMaxSpotLights = 256;
+
 	void AddLight(const Light* pLight);
 	void Clear();
 
 	FixedVector<DirectionalLight, 4> m_directionalLights;
-	FixedVector<PointLight, 256> m_pointLights;
-	FixedVector<SpotLight, 256> m_spotLights;
+	FixedVector<PointLight, kMaxPointLights> m_pointLights;
+	FixedVector<SpotLight, kMaxSpotLights> m_spotLights;
 	FixedVector<EnvironmentLight, 64> m_environmentLights;
 	EnvironmentLight m_globalEnvironmentLight;
 };
@@ -91,7 +94,7 @@ public:
 private:
 	void LazyInitShadowResources();
 
-	void QueueClusteredLightCulling(RdrAction* pAction, const Camera& rCamera, int numSpotLights, int numPointLights,
+	void QueueClusteredLightCulling(RdrAction* pAction, const Camera& rCamera, const RdrLightList* pLights,
 		RdrActionLightResources* pOutResources);
 	void QueueTiledLightCulling(RdrAction* pAction, const Camera& rCamera, int numSpotLights, int numPointLights);
 	void QueueVolumetricFog(RdrAction* pAction, const AssetLib::VolumetricFogSettings& rFogSettings, const RdrResourceHandle hLightIndicesRes);
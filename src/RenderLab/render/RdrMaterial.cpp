@@ -1,6 +1,7 @@
 #include "Precompiled.h"
 #include "RdrMaterial.h"
 #include "RdrShaderSystem.h"
+#include "RdrPipelineStateCache.h"
 #include "RdrResourceSystem.h"
 #include "RdrFrameMem.h"
 #include "RdrShaderConstants.h"
@@ -11,7 +12,7 @@
 
 namespace
 {
-	typedef std::map<Hashing::SHA1, RdrMaterial*> RdrMaterialLayoutMap;
+	typedef std::map<uint64, RdrMaterial*> RdrMaterialLayoutMap;
 	typedef std::map<Hashing::StringHash, RdrMaterialLayoutMap> RdrMaterialNameMap;
 	typedef FreeList<RdrMaterial, 1024> RdrMaterialList;
 
@@ -23,14 +24,19 @@ namespace
 		return Hashing::HashString(materialName);
 	}
 
-	Hashing::SHA1 makeMaterialLayoutHash(const RdrVertexInputElement* pInputLayout, uint nNumInputElements)
+	uint64 makeMaterialLayoutHash(const RdrVertexInputElement* pInputLayout, uint nNumInputElements)
 	{
-		Hashing::SHA1HashState* pHashState = Hashing::SHA1::Begin(pInputLayout, nNumInputElements * sizeof(pInputLayout[0]));
-		
-		Hashing::SHA1 materialHash;
-		Hashing::SHA1::Finish(pHashState, materialHash);
+		return Hashing::HashData64(pInputLayout, nNumInputElements * sizeof(pInputLayout[0]));
+	}
 
-		return materialHash;
+	bool hasPackedVertices(const RdrVertexInputElement* pInputLayout, uint nNumInputElements)
+	{
+		for (uint i = 0; i < nNumInputElements; ++i)
+		{
+			if (pInputLayout[i].semantic == RdrShaderSemantic::Position)
+				return pInputLayout[i].format == RdrVertexInputFormat::RGBA_U16_UNORM;
+		}
+		return false;
 	}
 
 	void loadMaterial(const CachedString& materialName, const RdrVertexInputElement* pInputLayout, uint nNumInputElements, RdrMaterial* pOutMaterial)
@@ -65,6 +71,11 @@ namespace
 			defines[numDefines++] = "ALPHA_CUTOUT";
 		}
 
+		if (hasPackedVertices(pInputLayout, nNumInputElements))
+		{
+			vertexShader.flags |= RdrShaderFlags::PackedVertices;
+		}
+
 		if (pMaterial->bNormalsBC5)
 		{
 			defines[numDefines++] = "NORMALS_BC5";
@@ -338,7 +349,7 @@ void RdrMaterial::CreatePipelineState(
 {
 	const RdrShader* pVertexShader = RdrShaderSystem::GetVertexShader(vertexShader);
 
-	m_hPipelineStates[(int)eMode] = RdrPipelineState::CreateGraphicsPipelineState(
+	m_hPipelineStates[(int)eMode] = RdrPipelineStateCache::GetGraphicsPipelineState(
 		pVertexShader, pPixelShader,
 		nullptr, nullptr,
 		pInputLayoutElements, nNumInputElements,
@@ -366,7 +377,7 @@ void RdrMaterial::CreateTessellationPipelineState(
 {
 	const RdrShader* pVertexShader = RdrShaderSystem::GetVertexShader(vertexShader);
 
-	m_hPipelineStates[(int)eMode] = RdrPipelineState::CreateGraphicsPipelineState(
+	m_hPipelineStates[(int)eMode] = RdrPipelineStateCache::GetGraphicsPipelineState(
 		pVertexShader, pPixelShader,
 		pHullShader, pDomainShader,
 		pInputLayoutElements, nNumInputElements,
@@ -471,7 +482,7 @@ RdrMaterial* RdrMaterial::Create(const CachedString& materialName, const RdrVert
 {
 	// Check if the material's already been loaded
 	Hashing::StringHash materialNameHash = makeMaterialNameHash(materialName.getString());
-	Hashing::SHA1 materialLayoutHash = makeMaterialLayoutHash(pInputLayout, nNumInputElements);
+	uint64 materialLayoutHash = makeMaterialLayoutHash(pInputLayout, nNumInputElements);
 
 	RdrMaterialNameMap::iterator iterName = s_materialCache.find(materialNameHash);
 	if (iterName != s_materialCache.end())
@@ -0,0 +1,506 @@
+#include "Precompiled.h"
+#include "RdrPipelineStateCache.h"
+#include "RdrShaderSystem.h"
+#include "UtilsLib/Hash.h"
+#include "UtilsLib/StringCache.h"
+#include "UtilsLib/ThreadMutex.h"
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+	const char* kRecordFilename = "pipelinestates.bin";
+	const uint kRecordMagic = 0x4f535052; // "RPSO"
+	const uint kRecordVersion = 1;
+	const uint kMaxDefines = 16; // Must fit the shader system's limit.
+
+	// Shader slots in a state description.
+	const RdrShaderStage kDescShaderStages[] = {
+		RdrShaderStage::Vertex,
+		RdrShaderStage::Pixel,
+		RdrShaderStage::Hull,
+		RdrShaderStage::Domain,
+	};
+	const uint kNumDescShaders = ARRAY_SIZE(kDescShaderStages);
+
+	struct RecordHeader
+	{
+		uint magic;
+		uint version;
+		uint numStates;
+	};
+
+	struct DescHasher
+	{
+		size_t operator()(const std::string& desc) const
+		{
+			return (size_t)Hashing::HashData64(desc.data(), (uint)desc.size());
+		}
+	};
+
+	struct CacheEntry
+	{
+		RdrPipelineState* pPipelineState;
+		uint refCount;
+	};
+
+	void releasePipelineState(RdrPipelineState* pPipelineState)
+	{
+		pPipelineState->Release();
+	}
+
+	RdrPipelineStateCache::Backend makeDefaultBackend()
+	{
+		RdrPipelineStateCache::Backend backend;
+		backend.createGraphicsPipelineState = RdrPipelineState::CreateGraphicsPipelineState;
+		backend.releasePipelineState = releasePipelineState;
+		backend.findShader = RdrShaderSystem::FindShader;
+		backend.recordFilename = nullptr;
+		return backend;
+	}
+
+	typedef std::unordered_map<std::string, CacheEntry, DescHasher> PipelineStateMap;
+	typedef std::unordered_set<std::string, DescHasher> PipelineStateDescSet;
+
+	struct
+	{
+		PipelineStateMap pipelineStates;
+		std::unordered_map<const RdrPipelineState*, const std::string*> pipelineStateDescs;
+
+		// Descriptions of every state created this run, including prewarmed ones.  Written out by Save().
+		PipelineStateDescSet recordedDescs;
+
+		RdrPipelineStateCache::Backend backend = makeDefaultBackend();
+		ThreadMutex mutex;
+
+		uint numHits;
+		uint numMisses;
+		uint numPrewarmed;
+		uint numFailedPrewarms;
+	} s_cache;
+
+	// The full state is stored in the record, so the description is written field by field in a fixed layout.
+	// Shaders are identified by their file and defines rather than pointers so that the record is valid in later runs.
+	template<typename T>
+	void writeValue(std::string& rDesc, const T& value)
+	{
+		rDesc.append((const char*)&value, sizeof(T));
+	}
+
+	void writeString(std::string& rDesc, const char* str)
+	{
+		rDesc.append(str, strlen(str) + 1);
+	}
+
+	void writeShader(std::string& rDesc, const RdrShader* pShader)
+	{
+		writeValue<uint8>(rDesc, pShader ? 1 : 0);
+		if (!pShader)
+			return;
+
+		writeString(rDesc, pShader->filename);
+		writeValue<uint8>(rDesc, (uint8)pShader->defines.size());
+		for (const char* define : pShader->defines)
+		{
+			writeString(rDesc, define);
+		}
+	}
+
+	std::string buildDesc(
+		const RdrShader* apShaders[kNumDescShaders],
+		const RdrVertexInputElement* pInputLayoutElements, uint nNumInputElements,
+		const RdrResourceFormat* pRtvFormats, uint nNumRtvFormats,
+		const RdrBlendMode eBlendMode,
+		const RdrRasterState& rasterState,
+		const RdrDepthStencilState& depthStencilState)
+	{
+		std::string desc;
+		desc.reserve(256);
+
+		for (uint i = 0; i < kNumDescShaders; ++i)
+		{
+			writeShader(desc, apShaders[i]);
+		}
+
+		writeValue<uint8>(desc, (uint8)nNumInputElements);
+		desc.append((const char*)pInputLayoutElements, nNumInputElements * sizeof(RdrVertexInputElement));
+
+		writeValue<uint8>(desc, (uint8)nNumRtvFormats);
+		for (uint i = 0; i < nNumRtvFormats; ++i)
+		{
+			writeValue<uint8>(desc, (uint8)pRtvFormats[i]);
+		}
+
+		writeValue<uint8>(desc, (uint8)eBlendMode);
+
+		// Raster state bitfields are copied individually because the unused bits aren't always initialized.
+		// The sample count comes from the global MSAA level when the pipeline state is created, so it's part of the key.
+		writeValue<uint8>(desc, (uint8)rasterState.bEnableMSAA);
+		writeValue<uint8>(desc, (uint8)rasterState.bEnableScissor);
+		writeValue<uint8>(desc, (uint8)rasterState.bWireframe);
+		writeValue<uint8>(desc, (uint8)rasterState.bUseSlopeScaledDepthBias);
+		writeValue<uint8>(desc, (uint8)rasterState.bDoubleSided);
+		writeValue<uint8>(desc, (uint8)(rasterState.bEnableMSAA ? g_debugState.msaaLevel : 1));
+
+		writeValue<uint8>(desc, (uint8)depthStencilState.bTestDepth);
+		writeValue<uint8>(desc, (uint8)depthStencilState.bWriteDepth);
+		writeValue<uint8>(desc, (uint8)depthStencilState.eDepthFunc);
+
+		return desc;
+	}
+
+	class DescReader
+	{
+	public:
+		DescReader(const std::string& desc)
+			: m_pData(desc.data()), m_pEnd(desc.data() + desc.size()), m_bValid(true) {}
+
+		template<typename T>
+		T ReadValue()
+		{
+			T value = T();
+			if (m_pData + sizeof(T) > m_pEnd)
+			{
+				m_bValid = false;
+				return value;
+			}
+
+			memcpy(&value, m_pData, sizeof(T));
+			m_pData += sizeof(T);
+			return value;
+		}
+
+		const char* ReadString()
+		{
+			const char* str = m_pData;
+			const char* pTerminator = (const char*)memchr(m_pData, 0, m_pEnd - m_pData);
+			if (!pTerminator)
+			{
+				m_bValid = false;
+				return "";
+			}
+
+			m_pData = pTerminator + 1;
+			return str;
+		}
+
+		void ReadBytes(void* pDst, uint size)
+		{
+			if (m_pData + size > m_pEnd)
+			{
+				m_bValid = false;
+				return;
+			}
+
+			memcpy(pDst, m_pData, size);
+			m_pData += size;
+		}
+
+		bool IsValid() const { return m_bValid; }
+		bool IsAtEnd() const { return m_pData == m_pEnd; }
+
+	private:
+		const char* m_pData;
+		const char* m_pEnd;
+		bool m_bValid;
+	};
+
+	struct ParsedDesc
+	{
+		const RdrShader* apShaders[kNumDescShaders];
+		std::vector<RdrVertexInputElement> inputLayoutElements;
+		std::vector<RdrResourceFormat> rtvFormats;
+		RdrBlendMode eBlendMode;
+		RdrRasterState rasterState;
+		RdrDepthStencilState depthStencilState;
+	};
+
+	// Parses a recorded description and finds the shaders it refers to.
+	// Fails if the description is malformed or any of its shaders no longer exist.
+	bool parseDesc(const std::string& desc, ParsedDesc& rOutParsed)
+	{
+		DescReader reader(desc);
+
+		for (uint i = 0; i < kNumDescShaders; ++i)
+		{
+			rOutParsed.apShaders[i] = nullptr;
+			if (!reader.ReadValue<uint8>())
+				continue;
+
+			const char* filename = reader.ReadString();
+			uint numDefines = reader.ReadValue<uint8>();
+			if (numDefines >= kMaxDefines)
+				return false;
+
+			// Pixel shaders keep pointers to their defines, so they need to live as long as the shader system.
+			const char* aDefines[kMaxDefines];
+			for (uint d = 0; d < numDefines; ++d)
+			{
+				aDefines[d] = CachedString(reader.ReadString()).getString();
+			}
+
+			if (!reader.IsValid())
+				return false;
+
+			rOutParsed.apShaders[i] = s_cache.backend.findShader(kDescShaderStages[i], filename, aDefines, numDefines);
+			if (!rOutParsed.apShaders[i])
+				return false;
+		}
+
+		rOutParsed.inputLayoutElements.resize(reader.ReadValue<uint8>());
+		reader.ReadBytes(rOutParsed.inputLayoutElements.data(), (uint)(rOutParsed.inputLayoutElements.size() * sizeof(RdrVertexInputElement)));
+
+		rOutParsed.rtvFormats.resize(reader.ReadValue<uint8>());
+		for (RdrResourceFormat& rFormat : rOutParsed.rtvFormats)
+		{
+			rFormat = (RdrResourceFormat)reader.ReadValue<uint8>();
+		}
+
+		rOutParsed.eBlendMode = (RdrBlendMode)reader.ReadValue<uint8>();
+
+		rOutParsed.rasterState.bEnableMSAA = reader.ReadValue<uint8>();
+		rOutParsed.rasterState.bEnableScissor = reader.ReadValue<uint8>();
+		rOutParsed.rasterState.bWireframe = reader.ReadValue<uint8>();
+		rOutParsed.rasterState.bUseSlopeScaledDepthBias = reader.ReadValue<uint8>();
+		rOutParsed.rasterState.bDoubleSided = reader.ReadValue<uint8>();
+		reader.ReadValue<uint8>(); // Sample count.  The current MSAA level is used instead.
+
+		rOutParsed.depthStencilState.bTestDepth = !!reader.ReadValue<uint8>();
+		rOutParsed.depthStencilState.bWriteDepth = !!reader.ReadValue<uint8>();
+		rOutParsed.depthStencilState.eDepthFunc = (RdrComparisonFunc)reader.ReadValue<uint8>();
+
+		return reader.IsValid() && reader.IsAtEnd()
+			&& (uint)rOutParsed.eBlendMode < (uint)RdrBlendMode::kCount
+			&& (uint)rOutParsed.depthStencilState.eDepthFunc < (uint)RdrComparisonFunc::Count;
+	}
+
+	RdrPipelineState* acquirePipelineState(
+		const RdrShader* apShaders[kNumDescShaders],
+		const RdrVertexInputElement* pInputLayoutElements, uint nNumInputElements,
+		const RdrResourceFormat* pRtvFormats, uint nNumRtvFormats,
+		const RdrBlendMode eBlendMode,
+		const RdrRasterState& rasterState,
+		const RdrDepthStencilState& depthStencilState,
+		bool bPrewarm)
+	{
+		std::string desc = buildDesc(apShaders, pInputLayoutElements, nNumInputElements, pRtvFormats, nNumRtvFormats,
+			eBlendMode, rasterState, depthStencilState);
+
+		AutoScopedLock lock(s_cache.mutex);
+
+		PipelineStateMap::iterator iter = s_cache.pipelineStates.find(desc);
+		if (iter != s_cache.pipelineStates.end())
+		{
+			if (!bPrewarm)
+			{
+				++iter->second.refCount;
+				++s_cache.numHits;
+			}
+			return iter->second.pPipelineState;
+		}
+
+		CacheEntry entry;
+		entry.pPipelineState = s_cache.backend.createGraphicsPipelineState(
+			apShaders[0], apShaders[1], apShaders[2], apShaders[3],
+			pInputLayoutElements, nNumInputElements,
+			pRtvFormats, nNumRtvFormats,
+			eBlendMode,
+			rasterState,
+			depthStencilState);
+
+		// Prewarmed states are referenced by the cache itself so they stay around until something uses them.
+		entry.refCount = 1;
+
+		if (bPrewarm)
+		{
+			++s_cache.numPrewarmed;
+		}
+		else
+		{
+			++s_cache.numMisses;
+		}
+
+		s_cache.recordedDescs.insert(desc);
+		iter = s_cache.pipelineStates.insert(std::make_pair(std::move(desc), entry)).first;
+		s_cache.pipelineStateDescs.insert(std::make_pair(entry.pPipelineState, &iter->first));
+
+		return entry.pPipelineState;
+	}
+
+	std::string getRecordFilename()
+	{
+		if (s_cache.backend.recordFilename)
+			return s_cache.backend.recordFilename;
+
+		char filename[MAX_PATH];
+		sprintf_s(filename, "%s/%s", Paths::GetBinDataDir(), kRecordFilename);
+		return filename;
+	}
+
+	bool loadRecord(const std::string& filename, std::vector<std::string>& rOutDescs)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		RecordHeader header;
+		file.read((char*)&header, sizeof(header));
+		if (!file.good() || header.magic != kRecordMagic || header.version != kRecordVersion)
+			return false;
+
+		rOutDescs.reserve(header.numStates);
+		for (uint i = 0; i < header.numStates; ++i)
+		{
+			uint descSize = 0;
+			file.read((char*)&descSize, sizeof(descSize));
+			if (!file.good() || descSize > 4096)
+				return false;
+
+			std::string desc(descSize, 0);
+			file.read(&desc[0], descSize);
+			if (!file.good())
+				return false;
+
+			rOutDescs.push_back(std::move(desc));
+		}
+
+		return true;
+	}
+}
+
+void RdrPipelineStateCache::SetBackend(const Backend& backend)
+{
+	AutoScopedLock lock(s_cache.mutex);
+	s_cache.backend = backend;
+}
+
+void RdrPipelineStateCache::Init()
+{
+	if (!g_userConfig.prewarmPipelineStates)
+		return;
+
+	std::string filename = getRecordFilename();
+	std::vector<std::string> descs;
+	if (!loadRecord(filename, descs) && !descs.empty())
+	{
+		Warning("Pipeline state record %s is corrupt.  Prewarming the states read before the error.", filename.c_str());
+	}
+
+	ParsedDesc parsed;
+	for (const std::string& desc : descs)
+	{
+		if (!parseDesc(desc, parsed))
+		{
+			++s_cache.numFailedPrewarms;
+			continue;
+		}
+
+		acquirePipelineState(parsed.apShaders,
+			parsed.inputLayoutElements.data(), (uint)parsed.inputLayoutElements.size(),
+			parsed.rtvFormats.data(), (uint)parsed.rtvFormats.size(),
+			parsed.eBlendMode,
+			parsed.rasterState,
+			parsed.depthStencilState,
+			true);
+	}
+}
+
+void RdrPipelineStateCache::Save()
+{
+	AutoScopedLock lock(s_cache.mutex);
+
+	std::string filename = getRecordFilename();
+	Paths::CreateDirectoryTreeForFile(filename);
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+
+	RecordHeader header;
+	header.magic = kRecordMagic;
+	header.version = kRecordVersion;
+	header.numStates = (uint)s_cache.recordedDescs.size();
+	file.write((const char*)&header, sizeof(header));
+
+	for (const std::string& desc : s_cache.recordedDescs)
+	{
+		uint descSize = (uint)desc.size();
+		file.write((const char*)&descSize, sizeof(descSize));
+		file.write(desc.data(), descSize);
+	}
+
+	if (!file.good())
+	{
+		Warning("Failed to write pipeline state record %s", filename.c_str());
+	}
+}
+
+void RdrPipelineStateCache::Shutdown()
+{
+	AutoScopedLock lock(s_cache.mutex);
+
+	for (auto& rEntry : s_cache.pipelineStates)
+	{
+		s_cache.backend.releasePipelineState(rEntry.second.pPipelineState);
+	}
+
+	s_cache.pipelineStates.clear();
+	s_cache.pipelineStateDescs.clear();
+	s_cache.recordedDescs.clear();
+	s_cache.numHits = 0;
+	s_cache.numMisses = 0;
+	s_cache.numPrewarmed = 0;
+	s_cache.numFailedPrewarms = 0;
+}
+
+RdrPipelineState* RdrPipelineStateCache::GetGraphicsPipelineState(
+	const RdrShader* pVertexShader, const RdrShader* pPixelShader,
+	const RdrShader* pHullShader, const RdrShader* pDomainShader,
+	const RdrVertexInputElement* pInputLayoutElements, uint nNumInputElements,
+	const RdrResourceFormat* pRtvFormats, uint nNumRtvFormats,
+	const RdrBlendMode eBlendMode,
+	const RdrRasterState& rasterState,
+	const RdrDepthStencilState& depthStencilState)
+{
+	const RdrShader* apShaders[kNumDescShaders] = { pVertexShader, pPixelShader, pHullShader, pDomainShader };
+	return acquirePipelineState(apShaders,
+		pInputLayoutElements, nNumInputElements,
+		pRtvFormats, nNumRtvFormats,
+		eBlendMode,
+		rasterState,
+		depthStencilState,
+		false);
+}
+
+void RdrPipelineStateCache::ReleasePipelineState(RdrPipelineState* pPipelineState)
+{
+	AutoScopedLock lock(s_cache.mutex);
+
+	auto descIter = s_cache.pipelineStateDescs.find(pPipelineState);
+	if (descIter == s_cache.pipelineStateDescs.end())
+	{
+		s_cache.backend.releasePipelineState(pPipelineState);
+		return;
+	}
+
+	PipelineStateMap::iterator iter = s_cache.pipelineStates.find(*descIter->second);
+	Assert(iter != s_cache.pipelineStates.end() && iter->second.refCount > 0);
+	if (--iter->second.refCount == 0)
+	{
+		s_cache.pipelineStateDescs.erase(descIter);
+		s_cache.pipelineStates.erase(iter);
+		s_cache.backend.releasePipelineState(pPipelineState);
+	}
+}
+
+RdrPipelineStateCache::Stats RdrPipelineStateCache::GetStats()
+{
+	AutoScopedLock lock(s_cache.mutex);
+
+	Stats stats;
+	stats.hits = s_cache.numHits;
+	stats.misses = s_cache.numMisses;
+	stats.prewarmed = s_cache.numPrewarmed;
+	stats.failedPrewarms = s_cache.numFailedPrewarms;
+	stats.liveStates = (uint)s_cache.pipelineStates.size();
+	return stats;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "RdrDeviceTypes.h"
+
+struct RdrShader;
+enum class RdrShaderStage;
+
+// Global cache of graphics pipeline states.
+// States are keyed by a 64-bit hash of their full description (shader files and defines, input layout, render target
+// formats, blend, raster, and depth state) so identical states requested by different materials share one pipeline
+// object.  Every state requested during a run is recorded and written to disk on shutdown, and the next run creates
+// those states during startup so new materials don't hitch the first time they're drawn.
+namespace RdrPipelineStateCache
+{
+	struct Stats
+	{
+		uint hits;
+		uint misses;
+		uint prewarmed;			// States created from the previous run's record.
+		uint failedPrewarms;	// Recorded states that couldn't be parsed or whose shaders no longer exist.
+		uint liveStates;
+	};
+
+	// Device and shader system calls made by the cache.  The defaults use RdrPipelineState and RdrShaderSystem.
+	struct Backend
+	{
+		RdrPipelineState* (*createGraphicsPipelineState)(
+			const RdrShader* pVertexShader, const RdrShader* pPixelShader,
+			const RdrShader* pHullShader, const RdrShader* pDomainShader,
+			const RdrVertexInputElement* pInputLayoutElements, uint nNumInputElements,
+			const RdrResourceFormat* pRtvFormats, uint nNumRtvFormats,
+			const RdrBlendMode eBlendMode,
+			const RdrRasterState& rasterState,
+			const RdrDepthStencilState& depthStencilState);
+		void (*releasePipelineState)(RdrPipelineState* pPipelineState);
+		const RdrShader* (*findShader)(RdrShaderStage eStage, const char* filename, const char** aDefines, uint numDefines);
+
+		// Where the record is loaded from and saved to.  Null uses the bin data directory.
+		const char* recordFilename;
+	};
+
+	// Replaces the backend so the cache can be tested without a device.  Must be called before Init().
+	void SetBackend(const Backend& backend);
+
+	// Loads the record from the previous run and creates its states.  Must be called after the shader system is initialized.
+	void Init();
+
+	// Writes every state requested this run to disk.
+	void Save();
+
+	// Releases every state held by the cache and clears the record and stats.
+	// Only safe once nothing references the cached states anymore.
+	void Shutdown();
+
+	// Returns a shared pipeline state matching the description, creating it if it doesn't exist yet.
+	// Each call adds a reference that must be released with ReleasePipelineState().
+	RdrPipelineState* GetGraphicsPipelineState(
+		const RdrShader* pVertexShader, const RdrShader* pPixelShader,
+		const RdrShader* pHullShader, const RdrShader* pDomainShader,
+		const RdrVertexInputElement* pInputLayoutElements, uint nNumInputElements,
+		const RdrResourceFormat* pRtvFormats, uint nNumRtvFormats,
+		const RdrBlendMode eBlendMode,
+		const RdrRasterState& rasterState,
+		const RdrDepthStencilState& depthStencilState);
+
+	// Drops a reference, destroying the pipeline state once nothing uses it.
+	// States that weren't created by the cache are released immediately.
+	void ReleasePipelineState(RdrPipelineState* pPipelineState);
+
+	Stats GetStats();
+}
@@ -2,6 +2,7 @@
 #include "RdrPostProcess.h"
 #include "RdrContext.h"
 #include "RdrDrawState.h"
+#include "RdrPipelineStateCache.h"
 #include "RdrFrameMem.h"
 #include "Renderer.h"
 #include "RdrShaderConstants.h"
@@ -19,68 +20,41 @@ namespace
 		return color.x * kLumScalar.x + color.y * kLumScalar.y + color.z * kLumScalar.z;
 	}
 
-	inline int getDbgReadIndex(int dbgFrame)
+	void dbgLuminanceReadbackComplete(const void* pData, uint dataSize, void* pUserData)
 	{
-		// Find which debug resource to read from this frame.  We have to wait 2 frames to avoid stalls on readbacks
-		int dbgReadIdx = (dbgFrame - 2);
-		if (dbgReadIdx < 0)
-		{
-			dbgReadIdx = 3 + dbgReadIdx;
-		}
-		return dbgReadIdx;
+		RdrPostProcessDbgData* pOutData = (RdrPostProcessDbgData*)pUserData;
+
+		const uint pixelByteSize = 8;
+		char dataBuffer[32];
+		void* pAlignedData = dataBuffer;
+		size_t space = sizeof(dataBuffer);
+		std::align(16, pixelByteSize, pAlignedData, space);
+		memcpy(pAlignedData, pData, pixelByteSize);
+
+		pOutData->lumColor = Maths::convertHalfToSinglePrecision4((float16*)pAlignedData);
+		pOutData->lumAtCursor = calcLuminance(pOutData->lumColor);
 	}
 
-	void dbgLuminanceInput(const InputManager& rInputManager, RdrContext* pRdrContext, const RdrResource* pColorBuffer, RdrResource& rLumCopyRes, RdrResource& rLumReadRes, RdrPostProcessDbgData& rOutData)
+	void dbgLuminanceInput(const InputManager& rInputManager, RdrResourceHandle hColorBuffer, RdrPostProcessDbgData& rOutData)
 	{
 		int mx, my;
 		rInputManager.GetMousePos(mx, my);
 
-		RdrBox srcRect(max(mx,0), max(my,0), 0, 1, 1, 1);
-		if (!rLumCopyRes.IsValid())
-		{
-			RdrTextureInfo info = {};
-			info.width = 1;
-			info.height = 1;
-			info.format = pColorBuffer->GetTextureInfo().format;
-			info.depth = 1;
-			info.mipLevels = 1;
-			info.sampleCount = 1;
-			rLumCopyRes.CreateTexture(*pRdrContext, info, RdrResourceAccessFlags::CpuRO_GpuRW, CREATE_NULL_BACKPOINTER);
-		}
-		pColorBuffer->CopyResourceRegion(*pRdrContext, srcRect, rLumCopyRes, IVec3::kZero);
-
-		if (rLumReadRes.IsValid())
-		{
-			const uint pixelByteSize = 8;
-			char dataBuffer[32];
-			void* pAlignedData = dataBuffer;
-			size_t space;
-			std::align(16, pixelByteSize, pAlignedData, space);
+		g_pRenderer->IssueTextureReadbackRequest(hColorBuffer, IVec3(max(mx, 0), max(my, 0), 0), dbgLuminanceReadbackComplete, &rOutData);
+	}
 
-			uint size = rdrGetTexturePitch(1, pColorBuffer->GetTextureInfo().format);
-			rLumReadRes.ReadResource(*pRdrContext, pAlignedData, pixelByteSize);
+	void dbgTonemapReadbackComplete(const void* pData, uint dataSize, void* pUserData)
+	{
+		RdrPostProcessDbgData* pOutData = (RdrPostProcessDbgData*)pUserData;
 
-			rOutData.lumColor = Maths::convertHalfToSinglePrecision4((float16*)pAlignedData);
-			rOutData.lumAtCursor = calcLuminance(rOutData.lumColor);
-		}
+		const ToneMapOutputParams* pTonemap = (const ToneMapOutputParams*)pData;
+		pOutData->linearExposure = pTonemap->linearExposure;
+		pOutData->adaptedLum = pTonemap->adaptedLum;
 	}
 
-	void dbgTonemapOutput(RdrContext* pRdrContext, const RdrResource* pTonemapOutputBuffer, RdrResource& rTonemapCopyRes, RdrResource& rTonemapReadRes, RdrPostProcessDbgData& rOutData)
+	void dbgTonemapOutput(RdrResourceHandle hTonemapOutputBuffer, RdrPostProcessDbgData& rOutData)
 	{
-		RdrBox srcRect(0, 0, 0, sizeof(ToneMapOutputParams), 1, 1);
-		if (!rTonemapCopyRes.IsValid())
-		{
-			rTonemapCopyRes.CreateStructuredBuffer(*pRdrContext, 1, srcRect.width, RdrResourceAccessFlags::CpuRO_GpuRW, CREATE_NULL_BACKPOINTER);
-		}
-		pTonemapOutputBuffer->CopyResourceRegion(*pRdrContext, srcRect, rTonemapCopyRes, IVec3::kZero);
-
-		if (rTonemapReadRes.IsValid())
-		{
-			ToneMapOutputParams tonemap;
-			rTonemapReadRes.ReadResource(*pRdrContext, &tonemap, sizeof(tonemap));
-			rOutData.linearExposure = tonemap.linearExposure;
-			rOutData.adaptedLum = tonemap.adaptedLum;
-		}
+		g_pRenderer->IssueStructuredBufferReadbackRequest(hTonemapOutputBuffer, 0, sizeof(ToneMapOutputParams), dbgTonemapReadbackComplete, &rOutData);
 	}
 
 	void setupFullscreenDrawState(RdrContext* pRdrContext, RdrDrawState* pDrawState)
@@ -107,7 +81,7 @@ namespace
 		rasterState.bUseSlopeScaledDepthBias = false;
 		rasterState.bEnableScissor = false;
 
-		return RdrPipelineState::CreateGraphicsPipelineState(
+		return RdrPipelineStateCache::GetGraphicsPipelineState(
 			pVertexShader, pPixelShader,
 			nullptr, nullptr,
 			nullptr, 0,
@@ -272,12 +246,9 @@ void RdrPostProcess::DoPostProcessing(RdrContext* pRdrContext, RdrDrawState* pDr
 		DoSsao(pRdrContext, pDrawState, rBuffers, rEffects, rGlobalConstants);
 	}
 
-	m_dbgFrame = (m_dbgFrame + 1) % 3;
-
 	if (m_debugger.IsActive() && m_pInputManager)
 	{
-		int dbgReadIdx = getDbgReadIndex(m_dbgFrame);
-		dbgLuminanceInput(*m_pInputManager, pRdrContext, pColorBuffer, m_lumDebugRes[m_dbgFrame], m_lumDebugRes[dbgReadIdx], m_debugData);
+		dbgLuminanceInput(*m_pInputManager, rBuffers.colorBuffer.hTexture, m_debugData);
 	}
 
 	//////////////////////////////////////////////////////////////////////////
@@ -366,8 +337,7 @@ void RdrPostProcess::DoLuminanceMeasurement(RdrContext* pRdrContext, RdrDrawStat
 
 	if (m_debugger.IsActive())
 	{
-		int dbgReadIdx = getDbgReadIndex(m_dbgFrame);
-		dbgTonemapOutput(pRdrContext, pTonemapOutput, m_tonemapDebugRes[m_dbgFrame], m_tonemapDebugRes[dbgReadIdx], m_debugData);
+		dbgTonemapOutput(m_hToneMapOutputConstants, m_debugData);
 	}
 
 	pRdrContext->EndEvent();
@@ -81,9 +81,6 @@ private:
 	const RdrPipelineState* m_copyPipelineState;
 	PostProcessDebugger m_debugger;
 	RdrPostProcessDbgData m_debugData;
-	RdrResource m_lumDebugRes[3];
-	RdrResource m_tonemapDebugRes[3];
-	int m_dbgFrame;
 	bool m_useHistogramToneMap;
 };
 
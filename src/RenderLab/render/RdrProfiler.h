@@ -51,6 +51,13 @@ enum class RdrProfileCounter
 	CsSampler,
 	CsUnorderedAccess,
 
+	// Shader resource descriptor heap.  Snapshots of the heap state rather than per-frame counts.
+	SrvDescriptorsLive,
+	SrvDescriptorsFree,
+	SrvDescriptorsFragmented,
+	SrvDescriptorsPeak,
+	SrvDescriptorAllocFailures,
+
 	Count
 };
 
@@ -79,6 +86,7 @@ public:
 
 	void IncrementCounter(RdrProfileCounter eCounter);
 	void AddCounter(RdrProfileCounter eCounter, int val);
+	void SetCounter(RdrProfileCounter eCounter, uint val);
 
 	float GetSectionTimeMS(RdrProfileSection eSection) const;
 	uint GetCounter(RdrProfileCounter eCounter) const;
@@ -119,6 +127,11 @@ inline void RdrGpuProfiler::AddCounter(RdrProfileCounter eCounter, int val)
 	m_counters[(int)eCounter] += val;
 }
 
+inline void RdrGpuProfiler::SetCounter(RdrProfileCounter eCounter, uint val)
+{
+	m_counters[(int)eCounter] = val;
+}
+
 struct CpuTimingIdComparator {
 	bool operator()(const uint64 lhs, const uint64 rhs) const 
 	{
@@ -0,0 +1,111 @@
+#include "Precompiled.h"
+#include "RdrReadbackPool.h"
+
+RdrReadbackPool::RdrReadbackPool()
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+uint RdrReadbackPool::CalcBucketSize(uint size)
+{
+	uint bucketSize = kMinBucketSize;
+	while (bucketSize < size)
+	{
+		bucketSize <<= 1;
+	}
+	return bucketSize;
+}
+
+uint RdrReadbackPool::Acquire(uint size, uint64 completedFrame)
+{
+	BucketMap::iterator iter = m_idleBuffers.find(CalcBucketSize(size));
+	if (iter == m_idleBuffers.end())
+		return kInvalidBuffer;
+
+	// Buffers are released in frame order, so the first one the GPU isn't done with ends the search.
+	std::vector<uint>& rIdle = iter->second;
+	if (rIdle.empty() || m_buffers[rIdle.front()].lastUsedFrame > completedFrame)
+		return kInvalidBuffer;
+
+	uint buffer = rIdle.front();
+	rIdle.erase(rIdle.begin());
+
+	m_buffers[buffer].bInUse = true;
+	++m_stats.buffersInUse;
+	++m_stats.reuses;
+	return buffer;
+}
+
+uint RdrReadbackPool::AddBuffer(uint size, uint resourceId)
+{
+	Buffer newBuffer;
+	newBuffer.resourceId = resourceId;
+	newBuffer.size = CalcBucketSize(size);
+	newBuffer.lastUsedFrame = 0;
+	newBuffer.bInUse = true;
+
+	uint buffer;
+	if (!m_freeSlots.empty())
+	{
+		buffer = m_freeSlots.back();
+		m_freeSlots.pop_back();
+		m_buffers[buffer] = newBuffer;
+	}
+	else
+	{
+		buffer = (uint)m_buffers.size();
+		m_buffers.push_back(newBuffer);
+	}
+
+	++m_stats.numBuffers;
+	++m_stats.buffersInUse;
+	++m_stats.creates;
+	m_stats.bytesAllocated += newBuffer.size;
+	return buffer;
+}
+
+void RdrReadbackPool::Release(uint buffer, uint64 lastUsedFrame)
+{
+	Buffer& rBuffer = m_buffers[buffer];
+	Assert(rBuffer.bInUse);
+
+	rBuffer.bInUse = false;
+	rBuffer.lastUsedFrame = lastUsedFrame;
+	--m_stats.buffersInUse;
+
+	// Keep the idle list in frame order.  Cancelled requests can release out of order, so insert from the back.
+	std::vector<uint>& rIdle = m_idleBuffers[rBuffer.size];
+	std::vector<uint>::iterator iter = rIdle.end();
+	while (iter != rIdle.begin() && m_buffers[*(iter - 1)].lastUsedFrame > lastUsedFrame)
+	{
+		--iter;
+	}
+	rIdle.insert(iter, buffer);
+}
+
+uint RdrReadbackPool::GetResourceId(uint buffer) const
+{
+	return m_buffers[buffer].resourceId;
+}
+
+void RdrReadbackPool::Trim(uint64 oldestFrameToKeep, std::vector<uint>& rOutResourceIds)
+{
+	for (BucketMap::value_type& rBucket : m_idleBuffers)
+	{
+		std::vector<uint>& rIdle = rBucket.second;
+		uint numEvicted = 0;
+		while (numEvicted < rIdle.size() && m_buffers[rIdle[numEvicted]].lastUsedFrame < oldestFrameToKeep)
+		{
+			uint buffer = rIdle[numEvicted];
+			rOutResourceIds.push_back(m_buffers[buffer].resourceId);
+			m_freeSlots.push_back(buffer);
+
+			--m_stats.numBuffers;
+			++m_stats.evictions;
+			m_stats.bytesAllocated -= m_buffers[buffer].size;
+			++numEvicted;
+		}
+
+		rIdle.erase(rIdle.begin(), rIdle.begin() + numEvicted);
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+// Pool of CPU readable buffers that GPU data is copied into for readback.
+// Buffers are bucketed by power-of-two size class and reused once the GPU has finished the last frame that used them.
+// Resources are identified by opaque ids so the pool has no graphics API dependencies; the caller creates and destroys them.
+class RdrReadbackPool
+{
+public:
+	static const uint kInvalidBuffer = ~0u;
+	static const uint kMinBucketSize = 256;
+
+	struct Stats
+	{
+		uint numBuffers;
+		uint buffersInUse;
+		uint64 bytesAllocated;
+		uint reuses;
+		uint creates;
+		uint evictions;
+	};
+
+	RdrReadbackPool();
+
+	static uint CalcBucketSize(uint size);
+
+	// Takes an idle buffer that can hold size bytes and that the GPU has finished with.
+	// Returns kInvalidBuffer if there isn't one, in which case the caller should create a resource of
+	// CalcBucketSize(size) bytes and register it with AddBuffer().
+	uint Acquire(uint size, uint64 completedFrame);
+
+	// Registers a new resource.  The returned buffer is in use.
+	uint AddBuffer(uint size, uint resourceId);
+
+	// Returns a buffer to the pool.  It won't be handed out again until the GPU has finished lastUsedFrame.
+	void Release(uint buffer, uint64 lastUsedFrame);
+
+	uint GetResourceId(uint buffer) const;
+
+	// Drops idle buffers that haven't been used since before oldestFrameToKeep.
+	// Their resource ids are appended to rOutResourceIds for the caller to destroy.
+	void Trim(uint64 oldestFrameToKeep, std::vector<uint>& rOutResourceIds);
+
+	const Stats& GetStats() const { return m_stats; }
+
+private:
+	struct Buffer
+	{
+		uint resourceId;
+		uint size;
+		uint64 lastUsedFrame;
+		bool bInUse;
+	};
+
+	typedef std::map<uint, std::vector<uint>> BucketMap;
+
+	std::vector<Buffer> m_buffers;
+	std::vector<uint> m_freeSlots;	// Entries in m_buffers that don't hold a resource.
+	BucketMap m_idleBuffers;		// Bucket size to idle buffers, in the order they were released.
+	Stats m_stats;
+};
@@ -2,14 +2,19 @@
 
 #include "RdrResource.h"
 
+// Called on the render thread once a readback's data is available.  The request is released after the callback returns.
+typedef void (*RdrReadbackCallback)(const void* pData, uint dataSize, void* pUserData);
+
 struct RdrResourceReadbackRequest
 {
 	RdrResourceHandle hSrcResource;
-	RdrResourceHandle hDstResource;
 	RdrBox srcRegion;
 	char* pData;
 	uint dataSize;
-	uint frameCount;
+	uint readbackBuffer; // Pooled buffer the data was copied into.  RdrReadbackPool::kInvalidBuffer until the copy is recorded.
+	uint64 copyFrame;    // Frame the copy was recorded in.  The data can be read once the GPU has finished it.
+	RdrReadbackCallback callback;
+	void* pUserData;
 	bool bComplete;
 };
 typedef FreeList<RdrResourceReadbackRequest, 32 * 3> RdrResourceReadbackRequestList;
@@ -117,24 +117,6 @@ namespace
 		return true;
 	}
 
-
-	ID3D12Resource* createUploadResource(ID3D12Device* pDevice, uint nByteSize)
-	{
-		ID3D12Resource* pUploadResource;
-
-		CD3DX12_HEAP_PROPERTIES heapProperties = selectHeapProperties(RdrResourceAccessFlags::CpuRW_GpuRO);
-		HRESULT hr = pDevice->CreateCommittedResource(
-			&heapProperties,
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(nByteSize),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&pUploadResource));
-
-		ValidateHResult(hr, __FUNCTION__, "Failed to create upload buffer!");
-
-		return pUploadResource;
-	}
 }
 
 void RdrResource::MarkUsedThisFrame() const
@@ -278,11 +260,6 @@ void RdrResource::ReleaseResource(RdrContext& context)
 		m_pResource->Release();
 		m_pResource = nullptr;
 	}
-	if (m_pUploadResource)
-	{
-		m_pUploadResource->Release();
-		m_pUploadResource = nullptr;
-	}
 
 	if (m_srv.pDesc) 
 		m_srv.pDesc->Release();
@@ -433,7 +410,35 @@ bool RdrResource::CreateConstantBuffer(RdrContext& context, uint size, RdrResour
 	return true;
 }
 
-void RdrResource::UpdateResource(RdrContext& context, const void* pSrcData, uint dataSize)
+RdrConstantBufferView RdrResource::CreateConstantBufferView(RdrContext& context, uint byteOffset, uint size, const RdrDebugBackpointer& debug)
+{
+	Assert((byteOffset & 255) == 0 && (size & 255) == 0);
+	Assert(byteOffset + size <= m_size);
+
+	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+	cbvDesc.BufferLocation = m_pResource->GetGPUVirtualAddress() + byteOffset;
+	cbvDesc.SizeInBytes = size;
+
+	RdrConstantBufferView view;
+	view.pResource = this;
+	view.pDesc = context.GetSrvHeap().CreateConstantBufferView(&cbvDesc, debug);
+	return view;
+}
+
+void* RdrResource::MapPersistent(RdrContext& context)
+{
+	Assert(IsFlagSet(m_accessFlags, RdrResourceAccessFlags::CpuWrite));
+
+	void* pData = nullptr;
+	CD3DX12_RANGE readRange(0, 0);
+	HRESULT hr = m_pResource->Map(0, &readRange, &pData);
+	if (!ValidateHResult(hr, __FUNCTION__, "Failed to map resource!"))
+		return nullptr;
+
+	return pData;
+}
+
+void RdrResource::UpdateResource(RdrContext& context, const void* pSrcData, uint dataSize, uint dstOffset)
 {
 	Assert(Renderer::IsRenderThread());
 
@@ -450,13 +455,15 @@ void RdrResource::UpdateResource(RdrContext& context, const void* pSrcData, uint
 		if (!ValidateHResult(hr, __FUNCTION__, "Failed to map resource!"))
 			return;
 
-		memcpy(pDstData, pSrcData, dataSize);
+		memcpy((char*)pDstData + dstOffset, pSrcData, dataSize);
 
-		CD3DX12_RANGE writeRange(0, dataSize);
+		CD3DX12_RANGE writeRange(dstOffset, dstOffset + dataSize);
 		m_pResource->Unmap(0, &writeRange);
 	}
 	else
 	{
+		Assert(dstOffset == 0);
+
 		static constexpr uint kMaxSubresources = 16;
 		D3D12_SUBRESOURCE_DATA subresourceData[kMaxSubresources];
 		uint numSubresources = 0;
@@ -499,21 +506,67 @@ void RdrResource::UpdateResource(RdrContext& context, const void* pSrcData, uint
 			subresourceData[0].SlicePitch = subresourceData[0].RowPitch;
 		}
 
-		if (!m_pUploadResource)
-		{
-			uint uploadBufferSize = (uint)GetRequiredIntermediateSize(m_pResource, 0, numSubresources);
-			m_pUploadResource = createUploadResource(context.GetDevice(), uploadBufferSize);
-		}
-
 		Assert(numSubresources < kMaxSubresources);
 
+		uint64 uploadSize = GetRequiredIntermediateSize(m_pResource, 0, numSubresources);
+		uint64 uploadAlignment = m_bIsTexture ? D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT : D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+		RdrUploadAllocation upload = context.GetUploadHeap().Allocate(uploadSize, uploadAlignment);
+		if (!upload.pResource)
+			return;
+
 		D3D12_RESOURCE_STATES eInitialState = m_eResourceState;
 		TransitionState(context, D3D12_RESOURCE_STATE_COPY_DEST);
-		UpdateSubresources<kMaxSubresources>(context.GetCommandList(), m_pResource, m_pUploadResource, 0, 0, numSubresources, subresourceData);
+		UpdateSubresources<kMaxSubresources>(context.GetCommandList(), m_pResource, upload.pResource, upload.offset, 0, numSubresources, subresourceData);
 		TransitionState(context, eInitialState);
 	}
 }
 
+void RdrResource::UpdateTextureRegion(RdrContext& context, uint arraySlice, const RdrBox& region, const void* pData)
+{
+	Assert(Renderer::IsRenderThread());
+	Assert(m_bIsTexture && region.depth == 1);
+	Assert(region.left + region.width <= m_textureInfo.width && region.top + region.height <= m_textureInfo.height);
+
+	// Rows in the upload buffer have to be padded out to the copy pitch alignment.
+	uint srcPitch = rdrGetTexturePitch(region.width, m_textureInfo.format);
+	uint numRows = rdrGetTextureRows(region.height, m_textureInfo.format);
+	uint uploadPitch = (srcPitch + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1);
+
+	RdrUploadAllocation upload = context.GetUploadHeap().Allocate(uploadPitch * numRows, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+	if (!upload.pResource)
+		return;
+
+	char* pUploadData;
+	CD3DX12_RANGE readRange(0, 0);
+	HRESULT hr = upload.pResource->Map(0, &readRange, (void**)&pUploadData);
+	if (!ValidateHResult(hr, __FUNCTION__, "Failed to map upload buffer!"))
+		return;
+
+	for (uint row = 0; row < numRows; ++row)
+	{
+		memcpy(pUploadData + upload.offset + row * uploadPitch, (const char*)pData + row * srcPitch, srcPitch);
+	}
+
+	CD3DX12_RANGE writeRange(upload.offset, upload.offset + uploadPitch * numRows);
+	upload.pResource->Unmap(0, &writeRange);
+
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
+	footprint.Offset = upload.offset;
+	footprint.Footprint.Format = getD3DFormat(m_textureInfo.format);
+	footprint.Footprint.Width = region.width;
+	footprint.Footprint.Height = region.height;
+	footprint.Footprint.Depth = 1;
+	footprint.Footprint.RowPitch = uploadPitch;
+
+	CD3DX12_TEXTURE_COPY_LOCATION src(upload.pResource, footprint);
+	CD3DX12_TEXTURE_COPY_LOCATION dst(m_pResource, D3D12CalcSubresource(0, arraySlice, 0, m_textureInfo.mipLevels, m_textureInfo.depth));
+
+	D3D12_RESOURCE_STATES eInitialState = m_eResourceState;
+	TransitionState(context, D3D12_RESOURCE_STATE_COPY_DEST);
+	context.GetCommandList()->CopyTextureRegion(&dst, region.left, region.top, 0, &src, nullptr);
+	TransitionState(context, eInitialState);
+}
+
 void RdrResource::CopyResourceRegion(RdrContext& context, const RdrBox& srcRegion, const RdrResource& rDstResource, const IVec3& dstOffset) const
 {
 	Assert(Renderer::IsRenderThread());
@@ -529,9 +582,27 @@ void RdrResource::CopyResourceRegion(RdrContext& context, const RdrBox& srcRegio
 		box.back = srcRegion.front + srcRegion.depth;
 
 		CD3DX12_TEXTURE_COPY_LOCATION src(m_pResource, 0);
-		CD3DX12_TEXTURE_COPY_LOCATION dst(rDstResource.GetResource(), 0);
 
-		context.GetCommandList()->CopyTextureRegion(&dst, dstOffset.x, dstOffset.y, dstOffset.z, &src, &box);
+		if (rDstResource.IsBuffer())
+		{
+			// Copying into a buffer (e.g. for readback) requires describing the texture layout within it.
+			// dstOffset.x is the byte offset into the buffer and rows are tightly packed up to the required pitch alignment.
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
+			footprint.Offset = dstOffset.x;
+			footprint.Footprint.Format = getD3DFormat(m_textureInfo.format);
+			footprint.Footprint.Width = srcRegion.width;
+			footprint.Footprint.Height = srcRegion.height;
+			footprint.Footprint.Depth = srcRegion.depth;
+			footprint.Footprint.RowPitch = (rdrGetTexturePitch(srcRegion.width, m_textureInfo.format) + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1);
+
+			CD3DX12_TEXTURE_COPY_LOCATION dst(rDstResource.GetResource(), footprint);
+			context.GetCommandList()->CopyTextureRegion(&dst, 0, 0, 0, &src, &box);
+		}
+		else
+		{
+			CD3DX12_TEXTURE_COPY_LOCATION dst(rDstResource.GetResource(), 0);
+			context.GetCommandList()->CopyTextureRegion(&dst, dstOffset.x, dstOffset.y, dstOffset.z, &src, &box);
+		}
 	}
 	else
 	{
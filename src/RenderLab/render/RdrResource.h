@@ -93,7 +93,17 @@ public:
 	/////////////////////////////////////////////////////////////
 	// Constant Buffers
 	bool CreateConstantBuffer(RdrContext& context, uint size, RdrResourceAccessFlags accessFlags, const RdrDebugBackpointer& debug);
-	void UpdateResource(RdrContext& context, const void* pData, uint dataSize);
+	void UpdateResource(RdrContext& context, const void* pData, uint dataSize, uint dstOffset = 0);
+
+	// Copies tightly packed texels into a region of one array slice of a texture's top mip through the upload heap.
+	void UpdateTextureRegion(RdrContext& context, uint arraySlice, const RdrBox& region, const void* pData);
+
+	// Creates an additional view of part of a constant buffer.  The caller is responsible for releasing the descriptor.
+	RdrConstantBufferView CreateConstantBufferView(RdrContext& context, uint byteOffset, uint size, const RdrDebugBackpointer& debug);
+
+	// Maps a CPU writable buffer for the rest of its lifetime.  Writes are visible to the GPU without unmapping,
+	// so the caller must not overwrite anything the GPU may still be reading.
+	void* MapPersistent(RdrContext& context);
 
 	void TransitionState(RdrContext& context, D3D12_RESOURCE_STATES eState);
 
@@ -120,7 +130,6 @@ private:
 
 
 	ID3D12Resource* m_pResource;
-	ID3D12Resource* m_pUploadResource;
 
 	RdrShaderResourceView m_srv;
 	RdrUnorderedAccessView m_uav;
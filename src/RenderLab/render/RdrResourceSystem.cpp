@@ -3,6 +3,7 @@
 #include "RdrContext.h"
 #include "RdrFrameMem.h"
 #include "RdrAction.h"
+#include "RdrPipelineStateCache.h"
 #include "Renderer.h"
 #include "AssetLib/TextureAsset.h"
 #include "AssetLib/AssetLibrary.h"
@@ -242,6 +243,7 @@ void RdrResourceCommandList::UpdateResource(RdrResourceHandle hResource, const v
 	cmd.hResource = hResource;
 	cmd.pData = pData;
 	cmd.dataSize = dataSize;
+	cmd.dstOffset = 0;
 	cmd.pFileData = nullptr;
 }
 
@@ -252,6 +254,17 @@ void RdrResourceCommandList::UpdateResourceFromFile(RdrResourceHandle hResource,
 	cmd.dataSize = dataSize;
 	cmd.hResource = hResource;
 	cmd.pData = ((char*)cmd.pFileData) + nDataStartOffset;
+	cmd.dstOffset = 0;
+	cmd.debug = debug;
+}
+
+void RdrResourceCommandList::UpdateTextureRegion(RdrResourceHandle hResource, uint arraySlice, const RdrBox& region, const void* pData, const RdrDebugBackpointer& debug)
+{
+	CmdUpdateTextureRegion& cmd = m_textureRegionUpdates.pushSafe();
+	cmd.hResource = hResource;
+	cmd.arraySlice = arraySlice;
+	cmd.region = region;
+	cmd.pData = pData;
 	cmd.debug = debug;
 }
 
@@ -380,6 +393,25 @@ void RdrResourceCommandList::UpdateBuffer(const RdrResourceHandle hResource, con
 	cmd.dataSize = pResource->GetBufferInfo().elementSize
 		? (pResource->GetBufferInfo().elementSize * numElements)
 		: rdrGetTexturePitch(1, pResource->GetBufferInfo().eFormat) * numElements;
+	cmd.dstOffset = 0;
+}
+
+void RdrResourceCommandList::UpdateBufferRange(const RdrResourceHandle hResource, const void* pSrcData, uint firstElement, uint numElements, const RdrDebugBackpointer& debug)
+{
+	RdrResource* pResource = s_resourceSystem.resources.get(hResource);
+	Assert(IsFlagSet(pResource->GetAccessFlags(), RdrResourceAccessFlags::CpuWrite));
+	Assert(firstElement + numElements <= pResource->GetBufferInfo().numElements);
+
+	uint elementSize = pResource->GetBufferInfo().elementSize
+		? pResource->GetBufferInfo().elementSize
+		: rdrGetTexturePitch(1, pResource->GetBufferInfo().eFormat);
+
+	CmdUpdateResource& cmd = m_resourceUpdates.pushSafe();
+	cmd.hResource = hResource;
+	cmd.pData = pSrcData;
+	cmd.dataSize = elementSize * numElements;
+	cmd.dstOffset = elementSize * firstElement;
+	cmd.debug = debug;
 }
 
 RdrShaderResourceViewHandle RdrResourceSystem::CreateShaderResourceView(RdrResourceHandle hResource, uint firstElement, const RdrDebugBackpointer& debug)
@@ -1026,7 +1058,7 @@ void RdrResourceCommandList::ProcessCleanupCommands(RdrContext* pRdrContext)
 
 			if (cmd.pPipelineState->GetLastUsedFrame() <= nLastCompletedFrame)
 			{
-				cmd.pPipelineState->Release();
+				RdrPipelineStateCache::ReleasePipelineState(cmd.pPipelineState);
 				m_pipelineStateReleases.eraseFast(i);
 				--i;
 				--numCmds;
@@ -1044,11 +1076,20 @@ void RdrResourceCommandList::ProcessPreFrameCommands(RdrContext* pRdrContext)
 		CmdUpdateResource& cmd = m_resourceUpdates[i];
 		RdrResource* pResource = s_resourceSystem.resources.get(cmd.hResource);
 
-		pResource->UpdateResource(*pRdrContext, cmd.pData, cmd.dataSize);
+		pResource->UpdateResource(*pRdrContext, cmd.pData, cmd.dataSize, cmd.dstOffset);
 
 		SAFE_DELETE(cmd.pFileData);
 	}
 
+	// Update texture regions.  Whole resource updates are applied first so a region update can follow a full update.
+	numCmds = (uint)m_textureRegionUpdates.size();
+	for (uint i = 0; i < numCmds; ++i)
+	{
+		const CmdUpdateTextureRegion& cmd = m_textureRegionUpdates[i];
+		RdrResource* pResource = s_resourceSystem.resources.get(cmd.hResource);
+		pResource->UpdateTextureRegion(*pRdrContext, cmd.arraySlice, cmd.region, cmd.pData);
+	}
+
 	// Update constant buffers
 	numCmds = (uint)m_constantBufferUpdates.size();
 	for (uint i = 0; i < numCmds; ++i)
@@ -1059,5 +1100,6 @@ void RdrResourceCommandList::ProcessPreFrameCommands(RdrContext* pRdrContext)
 	}
 
 	m_resourceUpdates.clear();
+	m_textureRegionUpdates.clear();
 	m_constantBufferUpdates.clear();
 }
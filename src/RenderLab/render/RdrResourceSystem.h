@@ -121,6 +121,8 @@ public:
 	void ReleaseGeo(const RdrGeoHandle hGeo, const RdrDebugBackpointer& debug);
 
 	void UpdateBuffer(const RdrResourceHandle hResource, const void* pSrcData, int numElements, const RdrDebugBackpointer& debug);
+	// Only supported for CPU writable buffers.  pSrcData points at the first updated element.
+	void UpdateBufferRange(const RdrResourceHandle hResource, const void* pSrcData, uint firstElement, uint numElements, const RdrDebugBackpointer& debug);
 
 	void ReleasePipelineState(RdrPipelineState* pPipelineState, const RdrDebugBackpointer& debug);
 
@@ -136,6 +138,8 @@ public:
 	void UpdateConstantBuffer(RdrConstantBufferHandle hBuffer, const void* pData, uint dataSize, const RdrDebugBackpointer& debug);
 	void UpdateResource(RdrResourceHandle hResource, const void* pData, uint dataSize, const RdrDebugBackpointer& debug);
 	void UpdateResourceFromFile(RdrResourceHandle hResource, const void* pFileData, uint nDataStartOffset, uint dataSize, const RdrDebugBackpointer& debug);
+	// Updates a region of one slice of a texture's top mip.  pData holds tightly packed rows and must stay valid until the next frame starts.
+	void UpdateTextureRegion(RdrResourceHandle hResource, uint arraySlice, const RdrBox& region, const void* pData, const RdrDebugBackpointer& debug);
 
 private:
 	// Command definitions
@@ -144,11 +148,22 @@ private:
 		RdrResourceHandle hResource;
 		const void* pData;
 		uint dataSize;
+		uint dstOffset = 0;
 
 		const void* pFileData = nullptr;
 		RdrDebugBackpointer debug;
 	};
 
+	struct CmdUpdateTextureRegion
+	{
+		RdrResourceHandle hResource;
+		uint arraySlice;
+		RdrBox region;
+		const void* pData;
+
+		RdrDebugBackpointer debug;
+	};
+
 	struct CmdReleaseResource
 	{
 		RdrResourceHandle hResource;
@@ -208,6 +223,7 @@ private:
 
 private:
 	FixedVector<CmdUpdateResource,			  8192>	m_resourceUpdates;
+	FixedVector<CmdUpdateTextureRegion,		  2048>	m_textureRegionUpdates;
 	FixedVector<CmdReleaseResource,			  2048>	m_resourceReleases;
 	FixedVector<CmdReleaseDescriptorTable,	  2048>	m_descTableReleases;
 	FixedVector<CmdReleaseRenderTarget,		  1024>	m_renderTargetReleases;
@@ -0,0 +1,291 @@
+#include "Precompiled.h"
+#include "RdrShaderCache.h"
+#include "UtilsLib/JobPool.h"
+#include <fstream>
+#include <cstdio>
+#include <unordered_map>
+
+namespace
+{
+	const uint kEntryMagic = 0x43524853; // "SHRC"
+	const uint kEntryVersion = 2;
+
+	struct EntryHeader
+	{
+		uint magic;
+		uint version;
+		Hashing::SHA1 key;
+		uint dataSize;
+		uint64 dataChecksum;
+	};
+
+	// Only guards against truncated or corrupted entries; the key already identifies the contents.
+	uint64 calcChecksum(const void* pData, uint dataSize)
+	{
+		return Hashing::HashData64(pData, dataSize);
+	}
+
+	// Distinguishes temporary files when identical entries are written by several threads at once.
+	std::atomic<uint> s_nextTempFileId(0);
+
+	struct CompileBatch
+	{
+		RdrShaderCache* pCache;
+		const std::vector<std::string>* pGlobalDefines;
+		std::vector<RdrShaderCache::CompileRequest*> uniqueRequests;
+	};
+
+	std::string getRequestName(const RdrShaderCache::CompileRequest& rRequest)
+	{
+		char prefix[32];
+		sprintf_s(prefix, "%d:%x:", (int)rRequest.eStage, rRequest.permutationFlags);
+
+		std::string name = prefix;
+		name += rRequest.filename;
+		for (const char* define : rRequest.defines)
+		{
+			name += '#';
+			name += define;
+		}
+		return name;
+	}
+
+	void hashString(Hashing::SHA1HashState* pState, const std::string& str)
+	{
+		// Include the terminator so adjacent strings can't run together into the same key.
+		Hashing::SHA1::Update(pState, str.c_str(), (uint)str.size() + 1);
+	}
+}
+
+RdrShaderCache::RdrShaderCache()
+	: m_preprocessFunc(nullptr)
+	, m_compileFunc(nullptr)
+	, m_pUserData(nullptr)
+	, m_numHits(0)
+	, m_numMisses(0)
+	, m_numRejectedEntries(0)
+	, m_numFailedWrites(0)
+	, m_numDuplicateRequests(0)
+	, m_bEnabled(false)
+{
+}
+
+void RdrShaderCache::Init(const char* cacheDir, const char* compilerId, PreprocessFunc preprocessFunc, CompileFunc compileFunc, void* pUserData)
+{
+	m_cacheDir = cacheDir ? cacheDir : "";
+	m_compilerId = compilerId;
+	m_preprocessFunc = preprocessFunc;
+	m_compileFunc = compileFunc;
+	m_pUserData = pUserData;
+	m_bEnabled = (cacheDir != nullptr);
+	m_numHits = 0;
+	m_numMisses = 0;
+	m_numRejectedEntries = 0;
+	m_numFailedWrites = 0;
+	m_numDuplicateRequests = 0;
+
+	if (m_bEnabled)
+	{
+		Paths::CreateDirectoryTreeForFile(m_cacheDir + "/");
+	}
+}
+
+Hashing::SHA1 RdrShaderCache::CalcKey(RdrShaderStage eStage, const char* pShaderText, uint textLen,
+	const std::vector<std::string>& globalDefines, uint permutationFlags) const
+{
+	uint stage = (uint)eStage;
+	uint numGlobalDefines = (uint)globalDefines.size();
+
+	Hashing::SHA1HashState* pState = Hashing::SHA1::Begin();
+	hashString(pState, m_compilerId);
+	Hashing::SHA1::Update(pState, &stage, sizeof(stage));
+	Hashing::SHA1::Update(pState, &permutationFlags, sizeof(permutationFlags));
+	Hashing::SHA1::Update(pState, &numGlobalDefines, sizeof(numGlobalDefines));
+	for (const std::string& define : globalDefines)
+	{
+		hashString(pState, define);
+	}
+	Hashing::SHA1::Update(pState, &textLen, sizeof(textLen));
+	Hashing::SHA1::Update(pState, pShaderText, textLen);
+
+	Hashing::SHA1 key;
+	Hashing::SHA1::Finish(pState, key);
+	return key;
+}
+
+std::string RdrShaderCache::GetEntryFilename(const Hashing::SHA1& key) const
+{
+	char name[sizeof(key.data) * 2 + 1];
+	for (uint i = 0; i < sizeof(key.data); ++i)
+	{
+		sprintf_s(name + i * 2, 3, "%02x", key.data[i]);
+	}
+
+	return m_cacheDir + "/" + name + ".shdc";
+}
+
+bool RdrShaderCache::LoadEntry(const Hashing::SHA1& key, void** ppOutCompiledData, uint* pOutDataSize)
+{
+	std::string filename = GetEntryFilename(key);
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	uint64 fileSize = (uint64)file.tellg();
+	file.seekg(0);
+
+	EntryHeader header;
+	bool bValid = (fileSize >= sizeof(header));
+	if (bValid)
+	{
+		file.read((char*)&header, sizeof(header));
+		bValid = file.good()
+			&& header.magic == kEntryMagic
+			&& header.version == kEntryVersion
+			&& header.key == key
+			&& header.dataSize > 0
+			&& fileSize == sizeof(header) + (uint64)header.dataSize;
+	}
+
+	char* pData = nullptr;
+	if (bValid)
+	{
+		pData = new char[header.dataSize];
+		file.read(pData, header.dataSize);
+		bValid = file.good() && calcChecksum(pData, header.dataSize) == header.dataChecksum;
+	}
+
+	file.close();
+
+	if (!bValid)
+	{
+		delete[] pData;
+		std::remove(filename.c_str());
+		++m_numRejectedEntries;
+		Warning("Discarding invalid shader cache entry %s", filename.c_str());
+		return false;
+	}
+
+	*ppOutCompiledData = pData;
+	*pOutDataSize = header.dataSize;
+	return true;
+}
+
+bool RdrShaderCache::StoreEntry(const Hashing::SHA1& key, const void* pCompiledData, uint dataSize)
+{
+	EntryHeader header;
+	header.magic = kEntryMagic;
+	header.version = kEntryVersion;
+	header.key = key;
+	header.dataSize = dataSize;
+	header.dataChecksum = calcChecksum(pCompiledData, dataSize);
+
+	// Write to a temporary file and rename it into place so a crash or a concurrent reader never sees a partial entry.
+	std::string filename = GetEntryFilename(key);
+	std::string tempFilename = filename + ".tmp" + std::to_string(s_nextTempFileId++);
+	bool bSucceeded;
+	{
+		std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)pCompiledData, dataSize);
+		bSucceeded = file.good();
+	}
+
+	if (bSucceeded)
+	{
+		std::remove(filename.c_str());
+		bSucceeded = (std::rename(tempFilename.c_str(), filename.c_str()) == 0);
+	}
+
+	if (!bSucceeded)
+	{
+		std::remove(tempFilename.c_str());
+		++m_numFailedWrites;
+	}
+
+	return bSucceeded;
+}
+
+bool RdrShaderCache::GetCompiledShader(RdrShaderStage eStage, const char* pShaderText, uint textLen,
+	const std::vector<std::string>& globalDefines, uint permutationFlags,
+	void** ppOutCompiledData, uint* pOutDataSize)
+{
+	if (!m_bEnabled)
+		return m_compileFunc(eStage, pShaderText, textLen, ppOutCompiledData, pOutDataSize, m_pUserData);
+
+	Hashing::SHA1 key = CalcKey(eStage, pShaderText, textLen, globalDefines, permutationFlags);
+	if (LoadEntry(key, ppOutCompiledData, pOutDataSize))
+	{
+		++m_numHits;
+		return true;
+	}
+
+	++m_numMisses;
+	if (!m_compileFunc(eStage, pShaderText, textLen, ppOutCompiledData, pOutDataSize, m_pUserData))
+		return false;
+
+	StoreEntry(key, *ppOutCompiledData, *pOutDataSize);
+	return true;
+}
+
+void RdrShaderCache::CompileShaderBatch(CompileRequest* aRequests, uint numRequests, const std::vector<std::string>& globalDefines)
+{
+	CompileBatch batch;
+	batch.pCache = this;
+	batch.pGlobalDefines = &globalDefines;
+
+	// Index of the request that compiles each permutation.
+	std::vector<uint> sourceRequests(numRequests);
+	std::unordered_map<std::string, uint> requestIndices;
+	for (uint i = 0; i < numRequests; ++i)
+	{
+		auto result = requestIndices.insert(std::make_pair(getRequestName(aRequests[i]), i));
+		sourceRequests[i] = result.first->second;
+		if (result.second)
+		{
+			batch.uniqueRequests.push_back(&aRequests[i]);
+		}
+	}
+
+	JobPool::ParallelFor((uint)batch.uniqueRequests.size(), 1,
+		[](uint nBegin, uint nEnd, void* pUserData)
+		{
+			CompileBatch* pBatch = (CompileBatch*)pUserData;
+			RdrShaderCache* pCache = pBatch->pCache;
+
+			std::vector<char> shaderText;
+			for (uint i = nBegin; i < nEnd; ++i)
+			{
+				CompileRequest& rRequest = *pBatch->uniqueRequests[i];
+				rRequest.pCompiledData = nullptr;
+				rRequest.compiledSize = 0;
+				rRequest.bSucceeded = false;
+
+				shaderText.clear();
+				if (!pCache->m_preprocessFunc(rRequest.filename, rRequest.defines, shaderText, pCache->m_pUserData))
+					continue;
+
+				rRequest.bSucceeded = pCache->GetCompiledShader(rRequest.eStage, shaderText.data(), (uint)shaderText.size(),
+					*pBatch->pGlobalDefines, rRequest.permutationFlags, &rRequest.pCompiledData, &rRequest.compiledSize);
+			}
+		}, &batch);
+
+	for (uint i = 0; i < numRequests; ++i)
+	{
+		if (sourceRequests[i] == i)
+			continue;
+
+		const CompileRequest& rSource = aRequests[sourceRequests[i]];
+		CompileRequest& rRequest = aRequests[i];
+		rRequest.bSucceeded = rSource.bSucceeded;
+		rRequest.compiledSize = rSource.compiledSize;
+		rRequest.pCompiledData = nullptr;
+		if (rSource.bSucceeded)
+		{
+			rRequest.pCompiledData = new char[rSource.compiledSize];
+			memcpy(rRequest.pCompiledData, rSource.pCompiledData, rSource.compiledSize);
+		}
+
+		++m_numDuplicateRequests;
+	}
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include "RdrShaders.h"
+#include "UtilsLib/Hash.h"
+
+// Persistent cache of compiled shader bytecode.
+// Entries are keyed by a SHA1 of the preprocessed shader text, the global shader defines, the permutation flags,
+// and the compiler identity (version and compile options), so an entry can never match a shader it wasn't built from
+// and nothing has to be invalidated when sources change.  Each entry is a file named after its key that is
+// validated against the key and a checksum of the bytecode when loaded; bad entries are discarded and recompiled.
+// Has no graphics API dependencies.  The preprocessor and compiler are supplied by the caller so the cache can be
+// tested with stubs.  Lookups may be made from multiple threads.
+class RdrShaderCache
+{
+public:
+	// Must allocate the output with new char[] to match RdrContext::ReleaseShader().
+	typedef bool (*CompileFunc)(RdrShaderStage eStage, const char* pShaderText, uint textLen,
+		void** ppOutCompiledData, uint* pOutDataSize, void* pUserData);
+
+	// Expands a shader file with the given defines plus the global defines.
+	typedef bool (*PreprocessFunc)(const char* filename, const std::vector<const char*>& defines,
+		std::vector<char>& rOutShaderText, void* pUserData);
+
+	// One shader permutation in a CompileShaderBatch() call.
+	struct CompileRequest
+	{
+		RdrShaderStage eStage;
+		const char* filename;
+		std::vector<const char*> defines;
+		uint permutationFlags;
+		RdrShader* pShader; // Shader the results are intended for.  Not used by the cache.
+
+		// Results
+		void* pCompiledData;
+		uint compiledSize;
+		bool bSucceeded;
+	};
+
+	struct Stats
+	{
+		uint hits;
+		uint misses;
+		uint rejectedEntries;	// Entries that failed validation.
+		uint failedWrites;
+		uint duplicateRequests;	// Batched requests that shared another request's compile.
+	};
+
+	RdrShaderCache();
+
+	// Passing a null cache directory disables the cache and compiles everything.
+	void Init(const char* cacheDir, const char* compilerId, PreprocessFunc preprocessFunc, CompileFunc compileFunc, void* pUserData);
+
+	// Loads the shader's bytecode from the cache, or compiles it and stores the result.
+	bool GetCompiledShader(RdrShaderStage eStage, const char* pShaderText, uint textLen,
+		const std::vector<std::string>& globalDefines, uint permutationFlags,
+		void** ppOutCompiledData, uint* pOutDataSize);
+
+	// Preprocesses and compiles the requests across the job pool.  Requests with the same stage, file, defines, and
+	// flags are only compiled once.  Results are written back to each request in order, and every successful request
+	// gets its own copy of the bytecode.
+	void CompileShaderBatch(CompileRequest* aRequests, uint numRequests, const std::vector<std::string>& globalDefines);
+
+	Hashing::SHA1 CalcKey(RdrShaderStage eStage, const char* pShaderText, uint textLen,
+		const std::vector<std::string>& globalDefines, uint permutationFlags) const;
+
+	bool LoadEntry(const Hashing::SHA1& key, void** ppOutCompiledData, uint* pOutDataSize);
+	bool StoreEntry(const Hashing::SHA1& key, const void* pCompiledData, uint dataSize);
+
+	bool IsEnabled() const;
+	Stats GetStats() const;
+
+private:
+	std::string GetEntryFilename(const Hashing::SHA1& key) const;
+
+private:
+	std::string m_cacheDir;
+	std::string m_compilerId;
+	PreprocessFunc m_preprocessFunc;
+	CompileFunc m_compileFunc;
+	void* m_pUserData;
+	std::atomic<uint> m_numHits;
+	std::atomic<uint> m_numMisses;
+	std::atomic<uint> m_numRejectedEntries;
+	std::atomic<uint> m_numFailedWrites;
+	std::atomic<uint> m_numDuplicateRequests;
+	bool m_bEnabled;
+};
+
+inline bool RdrShaderCache::IsEnabled() const
+{
+	return m_bEnabled;
+}
+
+inline RdrShaderCache::Stats RdrShaderCache::GetStats() const
+{
+	Stats stats;
+	stats.hits = m_numHits;
+	stats.misses = m_numMisses;
+	stats.rejectedEntries = m_numRejectedEntries;
+	stats.failedWrites = m_numFailedWrites;
+	stats.duplicateRequests = m_numDuplicateRequests;
+	return stats;
+}
@@ -1,7 +1,7 @@
 #include "Precompiled.h"
 #include "RdrShaderSystem.h"
+#include "RdrShaderCache.h"
 #include "UtilsLib/Hash.h"
-#include "UtilsLib/FixedVector.h"
 #include <d3dcompiler.h>
 #include "debug/DebugConsole.h"
 #include "Renderer.h"
@@ -9,6 +9,7 @@
 namespace
 {
 	const char* kShaderFolder = "shaders/";
+	const char* kShaderCacheFolder = "shadercache";
 	const char* kShaderFilePattern = "shaders/*.*";
 
 	const uint kMaxDefines = 16;
@@ -87,21 +88,19 @@ namespace
 
 	typedef std::map<Hashing::StringHash, RdrShader*> RdrShaderNameMap;
 
+	typedef std::vector<RdrShaderCache::CompileRequest> ShaderCompileRequestList;
+
+	// Shaders are recompiled before the command is queued, so the render thread only has to swap in the new bytecode.
 	struct ShdrCmdReloadShader
 	{
-		union
-		{
-			RdrShader* pPixelShader;
-			RdrVertexShaderType vertexShader;
-			RdrGeometryShaderType geomShader;
-			RdrComputeShader computeShader;
-		};
-		RdrShaderStage eStage;
+		RdrShader* pShader;
+		void* pCompiledData; // Null if the shader failed to compile.
+		uint compiledSize;
 	};
 
 	struct ShdrFrameState
 	{
-		FixedVector<ShdrCmdReloadShader, 256>      shaderReloads;
+		std::vector<ShdrCmdReloadShader> shaderReloads;
 	};
 
 	struct
@@ -122,17 +121,43 @@ namespace
 		RdrShaderNameMap pixelShaderCache;
 		RdrShaderList      pixelShaders;
 
-		ThreadMutex reloadMutex;
+		ThreadMutex reloadMutex;	// Serializes shader creation and reloads from the main and file watcher threads.
+		ThreadMutex commandMutex;	// Guards the frame states' commands.
 
-		ShdrFrameState states[2];
+		ShdrFrameState states[kMaxFrameStates];
 		uint       queueState;
 
 		// Defines that are auto-applied to all shaders.
 		std::vector<std::string> globalShaderDefines;
 
+		RdrShaderCache shaderCache;
+
 		bool bInitialized;
 	} s_shaderSystem;
 
+	bool shaderMatches(const RdrShader& rShader, const char* filename, const char** aDefines, uint numDefines)
+	{
+		if (!rShader.filename || _stricmp(rShader.filename, filename) != 0 || rShader.defines.size() != numDefines)
+			return false;
+
+		for (uint i = 0; i < numDefines; ++i)
+		{
+			if (strcmp(rShader.defines[i], aDefines[i]) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	const RdrShader* findShader(const RdrShader* aShaders, uint numShaders, const char* filename, const char** aDefines, uint numDefines)
+	{
+		for (uint i = 0; i < numShaders; ++i)
+		{
+			if (shaderMatches(aShaders[i], filename, aDefines, numDefines))
+				return &aShaders[i];
+		}
+		return nullptr;
+	}
+
 	inline ShdrFrameState& getQueueState()
 	{
 		return s_shaderSystem.states[s_shaderSystem.queueState];
@@ -215,46 +240,93 @@ namespace
 		return pPreprocessedData;
 	}
 
-	void createDefaultShader(RdrContext* pRdrContext, const RdrShaderStage eStage, const RdrShaderDef& rShaderDef, const RdrShaderFlags flags, RdrShader& rOutShader)
+	bool compileShaderWithContext(RdrShaderStage eStage, const char* pShaderText, uint textLen, void** ppOutCompiledData, uint* pOutDataSize, void* pUserData)
+	{
+		const RdrContext* pRdrContext = (const RdrContext*)pUserData;
+		return pRdrContext->CompileShader(eStage, pShaderText, textLen, ppOutCompiledData, pOutDataSize);
+	}
+
+	bool preprocessShaderText(const char* filename, const std::vector<const char*>& defines, std::vector<char>& rOutShaderText, void* pUserData)
+	{
+		ID3D10Blob* pPreprocData = preprocessShader(filename, defines);
+		if (!pPreprocData)
+			return false;
+
+		const char* pShaderText = (const char*)pPreprocData->GetBufferPointer();
+		rOutShaderText.assign(pShaderText, pShaderText + pPreprocData->GetBufferSize());
+		pPreprocData->Release();
+		return true;
+	}
+
+	bool compileShader(RdrShaderStage eStage, const char* pShaderText, uint textLen, RdrShaderFlags flags, void** ppOutCompiledData, uint* pOutDataSize)
+	{
+		return s_shaderSystem.shaderCache.GetCompiledShader(eStage, pShaderText, textLen,
+			s_shaderSystem.globalShaderDefines, (uint)flags, ppOutCompiledData, pOutDataSize);
+	}
+
+	void addShaderRequest(ShaderCompileRequestList& rRequests, RdrShader* pShader, RdrShaderFlags flags)
+	{
+		RdrShaderCache::CompileRequest request;
+		request.eStage = pShader->eStage;
+		request.filename = pShader->filename;
+		request.defines = pShader->defines;
+		request.permutationFlags = (uint)flags;
+		request.pShader = pShader;
+		rRequests.push_back(request);
+	}
+
+	void addDefaultShaderRequest(ShaderCompileRequestList& rRequests, const RdrShaderStage eStage, const RdrShaderDef& rShaderDef, const RdrShaderFlags flags, RdrShader* pShader)
 	{
 		if (!rShaderDef.filename)
 			return;
 
-		std::vector<const char*> defines;
+		RdrShaderCache::CompileRequest request;
+		request.eStage = eStage;
+		request.filename = rShaderDef.filename;
+		request.permutationFlags = (uint)flags;
+		request.pShader = pShader;
+
 		uint numDefines = 0;
 		while (rShaderDef.aDefines[numDefines] != 0)
 		{
-			defines.push_back(rShaderDef.aDefines[numDefines]);
+			request.defines.push_back(rShaderDef.aDefines[numDefines]);
 			++numDefines;
 		}
 
 		if ((flags & RdrShaderFlags::DepthOnly) != RdrShaderFlags::None)
-			defines.push_back("DEPTH_ONLY");
+			request.defines.push_back("DEPTH_ONLY");
 		if ((flags & RdrShaderFlags::AlphaCutout) != RdrShaderFlags::None)
-			defines.push_back("ALPHA_CUTOUT");
+			request.defines.push_back("ALPHA_CUTOUT");
 		if ((flags & RdrShaderFlags::IsInstanced) != RdrShaderFlags::None)
-			defines.push_back("IS_INSTANCED");
-		
-		ID3D10Blob* pPreprocData = preprocessShader(rShaderDef.filename, defines);
-		Assert(pPreprocData);
-
-		void* pCompiledData;
-		uint compiledDataSize;
+			request.defines.push_back("IS_INSTANCED");
+		if ((flags & RdrShaderFlags::PackedVertices) != RdrShaderFlags::None)
+			request.defines.push_back("PACKED_VERTICES");
 
-		const char* pShaderText = (char*)pPreprocData->GetBufferPointer();
-		bool res = pRdrContext->CompileShader(eStage, pShaderText, (uint)pPreprocData->GetBufferSize(), &pCompiledData, &compiledDataSize);
-		Assert(res);
+		rRequests.push_back(request);
+	}
 
-		rOutShader.filename = rShaderDef.filename;
-		rOutShader.pCompiledData = pCompiledData;
-		rOutShader.compiledSize = compiledDataSize;
-		rOutShader.eStage = eStage;
+	void compileShaderRequests(ShaderCompileRequestList& rRequests)
+	{
+		if (!rRequests.empty())
+		{
+			s_shaderSystem.shaderCache.CompileShaderBatch(rRequests.data(), (uint)rRequests.size(), s_shaderSystem.globalShaderDefines);
+		}
+	}
 
-		rOutShader.pCompiledData = pCompiledData;
-		rOutShader.compiledSize = compiledDataSize;
-		rOutShader.defines = defines;
+	// Compiles the shaders and queues the results for the render thread to swap in.
+	void queueShaderReloads(ShaderCompileRequestList& rRequests)
+	{
+		compileShaderRequests(rRequests);
 
-		pPreprocData->Release();
+		AutoScopedLock lock(s_shaderSystem.commandMutex);
+		for (const RdrShaderCache::CompileRequest& rRequest : rRequests)
+		{
+			ShdrCmdReloadShader cmd;
+			cmd.pShader = rRequest.pShader;
+			cmd.pCompiledData = rRequest.bSucceeded ? rRequest.pCompiledData : nullptr;
+			cmd.compiledSize = rRequest.bSucceeded ? rRequest.compiledSize : 0;
+			getQueueState().shaderReloads.push_back(cmd);
+		}
 	}
 
 	void handleShaderFileChanged(const char* filename, void* pUserData)
@@ -283,49 +355,34 @@ namespace
 		return (uint)shader;
 	}
 
-	void processDefaultShaderReload(RdrShaderStage eStage, RdrShader* pShader, const RdrShaderDef& rShaderDef, RdrShaderFlags flags, RdrShader& rErrorShader, RdrContext* pRdrContext)
+	void addVertexShaderRequests(ShaderCompileRequestList& rRequests, RdrVertexShaderType eType)
 	{
-		// Free the old shader object if it wasn't the error shader.
-		if (pShader->pCompiledData != rErrorShader.pCompiledData)
+		RdrVertexShader vertexShader;
+		vertexShader.eType = eType;
+		for (uint flags = 0; flags < (uint)RdrShaderFlags::NumCombos; ++flags)
 		{
-			pRdrContext->ReleaseShader(pShader);
+			vertexShader.flags = (RdrShaderFlags)flags;
+			addDefaultShaderRequest(rRequests, RdrShaderStage::Vertex, kVertexShaderDefs[(int)eType], vertexShader.flags,
+				&s_shaderSystem.vertexShaders[getVertexShaderIndex(vertexShader)]);
 		}
-
-		createDefaultShader(pRdrContext, eStage, rShaderDef, flags, *pShader);
 	}
 
-	void processShaderReload(RdrShaderStage eStage, RdrShader* pShader, RdrShader& rErrorShader, RdrContext* pRdrContext)
+	void addGeometryShaderRequests(ShaderCompileRequestList& rRequests, RdrGeometryShaderType eType)
 	{
-		// Free the old shader object if it wasn't the error shader.
-		if (pShader->pCompiledData != rErrorShader.pCompiledData)
+		RdrGeometryShader geomShader;
+		geomShader.eType = eType;
+		for (uint flags = 0; flags < (uint)RdrShaderFlags::NumCombos; ++flags)
 		{
-			pRdrContext->ReleaseShader(pShader);
+			geomShader.flags = (RdrShaderFlags)flags;
+			addDefaultShaderRequest(rRequests, RdrShaderStage::Geometry, kGeometryShaderDefs[(int)eType], geomShader.flags,
+				&s_shaderSystem.geometryShaders[getGeometryShaderIndex(geomShader)]);
 		}
+	}
 
-		ID3D10Blob* pBlob = preprocessShader(pShader->filename, pShader->defines);
-		if (pBlob)
-		{
-			uint textLen = (uint)pBlob->GetBufferSize();
-			char* pShaderText = new char[textLen];
-			memcpy(pShaderText, pBlob->GetBufferPointer(), textLen);
-
-			void* pCompiledData;
-			uint compiledDataSize;
-			bool succeeded = pRdrContext->CompileShader(eStage, pShaderText, textLen, &pCompiledData, &compiledDataSize);
-			if (succeeded)
-			{
-				pShader->pCompiledData = pCompiledData;
-				pShader->compiledSize = compiledDataSize;
-			}
-			else
-			{
-				pShader->pCompiledData = rErrorShader.pCompiledData;
-				pShader->compiledSize = rErrorShader.compiledSize;
-			}
-
-			delete pShaderText;
-			pBlob->Release();
-		}
+	void addComputeShaderRequest(ShaderCompileRequestList& rRequests, RdrComputeShader eShader)
+	{
+		addDefaultShaderRequest(rRequests, RdrShaderStage::Compute, kComputeShaderDefs[(int)eShader], RdrShaderFlags::None,
+			&s_shaderSystem.computeShaders[getComputeShaderIndex(eShader)]);
 	}
 
 	void cmdSetGlobalShaderDefine(DebugCommandArg* args, int numArgs)
@@ -347,27 +404,31 @@ void RdrShaderSystem::Init(RdrContext* pRdrContext)
 	// Debug commands
 	DebugConsole::RegisterCommand("SetGlobalShaderDefine", cmdSetGlobalShaderDefine, DebugCommandArgType::String, DebugCommandArgType::Integer);
 
+	// Compiled shaders are cached on disk between runs.
+	{
+		char compilerId[128];
+		pRdrContext->GetShaderCompilerId(compilerId, sizeof(compilerId));
+
+		char cacheDir[FILE_MAX_PATH];
+		sprintf_s(cacheDir, "%s/%s", Paths::GetBinDataDir(), kShaderCacheFolder);
+
+		s_shaderSystem.shaderCache.Init(g_userConfig.shaderCache ? cacheDir : nullptr, compilerId,
+			preprocessShaderText, compileShaderWithContext, pRdrContext);
+	}
+
 	//////////////////////////////////////
 	// Load default shaders.
-	for (int vs = 0; vs < (uint)RdrVertexShaderType::Count; ++vs)
+	// Every permutation is compiled in a single batch so they can be spread across the job pool.
+	ShaderCompileRequestList requests;
+	for (int vs = 0; vs < (int)RdrVertexShaderType::Count; ++vs)
 	{
-		for (uint flags = 0; flags < (uint)RdrShaderFlags::NumCombos; ++flags)
-		{
-			createDefaultShader(pRdrContext, RdrShaderStage::Vertex,
-				kVertexShaderDefs[vs], (RdrShaderFlags)flags,
-				s_shaderSystem.vertexShaders[vs * (uint)RdrShaderFlags::NumCombos + flags]);
-		}
+		addVertexShaderRequests(requests, (RdrVertexShaderType)vs);
 	}
 
 	/// Geometry shaders
 	for (int gs = 0; gs < (int)RdrGeometryShaderType::Count; ++gs)
 	{
-		for (uint flags = 0; flags < (uint)RdrShaderFlags::NumCombos; ++flags)
-		{
-			createDefaultShader(pRdrContext, RdrShaderStage::Geometry,
-				kGeometryShaderDefs[gs], (RdrShaderFlags)flags,
-				s_shaderSystem.geometryShaders[gs * (uint)RdrShaderFlags::NumCombos + flags]);
-		}
+		addGeometryShaderRequests(requests, (RdrGeometryShaderType)gs);
 	}
 
 	/// Tessellation shaders
@@ -375,31 +436,46 @@ void RdrShaderSystem::Init(RdrContext* pRdrContext)
 	{
 		for (uint flags = 0; flags < (uint)RdrShaderFlags::NumCombos; ++flags)
 		{
-			createDefaultShader(pRdrContext, RdrShaderStage::Hull,
+			addDefaultShaderRequest(requests, RdrShaderStage::Hull,
 				kHullShaderDefs[ts], (RdrShaderFlags)flags,
-				s_shaderSystem.hullShaders[ts * (uint)RdrShaderFlags::NumCombos + flags]);
-			createDefaultShader(pRdrContext, RdrShaderStage::Domain,
+				&s_shaderSystem.hullShaders[ts * (uint)RdrShaderFlags::NumCombos + flags]);
+			addDefaultShaderRequest(requests, RdrShaderStage::Domain,
 				kDomainShaderDefs[ts], (RdrShaderFlags)flags,
-				s_shaderSystem.domainShaders[ts * (uint)RdrShaderFlags::NumCombos + flags]);
+				&s_shaderSystem.domainShaders[ts * (uint)RdrShaderFlags::NumCombos + flags]);
 		}
 	}
 
 	/// Compute shaders
 	for (int cs = 0; cs < (int)RdrComputeShader::Count; ++cs)
 	{
-		createDefaultShader(pRdrContext, RdrShaderStage::Compute,
-			kComputeShaderDefs[cs], RdrShaderFlags::None,
-			s_shaderSystem.computeShaders[cs]);
-
-		s_shaderSystem.computeShaderPipelineStates[cs] = RdrPipelineState::CreateComputePipelineState(&s_shaderSystem.computeShaders[cs]);
+		addComputeShaderRequest(requests, (RdrComputeShader)cs);
 	}
 
 	// Error shaders
 	RdrShaderDef errorPixelShader = { "p_error.hlsl", 0 };
-	createDefaultShader(pRdrContext, RdrShaderStage::Pixel, errorPixelShader, RdrShaderFlags::None, s_shaderSystem.errorShaders[(int)RdrShaderStage::Pixel]);
+	addDefaultShaderRequest(requests, RdrShaderStage::Pixel, errorPixelShader, RdrShaderFlags::None, &s_shaderSystem.errorShaders[(int)RdrShaderStage::Pixel]);
 
 	RdrShaderDef wireframePixelShader = { "p_wireframe.hlsl", 0 };
-	createDefaultShader(pRdrContext, RdrShaderStage::Pixel, wireframePixelShader, RdrShaderFlags::None, s_shaderSystem.wireframePixelShader);
+	addDefaultShaderRequest(requests, RdrShaderStage::Pixel, wireframePixelShader, RdrShaderFlags::None, &s_shaderSystem.wireframePixelShader);
+
+	compileShaderRequests(requests);
+
+	for (const RdrShaderCache::CompileRequest& rRequest : requests)
+	{
+		Assert(rRequest.bSucceeded);
+
+		RdrShader& rShader = *rRequest.pShader;
+		rShader.filename = rRequest.filename;
+		rShader.pCompiledData = rRequest.pCompiledData;
+		rShader.compiledSize = rRequest.compiledSize;
+		rShader.eStage = rRequest.eStage;
+		rShader.defines = rRequest.defines;
+	}
+
+	for (int cs = 0; cs < (int)RdrComputeShader::Count; ++cs)
+	{
+		s_shaderSystem.computeShaderPipelineStates[cs] = RdrPipelineState::CreateComputePipelineState(&s_shaderSystem.computeShaders[cs]);
+	}
 
 	FileWatcher::AddListener(kShaderFilePattern, handleShaderFileChanged, nullptr);
 
@@ -410,26 +486,20 @@ void RdrShaderSystem::ReloadShader(const char* filename)
 {
 	AutoScopedLock lock(s_shaderSystem.reloadMutex);
 
-	bool found = false;
+	ShaderCompileRequestList requests;
 
 	Hashing::StringHash nameHash = Hashing::HashString(filename);
 	RdrShaderNameMap::iterator iter = s_shaderSystem.pixelShaderCache.find(nameHash);
 	if (iter != s_shaderSystem.pixelShaderCache.end())
 	{
-		ShdrCmdReloadShader& cmd = getQueueState().shaderReloads.pushSafe();
-		cmd.eStage = RdrShaderStage::Pixel;
-		cmd.pPixelShader = iter->second;
-		found = true;
+		addShaderRequest(requests, iter->second, RdrShaderFlags::None);
 	}
 
 	for (int i = 0; i < (int)RdrVertexShaderType::Count; ++i)
 	{
 		if (_stricmp(filename, kVertexShaderDefs[i].filename) == 0)
 		{
-			ShdrCmdReloadShader& cmd = getQueueState().shaderReloads.pushSafe();
-			cmd.eStage = RdrShaderStage::Vertex;
-			cmd.vertexShader = (RdrVertexShaderType)i;
-			found = true;
+			addVertexShaderRequests(requests, (RdrVertexShaderType)i);
 		}
 	}
 
@@ -437,10 +507,7 @@ void RdrShaderSystem::ReloadShader(const char* filename)
 	{
 		if (_stricmp(filename, kComputeShaderDefs[i].filename) == 0)
 		{
-			ShdrCmdReloadShader& cmd = getQueueState().shaderReloads.pushSafe();
-			cmd.eStage = RdrShaderStage::Compute;
-			cmd.computeShader = (RdrComputeShader)i;
-			found = true;
+			addComputeShaderRequest(requests, (RdrComputeShader)i);
 		}
 	}
 
@@ -448,20 +515,20 @@ void RdrShaderSystem::ReloadShader(const char* filename)
 	{
 		if (_stricmp(filename, kGeometryShaderDefs[i].filename) == 0)
 		{
-			ShdrCmdReloadShader& cmd = getQueueState().shaderReloads.pushSafe();
-			cmd.eStage = RdrShaderStage::Geometry;
-			cmd.geomShader = (RdrGeometryShaderType)i;
-			found = true;
+			addGeometryShaderRequests(requests, (RdrGeometryShaderType)i);
 		}
 	}
 
 	uint nFilenameLen = (uint)strlen(filename);
-	if (!found && 
-		(_stricmp(&filename[nFilenameLen - 6], ".hlsli") == 0) || (_stricmp(&filename[nFilenameLen - 2], ".h") == 0))
+	if (requests.empty() &&
+		((_stricmp(&filename[nFilenameLen - 6], ".hlsli") == 0) || (_stricmp(&filename[nFilenameLen - 2], ".h") == 0)))
 	{
 		// Couldn't find any specific shader... but it has a header extension.  Just reload all shaders
 		ReloadAllShaders();
+		return;
 	}
+
+	queueShaderReloads(requests);
 }
 
 void RdrShaderSystem::ReloadAllShaders()
@@ -469,36 +536,35 @@ void RdrShaderSystem::ReloadAllShaders()
 	if (!s_shaderSystem.bInitialized)
 		return;
 
+	AutoScopedLock lock(s_shaderSystem.reloadMutex);
+
+	ShaderCompileRequestList requests;
 	for (int i = 0; i < (int)RdrVertexShaderType::Count; ++i)
 	{
-		ShdrCmdReloadShader& cmd = getQueueState().shaderReloads.pushSafe();
-		cmd.eStage = RdrShaderStage::Vertex;
-		cmd.vertexShader = (RdrVertexShaderType)i;
+		addVertexShaderRequests(requests, (RdrVertexShaderType)i);
 	}
 	for (int i = 0; i < (int)RdrComputeShader::Count; ++i)
 	{
-		ShdrCmdReloadShader& cmd = getQueueState().shaderReloads.pushSafe();
-		cmd.eStage = RdrShaderStage::Compute;
-		cmd.computeShader = (RdrComputeShader)i;
+		addComputeShaderRequest(requests, (RdrComputeShader)i);
 	}
 	for (int i = 0; i < (int)RdrGeometryShaderType::Count; ++i)
 	{
-		ShdrCmdReloadShader& cmd = getQueueState().shaderReloads.pushSafe();
-		cmd.eStage = RdrShaderStage::Geometry;
-		cmd.geomShader = (RdrGeometryShaderType)i;
+		addGeometryShaderRequests(requests, (RdrGeometryShaderType)i);
 	}
 
 	RdrShaderNameMap::iterator iter = s_shaderSystem.pixelShaderCache.begin();
 	for (; iter != s_shaderSystem.pixelShaderCache.end(); ++iter)
 	{
-		ShdrCmdReloadShader& cmd = getQueueState().shaderReloads.pushSafe();
-		cmd.eStage = RdrShaderStage::Pixel;
-		cmd.pPixelShader = iter->second;
+		addShaderRequest(requests, iter->second, RdrShaderFlags::None);
 	}
+
+	queueShaderReloads(requests);
 }
 
 void RdrShaderSystem::SetGlobalShaderDefine(const char* define, bool enable)
 {
+	AutoScopedLock lock(s_shaderSystem.reloadMutex);
+
 	auto iter = s_shaderSystem.globalShaderDefines.begin();
 	for (; iter != s_shaderSystem.globalShaderDefines.end(); ++iter)
 	{
@@ -528,6 +594,8 @@ void RdrShaderSystem::SetGlobalShaderDefine(const char* define, bool enable)
 
 const RdrShader* RdrShaderSystem::CreatePixelShaderFromFile(const char* filename, const char** aDefines, uint numDefines)
 {
+	AutoScopedLock lock(s_shaderSystem.reloadMutex);
+
 	// Find shader in cache
 	char cacheName[256] = { 0 };
 	strcat_s(cacheName, filename);
@@ -554,10 +622,11 @@ const RdrShader* RdrShaderSystem::CreatePixelShaderFromFile(const char* filename
 		RdrShader* pShader = s_shaderSystem.pixelShaders.allocSafe();
 		pShader->filename = _strdup(filename);
 		pShader->defines = defines;
+		pShader->eStage = RdrShaderStage::Pixel;
 
 		s_shaderSystem.pixelShaderCache.insert(std::make_pair(nameHash, pShader));
 
-		bool res = g_pRenderer->GetContext()->CompileShader(RdrShaderStage::Pixel, (char*)pBlob->GetBufferPointer(), (uint)pBlob->GetBufferSize(), &pShader->pCompiledData, &pShader->compiledSize);
+		bool res = compileShader(RdrShaderStage::Pixel, (char*)pBlob->GetBufferPointer(), (uint)pBlob->GetBufferSize(), RdrShaderFlags::None, &pShader->pCompiledData, &pShader->compiledSize);
 		Assert(res);
 
 		return pShader;
@@ -609,69 +678,71 @@ const RdrShader* RdrShaderSystem::GetWireframePixelShader()
 	return &s_shaderSystem.wireframePixelShader;
 }
 
-void RdrShaderSystem::FlipState()
+const RdrShader* RdrShaderSystem::FindShader(RdrShaderStage eStage, const char* filename, const char** aDefines, uint numDefines)
+{
+	switch (eStage)
+	{
+	case RdrShaderStage::Vertex:
+		return findShader(s_shaderSystem.vertexShaders, (uint)ARRAY_SIZE(s_shaderSystem.vertexShaders), filename, aDefines, numDefines);
+	case RdrShaderStage::Pixel:
+		return CreatePixelShaderFromFile(filename, aDefines, numDefines);
+	case RdrShaderStage::Hull:
+		return findShader(s_shaderSystem.hullShaders, (uint)ARRAY_SIZE(s_shaderSystem.hullShaders), filename, aDefines, numDefines);
+	case RdrShaderStage::Domain:
+		return findShader(s_shaderSystem.domainShaders, (uint)ARRAY_SIZE(s_shaderSystem.domainShaders), filename, aDefines, numDefines);
+	default:
+		Assert(false);
+		return nullptr;
+	}
+}
+
+RdrShaderCache::Stats RdrShaderSystem::GetShaderCacheStats()
+{
+	return s_shaderSystem.shaderCache.GetStats();
+}
+
+void RdrShaderSystem::FlipState(uint nQueueState)
 {
-	s_shaderSystem.queueState = !s_shaderSystem.queueState;
+	AutoScopedLock lock(s_shaderSystem.commandMutex);
+	s_shaderSystem.queueState = nQueueState;
 }
 
-void RdrShaderSystem::ProcessCommands(RdrContext* pRdrContext)
+void RdrShaderSystem::ProcessCommands(RdrContext* pRdrContext, uint nFrameState)
 {
-	ShdrFrameState& state = s_shaderSystem.states[!s_shaderSystem.queueState];
+	AutoScopedLock lock(s_shaderSystem.commandMutex);
+	ShdrFrameState& state = s_shaderSystem.states[nFrameState];
 
-	// Shader creates
+	// Shader reloads
+	for (const ShdrCmdReloadShader& cmd : state.shaderReloads)
 	{
-		AutoScopedLock lock(s_shaderSystem.reloadMutex);
+		RdrShader* pShader = cmd.pShader;
+		const RdrShader& rErrorShader = s_shaderSystem.errorShaders[(int)pShader->eStage];
 
-		uint numCmds = (uint)state.shaderReloads.size();
-		for (uint i = 0; i < numCmds; ++i)
+		if (!cmd.pCompiledData && !rErrorShader.pCompiledData)
 		{
-			ShdrCmdReloadShader& cmd = state.shaderReloads[i];
-
-			RdrShader& rErrorShader = s_shaderSystem.errorShaders[(int)cmd.eStage];
-			RdrShader* pShader = nullptr;
-
-			switch (cmd.eStage)
-			{
-			case RdrShaderStage::Pixel:
-				{
-					pShader = cmd.pPixelShader;
-					processShaderReload(cmd.eStage, pShader, rErrorShader, pRdrContext);
-				}
-				break;
-			case RdrShaderStage::Vertex:
-				{
-					RdrVertexShader vertexShader;
-					vertexShader.eType = cmd.vertexShader;
-					for (uint flags = 0; flags < (uint)RdrShaderFlags::NumCombos; ++flags)
-					{
-						vertexShader.flags = (RdrShaderFlags)flags;
-						pShader = &s_shaderSystem.vertexShaders[getVertexShaderIndex(vertexShader)];
-						processDefaultShaderReload(cmd.eStage, pShader, kVertexShaderDefs[(int)cmd.vertexShader], vertexShader.flags, rErrorShader, pRdrContext);
-					}
-				}
-				break;
-			case RdrShaderStage::Geometry:
-				{
-					RdrGeometryShader geomShader;
-					geomShader.eType = cmd.geomShader;
-					for (uint flags = 0; flags < (uint)RdrShaderFlags::NumCombos; ++flags)
-					{
-						geomShader.flags = (RdrShaderFlags)flags;
-						pShader = &s_shaderSystem.geometryShaders[getGeometryShaderIndex(geomShader)];
-						processDefaultShaderReload(cmd.eStage, pShader, kGeometryShaderDefs[(int)cmd.geomShader], geomShader.flags, rErrorShader, pRdrContext);
-					}
-				}
-				break;
-			case RdrShaderStage::Compute:
-				{
-					pShader = &s_shaderSystem.computeShaders[getComputeShaderIndex(cmd.computeShader)];
-					processDefaultShaderReload(cmd.eStage, pShader, kComputeShaderDefs[(int)cmd.computeShader], RdrShaderFlags::None, rErrorShader, pRdrContext);
-				}
-				break;
-			}
-
-			RecreatePipelineStatesForShader(pShader);
+			// No error shader for this stage, so keep using the last version that compiled.
+			Warning("Failed to reload shader %s", pShader->filename);
+			continue;
+		}
+
+		// Free the old shader object if it wasn't the error shader.
+		if (pShader->pCompiledData != rErrorShader.pCompiledData)
+		{
+			pRdrContext->ReleaseShader(pShader);
 		}
+
+		if (cmd.pCompiledData)
+		{
+			pShader->pCompiledData = cmd.pCompiledData;
+			pShader->compiledSize = cmd.compiledSize;
+		}
+		else
+		{
+			pShader->pCompiledData = rErrorShader.pCompiledData;
+			pShader->compiledSize = rErrorShader.compiledSize;
+		}
+
+		RecreatePipelineStatesForShader(pShader);
 	}
 
 	state.shaderReloads.clear();
@@ -2,6 +2,7 @@
 
 #include "RdrShaders.h"
 #include "RdrGeometry.h"
+#include "RdrShaderCache.h"
 
 class RdrContext;
 
@@ -26,7 +27,14 @@ namespace RdrShaderSystem
 
 	const RdrShader* GetWireframePixelShader();
 
-	void FlipState();
-	void ProcessCommands(RdrContext* pRdrContext);
+	// Finds the vertex, hull, or domain shader built from the file and defines.
+	// Pixel shaders are created through CreatePixelShaderFromFile(), so the defines must stay valid as they do there.
+	const RdrShader* FindShader(RdrShaderStage eStage, const char* filename, const char** aDefines, uint numDefines);
+
+	RdrShaderCache::Stats GetShaderCacheStats();
+
+	// Frame states are indexed the same as the renderer's.
+	void FlipState(uint nQueueState);
+	void ProcessCommands(RdrContext* pRdrContext, uint nFrameState);
 }
 
@@ -48,6 +48,7 @@ enum class RdrShaderFlags : uint
 	DepthOnly		= 1 << 1,
 	AlphaCutout		= 1 << 2,
 	IsInstanced		= 1 << 3,
+	PackedVertices	= 1 << 4,
 
 	// Note: Need to switch m_vertexShaders over to a hash table if flag count gets too large.
 	NumCombos		= 1 << 5
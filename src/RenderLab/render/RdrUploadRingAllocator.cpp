@@ -0,0 +1,115 @@
+#include "Precompiled.h"
+#include "RdrUploadRingAllocator.h"
+
+namespace
+{
+	uint64 alignOffset(uint64 offset, uint64 alignment)
+	{
+		return (offset + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+RdrUploadRingAllocator::RdrUploadRingAllocator()
+	: m_capacity(0)
+	, m_head(0)
+	, m_used(0)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void RdrUploadRingAllocator::Init(uint64 capacity)
+{
+	m_frames.clear();
+	m_capacity = capacity;
+	m_head = 0;
+	m_used = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_stats.capacity = capacity;
+}
+
+void RdrUploadRingAllocator::BeginFrame(uint64 frameNum, uint64 lastCompletedFrame)
+{
+	while (!m_frames.empty() && m_frames.front().frameNum <= lastCompletedFrame)
+	{
+		m_used -= m_frames.front().size;
+		m_frames.pop_front();
+	}
+
+	FrameRange frame;
+	frame.frameNum = frameNum;
+	frame.startOffset = m_head;
+	frame.size = 0;
+	m_frames.push_back(frame);
+
+	m_stats.bytesAllocatedThisFrame = 0;
+	m_stats.allocationsThisFrame = 0;
+	m_stats.bytesInUse = m_used;
+}
+
+uint64 RdrUploadRingAllocator::Allocate(uint64 size, uint64 alignment)
+{
+	Assert(!m_frames.empty());
+	Assert(size > 0 && (alignment & (alignment - 1)) == 0);
+
+	FrameRange& rFrame = m_frames.back();
+
+	// Nothing is in flight, so start over from the beginning to make the whole ring available.
+	if (m_used == 0)
+	{
+		m_head = 0;
+		rFrame.startOffset = 0;
+	}
+
+	// Free space runs from the head to the oldest byte still in use, which may mean wrapping around the end of the ring.
+	// Frames that didn't allocate anything don't hold any space.
+	uint64 tail = m_head;
+	for (const FrameRange& rInFlightFrame : m_frames)
+	{
+		if (rInFlightFrame.size > 0)
+		{
+			tail = rInFlightFrame.startOffset;
+			break;
+		}
+	}
+
+	uint64 offset = kInvalidOffset;
+	uint64 alignedHead = alignOffset(m_head, alignment);
+	if (m_used == 0 || m_head > tail)
+	{
+		if (alignedHead + size <= m_capacity)
+		{
+			offset = alignedHead;
+		}
+		else if (size <= tail)
+		{
+			offset = 0;
+		}
+	}
+	else if (m_head < tail && alignedHead + size <= tail)
+	{
+		offset = alignedHead;
+	}
+
+	if (offset == kInvalidOffset)
+	{
+		++m_stats.failedAllocations;
+		return kInvalidOffset;
+	}
+
+	// Padding and any space skipped at the end of the ring are freed along with the rest of the frame.
+	uint64 consumed = (offset >= m_head) ? (offset + size - m_head) : (m_capacity - m_head + size);
+	rFrame.size += consumed;
+	m_used += consumed;
+	m_head = offset + size;
+	if (m_head == m_capacity)
+	{
+		m_head = 0;
+	}
+
+	++m_stats.allocationsThisFrame;
+	m_stats.bytesAllocatedThisFrame += consumed;
+	m_stats.bytesInUse = m_used;
+	m_stats.peakBytesInUse = std::max(m_stats.peakBytesInUse, m_used);
+
+	return offset;
+}
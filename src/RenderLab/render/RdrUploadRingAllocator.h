@@ -0,0 +1,50 @@
+#pragma once
+
+#include <deque>
+
+// Sub-allocates ranges of a shared upload buffer for resource updates.
+// Allocations are made in a ring and tagged with the frame they were made in.  A frame's space is reclaimed once
+// the GPU has finished that frame, so nothing is overwritten while a copy from it may still be pending.
+// Only deals in offsets and has no graphics API dependencies; the caller owns the memory the offsets refer to.
+class RdrUploadRingAllocator
+{
+public:
+	static const uint64 kInvalidOffset = ~0ull;
+
+	struct Stats
+	{
+		uint64 capacity;
+		uint64 bytesInUse;				// Bytes held by frames the GPU may still be reading, including the current frame.
+		uint64 peakBytesInUse;
+		uint64 bytesAllocatedThisFrame;	// Includes alignment padding and space skipped when wrapping.
+		uint allocationsThisFrame;
+		uint failedAllocations;			// Allocations that didn't fit since Init().
+	};
+
+	RdrUploadRingAllocator();
+
+	void Init(uint64 capacity);
+
+	// Starts a new frame and reclaims the space used by every frame up to and including lastCompletedFrame.
+	void BeginFrame(uint64 frameNum, uint64 lastCompletedFrame);
+
+	// Returns the offset of a range of the requested size and alignment, or kInvalidOffset if it doesn't fit.
+	// Alignment must be a power of two.
+	uint64 Allocate(uint64 size, uint64 alignment);
+
+	const Stats& GetStats() const { return m_stats; }
+
+private:
+	struct FrameRange
+	{
+		uint64 frameNum;
+		uint64 startOffset;
+		uint64 size;
+	};
+
+	std::deque<FrameRange> m_frames; // Frames that haven't been reclaimed yet, oldest first.
+	uint64 m_capacity;
+	uint64 m_head;	// Next byte to allocate.
+	uint64 m_used;
+	Stats m_stats;
+};
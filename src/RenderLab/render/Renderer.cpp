@@ -10,6 +10,7 @@
 #include "RdrDrawOp.h"
 #include "RdrComputeOp.h"
 #include "RdrInstancedObjectDataBuffer.h"
+#include "RdrPipelineStateCache.h"
 #include "Scene.h"
 #include "components/Renderable.h"
 #include "components/Light.h"
@@ -27,6 +28,9 @@ DWORD Renderer::s_nRenderThreadId = 0;
 
 namespace
 {
+	// Readback buffers that go unused for this many frames are destroyed.
+	const uint kReadbackBufferIdleFrames = 300;
+
 	void cmdSetLightingMethod(DebugCommandArg *args, int numArgs)
 	{
 		g_pRenderer->SetLightingMethod((RdrLightingMethod)args[0].val.inum);
@@ -42,6 +46,12 @@ bool Renderer::Init(HWND hWnd, int width, int height, const InputManager* pInput
 
 	DebugConsole::RegisterCommand("lightingMethod", cmdSetLightingMethod, DebugCommandArgType::Integer);
 
+	uint numFrameStates = (uint)std::max(g_userConfig.framesInFlight, (int)RdrFrameSync::kMinFrameStates);
+	numFrameStates = std::min(numFrameStates, kMaxFrameStates);
+	m_frameSync.Init(numFrameStates);
+	m_activeState = 0;
+	RdrFrameMem::Init(numFrameStates);
+
 	m_pContext = new RdrContext(m_gpuProfiler);
 	if (!m_pContext->Init(hWnd, width, height))
 		return false;
@@ -56,6 +66,7 @@ bool Renderer::Init(HWND hWnd, int width, int height, const InputManager* pInput
 
 	RdrShaderSystem::Init(m_pContext);
 	RdrAction::InitSharedData(m_pContext, pInputManager);
+	RdrPipelineStateCache::Init();
 
 	Resize(width, height);
 	ApplyDeviceChanges();
@@ -82,6 +93,8 @@ bool Renderer::Init(HWND hWnd, int width, int height, const InputManager* pInput
 void Renderer::Cleanup()
 {
 	// todo: flip frame to finish resource frees.
+	RdrPipelineStateCache::Save();
+
 	ImGui_ImplDX12_Shutdown();
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
@@ -148,54 +161,102 @@ void Renderer::PostFrameSync()
 	}
 
 	//////////////////////////////////////////////////////////////////////////
-	// Clear the data that we just rendered with.
-	RdrFrameState& rActiveState = GetActiveState();
+	// Hand the frame to the render thread and move on to the next state.
+	// The render thread has finished with the next state by the time this returns.
+	uint nQueueState = m_frameSync.SubmitFrame();
+
+	//////////////////////////////////////////////////////////////////////////
+	// Clear the data that the state was last rendered with.
+	RdrFrameState& rQueueState = m_frameStates[nQueueState];
 
 	// Release actions.
-	for (RdrAction* pAction : rActiveState.actions)
+	for (RdrAction* pAction : rQueueState.actions)
 	{
 		pAction->Release();
 	}
 
 	// Clear remaining state data.
-	rActiveState.actions.clear();
+	rQueueState.actions.clear();
 
-	// Swap state
-	m_queueState = !m_queueState;
-	RdrShaderSystem::FlipState();
-	RdrFrameMem::FlipState();
-	RdrInstancedObjectDataBuffer::FlipState();
+	RdrShaderSystem::FlipState(nQueueState);
+	RdrFrameMem::FlipState(nQueueState);
+	RdrInstancedObjectDataBuffer::FlipState(nQueueState);
 
 	m_eLightingMethod = m_ePendingLightingMethod;
 }
 
+void Renderer::StopRenderThread()
+{
+	m_frameSync.Shutdown();
+}
+
+bool Renderer::WaitForFrame()
+{
+	return m_frameSync.BeginRenderFrame(m_activeState);
+}
+
 void Renderer::ProcessReadbackRequests()
 {
 	AutoScopedLock lock(m_readbackMutex);
 
-	uint numRequests = (uint)m_pendingReadbackRequests.size();
-	for (uint i = 0; i < numRequests; ++i)
+	uint64 nFrameNum = m_pContext->GetFrameNum();
+
+	for (uint i = 0; i < m_pendingReadbackRequests.size(); ++i)
 	{
-		RdrResourceReadbackRequest* pRequest = m_readbackRequests.get(m_pendingReadbackRequests[i]);
-		if (pRequest->frameCount == 0)
+		RdrResourceReadbackRequestHandle hRequest = m_pendingReadbackRequests[i];
+		RdrResourceReadbackRequest* pRequest = m_readbackRequests.get(hRequest);
+		if (pRequest->readbackBuffer == RdrReadbackPool::kInvalidBuffer)
 		{
+			pRequest->readbackBuffer = m_readbackPool.Acquire(pRequest->dataSize, m_pContext->GetLastCompletedFrame());
+			if (pRequest->readbackBuffer == RdrReadbackPool::kInvalidBuffer)
+			{
+				RdrResourceHandle hBuffer = RdrResourceSystem::CreateStructuredBuffer(nullptr, 1, RdrReadbackPool::CalcBucketSize(pRequest->dataSize),
+					RdrResourceAccessFlags::CpuRO_GpuRW, CREATE_BACKPOINTER(this));
+				pRequest->readbackBuffer = m_readbackPool.AddBuffer(pRequest->dataSize, hBuffer);
+			}
+
 			const RdrResource* pSrc = RdrResourceSystem::GetResource(pRequest->hSrcResource);
-			const RdrResource* pDst = RdrResourceSystem::GetResource(pRequest->hDstResource);
+			const RdrResource* pDst = RdrResourceSystem::GetResource(m_readbackPool.GetResourceId(pRequest->readbackBuffer));
 			pSrc->CopyResourceRegion(*m_pContext, pRequest->srcRegion, *pDst, IVec3::kZero);
+			pRequest->copyFrame = nFrameNum;
 		}
-		else if (pRequest->frameCount == 3)
+		else if (m_pContext->IsFrameComplete(pRequest->copyFrame))
 		{
-			// After 2 frames, we can safely read from the resource without stalling.
-			const RdrResource* pDst = RdrResourceSystem::GetResource(pRequest->hDstResource);
+			const RdrResource* pDst = RdrResourceSystem::GetResource(m_readbackPool.GetResourceId(pRequest->readbackBuffer));
 			pDst->ReadResource(*m_pContext, pRequest->pData, pRequest->dataSize);
 			pRequest->bComplete = true;
+			m_readbackPool.Release(pRequest->readbackBuffer, pRequest->copyFrame);
+
+			if (pRequest->callback)
+			{
+				m_completedReadbackCallbacks.push_back(hRequest);
+			}
 
 			// Remove from pending list
-			m_pendingReadbackRequests.erase(m_pendingReadbackRequests.begin() + i);
+			m_pendingReadbackRequests[i] = m_pendingReadbackRequests.back();
+			m_pendingReadbackRequests.pop_back();
 			--i;
 		}
+	}
 
-		pRequest->frameCount++;
+	// Callbacks are deferred until the pending list is no longer being modified since they release their request.
+	for (RdrResourceReadbackRequestHandle hRequest : m_completedReadbackCallbacks)
+	{
+		RdrResourceReadbackRequest* pRequest = m_readbackRequests.get(hRequest);
+		pRequest->callback(pRequest->pData, pRequest->dataSize, pRequest->pUserData);
+		ReleaseResourceReadbackRequest(hRequest);
+	}
+	m_completedReadbackCallbacks.clear();
+
+	// Destroy buffers that haven't been needed in a while.
+	if (nFrameNum > kReadbackBufferIdleFrames)
+	{
+		std::vector<uint> evictedResources;
+		m_readbackPool.Trim(nFrameNum - kReadbackBufferIdleFrames, evictedResources);
+		for (uint resourceId : evictedResources)
+		{
+			GetResourceCommandList().ReleaseResource((RdrResourceHandle)resourceId, CREATE_BACKPOINTER(this));
+		}
 	}
 }
 
@@ -234,6 +295,8 @@ void Renderer::DrawFrame()
 	RdrFrameState& rFrameState = GetActiveState();
 
 	m_pContext->BeginFrame();
+	RdrAction::BeginSharedDataFrame(m_pContext);
+	RdrInstancedObjectDataBuffer::BeginFrame(m_activeState);
 
 	// Start the Dear ImGui frame
 	ImGui_ImplDX12_NewFrame();
@@ -243,7 +306,7 @@ void Renderer::DrawFrame()
 	{
 		RDR_PROFILER_CPU_SECTION("ProcessCommands");
 		// Process threaded render commands.
-		RdrShaderSystem::ProcessCommands(m_pContext);
+		RdrShaderSystem::ProcessCommands(m_pContext, m_activeState);
 		rFrameState.resourceCommands.ProcessPreFrameCommands(m_pContext);
 	
 		ProcessReadbackRequests();
@@ -268,61 +331,111 @@ void Renderer::DrawFrame()
 		}
 	}
 
+	// The frame's results are ready to be copied by the next frame.
+	{
+		AutoScopedLock lock(m_readbackMutex);
+		m_pendingReadbackRequests.insert(m_pendingReadbackRequests.end(), rFrameState.readbackRequests.begin(), rFrameState.readbackRequests.end());
+		rFrameState.readbackRequests.clear();
+	}
+
 	DrawCpuProfiler();
 
 	ImGui::Render();
 	ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), m_pContext->GetCommandList());
 
+	const RdrDescriptorAllocator::Stats srvStats = m_pContext->GetSrvHeap().GetStats();
+	m_gpuProfiler.SetCounter(RdrProfileCounter::SrvDescriptorsLive, srvStats.liveDescriptors);
+	m_gpuProfiler.SetCounter(RdrProfileCounter::SrvDescriptorsFree, srvStats.freeDescriptors);
+	m_gpuProfiler.SetCounter(RdrProfileCounter::SrvDescriptorsFragmented, srvStats.fragmentedDescriptors);
+	m_gpuProfiler.SetCounter(RdrProfileCounter::SrvDescriptorsPeak, srvStats.peakLiveDescriptors);
+	m_gpuProfiler.SetCounter(RdrProfileCounter::SrvDescriptorAllocFailures, srvStats.failedAllocations);
+
 	m_gpuProfiler.EndFrame();
 	m_pContext->Present();
 
 	// Process post-frame commands.
 	rFrameState.resourceCommands.ProcessCleanupCommands(m_pContext);
+
+	// Return the state to the main thread.
+	m_frameSync.EndRenderFrame();
 }
 
-RdrResourceReadbackRequestHandle Renderer::IssueTextureReadbackRequest(RdrResourceHandle hResource, const IVec3& pixelCoord)
+RdrResourceReadbackRequestHandle Renderer::IssueTextureReadbackRequest(RdrResourceHandle hResource, const IVec3& pixelCoord,
+	RdrReadbackCallback callback, void* pUserData)
 {
-	RdrResourceReadbackRequest* pReq = m_readbackRequests.alloc();
 	const RdrResource* pSrcResource = RdrResourceSystem::GetResource(hResource);
+
+	AutoScopedLock lock(m_readbackMutex);
+	RdrResourceReadbackRequest* pReq = m_readbackRequests.alloc();
 	pReq->hSrcResource = hResource;
-	pReq->frameCount = 0;
+	pReq->readbackBuffer = RdrReadbackPool::kInvalidBuffer;
+	pReq->copyFrame = 0;
+	pReq->callback = callback;
+	pReq->pUserData = pUserData;
 	pReq->bComplete = false;
 	pReq->srcRegion = RdrBox(pixelCoord.x, pixelCoord.y, 0, 1, 1, 1);
-	pReq->hDstResource = RdrResourceSystem::CreateTexture2D(1, 1, pSrcResource->GetTextureInfo().format,
-		RdrResourceAccessFlags::CpuRO_GpuRW, nullptr, CREATE_BACKPOINTER(this));
 	pReq->dataSize = rdrGetTexturePitch(1, pSrcResource->GetTextureInfo().format);
 	pReq->pData = new char[pReq->dataSize]; // todo: custom heap
 
-	AutoScopedLock lock(m_readbackMutex);
 	RdrResourceReadbackRequestHandle handle = m_readbackRequests.getId(pReq);
-	m_pendingReadbackRequests.push_back(handle);
+	QueueReadbackRequest(handle);
 	return handle;
 }
 
-RdrResourceReadbackRequestHandle Renderer::IssueStructuredBufferReadbackRequest(RdrResourceHandle hResource, uint startByteOffset, uint numBytesToRead)
+RdrResourceReadbackRequestHandle Renderer::IssueStructuredBufferReadbackRequest(RdrResourceHandle hResource, uint startByteOffset, uint numBytesToRead,
+	RdrReadbackCallback callback, void* pUserData)
 {
+	AutoScopedLock lock(m_readbackMutex);
 	RdrResourceReadbackRequest* pReq = m_readbackRequests.alloc();
 	pReq->hSrcResource = hResource;
-	pReq->frameCount = 0;
+	pReq->readbackBuffer = RdrReadbackPool::kInvalidBuffer;
+	pReq->copyFrame = 0;
+	pReq->callback = callback;
+	pReq->pUserData = pUserData;
 	pReq->bComplete = false;
 	pReq->srcRegion = RdrBox(startByteOffset, 0, 0, numBytesToRead, 1, 1);
-	pReq->hDstResource = RdrResourceSystem::CreateStructuredBuffer(nullptr, 1, numBytesToRead, RdrResourceAccessFlags::CpuRO_GpuRW, CREATE_BACKPOINTER(this));
 	pReq->dataSize = numBytesToRead;
 	pReq->pData = new char[numBytesToRead]; // todo: custom heap
 
-	AutoScopedLock lock(m_readbackMutex);
 	RdrResourceReadbackRequestHandle handle = m_readbackRequests.getId(pReq);
-	m_pendingReadbackRequests.push_back(handle);
+	QueueReadbackRequest(handle);
 	return handle;
 }
 
+void Renderer::QueueReadbackRequest(RdrResourceReadbackRequestHandle hRequest)
+{
+	// Copies are recorded at the start of a frame, before its actions draw.  Requests made while queuing a frame on the
+	// main thread wait until that frame has been drawn so they don't read back the results of an earlier frame.
+	if (IsRenderThread())
+	{
+		m_pendingReadbackRequests.push_back(hRequest);
+	}
+	else
+	{
+		GetQueueState().readbackRequests.push_back(hRequest);
+	}
+}
+
+bool Renderer::GetReadbackRequestData(RdrResourceReadbackRequestHandle hRequest, const void** ppOutData, uint* pOutDataSize)
+{
+	AutoScopedLock lock(m_readbackMutex);
+
+	const RdrResourceReadbackRequest* pReq = m_readbackRequests.get(hRequest);
+	if (!pReq->bComplete)
+		return false;
+
+	*ppOutData = pReq->pData;
+	*pOutDataSize = pReq->dataSize;
+	return true;
+}
+
 void Renderer::ReleaseResourceReadbackRequest(RdrResourceReadbackRequestHandle hRequest)
 {
+	AutoScopedLock lock(m_readbackMutex);
+
 	RdrResourceReadbackRequest* pReq = m_readbackRequests.get(hRequest);
 	if (!pReq->bComplete)
 	{
-		AutoScopedLock lock(m_readbackMutex);
-
 		uint numReqs = (uint)m_pendingReadbackRequests.size();
 		for (uint i = 0; i < numReqs; ++i)
 		{
@@ -337,11 +450,28 @@ void Renderer::ReleaseResourceReadbackRequest(RdrResourceReadbackRequestHandle h
 				break;
 			}
 		}
+
+		// Requests issued from the main thread may still be waiting for their frame to be drawn.
+		for (uint i = 0; i < GetNumFrameStates(); ++i)
+		{
+			std::vector<RdrResourceReadbackRequestHandle>& rFrameRequests = m_frameStates[i].readbackRequests;
+			auto iter = std::find(rFrameRequests.begin(), rFrameRequests.end(), hRequest);
+			if (iter != rFrameRequests.end())
+			{
+				rFrameRequests.erase(iter);
+				break;
+			}
+		}
+
+		// The copy may still be in flight, so the buffer can't be reused until the GPU finishes that frame.
+		if (pReq->readbackBuffer != RdrReadbackPool::kInvalidBuffer)
+		{
+			m_readbackPool.Release(pReq->readbackBuffer, pReq->copyFrame);
+		}
 	}
 
-	// todo: pool/reuse dest resources.
-	GetResourceCommandList().ReleaseResource(pReq->hDstResource, CREATE_BACKPOINTER(this));
-	SAFE_DELETE(pReq->pData);
+	delete[] pReq->pData;
+	pReq->pData = nullptr;
 
 	m_readbackRequests.releaseId(hRequest);
 }
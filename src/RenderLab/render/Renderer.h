@@ -8,6 +8,8 @@
 #include "RdrDrawState.h"
 #include "RdrPostProcess.h"
 #include "RdrRequests.h"
+#include "RdrReadbackPool.h"
+#include "RdrFrameSync.h"
 #include "RdrProfiler.h"
 #include "RdrLighting.h"
 #include "RdrSky.h"
@@ -20,6 +22,7 @@ struct RdrFrameState
 {
 	FixedVector<RdrAction*, MAX_ACTIONS_PER_FRAME> actions;
 	RdrResourceCommandList resourceCommands;
+	std::vector<RdrResourceReadbackRequestHandle> readbackRequests; // Issued by the main thread.  Become pending once the frame has been drawn.
 };
 
 // Global pointer to active renderer.
@@ -53,17 +56,35 @@ public:
 
 	RdrResourceCommandList& GetResourceCommandList();
 
-	void DrawFrame();
+	// Main thread.  Finalizes the queued frame and hands it to the render thread.
+	// Only blocks if the render thread hasn't finished any of the other frame states yet.
 	void PostFrameSync();
+	// Main thread.  Makes WaitForFrame() return false so the render thread can exit.
+	void StopRenderThread();
+
+	// Render thread.  Waits for a frame to be queued.  Returns false once the render thread should exit.
+	bool WaitForFrame();
+	void DrawFrame();
+
+	uint GetNumFrameStates() const;
+	RdrFrameSync::Stats GetFrameSyncStats() const;
 
 	int GetViewportWidth() const;
 	int GetViewportHeight() const;
 	Vec2 GetViewportSize() const;
 
-	RdrResourceReadbackRequestHandle IssueTextureReadbackRequest(RdrResourceHandle hResource, const IVec3& pixelCoord);
-	RdrResourceReadbackRequestHandle IssueStructuredBufferReadbackRequest(RdrResourceHandle hResource, uint startByteOffset, uint numBytesToRead);
+	// Readbacks copy the resource as it is at the end of the frame they were issued in, and complete once the GPU has finished the copy.
+	// If a callback is provided, it is called on the render thread when the data is ready and the request is released automatically.
+	// Otherwise poll with GetReadbackRequestData() and release the request when done with it.
+	RdrResourceReadbackRequestHandle IssueTextureReadbackRequest(RdrResourceHandle hResource, const IVec3& pixelCoord,
+		RdrReadbackCallback callback = nullptr, void* pUserData = nullptr);
+	RdrResourceReadbackRequestHandle IssueStructuredBufferReadbackRequest(RdrResourceHandle hResource, uint startByteOffset, uint numBytesToRead,
+		RdrReadbackCallback callback = nullptr, void* pUserData = nullptr);
+	bool GetReadbackRequestData(RdrResourceReadbackRequestHandle hRequest, const void** ppOutData, uint* pOutDataSize);
 	void ReleaseResourceReadbackRequest(RdrResourceReadbackRequestHandle hRequest);
 
+	const RdrReadbackPool::Stats& GetReadbackPoolStats() const;
+
 	void SetLightingMethod(RdrLightingMethod eLightingMethod);
 
 	const RdrGpuProfiler& GetProfiler() const;
@@ -78,6 +99,7 @@ private:
 	RdrFrameState& GetQueueState();
 	RdrFrameState& GetActiveState();
 
+	void QueueReadbackRequest(RdrResourceReadbackRequestHandle hRequest);
 	void ProcessReadbackRequests();
 
 	void DrawCpuProfiler();
@@ -92,8 +114,9 @@ private:
 
 	RdrDrawState m_drawState;
 
-	RdrFrameState m_frameStates[2];
-	uint          m_queueState; // Index of the state being queued to by the main thread. (The other state is the active frame state).
+	RdrFrameState m_frameStates[kMaxFrameStates];
+	RdrFrameSync  m_frameSync; // Tracks the state being queued to by the main thread.
+	uint          m_activeState; // Index of the state being drawn by the render thread.
 
 	int m_viewWidth;
 	int m_viewHeight;
@@ -105,6 +128,8 @@ private:
 
 	RdrResourceReadbackRequestList m_readbackRequests; // Average out to a max of 32 requests per frame
 	std::vector<RdrResourceReadbackRequestHandle> m_pendingReadbackRequests;
+	std::vector<RdrResourceReadbackRequestHandle> m_completedReadbackCallbacks;
+	RdrReadbackPool m_readbackPool;
 	ThreadMutex m_readbackMutex;
 };
 
@@ -125,12 +150,22 @@ inline Vec2 Renderer::GetViewportSize() const
 
 inline RdrFrameState& Renderer::GetQueueState()
 { 
-	return m_frameStates[m_queueState]; 
+	return m_frameStates[m_frameSync.GetQueueState()]; 
 }
 
 inline RdrFrameState& Renderer::GetActiveState()
 { 
-	return m_frameStates[!m_queueState]; 
+	return m_frameStates[m_activeState]; 
+}
+
+inline uint Renderer::GetNumFrameStates() const
+{
+	return m_frameSync.GetNumFrameStates();
+}
+
+inline RdrFrameSync::Stats Renderer::GetFrameSyncStats() const
+{
+	return m_frameSync.GetStats();
 }
 
 inline const RdrGpuProfiler& Renderer::GetProfiler() const
@@ -138,6 +173,11 @@ inline const RdrGpuProfiler& Renderer::GetProfiler() const
 	return m_gpuProfiler;
 }
 
+inline const RdrReadbackPool::Stats& Renderer::GetReadbackPoolStats() const
+{
+	return m_readbackPool.GetStats();
+}
+
 inline RdrLightingMethod Renderer::GetLightingMethod() const
 {
 	return m_eLightingMethod;
@@ -11,23 +11,132 @@ namespace
 {
 	const RdrVertexShader kVertexShader = { RdrVertexShaderType::Terrain, RdrShaderFlags::None };
 	const RdrTessellationShader kTessellationShader = { RdrTessellationShaderType::Terrain, RdrShaderFlags::None };
+	const RdrTessellationShader kDepthTessellationShader = { RdrTessellationShaderType::Terrain, RdrShaderFlags::DepthOnly };
+
+	// Upper limit on patches drawn by a single camera.
+	const uint kMaxPatches = 4096;
+
+	// Fraction of each LOD's range after which it morphs into the next LOD.
+	const float kMorphStartRatio = 0.66f;
 
 	static const RdrVertexInputElement s_terrainVertexDesc[] = {
 		{ RdrShaderSemantic::Position, 0, RdrVertexInputFormat::RG_F32, 0, 0, RdrVertexInputClass::PerVertex, 0 },
 		{ RdrShaderSemantic::Texcoord, 0, RdrVertexInputFormat::RGBA_F32, 1, 0, RdrVertexInputClass::PerInstance, 1 },
 	};
+
+	bool loadTerrainTile(uint nLevel, uint nTileX, uint nTileY, float16* pOutTexels, void* pUserData)
+	{
+		AssetLib::TerrainTileReader* pReader = (AssetLib::TerrainTileReader*)pUserData;
+		return pReader->ReadTile(nLevel, nTileX, nTileY, pOutTexels);
+	}
+
+	void fillDomainConstants(DsTerrain* pConstants, const AssetLib::Terrain& rSrcData, const TerrainClipmap& rClipmap,
+		const TerrainQuadtree& rQuadtree, const Vec3& lodOrigin)
+	{
+		memset(pConstants, 0, sizeof(DsTerrain));
+
+		const AssetLib::TerrainTiles& rLayout = rClipmap.GetLayout();
+		uint levelWidth = rLayout.width;
+		uint levelHeight = rLayout.height;
+		for (uint i = 0; i < rClipmap.GetLevelCount(); ++i)
+		{
+			TerrainClipmapLevel& rLevel = pConstants->clipmapLevels[i];
+			rLevel.size = Vec2((float)levelWidth, (float)levelHeight);
+
+			const TerrainClipmap::Region& rRegion = rClipmap.GetResidentRegion(i);
+			if (rRegion.bValid)
+			{
+				// Bilinear samples need half a texel of margin within the region.  Heightmap edges clamp instead.
+				rLevel.validMin.x = (rRegion.tileMinX == 0) ? -FLT_MAX : rRegion.tileMinX * rLayout.tileSize + 0.5f;
+				rLevel.validMin.y = (rRegion.tileMinY == 0) ? -FLT_MAX : rRegion.tileMinY * rLayout.tileSize + 0.5f;
+				rLevel.validMax.x = (rRegion.tileMaxX == rLayout.levelTilesX[i]) ? FLT_MAX : rRegion.tileMaxX * rLayout.tileSize - 0.5f;
+				rLevel.validMax.y = (rRegion.tileMaxY == rLayout.levelTilesY[i]) ? FLT_MAX : rRegion.tileMaxY * rLayout.tileSize - 0.5f;
+			}
+			else
+			{
+				rLevel.validMin = Vec2(FLT_MAX, FLT_MAX);
+				rLevel.validMax = Vec2(-FLT_MAX, -FLT_MAX);
+			}
+
+			levelWidth = max(levelWidth / 2, 1u);
+			levelHeight = max(levelHeight / 2, 1u);
+		}
+
+		for (uint i = 0; i < TERRAIN_MAX_LODS; ++i)
+		{
+			float morphStart = rQuadtree.GetMorphStart(i);
+			float morphEnd = rQuadtree.GetMorphEnd(i);
+			pConstants->lodMorphRanges[i] = Vec4(morphStart, 1.f / max(morphEnd - morphStart, 0.0001f), 0.f, 0.f);
+		}
+
+		pConstants->lodOrigin = lodOrigin;
+		pConstants->gridOrigin = rSrcData.cornerMin;
+		pConstants->heightmapTexelsPerUnit.x = rLayout.width / (rSrcData.cornerMax.x - rSrcData.cornerMin.x);
+		pConstants->heightmapTexelsPerUnit.y = rLayout.height / (rSrcData.cornerMax.y - rSrcData.cornerMin.y);
+		pConstants->heightScale = rSrcData.heightScale;
+		pConstants->clipmapRingTexelsRcp = 1.f / rClipmap.GetRingTexelSize();
+		pConstants->numClipmapLevels = rClipmap.GetLevelCount();
+	}
 }
 
+static_assert(TerrainQuadtree::kMaxLods == TERRAIN_MAX_LODS, "Terrain LOD count doesn't match the shaders!");
+static_assert(TerrainClipmap::kMaxLevels == TERRAIN_MAX_CLIPMAP_LEVELS, "Terrain clipmap level count doesn't match the shaders!");
+
 Terrain::Terrain()
-	: m_initialized(false)
+	: m_hClipmapTexture(0)
+	, m_clipmapTextureSlices(0)
+	, m_maxPatches(0)
+	, m_hGeo(0)
+	, m_initialized(false)
+{
+	for (uint i = 0; i < kNumInstanceBuffers; ++i)
+	{
+		m_ahInstanceBuffers[i] = 0;
+	}
+}
+
+bool Terrain::BuildQuadtree()
 {
+	// Node height bounds come from the finest level's tile bounds so no height data needs to be resident.
+	if (!m_tileReader.Open(m_srcData.heightmapName.getString()))
+		return false;
+
+	const AssetLib::TerrainTiles& rLayout = m_tileReader.GetLayout();
+	uint tilesX = rLayout.levelTilesX[0];
+	uint tilesY = rLayout.levelTilesY[0];
+	std::vector<float> minHeights(tilesX * tilesY);
+	std::vector<float> maxHeights(tilesX * tilesY);
+	for (uint y = 0; y < tilesY; ++y)
+	{
+		for (uint x = 0; x < tilesX; ++x)
+		{
+			m_tileReader.GetTileBounds(0, x, y, &minHeights[x + y * tilesX], &maxHeights[x + y * tilesX]);
+		}
+	}
 
+	Vec2 tileWorldSize;
+	tileWorldSize.x = (m_srcData.cornerMax.x - m_srcData.cornerMin.x) * rLayout.tileSize / rLayout.width;
+	tileWorldSize.y = (m_srcData.cornerMax.y - m_srcData.cornerMin.y) * rLayout.tileSize / rLayout.height;
+
+	m_quadtree.Build(minHeights.data(), maxHeights.data(), tilesX, tilesY, tileWorldSize,
+		m_srcData.cornerMin, m_srcData.cornerMax, m_srcData.heightScale, TERRAIN_LEAF_SIZE);
+	return (m_quadtree.GetLodCount() > 0);
 }
 
 void Terrain::Init(const AssetLib::Terrain& rTerrainAsset)
 {
-	m_initialized = true;
+	Cleanup();
+
 	m_srcData = rTerrainAsset;
+	if (!BuildQuadtree())
+	{
+		Warning("Failed to build terrain quadtree from heightmap tiles %s", m_srcData.heightmapName.getString());
+		m_tileReader.Close();
+		return;
+	}
+
+	m_initialized = true;
+	m_quadtree.SetLodRanges(g_debugState.terrainLodDistance, kMorphStartRatio);
 
 	Vec2* aVertices = (Vec2*)RdrFrameMem::AllocAligned(sizeof(Vec2) * 4, 16);
 	aVertices[0] = Vec2(0.f, 0.f);
@@ -41,26 +150,15 @@ void Terrain::Init(const AssetLib::Terrain& rTerrainAsset)
 		RdrTopology::Quad, Vec3(0.f, 0.f, 0.f), Vec3(1.f, 0.f, 1.f),
 		CREATE_BACKPOINTER(this));
 
-	// Instance buffer
-	float cellSize = 16.f;
-	m_gridSize.x = (uint)((m_srcData.cornerMax.x - m_srcData.cornerMin.x) / cellSize);
-	m_gridSize.y = (uint)((m_srcData.cornerMax.y - m_srcData.cornerMin.y) / cellSize);
-	Vec4* aInstanceData = (Vec4*)RdrFrameMem::AllocAligned(sizeof(Vec4) * m_gridSize.x * m_gridSize.y, 16);
-	for (uint x = 0; x < m_gridSize.x; ++x)
+	// Patch instance buffers.  Filled each frame with the selected (minX, minZ, size, lod) patches.
+	m_maxPatches = min(m_quadtree.GetLeafCount(), kMaxPatches);
+	for (uint i = 0; i < kNumInstanceBuffers; ++i)
 	{
-		for (uint y = 0; y < m_gridSize.y; ++y)
-		{
-			aInstanceData[x + y * (int)m_gridSize.x] = Vec4(
-				m_srcData.cornerMin.x + x * cellSize, 
-				m_srcData.cornerMin.y + y * cellSize,
-				cellSize, 
-				0.f);
-		}
+		m_ahInstanceBuffers[i] = RdrResourceSystem::CreateVertexBuffer(nullptr
+			, sizeof(Vec4), m_maxPatches
+			, RdrResourceAccessFlags::CpuRW_GpuRO
+			, CREATE_BACKPOINTER(this));
 	}
-	m_hInstanceData = RdrResourceSystem::CreateVertexBuffer(aInstanceData
-		, sizeof(aInstanceData[0]), m_gridSize.x * m_gridSize.y
-		, RdrResourceAccessFlags::None
-		, CREATE_BACKPOINTER(this));
 
 	// Create shaders
 	const RdrResourceFormat* pRtvFormats;
@@ -92,6 +190,25 @@ void Terrain::Init(const AssetLib::Terrain& rTerrainAsset)
 		rasterState,
 		RdrDepthStencilState(true, true, RdrComparisonFunc::LessEqual));
 
+	// Shadows
+	RdrVertexShader depthVertexShader = kVertexShader;
+	depthVertexShader.flags |= RdrShaderFlags::DepthOnly;
+
+	Renderer::GetStageRenderTargetFormats(RdrRenderStage::kShadowMap, &pRtvFormats, &nNumRtvFormats);
+
+	rasterState.bDoubleSided = true;
+	rasterState.bEnableMSAA = false;
+	rasterState.bUseSlopeScaledDepthBias = true;
+
+	m_material.CreateTessellationPipelineState(RdrShaderMode::ShadowMap,
+		depthVertexShader, nullptr,
+		RdrShaderSystem::GetHullShader(kDepthTessellationShader), RdrShaderSystem::GetDomainShader(kDepthTessellationShader),
+		s_terrainVertexDesc, ARRAY_SIZE(s_terrainVertexDesc),
+		pRtvFormats, nNumRtvFormats,
+		RdrBlendMode::kOpaque,
+		rasterState,
+		RdrDepthStencilState(true, true, RdrComparisonFunc::Less));
+
 	RdrResourceHandle ahTextures[2];
 	ahTextures[0] = RdrResourceSystem::CreateTextureFromFile("white", nullptr, CREATE_BACKPOINTER(this));
 	ahTextures[1] = RdrResourceSystem::CreateTextureFromFile("flat_ddn", nullptr, CREATE_BACKPOINTER(this));
@@ -101,20 +218,20 @@ void Terrain::Init(const AssetLib::Terrain& rTerrainAsset)
 	m_material.SetSamplers(0, 1, &sampler);
 
 	// Tessellation
-	RdrTextureInfo heightmapTexInfo;
-	RdrResourceHandle hHeightmapTexture = RdrResourceSystem::CreateTextureFromFile(m_srcData.heightmapName, &heightmapTexInfo, CREATE_BACKPOINTER(this));
-	m_material.SetTessellationTextures(0, 1, &hHeightmapTexture);
+	m_clipmap.Init(m_tileReader.GetLayout(), loadTerrainTile, &m_tileReader, true);
+
+	// Array textures need at least two slices to be viewed as an array.
+	uint ringTexels = m_clipmap.GetRingTexelSize();
+	m_clipmapTextureSlices = max(m_clipmap.GetLevelCount(), 2u);
+	m_hClipmapTexture = RdrResourceSystem::CreateTexture2DArray(ringTexels, ringTexels, m_clipmapTextureSlices,
+		RdrResourceFormat::R16_FLOAT, RdrResourceAccessFlags::CpuRO_GpuRO, CREATE_BACKPOINTER(this));
+	m_material.SetTessellationTextures(0, 1, &m_hClipmapTexture);
 
-	RdrSamplerState heightmapSampler(RdrComparisonFunc::Never, RdrTexCoordMode::Clamp, false);
+	RdrSamplerState heightmapSampler(RdrComparisonFunc::Never, RdrTexCoordMode::Wrap, false);
 	m_material.SetTessellationSamplers(0, 1, &heightmapSampler);
-	m_heightmapSize = UVec2(heightmapTexInfo.width, heightmapTexInfo.height);
 
 	DsTerrain* pDsConstants = (DsTerrain*)RdrFrameMem::AllocAligned(sizeof(DsTerrain), 16);
-	pDsConstants->lods[0].minPos = m_srcData.cornerMin;
-	pDsConstants->lods[0].size = (m_srcData.cornerMax - m_srcData.cornerMin);
-	pDsConstants->heightmapTexelSize.x = 1.f / m_heightmapSize.x;
-	pDsConstants->heightmapTexelSize.y = 1.f / m_heightmapSize.y;
-	pDsConstants->heightScale = m_srcData.heightScale;
+	fillDomainConstants(pDsConstants, m_srcData, m_clipmap, m_quadtree, Vec3::kZero);
 
 	m_material.FillTessellationConstantBuffer(pDsConstants, sizeof(DsTerrain), RdrResourceAccessFlags::CpuRW_GpuRO, CREATE_BACKPOINTER(this));
 }
@@ -122,20 +239,94 @@ void Terrain::Init(const AssetLib::Terrain& rTerrainAsset)
 RdrDrawOpSet Terrain::BuildDrawOps(RdrAction* pAction)
 {
 	// TODO: Remaining terrain tasks:
-	//	* Update instance buffer with LOD cells culled to the camera
-	//	* Terrain shadows
-	//	* Clipmapped height data
 	//	* Materials
 	if (!m_initialized)
 		return RdrDrawOpSet();
 
+	const Camera& rCamera = pAction->GetCamera();
+	UpdateClipmap(rCamera);
+
+	m_quadtree.SetLodRanges(g_debugState.terrainLodDistance, kMorphStartRatio);
+
+	// Morph ranges are measured from the scene camera in every pass.
+	DsTerrain* pDsConstants = (DsTerrain*)RdrFrameMem::AllocAligned(sizeof(DsTerrain), 16);
+	fillDomainConstants(pDsConstants, m_srcData, m_clipmap, m_quadtree, rCamera.GetPosition());
+	g_pRenderer->GetResourceCommandList().UpdateConstantBuffer(m_material.GetTessellationData().hDsConstants,
+		pDsConstants, sizeof(DsTerrain), CREATE_BACKPOINTER(this));
+
+	return BuildPatchDrawOp(rCamera, rCamera.GetPosition(), 0);
+}
+
+void Terrain::Cleanup()
+{
+	m_clipmap.Shutdown();
+	m_tileReader.Close();
+
+	if (m_hClipmapTexture)
+	{
+		g_pRenderer->GetResourceCommandList().ReleaseResource(m_hClipmapTexture, CREATE_BACKPOINTER(this));
+		m_hClipmapTexture = 0;
+	}
+
+	m_initialized = false;
+}
+
+void Terrain::UpdateClipmap(const Camera& rCamera)
+{
+	const AssetLib::TerrainTiles& rLayout = m_clipmap.GetLayout();
+	const Vec3& cameraPos = rCamera.GetPosition();
+
+	Vec2 centerTexel;
+	centerTexel.x = (cameraPos.x - m_srcData.cornerMin.x) / (m_srcData.cornerMax.x - m_srcData.cornerMin.x) * rLayout.width;
+	centerTexel.y = (cameraPos.z - m_srcData.cornerMin.y) / (m_srcData.cornerMax.y - m_srcData.cornerMin.y) * rLayout.height;
+	m_clipmap.Update(centerTexel);
+
+	if (!m_clipmap.ProcessCompletedLoads())
+		return;
+
+	// Only the ring slots that received a tile are uploaded.
+	uint tileSize = rLayout.tileSize;
+	uint ringTexels = m_clipmap.GetRingTexelSize();
+	const float16* pClipmapTexels = m_clipmap.GetTexels();
+	for (const TerrainClipmap::SlotUpdate& rSlot : m_clipmap.GetUpdatedSlots())
+	{
+		float16* pTexels = (float16*)RdrFrameMem::AllocAligned(tileSize * tileSize * sizeof(float16), 16);
+		const float16* pSrc = pClipmapTexels + rSlot.level * ringTexels * ringTexels + rSlot.slotY * tileSize * ringTexels + rSlot.slotX * tileSize;
+		for (uint y = 0; y < tileSize; ++y)
+		{
+			memcpy(pTexels + y * tileSize, pSrc + y * ringTexels, tileSize * sizeof(float16));
+		}
+
+		RdrBox region(rSlot.slotX * tileSize, rSlot.slotY * tileSize, 0, tileSize, tileSize, 1);
+		g_pRenderer->GetResourceCommandList().UpdateTextureRegion(m_hClipmapTexture, rSlot.level, region, pTexels, CREATE_BACKPOINTER(this));
+	}
+}
+
+RdrDrawOpSet Terrain::BuildShadowDrawOps(RdrAction* pAction, int shadowPassIndex)
+{
+	if (!m_initialized || !g_debugState.terrainShadows)
+		return RdrDrawOpSet();
+
+	// Patches are culled to the shadow camera but keep the scene camera's LODs so shadows match the visible surface.
+	return BuildPatchDrawOp(pAction->GetShadowCamera(shadowPassIndex), pAction->GetCamera().GetPosition(), 1 + shadowPassIndex);
+}
+
+RdrDrawOpSet Terrain::BuildPatchDrawOp(const Camera& rCullCamera, const Vec3& lodOrigin, uint nInstanceBuffer)
+{
+	Vec4* aPatches = (Vec4*)RdrFrameMem::AllocAligned(sizeof(Vec4) * m_maxPatches, 16);
+	uint numPatches = m_quadtree.Select(rCullCamera, lodOrigin, aPatches, m_maxPatches);
+	if (numPatches == 0)
+		return RdrDrawOpSet();
+
+	g_pRenderer->GetResourceCommandList().UpdateBuffer(m_ahInstanceBuffers[nInstanceBuffer], aPatches, numPatches, CREATE_BACKPOINTER(this));
+
 	//////////////////////////////////////////////////////////////////////////
 	// Fill out the draw op
 	RdrDrawOp* pDrawOp = RdrFrameMem::AllocDrawOp(CREATE_BACKPOINTER(this));
 	pDrawOp->hGeo = m_hGeo;
-	pDrawOp->hCustomInstanceBuffer = m_hInstanceData;
+	pDrawOp->hCustomInstanceBuffer = m_ahInstanceBuffers[nInstanceBuffer];
 	pDrawOp->pMaterial = &m_material;
-	pDrawOp->instanceCount = m_gridSize.x * m_gridSize.y;
+	pDrawOp->instanceCount = numPatches;
 
 	return RdrDrawOpSet(pDrawOp, 1);
-}
\ No newline at end of file
+}
@@ -6,6 +6,9 @@
 #include "RdrGeometry.h"
 #include "RdrMaterial.h"
 #include "RdrDrawOp.h"
+#include "RdrLighting.h"
+#include "TerrainQuadtree.h"
+#include "TerrainClipmap.h"
 
 class RdrAction;
 class Camera;
@@ -16,18 +19,35 @@ public:
 	Terrain();
 
 	void Init(const AssetLib::Terrain& rTerrainAsset);
+	void Cleanup();
+
 	RdrDrawOpSet BuildDrawOps(RdrAction* pAction);
+	RdrDrawOpSet BuildShadowDrawOps(RdrAction* pAction, int shadowPassIndex);
+
+private:
+	bool BuildQuadtree();
+	void UpdateClipmap(const Camera& rCamera);
+	RdrDrawOpSet BuildPatchDrawOp(const Camera& rCullCamera, const Vec3& lodOrigin, uint nInstanceBuffer);
 
 private:
+	// One patch instance buffer for the scene camera and one for each shadow pass.
+	static const uint kNumInstanceBuffers = 1 + MAX_SHADOW_MAPS_PER_FRAME;
+
 	AssetLib::Terrain m_srcData;
-	UVec2 m_gridSize;
-	UVec2 m_heightmapSize;
+
+	// Height data streams in from the terrain tiles file around the camera.
+	AssetLib::TerrainTileReader m_tileReader;
+	TerrainClipmap m_clipmap;
+	RdrResourceHandle m_hClipmapTexture;
+	uint m_clipmapTextureSlices;
+
+	TerrainQuadtree m_quadtree;
+	uint m_maxPatches;
 
 	RdrMaterial m_material;
 
 	RdrGeoHandle m_hGeo;
-	RdrResourceHandle m_hInstanceData;
-	RdrConstantBufferHandle m_hDomainConstants;
+	RdrResourceHandle m_ahInstanceBuffers[kNumInstanceBuffers];
 
 	bool m_initialized;
 };
@@ -0,0 +1,347 @@
+#include "Precompiled.h"
+#include "TerrainClipmap.h"
+#include <algorithm>
+
+namespace
+{
+	const uint kInvalidTile = (uint)-1;
+
+	struct LoadCandidate
+	{
+		uint level;
+		uint tileX;
+		uint tileY;
+		float distSqr;
+	};
+
+	bool compareCandidates(const LoadCandidate& rLeft, const LoadCandidate& rRight)
+	{
+		if (rLeft.level != rRight.level)
+			return rLeft.level > rRight.level;
+		return rLeft.distSqr < rRight.distSqr;
+	}
+}
+
+TerrainClipmap::TerrainClipmap()
+	: m_loadFunc(nullptr)
+	, m_pLoadUserData(nullptr)
+	, m_numPendingLoads(0)
+	, m_numCompletedLoads(0)
+	, m_numDiscardedLoads(0)
+	, m_bAsync(false)
+	, m_bShutdown(false)
+{
+	memset(&m_layout, 0, sizeof(m_layout));
+	memset(m_levels, 0, sizeof(m_levels));
+}
+
+TerrainClipmap::~TerrainClipmap()
+{
+	Shutdown();
+}
+
+void TerrainClipmap::Init(const AssetLib::TerrainTiles& rLayout, TileLoadFunc loadFunc, void* pUserData, bool bAsync)
+{
+	Shutdown();
+
+	m_layout = rLayout;
+	m_loadFunc = loadFunc;
+	m_pLoadUserData = pUserData;
+	m_numPendingLoads = 0;
+	m_numCompletedLoads = 0;
+	m_numDiscardedLoads = 0;
+
+	uint ringTexels = GetRingTexelSize();
+	m_texels.assign(m_layout.numLevels * ringTexels * ringTexels, 0);
+	m_updatedSlots.clear();
+
+	for (uint nLevel = 0; nLevel < kMaxLevels; ++nLevel)
+	{
+		Level& rLevel = m_levels[nLevel];
+		rLevel.windowMinX = 0;
+		rLevel.windowMinY = 0;
+		rLevel.windowSizeX = 0;
+		rLevel.windowSizeY = 0;
+		rLevel.resident.bValid = false;
+		for (Slot& rSlot : rLevel.slots)
+		{
+			rSlot.tileX = kInvalidTile;
+			rSlot.tileY = kInvalidTile;
+			rSlot.eState = SlotState::kEmpty;
+		}
+	}
+
+	m_bAsync = bAsync;
+	m_bShutdown = false;
+	if (m_bAsync)
+	{
+		m_streamingThread = std::thread(&TerrainClipmap::StreamingThreadMain, this);
+	}
+}
+
+void TerrainClipmap::Shutdown()
+{
+	if (m_streamingThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bShutdown = true;
+		}
+		m_requestCondition.notify_all();
+		m_streamingThread.join();
+	}
+
+	m_requests.clear();
+	m_results.clear();
+	m_numPendingLoads = 0;
+	m_layout.numLevels = 0;
+}
+
+TerrainClipmap::Slot& TerrainClipmap::GetSlot(uint nLevel, uint nTileX, uint nTileY)
+{
+	return m_levels[nLevel].slots[(nTileX % kRingTiles) + (nTileY % kRingTiles) * kRingTiles];
+}
+
+const TerrainClipmap::Slot& TerrainClipmap::GetSlot(uint nLevel, uint nTileX, uint nTileY) const
+{
+	return m_levels[nLevel].slots[(nTileX % kRingTiles) + (nTileY % kRingTiles) * kRingTiles];
+}
+
+bool TerrainClipmap::IsTileResident(uint nLevel, uint nTileX, uint nTileY) const
+{
+	const Slot& rSlot = GetSlot(nLevel, nTileX, nTileY);
+	return rSlot.tileX == nTileX && rSlot.tileY == nTileY && rSlot.eState == SlotState::kResident;
+}
+
+void TerrainClipmap::Update(const Vec2& centerTexel)
+{
+	for (uint nLevel = 0; nLevel < m_layout.numLevels; ++nLevel)
+	{
+		UpdateWindow(nLevel, centerTexel);
+		UpdateResidentRegion(nLevel);
+	}
+
+	QueueLoads();
+}
+
+void TerrainClipmap::UpdateWindow(uint nLevel, const Vec2& centerTexel)
+{
+	Level& rLevel = m_levels[nLevel];
+	uint tilesX = m_layout.levelTilesX[nLevel];
+	uint tilesY = m_layout.levelTilesY[nLevel];
+	rLevel.windowSizeX = std::min(tilesX, kRingTiles);
+	rLevel.windowSizeY = std::min(tilesY, kRingTiles);
+
+	// Center the window on the tile containing the camera, clamped to the edges of the level.
+	float levelScale = 1.f / (m_layout.tileSize * (1 << nLevel));
+	int minX = (int)floorf(centerTexel.x * levelScale - rLevel.windowSizeX * 0.5f + 0.5f);
+	int minY = (int)floorf(centerTexel.y * levelScale - rLevel.windowSizeY * 0.5f + 0.5f);
+	rLevel.windowMinX = (uint)std::max(std::min(minX, (int)(tilesX - rLevel.windowSizeX)), 0);
+	rLevel.windowMinY = (uint)std::max(std::min(minY, (int)(tilesY - rLevel.windowSizeY)), 0);
+
+	// Reassign slots whose tile left the window.  Loads already in flight for the old tile are discarded when they finish.
+	for (uint y = rLevel.windowMinY; y < rLevel.windowMinY + rLevel.windowSizeY; ++y)
+	{
+		for (uint x = rLevel.windowMinX; x < rLevel.windowMinX + rLevel.windowSizeX; ++x)
+		{
+			Slot& rSlot = GetSlot(nLevel, x, y);
+			if (rSlot.tileX != x || rSlot.tileY != y)
+			{
+				rSlot.tileX = x;
+				rSlot.tileY = y;
+				rSlot.eState = SlotState::kEmpty;
+			}
+		}
+	}
+}
+
+void TerrainClipmap::UpdateResidentRegion(uint nLevel)
+{
+	Level& rLevel = m_levels[nLevel];
+	Region& rRegion = rLevel.resident;
+
+	uint windowMaxX = rLevel.windowMinX + rLevel.windowSizeX;
+	uint windowMaxY = rLevel.windowMinY + rLevel.windowSizeY;
+
+	bool bWindowResident = true;
+	for (uint y = rLevel.windowMinY; y < windowMaxY && bWindowResident; ++y)
+	{
+		for (uint x = rLevel.windowMinX; x < windowMaxX; ++x)
+		{
+			if (!IsTileResident(nLevel, x, y))
+			{
+				bWindowResident = false;
+				break;
+			}
+		}
+	}
+
+	if (bWindowResident)
+	{
+		rRegion.tileMinX = rLevel.windowMinX;
+		rRegion.tileMinY = rLevel.windowMinY;
+		rRegion.tileMaxX = windowMaxX;
+		rRegion.tileMaxY = windowMaxY;
+		rRegion.bValid = true;
+	}
+	else if (rRegion.bValid)
+	{
+		// Tiles that stayed within the window keep their slots, so the overlap with the old region is still resident.
+		rRegion.tileMinX = std::max(rRegion.tileMinX, rLevel.windowMinX);
+		rRegion.tileMinY = std::max(rRegion.tileMinY, rLevel.windowMinY);
+		rRegion.tileMaxX = std::min(rRegion.tileMaxX, windowMaxX);
+		rRegion.tileMaxY = std::min(rRegion.tileMaxY, windowMaxY);
+		rRegion.bValid = (rRegion.tileMinX < rRegion.tileMaxX && rRegion.tileMinY < rRegion.tileMaxY);
+	}
+}
+
+void TerrainClipmap::QueueLoads()
+{
+	if (m_numPendingLoads >= kMaxPendingLoads)
+		return;
+
+	std::vector<LoadCandidate> candidates;
+	for (uint nLevel = 0; nLevel < m_layout.numLevels; ++nLevel)
+	{
+		const Level& rLevel = m_levels[nLevel];
+		float centerX = rLevel.windowMinX + rLevel.windowSizeX * 0.5f;
+		float centerY = rLevel.windowMinY + rLevel.windowSizeY * 0.5f;
+
+		for (uint y = rLevel.windowMinY; y < rLevel.windowMinY + rLevel.windowSizeY; ++y)
+		{
+			for (uint x = rLevel.windowMinX; x < rLevel.windowMinX + rLevel.windowSizeX; ++x)
+			{
+				if (GetSlot(nLevel, x, y).eState != SlotState::kEmpty)
+					continue;
+
+				float dx = x + 0.5f - centerX;
+				float dy = y + 0.5f - centerY;
+				LoadCandidate candidate = { nLevel, x, y, dx * dx + dy * dy };
+				candidates.push_back(candidate);
+			}
+		}
+	}
+
+	uint numLoads = std::min((uint)candidates.size(), kMaxPendingLoads - m_numPendingLoads);
+	std::partial_sort(candidates.begin(), candidates.begin() + numLoads, candidates.end(), compareCandidates);
+
+	for (uint i = 0; i < numLoads; ++i)
+	{
+		const LoadCandidate& rCandidate = candidates[i];
+		GetSlot(rCandidate.level, rCandidate.tileX, rCandidate.tileY).eState = SlotState::kLoading;
+		++m_numPendingLoads;
+
+		LoadRequest request = { rCandidate.level, rCandidate.tileX, rCandidate.tileY };
+		if (m_bAsync)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_requests.push_back(request);
+		}
+		else
+		{
+			m_results.emplace_back();
+			LoadTile(request, m_results.back());
+		}
+	}
+
+	if (m_bAsync && numLoads > 0)
+	{
+		m_requestCondition.notify_one();
+	}
+}
+
+void TerrainClipmap::LoadTile(const LoadRequest& rRequest, LoadResult& rOutResult)
+{
+	rOutResult.request = rRequest;
+	rOutResult.texels.resize(m_layout.tileSize * m_layout.tileSize);
+	rOutResult.bSucceeded = m_loadFunc(rRequest.level, rRequest.tileX, rRequest.tileY, rOutResult.texels.data(), m_pLoadUserData);
+}
+
+bool TerrainClipmap::ProcessCompletedLoads()
+{
+	m_updatedSlots.clear();
+
+	std::vector<LoadResult> results;
+	if (m_bAsync)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		results.swap(m_results);
+	}
+	else
+	{
+		results.swap(m_results);
+	}
+
+	if (results.empty())
+		return false;
+
+	uint tileSize = m_layout.tileSize;
+	uint ringTexels = GetRingTexelSize();
+	bool bChanged = false;
+	for (const LoadResult& rResult : results)
+	{
+		--m_numPendingLoads;
+
+		const LoadRequest& rRequest = rResult.request;
+		Slot& rSlot = GetSlot(rRequest.level, rRequest.tileX, rRequest.tileY);
+		if (rSlot.tileX != rRequest.tileX || rSlot.tileY != rRequest.tileY || rSlot.eState != SlotState::kLoading)
+		{
+			++m_numDiscardedLoads;
+			continue;
+		}
+
+		// Failed tiles are still marked resident so a bad file doesn't keep the rest of the level from streaming in.
+		if (rResult.bSucceeded)
+		{
+			float16* pDst = m_texels.data() + rRequest.level * ringTexels * ringTexels
+				+ (rRequest.tileY % kRingTiles) * tileSize * ringTexels
+				+ (rRequest.tileX % kRingTiles) * tileSize;
+			for (uint y = 0; y < tileSize; ++y)
+			{
+				memcpy(pDst + y * ringTexels, rResult.texels.data() + y * tileSize, tileSize * sizeof(float16));
+			}
+
+			SlotUpdate update = { rRequest.level, rRequest.tileX % kRingTiles, rRequest.tileY % kRingTiles };
+			m_updatedSlots.push_back(update);
+		}
+		else
+		{
+			Warning("Failed to load terrain tile %d (%d, %d)", rRequest.level, rRequest.tileX, rRequest.tileY);
+		}
+
+		rSlot.eState = SlotState::kResident;
+		++m_numCompletedLoads;
+		bChanged = true;
+	}
+
+	for (uint nLevel = 0; nLevel < m_layout.numLevels; ++nLevel)
+	{
+		UpdateResidentRegion(nLevel);
+	}
+
+	// Refill the queue as soon as there is room rather than waiting for the next update.
+	QueueLoads();
+
+	return bChanged;
+}
+
+void TerrainClipmap::StreamingThreadMain()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_requestCondition.wait(lock, [this] { return m_bShutdown || !m_requests.empty(); });
+		if (m_bShutdown)
+			break;
+
+		LoadRequest request = m_requests.front();
+		m_requests.pop_front();
+
+		lock.unlock();
+		LoadResult result;
+		LoadTile(request, result);
+		lock.lock();
+
+		m_results.push_back(std::move(result));
+	}
+}
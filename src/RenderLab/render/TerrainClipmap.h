@@ -0,0 +1,188 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include "AssetLib/TerrainTilesAsset.h"
+
+// Streams nested rings of heightmap tiles around the camera.
+// Level L keeps a window of up to kRingTiles x kRingTiles tiles from mip L of a terrain tiles file, so each
+// level covers twice the area of the previous one at half the resolution.
+// Tiles are stored toroidally: tile (x, y) always lives in ring slot (x % kRingTiles, y % kRingTiles).  Recentering
+// only loads the tiles that entered a window and the level texels can be sampled directly with wrap addressing.
+// Has no renderer dependencies so residency and scheduling can be tested with a simulated camera.
+class TerrainClipmap
+{
+public:
+	static const uint kMaxLevels = AssetLib::TerrainTiles::kMaxLevels;
+	static const uint kRingTiles = 8;
+	static const uint kMaxPendingLoads = 16;
+
+	// Reads a tile's tileSize * tileSize texels.  Called from the streaming thread when loads are asynchronous.
+	typedef bool (*TileLoadFunc)(uint nLevel, uint nTileX, uint nTileY, float16* pOutTexels, void* pUserData);
+
+	// Tile rectangle of a level where every tile is resident.  Max is exclusive.
+	struct Region
+	{
+		uint tileMinX;
+		uint tileMinY;
+		uint tileMaxX;
+		uint tileMaxY;
+		bool bValid;
+	};
+
+	// Ring slot of a level whose texels were replaced by a tile.
+	struct SlotUpdate
+	{
+		uint level;
+		uint slotX;
+		uint slotY;
+	};
+
+	TerrainClipmap();
+	~TerrainClipmap();
+
+	// Synchronous clipmaps load tiles within Update(), which keeps tests deterministic.
+	void Init(const AssetLib::TerrainTiles& rLayout, TileLoadFunc loadFunc, void* pUserData, bool bAsync);
+	void Shutdown();
+
+	// Recenters each level's window on a position in finest level texels and queues loads for tiles that entered it.
+	// Coarse levels are requested first so there is always something to sample, then tiles closest to the center.
+	void Update(const Vec2& centerTexel);
+
+	// Copies finished loads into the level texels.  Returns true if any texels changed.
+	bool ProcessCompletedLoads();
+
+	// Slots whose texels changed in the last call to ProcessCompletedLoads().
+	const std::vector<SlotUpdate>& GetUpdatedSlots() const;
+
+	uint GetLevelCount() const;
+	uint GetRingTexelSize() const;
+	const AssetLib::TerrainTiles& GetLayout() const;
+
+	// All levels' ring texels, one GetRingTexelSize()^2 slice per level.
+	const float16* GetTexels() const;
+
+	const Region& GetResidentRegion(uint nLevel) const;
+	bool IsTileResident(uint nLevel, uint nTileX, uint nTileY) const;
+
+	uint GetPendingLoadCount() const;
+	uint GetCompletedLoadCount() const;
+	uint GetDiscardedLoadCount() const;
+
+private:
+	enum class SlotState : uint8
+	{
+		kEmpty,		// Assigned a tile that hasn't been requested yet.
+		kLoading,
+		kResident,
+	};
+
+	struct Slot
+	{
+		uint tileX;
+		uint tileY;
+		SlotState eState;
+	};
+
+	struct Level
+	{
+		uint windowMinX;
+		uint windowMinY;
+		uint windowSizeX;
+		uint windowSizeY;
+		Slot slots[kRingTiles * kRingTiles];
+		Region resident;
+	};
+
+	struct LoadRequest
+	{
+		uint level;
+		uint tileX;
+		uint tileY;
+	};
+
+	struct LoadResult
+	{
+		LoadRequest request;
+		std::vector<float16> texels;
+		bool bSucceeded;
+	};
+
+	Slot& GetSlot(uint nLevel, uint nTileX, uint nTileY);
+	const Slot& GetSlot(uint nLevel, uint nTileX, uint nTileY) const;
+
+	void UpdateWindow(uint nLevel, const Vec2& centerTexel);
+	void UpdateResidentRegion(uint nLevel);
+	void QueueLoads();
+	void LoadTile(const LoadRequest& rRequest, LoadResult& rOutResult);
+
+	void StreamingThreadMain();
+
+private:
+	AssetLib::TerrainTiles m_layout;
+	Level m_levels[kMaxLevels];
+	std::vector<float16> m_texels;
+	std::vector<SlotUpdate> m_updatedSlots;
+
+	TileLoadFunc m_loadFunc;
+	void* m_pLoadUserData;
+	uint m_numPendingLoads;
+	uint m_numCompletedLoads;
+	uint m_numDiscardedLoads;
+
+	// Streaming thread state.  Requests and results are guarded by m_mutex.
+	std::thread m_streamingThread;
+	std::mutex m_mutex;
+	std::condition_variable m_requestCondition;
+	std::deque<LoadRequest> m_requests;
+	std::vector<LoadResult> m_results;
+	bool m_bAsync;
+	bool m_bShutdown;
+};
+
+inline uint TerrainClipmap::GetLevelCount() const
+{
+	return m_layout.numLevels;
+}
+
+inline uint TerrainClipmap::GetRingTexelSize() const
+{
+	return kRingTiles * m_layout.tileSize;
+}
+
+inline const AssetLib::TerrainTiles& TerrainClipmap::GetLayout() const
+{
+	return m_layout;
+}
+
+inline const float16* TerrainClipmap::GetTexels() const
+{
+	return m_texels.data();
+}
+
+inline const std::vector<TerrainClipmap::SlotUpdate>& TerrainClipmap::GetUpdatedSlots() const
+{
+	return m_updatedSlots;
+}
+
+inline const TerrainClipmap::Region& TerrainClipmap::GetResidentRegion(uint nLevel) const
+{
+	return m_levels[nLevel].resident;
+}
+
+inline uint TerrainClipmap::GetPendingLoadCount() const
+{
+	return m_numPendingLoads;
+}
+
+inline uint TerrainClipmap::GetCompletedLoadCount() const
+{
+	return m_numCompletedLoads;
+}
+
+inline uint TerrainClipmap::GetDiscardedLoadCount() const
+{
+	return m_numDiscardedLoads;
+}
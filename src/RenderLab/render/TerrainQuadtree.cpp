@@ -0,0 +1,285 @@
+#include "Precompiled.h"
+#include "TerrainQuadtree.h"
+#include "Camera.h"
+
+namespace
+{
+	bool intersectsSphere(const Vec3& boundsMin, const Vec3& boundsMax, const Vec3& center, float radius)
+	{
+		float distSqr = 0.f;
+		for (int i = 0; i < 3; ++i)
+		{
+			float d = 0.f;
+			if (center[i] < boundsMin[i])
+				d = boundsMin[i] - center[i];
+			else if (center[i] > boundsMax[i])
+				d = center[i] - boundsMax[i];
+			distSqr += d * d;
+		}
+		return distSqr <= radius * radius;
+	}
+}
+
+struct TerrainQuadtree::SelectContext
+{
+	const Camera* pCamera;
+	Vec3 lodOrigin;
+	Vec4* aPatches;
+	uint numPatches;
+	uint maxPatches;
+};
+
+TerrainQuadtree::TerrainQuadtree()
+	: m_leafSize(0.f)
+	, m_numLods(0)
+{
+	for (uint i = 0; i < kMaxLods; ++i)
+	{
+		m_levelWidths[i] = 0;
+		m_levelHeights[i] = 0;
+		m_lodRanges[i] = 0.f;
+		m_morphStarts[i] = 0.f;
+	}
+}
+
+void TerrainQuadtree::Build(const float* pMinHeights, const float* pMaxHeights, uint nBoundsWidth, uint nBoundsHeight, const Vec2& boundsCellSize,
+	const Vec2& cornerMin, const Vec2& cornerMax, float fHeightScale, float fLeafSize)
+{
+	m_cornerMin = cornerMin;
+	m_leafSize = fLeafSize;
+
+	Vec2 terrainSize(cornerMax.x - cornerMin.x, cornerMax.y - cornerMin.y);
+	uint leafWidth = (uint)(terrainSize.x / fLeafSize);
+	uint leafHeight = (uint)(terrainSize.y / fLeafSize);
+	if (leafWidth == 0 || leafHeight == 0 || nBoundsWidth == 0 || nBoundsHeight == 0 || !pMinHeights || !pMaxHeights)
+	{
+		m_numLods = 0;
+		return;
+	}
+
+	// Add levels until a single node covers the terrain.
+	m_numLods = 1;
+	while (m_numLods < kMaxLods && (((leafWidth - 1) >> (m_numLods - 1)) > 0 || ((leafHeight - 1) >> (m_numLods - 1)) > 0))
+	{
+		++m_numLods;
+	}
+
+	for (uint nLevel = 0; nLevel < m_numLods; ++nLevel)
+	{
+		uint nLevelMask = (1 << nLevel) - 1;
+		m_levelWidths[nLevel] = (leafWidth + nLevelMask) >> nLevel;
+		m_levelHeights[nLevel] = (leafHeight + nLevelMask) >> nLevel;
+		m_aLevelNodes[nLevel].resize(m_levelWidths[nLevel] * m_levelHeights[nLevel]);
+	}
+
+	// Leaf bounds combine every bounds cell the leaf overlaps.
+	float cellsPerUnitX = 1.f / boundsCellSize.x;
+	float cellsPerUnitZ = 1.f / boundsCellSize.y;
+	for (uint z = 0; z < leafHeight; ++z)
+	{
+		int cellMinZ = (int)floorf(z * fLeafSize * cellsPerUnitZ);
+		int cellMaxZ = (int)ceilf((z + 1) * fLeafSize * cellsPerUnitZ) - 1;
+		cellMinZ = min(cellMinZ, (int)nBoundsHeight - 1);
+		cellMaxZ = min(max(cellMaxZ, cellMinZ), (int)nBoundsHeight - 1);
+
+		for (uint x = 0; x < leafWidth; ++x)
+		{
+			int cellMinX = (int)floorf(x * fLeafSize * cellsPerUnitX);
+			int cellMaxX = (int)ceilf((x + 1) * fLeafSize * cellsPerUnitX) - 1;
+			cellMinX = min(cellMinX, (int)nBoundsWidth - 1);
+			cellMaxX = min(max(cellMaxX, cellMinX), (int)nBoundsWidth - 1);
+
+			float minHeight = FLT_MAX;
+			float maxHeight = -FLT_MAX;
+			for (int cz = cellMinZ; cz <= cellMaxZ; ++cz)
+			{
+				for (int cx = cellMinX; cx <= cellMaxX; ++cx)
+				{
+					minHeight = min(minHeight, pMinHeights[cx + cz * nBoundsWidth]);
+					maxHeight = max(maxHeight, pMaxHeights[cx + cz * nBoundsWidth]);
+				}
+			}
+
+			NodeBounds& rLeaf = m_aLevelNodes[0][x + z * leafWidth];
+			rLeaf.minHeight = min(minHeight * fHeightScale, maxHeight * fHeightScale);
+			rLeaf.maxHeight = max(minHeight * fHeightScale, maxHeight * fHeightScale);
+			rLeaf.eCoverage = Coverage::kFull;
+		}
+	}
+
+	// Parents combine the bounds of their children.
+	for (uint nLevel = 1; nLevel < m_numLods; ++nLevel)
+	{
+		uint childWidth = m_levelWidths[nLevel - 1];
+		uint childHeight = m_levelHeights[nLevel - 1];
+
+		for (uint z = 0; z < m_levelHeights[nLevel]; ++z)
+		{
+			for (uint x = 0; x < m_levelWidths[nLevel]; ++x)
+			{
+				NodeBounds& rNode = m_aLevelNodes[nLevel][x + z * m_levelWidths[nLevel]];
+				rNode.minHeight = FLT_MAX;
+				rNode.maxHeight = -FLT_MAX;
+
+				uint numFullChildren = 0;
+				uint numEmptyChildren = 0;
+				for (uint i = 0; i < 4; ++i)
+				{
+					uint cx = x * 2 + (i & 1);
+					uint cz = z * 2 + (i >> 1);
+					if (cx >= childWidth || cz >= childHeight || GetNode(nLevel - 1, cx, cz).eCoverage == Coverage::kEmpty)
+					{
+						++numEmptyChildren;
+						continue;
+					}
+
+					const NodeBounds& rChild = GetNode(nLevel - 1, cx, cz);
+					rNode.minHeight = min(rNode.minHeight, rChild.minHeight);
+					rNode.maxHeight = max(rNode.maxHeight, rChild.maxHeight);
+					if (rChild.eCoverage == Coverage::kFull)
+					{
+						++numFullChildren;
+					}
+				}
+
+				if (numFullChildren == 4)
+					rNode.eCoverage = Coverage::kFull;
+				else if (numEmptyChildren == 4)
+					rNode.eCoverage = Coverage::kEmpty;
+				else
+					rNode.eCoverage = Coverage::kPartial;
+			}
+		}
+	}
+}
+
+void TerrainQuadtree::SetLodRanges(float fLeafRange, float fMorphStartRatio)
+{
+	// Neighboring patches can only differ by one level if each range comfortably exceeds the diagonal of its patches.
+	fLeafRange = max(fLeafRange, m_leafSize * 3.f);
+
+	float prevRange = 0.f;
+	for (uint nLod = 0; nLod < kMaxLods; ++nLod)
+	{
+		m_lodRanges[nLod] = fLeafRange * (1 << nLod);
+		m_morphStarts[nLod] = prevRange + (m_lodRanges[nLod] - prevRange) * fMorphStartRatio;
+		prevRange = m_lodRanges[nLod];
+	}
+}
+
+uint TerrainQuadtree::Select(const Camera& rCullCamera, const Vec3& lodOrigin, Vec4* aOutPatches, uint nMaxPatches) const
+{
+	if (m_numLods == 0)
+		return 0;
+
+	SelectContext context;
+	context.pCamera = &rCullCamera;
+	context.lodOrigin = lodOrigin;
+	context.aPatches = aOutPatches;
+	context.numPatches = 0;
+	context.maxPatches = nMaxPatches;
+
+	// Nodes beyond the range of the top level are still drawn at the coarsest detail.
+	uint nTopLevel = m_numLods - 1;
+	for (uint z = 0; z < m_levelHeights[nTopLevel]; ++z)
+	{
+		for (uint x = 0; x < m_levelWidths[nTopLevel]; ++x)
+		{
+			if (!SelectNode(context, nTopLevel, x, z))
+			{
+				AddArea(context, nTopLevel, x, z, nTopLevel);
+			}
+		}
+	}
+
+	return context.numPatches;
+}
+
+const TerrainQuadtree::NodeBounds& TerrainQuadtree::GetNode(uint nLevel, uint x, uint z) const
+{
+	return m_aLevelNodes[nLevel][x + z * m_levelWidths[nLevel]];
+}
+
+void TerrainQuadtree::GetNodeBounds(uint nLevel, uint x, uint z, Vec3& rOutMin, Vec3& rOutMax) const
+{
+	const NodeBounds& rNode = GetNode(nLevel, x, z);
+	float size = m_leafSize * (1 << nLevel);
+	rOutMin = Vec3(m_cornerMin.x + x * size, rNode.minHeight, m_cornerMin.y + z * size);
+	rOutMax = Vec3(rOutMin.x + size, rNode.maxHeight, rOutMin.z + size);
+}
+
+bool TerrainQuadtree::SelectNode(SelectContext& rContext, uint nLevel, uint x, uint z) const
+{
+	const NodeBounds& rNode = GetNode(nLevel, x, z);
+	if (rNode.eCoverage == Coverage::kEmpty)
+		return true;
+
+	Vec3 boundsMin, boundsMax;
+	GetNodeBounds(nLevel, x, z, boundsMin, boundsMax);
+
+	// Out of range of this level, the parent has to cover this area.
+	if (!intersectsSphere(boundsMin, boundsMax, rContext.lodOrigin, m_lodRanges[nLevel]))
+		return false;
+
+	if (!rContext.pCamera->CanSee(boundsMin, boundsMax))
+		return true;
+
+	// Partial nodes always subdivide so nothing is drawn outside of the terrain.
+	if (nLevel == 0 || (rNode.eCoverage == Coverage::kFull && !intersectsSphere(boundsMin, boundsMax, rContext.lodOrigin, m_lodRanges[nLevel - 1])))
+	{
+		AddPatch(rContext, boundsMin, boundsMax, nLevel);
+		return true;
+	}
+
+	// Children that are too far away for their own level are drawn as a quarter patch at this level.
+	for (uint i = 0; i < 4; ++i)
+	{
+		uint cx = x * 2 + (i & 1);
+		uint cz = z * 2 + (i >> 1);
+		if (cx >= m_levelWidths[nLevel - 1] || cz >= m_levelHeights[nLevel - 1])
+			continue;
+
+		if (!SelectNode(rContext, nLevel - 1, cx, cz))
+		{
+			AddArea(rContext, nLevel - 1, cx, cz, nLevel);
+		}
+	}
+
+	return true;
+}
+
+void TerrainQuadtree::AddArea(SelectContext& rContext, uint nLevel, uint x, uint z, uint nLod) const
+{
+	const NodeBounds& rNode = GetNode(nLevel, x, z);
+	if (rNode.eCoverage == Coverage::kEmpty)
+		return;
+
+	Vec3 boundsMin, boundsMax;
+	GetNodeBounds(nLevel, x, z, boundsMin, boundsMax);
+	if (!rContext.pCamera->CanSee(boundsMin, boundsMax))
+		return;
+
+	if (rNode.eCoverage == Coverage::kFull)
+	{
+		AddPatch(rContext, boundsMin, boundsMax, nLod);
+		return;
+	}
+
+	for (uint i = 0; i < 4; ++i)
+	{
+		uint cx = x * 2 + (i & 1);
+		uint cz = z * 2 + (i >> 1);
+		if (cx < m_levelWidths[nLevel - 1] && cz < m_levelHeights[nLevel - 1])
+		{
+			AddArea(rContext, nLevel - 1, cx, cz, nLod);
+		}
+	}
+}
+
+void TerrainQuadtree::AddPatch(SelectContext& rContext, const Vec3& boundsMin, const Vec3& boundsMax, uint nLod) const
+{
+	if (rContext.numPatches < rContext.maxPatches)
+	{
+		rContext.aPatches[rContext.numPatches++] = Vec4(boundsMin.x, boundsMin.z, boundsMax.x - boundsMin.x, (float)nLod);
+	}
+}
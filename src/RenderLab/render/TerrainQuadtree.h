@@ -0,0 +1,98 @@
+#pragma once
+
+class Camera;
+
+// Quadtree over terrain patches for continuous distance-based LOD (CDLOD, Strugar 2010).
+// Each level doubles the patch size and LOD distance of the level below it.  Selected patches
+// morph toward the next coarser grid as they approach the end of their range so that
+// neighboring levels always meet without cracks.
+// Only depends on the camera and height bounds so selection can be run and timed without a renderer.
+class TerrainQuadtree
+{
+public:
+	static const uint kMaxLods = 8;
+
+	TerrainQuadtree();
+
+	// Builds per-node height bounds from row-major grids of unscaled (min, max) heights.
+	// Bounds cell (x, y) covers boundsCellSize * (x, y) to boundsCellSize * (x + 1, y + 1) from cornerMin.
+	void Build(const float* pMinHeights, const float* pMaxHeights, uint nBoundsWidth, uint nBoundsHeight, const Vec2& boundsCellSize,
+		const Vec2& cornerMin, const Vec2& cornerMax, float fHeightScale, float fLeafSize);
+
+	// Sets the distance covered by the finest level.  Each coarser level covers twice the distance of the previous one.
+	// fMorphStartRatio is where in each level's range the morph to the coarser level begins.
+	void SetLodRanges(float fLeafRange, float fMorphStartRatio);
+
+	// Selects the patches to draw.  Patches are culled against rCullCamera while LOD distances are measured from
+	// lodOrigin, which lets shadow passes select the same geometry as the scene camera.
+	// Each output patch is (minX, minZ, size, lod).  Returns the number of patches written.
+	uint Select(const Camera& rCullCamera, const Vec3& lodOrigin, Vec4* aOutPatches, uint nMaxPatches) const;
+
+	uint GetLodCount() const;
+	uint GetLeafCount() const;
+	float GetLeafSize() const;
+
+	// Distance from the LOD origin at which a level starts and finishes morphing into the next level.
+	float GetMorphStart(uint nLod) const;
+	float GetMorphEnd(uint nLod) const;
+
+private:
+	enum class Coverage : uint8
+	{
+		kEmpty,		// No part of the node is within the terrain.
+		kPartial,	// Some children are outside of the terrain.
+		kFull
+	};
+
+	struct NodeBounds
+	{
+		float minHeight;
+		float maxHeight;
+		Coverage eCoverage;
+	};
+
+	struct SelectContext;
+
+	const NodeBounds& GetNode(uint nLevel, uint x, uint z) const;
+	void GetNodeBounds(uint nLevel, uint x, uint z, Vec3& rOutMin, Vec3& rOutMax) const;
+
+	bool SelectNode(SelectContext& rContext, uint nLevel, uint x, uint z) const;
+	void AddArea(SelectContext& rContext, uint nLevel, uint x, uint z, uint nLod) const;
+	void AddPatch(SelectContext& rContext, const Vec3& boundsMin, const Vec3& boundsMax, uint nLod) const;
+
+private:
+	std::vector<NodeBounds> m_aLevelNodes[kMaxLods];
+	uint m_levelWidths[kMaxLods];
+	uint m_levelHeights[kMaxLods];
+	float m_lodRanges[kMaxLods];
+	float m_morphStarts[kMaxLods];
+
+	Vec2 m_cornerMin;
+	float m_leafSize;
+	uint m_numLods;
+};
+
+inline uint TerrainQuadtree::GetLodCount() const
+{
+	return m_numLods;
+}
+
+inline uint TerrainQuadtree::GetLeafCount() const
+{
+	return m_numLods ? m_levelWidths[0] * m_levelHeights[0] : 0;
+}
+
+inline float TerrainQuadtree::GetLeafSize() const
+{
+	return m_leafSize;
+}
+
+inline float TerrainQuadtree::GetMorphStart(uint nLod) const
+{
+	return m_morphStarts[nLod];
+}
+
+inline float TerrainQuadtree::GetMorphEnd(uint nLod) const
+{
+	return m_lodRanges[nLod];
+}
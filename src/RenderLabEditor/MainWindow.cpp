@@ -2,6 +2,7 @@
 #include "MainWindow.h"
 #include "FileDialog.h"
 #include "UtilsLib/Timer.h"
+#include "UtilsLib/JobPool.h"
 #include "Widgets/PropertyPanel.h"
 #include "Widgets/TreeView.h"
 #include "Widgets/AssetBrowser.h"
@@ -57,8 +58,6 @@ MainWindow::MainWindow(int width, int height, const char* title)
 	, m_pPropertyPanel(nullptr)
 	, m_pSceneTreeView(nullptr)
 	, m_running(false)
-	, m_hFrameDoneEvent(0)
-	, m_hRenderFrameDoneEvent(0)
 {
 	::InitCommonControls();
 
@@ -239,8 +238,6 @@ int MainWindow::Run()
 
 	Timer::Handle hTimer = Timer::Create();
 
-	m_hFrameDoneEvent = ::CreateEvent(NULL, false, false, L"Frame Done");
-	m_hRenderFrameDoneEvent = ::CreateEvent(NULL, false, false, L"Render Frame Done");
 	std::thread renderThread(MainWindow::RenderThreadMain, this);
 
 	MSG msg = { 0 };
@@ -268,23 +265,18 @@ int MainWindow::Run()
 
 		m_pRenderWindow->QueueDraw();
 
-		// Wait for render thread.
-		WaitForSingleObject(m_hRenderFrameDoneEvent, INFINITE);
-
-		// Sync threads.
+		// Hand the frame to the render thread.  Only waits if the render thread has fallen behind by every queued frame.
 		m_pRenderWindow->PostFrameSync();
-
-		// Restart render thread
-		::SetEvent(m_hFrameDoneEvent);
 	}
 
 	// End the render thread.
-	::SetEvent(m_hFrameDoneEvent);
+	m_pRenderWindow->StopRenderThread();
 	renderThread.join();
 
 	m_pRenderWindow->Close();
 
 	FileWatcher::Cleanup();
+	JobPool::Cleanup();
 
 	return (int)msg.wParam;
 }
@@ -294,13 +286,10 @@ void MainWindow::RenderThreadMain(MainWindow* pWindow)
 	Renderer::SetRenderThread(GetCurrentThreadId());
 	RdrCpuThreadProfiler& threadProfiler = RdrCpuThreadProfiler::GetThreadProfiler(GetCurrentThreadId());
 
-	while (pWindow->m_running)
+	while (pWindow->m_pRenderWindow->WaitForFrame())
 	{
 		threadProfiler.BeginFrame();
 		pWindow->m_pRenderWindow->DrawFrame();
 		threadProfiler.EndFrame();
-
-		::SetEvent(pWindow->m_hRenderFrameDoneEvent);
-		::WaitForSingleObject(pWindow->m_hFrameDoneEvent, INFINITE);
 	}
 }
@@ -45,9 +45,6 @@ private:
 	AssetBrowser* m_pAssetBrowser;
 	bool m_running;
 
-	HANDLE m_hFrameDoneEvent;
-	HANDLE m_hRenderFrameDoneEvent;
-
 	Menu m_mainMenu;
 	Menu m_fileMenu;
 	Menu m_addMenu;
@@ -9,7 +9,7 @@
 #include "Scene.h"
 #include "ViewModels/SceneViewModel.h"
 #include "UI.h"
-#include "Raycast.h"
+#include "RayQuery.h"
 
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_win32.h"
@@ -19,22 +19,15 @@ namespace
 {
 	Entity* raycastScene(const Vec3& rayOrigin, const Vec3& rayDir)
 	{
-		float closestT = FLT_MAX;
-		Entity* pClosestEntity = nullptr;
+		// Entities can be moved between clicks, so the query scene is rebuilt for each pick.
+		RayQueryScene rayScene;
+		rayScene.Build();
 
-		// TODO: Scene needs an acceleration structure to speed this up.
-		DefaultComponentAllocator* pComponents = Scene::GetComponentAllocator();
-		for (ModelComponent& rModel : pComponents->GetModelComponentFreeList())
-		{
-			float t;
-			if (rayModelIntersect(rayOrigin, rayDir, &rModel, &t) && t < closestT)
-			{
-				closestT = t;
-				pClosestEntity = rModel.GetEntity();
-			}
-		}
+		RayQuery ray = { rayOrigin, rayDir, FLT_MAX };
+		RayQueryHit hit;
+		rayScene.CastRays(&ray, 1, &hit);
 
-		return pClosestEntity;
+		return hit.pModel ? hit.pModel->GetEntity() : nullptr;
 	}
 }
 
@@ -258,11 +251,21 @@ void RenderWindow::QueueDraw()
 	m_renderer.QueueAction(pPrimaryAction);
 }
 
+bool RenderWindow::WaitForFrame()
+{
+	return m_renderer.WaitForFrame();
+}
+
 void RenderWindow::DrawFrame()
 {
 	m_renderer.DrawFrame();
 }
 
+void RenderWindow::StopRenderThread()
+{
+	m_renderer.StopRenderThread();
+}
+
 void RenderWindow::PostFrameSync()
 {
 	m_renderer.PostFrameSync();
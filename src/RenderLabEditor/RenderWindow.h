@@ -30,8 +30,10 @@ public:
 	void Update();
 	void QueueDraw();
 	void PostFrameSync();
+	void StopRenderThread();
 
 	// Render thread commands
+	bool WaitForFrame();
 	void DrawFrame();
 
 private:
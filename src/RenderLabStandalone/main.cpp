@@ -1,9 +1,11 @@
 #include "UtilsLib/Timer.h"
+#include "UtilsLib/JobPool.h"
 #include "AssetLib/AssetLibrary.h"
 #include "Entity.h"
 #include "RenderDoc\RenderDocUtil.h"
 #include "render\Renderer.h"
 #include "render\RdrOffscreenTasks.h"
+#include "render\RdrPipelineStateCache.h"
 #include "UserConfig.h"
 #include "Physics.h"
 #include "Time.h"
@@ -22,18 +24,13 @@ namespace
 	InputManager g_inputManager;
 	Renderer g_renderer;
 	bool g_running = true;
-	HANDLE g_hRenderFrameDoneEvent;
-	HANDLE g_hFrameDoneEvent;
 	int g_mouseCaptureCount = 0;
 
 	void renderThreadMain()
 	{
-		while (g_running)
+		while (g_renderer.WaitForFrame())
 		{
 			g_renderer.DrawFrame();
-
-			::SetEvent(g_hRenderFrameDoneEvent);
-			::WaitForSingleObject(g_hFrameDoneEvent, INFINITE);
 		}
 	}
 
@@ -95,6 +92,18 @@ namespace
 		return ::DefWindowProc(hWnd, msg, wParam, lParam);
 	}
 
+	void reportLaunchTime(Timer::Handle hLaunchTimer)
+	{
+		RdrShaderCache::Stats cacheStats = RdrShaderSystem::GetShaderCacheStats();
+		RdrPipelineStateCache::Stats psoStats = RdrPipelineStateCache::GetStats();
+
+		char msg[256];
+		sprintf_s(msg, "Launch to first frame: %.1f ms (shader cache: %u hits, %u misses; pipeline states: %u prewarmed, %u hits, %u misses)\n",
+			Timer::GetElapsedMilliseconds(hLaunchTimer), cacheStats.hits, cacheStats.misses,
+			psoStats.prewarmed, psoStats.hits, psoStats.misses);
+		OutputDebugStringA(msg);
+	}
+
 	HWND createRenderWindow(int width, int height)
 	{
 		WNDCLASSEXA wc = { 0 };
@@ -128,6 +137,8 @@ namespace
 
 int main(int argc, char** argv)
 {
+	Timer::Handle hLaunchTimer = Timer::Create();
+
 	GlobalState::Init();
 	UserConfig::Load();
 	if (g_userConfig.attachRenderDoc)
@@ -155,11 +166,10 @@ int main(int argc, char** argv)
 
 	Timer::Handle hTimer = Timer::Create();
 
-	g_hFrameDoneEvent = ::CreateEvent(NULL, false, false, L"Frame Done");
-	g_hRenderFrameDoneEvent = ::CreateEvent(NULL, false, false, L"Render Frame Done");
 	std::thread renderThread(renderThreadMain);
 
 	MSG msg = { 0 };
+	int nFrameCount = 0;
 	while (g_running)
 	{
 		g_inputManager.Reset();
@@ -197,20 +207,24 @@ int main(int argc, char** argv)
 			g_renderer.QueueAction(pAction);
 		}
 
-		// Wait for render thread.
-		WaitForSingleObject(g_hRenderFrameDoneEvent, INFINITE);
-
-		// Sync threads.
+		// Hand the frame to the render thread.  Only waits if the render thread has fallen behind by every queued frame.
 		g_renderer.PostFrameSync();
 
-		// Restart render thread
-		::SetEvent(g_hFrameDoneEvent);
+		// The render thread can be one frame behind per extra frame state, so the first frame of the scene has been presented
+		// once that many frames have been submitted.
+		if (++nFrameCount == (int)g_renderer.GetNumFrameStates())
+		{
+			reportLaunchTime(hLaunchTimer);
+			Timer::Release(hLaunchTimer);
+		}
 	}
 
+	g_renderer.StopRenderThread();
 	renderThread.join();
 
 	g_renderer.Cleanup();
 	FileWatcher::Cleanup();
+	JobPool::Cleanup();
 
 	return (int)msg.wParam;
 }
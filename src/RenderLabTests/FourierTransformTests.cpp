@@ -0,0 +1,218 @@
+#include "TestFramework.h"
+#include "MathLib/FourierTransform.h"
+#include "UtilsLib/Timer.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const double kPiDouble = 3.14159265358979323846;
+
+	struct Grid
+	{
+		std::vector<float> real;
+		std::vector<float> imag;
+	};
+
+	void makeRandomGrid(int nCount, std::mt19937& rng, Grid& rGrid)
+	{
+		std::uniform_real_distribution<float> dist(-1.f, 1.f);
+		rGrid.real.resize(nCount);
+		rGrid.imag.resize(nCount);
+		for (int i = 0; i < nCount; ++i)
+		{
+			rGrid.real[i] = dist(rng);
+			rGrid.imag[i] = dist(rng);
+		}
+	}
+
+	// Naive DFT in double precision using the same positive exponent convention as FourierTransform.
+	// The input is size x size row-major, or a single row when numRows is 1.
+	void naiveDft(const Grid& rInput, int size, int numRows, std::vector<double>& rOutReal, std::vector<double>& rOutImag)
+	{
+		rOutReal.assign(size * numRows, 0.0);
+		rOutImag.assign(size * numRows, 0.0);
+		for (int y = 0; y < numRows; ++y)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				double sumReal = 0.0;
+				double sumImag = 0.0;
+				for (int v = 0; v < numRows; ++v)
+				{
+					for (int u = 0; u < size; ++u)
+					{
+						double angle = 2.0 * kPiDouble * ((double)(u * x) / size + (double)(v * y) / numRows);
+						double c = cos(angle);
+						double s = sin(angle);
+						double inReal = rInput.real[v * size + u];
+						double inImag = rInput.imag[v * size + u];
+						sumReal += inReal * c - inImag * s;
+						sumImag += inReal * s + inImag * c;
+					}
+				}
+				rOutReal[y * size + x] = sumReal;
+				rOutImag[y * size + x] = sumImag;
+			}
+		}
+	}
+
+	// Largest error relative to the largest reference magnitude.
+	double calcMaxError(const Grid& rResult, const std::vector<double>& rExpectedReal, const std::vector<double>& rExpectedImag)
+	{
+		double maxError = 0.0;
+		double maxMagnitude = 1e-9;
+		for (size_t i = 0; i < rExpectedReal.size(); ++i)
+		{
+			maxError = std::max(maxError, hypot(rResult.real[i] - rExpectedReal[i], rResult.imag[i] - rExpectedImag[i]));
+			maxMagnitude = std::max(maxMagnitude, hypot(rExpectedReal[i], rExpectedImag[i]));
+		}
+		return maxError / maxMagnitude;
+	}
+}
+
+TEST(FourierTransform_MatchesNaiveDft1D)
+{
+	std::mt19937 rng(1);
+	for (int size = 2; size <= 512; size *= 2)
+	{
+		FourierTransform fft;
+		fft.Init(size);
+
+		Grid input;
+		makeRandomGrid(size, rng, input);
+
+		std::vector<double> expectedReal, expectedImag;
+		naiveDft(input, size, 1, expectedReal, expectedImag);
+
+		Grid result = input;
+		fft.Transform(result.real.data(), result.imag.data());
+		CHECK(calcMaxError(result, expectedReal, expectedImag) < 1e-5);
+	}
+}
+
+TEST(FourierTransform_MatchesNaiveDft2D)
+{
+	std::mt19937 rng(2);
+	for (int size = 2; size <= 32; size *= 2)
+	{
+		FourierTransform fft;
+		fft.Init(size);
+
+		Grid input;
+		makeRandomGrid(size * size, rng, input);
+
+		std::vector<double> expectedReal, expectedImag;
+		naiveDft(input, size, size, expectedReal, expectedImag);
+
+		Grid result = input;
+		float* pReal = result.real.data();
+		float* pImag = result.imag.data();
+		fft.Transform2D(&pReal, &pImag, 1);
+		CHECK(calcMaxError(result, expectedReal, expectedImag) < 1e-5);
+	}
+}
+
+// Splitting the passes into row and column ranges, the way the ocean update jobs do, must not change the result.
+TEST(FourierTransform_PartialPassesMatchTransform2D)
+{
+	const int kSize = 64;
+	const int kNumFields = 3;
+
+	FourierTransform fft;
+	fft.Init(kSize);
+
+	std::mt19937 rng(3);
+	Grid fields[kNumFields];
+	Grid splitFields[kNumFields];
+	float* apReal[kNumFields];
+	float* apImag[kNumFields];
+	for (int f = 0; f < kNumFields; ++f)
+	{
+		makeRandomGrid(kSize * kSize, rng, fields[f]);
+		splitFields[f] = fields[f];
+		apReal[f] = fields[f].real.data();
+		apImag[f] = fields[f].imag.data();
+	}
+
+	fft.Transform2D(apReal, apImag, kNumFields);
+
+	for (int f = 0; f < kNumFields; ++f)
+	{
+		for (int row = 0; row < kSize; row += 5)
+		{
+			fft.TransformRows(splitFields[f].real.data(), splitFields[f].imag.data(), row, std::min(5, kSize - row));
+		}
+		// Includes a range that isn't a multiple of 4 to cover the scalar tail.
+		fft.TransformColumns(splitFields[f].real.data(), splitFields[f].imag.data(), 0, 16);
+		fft.TransformColumns(splitFields[f].real.data(), splitFields[f].imag.data(), 16, 46);
+		fft.TransformColumns(splitFields[f].real.data(), splitFields[f].imag.data(), 62, 2);
+
+		CHECK(splitFields[f].real == fields[f].real);
+		CHECK(splitFields[f].imag == fields[f].imag);
+	}
+}
+
+BENCHMARK(FourierTransform_Throughput)
+{
+	// Same field count as the ocean simulation: height, x/z slope, and x/z displacement.
+	const int kNumFields = 5;
+
+	std::mt19937 rng(4);
+	Timer::Handle hTimer = Timer::Create();
+	for (int size = 64; size <= 512; size *= 2)
+	{
+		FourierTransform fft;
+		fft.Init(size);
+
+		Grid inputs[kNumFields];
+		Grid fields[kNumFields];
+		float* apReal[kNumFields];
+		float* apImag[kNumFields];
+		for (int f = 0; f < kNumFields; ++f)
+		{
+			makeRandomGrid(size * size, rng, inputs[f]);
+			fields[f] = inputs[f];
+			apReal[f] = fields[f].real.data();
+			apImag[f] = fields[f].imag.data();
+		}
+
+		// Enough repetitions for roughly the same amount of work at each size.
+		// The input is restored between iterations (outside the timings) as repeated transforms would overflow.
+		int numIterations = std::max(1, (int)((1 << 24) / ((double)size * size * kNumFields)));
+
+		double rowSeconds = 0.0;
+		double columnSeconds = 0.0;
+		double seconds = 0.0;
+		for (int i = 0; i < numIterations; ++i)
+		{
+			for (int f = 0; f < kNumFields; ++f)
+			{
+				std::copy(inputs[f].real.begin(), inputs[f].real.end(), fields[f].real.begin());
+				std::copy(inputs[f].imag.begin(), inputs[f].imag.end(), fields[f].imag.begin());
+			}
+
+			Timer::Reset(hTimer);
+			fft.TransformRows(apReal[0], apImag[0], 0, size);
+			rowSeconds += Timer::GetElapsedSecondsAndReset(hTimer);
+			fft.TransformColumns(apReal[0], apImag[0], 0, size);
+			columnSeconds += Timer::GetElapsedSeconds(hTimer);
+
+			std::copy(inputs[0].real.begin(), inputs[0].real.end(), fields[0].real.begin());
+			std::copy(inputs[0].imag.begin(), inputs[0].imag.end(), fields[0].imag.begin());
+
+			Timer::Reset(hTimer);
+			fft.Transform2D(apReal, apImag, kNumFields);
+			seconds += Timer::GetElapsedSeconds(hTimer);
+		}
+
+		// 5 N log2(N) flops per 1D transform is the usual figure of merit for complex FFTs.
+		double flopsPerTransform = 5.0 * size * size * 2.0 * log2((double)size);
+		printf("  %dx%d x %d fields: %.3f ms per frame, %.2f GFlops (rows %.3f ms, columns %.3f ms per field)\n",
+			size, size, kNumFields, seconds * 1000.0 / numIterations,
+			flopsPerTransform * kNumFields * numIterations / std::max(seconds, 1e-9) * 1e-9,
+			rowSeconds * 1000.0 / numIterations, columnSeconds * 1000.0 / numIterations);
+	}
+	Timer::Release(hTimer);
+}
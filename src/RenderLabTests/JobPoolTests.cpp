@@ -0,0 +1,215 @@
+#include "TestFramework.h"
+#include "UtilsLib/JobPool.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct CoverageContext
+	{
+		std::vector<std::atomic<uint>> visits;
+		std::atomic<uint> nNestedCalls;
+
+		explicit CoverageContext(uint nCount) : visits(nCount), nNestedCalls(0) {}
+	};
+
+	void countVisits(uint nBegin, uint nEnd, void* pUserData)
+	{
+		CoverageContext* pContext = (CoverageContext*)pUserData;
+		for (uint i = nBegin; i < nEnd; ++i)
+		{
+			++pContext->visits[i];
+		}
+	}
+
+	bool visitedOnce(const CoverageContext& rContext)
+	{
+		for (const std::atomic<uint>& rVisits : rContext.visits)
+		{
+			if (rVisits != 1)
+				return false;
+		}
+		return true;
+	}
+
+	// Each outer index owns 16 of the inner indices.
+	struct NestedContext
+	{
+		CoverageContext* pContext;
+		uint nOffset;
+	};
+
+	void countNestedVisits(uint nBegin, uint nEnd, void* pUserData)
+	{
+		NestedContext* pNested = (NestedContext*)pUserData;
+		countVisits(pNested->nOffset + nBegin, pNested->nOffset + nEnd, pNested->pContext);
+	}
+
+	void runNestedCalls(uint nBegin, uint nEnd, void* pUserData)
+	{
+		CoverageContext* pContext = (CoverageContext*)pUserData;
+		for (uint i = nBegin; i < nEnd; ++i)
+		{
+			NestedContext nested = { pContext, i * 16 };
+			JobPool::ParallelFor(16, 1, countNestedVisits, &nested);
+			++pContext->nNestedCalls;
+		}
+	}
+
+	struct BlockingContext
+	{
+		std::atomic<bool> bStarted;
+		std::atomic<bool> bReleased;
+		std::atomic<bool> bTimedOut;
+	};
+
+	// Holds every range until released, or gives up after a few seconds so a regression fails instead of hanging.
+	void waitForRelease(uint, uint, void* pUserData)
+	{
+		BlockingContext* pContext = (BlockingContext*)pUserData;
+		pContext->bStarted = true;
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (!pContext->bReleased)
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+			{
+				pContext->bTimedOut = true;
+				return;
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	struct ConcurrencyContext
+	{
+		CoverageContext coverage;
+		std::atomic<uint> nRunning;
+		std::atomic<uint> nPeakRunning;
+		std::atomic<uint> nOtherThreadRanges;
+		std::thread::id callerId;
+
+		explicit ConcurrencyContext(uint nCount) : coverage(nCount), nRunning(0), nPeakRunning(0), nOtherThreadRanges(0), callerId(std::this_thread::get_id()) {}
+	};
+
+	// Records how many ranges overlap, holding each briefly so the other threads get a chance to join in.
+	void countConcurrentRanges(uint nBegin, uint nEnd, void* pUserData)
+	{
+		ConcurrencyContext* pContext = (ConcurrencyContext*)pUserData;
+		uint nRunning = ++pContext->nRunning;
+		uint nPeak = pContext->nPeakRunning;
+		while (nRunning > nPeak && !pContext->nPeakRunning.compare_exchange_weak(nPeak, nRunning)) {}
+
+		if (std::this_thread::get_id() != pContext->callerId)
+		{
+			++pContext->nOtherThreadRanges;
+		}
+
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+		countVisits(nBegin, nEnd, &pContext->coverage);
+		--pContext->nRunning;
+	}
+}
+
+TEST(JobPool_CoversEveryIndexOnce)
+{
+	const uint kGrainSizes[] = { 1, 7, 64, 1000, 5000 };
+	for (uint nGrainSize : kGrainSizes)
+	{
+		CoverageContext context(4099);
+		JobPool::ParallelFor(4099, nGrainSize, countVisits, &context);
+		CHECK(visitedOnce(context));
+	}
+}
+
+TEST(JobPool_NestedCallsRunInline)
+{
+	CoverageContext context(256);
+	JobPool::ParallelFor(16, 1, runNestedCalls, &context);
+
+	CHECK(context.nNestedCalls == 16);
+	CHECK(visitedOnce(context));
+}
+
+TEST(JobPool_ConcurrentCallers)
+{
+	const uint kNumCallers = 4;
+	const uint kCallsPerCaller = 50;
+
+	std::atomic<uint> nFailures(0);
+	std::vector<std::thread> callers;
+	for (uint nCaller = 0; nCaller < kNumCallers; ++nCaller)
+	{
+		callers.push_back(std::thread([&nFailures, nCaller]()
+		{
+			for (uint nCall = 0; nCall < kCallsPerCaller; ++nCall)
+			{
+				uint nCount = 100 + nCaller * 37 + nCall * 11;
+				CoverageContext context(nCount);
+				JobPool::ParallelFor(nCount, 1 + nCall % 5, countVisits, &context);
+				if (!visitedOnce(context))
+				{
+					++nFailures;
+				}
+			}
+		}));
+	}
+
+	for (std::thread& rCaller : callers)
+	{
+		rCaller.join();
+	}
+	CHECK(nFailures == 0);
+}
+
+// A long running call on one thread must not hold up a call made from another.
+TEST(JobPool_CallsDoNotWaitForOtherCallers)
+{
+	BlockingContext blocking;
+	blocking.bStarted = false;
+	blocking.bReleased = false;
+	blocking.bTimedOut = false;
+
+	std::thread blockingCaller([&blocking]()
+	{
+		JobPool::ParallelFor(JobPool::GetThreadCount() * 4, 1, waitForRelease, &blocking);
+	});
+
+	while (!blocking.bStarted)
+	{
+		std::this_thread::yield();
+	}
+
+	CoverageContext context(1000);
+	JobPool::ParallelFor(1000, 10, countVisits, &context);
+	blocking.bReleased = true;
+	blockingCaller.join();
+
+	CHECK(visitedOnce(context));
+	CHECK(!blocking.bTimedOut);
+}
+
+TEST(JobPool_MaxThreadCount)
+{
+	JobPool::SetMaxThreadCount(1);
+	CHECK(JobPool::GetThreadCount() == 1);
+	{
+		ConcurrencyContext context(64);
+		JobPool::ParallelFor(64, 1, countConcurrentRanges, &context);
+		CHECK(visitedOnce(context.coverage));
+		CHECK(context.nOtherThreadRanges == 0);
+	}
+
+	JobPool::SetMaxThreadCount(2);
+	CHECK(JobPool::GetThreadCount() <= 2);
+	{
+		ConcurrencyContext context(64);
+		JobPool::ParallelFor(64, 1, countConcurrentRanges, &context);
+		CHECK(visitedOnce(context.coverage));
+		CHECK(context.nPeakRunning <= 2);
+	}
+
+	JobPool::SetMaxThreadCount(0);
+}
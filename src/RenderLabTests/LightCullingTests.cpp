@@ -0,0 +1,319 @@
+#include "TestFramework.h"
+#include "Types.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "MathLib/Maths.h"
+#include "render/LightCulling.h"
+#include "UtilsLib/Timer.h"
+
+namespace
+{
+	// Straight scalar port of c_clustered_light_cull.hlsl to check the CPU assignment against.
+	namespace Reference
+	{
+		struct Froxel
+		{
+			float nearX[2];
+			float nearY[2];
+			float farX[2];
+			float farY[2];
+			float minZ;
+			float maxZ;
+			Vec3 center;
+		};
+
+		Froxel constructFroxel(const ClusteredLightCullingParams& rParams, uint x, uint y, uint z)
+		{
+			const float kSliceScale = CLUSTEREDLIGHTING_MAX_DEPTH / CLUSTEREDLIGHTING_SPECIAL_NEAR_DEPTH;
+			float depthMin = 0.1f;
+			float depthMax = CLUSTEREDLIGHTING_SPECIAL_NEAR_DEPTH;
+			if (z > 0)
+			{
+				depthMin = CLUSTEREDLIGHTING_SPECIAL_NEAR_DEPTH * powf(kSliceScale, (z - 1) / (CLUSTEREDLIGHTING_DEPTH_SLICES - 1.f));
+				depthMax = CLUSTEREDLIGHTING_SPECIAL_NEAR_DEPTH * powf(kSliceScale, z / (CLUSTEREDLIGHTING_DEPTH_SLICES - 1.f));
+			}
+
+			float tilesX = rParams.screenSize.x / (float)rParams.clusterTileSize;
+			float tilesY = rParams.screenSize.y / (float)rParams.clusterTileSize;
+
+			Froxel froxel;
+			froxel.nearX[0] = -(1.f - 2.f / tilesX * x) * depthMin / rParams.proj_11;
+			froxel.nearX[1] = -(1.f - 2.f / tilesX * (x + 1)) * depthMin / rParams.proj_11;
+			froxel.nearY[0] = (1.f - 2.f / tilesY * (y + 1)) * depthMin / rParams.proj_22;
+			froxel.nearY[1] = (1.f - 2.f / tilesY * y) * depthMin / rParams.proj_22;
+			froxel.farX[0] = -(1.f - 2.f / tilesX * x) * depthMax / rParams.proj_11;
+			froxel.farX[1] = -(1.f - 2.f / tilesX * (x + 1)) * depthMax / rParams.proj_11;
+			froxel.farY[0] = (1.f - 2.f / tilesY * (y + 1)) * depthMax / rParams.proj_22;
+			froxel.farY[1] = (1.f - 2.f / tilesY * y) * depthMax / rParams.proj_22;
+			froxel.minZ = depthMin;
+			froxel.maxZ = depthMax;
+
+			Vec3 boundsMin(std::min(froxel.nearX[0], froxel.farX[0]), std::min(froxel.nearY[0], froxel.farY[0]), depthMin);
+			Vec3 boundsMax(std::max(froxel.nearX[1], froxel.farX[1]), std::max(froxel.nearY[1], froxel.farY[1]), depthMax);
+			froxel.center = (boundsMin + boundsMax) * 0.5f;
+			return froxel;
+		}
+
+		// Separating axis test of the froxel against a sphere or half space along an axis.
+		bool testAxis(const Froxel& rFroxel, const Vec3& pos, const Vec3& axis, float radius)
+		{
+			float nearDist = -Vec3Dot(axis, pos)
+				+ std::min(axis.x * rFroxel.nearX[0], axis.x * rFroxel.nearX[1])
+				+ std::min(axis.y * rFroxel.nearY[0], axis.y * rFroxel.nearY[1])
+				+ axis.z * rFroxel.minZ;
+			float farDist = -Vec3Dot(axis, pos)
+				+ std::min(axis.x * rFroxel.farX[0], axis.x * rFroxel.farX[1])
+				+ std::min(axis.y * rFroxel.farY[0], axis.y * rFroxel.farY[1])
+				+ axis.z * rFroxel.maxZ;
+			return std::min(nearDist, farDist) < radius;
+		}
+
+		Vec3 transformToView(const Matrix44& mtxViewTransposed, const Vec3& v, float w)
+		{
+			const Matrix44& m = mtxViewTransposed;
+			return Vec3(m._11 * v.x + m._12 * v.y + m._13 * v.z + m._14 * w,
+				m._21 * v.x + m._22 * v.y + m._23 * v.z + m._24 * w,
+				m._31 * v.x + m._32 * v.y + m._33 * v.z + m._34 * w);
+		}
+
+		bool testPointLight(const ClusteredLightCullingParams& rParams, const Froxel& rFroxel, const PointLight& rLight)
+		{
+			Vec3 lightPos = transformToView(rParams.mtxView, rLight.position, 1.f);
+			return testAxis(rFroxel, lightPos, Vec3Normalize(rFroxel.center - lightPos), rLight.radius);
+		}
+
+		bool testSpotLight(const ClusteredLightCullingParams& rParams, const Froxel& rFroxel, const SpotLight& rLight)
+		{
+			Vec3 lightPos = transformToView(rParams.mtxView, rLight.position, 1.f);
+			Vec3 toFroxel = Vec3Normalize(rFroxel.center - lightPos);
+			if (!testAxis(rFroxel, lightPos, toFroxel, rLight.radius))
+				return false;
+
+			// Plane through the light that touches the cone on the side facing the froxel.
+			Vec3 lightDir = transformToView(rParams.mtxView, rLight.direction, 0.f);
+			Vec3 tangent = Vec3Normalize(Vec3Cross(lightDir, toFroxel));
+			Vec3 capDir = Vec3Cross(tangent, lightDir);
+			Vec3 capEdge = lightPos + lightDir * rLight.radius + capDir * (rLight.radius * tanf(rLight.outerConeAngle));
+			Vec3 normal = Vec3Cross(tangent, Vec3Normalize(capEdge - lightPos));
+			return testAxis(rFroxel, lightPos, normal, 0.f);
+		}
+
+		// Lights are visited in a random order, like the shader's threads, so overflowing clusters keep arbitrary subsets.
+		void assignLights(const ClusteredLightCullingParams& rParams, const SpotLight* aSpotLights, const PointLight* aPointLights,
+			std::mt19937& rRng, bool bShuffle, uint16* aOutLightIndices)
+		{
+			std::vector<uint> spotOrder(rParams.spotLightCount);
+			std::vector<uint> pointOrder(rParams.pointLightCount);
+			for (uint z = 0; z < rParams.clusterCountZ; ++z)
+			{
+				for (uint y = 0; y < rParams.clusterCountY; ++y)
+				{
+					for (uint x = 0; x < rParams.clusterCountX; ++x)
+					{
+						Froxel froxel = constructFroxel(rParams, x, y, z);
+						uint16* pBlock = aOutLightIndices + (x + (y + z * rParams.clusterCountY) * rParams.clusterCountX) * CLUSTEREDLIGHTING_BLOCK_SIZE;
+
+						for (uint i = 0; i < spotOrder.size(); ++i)
+							spotOrder[i] = i;
+						for (uint i = 0; i < pointOrder.size(); ++i)
+							pointOrder[i] = i;
+						if (bShuffle)
+						{
+							std::shuffle(spotOrder.begin(), spotOrder.end(), rRng);
+							std::shuffle(pointOrder.begin(), pointOrder.end(), rRng);
+						}
+
+						uint numLights = 0;
+						uint numSpotLights = 0;
+						uint numPointLights = 0;
+						for (uint i : spotOrder)
+						{
+							if (numLights < CLUSTEREDLIGHTING_MAX_LIGHTS_PER && testSpotLight(rParams, froxel, aSpotLights[i]))
+							{
+								pBlock[LIGHTLIST_NUM_LIGHT_TYPES + numLights++] = (uint16)i;
+								++numSpotLights;
+							}
+						}
+						for (uint i : pointOrder)
+						{
+							if (numLights < CLUSTEREDLIGHTING_MAX_LIGHTS_PER && testPointLight(rParams, froxel, aPointLights[i]))
+							{
+								pBlock[LIGHTLIST_NUM_LIGHT_TYPES + numLights++] = (uint16)i;
+								++numPointLights;
+							}
+						}
+						pBlock[0] = (uint16)numSpotLights;
+						pBlock[1] = (uint16)numPointLights;
+					}
+				}
+			}
+		}
+	}
+
+	// 1920x1080 view with the cluster tile size and transposed view matrix set up the way RdrLighting does.
+	ClusteredLightCullingParams makeParams(const Vec3& eyePos, const Vec3& eyeDir)
+	{
+		const float kWidth = 1920.f;
+		const float kHeight = 1080.f;
+		const float kFovY = Maths::DegToRad(60.f);
+
+		ClusteredLightCullingParams params = {};
+		Matrix44 mtxProj = Matrix44PerspectiveFovLH(kFovY, kWidth / kHeight, 0.1f, 1000.f);
+		params.mtxView = Matrix44Transpose(Matrix44LookToLH(eyePos, eyeDir, Vec3::kUnitY));
+		params.proj_11 = mtxProj._11;
+		params.proj_22 = mtxProj._22;
+		params.screenSize = Vec2(kWidth, kHeight);
+		params.fovY = kFovY;
+		params.aspectRatio = kWidth / kHeight;
+		params.clusterTileSize = ((uint)ceilf(std::max(kWidth, kHeight) / 16.f) + 7) & ~7;
+		params.clusterCountX = (uint)ceilf(kWidth / params.clusterTileSize);
+		params.clusterCountY = (uint)ceilf(kHeight / params.clusterTileSize);
+		params.clusterCountZ = CLUSTEREDLIGHTING_DEPTH_SLICES;
+		return params;
+	}
+
+	// Lights scattered in front of the camera.  Smaller spreads pack enough lights together to overflow clusters.
+	void makeLights(uint numLights, const Vec3& eyePos, float spread, std::mt19937& rRng,
+		std::vector<SpotLight>& rOutSpotLights, std::vector<PointLight>& rOutPointLights)
+	{
+		std::uniform_real_distribution<float> dist(0.f, 1.f);
+
+		rOutSpotLights.assign(numLights, SpotLight());
+		for (SpotLight& rLight : rOutSpotLights)
+		{
+			rLight.position = Vec3(eyePos.x + (dist(rRng) - 0.5f) * spread, dist(rRng) * 20.f, eyePos.z + dist(rRng) * spread);
+			rLight.direction = Vec3Normalize(Vec3(dist(rRng) - 0.5f, -dist(rRng), dist(rRng) - 0.5f));
+			rLight.radius = 2.f + dist(rRng) * 30.f;
+			rLight.outerConeAngle = 0.1f + dist(rRng) * 0.9f;
+		}
+
+		rOutPointLights.assign(numLights, PointLight());
+		for (PointLight& rLight : rOutPointLights)
+		{
+			rLight.position = Vec3(eyePos.x + (dist(rRng) - 0.5f) * spread, dist(rRng) * 20.f, eyePos.z + dist(rRng) * spread);
+			rLight.radius = 1.f + dist(rRng) * 20.f;
+		}
+	}
+}
+
+TEST(LightCulling_MatchesShaderReference)
+{
+	const Vec3 kEyePos(3.f, 2.f, -5.f);
+	const Vec3 kEyeDir = Vec3Normalize(Vec3(0.5f, -0.1f, 0.86f));
+	std::mt19937 rng(1234);
+
+	uint numFullClusters = 0;
+	const uint kLightCounts[] = { 16, 64, 256, 1024 };
+	for (uint numLights : kLightCounts)
+	{
+		ClusteredLightCullingParams params = makeParams(kEyePos, kEyeDir);
+		std::vector<SpotLight> spotLights;
+		std::vector<PointLight> pointLights;
+		makeLights(numLights, kEyePos, (numLights == 1024) ? 40.f : 200.f, rng, spotLights, pointLights);
+		params.spotLightCount = numLights;
+		params.pointLightCount = numLights;
+
+		uint numIndices = LightCulling::GetClusteredLightIndexCount(params);
+		std::vector<uint16> cpuIndices(numIndices);
+		std::vector<uint16> shaderIndices(numIndices);
+		LightCulling::AssignClusteredLights(params, spotLights.data(), pointLights.data(), cpuIndices.data());
+		Reference::assignLights(params, spotLights.data(), pointLights.data(), rng, true, shaderIndices.data());
+
+		CHECK(LightCulling::ValidateClusteredLights(params, spotLights.data(), pointLights.data(), cpuIndices.data()) == 0);
+		CHECK(LightCulling::ValidateClusteredLights(params, spotLights.data(), pointLights.data(), shaderIndices.data()) == 0);
+
+		// Light counts must match exactly, including where clusters overflow.
+		uint numCountMismatches = 0;
+		for (uint i = 0; i < numIndices; i += CLUSTEREDLIGHTING_BLOCK_SIZE)
+		{
+			if (cpuIndices[i] != shaderIndices[i] || cpuIndices[i + 1] != shaderIndices[i + 1])
+				++numCountMismatches;
+			if (cpuIndices[i] + cpuIndices[i + 1] == CLUSTEREDLIGHTING_MAX_LIGHTS_PER)
+				++numFullClusters;
+		}
+		CHECK(numCountMismatches == 0);
+	}
+
+	// The dense light set has to exercise the overflow handling.
+	CHECK(numFullClusters > 0);
+}
+
+TEST(LightCulling_ValidationDetectsCorruptCluster)
+{
+	const Vec3 kEyePos(0.f, 2.f, 0.f);
+	ClusteredLightCullingParams params = makeParams(kEyePos, Vec3::kUnitZ);
+
+	std::mt19937 rng(99);
+	std::vector<SpotLight> spotLights;
+	std::vector<PointLight> pointLights;
+	makeLights(128, kEyePos, 100.f, rng, spotLights, pointLights);
+	params.spotLightCount = (uint)spotLights.size();
+	params.pointLightCount = (uint)pointLights.size();
+
+	std::vector<uint16> lightIndices(LightCulling::GetClusteredLightIndexCount(params));
+	Reference::assignLights(params, spotLights.data(), pointLights.data(), rng, true, lightIndices.data());
+	CHECK(LightCulling::ValidateClusteredLights(params, spotLights.data(), pointLights.data(), lightIndices.data()) == 0);
+
+	// Swap a light in the first non-empty cluster for one that isn't in it.
+	for (uint i = 0; i < lightIndices.size(); i += CLUSTEREDLIGHTING_BLOCK_SIZE)
+	{
+		uint numLights = lightIndices[i] + lightIndices[i + 1];
+		if (numLights == 0 || numLights == CLUSTEREDLIGHTING_MAX_LIGHTS_PER)
+			continue;
+
+		uint16* pLights = &lightIndices[i + LIGHTLIST_NUM_LIGHT_TYPES];
+		uint16* pFirstPointLight = pLights + lightIndices[i];
+		uint16* pEnd = pLights + numLights;
+		bool bIsSpotLight = (lightIndices[i] > 0);
+		uint16* pTypeBegin = bIsSpotLight ? pLights : pFirstPointLight;
+		uint16* pTypeEnd = bIsSpotLight ? pFirstPointLight : pEnd;
+		for (uint16 light = 0; light < 128; ++light)
+		{
+			if (std::find(pTypeBegin, pTypeEnd, light) == pTypeEnd)
+			{
+				*pTypeBegin = light;
+				break;
+			}
+		}
+		break;
+	}
+	CHECK(LightCulling::ValidateClusteredLights(params, spotLights.data(), pointLights.data(), lightIndices.data()) == 1);
+}
+
+BENCHMARK(LightCulling_AssignClusteredLights)
+{
+	const Vec3 kEyePos(3.f, 2.f, -5.f);
+	const Vec3 kEyeDir = Vec3Normalize(Vec3(0.5f, -0.1f, 0.86f));
+	std::mt19937 rng(7);
+
+	Timer::Handle hTimer = Timer::Create();
+	const uint kLightCounts[] = { 64, 256, 1024 };
+	for (uint numLights : kLightCounts)
+	{
+		ClusteredLightCullingParams params = makeParams(kEyePos, kEyeDir);
+		std::vector<SpotLight> spotLights;
+		std::vector<PointLight> pointLights;
+		makeLights(numLights, kEyePos, 200.f, rng, spotLights, pointLights);
+		params.spotLightCount = numLights;
+		params.pointLightCount = numLights;
+
+		std::vector<uint16> lightIndices(LightCulling::GetClusteredLightIndexCount(params));
+
+		const int kNumIterations = 20;
+		Timer::Reset(hTimer);
+		for (int i = 0; i < kNumIterations; ++i)
+		{
+			LightCulling::AssignClusteredLights(params, spotLights.data(), pointLights.data(), lightIndices.data());
+		}
+		double assignMs = Timer::GetElapsedMilliseconds(hTimer) / kNumIterations;
+
+		Timer::Reset(hTimer);
+		Reference::assignLights(params, spotLights.data(), pointLights.data(), rng, false, lightIndices.data());
+		double referenceMs = Timer::GetElapsedMilliseconds(hTimer);
+
+		printf("  %u spot + %u point lights, %ux%ux%u clusters: %.3f ms, scalar reference %.2f ms\n",
+			numLights, numLights, params.clusterCountX, params.clusterCountY, params.clusterCountZ, assignMs, referenceMs);
+	}
+	Timer::Release(hTimer);
+}
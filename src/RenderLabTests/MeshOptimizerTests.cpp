@@ -0,0 +1,212 @@
+#include "TestFramework.h"
+#include "../AssetImporter/MeshOptimizer.h"
+#include "AssetLib/ModelAsset.h"
+#include "MathLib/Maths.h"
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+	struct TestMesh
+	{
+		std::vector<Vec3> positions;
+		std::vector<uint> indices;
+	};
+
+	// Regular grid over [0,1]x[0,1] displaced along z by the height function.
+	TestMesh makeHeightfield(uint nCells, const std::function<float(float, float)>& heightFunc)
+	{
+		TestMesh mesh;
+		for (uint y = 0; y <= nCells; ++y)
+		{
+			for (uint x = 0; x <= nCells; ++x)
+			{
+				float u = x / (float)nCells;
+				float v = y / (float)nCells;
+				mesh.positions.push_back(Vec3(u, v, heightFunc(u, v)));
+			}
+		}
+
+		for (uint y = 0; y < nCells; ++y)
+		{
+			for (uint x = 0; x < nCells; ++x)
+			{
+				uint i0 = y * (nCells + 1) + x;
+				uint i1 = i0 + 1;
+				uint i2 = i0 + nCells + 1;
+				uint i3 = i2 + 1;
+				mesh.indices.insert(mesh.indices.end(), { i0, i1, i3, i0, i3, i2 });
+			}
+		}
+		return mesh;
+	}
+
+	float calcSurfaceArea(const std::vector<uint>& indices, const std::vector<Vec3>& positions)
+	{
+		float fArea = 0.f;
+		for (uint i = 0; i < indices.size(); i += 3)
+		{
+			const Vec3& p0 = positions[indices[i + 0]];
+			fArea += 0.5f * Vec3Length(Vec3Cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0));
+		}
+		return fArea;
+	}
+
+	// Closest point on a triangle (Ericson, "Real-Time Collision Detection" 5.1.5).
+	Vec3 closestPointOnTriangle(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c)
+	{
+		Vec3 ab = b - a;
+		Vec3 ac = c - a;
+		Vec3 ap = p - a;
+		float d1 = Vec3Dot(ab, ap);
+		float d2 = Vec3Dot(ac, ap);
+		if (d1 <= 0.f && d2 <= 0.f)
+			return a;
+
+		Vec3 bp = p - b;
+		float d3 = Vec3Dot(ab, bp);
+		float d4 = Vec3Dot(ac, bp);
+		if (d3 >= 0.f && d4 <= d3)
+			return b;
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f)
+			return a + ab * (d1 / (d1 - d3));
+
+		Vec3 cp = p - c;
+		float d5 = Vec3Dot(ab, cp);
+		float d6 = Vec3Dot(ac, cp);
+		if (d6 >= 0.f && d5 <= d6)
+			return c;
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f)
+			return a + ac * (d2 / (d2 - d6));
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f)
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+		float fDenom = 1.f / (va + vb + vc);
+		return a + ab * (vb * fDenom) + ac * (vc * fDenom);
+	}
+
+	float calcDistanceToSurface(const Vec3& p, const std::vector<uint>& indices, const std::vector<Vec3>& positions)
+	{
+		float fMinDistSqr = FLT_MAX;
+		for (uint i = 0; i < indices.size(); i += 3)
+		{
+			Vec3 q = closestPointOnTriangle(p, positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]]);
+			fMinDistSqr = std::min(fMinDistSqr, Vec3LengthSqr(p - q));
+		}
+		return sqrtf(fMinDistSqr);
+	}
+
+	// Brute force reference for MeshOptimizer::MeasureDeviation() with a much denser set of samples per triangle.
+	float calcReferenceDeviation(const std::vector<uint>& indicesA, const std::vector<uint>& indicesB, const std::vector<Vec3>& positions)
+	{
+		const uint kSubdivisions = 6;
+
+		float fMaxDist = 0.f;
+		for (int nDir = 0; nDir < 2; ++nDir)
+		{
+			const std::vector<uint>& srcIndices = nDir ? indicesB : indicesA;
+			const std::vector<uint>& dstIndices = nDir ? indicesA : indicesB;
+			for (uint i = 0; i < srcIndices.size(); i += 3)
+			{
+				const Vec3& p0 = positions[srcIndices[i]];
+				const Vec3& p1 = positions[srcIndices[i + 1]];
+				const Vec3& p2 = positions[srcIndices[i + 2]];
+				for (uint u = 0; u <= kSubdivisions; ++u)
+				{
+					for (uint v = 0; u + v <= kSubdivisions; ++v)
+					{
+						float fU = u / (float)kSubdivisions;
+						float fV = v / (float)kSubdivisions;
+						Vec3 vSample = p0 + (p1 - p0) * fU + (p2 - p0) * fV;
+						fMaxDist = std::max(fMaxDist, calcDistanceToSurface(vSample, dstIndices, positions));
+					}
+				}
+			}
+		}
+		return fMaxDist;
+	}
+}
+
+TEST(MeshOptimizer_SimplifyFlatGrid)
+{
+	// Interior vertices of a plane can all be removed without any error.
+	TestMesh mesh = makeHeightfield(32, [](float, float) { return 0.f; });
+	uint nTriCount = (uint)mesh.indices.size() / 3;
+
+	float fError = -1.f;
+	std::vector<uint> lodIndices = MeshOptimizer::Simplify(mesh.indices, mesh.positions, 0, 1e-4f, &fError);
+
+	CHECK(lodIndices.size() % 3 == 0);
+	CHECK(lodIndices.size() / 3 <= nTriCount / 8);
+	CHECK(fError >= 0.f && fError <= 1e-4f);
+
+	// The open border is preserved, so the simplified plane still covers exactly the same area.
+	CHECK_NEAR(calcSurfaceArea(lodIndices, mesh.positions), 1.f, 1e-4f);
+	for (uint nIndex : lodIndices)
+	{
+		CHECK(nIndex < mesh.positions.size());
+	}
+}
+
+TEST(MeshOptimizer_SimplifyTargetCount)
+{
+	TestMesh mesh = makeHeightfield(32, [](float u, float v) { return 0.05f * sinf(u * 9.f) * cosf(v * 7.f); });
+	uint nTriCount = (uint)mesh.indices.size() / 3;
+
+	// With an unlimited error the simplifier stops as soon as the target is met.
+	uint nTargetIndexCount = (nTriCount / 2) * 3;
+	std::vector<uint> lodIndices = MeshOptimizer::Simplify(mesh.indices, mesh.positions, nTargetIndexCount, FLT_MAX, nullptr);
+	CHECK(lodIndices.size() <= nTargetIndexCount);
+	CHECK(lodIndices.size() >= nTargetIndexCount * 3 / 4);
+
+	// Larger error limits never keep more triangles than smaller ones.
+	uint nPrevTriCount = nTriCount;
+	const float kErrorLimits[] = { 0.0005f, 0.002f, 0.008f, 0.032f };
+	for (float fErrorLimit : kErrorLimits)
+	{
+		float fError;
+		lodIndices = MeshOptimizer::Simplify(mesh.indices, mesh.positions, 0, fErrorLimit, &fError);
+		uint nLodTriCount = (uint)lodIndices.size() / 3;
+		CHECK(nLodTriCount <= nPrevTriCount);
+		CHECK(fError <= fErrorLimit);
+		nPrevTriCount = nLodTriCount;
+	}
+	CHECK(nPrevTriCount < nTriCount / 4);
+}
+
+TEST(MeshOptimizer_MeasureDeviation)
+{
+	// LOD errors are measured at a handful of points per triangle.  Selection scales them by kLodErrorMargin to
+	// cover the deviation between the samples, which is checked against a much denser brute force measurement.
+	const std::function<float(float, float)> heightFuncs[] = {
+		[](float u, float v) { return 0.05f * sinf(u * 9.f) * cosf(v * 7.f); },
+		[](float u, float v) { return 0.2f * (u - 0.5f) * (u - 0.5f) + 0.1f * v * v; },
+		[](float u, float v) { float r = sqrtf((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f)); return 0.03f * cosf(r * 30.f); },
+	};
+
+	for (const auto& heightFunc : heightFuncs)
+	{
+		TestMesh mesh = makeHeightfield(24, heightFunc);
+		CHECK(MeshOptimizer::MeasureDeviation(mesh.indices, mesh.indices, mesh.positions) <= 1e-6f);
+
+		const float kErrorLimits[] = { 0.001f, 0.004f, 0.016f };
+		for (float fErrorLimit : kErrorLimits)
+		{
+			std::vector<uint> lodIndices = MeshOptimizer::Simplify(mesh.indices, mesh.positions, 0, fErrorLimit, nullptr);
+			CHECK(lodIndices.size() < mesh.indices.size());
+
+			float fDeviation = MeshOptimizer::MeasureDeviation(mesh.indices, lodIndices, mesh.positions);
+			float fReference = calcReferenceDeviation(mesh.indices, lodIndices, mesh.positions);
+
+			// The measured samples are a subset of the reference samples.
+			CHECK(fDeviation <= fReference + 1e-6f);
+			CHECK(fReference <= fDeviation * AssetLib::Model::kLodErrorMargin + 1e-6f);
+		}
+	}
+}
@@ -0,0 +1,225 @@
+#include "TestFramework.h"
+#include "AssetLib/ModelBvh.h"
+#include "MathLib/Maths.h"
+#include "UtilsLib/Timer.h"
+#include <algorithm>
+#include <random>
+
+namespace
+{
+	struct BvhTestScene
+	{
+		std::vector<Vec3> positions;
+		std::vector<AssetLib::Model::BvhTriangle> triangles;
+
+		std::vector<AssetLib::Model::BvhNode> nodes;
+		std::vector<AssetLib::Model::BvhTriangle> bvhTriangles;
+	};
+
+	// Bumpy sphere surrounded by a soup of small random triangles, so the hierarchy has
+	// both a coherent surface and scattered overlapping leaves.
+	void makeScene(uint nRings, uint nSegments, uint nSoupTris, BvhTestScene& rScene)
+	{
+		for (uint i = 0; i <= nRings; ++i)
+		{
+			for (uint j = 0; j <= nSegments; ++j)
+			{
+				float fTheta = Maths::kPi * i / nRings;
+				float fPhi = Maths::kTwoPi * j / nSegments;
+				float r = 1.f + 0.05f * sinf(7.f * fTheta) * cosf(5.f * fPhi);
+				rScene.positions.push_back(Vec3(r * sinf(fTheta) * cosf(fPhi), r * cosf(fTheta), r * sinf(fTheta) * sinf(fPhi)));
+			}
+		}
+
+		for (uint i = 0; i < nRings; ++i)
+		{
+			for (uint j = 0; j < nSegments; ++j)
+			{
+				uint a = i * (nSegments + 1) + j;
+				uint b = a + 1;
+				uint c = a + nSegments + 1;
+				uint d = c + 1;
+				rScene.triangles.push_back(AssetLib::Model::BvhTriangle{ { a, c, b } });
+				rScene.triangles.push_back(AssetLib::Model::BvhTriangle{ { b, c, d } });
+			}
+		}
+
+		std::mt19937 rng(3);
+		std::uniform_real_distribution<float> dist(-1.f, 1.f);
+		for (uint i = 0; i < nSoupTris; ++i)
+		{
+			uint nBase = (uint)rScene.positions.size();
+			Vec3 vCenter(dist(rng) * 3.f, dist(rng) * 3.f, dist(rng) * 3.f);
+			for (uint k = 0; k < 3; ++k)
+			{
+				rScene.positions.push_back(vCenter + Vec3(dist(rng), dist(rng), dist(rng)) * 0.05f);
+			}
+			rScene.triangles.push_back(AssetLib::Model::BvhTriangle{ { nBase, nBase + 1, nBase + 2 } });
+		}
+
+		ModelBvh::Build(rScene.triangles, rScene.positions.data(), rScene.nodes, rScene.bvhTriangles);
+	}
+
+	// Rays from a box around the scene towards random points near its center.  Directions are not normalized.
+	void makeRays(uint nNumRays, std::vector<Vec3>& rOrigins, std::vector<Vec3>& rDirs)
+	{
+		std::mt19937 rng(5);
+		std::uniform_real_distribution<float> dist(-1.f, 1.f);
+		for (uint i = 0; i < nNumRays; ++i)
+		{
+			Vec3 vOrigin = Vec3(dist(rng), dist(rng), dist(rng)) * 4.f;
+			Vec3 vTarget(dist(rng), dist(rng), dist(rng));
+			rOrigins.push_back(vOrigin);
+			rDirs.push_back((i % 50 == 0) ? Vec3(0.f, 0.f, 1.f) : (vTarget - vOrigin) * (dist(rng) + 1.5f));
+		}
+	}
+
+	float bruteForceIntersect(const BvhTestScene& rScene, const Vec3& vOrigin, const Vec3& vDir)
+	{
+		float fClosestT = FLT_MAX;
+		for (const AssetLib::Model::BvhTriangle& tri : rScene.triangles)
+		{
+			float t;
+			if (ModelBvh::RayTriangleIntersect(vOrigin, vDir, rScene.positions[tri.anPositions[0]], rScene.positions[tri.anPositions[1]], rScene.positions[tri.anPositions[2]], &t)
+				&& t < fClosestT)
+			{
+				fClosestT = t;
+			}
+		}
+		return fClosestT;
+	}
+}
+
+TEST(ModelBvh_RayIntersectMatchesBruteForce)
+{
+	BvhTestScene scene;
+	makeScene(40, 80, 2000, scene);
+	CHECK(!scene.nodes.empty());
+	CHECK(scene.bvhTriangles.size() == scene.triangles.size());
+
+	std::vector<Vec3> rayOrigins;
+	std::vector<Vec3> rayDirs;
+	makeRays(2000, rayOrigins, rayDirs);
+
+	uint nHits = 0;
+	for (uint i = 0; i < rayOrigins.size(); ++i)
+	{
+		float fBruteT = bruteForceIntersect(scene, rayOrigins[i], rayDirs[i]);
+		float fBvhT = FLT_MAX;
+		bool bHit = ModelBvh::RayIntersect(scene.nodes.data(), scene.bvhTriangles.data(), scene.positions.data(), rayOrigins[i], rayDirs[i], &fBvhT);
+
+		// The same triangle test runs on the same data, so hits must match exactly.
+		CHECK(bHit == (fBruteT != FLT_MAX));
+		if (bHit)
+		{
+			CHECK(fBvhT == fBruteT);
+			++nHits;
+		}
+	}
+
+	// Make sure the rays exercise both outcomes.
+	CHECK(nHits > rayOrigins.size() / 4);
+	CHECK(nHits < rayOrigins.size());
+}
+
+TEST(ModelBvh_PacketMatchesSingleRays)
+{
+	BvhTestScene scene;
+	makeScene(40, 80, 2000, scene);
+
+	std::vector<Vec3> rayOrigins;
+	std::vector<Vec3> rayDirs;
+	makeRays(2000, rayOrigins, rayDirs);
+
+	for (uint nFirst = 0; nFirst < rayOrigins.size(); nFirst += ModelBvh::kRayPacketSize)
+	{
+		ModelBvh::RayPacket packet;
+		float afT[ModelBvh::kRayPacketSize];
+		for (uint k = 0; k < ModelBvh::kRayPacketSize; ++k)
+		{
+			uint i = nFirst + k;
+			packet.originX[k] = rayOrigins[i].x;
+			packet.originY[k] = rayOrigins[i].y;
+			packet.originZ[k] = rayOrigins[i].z;
+			packet.dirX[k] = rayDirs[i].x;
+			packet.dirY[k] = rayDirs[i].y;
+			packet.dirZ[k] = rayDirs[i].z;
+
+			// Every fourth packet has an inactive lane.
+			afT[k] = ((nFirst / ModelBvh::kRayPacketSize) % 4 == 0 && k == 1) ? 0.f : FLT_MAX;
+		}
+
+		uint nHitMask = ModelBvh::RayIntersectPacket(scene.nodes.data(), scene.bvhTriangles.data(), scene.positions.data(), packet, afT);
+		for (uint k = 0; k < ModelBvh::kRayPacketSize; ++k)
+		{
+			uint i = nFirst + k;
+			bool bInactive = ((nFirst / ModelBvh::kRayPacketSize) % 4 == 0 && k == 1);
+			float fSingleT = FLT_MAX;
+			bool bSingleHit = !bInactive && ModelBvh::RayIntersect(scene.nodes.data(), scene.bvhTriangles.data(), scene.positions.data(), rayOrigins[i], rayDirs[i], &fSingleT);
+
+			CHECK(((nHitMask >> k) & 1) == (bSingleHit ? 1u : 0u));
+			if (bSingleHit)
+			{
+				CHECK(afT[k] == fSingleT);
+			}
+		}
+	}
+}
+
+BENCHMARK(ModelBvh_Raycasts)
+{
+	const uint kNumRays = 200000;
+	const uint kNumBruteForceRays = 200;
+
+	BvhTestScene scene;
+	Timer::Handle hTimer = Timer::Create();
+	makeScene(200, 400, 20000, scene);
+	Timer::Reset(hTimer);
+	ModelBvh::Build(scene.triangles, scene.positions.data(), scene.nodes, scene.bvhTriangles);
+	double fBuildMs = Timer::GetElapsedMillisecondsAndReset(hTimer);
+
+	std::vector<Vec3> rayOrigins;
+	std::vector<Vec3> rayDirs;
+	makeRays(kNumRays, rayOrigins, rayDirs);
+
+	Timer::Reset(hTimer);
+	uint nHits = 0;
+	for (uint i = 0; i < kNumRays; ++i)
+	{
+		float t;
+		if (ModelBvh::RayIntersect(scene.nodes.data(), scene.bvhTriangles.data(), scene.positions.data(), rayOrigins[i], rayDirs[i], &t))
+			++nHits;
+	}
+	double fBvhSeconds = Timer::GetElapsedSecondsAndReset(hTimer);
+
+	ModelBvh::RayPacket packet;
+	float afT[ModelBvh::kRayPacketSize];
+	for (uint nFirst = 0; nFirst + ModelBvh::kRayPacketSize <= kNumRays; nFirst += ModelBvh::kRayPacketSize)
+	{
+		for (uint k = 0; k < ModelBvh::kRayPacketSize; ++k)
+		{
+			const Vec3& vOrigin = rayOrigins[nFirst + k];
+			const Vec3& vDir = rayDirs[nFirst + k];
+			packet.originX[k] = vOrigin.x; packet.originY[k] = vOrigin.y; packet.originZ[k] = vOrigin.z;
+			packet.dirX[k] = vDir.x; packet.dirY[k] = vDir.y; packet.dirZ[k] = vDir.z;
+			afT[k] = FLT_MAX;
+		}
+		ModelBvh::RayIntersectPacket(scene.nodes.data(), scene.bvhTriangles.data(), scene.positions.data(), packet, afT);
+	}
+	double fPacketSeconds = Timer::GetElapsedSecondsAndReset(hTimer);
+
+	uint nBruteForceHits = 0;
+	for (uint i = 0; i < kNumBruteForceRays; ++i)
+	{
+		if (bruteForceIntersect(scene, rayOrigins[i], rayDirs[i]) != FLT_MAX)
+			++nBruteForceHits;
+	}
+	double fBruteSeconds = Timer::GetElapsedSeconds(hTimer);
+	Timer::Release(hTimer);
+
+	printf("  %u tris, %u nodes, built in %.1f ms\n", (uint)scene.triangles.size(), (uint)scene.nodes.size(), fBuildMs);
+	printf("  single: %.2f Mrays/sec (%u/%u hit)  packet: %.2f Mrays/sec  brute force: %.4f Mrays/sec (%u/%u hit)\n",
+		kNumRays / std::max(fBvhSeconds, 1e-9) * 1e-6, nHits, kNumRays,
+		kNumRays / std::max(fPacketSeconds, 1e-9) * 1e-6,
+		kNumBruteForceRays / std::max(fBruteSeconds, 1e-9) * 1e-6, nBruteForceHits, kNumBruteForceRays);
+}
@@ -0,0 +1,223 @@
+#include "TestFramework.h"
+#include "Types.h"
+#include "MathLib/Maths.h"
+#include "render/OceanGrid.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const int kGridSize = 64;
+	const int kNumLods = 4;
+	const float kTileSize = 64.f;
+	const float kCellSize = kTileSize / kGridSize;
+
+	// Analytic periodic displacement that wraps exactly over the tile.
+	struct DisplacementWave
+	{
+		float amplitudeX;
+		float amplitudeZ;
+		float kx;
+		float kz;
+
+		float CalcDx(float x, float z) const { return amplitudeX * sinf(kx * x + kz * z); }
+		float CalcDz(float x, float z) const { return amplitudeZ * cosf(kx * x - kz * z); }
+
+		float CalcJacobian(float x, float z) const
+		{
+			float dDxdx = amplitudeX * kx * cosf(kx * x + kz * z);
+			float dDxdz = amplitudeX * kz * cosf(kx * x + kz * z);
+			float dDzdx = -amplitudeZ * kx * sinf(kx * x - kz * z);
+			float dDzdz = amplitudeZ * kz * sinf(kx * x - kz * z);
+			return (1.f + dDxdx) * (1.f + dDzdz) - dDxdz * dDzdx;
+		}
+	};
+
+	void fillDisplacement(const DisplacementWave& rWave, std::vector<float>& rDx, std::vector<float>& rDz)
+	{
+		rDx.resize(kGridSize * kGridSize);
+		rDz.resize(kGridSize * kGridSize);
+		for (int m = 0; m < kGridSize; ++m)
+		{
+			for (int n = 0; n < kGridSize; ++n)
+			{
+				rDx[m * kGridSize + n] = rWave.CalcDx(n * kCellSize, m * kCellSize);
+				rDz[m * kGridSize + n] = rWave.CalcDz(n * kCellSize, m * kCellSize);
+			}
+		}
+	}
+
+	// Flat tile positions, with skirt vertices one unit below their edge.
+	std::vector<Vec3> makeFlatPositions()
+	{
+		std::vector<Vec3> positions(OceanGrid::CalcVertexCount(kGridSize));
+		for (int m = 0; m <= kGridSize; ++m)
+		{
+			for (int n = 0; n <= kGridSize; ++n)
+			{
+				positions[OceanGrid::GetSurfaceVertexIndex(kGridSize, n, m)] = Vec3((float)n, 0.f, (float)m);
+			}
+		}
+
+		for (int edge = 0; edge < OceanGrid::kEdge_Count; ++edge)
+		{
+			for (int i = 0; i <= kGridSize; ++i)
+			{
+				Vec3 pos = positions[OceanGrid::GetEdgeVertexIndex(kGridSize, (OceanGrid::Edge)edge, i)];
+				positions[OceanGrid::GetSkirtVertexIndex(kGridSize, (OceanGrid::Edge)edge, i)] = pos - Vec3(0.f, 1.f, 0.f);
+			}
+		}
+		return positions;
+	}
+
+	// Height along the edge of a tile drawn with every step'th vertex, at a position in cells along the edge.
+	float sampleEdge(const std::vector<float>& rHeights, int step, float pos)
+	{
+		int segment = std::min((int)(pos / step), kGridSize / step - 1);
+		float t = (pos - segment * step) / step;
+		return rHeights[segment * step] + (rHeights[(segment + 1) * step] - rHeights[segment * step]) * t;
+	}
+}
+
+TEST(OceanGrid_JacobianMatchesAnalytic)
+{
+	// Central differences are second order, so the error shrinks with (k * cellSize)^2.
+	DisplacementWave wave = { 0.8f, 0.5f, 3.f * Maths::kTwoPi / kTileSize, 2.f * Maths::kTwoPi / kTileSize };
+	std::vector<float> dx, dz;
+	fillDisplacement(wave, dx, dz);
+
+	float kh = std::max(wave.kx, wave.kz) * kCellSize;
+	float tolerance = 2.f * (wave.amplitudeX + wave.amplitudeZ) * std::max(wave.kx, wave.kz) * kh * kh / 6.f + 1e-4f;
+
+	float maxError = 0.f;
+	for (int m = 0; m <= kGridSize; ++m)
+	{
+		for (int n = 0; n <= kGridSize; ++n)
+		{
+			// The last row and column wrap around to the first.
+			float jacobian = OceanGrid::CalcJacobian(dx.data(), dz.data(), kGridSize, kCellSize, n, m);
+			float expected = wave.CalcJacobian((n % kGridSize) * kCellSize, (m % kGridSize) * kCellSize);
+			maxError = std::max(maxError, fabsf(jacobian - expected));
+		}
+	}
+	CHECK(maxError <= tolerance);
+}
+
+TEST(OceanGrid_JacobianDetectsFolds)
+{
+	// Strong enough choppiness to fold the surface over in places.
+	DisplacementWave wave = { 8.f, 8.f, 2.f * Maths::kTwoPi / kTileSize, 2.f * Maths::kTwoPi / kTileSize };
+	std::vector<float> dx, dz;
+	fillDisplacement(wave, dx, dz);
+
+	int numFolds = 0;
+	int numMismatches = 0;
+	for (int m = 0; m < kGridSize; ++m)
+	{
+		for (int n = 0; n < kGridSize; ++n)
+		{
+			float jacobian = OceanGrid::CalcJacobian(dx.data(), dz.data(), kGridSize, kCellSize, n, m);
+			float expected = wave.CalcJacobian(n * kCellSize, m * kCellSize);
+			if (expected < 0.f)
+				++numFolds;
+
+			// Only compare signs away from the fold boundary where the difference error could flip them.
+			if (fabsf(expected) > 0.1f && (jacobian < 0.f) != (expected < 0.f))
+				++numMismatches;
+		}
+	}
+	CHECK(numFolds > 0);
+	CHECK(numMismatches == 0);
+}
+
+TEST(OceanGrid_LodWinding)
+{
+	std::vector<Vec3> positions = makeFlatPositions();
+	Vec3 center(kGridSize * 0.5f, 0.f, kGridSize * 0.5f);
+
+	for (int step = 1; step <= 8; step *= 2)
+	{
+		std::vector<uint> indices;
+		OceanGrid::AppendLodIndices(kGridSize, step, indices);
+
+		int numCells = kGridSize / step;
+		int numSkirtQuads = OceanGrid::kEdge_Count * numCells;
+		CHECK(indices.size() == (size_t)(numCells * numCells + numSkirtQuads) * 6);
+
+		uint numBadSurfaceTris = 0;
+		uint numBadSkirtTris = 0;
+		float surfaceArea = 0.f;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			bool bInRange = true;
+			for (int k = 0; k < 3; ++k)
+			{
+				bInRange &= (indices[i + k] < positions.size());
+			}
+			CHECK(bInRange);
+			if (!bInRange)
+				return;
+
+			const Vec3& a = positions[indices[i + 0]];
+			const Vec3& b = positions[indices[i + 1]];
+			const Vec3& c = positions[indices[i + 2]];
+			Vec3 normal = Vec3Cross(b - a, c - a);
+			Vec3 triCenter = (a + b + c) / 3.f;
+
+			if (a.y == 0.f && b.y == 0.f && c.y == 0.f)
+			{
+				// Surface triangles face up.
+				if (normal.y <= 0.f)
+					++numBadSurfaceTris;
+				surfaceArea += normal.y * 0.5f;
+			}
+			else
+			{
+				// Skirts are vertical and face away from the tile center.
+				Vec3 outwards = triCenter - center;
+				outwards.y = 0.f;
+				if (fabsf(normal.y) > 1e-6f || Vec3Dot(normal, outwards) <= 0.f)
+					++numBadSkirtTris;
+			}
+		}
+
+		CHECK(numBadSurfaceTris == 0);
+		CHECK(numBadSkirtTris == 0);
+		CHECK_NEAR(surfaceArea, (float)(kGridSize * kGridSize), 1e-3f);
+	}
+}
+
+// Where tiles of different LOD levels meet, the gap between their edges must be within the skirt depth.
+TEST(OceanGrid_SkirtsCoverLodCracks)
+{
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> slopeDist(-1.f, 1.f);
+	const float skirtDepth = OceanGrid::CalcSkirtDepth(kCellSize, kNumLods);
+
+	for (int trial = 0; trial < 100; ++trial)
+	{
+		// Random edge profile that is never steeper than 45 degrees.
+		std::vector<float> heights(kGridSize + 1);
+		heights[0] = 0.f;
+		for (int i = 1; i <= kGridSize; ++i)
+		{
+			heights[i] = heights[i - 1] + slopeDist(rng) * kCellSize;
+		}
+
+		float maxGap = 0.f;
+		for (int fineLod = 0; fineLod < kNumLods; ++fineLod)
+		{
+			for (int coarseLod = fineLod + 1; coarseLod < kNumLods; ++coarseLod)
+			{
+				for (int sample = 0; sample <= kGridSize * 4; ++sample)
+				{
+					float pos = sample * 0.25f;
+					float gap = fabsf(sampleEdge(heights, 1 << fineLod, pos) - sampleEdge(heights, 1 << coarseLod, pos));
+					maxGap = std::max(maxGap, gap);
+				}
+			}
+		}
+		CHECK(maxGap <= skirtDepth);
+	}
+}
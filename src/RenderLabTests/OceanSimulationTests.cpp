@@ -0,0 +1,147 @@
+#include "TestFramework.h"
+#include "Types.h"
+#include "MathLib/Maths.h"
+#include "render/OceanSimulation.h"
+#include "render/OceanGrid.h"
+#include "UtilsLib/JobPool.h"
+#include "UtilsLib/Timer.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const int kNumLods = 4;
+	const float kTileSize = 64.f;
+	const float kWaveHeightScalar = 0.000015f;
+	const float kStepTime = 1.f / 30.f;
+
+	// The spectrum is seeded from rand(), so reseed to get the same waves for every simulation.
+	void initSimulation(OceanSimulation& rSimulation, int gridSize)
+	{
+		srand(7);
+		rSimulation.Init(gridSize, kTileSize, kWaveHeightScalar, Vec2(4.f, 3.f),
+			OceanGrid::CalcSkirtDepth(kTileSize / gridSize, kNumLods));
+	}
+
+	struct SimulationState
+	{
+		std::vector<OceanVertex> vertices;
+		std::vector<Vec3> samples;
+
+		void Resize(int gridSize)
+		{
+			vertices.resize(OceanGrid::CalcVertexCount(gridSize));
+			samples.resize(gridSize * gridSize);
+		}
+	};
+}
+
+TEST(OceanSimulation_PoolMatchesSingleThread)
+{
+	const int kGridSize = 128;
+
+	OceanSimulation simulation;
+	initSimulation(simulation, kGridSize);
+
+	SimulationState singleThread;
+	SimulationState pooled;
+	singleThread.Resize(kGridSize);
+	pooled.Resize(kGridSize);
+
+	// Every stage writes disjoint rows or columns, so the split must not change the result.
+	JobPool::SetMaxThreadCount(1);
+	simulation.Simulate(2.5f, singleThread.vertices.data(), singleThread.samples.data());
+	JobPool::SetMaxThreadCount(0);
+	simulation.Simulate(2.5f, pooled.vertices.data(), pooled.samples.data());
+
+	CHECK(memcmp(singleThread.vertices.data(), pooled.vertices.data(), singleThread.vertices.size() * sizeof(OceanVertex)) == 0);
+	CHECK(memcmp(singleThread.samples.data(), pooled.samples.data(), singleThread.samples.size() * sizeof(Vec3)) == 0);
+}
+
+TEST(OceanSimulation_InterpolateEndpoints)
+{
+	const int kGridSize = 64;
+
+	OceanSimulation simulation;
+	initSimulation(simulation, kGridSize);
+
+	SimulationState states[3];
+	for (SimulationState& rState : states)
+	{
+		rState.Resize(kGridSize);
+	}
+	simulation.Simulate(1.f, states[0].vertices.data(), states[0].samples.data());
+	simulation.Simulate(1.f + kStepTime, states[1].vertices.data(), states[1].samples.data());
+
+	for (float t : { 0.f, 1.f })
+	{
+		simulation.Interpolate(states[0].vertices.data(), states[1].vertices.data(), states[0].samples.data(), states[1].samples.data(),
+			t, states[2].vertices.data(), states[2].samples.data());
+
+		const SimulationState& rExpected = states[t == 0.f ? 0 : 1];
+		float maxError = 0.f;
+		for (size_t i = 0; i < rExpected.vertices.size(); ++i)
+		{
+			maxError = std::max(maxError, Vec3Length(states[2].vertices[i].position - rExpected.vertices[i].position));
+		}
+		for (size_t i = 0; i < rExpected.samples.size(); ++i)
+		{
+			maxError = std::max(maxError, Vec3Length(states[2].samples[i] - rExpected.samples[i]));
+		}
+		CHECK_NEAR(maxError, 0.f, 1e-5f);
+	}
+}
+
+BENCHMARK(OceanSimulation_Update)
+{
+	// One fixed rate step as run by Ocean::Update(): simulate the new state and blend it with the previous one.
+	Timer::Handle hTimer = Timer::Create();
+	printf("  Job pool threads: %u\n", JobPool::GetThreadCount());
+	for (int size = 64; size <= 512; size *= 2)
+	{
+		OceanSimulation simulation;
+		initSimulation(simulation, size);
+
+		SimulationState states[3];
+		for (SimulationState& rState : states)
+		{
+			rState.Resize(size);
+		}
+		simulation.Simulate(0.f, states[0].vertices.data(), states[0].samples.data());
+
+		// Roughly the same amount of work at each size.
+		int numIterations = std::max(4, (1 << 21) / (size * size));
+
+		double stepSeconds[2];
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			// First pass is a single worker (the calling thread), second is the full pool.
+			JobPool::SetMaxThreadCount(pass == 0 ? 1 : 0);
+
+			double simulateSeconds = 0.0;
+			double interpolateSeconds = 0.0;
+			for (int i = 0; i < numIterations; ++i)
+			{
+				Timer::Reset(hTimer);
+				simulation.Simulate((i + 1) * kStepTime, states[1].vertices.data(), states[1].samples.data());
+				simulateSeconds += Timer::GetElapsedSeconds(hTimer);
+
+				Timer::Reset(hTimer);
+				simulation.Interpolate(states[0].vertices.data(), states[1].vertices.data(), states[0].samples.data(), states[1].samples.data(),
+					0.5f, states[2].vertices.data(), states[2].samples.data());
+				interpolateSeconds += Timer::GetElapsedSeconds(hTimer);
+			}
+
+			stepSeconds[pass] = simulateSeconds + interpolateSeconds;
+			printf("  %dx%d %s: %.3f ms per step (simulate %.3f ms, interpolate %.3f ms)\n",
+				size, size, pass == 0 ? "1 thread " : "job pool",
+				stepSeconds[pass] * 1000.0 / numIterations,
+				simulateSeconds * 1000.0 / numIterations, interpolateSeconds * 1000.0 / numIterations);
+		}
+		printf("  %dx%d speedup: %.2fx\n", size, size, stepSeconds[0] / std::max(stepSeconds[1], 1e-9));
+	}
+	JobPool::SetMaxThreadCount(0);
+	Timer::Release(hTimer);
+}
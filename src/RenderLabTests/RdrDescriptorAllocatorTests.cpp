@@ -0,0 +1,178 @@
+#include "TestFramework.h"
+#include "Types.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "render/RdrDescriptorAllocator.h"
+
+namespace
+{
+	const uint kInvalidOffset = RdrDescriptorAllocator::kInvalidOffset;
+
+	struct LiveAllocation
+	{
+		uint offset;
+		uint size;
+	};
+
+	// Draws sizes like the renderer's: mostly single views, then material and compute tables of up to 16.
+	uint randomTableSize(std::mt19937& rRng)
+	{
+		uint r = rRng() % 100;
+		if (r < 55)
+			return 1;
+		if (r < 75)
+			return 2 + rRng() % 3;
+		if (r < 92)
+			return 5 + rRng() % 4;
+		return 9 + rRng() % 8;
+	}
+}
+
+TEST(RdrDescriptorAllocator_CoalescesFreedRanges)
+{
+	RdrDescriptorAllocator allocator;
+	allocator.Init(100);
+
+	uint first = allocator.Allocate(30);
+	uint second = allocator.Allocate(70);
+	CHECK(first == 0 && second == 30);
+	CHECK(allocator.Allocate(1) == kInvalidOffset);
+	CHECK(allocator.GetStats().failedAllocations == 1);
+
+	// An exact fit is found in the freed space.
+	allocator.Free(first);
+	CHECK(allocator.Allocate(30) == 0);
+	CHECK(allocator.GetAllocationSize(0) == 30);
+
+	allocator.Free(0);
+	allocator.Free(second);
+	RdrDescriptorAllocator::Stats stats = allocator.GetStats();
+	CHECK(stats.freeRanges == 1);
+	CHECK(stats.largestFreeRange == 100);
+	CHECK(stats.liveAllocations == 0);
+
+	// Tables fill the whole heap with no space lost to bucketing.
+	allocator.Init(16 * 1000);
+	uint numTables = 0;
+	while (allocator.Allocate(16) != kInvalidOffset)
+	{
+		++numTables;
+	}
+	CHECK(numTables == 1000);
+}
+
+// Grows and shrinks the live set repeatedly with renderer-like table sizes, checking every allocation against an
+// ownership map and the stats against a brute force scan of the heap.
+TEST(RdrDescriptorAllocator_Churn)
+{
+	// The size of the old fixed buckets: 8000 single descriptors and 1024 tables each of 2, 4, and 8.
+	const uint kCapacity = 8000 + 1024 * (2 + 4 + 8);
+	RdrDescriptorAllocator allocator;
+	allocator.Init(kCapacity);
+
+	std::mt19937 rng(1234);
+	std::vector<bool> owned(kCapacity, false);
+	std::vector<LiveAllocation> liveAllocations;
+	uint numOverlaps = 0;
+	uint numBadAllocations = 0;
+	uint numBadStats = 0;
+	uint numFailedAllocations = 0;
+	uint numIterations = 0;
+	for (int phase = 0; phase < 40; ++phase)
+	{
+		uint targetAllocations = (phase % 2 == 0) ? 3000 + rng() % 3000 : 200 + rng() % 500;
+		for (int i = 0; i < 20000; ++i, ++numIterations)
+		{
+			bool bAllocate = (liveAllocations.size() < targetAllocations) ? (rng() % 4 != 0) : (rng() % 4 == 0);
+			if (bAllocate)
+			{
+				uint size = randomTableSize(rng);
+				uint offset = allocator.Allocate(size);
+				if (offset == kInvalidOffset)
+				{
+					++numFailedAllocations;
+					continue;
+				}
+
+				if (offset + size > kCapacity || allocator.GetAllocationSize(offset) != size)
+				{
+					++numBadAllocations;
+					continue;
+				}
+
+				for (uint k = offset; k < offset + size; ++k)
+				{
+					if (owned[k])
+						++numOverlaps;
+					owned[k] = true;
+				}
+
+				LiveAllocation allocation = { offset, size };
+				liveAllocations.push_back(allocation);
+			}
+			else if (!liveAllocations.empty())
+			{
+				uint index = rng() % liveAllocations.size();
+				LiveAllocation allocation = liveAllocations[index];
+				liveAllocations[index] = liveAllocations.back();
+				liveAllocations.pop_back();
+
+				std::fill(owned.begin() + allocation.offset, owned.begin() + allocation.offset + allocation.size, false);
+				allocator.Free(allocation.offset);
+			}
+
+			if ((numIterations & 1023) == 0)
+			{
+				uint liveDescriptors = 0;
+				for (const LiveAllocation& rAllocation : liveAllocations)
+				{
+					liveDescriptors += rAllocation.size;
+				}
+
+				// Free neighbors are always merged, so every run of free descriptors is exactly one free range.
+				uint largestRun = 0;
+				uint numRuns = 0;
+				uint runLength = 0;
+				for (uint k = 0; k < kCapacity; ++k)
+				{
+					if (owned[k])
+					{
+						runLength = 0;
+						continue;
+					}
+
+					if (runLength == 0)
+						++numRuns;
+					++runLength;
+					largestRun = std::max(largestRun, runLength);
+				}
+
+				RdrDescriptorAllocator::Stats stats = allocator.GetStats();
+				if (stats.liveDescriptors != liveDescriptors
+					|| stats.liveAllocations != liveAllocations.size()
+					|| stats.freeDescriptors + stats.liveDescriptors != kCapacity
+					|| stats.largestFreeRange != largestRun
+					|| stats.freeRanges != numRuns)
+				{
+					++numBadStats;
+				}
+			}
+		}
+	}
+
+	CHECK(numOverlaps == 0);
+	CHECK(numBadAllocations == 0);
+	CHECK(numBadStats == 0);
+	CHECK(numFailedAllocations == 0);
+
+	// Freeing everything merges the heap back into a single range.
+	for (const LiveAllocation& rAllocation : liveAllocations)
+	{
+		allocator.Free(rAllocation.offset);
+	}
+	RdrDescriptorAllocator::Stats stats = allocator.GetStats();
+	CHECK(stats.freeRanges == 1);
+	CHECK(stats.largestFreeRange == kCapacity);
+	CHECK(stats.liveDescriptors == 0);
+}
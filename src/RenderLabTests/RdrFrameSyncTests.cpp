@@ -0,0 +1,166 @@
+#include "TestFramework.h"
+#include "Types.h"
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include "render/RdrFrameSync.h"
+
+// Frame state contents are plain memory handed between the threads only by RdrFrameSync, as in the renderer, so
+// building the tests with a race detector (e.g. -fsanitize=thread) also checks that the hand-offs synchronize.
+namespace
+{
+	const uint kMaxFrameStates = 4;
+
+	struct FrameState
+	{
+		int64 frameNum;
+		std::vector<int64> commands;
+	};
+
+	struct FrameSyncContext
+	{
+		RdrFrameSync sync;
+		FrameState states[kMaxFrameStates];
+		std::atomic<bool> drawing[kMaxFrameStates];
+		int64 numFrames;
+
+		// Written by the render thread, read after it is joined.
+		uint numOutOfOrderFrames;
+		uint numBadCommands;
+	};
+
+	// Spikes on either thread are absorbed by the queue or stall the other thread, depending on the state count.
+	void simulateWork(std::mt19937& rRng)
+	{
+		uint r = rRng() % 50;
+		if (r == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(500));
+		}
+		else if (r < 10)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void renderThreadMain(FrameSyncContext* pContext)
+	{
+		std::mt19937 rng(7);
+		int64 expectedFrame = 0;
+		uint state;
+		while (expectedFrame < pContext->numFrames && pContext->sync.BeginRenderFrame(state))
+		{
+			pContext->drawing[state] = true;
+
+			const FrameState& rState = pContext->states[state];
+			if (rState.frameNum != expectedFrame)
+				++pContext->numOutOfOrderFrames;
+			for (int64 command : rState.commands)
+			{
+				if (command != rState.frameNum)
+					++pContext->numBadCommands;
+			}
+			simulateWork(rng);
+
+			pContext->drawing[state] = false;
+			pContext->sync.EndRenderFrame();
+			++expectedFrame;
+		}
+	}
+}
+
+TEST(RdrFrameSync_DrawsFramesInSubmitOrder)
+{
+	for (uint numStates = RdrFrameSync::kMinFrameStates; numStates <= kMaxFrameStates; ++numStates)
+	{
+		FrameSyncContext context;
+		context.sync.Init(numStates);
+		context.numFrames = 2000;
+		context.numOutOfOrderFrames = 0;
+		context.numBadCommands = 0;
+		for (uint i = 0; i < kMaxFrameStates; ++i)
+		{
+			context.states[i].frameNum = -1;
+			context.drawing[i] = false;
+		}
+
+		std::thread renderThread(renderThreadMain, &context);
+
+		// The main thread never queues into the state being drawn.
+		std::mt19937 rng(numStates);
+		uint numQueuesIntoDrawnState = 0;
+		uint queueState = context.sync.GetQueueState();
+		for (int64 frame = 0; frame < context.numFrames; ++frame)
+		{
+			if (queueState >= numStates || context.drawing[queueState])
+			{
+				// Stop the render thread rather than leave it waiting for frames that won't come.
+				++numQueuesIntoDrawnState;
+				context.sync.Shutdown();
+				break;
+			}
+
+			FrameState& rState = context.states[queueState];
+			rState.frameNum = frame;
+			rState.commands.assign(1 + rng() % 32, frame);
+			simulateWork(rng);
+
+			if (context.drawing[queueState])
+				++numQueuesIntoDrawnState;
+
+			queueState = context.sync.SubmitFrame();
+			CHECK(context.sync.GetStats().queuedFrames <= numStates);
+		}
+
+		renderThread.join();
+		context.sync.Shutdown();
+
+		CHECK(numQueuesIntoDrawnState == 0);
+		CHECK(context.numOutOfOrderFrames == 0);
+		CHECK(context.numBadCommands == 0);
+	}
+}
+
+TEST(RdrFrameSync_ShutdownWakesWaitingThreads)
+{
+	// The render thread is waiting for a frame that never comes.
+	{
+		RdrFrameSync sync;
+		sync.Init(3);
+
+		std::atomic<int> result(-1);
+		std::thread renderThread([&sync, &result]
+			{
+				uint state;
+				result = sync.BeginRenderFrame(state) ? 1 : 0;
+			});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		CHECK(result == -1);
+		sync.Shutdown();
+		renderThread.join();
+		CHECK(result == 0);
+	}
+
+	// The main thread is waiting for a free state while the render thread is stuck.
+	{
+		RdrFrameSync sync;
+		sync.Init(2);
+
+		std::atomic<bool> bSubmitted(false);
+		std::thread mainThread([&sync, &bSubmitted]
+			{
+				sync.SubmitFrame();
+				sync.SubmitFrame();
+				bSubmitted = true;
+			});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		CHECK(!bSubmitted);
+		sync.Shutdown();
+		mainThread.join();
+		CHECK(bSubmitted);
+	}
+}
@@ -0,0 +1,128 @@
+#include "TestFramework.h"
+#include "Types.h"
+#include <deque>
+#include <random>
+#include <vector>
+#include "render/RdrInstanceIdRing.h"
+
+namespace
+{
+	const uint kIdsPerBlock = RdrInstanceIdRing::kIdsPerBlock;
+}
+
+TEST(RdrInstanceIdRing_PacksListsOnBlockBoundaries)
+{
+	RdrInstanceIdRing ring;
+	ring.Init(4);
+	ring.BeginFrame(2, 0);
+
+	uint offset;
+	CHECK(ring.GetListCapacity(100, offset) == 100);
+	CHECK(offset == 0);
+	ring.CommitList(offset, 100);
+
+	// The next list starts on the block after the two the first one used, and is limited to the rest of the ring.
+	CHECK(ring.GetListCapacity(2048, offset) == 2 * kIdsPerBlock);
+	CHECK(offset == 2 * kIdsPerBlock);
+	ring.CommitList(offset, 3);
+
+	// Committing an empty list gives its space back.
+	CHECK(ring.GetListCapacity(2, offset) == 2);
+	CHECK(offset == 3 * kIdsPerBlock);
+	ring.CommitList(offset, 0);
+	CHECK(ring.GetListCapacity(2, offset) == 2);
+	CHECK(offset == 3 * kIdsPerBlock);
+	ring.CommitList(offset, 2);
+
+	CHECK(ring.GetStats().listsThisFrame == 3);
+	CHECK(ring.GetStats().idsThisFrame == 105);
+	CHECK(ring.GetStats().blocksInUse == 4);
+
+	// The ring is full until the frame that filled it completes.
+	CHECK(ring.GetListCapacity(2, offset) == 0);
+	ring.BeginFrame(3, 1);
+	CHECK(ring.GetListCapacity(2, offset) == 0);
+	CHECK(ring.GetStats().failedLists == 2);
+
+	ring.BeginFrame(4, 2);
+	CHECK(ring.GetListCapacity(4 * kIdsPerBlock, offset) == 4 * kIdsPerBlock);
+	CHECK(offset == 0);
+}
+
+TEST(RdrInstanceIdRing_WrapsAroundInFlightFrames)
+{
+	RdrInstanceIdRing ring;
+	ring.Init(8);
+	uint offset;
+
+	ring.BeginFrame(2, 0);
+	ring.GetListCapacity(5 * kIdsPerBlock, offset);
+	ring.CommitList(offset, 5 * kIdsPerBlock);
+
+	ring.BeginFrame(3, 1);
+	ring.GetListCapacity(2 * kIdsPerBlock, offset);
+	CHECK(offset == 5 * kIdsPerBlock);
+	ring.CommitList(offset, 2 * kIdsPerBlock);
+
+	// Frame 2 is done, so a list that doesn't fit in the last block wraps to the start, skipping that block.
+	ring.BeginFrame(4, 2);
+	CHECK(ring.GetListCapacity(3 * kIdsPerBlock, offset) == 3 * kIdsPerBlock);
+	CHECK(offset == 0);
+	ring.CommitList(offset, 3 * kIdsPerBlock);
+	CHECK(ring.GetStats().blocksInUse == 2 + 1 + 3);
+
+	// Lists stop short of frame 3's blocks.
+	CHECK(ring.GetListCapacity(3 * kIdsPerBlock, offset) == 2 * kIdsPerBlock);
+	CHECK(offset == 3 * kIdsPerBlock);
+}
+
+// Random lists with a random GPU latency.  Blocks are never handed out while a frame the GPU may still be reading
+// owns them, and lists within a frame never overlap.
+TEST(RdrInstanceIdRing_NeverOverwritesInFlightFrames)
+{
+	std::mt19937 rng(1);
+	uint numOverwrites = 0;
+	uint numBadLists = 0;
+	uint numLists = 0;
+	for (int trial = 0; trial < 200; ++trial)
+	{
+		uint numBlocks = 1 + rng() % 64;
+		uint latency = 1 + rng() % 3;
+		RdrInstanceIdRing ring;
+		ring.Init(numBlocks);
+
+		// Frame that last wrote each block.
+		std::vector<int64> blockFrames(numBlocks, -1000);
+		for (uint64 frame = latency; frame < latency + 300; ++frame)
+		{
+			uint64 completedFrame = frame - latency;
+			ring.BeginFrame(frame, completedFrame);
+
+			int numFrameLists = rng() % 12;
+			for (int i = 0; i < numFrameLists; ++i)
+			{
+				uint maxIds = 1 + rng() % ((rng() % 2) ? 4 * kIdsPerBlock : 2048);
+				uint offset;
+				uint capacity = ring.GetListCapacity(maxIds, offset);
+				if (capacity == 0)
+					continue;
+
+				if (capacity > maxIds || offset % kIdsPerBlock != 0 || offset + capacity > ring.GetCapacity())
+					++numBadLists;
+
+				uint numIds = (rng() % 4 == 0) ? 0 : 1 + rng() % capacity;
+				for (uint block = offset / kIdsPerBlock; block < (offset + numIds + kIdsPerBlock - 1) / kIdsPerBlock; ++block)
+				{
+					if (blockFrames[block] > (int64)completedFrame)
+						++numOverwrites;
+					blockFrames[block] = (int64)frame;
+				}
+				ring.CommitList(offset, numIds);
+				++numLists;
+			}
+		}
+	}
+	CHECK(numLists > 0);
+	CHECK(numBadLists == 0);
+	CHECK(numOverwrites == 0);
+}
@@ -0,0 +1,310 @@
+#include "TestFramework.h"
+#include "Types.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+#include "MathLib/Maths.h"
+#include "FreeList.h"
+#include "GlobalState.h"
+#include "UserConfig.h"
+#include "render/RdrPipelineStateCache.h"
+#include "render/RdrShaders.h"
+
+namespace
+{
+	const char* kRecordFilename = "RenderLabTests_pipelinestates.bin";
+
+	// Stub device that hands out empty pipeline states and tracks which are alive.
+	struct StubDevice
+	{
+		std::set<RdrPipelineState*> liveStates;
+		uint numCreated;
+		uint numBadReleases;
+	} s_device;
+
+	// Shaders known to the stub shader system.
+	std::vector<RdrShader*> s_shaders;
+	bool s_bShadersMissing = false;
+
+	RdrPipelineState* stubCreateGraphicsPipelineState(
+		const RdrShader*, const RdrShader*, const RdrShader*, const RdrShader*,
+		const RdrVertexInputElement*, uint, const RdrResourceFormat*, uint,
+		const RdrBlendMode, const RdrRasterState&, const RdrDepthStencilState&)
+	{
+		RdrPipelineState* pPipelineState = new RdrPipelineState();
+		s_device.liveStates.insert(pPipelineState);
+		++s_device.numCreated;
+		return pPipelineState;
+	}
+
+	void stubReleasePipelineState(RdrPipelineState* pPipelineState)
+	{
+		if (s_device.liveStates.erase(pPipelineState) == 0)
+		{
+			++s_device.numBadReleases;
+			return;
+		}
+		delete pPipelineState;
+	}
+
+	const RdrShader* stubFindShader(RdrShaderStage eStage, const char* filename, const char** aDefines, uint numDefines)
+	{
+		if (s_bShadersMissing)
+			return nullptr;
+
+		for (const RdrShader* pShader : s_shaders)
+		{
+			if (pShader->eStage != eStage || strcmp(pShader->filename, filename) != 0 || pShader->defines.size() != numDefines)
+				continue;
+
+			bool bDefinesMatch = true;
+			for (uint i = 0; i < numDefines; ++i)
+			{
+				bDefinesMatch &= (strcmp(pShader->defines[i], aDefines[i]) == 0);
+			}
+
+			if (bDefinesMatch)
+				return pShader;
+		}
+		return nullptr;
+	}
+
+	RdrShader* addShader(RdrShaderStage eStage, const char* filename, const std::vector<const char*>& defines)
+	{
+		RdrShader* pShader = new RdrShader();
+		pShader->filename = filename;
+		pShader->eStage = eStage;
+		pShader->defines = defines;
+		s_shaders.push_back(pShader);
+		return pShader;
+	}
+
+	// Starts a run of the renderer with the stubs in place and the record from the previous run, if any.
+	void startRun()
+	{
+		RdrPipelineStateCache::Backend backend;
+		backend.createGraphicsPipelineState = stubCreateGraphicsPipelineState;
+		backend.releasePipelineState = stubReleasePipelineState;
+		backend.findShader = stubFindShader;
+		backend.recordFilename = kRecordFilename;
+		RdrPipelineStateCache::SetBackend(backend);
+
+		g_userConfig.prewarmPipelineStates = true;
+		g_debugState.msaaLevel = 4;
+		s_device.numCreated = 0;
+		s_device.numBadReleases = 0;
+		RdrPipelineStateCache::Init();
+	}
+
+	void endRun()
+	{
+		RdrPipelineStateCache::Save();
+		RdrPipelineStateCache::Shutdown();
+	}
+
+	void cleanup()
+	{
+		for (RdrShader* pShader : s_shaders)
+		{
+			delete pShader;
+		}
+		s_shaders.clear();
+		std::remove(kRecordFilename);
+	}
+
+	// A material's worth of pipeline state inputs.
+	struct StateDesc
+	{
+		const RdrShader* pVertexShader;
+		const RdrShader* pPixelShader;
+		std::vector<RdrVertexInputElement> inputLayout;
+		std::vector<RdrResourceFormat> rtvFormats;
+		RdrBlendMode eBlendMode;
+		RdrRasterState rasterState;
+		RdrDepthStencilState depthStencilState;
+	};
+
+	RdrPipelineState* getState(const StateDesc& rDesc)
+	{
+		return RdrPipelineStateCache::GetGraphicsPipelineState(rDesc.pVertexShader, rDesc.pPixelShader, nullptr, nullptr,
+			rDesc.inputLayout.data(), (uint)rDesc.inputLayout.size(),
+			rDesc.rtvFormats.data(), (uint)rDesc.rtvFormats.size(),
+			rDesc.eBlendMode, rDesc.rasterState, rDesc.depthStencilState);
+	}
+
+	std::vector<StateDesc> makeStateDescs()
+	{
+		const RdrShader* pModelVs = addShader(RdrShaderStage::Vertex, "v_model.hlsl", {});
+		const RdrShader* pInstancedVs = addShader(RdrShaderStage::Vertex, "v_model.hlsl", { "IS_INSTANCED" });
+		const RdrShader* pOpaquePs = addShader(RdrShaderStage::Pixel, "p_model.hlsl", {});
+		const RdrShader* pCutoutPs = addShader(RdrShaderStage::Pixel, "p_model.hlsl", { "ALPHA_CUTOUT" });
+
+		StateDesc desc;
+		desc.pVertexShader = pModelVs;
+		desc.pPixelShader = pOpaquePs;
+		desc.inputLayout.push_back({ RdrShaderSemantic::Position, 0, RdrVertexInputFormat::RGB_F32, 0, 0, RdrVertexInputClass::PerVertex, 0 });
+		desc.inputLayout.push_back({ RdrShaderSemantic::Texcoord, 0, RdrVertexInputFormat::RG_F32, 0, 12, RdrVertexInputClass::PerVertex, 0 });
+		desc.rtvFormats.push_back(RdrResourceFormat::R16G16B16A16_FLOAT);
+		desc.eBlendMode = RdrBlendMode::kOpaque;
+		memset(&desc.rasterState, 0, sizeof(desc.rasterState));
+		desc.rasterState.bEnableMSAA = true;
+		desc.depthStencilState = RdrDepthStencilState(true, true, RdrComparisonFunc::Less);
+
+		std::vector<StateDesc> descs;
+		descs.push_back(desc);
+
+		desc.pPixelShader = pCutoutPs;
+		descs.push_back(desc);
+
+		desc.pVertexShader = pInstancedVs;
+		desc.inputLayout.pop_back();
+		desc.rtvFormats.clear();
+		desc.eBlendMode = RdrBlendMode::kAlpha;
+		desc.depthStencilState = RdrDepthStencilState(true, false, RdrComparisonFunc::LessEqual);
+		descs.push_back(desc);
+
+		return descs;
+	}
+}
+
+TEST(RdrPipelineStateCache_SharesIdenticalStates)
+{
+	cleanup();
+	startRun();
+	std::vector<StateDesc> descs = makeStateDescs();
+
+	RdrPipelineState* pState = getState(descs[0]);
+	CHECK(s_device.numCreated == 1);
+
+	// Uninitialized raster state bits, as in materials, don't split the key.
+	StateDesc garbageDesc = descs[0];
+	memset(&garbageDesc.rasterState, 0xcd, sizeof(garbageDesc.rasterState));
+	garbageDesc.rasterState.bEnableMSAA = true;
+	garbageDesc.rasterState.bEnableScissor = false;
+	garbageDesc.rasterState.bWireframe = false;
+	garbageDesc.rasterState.bUseSlopeScaledDepthBias = false;
+	garbageDesc.rasterState.bDoubleSided = false;
+	CHECK(getState(garbageDesc) == pState);
+	CHECK(s_device.numCreated == 1);
+
+	// Any difference in the description is a different state, including the global MSAA level.
+	RdrPipelineState* pCutoutState = getState(descs[1]);
+	RdrPipelineState* pAlphaState = getState(descs[2]);
+	CHECK(pCutoutState != pState && pAlphaState != pState && pAlphaState != pCutoutState);
+
+	g_debugState.msaaLevel = 2;
+	RdrPipelineState* pLowMsaaState = getState(descs[0]);
+	CHECK(pLowMsaaState != pState);
+	g_debugState.msaaLevel = 4;
+	CHECK(s_device.numCreated == 4);
+
+	RdrPipelineStateCache::Stats stats = RdrPipelineStateCache::GetStats();
+	CHECK(stats.hits == 1);
+	CHECK(stats.misses == 4);
+	CHECK(stats.liveStates == 4);
+
+	// States are destroyed when their last reference is released.
+	RdrPipelineStateCache::ReleasePipelineState(pState);
+	CHECK(s_device.liveStates.count(pState) == 1);
+	RdrPipelineStateCache::ReleasePipelineState(pState);
+	CHECK(s_device.liveStates.count(pState) == 0);
+	CHECK(RdrPipelineStateCache::GetStats().liveStates == 3);
+
+	// States that didn't come from the cache are released directly.
+	RdrPipelineState* pUncachedState = stubCreateGraphicsPipelineState(nullptr, nullptr, nullptr, nullptr,
+		nullptr, 0, nullptr, 0, RdrBlendMode::kOpaque, descs[0].rasterState, descs[0].depthStencilState);
+	RdrPipelineStateCache::ReleasePipelineState(pUncachedState);
+	CHECK(s_device.liveStates.count(pUncachedState) == 0);
+
+	RdrPipelineStateCache::ReleasePipelineState(pCutoutState);
+	RdrPipelineStateCache::ReleasePipelineState(pAlphaState);
+	RdrPipelineStateCache::ReleasePipelineState(pLowMsaaState);
+	CHECK(s_device.liveStates.empty());
+	CHECK(s_device.numBadReleases == 0);
+
+	RdrPipelineStateCache::Shutdown();
+	cleanup();
+}
+
+TEST(RdrPipelineStateCache_PrewarmsRecordedStates)
+{
+	cleanup();
+	std::vector<StateDesc> descs = makeStateDescs();
+
+	// First run: nothing is recorded, so every state is created on first use.
+	startRun();
+	CHECK(RdrPipelineStateCache::GetStats().prewarmed == 0);
+	std::vector<RdrPipelineState*> states;
+	for (const StateDesc& rDesc : descs)
+	{
+		states.push_back(getState(rDesc));
+	}
+	CHECK(s_device.numCreated == descs.size());
+	for (RdrPipelineState* pState : states)
+	{
+		RdrPipelineStateCache::ReleasePipelineState(pState);
+	}
+	endRun();
+	CHECK(s_device.liveStates.empty());
+
+	// Second run: the recorded states are created during Init() and shared with later requests.
+	startRun();
+	RdrPipelineStateCache::Stats stats = RdrPipelineStateCache::GetStats();
+	CHECK(stats.prewarmed == descs.size());
+	CHECK(stats.failedPrewarms == 0);
+	CHECK(s_device.numCreated == descs.size());
+
+	states.clear();
+	for (const StateDesc& rDesc : descs)
+	{
+		states.push_back(getState(rDesc));
+	}
+	CHECK(s_device.numCreated == descs.size());
+	CHECK(RdrPipelineStateCache::GetStats().hits == descs.size());
+	CHECK(RdrPipelineStateCache::GetStats().misses == 0);
+
+	// Prewarmed states keep the cache's reference after materials release them.
+	for (RdrPipelineState* pState : states)
+	{
+		RdrPipelineStateCache::ReleasePipelineState(pState);
+	}
+	CHECK(s_device.liveStates.size() == descs.size());
+	endRun();
+	CHECK(s_device.liveStates.empty());
+
+	// States whose shaders no longer exist are skipped.
+	s_bShadersMissing = true;
+	startRun();
+	stats = RdrPipelineStateCache::GetStats();
+	CHECK(stats.prewarmed == 0);
+	CHECK(stats.failedPrewarms == descs.size());
+	RdrPipelineStateCache::Shutdown();
+	s_bShadersMissing = false;
+
+	// A truncated record still prewarms the states before the damage.
+	std::vector<char> record;
+	{
+		std::ifstream file(kRecordFilename, std::ios::binary);
+		record.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	CHECK(record.size() > 8);
+	record.resize(record.size() - 8);
+	{
+		std::ofstream file(kRecordFilename, std::ios::binary | std::ios::trunc);
+		file.write(record.data(), record.size());
+	}
+
+	startRun();
+	stats = RdrPipelineStateCache::GetStats();
+	CHECK(stats.prewarmed == descs.size() - 1);
+	CHECK(s_device.numCreated == descs.size() - 1);
+	RdrPipelineStateCache::Shutdown();
+	CHECK(s_device.liveStates.empty());
+	CHECK(s_device.numBadReleases == 0);
+
+	cleanup();
+}
@@ -0,0 +1,136 @@
+#include "TestFramework.h"
+#include "Types.h"
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+#include "render/RdrReadbackPool.h"
+
+namespace
+{
+	struct InFlightRequest
+	{
+		uint buffer;
+		uint64 frameNum;
+	};
+}
+
+TEST(RdrReadbackPool_ReusesCompletedBuffers)
+{
+	CHECK(RdrReadbackPool::CalcBucketSize(1) == 256);
+	CHECK(RdrReadbackPool::CalcBucketSize(256) == 256);
+	CHECK(RdrReadbackPool::CalcBucketSize(257) == 512);
+	CHECK(RdrReadbackPool::CalcBucketSize(5000) == 8192);
+
+	RdrReadbackPool pool;
+	CHECK(pool.Acquire(16, 100) == RdrReadbackPool::kInvalidBuffer);
+
+	uint buffer = pool.AddBuffer(16, 42);
+	CHECK(pool.GetResourceId(buffer) == 42);
+
+	// Buffers are only handed out again from the same bucket once the GPU is done with them.
+	pool.Release(buffer, 10);
+	CHECK(pool.Acquire(16, 9) == RdrReadbackPool::kInvalidBuffer);
+	CHECK(pool.Acquire(300, 10) == RdrReadbackPool::kInvalidBuffer);
+	CHECK(pool.Acquire(200, 10) == buffer);
+	pool.Release(buffer, 12);
+
+	std::vector<uint> evictedIds;
+	pool.Trim(12, evictedIds);
+	CHECK(evictedIds.empty());
+	pool.Trim(13, evictedIds);
+	CHECK(evictedIds.size() == 1 && evictedIds[0] == 42);
+	CHECK(pool.GetStats().numBuffers == 0);
+	CHECK(pool.GetStats().bytesAllocated == 0);
+	CHECK(pool.GetStats().evictions == 1);
+
+	// Evicted slots are reused for new buffers.
+	CHECK(pool.AddBuffer(1000, 7) == buffer);
+	CHECK(pool.GetStats().bytesAllocated == 1024);
+}
+
+// Requests of random sizes completing with a varying fence, some cancelled before the GPU finishes, and periodic trims.
+TEST(RdrReadbackPool_Churn)
+{
+	std::mt19937 rng(5);
+	RdrReadbackPool pool;
+	uint nextResourceId = 1;
+	std::set<uint> liveResources;
+	std::set<uint> inUseResources;
+	std::map<uint, uint64> releasedFrames;
+	std::vector<InFlightRequest> inFlightRequests;
+
+	uint numRequests = 0;
+	uint numBadBuffers = 0;
+	uint numBadEvictions = 0;
+	uint numBadStats = 0;
+	for (uint64 frame = 2; frame < 5000; ++frame)
+	{
+		uint64 completedFrame = frame - 1 - rng() % 3;
+
+		for (size_t i = 0; i < inFlightRequests.size(); )
+		{
+			InFlightRequest& rRequest = inFlightRequests[i];
+			if (rRequest.frameNum <= completedFrame || rng() % 20 == 0)
+			{
+				uint resourceId = pool.GetResourceId(rRequest.buffer);
+				inUseResources.erase(resourceId);
+				releasedFrames[resourceId] = rRequest.frameNum;
+				pool.Release(rRequest.buffer, rRequest.frameNum);
+
+				rRequest = inFlightRequests.back();
+				inFlightRequests.pop_back();
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		int numFrameRequests = rng() % 6;
+		for (int i = 0; i < numFrameRequests; ++i)
+		{
+			uint size = 1 + ((rng() % 4) ? rng() % 64 : rng() % 20000);
+			uint buffer = pool.Acquire(size, completedFrame);
+			if (buffer == RdrReadbackPool::kInvalidBuffer)
+			{
+				buffer = pool.AddBuffer(size, nextResourceId);
+				liveResources.insert(nextResourceId);
+				++nextResourceId;
+			}
+
+			// Reused buffers must be alive, idle, and finished with by the GPU.
+			uint resourceId = pool.GetResourceId(buffer);
+			if (!liveResources.count(resourceId) || inUseResources.count(resourceId) || releasedFrames[resourceId] > completedFrame)
+				++numBadBuffers;
+			inUseResources.insert(resourceId);
+
+			InFlightRequest request = { buffer, frame };
+			inFlightRequests.push_back(request);
+			++numRequests;
+		}
+
+		if (frame % 50 == 0)
+		{
+			std::vector<uint> evictedIds;
+			pool.Trim(frame - 100, evictedIds);
+			for (uint resourceId : evictedIds)
+			{
+				if (!liveResources.count(resourceId) || inUseResources.count(resourceId))
+					++numBadEvictions;
+				liveResources.erase(resourceId);
+			}
+		}
+
+		if (pool.GetStats().numBuffers != liveResources.size() || pool.GetStats().buffersInUse != inUseResources.size())
+			++numBadStats;
+	}
+
+	const RdrReadbackPool::Stats& rStats = pool.GetStats();
+	CHECK(numBadBuffers == 0);
+	CHECK(numBadEvictions == 0);
+	CHECK(numBadStats == 0);
+	CHECK(rStats.creates + rStats.reuses == numRequests);
+	CHECK(rStats.reuses > rStats.creates);
+	CHECK(rStats.evictions > 0);
+}
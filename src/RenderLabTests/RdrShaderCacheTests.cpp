@@ -0,0 +1,395 @@
+#include "TestFramework.h"
+#include "Types.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "UtilsLib/Paths.h"
+#include "UtilsLib/Util.h"
+#include "FreeList.h"
+#include "render/RdrShaderCache.h"
+
+namespace
+{
+	const char* kCacheDir = "RenderLabTests_ShaderCache";
+
+	std::atomic<uint> s_numCompiles(0);
+
+	// Stub compiler: the "bytecode" is the stage followed by the shader text.  Shaders starting with "bad" fail.
+	bool stubCompile(RdrShaderStage eStage, const char* pShaderText, uint textLen,
+		void** ppOutCompiledData, uint* pOutDataSize, void*)
+	{
+		++s_numCompiles;
+		if (textLen >= 3 && strncmp(pShaderText, "bad", 3) == 0)
+			return false;
+
+		char* pData = new char[textLen + 1];
+		pData[0] = (char)eStage;
+		memcpy(pData + 1, pShaderText, textLen);
+		*ppOutCompiledData = pData;
+		*pOutDataSize = textLen + 1;
+		return true;
+	}
+
+	// Stub preprocessor: the expanded text is the filename followed by its defines.
+	bool stubPreprocess(const char* filename, const std::vector<const char*>& defines,
+		std::vector<char>& rOutShaderText, void*)
+	{
+		std::string text = filename;
+		for (const char* define : defines)
+		{
+			text += "#define ";
+			text += define;
+		}
+		rOutShaderText.assign(text.begin(), text.end());
+		return true;
+	}
+
+	void removeCacheFile(const char* filename, bool isDirectory, void*)
+	{
+		if (!isDirectory)
+		{
+			std::remove((std::string(kCacheDir) + "/" + filename).c_str());
+		}
+	}
+
+	void clearCacheDir()
+	{
+		Paths::ForEachFile((std::string(kCacheDir) + "/*").c_str(), false, removeCacheFile, nullptr);
+	}
+
+	std::string getEntryFilename(const Hashing::SHA1& key)
+	{
+		char name[sizeof(key.data) * 2 + 1];
+		for (uint i = 0; i < sizeof(key.data); ++i)
+		{
+			sprintf_s(name + i * 2, 3, "%02x", key.data[i]);
+		}
+		return std::string(kCacheDir) + "/" + name + ".shdc";
+	}
+
+	void writeFile(const std::string& filename, const std::vector<char>& rContents)
+	{
+		std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+		file.write(rContents.data(), rContents.size());
+	}
+
+	struct Permutation
+	{
+		RdrShaderStage eStage;
+		std::string text;
+		uint flags;
+	};
+
+	std::vector<Permutation> makePermutations()
+	{
+		std::vector<Permutation> permutations;
+		for (uint nShader = 0; nShader < 4; ++nShader)
+		{
+			for (uint flags = 0; flags < 8; ++flags)
+			{
+				Permutation perm = { RdrShaderStage::Vertex, "v_shader" + std::to_string(nShader) + std::string(500, 'x'), flags };
+				permutations.push_back(perm);
+			}
+		}
+		for (uint nShader = 0; nShader < 4; ++nShader)
+		{
+			Permutation perm = { RdrShaderStage::Compute, "c_shader" + std::to_string(nShader) + std::string(1000, 'y'), 0 };
+			permutations.push_back(perm);
+		}
+		return permutations;
+	}
+
+	// Returns the number of permutations whose bytecode didn't match the stub compiler's output.
+	uint getAll(RdrShaderCache& rCache, const std::vector<Permutation>& rPermutations, const std::vector<std::string>& rGlobalDefines)
+	{
+		uint numBad = 0;
+		for (const Permutation& rPerm : rPermutations)
+		{
+			void* pData = nullptr;
+			uint dataSize = 0;
+			if (!rCache.GetCompiledShader(rPerm.eStage, rPerm.text.c_str(), (uint)rPerm.text.size(), rGlobalDefines, rPerm.flags, &pData, &dataSize))
+			{
+				++numBad;
+				continue;
+			}
+
+			const char* pChars = (const char*)pData;
+			if (dataSize != rPerm.text.size() + 1 || pChars[0] != (char)rPerm.eStage || memcmp(pChars + 1, rPerm.text.data(), rPerm.text.size()) != 0)
+				++numBad;
+			delete[] pChars;
+		}
+		return numBad;
+	}
+	const char* kFlagDefines[] = { "DEPTH_ONLY", "ALPHA_CUTOUT", "IS_INSTANCED", "PACKED_VERTICES" };
+	const char* kComputeShaders[] = { "c_tiled_depth", "c_clustered_light_cull", "c_volumetric_fog", "c_tiled_depth" };
+	const char* kBadShader = "bad_shader";
+
+	// Mirrors RdrShaderSystem's permutations: vertex shaders with every flag combination (two types share a file),
+	// compute shaders with a repeated entry, and a shader that fails to compile requested twice.
+	std::vector<RdrShaderCache::CompileRequest> makeBatchRequests()
+	{
+		const char* vertexShaders[] = { "v_model", "v_decal", "v_sky", "v_ocean", "v_ocean", "v_screen" };
+
+		std::vector<RdrShaderCache::CompileRequest> requests;
+		for (const char* filename : vertexShaders)
+		{
+			for (uint flags = 0; flags < 16; ++flags)
+			{
+				RdrShaderCache::CompileRequest request = {};
+				request.eStage = RdrShaderStage::Vertex;
+				request.filename = filename;
+				request.permutationFlags = flags;
+				for (uint nFlag = 0; nFlag < ARRAY_SIZE(kFlagDefines); ++nFlag)
+				{
+					if (flags & (1 << nFlag))
+						request.defines.push_back(kFlagDefines[nFlag]);
+				}
+				requests.push_back(request);
+			}
+		}
+
+		for (const char* filename : kComputeShaders)
+		{
+			RdrShaderCache::CompileRequest request = {};
+			request.eStage = RdrShaderStage::Compute;
+			request.filename = filename;
+			requests.push_back(request);
+		}
+
+		RdrShaderCache::CompileRequest badRequest = {};
+		badRequest.eStage = RdrShaderStage::Pixel;
+		badRequest.filename = kBadShader;
+		requests.push_back(badRequest);
+		requests.push_back(badRequest);
+		return requests;
+	}
+
+	// Returns the number of requests whose results don't belong to them.
+	uint checkBatchResults(const std::vector<RdrShaderCache::CompileRequest>& rRequests)
+	{
+		uint numBad = 0;
+		for (const RdrShaderCache::CompileRequest& rRequest : rRequests)
+		{
+			if (strcmp(rRequest.filename, kBadShader) == 0)
+			{
+				if (rRequest.bSucceeded || rRequest.pCompiledData)
+					++numBad;
+				continue;
+			}
+
+			std::vector<char> text;
+			stubPreprocess(rRequest.filename, rRequest.defines, text, nullptr);
+
+			const char* pChars = (const char*)rRequest.pCompiledData;
+			if (!rRequest.bSucceeded || !pChars
+				|| rRequest.compiledSize != text.size() + 1
+				|| pChars[0] != (char)rRequest.eStage
+				|| memcmp(pChars + 1, text.data(), text.size()) != 0)
+			{
+				++numBad;
+			}
+		}
+		return numBad;
+	}
+
+	void releaseBatchResults(std::vector<RdrShaderCache::CompileRequest>& rRequests)
+	{
+		for (RdrShaderCache::CompileRequest& rRequest : rRequests)
+		{
+			delete[] (char*)rRequest.pCompiledData;
+			rRequest.pCompiledData = nullptr;
+		}
+	}
+}
+
+TEST(RdrShaderCache_WarmCacheSkipsCompiles)
+{
+	clearCacheDir();
+	std::vector<Permutation> permutations = makePermutations();
+	std::vector<std::string> globalDefines = { "CLUSTERED_LIGHTING" };
+
+	RdrShaderCache coldCache;
+	coldCache.Init(kCacheDir, "stub 1", stubPreprocess, stubCompile, nullptr);
+	s_numCompiles = 0;
+	CHECK(getAll(coldCache, permutations, globalDefines) == 0);
+	CHECK(s_numCompiles == permutations.size());
+	CHECK(coldCache.GetStats().misses == permutations.size());
+	CHECK(coldCache.GetStats().failedWrites == 0);
+
+	// A new cache over the same directory, as on the next run, loads everything.
+	RdrShaderCache warmCache;
+	warmCache.Init(kCacheDir, "stub 1", stubPreprocess, stubCompile, nullptr);
+	s_numCompiles = 0;
+	CHECK(getAll(warmCache, permutations, globalDefines) == 0);
+	CHECK(s_numCompiles == 0);
+	CHECK(warmCache.GetStats().hits == permutations.size());
+	CHECK(warmCache.GetStats().misses == 0);
+
+	clearCacheDir();
+}
+
+TEST(RdrShaderCache_KeyCoversAllInputs)
+{
+	clearCacheDir();
+	std::vector<Permutation> permutations = makePermutations();
+	std::vector<std::string> globalDefines = { "CLUSTERED_LIGHTING" };
+
+	RdrShaderCache cache;
+	cache.Init(kCacheDir, "stub 1", stubPreprocess, stubCompile, nullptr);
+	CHECK(getAll(cache, { permutations[0] }, globalDefines) == 0);
+	CHECK(cache.GetStats().misses == 1);
+
+	// Different global defines, flags, and stage each need their own entry.
+	CHECK(getAll(cache, { permutations[0] }, {}) == 0);
+	CHECK(cache.GetStats().misses == 2);
+
+	Permutation perm = permutations[0];
+	perm.flags = 99;
+	CHECK(getAll(cache, { perm }, globalDefines) == 0);
+	CHECK(cache.GetStats().misses == 3);
+
+	perm = permutations[0];
+	perm.eStage = RdrShaderStage::Pixel;
+	CHECK(getAll(cache, { perm }, globalDefines) == 0);
+	CHECK(cache.GetStats().misses == 4);
+
+	// So does a different compiler.
+	RdrShaderCache newCompilerCache;
+	newCompilerCache.Init(kCacheDir, "stub 2", stubPreprocess, stubCompile, nullptr);
+	CHECK(getAll(newCompilerCache, { permutations[0] }, globalDefines) == 0);
+	CHECK(newCompilerCache.GetStats().misses == 1);
+	CHECK(newCompilerCache.GetStats().hits == 0);
+
+	// The original inputs still hit.
+	CHECK(getAll(cache, { permutations[0] }, globalDefines) == 0);
+	CHECK(cache.GetStats().hits == 1);
+
+	clearCacheDir();
+}
+
+TEST(RdrShaderCache_RejectsCorruptEntries)
+{
+	clearCacheDir();
+	std::vector<Permutation> permutations = makePermutations();
+	std::vector<std::string> globalDefines;
+	const Permutation& rPerm = permutations[1];
+
+	RdrShaderCache cache;
+	cache.Init(kCacheDir, "stub 1", stubPreprocess, stubCompile, nullptr);
+	CHECK(getAll(cache, { rPerm }, globalDefines) == 0);
+
+	Hashing::SHA1 key = cache.CalcKey(rPerm.eStage, rPerm.text.c_str(), (uint)rPerm.text.size(), globalDefines, rPerm.flags);
+	std::string filename = getEntryFilename(key);
+
+	// Flip a byte of the bytecode.
+	std::vector<char> contents;
+	{
+		std::ifstream file(filename, std::ios::binary);
+		CHECK(file.is_open());
+		contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	CHECK(contents.size() > 100);
+	if (contents.size() <= 100)
+		return;
+	contents[100] ^= 0xff;
+	writeFile(filename, contents);
+
+	s_numCompiles = 0;
+	CHECK(getAll(cache, { rPerm }, globalDefines) == 0);
+	CHECK(cache.GetStats().rejectedEntries == 1);
+	CHECK(s_numCompiles == 1);
+
+	// The recompiled entry replaced the bad one.
+	CHECK(getAll(cache, { rPerm }, globalDefines) == 0);
+	CHECK(cache.GetStats().hits == 1);
+
+	// Truncate the entry.
+	contents.resize(50);
+	writeFile(filename, contents);
+
+	s_numCompiles = 0;
+	CHECK(getAll(cache, { rPerm }, globalDefines) == 0);
+	CHECK(cache.GetStats().rejectedEntries == 2);
+	CHECK(s_numCompiles == 1);
+
+	clearCacheDir();
+}
+
+TEST(RdrShaderCache_DisabledAlwaysCompiles)
+{
+	std::vector<Permutation> permutations = makePermutations();
+	std::vector<std::string> globalDefines;
+
+	RdrShaderCache cache;
+	cache.Init(nullptr, "stub 1", stubPreprocess, stubCompile, nullptr);
+	CHECK(!cache.IsEnabled());
+
+	s_numCompiles = 0;
+	CHECK(getAll(cache, { permutations[0] }, globalDefines) == 0);
+	CHECK(getAll(cache, { permutations[0] }, globalDefines) == 0);
+	CHECK(s_numCompiles == 2);
+	CHECK(cache.GetStats().hits == 0);
+	CHECK(cache.GetStats().misses == 0);
+}
+
+TEST(RdrShaderCache_BatchCompilesEachPermutationOnce)
+{
+	std::vector<RdrShaderCache::CompileRequest> requests = makeBatchRequests();
+	std::vector<std::string> globalDefines = { "CLUSTERED_LIGHTING" };
+
+	RdrShaderCache cache;
+	cache.Init(nullptr, "stub 1", stubPreprocess, stubCompile, nullptr);
+	s_numCompiles = 0;
+	cache.CompileShaderBatch(requests.data(), (uint)requests.size(), globalDefines);
+
+	// The shared vertex shader file, the repeated compute shader, and the second bad shader are duplicates.
+	const uint numDuplicates = 16 + 1 + 1;
+	CHECK(s_numCompiles == requests.size() - numDuplicates);
+	CHECK(cache.GetStats().duplicateRequests == numDuplicates);
+
+	// Results land on the request they were made for, and every request owns its bytecode.
+	CHECK(checkBatchResults(requests) == 0);
+	uint numSharedResults = 0;
+	for (uint i = 0; i < requests.size(); ++i)
+	{
+		for (uint j = i + 1; j < requests.size(); ++j)
+		{
+			if (requests[i].pCompiledData && requests[i].pCompiledData == requests[j].pCompiledData)
+				++numSharedResults;
+		}
+	}
+	CHECK(numSharedResults == 0);
+
+	releaseBatchResults(requests);
+}
+
+TEST(RdrShaderCache_BatchUsesCache)
+{
+	clearCacheDir();
+	std::vector<std::string> globalDefines = { "CLUSTERED_LIGHTING" };
+
+	RdrShaderCache cache;
+	cache.Init(kCacheDir, "stub 1", stubPreprocess, stubCompile, nullptr);
+	std::vector<RdrShaderCache::CompileRequest> coldRequests = makeBatchRequests();
+	cache.CompileShaderBatch(coldRequests.data(), (uint)coldRequests.size(), globalDefines);
+	CHECK(checkBatchResults(coldRequests) == 0);
+	CHECK(cache.GetStats().failedWrites == 0);
+	releaseBatchResults(coldRequests);
+
+	// Only the failed shader isn't cached.
+	RdrShaderCache warmCache;
+	warmCache.Init(kCacheDir, "stub 1", stubPreprocess, stubCompile, nullptr);
+	std::vector<RdrShaderCache::CompileRequest> warmRequests = makeBatchRequests();
+	s_numCompiles = 0;
+	warmCache.CompileShaderBatch(warmRequests.data(), (uint)warmRequests.size(), globalDefines);
+	CHECK(checkBatchResults(warmRequests) == 0);
+	CHECK(s_numCompiles == 1);
+	CHECK(warmCache.GetStats().misses == 1);
+	releaseBatchResults(warmRequests);
+
+	clearCacheDir();
+}
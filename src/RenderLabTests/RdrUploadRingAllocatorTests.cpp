@@ -0,0 +1,126 @@
+#include "TestFramework.h"
+#include "Types.h"
+#include <iterator>
+#include <map>
+#include <random>
+#include "render/RdrUploadRingAllocator.h"
+
+namespace
+{
+	const uint64 kInvalidOffset = RdrUploadRingAllocator::kInvalidOffset;
+
+	struct LiveAllocation
+	{
+		uint64 end;
+		uint64 frameNum;
+	};
+}
+
+TEST(RdrUploadRingAllocator_AlignsAndWraps)
+{
+	RdrUploadRingAllocator allocator;
+	allocator.Init(1024);
+	allocator.BeginFrame(2, 0);
+
+	// Aligned allocations pad the head; padding counts as used.
+	CHECK(allocator.Allocate(100, 256) == 0);
+	CHECK(allocator.Allocate(10, 256) == 256);
+	CHECK(allocator.Allocate(800, 16) == kInvalidOffset);
+	CHECK(allocator.Allocate(700, 1) == 266);
+	CHECK(allocator.Allocate(1, 1) == 966);
+	CHECK(allocator.GetStats().bytesInUse == 967);
+	CHECK(allocator.GetStats().allocationsThisFrame == 4);
+
+	// Frame 2 is still in flight, so only the space at the end of the ring is free.
+	allocator.BeginFrame(3, 1);
+	CHECK(allocator.Allocate(100, 1) == kInvalidOffset);
+	CHECK(allocator.Allocate(57, 1) == 967);
+
+	// Once frame 2 completes, allocations wrap to the start and stop at frame 3's space.
+	allocator.BeginFrame(4, 2);
+	CHECK(allocator.GetStats().bytesInUse == 57);
+	CHECK(allocator.Allocate(500, 512) == 0);
+	CHECK(allocator.Allocate(467, 1) == 500);
+	CHECK(allocator.Allocate(1, 1) == kInvalidOffset);
+
+	// With nothing in flight the whole ring is available again.
+	allocator.BeginFrame(5, 4);
+	CHECK(allocator.GetStats().bytesInUse == 0);
+	CHECK(allocator.Allocate(1024, 1) == 0);
+	CHECK(allocator.Allocate(2000, 1) == kInvalidOffset);
+
+	CHECK(allocator.GetStats().failedAllocations == 4);
+	CHECK(allocator.GetStats().peakBytesInUse == 1024);
+}
+
+// Random allocations with a random GPU latency.  Allocations never overlap anything a frame the GPU may still be
+// reading owns, and each frame's space is reclaimed once it completes.
+TEST(RdrUploadRingAllocator_ReclaimsCompletedFrames)
+{
+	std::mt19937_64 rng(7);
+	uint numAllocations = 0;
+	uint numBadAllocations = 0;
+	uint numOverlaps = 0;
+	uint numBadUsage = 0;
+	for (int trial = 0; trial < 300; ++trial)
+	{
+		uint64 capacity = 64 + rng() % 100000;
+		uint64 latency = 1 + rng() % 3;
+		RdrUploadRingAllocator allocator;
+		allocator.Init(capacity);
+
+		// Start offset -> end offset and frame.
+		std::map<uint64, LiveAllocation> liveAllocations;
+		for (uint64 frame = latency; frame < latency + 400; ++frame)
+		{
+			uint64 completedFrame = frame - latency;
+			allocator.BeginFrame(frame, completedFrame);
+			for (auto iter = liveAllocations.begin(); iter != liveAllocations.end(); )
+			{
+				if (iter->second.frameNum <= completedFrame)
+					iter = liveAllocations.erase(iter);
+				else
+					++iter;
+			}
+
+			// Everything the GPU has finished with is available again.
+			if (liveAllocations.empty() && allocator.GetStats().bytesInUse != 0)
+				++numBadUsage;
+
+			int numFrameAllocations = rng() % 20;
+			for (int i = 0; i < numFrameAllocations; ++i)
+			{
+				uint64 size = 1 + rng() % ((rng() % 4) ? capacity / 16 + 1 : capacity);
+				uint64 alignment = 1ull << (rng() % 10);
+				uint64 offset = allocator.Allocate(size, alignment);
+				if (offset == kInvalidOffset)
+					continue;
+
+				++numAllocations;
+				if (offset % alignment != 0 || offset + size > capacity)
+					++numBadAllocations;
+
+				auto next = liveAllocations.upper_bound(offset);
+				if (next != liveAllocations.end() && offset + size > next->first)
+					++numOverlaps;
+				if (next != liveAllocations.begin() && std::prev(next)->second.end > offset)
+					++numOverlaps;
+
+				LiveAllocation allocation = { offset + size, frame };
+				liveAllocations[offset] = allocation;
+			}
+
+			uint64 liveBytes = 0;
+			for (const auto& rAllocation : liveAllocations)
+			{
+				liveBytes += rAllocation.second.end - rAllocation.first;
+			}
+			if (liveBytes > allocator.GetStats().bytesInUse || allocator.GetStats().bytesInUse > capacity)
+				++numBadUsage;
+		}
+	}
+	CHECK(numAllocations > 0);
+	CHECK(numBadAllocations == 0);
+	CHECK(numOverlaps == 0);
+	CHECK(numBadUsage == 0);
+}
@@ -0,0 +1,280 @@
+#include "TestFramework.h"
+#include "Types.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "MathLib/Maths.h"
+#include "render/TerrainClipmap.h"
+
+namespace
+{
+	const uint kTileSize = 64;
+	const uint kTerrainSize = 16384;
+
+	struct LoadContext
+	{
+		const AssetLib::TerrainTiles* pLayout;
+		std::atomic<uint> nLoads;
+		uint nDelayUs;
+	};
+
+	// Every texel of a tile is tagged with its level and coordinates so misplaced tiles can be detected.
+	float16 makeTileTag(uint nLevel, uint nTileX, uint nTileY)
+	{
+		return (float16)((nLevel << 12) | ((nTileX & 63) << 6) | (nTileY & 63));
+	}
+
+	bool loadTaggedTile(uint nLevel, uint nTileX, uint nTileY, float16* pOutTexels, void* pUserData)
+	{
+		LoadContext* pContext = (LoadContext*)pUserData;
+		if (pContext->nDelayUs)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(pContext->nDelayUs));
+		}
+
+		std::fill(pOutTexels, pOutTexels + kTileSize * kTileSize, makeTileTag(nLevel, nTileX, nTileY));
+		++pContext->nLoads;
+		return true;
+	}
+
+	// Same level layout as the texture importer writes.
+	AssetLib::TerrainTiles makeLayout(uint width, uint height)
+	{
+		AssetLib::TerrainTiles layout = {};
+		layout.width = width;
+		layout.height = height;
+		layout.tileSize = kTileSize;
+
+		uint numTiles = 0;
+		while (layout.numLevels < AssetLib::TerrainTiles::kMaxLevels)
+		{
+			uint nLevel = layout.numLevels++;
+			layout.levelTilesX[nLevel] = (width + kTileSize - 1) / kTileSize;
+			layout.levelTilesY[nLevel] = (height + kTileSize - 1) / kTileSize;
+			layout.levelFirstTile[nLevel] = numTiles;
+			numTiles += layout.levelTilesX[nLevel] * layout.levelTilesY[nLevel];
+
+			if (width <= kTileSize && height <= kTileSize)
+				break;
+			width = std::max(width / 2, 1u);
+			height = std::max(height / 2, 1u);
+		}
+		return layout;
+	}
+
+	// Mirrors the clipmap texture, which only receives the slots reported by GetUpdatedSlots().
+	void applySlotUpdates(const TerrainClipmap& rClipmap, std::vector<float16>& rTexture)
+	{
+		uint ringTexels = rClipmap.GetRingTexelSize();
+		rTexture.resize(rClipmap.GetLevelCount() * ringTexels * ringTexels);
+		for (const TerrainClipmap::SlotUpdate& rSlot : rClipmap.GetUpdatedSlots())
+		{
+			uint offset = rSlot.level * ringTexels * ringTexels + rSlot.slotY * kTileSize * ringTexels + rSlot.slotX * kTileSize;
+			for (uint y = 0; y < kTileSize; ++y)
+			{
+				std::copy(rClipmap.GetTexels() + offset + y * ringTexels, rClipmap.GetTexels() + offset + y * ringTexels + kTileSize,
+					rTexture.begin() + offset + y * ringTexels);
+			}
+		}
+	}
+
+	// Counts resident region tiles that aren't resident or whose texels in the texture are not that tile's.
+	uint countBadResidentTiles(const TerrainClipmap& rClipmap, const std::vector<float16>& rTexture)
+	{
+		uint ringTexels = rClipmap.GetRingTexelSize();
+		uint numBad = 0;
+		for (uint nLevel = 0; nLevel < rClipmap.GetLevelCount(); ++nLevel)
+		{
+			const TerrainClipmap::Region& rRegion = rClipmap.GetResidentRegion(nLevel);
+			if (!rRegion.bValid)
+				continue;
+
+			if (rRegion.tileMaxX - rRegion.tileMinX > TerrainClipmap::kRingTiles || rRegion.tileMaxY - rRegion.tileMinY > TerrainClipmap::kRingTiles)
+				++numBad;
+
+			for (uint y = rRegion.tileMinY; y < rRegion.tileMaxY; ++y)
+			{
+				for (uint x = rRegion.tileMinX; x < rRegion.tileMaxX; ++x)
+				{
+					uint offset = nLevel * ringTexels * ringTexels
+						+ (y % TerrainClipmap::kRingTiles) * kTileSize * ringTexels
+						+ (x % TerrainClipmap::kRingTiles) * kTileSize;
+					float16 tag = makeTileTag(nLevel, x, y);
+					if (!rClipmap.IsTileResident(nLevel, x, y)
+						|| rTexture[offset] != tag
+						|| rTexture[offset + (kTileSize - 1) * ringTexels + kTileSize - 1] != tag)
+					{
+						++numBad;
+					}
+				}
+			}
+		}
+		return numBad;
+	}
+
+	bool regionContains(const TerrainClipmap& rClipmap, uint nLevel, const Vec2& texel)
+	{
+		const TerrainClipmap::Region& rRegion = rClipmap.GetResidentRegion(nLevel);
+		float levelScale = 1.f / (kTileSize * (1 << nLevel));
+		uint tileX = (uint)(texel.x * levelScale);
+		uint tileY = (uint)(texel.y * levelScale);
+		return rRegion.bValid && tileX >= rRegion.tileMinX && tileX < rRegion.tileMaxX && tileY >= rRegion.tileMinY && tileY < rRegion.tileMaxY;
+	}
+
+	bool anyRegionContains(const TerrainClipmap& rClipmap, const Vec2& texel)
+	{
+		for (uint nLevel = 0; nLevel < rClipmap.GetLevelCount(); ++nLevel)
+		{
+			if (regionContains(rClipmap, nLevel, texel))
+				return true;
+		}
+		return false;
+	}
+
+	bool allRegionsContain(const TerrainClipmap& rClipmap, const Vec2& texel)
+	{
+		for (uint nLevel = 0; nLevel < rClipmap.GetLevelCount(); ++nLevel)
+		{
+			if (!regionContains(rClipmap, nLevel, texel))
+				return false;
+		}
+		return true;
+	}
+
+	// Updates the clipmap and the mirrored texture the way Terrain does each frame.
+	void updateFrame(TerrainClipmap& rClipmap, const Vec2& centerTexel, std::vector<float16>& rTexture)
+	{
+		rClipmap.Update(centerTexel);
+		rClipmap.ProcessCompletedLoads();
+		applySlotUpdates(rClipmap, rTexture);
+	}
+}
+
+TEST(TerrainClipmap_SimulatedCameraResidency)
+{
+	AssetLib::TerrainTiles layout = makeLayout(kTerrainSize, kTerrainSize);
+	LoadContext loadContext;
+	loadContext.pLayout = &layout;
+	loadContext.nLoads = 0;
+	loadContext.nDelayUs = 0;
+
+	TerrainClipmap clipmap;
+	clipmap.Init(layout, loadTaggedTile, &loadContext, false);
+	std::vector<float16> texture;
+
+	// Coarse levels are loaded first so there is something to sample from the first frame on.
+	Vec2 camera(8000.f, 8000.f);
+	uint numBadTiles = 0;
+	uint numFrames = 0;
+	do
+	{
+		updateFrame(clipmap, camera, texture);
+		numBadTiles += countBadResidentTiles(clipmap, texture);
+		if (numFrames == 0)
+		{
+			CHECK(clipmap.GetResidentRegion(layout.numLevels - 1).bValid);
+		}
+		++numFrames;
+	} while (clipmap.GetPendingLoadCount() > 0 && numFrames < 200);
+
+	uint numWindowTiles = 0;
+	for (uint nLevel = 0; nLevel < layout.numLevels; ++nLevel)
+	{
+		numWindowTiles += std::min(layout.levelTilesX[nLevel], TerrainClipmap::kRingTiles) * std::min(layout.levelTilesY[nLevel], TerrainClipmap::kRingTiles);
+	}
+	CHECK(clipmap.GetPendingLoadCount() == 0);
+	CHECK(loadContext.nLoads == numWindowTiles);
+	CHECK(allRegionsContain(clipmap, camera));
+
+	// Fly diagonally across the terrain.  Loads keep up, so the finest level always covers the camera.
+	uint numLoadsBefore = loadContext.nLoads;
+	uint numFramesOutsideFinest = 0;
+	uint numFramesUncovered = 0;
+	for (uint i = 0; i < 4000; ++i)
+	{
+		camera = Vec2(8000.f + i * 2.f, 8000.f + i * 1.5f);
+		updateFrame(clipmap, camera, texture);
+		numBadTiles += countBadResidentTiles(clipmap, texture);
+		CHECK(clipmap.GetPendingLoadCount() <= TerrainClipmap::kMaxPendingLoads);
+
+		if (!regionContains(clipmap, 0, camera))
+			++numFramesOutsideFinest;
+		if (!anyRegionContains(clipmap, camera))
+			++numFramesUncovered;
+	}
+	CHECK(numFramesOutsideFinest == 0);
+	CHECK(numFramesUncovered == 0);
+	// Only tiles entering the windows are loaded, far fewer than a window per frame.
+	CHECK(loadContext.nLoads - numLoadsBefore < 4000);
+
+	// After a teleport the coarsest level is back immediately and the rest follow.
+	camera = Vec2(1000.f, 15000.f);
+	updateFrame(clipmap, camera, texture);
+	numBadTiles += countBadResidentTiles(clipmap, texture);
+	CHECK(clipmap.GetResidentRegion(layout.numLevels - 1).bValid);
+	numFrames = 1;
+	while (clipmap.GetPendingLoadCount() > 0 && numFrames < 100)
+	{
+		updateFrame(clipmap, camera, texture);
+		numBadTiles += countBadResidentTiles(clipmap, texture);
+		++numFrames;
+	}
+	CHECK(allRegionsContain(clipmap, camera));
+
+	// Windows are clamped to the edges of the terrain.
+	camera = Vec2(0.f, 0.f);
+	for (uint i = 0; i < 100; ++i)
+	{
+		updateFrame(clipmap, camera, texture);
+	}
+	numBadTiles += countBadResidentTiles(clipmap, texture);
+	CHECK(clipmap.GetResidentRegion(0).tileMinX == 0 && clipmap.GetResidentRegion(0).tileMaxX == TerrainClipmap::kRingTiles);
+
+	CHECK(numBadTiles == 0);
+}
+
+TEST(TerrainClipmap_AsyncStreaming)
+{
+	AssetLib::TerrainTiles layout = makeLayout(kTerrainSize, kTerrainSize);
+	LoadContext loadContext;
+	loadContext.pLayout = &layout;
+	loadContext.nLoads = 0;
+	loadContext.nDelayUs = 100;
+
+	TerrainClipmap clipmap;
+	clipmap.Init(layout, loadTaggedTile, &loadContext, true);
+	std::vector<float16> texture;
+
+	// The camera outruns the loader, but once the coarsest tiles arrive some level always covers it.
+	Vec2 camera;
+	uint numBadTiles = 0;
+	uint numFramesUncovered = 0;
+	for (uint i = 0; i < 200; ++i)
+	{
+		camera = Vec2(4000.f + i * 8.f, 4000.f + i * 3.f);
+		updateFrame(clipmap, camera, texture);
+		numBadTiles += countBadResidentTiles(clipmap, texture);
+		if (i >= 10 && !anyRegionContains(clipmap, camera))
+			++numFramesUncovered;
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	CHECK(numFramesUncovered == 0);
+
+	uint numWaits = 0;
+	while (clipmap.GetPendingLoadCount() > 0 && numWaits < 2000)
+	{
+		updateFrame(clipmap, camera, texture);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		++numWaits;
+	}
+	numBadTiles += countBadResidentTiles(clipmap, texture);
+	CHECK(clipmap.GetPendingLoadCount() == 0);
+	CHECK(allRegionsContain(clipmap, camera));
+	CHECK(numBadTiles == 0);
+
+	// Shutting down with loads in flight must not hang or crash.
+	clipmap.Update(Vec2(100.f, 100.f));
+	clipmap.Shutdown();
+}
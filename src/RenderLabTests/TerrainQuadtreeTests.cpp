@@ -0,0 +1,161 @@
+#include "TestFramework.h"
+#include "Types.h"
+#include <algorithm>
+#include <float.h>
+#include <vector>
+#include "MathLib/Maths.h"
+#include "render/Camera.h"
+#include "render/TerrainQuadtree.h"
+#include "UtilsLib/Timer.h"
+
+namespace
+{
+	// Matches Terrain's defaults: TERRAIN_LEAF_SIZE, the terrainLodDistance debug setting and kMorphStartRatio.
+	const float kLeafSize = 16.f;
+	const float kLeafRange = 64.f;
+	const float kMorphStartRatio = 0.66f;
+	const float kHeightScale = 40.f;
+
+	// Bounds cells cover this many heightmap samples, like the finest level of heightmap tiles.
+	const uint kBoundsCellSamples = 64;
+
+	// Per-cell height bounds of rolling hills.
+	struct HeightBounds
+	{
+		std::vector<float> minHeights;
+		std::vector<float> maxHeights;
+		uint nCellsPerSide;
+	};
+
+	void makeHeightBounds(uint nHeightmapSize, HeightBounds& rBounds)
+	{
+		rBounds.nCellsPerSide = nHeightmapSize / kBoundsCellSamples;
+		rBounds.minHeights.assign(rBounds.nCellsPerSide * rBounds.nCellsPerSide, FLT_MAX);
+		rBounds.maxHeights.assign(rBounds.nCellsPerSide * rBounds.nCellsPerSide, -FLT_MAX);
+		for (uint z = 0; z < nHeightmapSize; ++z)
+		{
+			for (uint x = 0; x < nHeightmapSize; ++x)
+			{
+				float height = 0.5f + 0.35f * sinf(x * 0.02f) * cosf(z * 0.03f) + 0.15f * sinf(x * 0.11f + z * 0.07f);
+				uint nCell = (x / kBoundsCellSamples) + (z / kBoundsCellSamples) * rBounds.nCellsPerSide;
+				rBounds.minHeights[nCell] = std::min(rBounds.minHeights[nCell], height);
+				rBounds.maxHeights[nCell] = std::max(rBounds.maxHeights[nCell], height);
+			}
+		}
+	}
+
+	// Square terrain centered on the origin.
+	void buildQuadtree(const HeightBounds& rBounds, float extent, TerrainQuadtree& rQuadtree)
+	{
+		float cellSize = extent / rBounds.nCellsPerSide;
+		rQuadtree.Build(rBounds.minHeights.data(), rBounds.maxHeights.data(), rBounds.nCellsPerSide, rBounds.nCellsPerSide,
+			Vec2(cellSize, cellSize), Vec2(-extent * 0.5f, -extent * 0.5f), Vec2(extent * 0.5f, extent * 0.5f), kHeightScale, kLeafSize);
+		rQuadtree.SetLodRanges(kLeafRange, kMorphStartRatio);
+	}
+}
+
+TEST(TerrainQuadtree_SelectionCoversTerrain)
+{
+	const float kExtent = 1024.f;
+	HeightBounds bounds;
+	makeHeightBounds(1024, bounds);
+
+	TerrainQuadtree quadtree;
+	buildQuadtree(bounds, kExtent, quadtree);
+	CHECK(quadtree.GetLodCount() > 1);
+
+	// Spherical cameras see everything, so the selection should tile the whole terrain.
+	Camera camera;
+	Vec3 lodOrigin(10.f, 30.f, -20.f);
+	camera.SetAsSphere(lodOrigin, 0.1f, 100000.f);
+
+	std::vector<Vec4> patches(quadtree.GetLeafCount());
+	uint numPatches = quadtree.Select(camera, lodOrigin, patches.data(), (uint)patches.size());
+	CHECK(numPatches > 0);
+
+	// Rasterize the patches' LODs onto the leaf grid.
+	uint leavesPerSide = (uint)(kExtent / kLeafSize);
+	std::vector<int> leafLods(leavesPerSide * leavesPerSide, -1);
+	uint numOverlaps = 0;
+	for (uint i = 0; i < numPatches; ++i)
+	{
+		const Vec4& rPatch = patches[i];
+		uint x0 = (uint)((rPatch.x + kExtent * 0.5f) / kLeafSize);
+		uint z0 = (uint)((rPatch.y + kExtent * 0.5f) / kLeafSize);
+		uint size = (uint)(rPatch.z / kLeafSize);
+		for (uint z = z0; z < std::min(z0 + size, leavesPerSide); ++z)
+		{
+			for (uint x = x0; x < std::min(x0 + size, leavesPerSide); ++x)
+			{
+				if (leafLods[x + z * leavesPerSide] >= 0)
+					++numOverlaps;
+				leafLods[x + z * leavesPerSide] = (int)rPatch.w;
+			}
+		}
+	}
+	CHECK(numOverlaps == 0);
+
+	// Morphing only joins up adjacent levels, so neighboring leaves can differ by at most one LOD.
+	uint numUncovered = 0;
+	int maxLodDiff = 0;
+	for (uint z = 0; z < leavesPerSide; ++z)
+	{
+		for (uint x = 0; x < leavesPerSide; ++x)
+		{
+			int lod = leafLods[x + z * leavesPerSide];
+			if (lod < 0)
+			{
+				++numUncovered;
+				continue;
+			}
+
+			if (x + 1 < leavesPerSide && leafLods[x + 1 + z * leavesPerSide] >= 0)
+				maxLodDiff = std::max(maxLodDiff, abs(leafLods[x + 1 + z * leavesPerSide] - lod));
+			if (z + 1 < leavesPerSide && leafLods[x + (z + 1) * leavesPerSide] >= 0)
+				maxLodDiff = std::max(maxLodDiff, abs(leafLods[x + (z + 1) * leavesPerSide] - lod));
+		}
+	}
+	CHECK(numUncovered == 0);
+	CHECK(maxLodDiff <= 1);
+}
+
+BENCHMARK(TerrainQuadtree_Select)
+{
+	const int kNumFrames = 2000;
+
+	HeightBounds bounds;
+	makeHeightBounds(4096, bounds);
+
+	Timer::Handle hTimer = Timer::Create();
+	const float kExtents[] = { 1024.f, 4096.f, 16384.f };
+	for (float extent : kExtents)
+	{
+		TerrainQuadtree quadtree;
+		Timer::Reset(hTimer);
+		buildQuadtree(bounds, extent, quadtree);
+		double buildMs = Timer::GetElapsedMilliseconds(hTimer);
+
+		std::vector<Vec4> patches(quadtree.GetLeafCount());
+
+		// Camera circling the terrain, looking slightly down and along its path.
+		// Timings include the per-frame camera update, as Terrain pays for that too.
+		Camera camera;
+		uint64 totalPatches = 0;
+		Timer::Reset(hTimer);
+		for (int frame = 0; frame < kNumFrames; ++frame)
+		{
+			float angle = frame * 0.01f;
+			Vec3 pos(cosf(angle) * extent * 0.3f, 50.f, sinf(angle) * extent * 0.3f);
+			Vec3 dir = Vec3Normalize(Vec3(-sinf(angle), -0.2f, cosf(angle)));
+			camera.SetAsPerspective(pos, dir, Maths::DegToRad(60.f), 16.f / 9.f, 0.1f, 3000.f);
+			camera.UpdateFrustum();
+
+			totalPatches += quadtree.Select(camera, pos, patches.data(), (uint)patches.size());
+		}
+		double selectUs = Timer::GetElapsedMilliseconds(hTimer) * 1000.0 / kNumFrames;
+
+		printf("  %.0fm terrain: %u LODs, %u leaves, built in %.2f ms, %.1f patches and %.2f us per select\n",
+			extent, quadtree.GetLodCount(), quadtree.GetLeafCount(), buildMs, (double)totalPatches / kNumFrames, selectUs);
+	}
+	Timer::Release(hTimer);
+}
@@ -0,0 +1,81 @@
+#include "TestFramework.h"
+#include <vector>
+#include <string.h>
+
+namespace
+{
+	struct TestEntry
+	{
+		const char* name;
+		Test::TestFunc func;
+		bool bBenchmark;
+	};
+
+	std::vector<TestEntry>& getTests()
+	{
+		// Function static so registration from other translation units doesn't depend on initialization order.
+		static std::vector<TestEntry> s_tests;
+		return s_tests;
+	}
+
+	int s_numFailures = 0;
+
+	bool matchesFilters(const char* name, const std::vector<const char*>& filters)
+	{
+		if (filters.empty())
+			return true;
+
+		for (const char* filter : filters)
+		{
+			if (strstr(name, filter))
+				return true;
+		}
+		return false;
+	}
+}
+
+Test::Registrar::Registrar(const char* name, TestFunc func, bool bBenchmark)
+{
+	getTests().push_back(TestEntry{ name, func, bBenchmark });
+}
+
+void Test::ReportFailure(const char* file, int line, const char* expr)
+{
+	printf("  %s(%d): CHECK failed: %s\n", file, line, expr);
+	++s_numFailures;
+}
+
+int Test::RunAll(int argc, char** argv)
+{
+	bool bRunBenchmarks = false;
+	std::vector<const char*> filters;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-bench") == 0)
+			bRunBenchmarks = true;
+		else
+			filters.push_back(argv[i]);
+	}
+
+	int nNumRun = 0;
+	int nNumFailedTests = 0;
+	for (const TestEntry& test : getTests())
+	{
+		if (test.bBenchmark && !bRunBenchmarks)
+			continue;
+		if (!matchesFilters(test.name, filters))
+			continue;
+
+		printf("%s\n", test.name);
+		int nPrevFailures = s_numFailures;
+		test.func();
+		fflush(stdout);
+
+		++nNumRun;
+		if (s_numFailures != nPrevFailures)
+			++nNumFailedTests;
+	}
+
+	printf("%d run, %d failed (%d failed checks)\n", nNumRun, nNumFailedTests, s_numFailures);
+	return s_numFailures;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <stdio.h>
+#include <math.h>
+
+// Minimal self-registering test runner.  Tests and benchmarks are declared at file scope with
+// TEST() and BENCHMARK(); main() runs every test whose name contains one of the command line filters.
+// Benchmarks are only run when "-bench" is passed since they take much longer than the tests.
+namespace Test
+{
+	typedef void (*TestFunc)();
+
+	struct Registrar
+	{
+		Registrar(const char* name, TestFunc func, bool bBenchmark);
+	};
+
+	// Returns the number of failed checks.
+	int RunAll(int argc, char** argv);
+
+	void ReportFailure(const char* file, int line, const char* expr);
+}
+
+#define TEST(name) \
+	static void name(); \
+	static Test::Registrar s_registrar_##name(#name, name, false); \
+	static void name()
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static Test::Registrar s_registrar_##name(#name, name, true); \
+	static void name()
+
+#define CHECK(expr) \
+	do { if (!(expr)) Test::ReportFailure(__FILE__, __LINE__, #expr); } while (0)
+
+#define CHECK_NEAR(a, b, eps) \
+	do { if (!(fabs((double)(a) - (double)(b)) <= (double)(eps))) Test::ReportFailure(__FILE__, __LINE__, #a " ~= " #b); } while (0)
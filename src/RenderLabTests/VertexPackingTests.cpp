@@ -0,0 +1,144 @@
+#include "TestFramework.h"
+#include "../AssetImporter/VertexPacking.h"
+#include "MathLib/Maths.h"
+#include <algorithm>
+#include <random>
+
+namespace
+{
+	const uint kNumSamples = 100000;
+
+	Vec3 randomUnitVector(std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> dist(-1.f, 1.f);
+		while (true)
+		{
+			Vec3 v(dist(rng), dist(rng), dist(rng));
+			float fLength = Vec3Length(v);
+			if (fLength > 0.01f && fLength <= 1.f)
+				return v / fLength;
+		}
+	}
+
+	// acos() of the dot product loses too much precision for nearly parallel vectors.
+	float angleBetween(const Vec3& a, const Vec3& b)
+	{
+		return atan2f(Vec3Length(Vec3Cross(a, b)), Vec3Dot(a, b));
+	}
+}
+
+TEST(VertexPacking_PositionUnorm16)
+{
+	VertexPacking::PositionQuantization quantization;
+	quantization.vOffset = Vec3(-12.f, -0.5f, 3.f);
+	quantization.vScale = Vec3(24.f, 1.f, 250.f);
+
+	// Rounding to the nearest of 65535 steps is off by at most half a step per axis.
+	Vec3 vMaxError = quantization.vScale * (0.5f / 65535.f) + Vec3(1e-5f, 1e-5f, 1e-5f);
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> dist(0.f, 1.f);
+	for (uint i = 0; i < kNumSamples; ++i)
+	{
+		Vec3 vPos = Vec3(dist(rng), dist(rng), dist(rng)) * quantization.vScale + quantization.vOffset;
+		float fSign = (i & 1) ? 1.f : -1.f;
+
+		VertexPacking::PackedPosition packed = VertexPacking::PackPosition(vPos, fSign, quantization);
+		Vec3 vError = Vec3Abs(VertexPacking::UnpackPosition(packed, quantization) - vPos);
+		CHECK(vError.x <= vMaxError.x && vError.y <= vMaxError.y && vError.z <= vMaxError.z);
+		CHECK(packed.w == ((fSign < 0.f) ? 0 : 0xffff));
+	}
+
+	// The bounds themselves must be exact so adjacent subobjects don't crack at shared extremes.
+	Vec3 vMax = quantization.vOffset + quantization.vScale;
+	CHECK(Vec3MaxComponent(Vec3Abs(VertexPacking::UnpackPosition(VertexPacking::PackPosition(quantization.vOffset, 1.f, quantization), quantization) - quantization.vOffset)) <= 1e-5f);
+	CHECK(Vec3MaxComponent(Vec3Abs(VertexPacking::UnpackPosition(VertexPacking::PackPosition(vMax, 1.f, quantization), quantization) - vMax)) <= 1e-4f);
+}
+
+TEST(VertexPacking_OctahedralNormals)
+{
+	// 16 bit octahedral vectors are accurate to well under a hundredth of a degree.
+	const float kMaxAngleError = Maths::DegToRad(0.01f);
+
+	std::vector<Vec3> directions = {
+		Vec3(1.f, 0.f, 0.f), Vec3(-1.f, 0.f, 0.f),
+		Vec3(0.f, 1.f, 0.f), Vec3(0.f, -1.f, 0.f),
+		Vec3(0.f, 0.f, 1.f), Vec3(0.f, 0.f, -1.f),
+		Vec3Normalize(Vec3(1.f, 1.f, -1.f)), Vec3Normalize(Vec3(-1.f, -1.f, -1.f)),
+		Vec3Normalize(Vec3(1.f, -1.f, 0.f)), Vec3Normalize(Vec3(0.f, 1e-4f, -1.f)),
+	};
+
+	std::mt19937 rng(2);
+	for (uint i = 0; i < kNumSamples; ++i)
+	{
+		directions.push_back(randomUnitVector(rng));
+	}
+
+	float fMaxError = 0.f;
+	for (const Vec3& vDir : directions)
+	{
+		Vec3 vDecoded = VertexPacking::UnpackDirection(VertexPacking::PackDirection(vDir));
+		CHECK_NEAR(Vec3Length(vDecoded), 1.f, 1e-5f);
+		fMaxError = std::max(fMaxError, angleBetween(vDir, vDecoded));
+	}
+	CHECK(fMaxError <= kMaxAngleError);
+}
+
+TEST(VertexPacking_TangentFrame)
+{
+	// Packed vertices drop the bitangent, so it has to survive being rebuilt from the packed normal, tangent and sign.
+	const float kMaxAngleError = Maths::DegToRad(0.02f);
+
+	VertexPacking::PositionQuantization quantization;
+	quantization.vOffset = Vec3(-1.f, -1.f, -1.f);
+	quantization.vScale = Vec3(2.f, 2.f, 2.f);
+
+	std::mt19937 rng(3);
+	float fMaxTangentError = 0.f;
+	float fMaxBitangentError = 0.f;
+	for (uint i = 0; i < kNumSamples; ++i)
+	{
+		Vec3 vNormal = randomUnitVector(rng);
+		Vec3 vTangent = Vec3Normalize(Vec3Cross(vNormal, randomUnitVector(rng)));
+		float fSign = (i & 1) ? 1.f : -1.f;
+		Vec3 vBitangent = Vec3Cross(vNormal, vTangent) * fSign;
+
+		VertexPacking::PackedPosition packedPos = VertexPacking::PackPosition(Vec3::kZero, fSign, quantization);
+		Vec3 vDecodedNormal = VertexPacking::UnpackDirection(VertexPacking::PackDirection(vNormal));
+		Vec3 vDecodedTangent = VertexPacking::UnpackDirection(VertexPacking::PackDirection(vTangent));
+		float fDecodedSign = (packedPos.w == 0) ? -1.f : 1.f;
+		Vec3 vDecodedBitangent = Vec3Cross(vDecodedNormal, vDecodedTangent) * fDecodedSign;
+
+		fMaxTangentError = std::max(fMaxTangentError, angleBetween(vTangent, vDecodedTangent));
+		fMaxBitangentError = std::max(fMaxBitangentError, angleBetween(vBitangent, Vec3Normalize(vDecodedBitangent)));
+	}
+	CHECK(fMaxTangentError <= kMaxAngleError);
+	CHECK(fMaxBitangentError <= kMaxAngleError);
+}
+
+TEST(VertexPacking_HalfTexcoords)
+{
+	std::mt19937 rng(4);
+	std::uniform_real_distribution<float> unitDist(0.f, 1.f);
+	std::uniform_real_distribution<float> tiledDist(-16.f, 16.f);
+	for (uint i = 0; i < kNumSamples; ++i)
+	{
+		Vec2 uv = (i & 1) ? Vec2(unitDist(rng), unitDist(rng)) : Vec2(tiledDist(rng), tiledDist(rng));
+		Vec2 uvDecoded = VertexPacking::UnpackTexcoord(VertexPacking::PackTexcoord(uv));
+
+		// Half precision has an 11 bit significand, so rounding is off by at most 2^-11 relative.
+		// Below 2^-14 the values are denormal and the error is fixed at half the smallest step.
+		float fMaxErrorU = std::max(fabsf(uv.x), 1.f / 16384.f) / 2048.f;
+		float fMaxErrorV = std::max(fabsf(uv.y), 1.f / 16384.f) / 2048.f;
+		CHECK(fabsf(uvDecoded.x - uv.x) <= fMaxErrorU);
+		CHECK(fabsf(uvDecoded.y - uv.y) <= fMaxErrorV);
+	}
+
+	// Texcoords on the edges of the unit square are exact.
+	const Vec2 corners[] = { Vec2(0.f, 0.f), Vec2(1.f, 0.f), Vec2(0.f, 1.f), Vec2(1.f, 1.f), Vec2(0.5f, 0.25f) };
+	for (const Vec2& uv : corners)
+	{
+		Vec2 uvDecoded = VertexPacking::UnpackTexcoord(VertexPacking::PackTexcoord(uv));
+		CHECK(uvDecoded.x == uv.x && uvDecoded.y == uv.y);
+	}
+}
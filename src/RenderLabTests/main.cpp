@@ -0,0 +1,14 @@
+#include "TestFramework.h"
+#include "UtilsLib/JobPool.h"
+
+// Headless tests for systems that can be exercised without a device or window.
+// Usage: RenderLabTests [-bench] [name filters...]
+int main(int argc, char** argv)
+{
+	int numFailed = Test::RunAll(argc, argv);
+
+	// Worker threads must be shut down before statics are destroyed.
+	JobPool::Cleanup();
+
+	return numFailed;
+}
@@ -1,49 +1,244 @@
 #include "Hash.h"
 #include "Error.h"
+#include "FileLoader.h"
+
+#if defined(_WIN32)
 #include <windows.h>
 #include <winternl.h>
 #include <bcrypt.h>
+#include <intrin.h>
 
 #pragma comment(lib, "bcrypt.lib")
+#endif
 
 using namespace Hashing;
 
 namespace
 {
-	BCRYPT_ALG_HANDLE s_algorithmSHA1 = 0;
+	//////////////////////////////////////////////////////////////////////////
+	// Fast hash
+	// Follows the structure of XXH3: the input is consumed in 32-byte stripes, each of its four 64-bit lanes is mixed
+	// with a block of keying material and accumulated with a 32x32->64 multiply, and the accumulators are scrambled
+	// every few stripes.  The lanes are independent so the stripe loop vectorizes.  The accumulators are folded down
+	// with 64x64->128 multiplies at the end.
+	const uint kHashLanes = 4;
+	const uint kHashStripeSize = kHashLanes * sizeof(uint64);
+	const uint kHashStripesPerBlock = 8;
+
+	const uint64 kHashPrime64_1 = 0x9e3779b185ebca87ull;
+	const uint64 kHashPrime64_2 = 0xc2b2ae3d27d4eb4full;
+	const uint64 kHashPrime32_1 = 0x9e3779b1ull;
+
+	// Random keying material.  Stripes use successive 8-byte offsets into it.
+	const uint64 kHashSecret[16] = {
+		0xdaeb8ebd244a330cull, 0x685bd8519d0023dbull,
+		0x959ef8713231c2caull, 0xd1ea2fa4dd9af44cull,
+		0xa402cba46b82bdddull, 0x4f7580cd7b17a39eull,
+		0xc8b045b99d6fb286ull, 0xceca0ca0c351e0a7ull,
+		0x38987f53584df3c8ull, 0xbb74476ee0b6e30full,
+		0x9474c83868219521ull, 0xa309f5fba2117b34ull,
+		0xf901131499f29aadull, 0x6568525f65be34aeull,
+		0xe61c980e7426b628ull, 0xf330a10b9efe9904ull,
+	};
+	const uint kHashScrambleSecret = 12;
+	const uint kHashMergeSecretLow = 8;
+	const uint kHashMergeSecretHigh = 11;
+
+	// Assumes a little-endian target, like the rest of the engine's data formats.
+	inline uint64 read64(const uint8* pData)
+	{
+		uint64 value;
+		memcpy(&value, pData, sizeof(value));
+		return value;
+	}
+
+	// Multiplies to 128 bits and folds the halves together.
+	inline uint64 mulFold64(uint64 a, uint64 b)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		uint64 high;
+		uint64 low = _umul128(a, b, &high);
+		return low ^ high;
+#elif defined(__SIZEOF_INT128__)
+		unsigned __int128 product = (unsigned __int128)a * b;
+		return (uint64)product ^ (uint64)(product >> 64);
+#else
+		uint64 aLow = a & 0xffffffff, aHigh = a >> 32;
+		uint64 bLow = b & 0xffffffff, bHigh = b >> 32;
+		uint64 lowLow = aLow * bLow;
+		uint64 highLow = aHigh * bLow;
+		uint64 lowHigh = aLow * bHigh;
+		uint64 highHigh = aHigh * bHigh;
+		uint64 cross = (lowLow >> 32) + (highLow & 0xffffffff) + lowHigh;
+		uint64 high = highHigh + (highLow >> 32) + (cross >> 32);
+		uint64 low = (cross << 32) | (lowLow & 0xffffffff);
+		return low ^ high;
+#endif
+	}
+
+	inline uint64 avalanche(uint64 hash)
+	{
+		hash ^= hash >> 37;
+		hash *= 0x165667919e3779f9ull;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	inline void accumulateStripe(uint64 acc[kHashLanes], const uint8* pStripe, const uint64* pSecret)
+	{
+		for (uint i = 0; i < kHashLanes; ++i)
+		{
+			uint64 value = read64(pStripe + i * sizeof(uint64));
+			uint64 key = value ^ pSecret[i];
+			acc[i ^ 1] += value;
+			acc[i] += (key & 0xffffffff) * (key >> 32);
+		}
+	}
+
+	inline void scrambleAccumulators(uint64 acc[kHashLanes])
+	{
+		const uint64* pSecret = kHashSecret + kHashScrambleSecret;
+		for (uint i = 0; i < kHashLanes; ++i)
+		{
+			acc[i] ^= acc[i] >> 47;
+			acc[i] ^= pSecret[i];
+			acc[i] *= kHashPrime32_1;
+		}
+	}
+
+	void accumulateData(uint64 acc[kHashLanes], const uint8* pData, uint dataSize, uint64 seed)
+	{
+		acc[0] = seed + kHashPrime64_1;
+		acc[1] = seed ^ kHashPrime64_2;
+		acc[2] = seed - kHashPrime64_1;
+		acc[3] = ~seed + kHashPrime64_2;
+
+		uint numFullStripes = dataSize / kHashStripeSize;
+		uint stripe = 0;
+		for (uint i = 0; i < numFullStripes; ++i)
+		{
+			accumulateStripe(acc, pData + i * kHashStripeSize, kHashSecret + stripe);
+			if (++stripe == kHashStripesPerBlock)
+			{
+				scrambleAccumulators(acc);
+				stripe = 0;
+			}
+		}
 
-	void initSHA1()
+		// The final partial stripe is zero padded.  The length is mixed in when merging, so padding can't collide with data.
+		uint remainder = dataSize % kHashStripeSize;
+		if (remainder)
+		{
+			uint8 lastStripe[kHashStripeSize] = { 0 };
+			memcpy(lastStripe, pData + numFullStripes * kHashStripeSize, remainder);
+			accumulateStripe(acc, lastStripe, kHashSecret + stripe);
+		}
+	}
+
+	uint64 mergeAccumulators(const uint64 acc[kHashLanes], const uint64* pSecret, uint64 start)
 	{
-		if (!NT_SUCCESS(BCryptOpenAlgorithmProvider(&s_algorithmSHA1, BCRYPT_SHA1_ALGORITHM, nullptr, 0)))
+		uint64 result = start;
+		result += mulFold64(acc[0] ^ pSecret[0], acc[1] ^ pSecret[1]);
+		result += mulFold64(acc[2] ^ pSecret[2], acc[3] ^ pSecret[3]);
+		return avalanche(result);
+	}
+
+#if defined(_WIN32)
+	//////////////////////////////////////////////////////////////////////////
+	// SHA1 through the Windows cryptography API
+	BCRYPT_ALG_HANDLE openSHA1Provider()
+	{
+		BCRYPT_ALG_HANDLE hAlgorithm = 0;
+		if (!NT_SUCCESS(BCryptOpenAlgorithmProvider(&hAlgorithm, BCRYPT_SHA1_ALGORITHM, nullptr, 0)))
 		{
 			Error("Failed to create SHA1 algorithm provider");
 		}
+		return hAlgorithm;
 	}
 
-}
+	BCRYPT_ALG_HANDLE getSHA1Provider()
+	{
+		// Opened on first use.  Hashes may be started from several threads at once, which a static local handles.
+		static BCRYPT_ALG_HANDLE s_algorithmSHA1 = openSHA1Provider();
+		return s_algorithmSHA1;
+	}
+#else
+	//////////////////////////////////////////////////////////////////////////
+	// Portable SHA1 (FIPS 180-4) for platforms without BCrypt.
+	struct PortableSHA1State
+	{
+		uint h[5];
+		uint8 block[64];
+		uint blockSize;
+		uint64 totalSize;
+	};
 
-SHA1HashState* SHA1::Begin()
-{
-	if (!s_algorithmSHA1)
-		initSHA1();
+	inline uint rotateLeft(uint value, int bits)
+	{
+		return (value << bits) | (value >> (32 - bits));
+	}
 
-	BCRYPT_HASH_HANDLE hHash;
-	if (!NT_SUCCESS(BCryptCreateHash(s_algorithmSHA1, &hHash, nullptr, 0, nullptr, 0, 0)))
-		Error("Failed to create SHA1 hash");
+	void sha1ProcessBlock(uint h[5], const uint8* pBlock)
+	{
+		uint w[80];
+		for (uint i = 0; i < 16; ++i)
+		{
+			w[i] = ((uint)pBlock[i * 4] << 24) | ((uint)pBlock[i * 4 + 1] << 16) | ((uint)pBlock[i * 4 + 2] << 8) | pBlock[i * 4 + 3];
+		}
+		for (uint i = 16; i < 80; ++i)
+		{
+			w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+		}
 
-	return hHash;
+		uint a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+		for (uint i = 0; i < 80; ++i)
+		{
+			uint f, k;
+			if (i < 20)
+			{
+				f = (b & c) | (~b & d);
+				k = 0x5a827999;
+			}
+			else if (i < 40)
+			{
+				f = b ^ c ^ d;
+				k = 0x6ed9eba1;
+			}
+			else if (i < 60)
+			{
+				f = (b & c) | (b & d) | (c & d);
+				k = 0x8f1bbcdc;
+			}
+			else
+			{
+				f = b ^ c ^ d;
+				k = 0xca62c1d6;
+			}
+
+			uint temp = rotateLeft(a, 5) + f + e + k + w[i];
+			e = d;
+			d = c;
+			c = rotateLeft(b, 30);
+			b = a;
+			a = temp;
+		}
+
+		h[0] += a;
+		h[1] += b;
+		h[2] += c;
+		h[3] += d;
+		h[4] += e;
+	}
+#endif
 }
 
-SHA1HashState* SHA1::Begin(const void* pData, uint dataSize)
+#if defined(_WIN32)
+SHA1HashState* SHA1::Begin()
 {
-	if (!s_algorithmSHA1)
-		initSHA1();
-
 	BCRYPT_HASH_HANDLE hHash;
-	if (!NT_SUCCESS(BCryptCreateHash(s_algorithmSHA1, &hHash, nullptr, 0, nullptr, 0, 0)))
+	if (!NT_SUCCESS(BCryptCreateHash(getSHA1Provider(), &hHash, nullptr, 0, nullptr, 0, 0)))
 		Error("Failed to create SHA1 hash");
 
-	Update(hHash, pData, dataSize);
 	return hHash;
 }
 
@@ -59,6 +254,93 @@ void SHA1::Finish(SHA1HashState* pState, SHA1& rOutHash)
 		Error("Failed to finalize SHA1 hash");
 	BCryptDestroyHash(pState);
 }
+#else
+SHA1HashState* SHA1::Begin()
+{
+	PortableSHA1State* pState = new PortableSHA1State();
+	pState->h[0] = 0x67452301;
+	pState->h[1] = 0xefcdab89;
+	pState->h[2] = 0x98badcfe;
+	pState->h[3] = 0x10325476;
+	pState->h[4] = 0xc3d2e1f0;
+	pState->blockSize = 0;
+	pState->totalSize = 0;
+	return pState;
+}
+
+void SHA1::Update(SHA1HashState* pState, const void* pData, uint dataSize)
+{
+	PortableSHA1State* pSHA1State = (PortableSHA1State*)pState;
+	const uint8* pBytes = (const uint8*)pData;
+	pSHA1State->totalSize += dataSize;
+
+	while (dataSize > 0)
+	{
+		uint copySize = sizeof(pSHA1State->block) - pSHA1State->blockSize;
+		if (copySize > dataSize)
+		{
+			copySize = dataSize;
+		}
+
+		memcpy(pSHA1State->block + pSHA1State->blockSize, pBytes, copySize);
+		pSHA1State->blockSize += copySize;
+		pBytes += copySize;
+		dataSize -= copySize;
+
+		if (pSHA1State->blockSize == sizeof(pSHA1State->block))
+		{
+			sha1ProcessBlock(pSHA1State->h, pSHA1State->block);
+			pSHA1State->blockSize = 0;
+		}
+	}
+}
+
+void SHA1::Finish(SHA1HashState* pState, SHA1& rOutHash)
+{
+	PortableSHA1State* pSHA1State = (PortableSHA1State*)pState;
+	uint64 totalBits = pSHA1State->totalSize * 8;
+
+	// Pad with a one bit and zeros so the message length fits in the last 8 bytes of a block.
+	uint8 padding[72] = { 0x80 };
+	uint paddingSize = (pSHA1State->blockSize < 56) ? (56 - pSHA1State->blockSize) : (120 - pSHA1State->blockSize);
+	for (uint i = 0; i < 8; ++i)
+	{
+		padding[paddingSize + i] = (uint8)(totalBits >> (56 - i * 8));
+	}
+	Update(pState, padding, paddingSize + 8);
+
+	for (uint i = 0; i < 5; ++i)
+	{
+		rOutHash.data[i * 4 + 0] = (uchar)(pSHA1State->h[i] >> 24);
+		rOutHash.data[i * 4 + 1] = (uchar)(pSHA1State->h[i] >> 16);
+		rOutHash.data[i * 4 + 2] = (uchar)(pSHA1State->h[i] >> 8);
+		rOutHash.data[i * 4 + 3] = (uchar)(pSHA1State->h[i]);
+	}
+
+	delete pSHA1State;
+}
+#endif
+
+SHA1HashState* SHA1::Begin(const void* pData, uint dataSize)
+{
+	SHA1HashState* pState = Begin();
+	Update(pState, pData, dataSize);
+	return pState;
+}
+
+bool SHA1::HashFile(const char* filename, SHA1& rOutHash)
+{
+	char* pFileData;
+	uint fileSize;
+	if (!FileLoader::Load(filename, &pFileData, &fileSize))
+		return false;
+
+	SHA1HashState* pState = Begin(pFileData, fileSize);
+	Finish(pState, rOutHash);
+
+	delete pFileData;
+	return true;
+}
 
 StringHash Hashing::HashString(const char* str)
 {
@@ -71,4 +353,22 @@ StringHash Hashing::HashString(const char* str)
 		hash = c + (hash << 6) + (hash << 16) - hash;
 
 	return hash;
-}
\ No newline at end of file
+}
+
+uint64 Hashing::HashData64(const void* pData, uint dataSize, uint64 seed)
+{
+	uint64 acc[kHashLanes];
+	accumulateData(acc, (const uint8*)pData, dataSize, seed);
+	return mergeAccumulators(acc, kHashSecret + kHashMergeSecretLow, dataSize * kHashPrime64_1);
+}
+
+Hash128 Hashing::HashData128(const void* pData, uint dataSize, uint64 seed)
+{
+	uint64 acc[kHashLanes];
+	accumulateData(acc, (const uint8*)pData, dataSize, seed);
+
+	Hash128 hash;
+	hash.low = mergeAccumulators(acc, kHashSecret + kHashMergeSecretLow, dataSize * kHashPrime64_1);
+	hash.high = mergeAccumulators(acc, kHashSecret + kHashMergeSecretHigh, ~((uint64)dataSize * kHashPrime64_2));
+	return hash;
+}
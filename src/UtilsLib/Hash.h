@@ -1,7 +1,7 @@
 #pragma once
 
 #include "../Types.h"
-#include <vcruntime_string.h>
+#include <string.h>
 
 namespace Hashing
 {
@@ -13,6 +13,7 @@ namespace Hashing
 		static SHA1HashState* Begin(const void* pData, uint dataSize);
 		static void Update(SHA1HashState* pState, const void* pData, uint dataSize);
 		static void Finish(SHA1HashState* pState, SHA1& rOutHash);
+		static bool HashFile(const char* filename, SHA1& rOutHash);
 
 		uchar data[20];
 	
@@ -20,9 +21,46 @@ namespace Hashing
 		{
 			return memcmp(data, other.data, sizeof(data)) < 0;
 		}
+
+		bool operator == (const SHA1& other) const
+		{
+			return memcmp(data, other.data, sizeof(data)) == 0;
+		}
+
+		bool operator != (const SHA1& other) const
+		{
+			return !(*this == other);
+		}
 	};
 
 	typedef uint StringHash;
 
 	StringHash HashString(const char* str);
+
+	struct Hash128
+	{
+		uint64 low;
+		uint64 high;
+
+		bool operator < (const Hash128& other) const
+		{
+			return (high != other.high) ? (high < other.high) : (low < other.low);
+		}
+
+		bool operator == (const Hash128& other) const
+		{
+			return low == other.low && high == other.high;
+		}
+
+		bool operator != (const Hash128& other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	// Fast non-cryptographic hashes for run-time keys such as cache and lookup table keys.
+	// Results are the same on every platform and run, so they can be stored, but they shouldn't be used to identify
+	// file contents or anything an adversary controls; use SHA1 for those.
+	uint64 HashData64(const void* pData, uint dataSize, uint64 seed = 0);
+	Hash128 HashData128(const void* pData, uint dataSize, uint64 seed = 0);
 }
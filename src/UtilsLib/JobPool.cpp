@@ -0,0 +1,204 @@
+#include "JobPool.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+	struct Job
+	{
+		JobPool::RangeFunc func;
+		void* pUserData;
+		uint nCount;
+		uint nGrainSize;
+		std::atomic<uint> nextIndex;
+
+		// Workers currently running ranges of this job, and how many may join the calling thread.  Guarded by the pool mutex.
+		uint nActiveWorkers;
+		uint nMaxWorkers;
+	};
+
+	struct
+	{
+		std::vector<std::thread> threads;
+
+		std::mutex mutex;
+		std::condition_variable wakeCondition;
+		std::condition_variable doneCondition;
+		bool bTerminate;
+
+		// Jobs that may still have unclaimed ranges, one per ParallelFor() in flight.
+		// Each caller owns its job, so calls from different threads don't wait on each other.
+		std::vector<Job*> activeJobs;
+
+		// Bumped for every new job so busy workers can move over to it.
+		std::atomic<uint> nSubmitCount;
+
+		// See JobPool::SetMaxThreadCount().  0 when unlimited.
+		std::atomic<uint> nMaxThreads;
+	} s_jobPool;
+
+	thread_local bool s_bIsWorkerThread = false;
+
+	// Runs ranges until all have been claimed and returns true.
+	// Workers pass the submit count they started with and return false early if another job has been submitted since.
+	bool runJob(Job& rJob, const uint* pSubmitCount)
+	{
+		while (true)
+		{
+			uint nBegin = rJob.nextIndex.fetch_add(rJob.nGrainSize);
+			if (nBegin >= rJob.nCount)
+				return true;
+
+			uint nEnd = std::min(nBegin + rJob.nGrainSize, rJob.nCount);
+			rJob.func(nBegin, nEnd, rJob.pUserData);
+
+			if (pSubmitCount && *pSubmitCount != s_jobPool.nSubmitCount.load(std::memory_order_relaxed))
+				return false;
+		}
+	}
+
+	// Removes a job whose ranges have all been claimed.  Must be called with the pool mutex held.
+	void retireJob(Job* pJob)
+	{
+		auto iter = std::find(s_jobPool.activeJobs.begin(), s_jobPool.activeJobs.end(), pJob);
+		if (iter != s_jobPool.activeJobs.end())
+		{
+			s_jobPool.activeJobs.erase(iter);
+		}
+	}
+
+	// Picks the job with the fewest workers so concurrent callers share the pool instead of queueing behind each other.
+	// Returns null if every job already has as many workers as it allows.  Must be called with the pool mutex held.
+	Job* pickJob()
+	{
+		Job* pBestJob = nullptr;
+		for (Job* pJob : s_jobPool.activeJobs)
+		{
+			if (pJob->nActiveWorkers < pJob->nMaxWorkers && (!pBestJob || pJob->nActiveWorkers < pBestJob->nActiveWorkers))
+			{
+				pBestJob = pJob;
+			}
+		}
+		return pBestJob;
+	}
+
+	void workerThreadMain()
+	{
+		s_bIsWorkerThread = true;
+
+		std::unique_lock<std::mutex> lock(s_jobPool.mutex);
+		while (true)
+		{
+			Job* pJob = nullptr;
+			s_jobPool.wakeCondition.wait(lock, [&pJob]() { return s_jobPool.bTerminate || (pJob = pickJob()) != nullptr; });
+			if (s_jobPool.bTerminate)
+				return;
+
+			++pJob->nActiveWorkers;
+			uint nSubmitCount = s_jobPool.nSubmitCount;
+			lock.unlock();
+
+			bool bFinished = runJob(*pJob, &nSubmitCount);
+
+			lock.lock();
+			if (bFinished)
+			{
+				// Every range has been claimed, so stop other workers from picking it up.
+				retireJob(pJob);
+			}
+			if (--pJob->nActiveWorkers == 0)
+			{
+				s_jobPool.doneCondition.notify_all();
+			}
+		}
+	}
+
+	uint getHardwareThreadCount()
+	{
+		return std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	void initThreads()
+	{
+		s_jobPool.bTerminate = false;
+
+		// Leave one hardware thread for the caller.
+		uint nNumWorkers = getHardwareThreadCount() - 1;
+		for (uint i = 0; i < nNumWorkers; ++i)
+		{
+			s_jobPool.threads.push_back(std::thread(workerThreadMain));
+		}
+	}
+}
+
+uint JobPool::GetThreadCount()
+{
+	uint nMaxThreads = s_jobPool.nMaxThreads;
+	return nMaxThreads ? std::min(nMaxThreads, getHardwareThreadCount()) : getHardwareThreadCount();
+}
+
+void JobPool::SetMaxThreadCount(uint nMaxThreads)
+{
+	s_jobPool.nMaxThreads = nMaxThreads;
+}
+
+void JobPool::ParallelFor(uint nCount, uint nGrainSize, RangeFunc func, void* pUserData)
+{
+	nGrainSize = std::max(nGrainSize, 1u);
+
+	uint nThreadCount = GetThreadCount();
+	if (nCount <= nGrainSize || s_bIsWorkerThread || nThreadCount == 1)
+	{
+		func(0, nCount, pUserData);
+		return;
+	}
+
+	Job job;
+	job.func = func;
+	job.pUserData = pUserData;
+	job.nCount = nCount;
+	job.nGrainSize = nGrainSize;
+	job.nextIndex = 0;
+	job.nActiveWorkers = 0;
+	job.nMaxWorkers = nThreadCount - 1;
+
+	{
+		std::lock_guard<std::mutex> lock(s_jobPool.mutex);
+		if (s_jobPool.threads.empty())
+		{
+			initThreads();
+		}
+
+		s_jobPool.activeJobs.push_back(&job);
+		++s_jobPool.nSubmitCount;
+	}
+	s_jobPool.wakeCondition.notify_all();
+
+	// The calling thread does its share of the work too.
+	runJob(job, nullptr);
+
+	// Once every range has been claimed, wait for workers still finishing theirs.
+	// Retiring the job under the lock ensures no late waking worker picks it up after it goes out of scope.
+	std::unique_lock<std::mutex> lock(s_jobPool.mutex);
+	retireJob(&job);
+	s_jobPool.doneCondition.wait(lock, [&job]() { return job.nActiveWorkers == 0; });
+}
+
+void JobPool::Cleanup()
+{
+	{
+		std::lock_guard<std::mutex> lock(s_jobPool.mutex);
+		s_jobPool.bTerminate = true;
+	}
+	s_jobPool.wakeCondition.notify_all();
+
+	for (std::thread& rThread : s_jobPool.threads)
+	{
+		rThread.join();
+	}
+	s_jobPool.threads.clear();
+}
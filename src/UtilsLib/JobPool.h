@@ -0,0 +1,24 @@
+#pragma once
+#include "../Types.h"
+
+// Persistent worker threads for data parallel work.
+// Worker threads are created on first use and live until Cleanup().
+namespace JobPool
+{
+	// Processes indices [nBegin, nEnd).
+	typedef void (*RangeFunc)(uint nBegin, uint nEnd, void* pUserData);
+
+	// Number of threads that work on a ParallelFor(), including the calling thread.
+	uint GetThreadCount();
+
+	// Limits the threads that work on each ParallelFor() started after this call, including the calling thread.
+	// 0 removes the limit.  Lets benchmarks compare the pool against a single thread.
+	void SetMaxThreadCount(uint nMaxThreads);
+
+	// Splits [0, nCount) into ranges of nGrainSize and runs them across the workers and the calling thread.
+	// Blocks until every range has completed.  Calls made from inside a job run inline on the calling worker.
+	// Calls from different threads run concurrently, with idle workers going to the call that has the fewest.
+	void ParallelFor(uint nCount, uint nGrainSize, RangeFunc func, void* pUserData);
+
+	void Cleanup();
+}
@@ -51,6 +51,72 @@ namespace
 
 		s_initialized = true;
 	}
+
+	bool isRelativeDirEntry(const char* filename)
+	{
+		return strcmp(filename, ".") == 0 || strcmp(filename, "..") == 0;
+	}
+
+	void joinPath(char* outPath, int maxPathLen, const char* dir, const char* filename)
+	{
+		if (dir[0])
+			sprintf_s(outPath, maxPathLen, "%s\\%s", dir, filename);
+		else
+			strcpy_s(outPath, maxPathLen, filename);
+	}
+
+	// Filenames passed to the callback are relative to the root search directory.
+	// The '.' and '..' entries are only reported for the root directory.
+	void forEachFileInDir(const char* dir, const char* relDir, const char* pattern, bool includeSubDirs, Paths::FileCallback callback, void* pUserData)
+	{
+		char searchPath[FILE_MAX_PATH];
+		joinPath(searchPath, ARRAY_SIZE(searchPath), dir, pattern);
+
+		WIN32_FIND_DATAA findData;
+		HANDLE hFind = FindFirstFileA(searchPath, &findData);
+		if (hFind != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				bool isDirectory = (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+				if (relDir[0] && isDirectory && isRelativeDirEntry(findData.cFileName))
+					continue;
+
+				char relName[FILE_MAX_PATH];
+				joinPath(relName, ARRAY_SIZE(relName), relDir, findData.cFileName);
+				callback(relName, isDirectory, pUserData);
+			}
+			while (FindNextFileA(hFind, &findData) != 0);
+
+			FindClose(hFind);
+		}
+
+		if (!includeSubDirs)
+			return;
+
+		// The file pattern may exclude directories, so sub-directories are found with a separate search.
+		joinPath(searchPath, ARRAY_SIZE(searchPath), dir, "*");
+		hFind = FindFirstFileA(searchPath, &findData);
+		if (hFind == INVALID_HANDLE_VALUE)
+			return;
+
+		do
+		{
+			if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && !isRelativeDirEntry(findData.cFileName))
+			{
+				char subDir[FILE_MAX_PATH];
+				joinPath(subDir, ARRAY_SIZE(subDir), dir, findData.cFileName);
+
+				char subRelDir[FILE_MAX_PATH];
+				joinPath(subRelDir, ARRAY_SIZE(subRelDir), relDir, findData.cFileName);
+
+				forEachFileInDir(subDir, subRelDir, pattern, true, callback, pUserData);
+			}
+		}
+		while (FindNextFileA(hFind, &findData) != 0);
+
+		FindClose(hFind);
+	}
 }
 
 const char* Paths::GetSrcDataDir()
@@ -108,28 +174,20 @@ void Paths::GetFilenameNoExtension(const char* path, char* outFilename, int maxN
 
 void Paths::ForEachFile(const char* searchPattern, bool includeSubDirs, FileCallback callback, void* pUserData)
 {
-	WIN32_FIND_DATAA findData;
-
-	HANDLE hFind = FindFirstFileA(searchPattern, &findData);
-	if (hFind == INVALID_HANDLE_VALUE)
-		return;
-
-	do
+	// Split the search pattern into its directory and file pattern parts.
+	char dir[FILE_MAX_PATH] = { 0 };
+	const char* pattern = searchPattern;
+	for (int i = (int)strlen(searchPattern) - 1; i >= 0; --i)
 	{
-		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-		{
-			callback(findData.cFileName, true, pUserData);
-			if (includeSubDirs)
-				ForEachFile(findData.cFileName, true, callback, pUserData);
-		}
-		else
+		if (searchPattern[i] == '/' || searchPattern[i] == '\\')
 		{
-			callback(findData.cFileName, false, pUserData);
+			strncpy_s(dir, searchPattern, i);
+			pattern = searchPattern + i + 1;
+			break;
 		}
-	} 
-	while (FindNextFileA(hFind, &findData) != 0);
+	}
 
-	FindClose(hFind);
+	forEachFileInDir(dir, "", pattern, includeSubDirs, callback, pUserData);
 }
 
 void Paths::CreateDirectoryTreeForFile(const std::string& filename)
@@ -14,6 +14,7 @@ namespace Paths
 
 	void GetFilenameNoExtension(const char* path, char* outFilename, int maxNameLen);
 
+	// Callback filenames are relative to the directory of the search pattern.
 	typedef void (*FileCallback)(const char* filename, bool isDirectory, void* pUserData);
 	void ForEachFile(const char* searchPattern, bool includeSubDirs, FileCallback callback, void* pUserData);
 }